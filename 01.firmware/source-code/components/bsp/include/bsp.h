@@ -1,6 +1,8 @@
 #ifndef BSP_H_
 #define BSP_H_
 
+#include "sdkconfig.h"
+
 /* LCD size */
 #define EXAMPLE_LCD_H_RES (720)
 #define EXAMPLE_LCD_V_RES (720)
@@ -37,4 +39,17 @@
 #define SD_D2 (GPIO_NUM_41)
 #define SD_D3 (GPIO_NUM_42)
 
+/* Audio: ES8311 codec on the touch I2C bus, playback over I2S
+ * 原理图上没有音频通路，默认关闭；打开后的引脚在 menuconfig "Audio Configuration" 里配（默认值取自 EV 板）
+ */
+#if CONFIG_BSP_AUDIO_ENABLE
+#define BSP_I2S_NUM (CONFIG_BSP_I2S_NUM)
+#define BSP_I2S_MCLK (CONFIG_BSP_I2S_MCLK_GPIO) // -1：不接 MCLK，ES8311 用 SCLK 作时钟
+#define BSP_I2S_SCLK (CONFIG_BSP_I2S_SCLK_GPIO)
+#define BSP_I2S_LRCK (CONFIG_BSP_I2S_LRCK_GPIO)
+#define BSP_I2S_DOUT (CONFIG_BSP_I2S_DOUT_GPIO)
+#define BSP_POWER_AMP_IO (CONFIG_BSP_POWER_AMP_GPIO) // -1：功放常开
+#endif
+#define BSP_AUDIO_SAMPLE_RATE (44100) // I2S 固定在这个采样率，各路声音由混音器转换
+
 #endif
\ No newline at end of file
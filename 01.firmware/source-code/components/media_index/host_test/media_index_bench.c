@@ -0,0 +1,310 @@
+// media_index 的主机测试：自然排序、过滤、缓存校验和查找，N 个文件的目录上计时
+
+#include "media_index.h"
+
+#include <dirent.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+static int s_fail = 0;
+
+#define CHECK(cond, ...)                                     \
+    do                                                       \
+    {                                                        \
+        if (!(cond))                                         \
+        {                                                    \
+            printf("FAIL %s:%d: ", __FILE__, __LINE__);      \
+            printf(__VA_ARGS__);                             \
+            printf("\n");                                    \
+            s_fail++;                                        \
+        }                                                    \
+    } while (0)
+
+static int64_t now_us(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+static void touch(const char *dir, const char *name)
+{
+    char path[512];
+    snprintf(path, sizeof(path), "%s/%s", dir, name);
+    int fd = open(path, O_CREAT | O_WRONLY, 0644);
+    if (fd >= 0)
+        close(fd);
+}
+
+static void test_natural_cmp(void)
+{
+    static const char *sorted[] = {
+        "a", "A1", "a2", "a02", "a10", "a10b", "B", "track 9.mp3", "Track 10.mp3", "track 100.mp3", "z",
+    };
+    size_t n = sizeof(sorted) / sizeof(sorted[0]);
+    for (size_t i = 0; i + 1 < n; i++)
+    {
+        CHECK(media_index_natural_cmp(sorted[i], sorted[i + 1]) < 0, "\"%s\" < \"%s\"", sorted[i], sorted[i + 1]);
+        CHECK(media_index_natural_cmp(sorted[i + 1], sorted[i]) > 0, "\"%s\" > \"%s\"", sorted[i + 1], sorted[i]);
+    }
+    CHECK(media_index_natural_cmp("x1", "x1") == 0, "equal");
+    CHECK(media_index_natural_cmp("99999999999999999999", "100000000000000000000") < 0, "long digit runs");
+}
+
+// 以前的做法：两遍 readdir，每个文件 malloc 一份完整路径，按名字找要线性比较
+static double baseline_scan_ms(const char *dir, char ***out, size_t *out_n)
+{
+    int64_t t0 = now_us();
+    DIR *d = opendir(dir);
+    size_t n = 0;
+    struct dirent *ent;
+    while ((ent = readdir(d)) != NULL)
+    {
+        const char *dot = strrchr(ent->d_name, '.');
+        if (ent->d_name[0] != '.' && dot && strcasecmp(dot, ".mp3") == 0)
+            n++;
+    }
+    char **list = (char **)calloc(n ? n : 1, sizeof(char *));
+    rewinddir(d);
+    size_t i = 0;
+    while ((ent = readdir(d)) != NULL && i < n)
+    {
+        const char *dot = strrchr(ent->d_name, '.');
+        if (ent->d_name[0] == '.' || !dot || strcasecmp(dot, ".mp3") != 0)
+            continue;
+        size_t need = strlen(dir) + strlen(ent->d_name) + 2;
+        list[i] = (char *)malloc(need);
+        snprintf(list[i++], need, "%s/%s", dir, ent->d_name);
+    }
+    closedir(d);
+    *out = list;
+    *out_n = i;
+    return (now_us() - t0) / 1000.0;
+}
+
+static void print_stats(const char *what, const media_index_t *mi, double total_ms)
+{
+    media_index_stats_t st;
+    media_index_get_stats(mi, &st);
+    printf("%-22s %8.1f ms  (list %.1f, sort %.1f, build %.1f, cache %.1f)  %zu entries, %zu KiB%s\n", what,
+           total_ms, st.list_us / 1000.0, st.sort_us / 1000.0, st.build_us / 1000.0, st.cache_us / 1000.0,
+           media_index_count(mi), st.bytes / 1024, st.from_cache ? "  [cache]" : "");
+}
+
+static bool same_order(const media_index_t *a, const media_index_t *b)
+{
+    if (media_index_count(a) != media_index_count(b))
+        return false;
+    for (size_t i = 0; i < media_index_count(a); i++)
+    {
+        if (strcmp(media_index_path(a, i), media_index_path(b, i)) != 0)
+            return false;
+    }
+    return true;
+}
+
+static media_index_t *timed_open(const char *dir, const media_index_config_t *cfg, double *ms)
+{
+    int64_t t0 = now_us();
+    media_index_t *mi = media_index_open(dir, cfg);
+    *ms = (now_us() - t0) / 1000.0;
+    return mi;
+}
+
+int main(int argc, char **argv)
+{
+    size_t n = 50000;
+    bool keep = false;
+    int opt;
+    while ((opt = getopt(argc, argv, "n:k")) != -1)
+    {
+        if (opt == 'n')
+            n = (size_t)strtoul(optarg, NULL, 0);
+        else if (opt == 'k')
+            keep = true;
+    }
+
+    test_natural_cmp();
+
+    char dir[] = "/tmp/media_index_XXXXXX";
+    if (!mkdtemp(dir))
+    {
+        perror("mkdtemp");
+        return 1;
+    }
+
+    // 打乱创建顺序，readdir 的顺序就不是排好的；每 8 个里有 1 个不是 .mp3，另有子目录和隐藏文件
+    size_t *perm = (size_t *)malloc(n * sizeof(size_t));
+    for (size_t i = 0; i < n; i++)
+        perm[i] = i;
+    srand(1);
+    for (size_t i = n; i > 1; i--)
+    {
+        size_t j = (size_t)rand() % i;
+        size_t t = perm[i - 1];
+        perm[i - 1] = perm[j];
+        perm[j] = t;
+    }
+    size_t mp3 = 0;
+    int64_t t0 = now_us();
+    for (size_t i = 0; i < n; i++)
+    {
+        char name[64];
+        size_t k = perm[i];
+        if (k % 8 == 7)
+            snprintf(name, sizeof(name), "cover %zu.jpg", k);
+        else
+        {
+            snprintf(name, sizeof(name), "%s %zu.%s", k % 3 ? "Track" : "track", k, k % 5 ? "mp3" : "MP3");
+            mp3++;
+        }
+        touch(dir, name);
+    }
+    touch(dir, ".hidden.mp3");
+    char sub[600];
+    snprintf(sub, sizeof(sub), "%s/album.mp3", dir);
+    mkdir(sub, 0755);
+    printf("%zu files (%zu .mp3) in %s, created in %.0f ms\n\n", n, mp3, dir, (now_us() - t0) / 1000.0);
+
+    static const char *const exts[] = {".mp3", NULL};
+    media_index_config_t cfg = {.exts = exts, .natural_sort = true};
+
+    // 以前的两遍扫描做参照
+    char **base;
+    size_t base_n;
+    double ms = baseline_scan_ms(dir, &base, &base_n);
+    printf("%-22s %8.1f ms  %zu entries, unsorted\n", "two-pass readdir", ms, base_n);
+    CHECK(base_n == mp3 + 1, "baseline count %zu", base_n); // 它把 album.mp3 子目录也算进去了
+
+    // 扫描 + 排序
+    media_index_t *mi = timed_open(dir, &cfg, &ms);
+    CHECK(mi != NULL, "open");
+    print_stats("scan + natural sort", mi, ms);
+    CHECK(media_index_count(mi) == mp3, "count %zu != %zu", media_index_count(mi), mp3);
+    for (size_t i = 0; i + 1 < media_index_count(mi); i++)
+    {
+        if (media_index_natural_cmp(media_index_name(mi, i), media_index_name(mi, i + 1)) >= 0)
+        {
+            CHECK(0, "order at %zu: %s, %s", i, media_index_name(mi, i), media_index_name(mi, i + 1));
+            break;
+        }
+    }
+    CHECK(strcmp(media_index_name(mi, 0), "track 0.MP3") == 0, "first %s", media_index_name(mi, 0));
+    CHECK(media_index_path(mi, media_index_count(mi)) == NULL, "out of range");
+
+    // 查找：下标 → 路径 → 下标
+    size_t cnt = media_index_count(mi);
+    t0 = now_us();
+    size_t bad = 0;
+    for (size_t i = 0; i < cnt; i++)
+        bad += media_index_find(mi, media_index_path(mi, i)) != i;
+    double find_ns = (now_us() - t0) * 1000.0 / (cnt ? cnt : 1);
+    for (size_t i = 0; i < cnt; i++)
+        bad += media_index_find(mi, media_index_name(mi, i)) != i;
+    CHECK(bad == 0, "%zu lookups wrong", bad);
+    CHECK(media_index_find(mi, "cover 7.jpg") == MEDIA_INDEX_NONE, "filtered name found");
+    CHECK(media_index_find(mi, "nope.mp3") == MEDIA_INDEX_NONE, "missing name found");
+
+    size_t probes = cnt < 2000 ? cnt : 2000;
+    size_t found = 0;
+    t0 = now_us();
+    for (size_t i = 0; i < probes; i++)
+    {
+        const char *want = media_index_path(mi, (i * 7919) % cnt);
+        for (size_t j = 0; j < base_n; j++)
+        {
+            if (strcmp(base[j], want) == 0)
+            {
+                found++;
+                break;
+            }
+        }
+    }
+    double linear_ns = (now_us() - t0) * 1000.0 / (probes ? probes : 1);
+    CHECK(found == probes, "linear search found %zu of %zu", found, probes);
+    printf("%-22s %8.0f ns  (linear search over the list: %.0f ns)\n\n", "path -> index", find_ns, linear_ns);
+
+    // 缓存：第一次写，第二次读，顺序必须一样
+    cfg.cache = true;
+    media_index_t *c1 = timed_open(dir, &cfg, &ms);
+    print_stats("scan + write cache", c1, ms);
+    media_index_t *c2 = timed_open(dir, &cfg, &ms);
+    print_stats("cached, verified", c2, ms);
+    media_index_stats_t st;
+    media_index_get_stats(c2, &st);
+    CHECK(st.from_cache, "second open should use the cache");
+    CHECK(same_order(mi, c2), "cached order differs");
+
+    cfg.trust_mtime = true;
+    media_index_t *c3 = timed_open(dir, &cfg, &ms);
+    print_stats("cached, trust mtime", c3, ms);
+    media_index_get_stats(c3, &st);
+    CHECK(st.from_cache && st.list_us == 0, "trusted mtime should skip listing");
+    CHECK(same_order(mi, c3), "cached order differs");
+
+    // 不同过滤条件用各自的缓存
+    static const char *const jpg[] = {".jpg", NULL};
+    media_index_config_t jcfg = {.exts = jpg, .natural_sort = true, .cache = true};
+    media_index_t *j1 = media_index_open(dir, &jcfg);
+    CHECK(media_index_count(j1) == n - mp3, "jpg count %zu", media_index_count(j1));
+    media_index_close(j1);
+    media_index_t *c4 = media_index_open(dir, &cfg);
+    media_index_get_stats(c4, &st);
+    CHECK(st.from_cache && same_order(mi, c4), "mp3 cache lost after jpg index");
+    media_index_close(c4);
+
+    // 改名：数量不变，哈希变了 → 重新扫描（先关掉 trust_mtime，模拟 FAT 上 mtime 不变）
+    cfg.trust_mtime = false;
+    char from[600], to[600];
+    snprintf(from, sizeof(from), "%s", media_index_path(mi, 1));
+    snprintf(to, sizeof(to), "%s/zzz renamed.mp3", dir);
+    rename(from, to);
+    media_index_t *c5 = media_index_open(dir, &cfg);
+    media_index_get_stats(c5, &st);
+    CHECK(!st.from_cache, "rename not detected");
+    CHECK(media_index_count(c5) == mp3 && media_index_find(c5, "zzz renamed.mp3") == mp3 - 1, "renamed entry");
+    media_index_close(c5);
+
+    // 新增文件 → 重新扫描
+    touch(dir, "Track 0a.mp3");
+    media_index_t *c6 = media_index_open(dir, &cfg);
+    media_index_get_stats(c6, &st);
+    CHECK(!st.from_cache && media_index_count(c6) == mp3 + 1, "added file not detected");
+    CHECK(media_index_find(c6, "Track 0a.mp3") == 1, "new entry at %zu", media_index_find(c6, "Track 0a.mp3"));
+    media_index_close(c6);
+
+    // 结尾带 '/' 的目录、空结果
+    char slash[600];
+    snprintf(slash, sizeof(slash), "%s/", dir);
+    static const char *const none[] = {".flac", NULL};
+    media_index_config_t ncfg = {.exts = none};
+    media_index_t *e = media_index_open(slash, &ncfg);
+    CHECK(e && media_index_count(e) == 0 && media_index_find(e, "x.flac") == MEDIA_INDEX_NONE, "empty index");
+    media_index_close(e);
+    CHECK(media_index_open("/nonexistent/dir", &cfg) == NULL, "missing dir");
+
+    media_index_close(mi);
+    media_index_close(c1);
+    media_index_close(c2);
+    media_index_close(c3);
+    for (size_t i = 0; i < base_n; i++)
+        free(base[i]);
+    free(base);
+    free(perm);
+
+    if (!keep)
+    {
+        char cmd[600];
+        snprintf(cmd, sizeof(cmd), "rm -rf '%s'", dir);
+        if (system(cmd) != 0)
+            printf("could not remove %s\n", dir);
+    }
+
+    printf("\n%s\n", s_fail ? "FAILED" : "all checks passed");
+    return s_fail ? 1 : 0;
+}
@@ -0,0 +1,57 @@
+#pragma once
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// 媒体目录索引：一次 readdir 收集文件名（按扩展名过滤），自然排序后放进一整块字符串区，
+// 下标 → 路径、路径 → 下标都是 O(1)。可选把结果缓存到目录里，下次打开先校验再直接读，
+// 不用重新过滤、排序。相册、视频列表、音乐播放列表共用。
+
+#define MEDIA_INDEX_NONE ((size_t)-1)
+
+typedef struct media_index media_index_t;
+
+typedef struct
+{
+    const char *const *exts; // 只收这些扩展名（含点，不分大小写），NULL 结尾；NULL 表示全收
+    bool natural_sort;       // "a2" 排在 "a10" 前面，不分大小写；false 保持目录顺序
+    bool cache;              // 结果存到目录下的 .midx_xxxxxxxx（每种过滤条件一个）
+    bool trust_mtime;        // 缓存里的目录 mtime 没变就不再列目录。FAT 上增删文件不改目录 mtime，
+                             // 只适合内容由本机写入的目录；默认 false：列一遍目录比对数量和文件名哈希
+} media_index_config_t;
+
+typedef struct
+{
+    bool from_cache;
+    uint32_t list_us;  // readdir + 过滤（用缓存时是校验那一遍）
+    uint32_t sort_us;
+    uint32_t build_us; // 拼路径区和哈希表
+    uint32_t cache_us; // 读或写缓存文件
+    size_t bytes;      // 索引占用的内存
+} media_index_stats_t;
+
+// 目录打不开或内存不够返回 NULL；没有匹配的文件时返回空索引（count 为 0）
+media_index_t *media_index_open(const char *dir, const media_index_config_t *cfg);
+void media_index_close(media_index_t *mi);
+
+size_t media_index_count(const media_index_t *mi);
+
+// 完整路径 "dir/name"，索引关闭前一直有效；越界返回 NULL
+const char *media_index_path(const media_index_t *mi, size_t index);
+const char *media_index_name(const media_index_t *mi, size_t index);
+
+// 文件名或完整路径 → 下标，找不到返回 MEDIA_INDEX_NONE
+size_t media_index_find(const media_index_t *mi, const char *name_or_path);
+
+void media_index_get_stats(const media_index_t *mi, media_index_stats_t *out);
+
+// 排序用的比较：数字串按数值比，其余不分大小写
+int media_index_natural_cmp(const char *a, const char *b);
+
+#ifdef __cplusplus
+}
+#endif
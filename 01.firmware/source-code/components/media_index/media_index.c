@@ -0,0 +1,564 @@
+// media_index.c — 媒体目录索引
+// 内存布局：所有路径 "dir/name\0" 按最终顺序连续放在一块 arena 里，off[i] 是第 i 个的偏移；
+// 文件名 → 下标用开放寻址哈希表（存下标 + 1，0 为空）。大目录时都放 PSRAM。
+// 缓存文件：头 + 排好序的文件名（'\0' 分隔），校验通过时省掉过滤、排序和逐个 malloc。
+
+#include "media_index.h"
+
+#include <dirent.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <sys/stat.h>
+
+#ifdef ESP_PLATFORM
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "esp_heap_caps.h"
+#define MI_MALLOC(n) heap_caps_malloc_prefer((n), 2, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT, MALLOC_CAP_8BIT)
+#define MI_REALLOC(p, n) heap_caps_realloc_prefer((p), (n), 2, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT, MALLOC_CAP_8BIT)
+#define MI_FREE(p) heap_caps_free(p)
+static inline int64_t now_us(void) { return esp_timer_get_time(); }
+#else
+#include <time.h>
+#define ESP_LOGI(tag, fmt, ...) ((void)0)
+#define ESP_LOGW(tag, fmt, ...) fprintf(stderr, "W %s: " fmt "\n", tag, ##__VA_ARGS__)
+#define ESP_LOGE(tag, fmt, ...) fprintf(stderr, "E %s: " fmt "\n", tag, ##__VA_ARGS__)
+#define MI_MALLOC(n) malloc(n)
+#define MI_REALLOC(p, n) realloc((p), (n))
+#define MI_FREE(p) free(p)
+static inline int64_t now_us(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+#endif
+
+static const char *TAG = "media_index";
+
+#define CACHE_MAGIC 0x5844494Du // "MIDX"
+#define CACHE_VERSION 1
+#define CACHE_NAME_MAX 24       // ".midx_xxxxxxxx.tmp"
+
+struct media_index
+{
+    char *arena;
+    uint32_t *off;
+    uint32_t *slot;
+    uint32_t mask;
+    size_t count;
+    size_t dir_len; // prefix 的长度，含结尾的 '/'
+    media_index_stats_t stats;
+    char prefix[];  // "dir/"
+};
+
+typedef struct
+{
+    uint32_t magic;
+    uint16_t version;
+    uint16_t reserved;
+    uint32_t key;        // 过滤条件和排序方式
+    uint32_t count;
+    uint32_t names_hash; // 与顺序无关：各文件名哈希之和
+    uint32_t names_size;
+    int64_t mtime;       // 写完缓存之后的目录 mtime
+} cache_hdr_t;
+
+// 目录扫描的中间结果：文件名连续放，off 是各自的偏移
+typedef struct
+{
+    char *buf;
+    size_t len, cap;
+    uint32_t *off;
+    size_t n, ncap;
+    uint32_t hash;
+} name_list_t;
+
+// =====================================================
+// 小工具
+// =====================================================
+static uint32_t fnv1a(const char *s, uint32_t h)
+{
+    while (*s)
+    {
+        h ^= (unsigned char)*s++;
+        h *= 16777619u;
+    }
+    return h;
+}
+
+static inline bool is_digit(unsigned char c)
+{
+    return c >= '0' && c <= '9';
+}
+
+static inline unsigned char lower(unsigned char c)
+{
+    return (c >= 'A' && c <= 'Z') ? (unsigned char)(c + 32) : c;
+}
+
+int media_index_natural_cmp(const char *a, const char *b)
+{
+    const unsigned char *p = (const unsigned char *)a;
+    const unsigned char *q = (const unsigned char *)b;
+    int zeros = 0; // 数值相同、前导零不同："1" 在 "01" 前面
+
+    while (*p && *q)
+    {
+        if (is_digit(*p) && is_digit(*q))
+        {
+            const unsigned char *p0 = p, *q0 = q;
+            while (*p == '0')
+                p++;
+            while (*q == '0')
+                q++;
+            const unsigned char *ps = p, *qs = q;
+            while (is_digit(*p))
+                p++;
+            while (is_digit(*q))
+                q++;
+            size_t lp = (size_t)(p - ps), lq = (size_t)(q - qs);
+            if (lp != lq)
+                return lp < lq ? -1 : 1;
+            int c = memcmp(ps, qs, lp);
+            if (c)
+                return c;
+            if (!zeros && (ps - p0) != (qs - q0))
+                zeros = (ps - p0) < (qs - q0) ? -1 : 1;
+            continue;
+        }
+        unsigned char ca = lower(*p), cb = lower(*q);
+        if (ca != cb)
+            return ca < cb ? -1 : 1;
+        p++;
+        q++;
+    }
+    if (*p || *q)
+        return *p ? 1 : -1;
+    if (zeros)
+        return zeros;
+    return strcmp(a, b); // 只差大小写时也给出确定的顺序
+}
+
+static int natural_qsort_cmp(const void *a, const void *b)
+{
+    return media_index_natural_cmp(*(const char *const *)a, *(const char *const *)b);
+}
+
+static bool ext_ok(const char *name, const char *const *exts)
+{
+    if (!exts)
+        return true;
+    const char *dot = strrchr(name, '.');
+    if (!dot)
+        return false;
+    for (; *exts; exts++)
+    {
+        if (strcasecmp(dot, *exts) == 0)
+            return true;
+    }
+    return false;
+}
+
+static uint32_t config_key(const media_index_config_t *cfg)
+{
+    uint32_t h = 2166136261u;
+    if (cfg->exts)
+    {
+        for (const char *const *e = cfg->exts; *e; e++)
+        {
+            for (const char *s = *e; *s; s++)
+            {
+                h ^= lower((unsigned char)*s);
+                h *= 16777619u;
+            }
+            h ^= '|';
+            h *= 16777619u;
+        }
+    }
+    h ^= cfg->natural_sort ? 'n' : 'd';
+    h *= 16777619u;
+    return h;
+}
+
+static bool dir_mtime(const char *dir, int64_t *out)
+{
+    struct stat st;
+    if (stat(dir, &st) != 0)
+        return false;
+    *out = (int64_t)st.st_mtime;
+    return true;
+}
+
+// =====================================================
+// 扫描：一遍 readdir，按需收集文件名
+// =====================================================
+static bool list_push(name_list_t *l, const char *name)
+{
+    size_t len = strlen(name) + 1;
+    if (l->len + len > l->cap)
+    {
+        size_t cap = l->cap ? l->cap * 2 : 4096;
+        while (cap < l->len + len)
+            cap *= 2;
+        char *p = (char *)MI_REALLOC(l->buf, cap);
+        if (!p)
+            return false;
+        l->buf = p;
+        l->cap = cap;
+    }
+    if (l->n == l->ncap)
+    {
+        size_t ncap = l->ncap ? l->ncap * 2 : 256;
+        uint32_t *p = (uint32_t *)MI_REALLOC(l->off, ncap * sizeof(uint32_t));
+        if (!p)
+            return false;
+        l->off = p;
+        l->ncap = ncap;
+    }
+    memcpy(l->buf + l->len, name, len);
+    l->off[l->n++] = (uint32_t)l->len;
+    l->len += len;
+    return true;
+}
+
+static void list_free(name_list_t *l)
+{
+    MI_FREE(l->buf);
+    MI_FREE(l->off);
+    memset(l, 0, sizeof(*l));
+}
+
+// collect=false 时只数数量、算哈希（校验缓存用），不分配内存
+static bool list_dir(const char *dir, const media_index_config_t *cfg, bool collect, name_list_t *out)
+{
+    DIR *d = opendir(dir);
+    if (!d)
+    {
+        ESP_LOGE(TAG, "opendir(%s) failed", dir);
+        return false;
+    }
+
+    bool ok = true;
+    struct dirent *ent;
+    while ((ent = readdir(d)) != NULL)
+    {
+        const char *name = ent->d_name;
+        if (name[0] == '.')
+            continue;
+#ifdef DT_DIR
+        if (ent->d_type == DT_DIR)
+            continue;
+#endif
+        if (!ext_ok(name, cfg->exts))
+            continue;
+        out->hash += fnv1a(name, 2166136261u);
+        if (!collect)
+        {
+            out->n++;
+        }
+        else if (!list_push(out, name))
+        {
+            ok = false;
+            break;
+        }
+    }
+    closedir(d);
+    return ok;
+}
+
+// =====================================================
+// 建索引：按 names 的顺序拼路径区和哈希表
+// =====================================================
+static media_index_t *index_new(const char *prefix, size_t dir_len)
+{
+    media_index_t *mi = (media_index_t *)calloc(1, sizeof(media_index_t) + dir_len + 1);
+    if (!mi)
+        return NULL;
+    memcpy(mi->prefix, prefix, dir_len + 1);
+    mi->dir_len = dir_len;
+    return mi;
+}
+
+static bool index_build(media_index_t *mi, const char *const *names, size_t n, size_t names_size)
+{
+    size_t arena_size = names_size + n * mi->dir_len;
+    uint32_t slots = 16;
+    while (slots < 2 * n)
+        slots <<= 1;
+
+    mi->arena = (char *)MI_MALLOC(arena_size ? arena_size : 1);
+    mi->off = (uint32_t *)MI_MALLOC((n ? n : 1) * sizeof(uint32_t));
+    mi->slot = (uint32_t *)MI_MALLOC(slots * sizeof(uint32_t));
+    if (!mi->arena || !mi->off || !mi->slot)
+        return false;
+    memset(mi->slot, 0, slots * sizeof(uint32_t));
+    mi->mask = slots - 1;
+
+    size_t pos = 0;
+    for (size_t i = 0; i < n; i++)
+    {
+        size_t len = strlen(names[i]) + 1;
+        mi->off[i] = (uint32_t)pos;
+        memcpy(mi->arena + pos, mi->prefix, mi->dir_len);
+        memcpy(mi->arena + pos + mi->dir_len, names[i], len);
+        pos += mi->dir_len + len;
+
+        uint32_t h = fnv1a(names[i], 2166136261u) & mi->mask;
+        while (mi->slot[h])
+            h = (h + 1) & mi->mask;
+        mi->slot[h] = (uint32_t)(i + 1);
+    }
+    mi->count = n;
+    mi->stats.bytes = sizeof(*mi) + mi->dir_len + 1 + arena_size + n * sizeof(uint32_t) + slots * sizeof(uint32_t);
+    return true;
+}
+
+// =====================================================
+// 缓存文件
+// =====================================================
+static void cache_path(char *buf, size_t len, const media_index_t *mi, uint32_t key, bool tmp)
+{
+    snprintf(buf, len, "%s.midx_%08x%s", mi->prefix, (unsigned)key, tmp ? ".tmp" : "");
+}
+
+static bool cache_load(media_index_t *mi, const char *dir, const media_index_config_t *cfg, uint32_t key)
+{
+    char path[mi->dir_len + CACHE_NAME_MAX];
+    cache_path(path, sizeof(path), mi, key, false);
+    FILE *fp = fopen(path, "rb");
+    if (!fp)
+        return false;
+
+    int64_t t0 = now_us();
+    bool ok = false;
+    char *blob = NULL;
+    const char **names = NULL;
+    cache_hdr_t hdr;
+    int64_t mtime;
+    if (fread(&hdr, sizeof(hdr), 1, fp) != 1 || hdr.magic != CACHE_MAGIC || hdr.version != CACHE_VERSION ||
+        hdr.key != key || !dir_mtime(dir, &mtime))
+        goto out;
+
+    if (mtime != hdr.mtime || !cfg->trust_mtime)
+    {
+        // 列一遍目录，数量和文件名哈希都对上才用
+        int64_t t1 = now_us();
+        name_list_t l = {0};
+        bool listed = list_dir(dir, cfg, false, &l);
+        mi->stats.list_us = (uint32_t)(now_us() - t1);
+        if (!listed || l.n != hdr.count || l.hash != hdr.names_hash)
+            goto out;
+    }
+
+    blob = (char *)MI_MALLOC(hdr.names_size ? hdr.names_size : 1);
+    names = (const char **)malloc((hdr.count ? hdr.count : 1) * sizeof(char *));
+    if (!blob || !names || fread(blob, 1, hdr.names_size, fp) != hdr.names_size)
+        goto out;
+    if (hdr.names_size && blob[hdr.names_size - 1] != '\0')
+        goto out;
+
+    size_t n = 0;
+    for (size_t pos = 0; pos < hdr.names_size && n < hdr.count; n++)
+    {
+        names[n] = blob + pos;
+        pos += strlen(blob + pos) + 1;
+    }
+    if (n != hdr.count)
+        goto out;
+
+    int64_t t2 = now_us();
+    ok = index_build(mi, names, n, hdr.names_size);
+    mi->stats.build_us = (uint32_t)(now_us() - t2);
+    mi->stats.from_cache = ok;
+
+out:
+    fclose(fp);
+    free(names);
+    MI_FREE(blob);
+    mi->stats.cache_us = (uint32_t)(now_us() - t0) - mi->stats.list_us - mi->stats.build_us;
+    return ok;
+}
+
+static void cache_store(media_index_t *mi, const char *dir, uint32_t key, uint32_t names_hash)
+{
+    int64_t t0 = now_us();
+    char tmp[mi->dir_len + CACHE_NAME_MAX];
+    char path[mi->dir_len + CACHE_NAME_MAX];
+    cache_path(tmp, sizeof(tmp), mi, key, true);
+    cache_path(path, sizeof(path), mi, key, false);
+
+    FILE *fp = fopen(tmp, "wb");
+    if (!fp)
+    {
+        ESP_LOGW(TAG, "cache %s not writable", tmp);
+        return;
+    }
+
+    cache_hdr_t hdr = {
+        .magic = CACHE_MAGIC,
+        .version = CACHE_VERSION,
+        .key = key,
+        .count = (uint32_t)mi->count,
+        .names_hash = names_hash,
+    };
+    for (size_t i = 0; i < mi->count; i++)
+        hdr.names_size += (uint32_t)strlen(media_index_name(mi, i)) + 1;
+
+    bool ok = fwrite(&hdr, sizeof(hdr), 1, fp) == 1;
+    for (size_t i = 0; ok && i < mi->count; i++)
+    {
+        const char *name = media_index_name(mi, i);
+        ok = fwrite(name, 1, strlen(name) + 1, fp) == strlen(name) + 1;
+    }
+    ok = (fclose(fp) == 0) && ok;
+
+    // FAT 上 rename 不覆盖已有文件
+    remove(path);
+    if (!ok || rename(tmp, path) != 0)
+    {
+        ESP_LOGW(TAG, "cache %s write failed", path);
+        remove(tmp);
+        return;
+    }
+
+    // 新建缓存文件本身会改目录 mtime，所以写完再记
+    if (dir_mtime(dir, &hdr.mtime) && (fp = fopen(path, "r+b")) != NULL)
+    {
+        fwrite(&hdr, sizeof(hdr), 1, fp);
+        fclose(fp);
+    }
+    mi->stats.cache_us = (uint32_t)(now_us() - t0);
+}
+
+// =====================================================
+// 公共接口
+// =====================================================
+media_index_t *media_index_open(const char *dir, const media_index_config_t *cfg)
+{
+    static const media_index_config_t defaults = {0};
+    if (!dir || !dir[0])
+        return NULL;
+    if (!cfg)
+        cfg = &defaults;
+
+    // 去掉结尾的 '/'，前缀统一成 "dir/"
+    size_t len = strlen(dir);
+    while (len > 1 && dir[len - 1] == '/')
+        len--;
+    char norm[len + 1];
+    memcpy(norm, dir, len);
+    norm[len] = '\0';
+    char prefix[len + 2];
+    snprintf(prefix, sizeof(prefix), "%s%s", norm, (len == 1 && norm[0] == '/') ? "" : "/");
+
+    media_index_t *mi = index_new(prefix, strlen(prefix));
+    if (!mi)
+        return NULL;
+
+    uint32_t key = config_key(cfg);
+    if (cfg->cache && cache_load(mi, norm, cfg, key))
+    {
+        ESP_LOGI(TAG, "%s: %u entries from cache", norm, (unsigned)mi->count);
+        return mi;
+    }
+    MI_FREE(mi->arena);
+    MI_FREE(mi->off);
+    MI_FREE(mi->slot);
+    mi->arena = NULL;
+    mi->off = mi->slot = NULL;
+    memset(&mi->stats, 0, sizeof(mi->stats));
+
+    int64_t t0 = now_us();
+    name_list_t l = {0};
+    const char **names = NULL;
+    if (!list_dir(norm, cfg, true, &l))
+        goto fail;
+    names = (const char **)malloc((l.n ? l.n : 1) * sizeof(char *));
+    if (!names)
+        goto fail;
+    for (size_t i = 0; i < l.n; i++)
+        names[i] = l.buf + l.off[i];
+
+    int64_t t1 = now_us();
+    mi->stats.list_us = (uint32_t)(t1 - t0);
+    if (cfg->natural_sort)
+        qsort(names, l.n, sizeof(names[0]), natural_qsort_cmp);
+    int64_t t2 = now_us();
+    mi->stats.sort_us = (uint32_t)(t2 - t1);
+
+    if (!index_build(mi, names, l.n, l.len))
+        goto fail;
+    mi->stats.build_us = (uint32_t)(now_us() - t2);
+    uint32_t names_hash = l.hash;
+    free(names);
+    list_free(&l);
+
+    if (cfg->cache)
+        cache_store(mi, norm, key, names_hash);
+    ESP_LOGI(TAG, "%s: %u entries", norm, (unsigned)mi->count);
+    return mi;
+
+fail:
+    ESP_LOGE(TAG, "%s: scan failed", norm);
+    free(names);
+    list_free(&l);
+    media_index_close(mi);
+    return NULL;
+}
+
+void media_index_close(media_index_t *mi)
+{
+    if (!mi)
+        return;
+    MI_FREE(mi->arena);
+    MI_FREE(mi->off);
+    MI_FREE(mi->slot);
+    free(mi);
+}
+
+size_t media_index_count(const media_index_t *mi)
+{
+    return mi ? mi->count : 0;
+}
+
+const char *media_index_path(const media_index_t *mi, size_t index)
+{
+    if (!mi || index >= mi->count)
+        return NULL;
+    return mi->arena + mi->off[index];
+}
+
+const char *media_index_name(const media_index_t *mi, size_t index)
+{
+    if (!mi || index >= mi->count)
+        return NULL;
+    return mi->arena + mi->off[index] + mi->dir_len;
+}
+
+size_t media_index_find(const media_index_t *mi, const char *name_or_path)
+{
+    if (!mi || !name_or_path || !mi->count)
+        return MEDIA_INDEX_NONE;
+    const char *name = name_or_path;
+    if (strncmp(name, mi->prefix, mi->dir_len) == 0)
+        name += mi->dir_len;
+
+    uint32_t h = fnv1a(name, 2166136261u) & mi->mask;
+    for (uint32_t i; (i = mi->slot[h]) != 0; h = (h + 1) & mi->mask)
+    {
+        if (strcmp(mi->arena + mi->off[i - 1] + mi->dir_len, name) == 0)
+            return i - 1;
+    }
+    return MEDIA_INDEX_NONE;
+}
+
+void media_index_get_stats(const media_index_t *mi, media_index_stats_t *out)
+{
+    if (mi)
+        *out = mi->stats;
+    else
+        memset(out, 0, sizeof(*out));
+}
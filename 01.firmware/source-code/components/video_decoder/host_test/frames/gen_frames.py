@@ -0,0 +1,60 @@
+#!/usr/bin/env python3
+# Reference frames for yuv2rgb_test (see ../Makefile)
+#
+# <name>.i420    Y plane, then Cb and Cr planes of ceil(w/2) x ceil(h/2)
+# <name>.rgb565  the same picture as RGB565 little endian, converted in floating point
+#                (BT.601 limited range, rounded, clamped, then truncated to 5/6/5 bits)
+#
+# The frames are checked in, run this only to add or change frames.
+
+import os
+import numpy as np
+
+FRAMES = {
+    # name          w   h
+    "ramp_66x38": (66, 38),   # Y ramp across, Cb down, Cr across, reaches every clamp
+    "noise_35x19": (35, 19),  # odd size, random planes
+}
+
+
+def planes(name, w, h):
+    cw, ch = (w + 1) // 2, (h + 1) // 2
+    if name.startswith("ramp"):
+        y = np.tile(np.linspace(0, 255, w).round(), (h, 1))
+        y += np.arange(h)[:, None] % 3  # keep the rows different
+        u = np.tile(np.linspace(0, 255, ch).round()[:, None], (1, cw))
+        v = np.tile(np.linspace(255, 0, cw).round(), (ch, 1))
+    else:
+        rng = np.random.default_rng(0x59555632)
+        y = rng.integers(0, 256, (h, w))
+        u = rng.integers(0, 256, (ch, cw))
+        v = rng.integers(0, 256, (ch, cw))
+    return [np.clip(p, 0, 255).astype(np.uint8) for p in (y, u, v)]
+
+
+def to_rgb565(y, u, v):
+    h, w = y.shape
+    # every 2x2 block shares one chroma sample
+    cu = np.repeat(np.repeat(u.astype(float), 2, 0), 2, 1)[:h, :w] - 128
+    cv = np.repeat(np.repeat(v.astype(float), 2, 0), 2, 1)[:h, :w] - 128
+    yy = 255 / 219 * (y.astype(float) - 16)
+    r = yy + 255 / 224 * 1.402 * cv
+    g = yy - 255 / 224 * (1.772 * 0.114 / 0.587) * cu - 255 / 224 * (1.402 * 0.299 / 0.587) * cv
+    b = yy + 255 / 224 * 1.772 * cu
+    r, g, b = [np.clip(np.round(c), 0, 255).astype(np.uint16) for c in (r, g, b)]
+    return ((r >> 3) << 11) | ((g >> 2) << 5) | (b >> 3)
+
+
+def main():
+    out = os.path.dirname(os.path.abspath(__file__))
+    for name, (w, h) in FRAMES.items():
+        y, u, v = planes(name, w, h)
+        with open(os.path.join(out, name + ".i420"), "wb") as f:
+            for p in (y, u, v):
+                f.write(p.tobytes())
+        to_rgb565(y, u, v).astype("<u2").tofile(os.path.join(out, name + ".rgb565"))
+        print(name, w, h)
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,457 @@
+// yuv2rgb 的主机测试：与 frames/ 下的参考帧（浮点 BT.601，gen_frames.py 生成）对比
+//   1) I420 转换与参考 RGB565 每通道相差不超过 1 LSB
+//   2) NV12 / CbYCrY 输入、融合内核 1:1 输出与 I420 转换逐位一致
+//   3) 缩放 + 黑边：矩形内等于参考帧的最近邻取样（±1 LSB，RGB565 输入逐位相同），矩形外为黑，
+//      stride 之外不写
+// -n N 再跑基准：720x720 屏上常见的几种比例，每种格式输出的百万像素/秒（N 次取最好）
+
+#include "yuv2rgb.h"
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#define GUARD 0x5a5a
+
+static int s_fail = 0;
+
+#define CHECK(cond, ...)                                     \
+    do                                                       \
+    {                                                        \
+        if (!(cond))                                         \
+        {                                                    \
+            printf("FAIL %s:%d: ", __FILE__, __LINE__);      \
+            printf(__VA_ARGS__);                             \
+            printf("\n");                                    \
+            s_fail++;                                        \
+        }                                                    \
+    } while (0)
+
+typedef struct
+{
+    const char *name;
+    int w, h;
+    int cw, ch;      // 色度平面尺寸
+    uint8_t *i420;   // Y，Cb，Cr 三个平面连续
+    uint16_t *ref;   // 参考 RGB565
+    uint8_t *nv12;   // Y + CbCr 交织
+    uint8_t *cbycry; // 每行 w 向上取偶，色度取所在 2x2 块
+    int cbycry_stride;
+} frame_t;
+
+static void *load(const char *dir, const char *name, const char *ext, size_t len)
+{
+    char path[512];
+    snprintf(path, sizeof(path), "%s/%s.%s", dir, name, ext);
+    FILE *f = fopen(path, "rb");
+    if (!f)
+    {
+        printf("cannot open %s\n", path);
+        exit(2);
+    }
+    void *buf = malloc(len);
+    size_t n = fread(buf, 1, len, f);
+    int extra = fgetc(f);
+    fclose(f);
+    if (n != len || extra != EOF)
+    {
+        printf("%s: size is not %zu bytes\n", path, len);
+        exit(2);
+    }
+    return buf;
+}
+
+static void frame_load(frame_t *fr, const char *dir, const char *name, int w, int h)
+{
+    fr->name = name;
+    fr->w = w;
+    fr->h = h;
+    fr->cw = (w + 1) / 2;
+    fr->ch = (h + 1) / 2;
+    fr->i420 = load(dir, name, "i420", (size_t)w * h + 2 * (size_t)fr->cw * fr->ch);
+    fr->ref = load(dir, name, "rgb565", (size_t)w * h * 2);
+
+    const uint8_t *u = fr->i420 + (size_t)w * h;
+    const uint8_t *v = u + (size_t)fr->cw * fr->ch;
+    fr->nv12 = malloc((size_t)w * h + 2 * (size_t)fr->cw * fr->ch);
+    memcpy(fr->nv12, fr->i420, (size_t)w * h);
+    for (int i = 0; i < fr->cw * fr->ch; i++)
+    {
+        fr->nv12[(size_t)w * h + 2 * i] = u[i];
+        fr->nv12[(size_t)w * h + 2 * i + 1] = v[i];
+    }
+
+    fr->cbycry_stride = fr->cw * 4;
+    fr->cbycry = calloc((size_t)fr->cbycry_stride, h);
+    for (int y = 0; y < h; y++)
+    {
+        uint8_t *d = fr->cbycry + (size_t)y * fr->cbycry_stride;
+        for (int x = 0; x < fr->cw * 2; x++)
+        {
+            int c = (y >> 1) * fr->cw + (x >> 1);
+            d[(x >> 1) * 4] = u[c];
+            d[(x >> 1) * 4 + 2] = v[c];
+            d[(x >> 1) * 4 + 1 + (x & 1) * 2] = fr->i420[(size_t)y * w + (x < w ? x : w - 1)];
+        }
+    }
+}
+
+static video_image_t frame_image(const frame_t *fr, video_pix_fmt_t fmt)
+{
+    video_image_t img = {.fmt = fmt, .w = fr->w, .h = fr->h};
+    switch (fmt)
+    {
+    case VIDEO_PIX_I420:
+        img.plane[0] = fr->i420;
+        img.plane[1] = fr->i420 + (size_t)fr->w * fr->h;
+        img.plane[2] = img.plane[1] + (size_t)fr->cw * fr->ch;
+        img.stride[0] = fr->w;
+        img.stride[1] = img.stride[2] = fr->cw;
+        break;
+    case VIDEO_PIX_NV12:
+        img.plane[0] = fr->nv12;
+        img.plane[1] = fr->nv12 + (size_t)fr->w * fr->h;
+        img.stride[0] = fr->w;
+        img.stride[1] = fr->cw * 2;
+        break;
+    case VIDEO_PIX_CBYCRY:
+        img.plane[0] = fr->cbycry;
+        img.stride[0] = fr->cbycry_stride;
+        break;
+    default:
+        img.plane[0] = (const uint8_t *)fr->ref;
+        img.stride[0] = fr->w * 2;
+        break;
+    }
+    return img;
+}
+
+// 两个 565 像素各通道差的最大值
+static int diff565(uint16_t a, uint16_t b)
+{
+    int dr = abs((a >> 11) - (b >> 11));
+    int dg = abs(((a >> 5) & 63) - ((b >> 5) & 63));
+    int db = abs((a & 31) - (b & 31));
+    int d = dr > dg ? dr : dg;
+    return d > db ? d : db;
+}
+
+static void test_convert(const frame_t *fr)
+{
+    const int w = fr->w, h = fr->h;
+    uint16_t *out = calloc((size_t)w * h, 2);
+    uint16_t *alt = calloc((size_t)w * h, 2);
+    const uint8_t *u = fr->i420 + (size_t)w * h;
+    int max_diff = 0, exact = 0;
+
+    i420_to_rgb565(fr->i420, w, u, u + (size_t)fr->cw * fr->ch, fr->cw, w, h, out, w);
+    for (int i = 0; i < w * h; i++)
+    {
+        int d = diff565(out[i], fr->ref[i]);
+        max_diff = d > max_diff ? d : max_diff;
+        exact += (d == 0);
+    }
+    CHECK(max_diff <= 1, "%s: i420 differs from the reference by %d LSB", fr->name, max_diff);
+    printf("%-12s i420 -> rgb565: %5.1f%% exact, max %d LSB\n", fr->name, 100.0 * exact / (w * h), max_diff);
+
+    nv12_to_rgb565(fr->nv12, w, fr->nv12 + (size_t)w * h, fr->cw * 2, w, h, alt, w);
+    CHECK(!memcmp(out, alt, (size_t)w * h * 2), "%s: nv12 differs from i420", fr->name);
+
+    // 融合内核 1:1，全部格式都与 i420_to_rgb565 逐位一致：对齐的目标（两像素一次写）、错开一个像素的目标、
+    // 从奇数列开始（矩形左移一列，走逐像素取样）
+    static const video_pix_fmt_t fmts[] = {VIDEO_PIX_I420, VIDEO_PIX_NV12, VIDEO_PIX_CBYCRY};
+    uint16_t *buf = calloc((size_t)w * h + 1, 2);
+    for (int f = 0; f < 3; f++)
+    {
+        video_image_t img = frame_image(fr, fmts[f]);
+        memset(alt, 0, (size_t)w * h * 2);
+        yuv2rgb_blit_rect(&img, alt, w, h, w, 0, 0, w, h);
+        CHECK(!memcmp(out, alt, (size_t)w * h * 2), "%s: blit_rect fmt %d 1:1 differs", fr->name, fmts[f]);
+
+        memset(buf, 0, ((size_t)w * h + 1) * 2);
+        yuv2rgb_blit_rect(&img, buf + 1, w, h, w, 0, 0, w, h);
+        CHECK(!memcmp(out, buf + 1, (size_t)w * h * 2), "%s: blit_rect fmt %d 1:1 unaligned differs", fr->name,
+              fmts[f]);
+
+        int bad = 0;
+        yuv2rgb_blit_rect(&img, alt, w, h, w, -1, 0, w, h);
+        for (int y = 0; y < h; y++)
+            for (int x = 0; x < w; x++)
+                bad += alt[y * w + x] != (x + 1 < w ? out[y * w + x + 1] : 0);
+        CHECK(bad == 0, "%s: blit_rect fmt %d 1:1 from odd column: %d pixels differ", fr->name, fmts[f], bad);
+    }
+    free(buf);
+    free(out);
+    free(alt);
+}
+
+// 等比缩放进 dst_w x dst_h（stride 多出的像素是保护区），与参考帧的最近邻取样对比
+static void test_fit(const frame_t *fr, int dst_w, int dst_h)
+{
+    const int stride = dst_w + 3;
+    uint16_t *dst = malloc((size_t)stride * dst_h * 2);
+    static const video_pix_fmt_t fmts[] = {VIDEO_PIX_I420, VIDEO_PIX_NV12, VIDEO_PIX_CBYCRY, VIDEO_PIX_RGB565};
+
+    // 期望的矩形：与 yuv2rgb_blit_fit 同样的等比规则
+    int rw = dst_w, rh = dst_h;
+    if ((long)fr->w * dst_h > (long)fr->h * dst_w)
+        rh = (int)((long)fr->h * dst_w / fr->w);
+    else
+        rw = (int)((long)fr->w * dst_h / fr->h);
+    int rx = (dst_w - rw) / 2, ry = (dst_h - rh) / 2;
+    uint32_t xstep = (uint32_t)(((uint64_t)fr->w << 16) / rw);
+    uint32_t ystep = (uint32_t)(((uint64_t)fr->h << 16) / rh);
+
+    for (int f = 0; f < 4; f++)
+    {
+        video_image_t img = frame_image(fr, fmts[f]);
+        for (int i = 0; i < stride * dst_h; i++)
+            dst[i] = GUARD;
+        yuv2rgb_blit_fit(&img, dst, dst_w, dst_h, stride);
+
+        int bad_bar = 0, bad_guard = 0, bad_pos = 0, max_diff = 0;
+        for (int y = 0; y < dst_h; y++)
+        {
+            for (int x = 0; x < stride; x++)
+            {
+                uint16_t px = dst[(size_t)y * stride + x];
+                if (x >= dst_w)
+                {
+                    bad_guard += (px != GUARD);
+                    continue;
+                }
+                if (x < rx || x >= rx + rw || y < ry || y >= ry + rh)
+                {
+                    bad_bar += (px != 0);
+                    continue;
+                }
+                // 像素中心取样，16.16 步长（截断）与内核约定一致；与精确位置 floor((x - rx + 0.5) * w / rw)
+                // 最多差一个源像素（恰好落在边界上时取左/上）
+                int sx = (int)(((uint64_t)(x - rx) * xstep + xstep / 2) >> 16);
+                int sy = (int)(((uint64_t)(y - ry) * ystep + ystep / 2) >> 16);
+                int ex = (int)(((long)(x - rx) * 2 + 1) * fr->w / (2L * rw));
+                int ey = (int)(((long)(y - ry) * 2 + 1) * fr->h / (2L * rh));
+                bad_pos += (sx != ex && sx != ex - 1) || (sy != ey && sy != ey - 1);
+                int d = diff565(px, fr->ref[(size_t)sy * fr->w + sx]);
+                max_diff = d > max_diff ? d : max_diff;
+            }
+        }
+        CHECK(bad_bar == 0, "%s -> %dx%d fmt %d: %d bar pixels not black", fr->name, dst_w, dst_h, fmts[f], bad_bar);
+        CHECK(bad_guard == 0, "%s -> %dx%d fmt %d: %d pixels written past dst_w", fr->name, dst_w, dst_h, fmts[f],
+              bad_guard);
+        CHECK(bad_pos == 0, "%s -> %dx%d: sampling more than one source pixel off", fr->name, dst_w, dst_h);
+        CHECK(max_diff <= (fmts[f] == VIDEO_PIX_RGB565 ? 0 : 1), "%s -> %dx%d fmt %d: %d LSB off the reference",
+              fr->name, dst_w, dst_h, fmts[f], max_diff);
+    }
+    free(dst);
+}
+
+// 向量版与查表版逐位一致：随机数据，各种格式、比例、矩形位置（含负偏移、奇数列、超出 dst）
+static void test_vec(void)
+{
+    static const video_pix_fmt_t fmts[] = {VIDEO_PIX_I420, VIDEO_PIX_NV12, VIDEO_PIX_CBYCRY};
+    static const int srcs[][2] = {{64, 36}, {37, 21}, {320, 180}, {2, 2}};
+    static const int rects[][4] = {
+        {0, 0, 64, 36}, {1, 0, 64, 36}, {-3, -1, 64, 36}, {0, 0, 97, 61}, {5, 2, 40, 23},
+        {0, 0, 300, 170}, {-17, 4, 211, 118}, {3, 3, 1, 1}, {0, 0, 23, 77},
+    };
+    const int dst_w = 240, dst_h = 140;
+    uint8_t *planes = malloc((size_t)320 * 180 * 2);
+    uint16_t *a = malloc((size_t)dst_w * dst_h * 2);
+    uint16_t *b = malloc((size_t)dst_w * dst_h * 2);
+    uint32_t seed = 7;
+    for (int i = 0; i < 320 * 180 * 2; i++)
+    {
+        seed = seed * 1103515245 + 12345;
+        planes[i] = (uint8_t)(seed >> 16);
+    }
+
+    int cases = 0, bad = 0;
+    for (size_t s = 0; s < sizeof(srcs) / sizeof(srcs[0]); s++)
+    {
+        const int w = srcs[s][0], h = srcs[s][1];
+        for (size_t f = 0; f < sizeof(fmts) / sizeof(fmts[0]); f++)
+        {
+            video_image_t img = {.fmt = fmts[f], .w = w, .h = h, .plane = {planes}};
+            if (fmts[f] == VIDEO_PIX_I420)
+            {
+                img.plane[1] = planes + (size_t)w * h;
+                img.plane[2] = img.plane[1] + (size_t)((w + 1) / 2) * ((h + 1) / 2);
+                img.stride[0] = w;
+                img.stride[1] = img.stride[2] = (w + 1) / 2;
+            }
+            else if (fmts[f] == VIDEO_PIX_NV12)
+            {
+                img.plane[1] = planes + (size_t)w * h;
+                img.stride[0] = w;
+                img.stride[1] = (w + 1) & ~1;
+            }
+            else
+                img.stride[0] = ((w + 1) & ~1) * 2;
+
+            for (size_t r = 0; r < sizeof(rects) / sizeof(rects[0]); r++)
+            {
+                // 每种情况再错开 1 个像素的目标地址，覆盖非 4 字节对齐的写
+                for (int ofs = 0; ofs < 2; ofs++)
+                {
+                    yuv2rgb_blit_rect_c(&img, a + ofs, dst_w - ofs, dst_h, dst_w, rects[r][0], rects[r][1],
+                                        rects[r][2], rects[r][3]);
+                    yuv2rgb_blit_rect_vec(&img, b + ofs, dst_w - ofs, dst_h, dst_w, rects[r][0], rects[r][1],
+                                          rects[r][2], rects[r][3]);
+                    int diff = 0;
+                    for (int y = 0; y < dst_h; y++)
+                        diff += memcmp(a + ofs + (size_t)y * dst_w, b + ofs + (size_t)y * dst_w,
+                                       (size_t)(dst_w - ofs) * 2) != 0;
+                    CHECK(diff == 0, "vec %dx%d fmt %d rect (%d,%d %dx%d)+%d: %d rows differ from scalar", w, h,
+                          fmts[f], rects[r][0], rects[r][1], rects[r][2], rects[r][3], ofs, diff);
+                    bad += diff != 0;
+                    cases++;
+                }
+            }
+        }
+    }
+    printf("vec vs scalar: %d/%d cases bit-exact\n", cases - bad, cases);
+    free(planes);
+    free(a);
+    free(b);
+}
+
+static double now_s(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static void bench(int loops)
+{
+    static const struct
+    {
+        const char *name;
+        int src_w, src_h, dst_w, dst_h;
+    } cases[] = {
+        {"1:1 720x720", 720, 720, 720, 720},
+        {"720p -> 720x720", 1280, 720, 720, 720}, // 缩小 1.78 倍 + 黑边
+        {"480p -> 720x720", 640, 480, 720, 720},  // 放大 1.125 倍 + 黑边
+        {"720p -> 160x90", 1280, 720, 160, 90},   // 海报缩略图
+    };
+    static const struct
+    {
+        video_pix_fmt_t fmt;
+        const char *name;
+    } fmts[] = {
+        {VIDEO_PIX_I420, "i420"},
+        {VIDEO_PIX_NV12, "nv12"},
+        {VIDEO_PIX_CBYCRY, "cbycry"},
+        {VIDEO_PIX_RGB565, "rgb565"},
+    };
+    const int max_w = 1280, max_h = 720;
+    uint8_t *planes = malloc((size_t)max_w * max_h * 2);
+    uint16_t *dst = malloc((size_t)720 * 720 * 2);
+    uint32_t seed = 1;
+    for (int i = 0; i < max_w * max_h * 2; i++)
+    {
+        seed = seed * 1103515245 + 12345;
+        planes[i] = (uint8_t)(seed >> 16);
+    }
+
+    printf("\n%-18s %-7s %9s %9s\n", "case", "format", "MPix/s c", "vec");
+    for (size_t c = 0; c < sizeof(cases) / sizeof(cases[0]); c++)
+    {
+        for (size_t f = 0; f < sizeof(fmts) / sizeof(fmts[0]); f++)
+        {
+            const int w = cases[c].src_w, h = cases[c].src_h;
+            video_image_t img = {.fmt = fmts[f].fmt, .w = w, .h = h, .plane = {planes}};
+            switch (fmts[f].fmt)
+            {
+            case VIDEO_PIX_I420:
+                img.plane[1] = planes + (size_t)w * h;
+                img.plane[2] = img.plane[1] + (size_t)(w / 2) * (h / 2);
+                img.stride[0] = w;
+                img.stride[1] = img.stride[2] = w / 2;
+                break;
+            case VIDEO_PIX_NV12:
+                img.plane[1] = planes + (size_t)w * h;
+                img.stride[0] = img.stride[1] = w;
+                break;
+            default:
+                img.stride[0] = w * 2;
+                break;
+            }
+
+            // 与 yuv2rgb_blit_fit 同样的等比矩形，分别跑两种实现
+            const int dw = cases[c].dst_w, dh = cases[c].dst_h;
+            int rw = dw, rh = dh;
+            if ((long)w * dh > (long)h * dw)
+                rh = (int)((long)h * dw / w);
+            else
+                rw = (int)((long)w * dh / h);
+            double mpix[2];
+            for (int impl = 0; impl < 2; impl++)
+            {
+                double best = 0;
+                for (int n = 0; n < loops; n++)
+                {
+                    double t0 = now_s();
+                    (impl ? yuv2rgb_blit_rect_vec : yuv2rgb_blit_rect_c)(&img, dst, dw, dh, dw, (dw - rw) / 2,
+                                                                         (dh - rh) / 2, rw, rh);
+                    double t = now_s() - t0;
+                    best = (n == 0 || t < best) ? t : best;
+                }
+                mpix[impl] = best > 0 ? dw * dh / best / 1e6 : 0;
+            }
+            printf("%-18s %-7s %9.1f %9.1f\n", cases[c].name, fmts[f].name, mpix[0], mpix[1]);
+        }
+    }
+    free(planes);
+    free(dst);
+}
+
+int main(int argc, char **argv)
+{
+    int loops = 0, opt;
+    while ((opt = getopt(argc, argv, "n:")) != -1)
+    {
+        if (opt == 'n')
+            loops = atoi(optarg);
+        else
+        {
+            printf("usage: yuv2rgb_test [-n loops] [frames_dir]\n");
+            return 2;
+        }
+    }
+    const char *dir = optind < argc ? argv[optind] : "frames";
+    static const struct
+    {
+        const char *name;
+        int w, h;
+    } frames[] = {
+        {"ramp_66x38", 66, 38},
+        {"noise_35x19", 35, 19},
+    };
+    static const int sizes[][2] = {
+        {66, 38}, {132, 76}, {200, 60}, {50, 29}, {40, 90}, {31, 17}, {7, 5}, {480, 272},
+    };
+
+    for (size_t i = 0; i < sizeof(frames) / sizeof(frames[0]); i++)
+    {
+        frame_t fr;
+        frame_load(&fr, dir, frames[i].name, frames[i].w, frames[i].h);
+        test_convert(&fr);
+        for (size_t s = 0; s < sizeof(sizes) / sizeof(sizes[0]); s++)
+            test_fit(&fr, sizes[s][0], sizes[s][1]);
+        free(fr.i420);
+        free(fr.ref);
+        free(fr.nv12);
+        free(fr.cbycry);
+    }
+    test_vec();
+
+    printf("%s\n", s_fail ? "FAILED" : "all passed");
+    if (!s_fail && loops > 0)
+        bench(loops);
+    return s_fail ? 1 : 0;
+}
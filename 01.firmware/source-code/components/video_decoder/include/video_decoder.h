@@ -0,0 +1,61 @@
+#pragma once
+#include "lvgl.h"
+#include "avi_player.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef enum
+{
+    VIDEO_DEC_FRAME = 0, // 有新画面，可调用 video_decoder_output
+    VIDEO_DEC_PENDING,   // 数据已吃下但还没出图（H.264 参数集 / 解码延迟）
+    VIDEO_DEC_ERROR,
+} video_dec_status_t;
+
+typedef struct video_decoder video_decoder_t;
+
+// 解码后端：MJPEG（esp_new_jpeg）/ H.264 baseline（esp_h264 软解，可选，默认不编译）
+typedef struct
+{
+    const char *name;
+    bool (*open)(video_decoder_t *dec);
+    // 送入一帧压缩数据；返回 VIDEO_DEC_FRAME 时 src_w/src_h 有效
+    video_dec_status_t (*feed)(video_decoder_t *dec, const uint8_t *data, size_t len);
+    // 输出当前画面到 dst（dst_w*dst_h RGB565）：等比缩放，黑边居中
+    bool (*output)(video_decoder_t *dec, lv_color_t *dst, int dst_w, int dst_h);
+    void (*close)(video_decoder_t *dec);
+} video_decoder_ops_t;
+
+struct video_decoder
+{
+    const video_decoder_ops_t *ops;
+    video_frame_format format;
+    int src_w, src_h; // 最近一帧的原始分辨率
+    void *priv;
+};
+
+extern const video_decoder_ops_t video_decoder_mjpeg_ops;
+extern const video_decoder_ops_t video_decoder_h264_ops; // 仅在 CONFIG_VIDEO_DECODER_H264 时存在
+
+/**
+ * 按 AVI 的视频格式创建解码器；hint_w/hint_h 为容器头里的分辨率（H.264 输出尺寸以它为准）
+ * 不支持的格式返回 NULL（H.264 默认不编译，见 Kconfig 的 VIDEO_DECODER_H264）
+ */
+video_decoder_t *video_decoder_create(video_frame_format format, int hint_w, int hint_h);
+
+static inline video_dec_status_t video_decoder_feed(video_decoder_t *dec, const uint8_t *data, size_t len)
+{
+    return dec->ops->feed(dec, data, len);
+}
+
+static inline bool video_decoder_output(video_decoder_t *dec, lv_color_t *dst, int dst_w, int dst_h)
+{
+    return dec->ops->output(dec, dst, dst_w, dst_h);
+}
+
+void video_decoder_destroy(video_decoder_t *dec);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,71 @@
+#pragma once
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// YUV 4:2:0 → RGB565（BT.601 limited range，小端，与 JPEG_PIXEL_FORMAT_RGB565_LE 一致）
+// 不依赖 IDF / LVGL，可直接在 Linux 主机上编译测试
+
+/**
+ * 通用 4:2:0：u/v 为色度平面首地址，uv_step 为相邻色度样本间距
+ *   I420：u/v 各自独立平面，uv_step = 1
+ *   NV12：u = uv，v = uv + 1，uv_step = 2
+ * w/h 为输出像素数；奇数宽高最后一列/行复用上一组色度
+ * 所有 stride 以字节为单位（dst_stride 以像素为单位）
+ */
+void yuv420_to_rgb565(const uint8_t *y, int y_stride,
+                      const uint8_t *u, const uint8_t *v, int uv_stride, int uv_step,
+                      int w, int h, uint16_t *dst, int dst_stride);
+
+static inline void nv12_to_rgb565(const uint8_t *y, int y_stride, const uint8_t *uv, int uv_stride,
+                                  int w, int h, uint16_t *dst, int dst_stride)
+{
+    yuv420_to_rgb565(y, y_stride, uv, uv + 1, uv_stride, 2, w, h, dst, dst_stride);
+}
+
+static inline void i420_to_rgb565(const uint8_t *y, int y_stride, const uint8_t *u, const uint8_t *v,
+                                  int uv_stride, int w, int h, uint16_t *dst, int dst_stride)
+{
+    yuv420_to_rgb565(y, y_stride, u, v, uv_stride, 1, w, h, dst, dst_stride);
+}
+
+// =====================================================
+// 融合内核：格式转换 + 任意比例缩放（最近邻，16.16 定点）+ 黑边，一次写完目标
+// =====================================================
+typedef enum
+{
+    VIDEO_PIX_RGB565 = 0, // plane[0]
+    VIDEO_PIX_CBYCRY,     // plane[0]，每 4 字节 Cb Y0 Cr Y1（UYVY）
+    VIDEO_PIX_NV12,       // plane[0] = Y，plane[1] = CbCr 交织
+    VIDEO_PIX_I420,       // plane[0] = Y，plane[1] = Cb，plane[2] = Cr
+} video_pix_fmt_t;
+
+typedef struct
+{
+    video_pix_fmt_t fmt;
+    int w, h;
+    const uint8_t *plane[3];
+    int stride[3]; // 字节
+} video_image_t;
+
+/**
+ * 把 src 缩放到 dst 内的矩形 (rx, ry, rw, rh)，矩形外填黑；dst 每个像素只写一次
+ * 矩形可以超出 dst（超出部分裁掉）；dst_stride 以像素为单位
+ */
+void yuv2rgb_blit_rect(const video_image_t *src, uint16_t *dst, int dst_w, int dst_h, int dst_stride,
+                       int rx, int ry, int rw, int rh);
+
+// 等比缩放进 dst，黑边居中
+void yuv2rgb_blit_fit(const video_image_t *src, uint16_t *dst, int dst_w, int dst_h, int dst_stride);
+
+// 两种实现，结果逐位一致，供测试/基准对比；yuv2rgb_blit_rect 默认用 _c，定义 YUV2RGB_VECTOR 时用 _vec
+void yuv2rgb_blit_rect_c(const video_image_t *src, uint16_t *dst, int dst_w, int dst_h, int dst_stride,
+                         int rx, int ry, int rw, int rh);
+void yuv2rgb_blit_rect_vec(const video_image_t *src, uint16_t *dst, int dst_w, int dst_h, int dst_stride,
+                           int rx, int ry, int rw, int rh);
+
+#ifdef __cplusplus
+}
+#endif
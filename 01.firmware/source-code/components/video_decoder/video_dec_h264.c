@@ -0,0 +1,115 @@
+// video_dec_h264.c — H.264 baseline 后端（esp_h264 软解，输出 I420）
+// 可选后端，默认不编译（CONFIG_VIDEO_DECODER_H264），固件本身不依赖 esp_h264
+// 软解只出 I420，没有 NV12；还没有和参考解码器逐帧对比的测试，只有 yuv2rgb 在 host_test 里测过
+// 不依赖硬件编解码器，P4 / S3 通用；颜色转换见 yuv2rgb.c
+// AVI 里的 H.264 为 Annex-B 码流，一个 00dc 块通常就是一个访问单元
+
+#include "video_decoder.h"
+#include "yuv2rgb.h"
+#include "esp_h264_dec_sw.h"
+
+#include "esp_log.h"
+
+#include <stdlib.h>
+
+static const char *TAG = "video_h264";
+
+typedef struct
+{
+    esp_h264_dec_handle_t dec;
+    const uint8_t *frame; // 最近一帧 I420（解码器内部缓冲，下次 process 前有效）
+} h264_priv_t;
+
+static bool h264_open(video_decoder_t *dec)
+{
+    h264_priv_t *p = (h264_priv_t *)calloc(1, sizeof(h264_priv_t));
+    if (!p)
+        return false;
+
+    esp_h264_dec_cfg_sw_t cfg = {.pic_type = ESP_H264_RAW_FMT_I420};
+    if (esp_h264_dec_sw_new(&cfg, &p->dec) != ESP_H264_ERR_OK)
+    {
+        free(p);
+        return false;
+    }
+    if (esp_h264_dec_open(p->dec) != ESP_H264_ERR_OK)
+    {
+        esp_h264_dec_del(p->dec);
+        free(p);
+        return false;
+    }
+    dec->priv = p;
+    return true;
+}
+
+static video_dec_status_t h264_feed(video_decoder_t *dec, const uint8_t *data, size_t len)
+{
+    h264_priv_t *p = (h264_priv_t *)dec->priv;
+    esp_h264_dec_in_frame_t in = {
+        .raw_data.buffer = (uint8_t *)data,
+        .raw_data.len = (uint32_t)len,
+    };
+    esp_h264_dec_out_frame_t out = {0};
+    video_dec_status_t st = VIDEO_DEC_PENDING;
+
+    // 解码器每次吃掉一个 NAL，SPS/PPS/SEI 不出图；取最后一个出图的结果
+    while (in.raw_data.len > 0)
+    {
+        if (esp_h264_dec_process(p->dec, &in, &out) != ESP_H264_ERR_OK)
+            return VIDEO_DEC_ERROR;
+        if (out.out_size > 0)
+        {
+            // 软解不提供尺寸查询：用容器头里的分辨率，并用输出大小核对
+            if (out.out_size != (uint32_t)dec->src_w * dec->src_h * 3 / 2)
+            {
+                ESP_LOGE(TAG, "frame size %u does not match %dx%d", (unsigned)out.out_size, dec->src_w, dec->src_h);
+                return VIDEO_DEC_ERROR;
+            }
+            p->frame = out.outbuf;
+            st = VIDEO_DEC_FRAME;
+        }
+        if (in.consume == 0)
+            break;
+        in.raw_data.buffer += in.consume;
+        in.raw_data.len -= in.consume;
+    }
+    return st;
+}
+
+static bool h264_output(video_decoder_t *dec, lv_color_t *dst, int dst_w, int dst_h)
+{
+    h264_priv_t *p = (h264_priv_t *)dec->priv;
+    if (!p->frame)
+        return false;
+
+    // 转换 + 等比缩放 + 黑边一次完成，不经过中间 RGB 缓冲
+    int w = dec->src_w, h = dec->src_h;
+    video_image_t img = {
+        .fmt = VIDEO_PIX_I420,
+        .w = w,
+        .h = h,
+        .plane = {p->frame, p->frame + (size_t)w * h, p->frame + (size_t)w * h + (size_t)(w / 2) * (h / 2)},
+        .stride = {w, w / 2, w / 2},
+    };
+    yuv2rgb_blit_fit(&img, (uint16_t *)dst, dst_w, dst_h, dst_w);
+    return true;
+}
+
+static void h264_close(video_decoder_t *dec)
+{
+    h264_priv_t *p = (h264_priv_t *)dec->priv;
+    if (!p)
+        return;
+    esp_h264_dec_close(p->dec);
+    esp_h264_dec_del(p->dec);
+    free(p);
+    dec->priv = NULL;
+}
+
+const video_decoder_ops_t video_decoder_h264_ops = {
+    .name = "h264",
+    .open = h264_open,
+    .feed = h264_feed,
+    .output = h264_output,
+    .close = h264_close,
+};
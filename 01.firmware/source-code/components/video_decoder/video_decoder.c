@@ -0,0 +1,232 @@
+// video_decoder.c — 视频解码抽象 + MJPEG 后端（esp_new_jpeg）
+// H.264 后端见 video_dec_h264.c（默认不编译，打开 CONFIG_VIDEO_DECODER_H264 并带上 esp_h264 组件才有）
+
+#include "video_decoder.h"
+#include "sdkconfig.h"
+#include "esp_jpeg_dec.h"
+#include "yuv2rgb.h"
+
+#include "esp_log.h"
+
+#include <string.h>
+#include <stdlib.h>
+
+static const char *TAG = "video_dec";
+
+// =====================================================
+// 公共部分
+// =====================================================
+video_decoder_t *video_decoder_create(video_frame_format format, int hint_w, int hint_h)
+{
+    const video_decoder_ops_t *ops = NULL;
+    switch (format)
+    {
+    case FORMAT_MJEPG:
+        ops = &video_decoder_mjpeg_ops;
+        break;
+#if CONFIG_VIDEO_DECODER_H264
+    case FORMAT_H264:
+        ops = &video_decoder_h264_ops;
+        break;
+#else
+    case FORMAT_H264:
+        ESP_LOGE(TAG, "h264 is not built in (CONFIG_VIDEO_DECODER_H264)");
+        return NULL;
+#endif
+    default:
+        ESP_LOGE(TAG, "unsupported video format %d", format);
+        return NULL;
+    }
+
+    video_decoder_t *dec = (video_decoder_t *)calloc(1, sizeof(video_decoder_t));
+    if (!dec)
+        return NULL;
+    dec->ops = ops;
+    dec->format = format;
+    dec->src_w = hint_w;
+    dec->src_h = hint_h;
+    if (!ops->open(dec))
+    {
+        ESP_LOGE(TAG, "%s open failed", ops->name);
+        free(dec);
+        return NULL;
+    }
+    return dec;
+}
+
+void video_decoder_destroy(video_decoder_t *dec)
+{
+    if (!dec)
+        return;
+    dec->ops->close(dec);
+    free(dec);
+}
+
+// =====================================================
+// MJPEG：解码器按需要的缩放尺寸（8 的倍数）重新打开
+// =====================================================
+typedef struct
+{
+    jpeg_dec_handle_t jpeg;
+    int scale_w, scale_h; // 当前解码器的缩放配置（0 = 不缩放）
+    jpeg_dec_io_t io;
+    const uint8_t *data;  // 当前帧（仅在 feed/output 之间有效）
+    size_t len;
+    uint8_t *decode_buf;  // 尺寸不一致时的临时解码缓冲
+    int decode_cap;
+} mjpeg_priv_t;
+
+static bool mjpeg_config(mjpeg_priv_t *p, int scale_w, int scale_h)
+{
+    if (p->jpeg && p->scale_w == scale_w && p->scale_h == scale_h)
+        return true;
+
+    if (p->jpeg)
+    {
+        jpeg_dec_close(p->jpeg);
+        p->jpeg = NULL;
+    }
+    jpeg_dec_config_t cfg = DEFAULT_JPEG_DEC_CONFIG();
+    cfg.output_type = JPEG_PIXEL_FORMAT_RGB565_LE;
+    cfg.scale.width = scale_w;
+    cfg.scale.height = scale_h;
+    if (jpeg_dec_open(&cfg, &p->jpeg) != JPEG_ERR_OK)
+    {
+        p->jpeg = NULL;
+        return false;
+    }
+    p->scale_w = scale_w;
+    p->scale_h = scale_h;
+    return true;
+}
+
+// 保持比例缩进目标尺寸，宽高向下取 8 的倍数；不需要缩小时返回 0
+static void fit_scale(int img_w, int img_h, int surf_w, int surf_h, int *out_w, int *out_h)
+{
+    *out_w = 0;
+    *out_h = 0;
+    if (img_w <= surf_w && img_h <= surf_h)
+        return;
+
+    int w = surf_w, h = (int)((int64_t)img_h * surf_w / img_w);
+    if (h > surf_h)
+    {
+        h = surf_h;
+        w = (int)((int64_t)img_w * surf_h / img_h);
+    }
+    w &= ~7;
+    h &= ~7;
+    if (w >= 8 && h >= 8)
+    {
+        *out_w = w;
+        *out_h = h;
+    }
+}
+
+static bool mjpeg_open(video_decoder_t *dec)
+{
+    mjpeg_priv_t *p = (mjpeg_priv_t *)calloc(1, sizeof(mjpeg_priv_t));
+    if (!p)
+        return false;
+    if (!mjpeg_config(p, 0, 0))
+    {
+        free(p);
+        return false;
+    }
+    dec->priv = p;
+    return true;
+}
+
+static video_dec_status_t mjpeg_feed(video_decoder_t *dec, const uint8_t *data, size_t len)
+{
+    mjpeg_priv_t *p = (mjpeg_priv_t *)dec->priv;
+    jpeg_dec_header_info_t hi;
+
+    p->data = data;
+    p->len = len;
+    p->io = (jpeg_dec_io_t){.inbuf = (uint8_t *)data, .inbuf_len = (int)len};
+    if (jpeg_dec_parse_header(p->jpeg, &p->io, &hi) != JPEG_ERR_OK)
+        return VIDEO_DEC_ERROR;
+    dec->src_w = hi.width;
+    dec->src_h = hi.height;
+    return VIDEO_DEC_FRAME;
+}
+
+static bool mjpeg_output(video_decoder_t *dec, lv_color_t *dst, int dst_w, int dst_h)
+{
+    mjpeg_priv_t *p = (mjpeg_priv_t *)dec->priv;
+
+    int sw, sh;
+    fit_scale(dec->src_w, dec->src_h, dst_w, dst_h, &sw, &sh);
+    if (sw != p->scale_w || sh != p->scale_h)
+    {
+        // 缩放只能在 open 时配置：换配置后重新解析本帧头
+        jpeg_dec_header_info_t hi;
+        if (!mjpeg_config(p, sw, sh))
+            return false;
+        p->io = (jpeg_dec_io_t){.inbuf = (uint8_t *)p->data, .inbuf_len = (int)p->len};
+        if (jpeg_dec_parse_header(p->jpeg, &p->io, &hi) != JPEG_ERR_OK)
+            return false;
+        ESP_LOGI(TAG, "mjpeg %dx%d -> %dx%d (scale %dx%d)", dec->src_w, dec->src_h, dst_w, dst_h, sw, sh);
+    }
+
+    int out_len = 0;
+    if (jpeg_dec_get_outbuf_len(p->jpeg, &out_len) != JPEG_ERR_OK || out_len <= 0)
+        return false;
+
+    // 零拷贝：直接解到目标
+    if (out_len == dst_w * dst_h * (int)sizeof(lv_color_t))
+    {
+        p->io.outbuf = (uint8_t *)dst;
+        return jpeg_dec_process(p->jpeg, &p->io) == JPEG_ERR_OK;
+    }
+
+    // 尺寸不一致：解到临时缓冲，再一次性缩放到精确等比尺寸并填黑边
+    if (out_len > p->decode_cap)
+    {
+        if (p->decode_buf)
+            jpeg_free_align(p->decode_buf);
+        p->decode_buf = (uint8_t *)jpeg_calloc_align((size_t)out_len, 16);
+        if (!p->decode_buf)
+        {
+            p->decode_cap = 0;
+            ESP_LOGE(TAG, "no mem decode_buf %d", out_len);
+            return false;
+        }
+        p->decode_cap = out_len;
+    }
+    p->io.outbuf = p->decode_buf;
+    if (jpeg_dec_process(p->jpeg, &p->io) != JPEG_ERR_OK)
+        return false;
+
+    video_image_t img = {
+        .fmt = VIDEO_PIX_RGB565,
+        .w = p->scale_w ? p->scale_w : dec->src_w,
+        .h = p->scale_h ? p->scale_h : dec->src_h,
+        .plane = {p->decode_buf},
+    };
+    img.stride[0] = img.w * 2;
+    yuv2rgb_blit_fit(&img, (uint16_t *)dst, dst_w, dst_h, dst_w);
+    return true;
+}
+
+static void mjpeg_close(video_decoder_t *dec)
+{
+    mjpeg_priv_t *p = (mjpeg_priv_t *)dec->priv;
+    if (!p)
+        return;
+    if (p->jpeg)
+        jpeg_dec_close(p->jpeg);
+    if (p->decode_buf)
+        jpeg_free_align(p->decode_buf);
+    free(p);
+    dec->priv = NULL;
+}
+
+const video_decoder_ops_t video_decoder_mjpeg_ops = {
+    .name = "mjpeg",
+    .open = mjpeg_open,
+    .feed = mjpeg_feed,
+    .output = mjpeg_output,
+    .close = mjpeg_close,
+};
@@ -0,0 +1,423 @@
+// yuv2rgb.c — YUV 4:2:0（I420 / NV12）→ RGB565，以及转换+缩放+黑边融合内核
+// 针对 ESP32-P4（RV32，无浮点/无饱和指令依赖）：
+//   1) 定点系数，2x2 像素共用一次色度计算
+//   2) 饱和 + 565 打包合并成查表（R/G/B 各一张，已移位到位，OR 即得像素）
+//   3) 两行同时处理，目标行 4 字节对齐时两像素合成一次 32 位写
+// 融合内核按格式生成专用行函数（常量步长）：1:1 时两像素共用色度、一次 32 位写，步长 < 1.5 时色度换组才重算
+// 另有 GCC 通用向量版（_vec，与查表版逐位一致），默认不用：GCC 不会把通用向量映射到 P4 的 PIE 指令，
+// RV32 上逐元素模拟比查表慢，主机上（SSE2 / AVX2）也没快过查表，见 host_test 的 bench；定义 YUV2RGB_VECTOR 才切过去
+
+#include "yuv2rgb.h"
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+// (298*(Y-16) + 系数*色度 + 128) >> 8 的取值范围约 [-278, 535]
+#define CLIP_OFS 384
+#define CLIP_LEN 1024
+
+static uint16_t s_r565[CLIP_LEN];
+static uint16_t s_g565[CLIP_LEN];
+static uint16_t s_b565[CLIP_LEN];
+static int32_t s_yy[256];
+static volatile bool s_tables_ready = false;
+
+// 多线程同时初始化写入的是相同内容，无需加锁
+static void tables_init(void)
+{
+    for (int i = 0; i < CLIP_LEN; i++)
+    {
+        int c = i - CLIP_OFS;
+        c = c < 0 ? 0 : (c > 255 ? 255 : c);
+        s_r565[i] = (uint16_t)((c >> 3) << 11);
+        s_g565[i] = (uint16_t)((c >> 2) << 5);
+        s_b565[i] = (uint16_t)(c >> 3);
+    }
+    for (int i = 0; i < 256; i++)
+        s_yy[i] = 298 * (i - 16) + 128;
+    s_tables_ready = true;
+}
+
+static inline uint16_t pixel(int32_t yy, int32_t rv, int32_t guv, int32_t bu)
+{
+    return s_r565[((yy + rv) >> 8) + CLIP_OFS] |
+           s_g565[((yy + guv) >> 8) + CLIP_OFS] |
+           s_b565[((yy + bu) >> 8) + CLIP_OFS];
+}
+
+void yuv420_to_rgb565(const uint8_t *y, int y_stride,
+                      const uint8_t *u, const uint8_t *v, int uv_stride, int uv_step,
+                      int w, int h, uint16_t *dst, int dst_stride)
+{
+    if (!s_tables_ready)
+        tables_init();
+
+    for (int row = 0; row < h; row += 2)
+    {
+        const uint8_t *y0 = y + (size_t)row * y_stride;
+        const uint8_t *y1 = (row + 1 < h) ? y0 + y_stride : NULL;
+        const uint8_t *pu = u + (size_t)(row >> 1) * uv_stride;
+        const uint8_t *pv = v + (size_t)(row >> 1) * uv_stride;
+        uint16_t *d0 = dst + (size_t)row * dst_stride;
+        uint16_t *d1 = d0 + dst_stride;
+        bool wide = (((uintptr_t)d0 | (uintptr_t)(y1 ? d1 : d0)) & 3) == 0;
+
+        int x = 0;
+        for (; x + 1 < w; x += 2, pu += uv_step, pv += uv_step)
+        {
+            int32_t cu = *pu - 128, cv = *pv - 128;
+            int32_t rv = 409 * cv, guv = -100 * cu - 208 * cv, bu = 516 * cu;
+
+            uint16_t a = pixel(s_yy[y0[x]], rv, guv, bu);
+            uint16_t b = pixel(s_yy[y0[x + 1]], rv, guv, bu);
+            if (wide)
+                *(uint32_t *)(d0 + x) = (uint32_t)a | ((uint32_t)b << 16);
+            else
+            {
+                d0[x] = a;
+                d0[x + 1] = b;
+            }
+
+            if (!y1)
+                continue;
+            a = pixel(s_yy[y1[x]], rv, guv, bu);
+            b = pixel(s_yy[y1[x + 1]], rv, guv, bu);
+            if (wide)
+                *(uint32_t *)(d1 + x) = (uint32_t)a | ((uint32_t)b << 16);
+            else
+            {
+                d1[x] = a;
+                d1[x + 1] = b;
+            }
+        }
+
+        // 奇数宽：最后一列
+        if (x < w)
+        {
+            int32_t cu = *pu - 128, cv = *pv - 128;
+            int32_t rv = 409 * cv, guv = -100 * cu - 208 * cv, bu = 516 * cu;
+            d0[x] = pixel(s_yy[y0[x]], rv, guv, bu);
+            if (y1)
+                d1[x] = pixel(s_yy[y1[x]], rv, guv, bu);
+        }
+    }
+}
+
+// =====================================================
+// 融合内核：每一目标行先定位源行，再按 16.16 步长最近邻取样
+// =====================================================
+typedef struct
+{
+    const uint8_t *y, *u, *v; // 当前源行；RGB565 只用 y
+} row_src_t;
+
+typedef void (*row_fn_t)(const row_src_t *rs, uint16_t *d, int n, uint32_t acc, uint32_t step);
+
+static void setup_row(const video_image_t *src, int sy, row_src_t *rs)
+{
+    const uint8_t *row = src->plane[0] + (size_t)sy * src->stride[0];
+    switch (src->fmt)
+    {
+    case VIDEO_PIX_CBYCRY:
+        rs->y = row;
+        rs->u = row;
+        rs->v = row + 2;
+        break;
+    case VIDEO_PIX_NV12:
+        rs->y = row;
+        rs->u = src->plane[1] + (size_t)(sy >> 1) * src->stride[1];
+        rs->v = rs->u + 1;
+        break;
+    case VIDEO_PIX_I420:
+        rs->y = row;
+        rs->u = src->plane[1] + (size_t)(sy >> 1) * src->stride[1];
+        rs->v = src->plane[2] + (size_t)(sy >> 1) * src->stride[2];
+        break;
+    default:
+        rs->y = row;
+        rs->u = rs->v = NULL;
+        break;
+    }
+}
+
+static void row_rgb565(const row_src_t *rs, uint16_t *d, int n, uint32_t acc, uint32_t step)
+{
+    const uint16_t *s = (const uint16_t *)rs->y;
+    if (step == 0x10000)
+    {
+        memcpy(d, s + (acc >> 16), (size_t)n * 2);
+        return;
+    }
+    for (int i = 0; i < n; i++, acc += step)
+        d[i] = s[acc >> 16];
+}
+
+#define CHROMA_REUSE_STEP 0x18000
+
+// Y 偏移 = sx*YMUL + YADD，色度偏移 = (sx>>1)*CMUL
+// 1:1 且从偶数列开始：两像素一组共用色度，目标 4 字节对齐时合成一次 32 位写
+// 其余比例：步长小于 1.5 像素时相邻目标像素常落在同一组色度上，色度项只在换组时重算；
+// 缩小更多时几乎每个像素都换组，比较反而更慢，逐像素计算
+#define ROW_C(name, YMUL, YADD, CMUL)                                                   \
+    static void name(const row_src_t *rs, uint16_t *d, int n, uint32_t acc, uint32_t step) \
+    {                                                                                   \
+        int32_t rv = 0, guv = 0, bu = 0;                                                \
+        if (step == 0x10000 && !((acc >> 16) & 1))                                      \
+        {                                                                               \
+            uint32_t sx = acc >> 16;                                                    \
+            const uint8_t *py = rs->y + sx * (YMUL) + (YADD);                           \
+            const uint8_t *pu = rs->u + (sx >> 1) * (CMUL);                             \
+            const uint8_t *pv = rs->v + (sx >> 1) * (CMUL);                             \
+            bool wide = ((uintptr_t)d & 3) == 0;                                        \
+            int i = 0;                                                                  \
+            for (; i + 1 < n; i += 2, py += 2 * (YMUL), pu += (CMUL), pv += (CMUL))     \
+            {                                                                           \
+                int32_t cu = *pu - 128, cv = *pv - 128;                                 \
+                rv = 409 * cv;                                                          \
+                guv = -100 * cu - 208 * cv;                                             \
+                bu = 516 * cu;                                                          \
+                uint16_t a = pixel(s_yy[py[0]], rv, guv, bu);                           \
+                uint16_t b = pixel(s_yy[py[YMUL]], rv, guv, bu);                        \
+                if (wide)                                                               \
+                    *(uint32_t *)(d + i) = (uint32_t)a | ((uint32_t)b << 16);           \
+                else                                                                    \
+                {                                                                       \
+                    d[i] = a;                                                           \
+                    d[i + 1] = b;                                                       \
+                }                                                                       \
+            }                                                                           \
+            if (i < n)                                                                  \
+            {                                                                           \
+                int32_t cu = *pu - 128, cv = *pv - 128;                                 \
+                d[i] = pixel(s_yy[py[0]], 409 * cv, -100 * cu - 208 * cv, 516 * cu);    \
+            }                                                                           \
+            return;                                                                     \
+        }                                                                               \
+        if (step >= CHROMA_REUSE_STEP)                                                  \
+        {                                                                               \
+            for (int i = 0; i < n; i++, acc += step)                                    \
+            {                                                                           \
+                uint32_t sx = acc >> 16;                                                \
+                uint32_t c = (sx >> 1) * (CMUL);                                        \
+                int32_t cu = rs->u[c] - 128, cv = rs->v[c] - 128;                       \
+                d[i] = pixel(s_yy[rs->y[sx * (YMUL) + (YADD)]], 409 * cv,               \
+                             -100 * cu - 208 * cv, 516 * cu);                           \
+            }                                                                           \
+            return;                                                                     \
+        }                                                                               \
+        uint32_t last = UINT32_MAX;                                                     \
+        for (int i = 0; i < n; i++, acc += step)                                        \
+        {                                                                               \
+            uint32_t sx = acc >> 16;                                                    \
+            uint32_t c = (sx >> 1) * (CMUL);                                            \
+            if (c != last)                                                              \
+            {                                                                           \
+                int32_t cu = rs->u[c] - 128, cv = rs->v[c] - 128;                       \
+                rv = 409 * cv;                                                          \
+                guv = -100 * cu - 208 * cv;                                             \
+                bu = 516 * cu;                                                          \
+                last = c;                                                               \
+            }                                                                           \
+            d[i] = pixel(s_yy[rs->y[sx * (YMUL) + (YADD)]], rv, guv, bu);               \
+        }                                                                               \
+    }
+
+ROW_C(row_cbycry_c, 2, 1, 4)
+ROW_C(row_nv12_c, 1, 0, 2)
+ROW_C(row_i420_c, 1, 0, 1)
+
+#if defined(__GNUC__)
+// 向量版：先把源行连续区段整段转换（16 像素一组，连续读取，适合 SIMD），再按步长取样
+// 1:1 直接写目标；缩小超过 1.5 倍时整段转换浪费太多，回落到查表取样
+typedef int32_t v16i32 __attribute__((vector_size(64)));
+typedef uint16_t v16u16 __attribute__((vector_size(32)));
+
+#define SPAN_CHUNK 256
+#define SPAN_MAX_STEP 0x18000
+
+static inline v16i32 vclamp255(v16i32 x)
+{
+    x &= (v16i32)(x > 0);
+    v16i32 hi = (v16i32)(x > 255);
+    return (x & ~hi) | (hi & 255);
+}
+
+static inline void conv16(const int32_t *ya, const int32_t *ua, const int32_t *va, uint16_t *out)
+{
+    v16i32 y, u, v;
+    memcpy(&y, ya, sizeof(y));
+    memcpy(&u, ua, sizeof(u));
+    memcpy(&v, va, sizeof(v));
+    y = (y - 16) * 298 + 128;
+    u -= 128;
+    v -= 128;
+    v16i32 r = vclamp255((y + 409 * v) >> 8);
+    v16i32 g = vclamp255((y - 100 * u - 208 * v) >> 8);
+    v16i32 b = vclamp255((y + 516 * u) >> 8);
+    v16u16 px = __builtin_convertvector(((r >> 3) << 11) | ((g >> 2) << 5) | (b >> 3), v16u16);
+    memcpy(out, &px, sizeof(px));
+}
+
+// 源像素 [sx, sx+n) → out，sx 为偶数
+#define SPAN_VEC(name, YMUL, YADD, CMUL)                                                \
+    static void name(const row_src_t *rs, uint32_t sx, int n, uint16_t *out)            \
+    {                                                                                   \
+        int i = 0;                                                                      \
+        for (; i + 16 <= n; i += 16)                                                    \
+        {                                                                               \
+            int32_t ya[16], ua[16], va[16];                                             \
+            const uint8_t *py = rs->y + (sx + i) * (YMUL) + (YADD);                     \
+            const uint8_t *pu = rs->u + ((sx + i) >> 1) * (CMUL);                       \
+            const uint8_t *pv = rs->v + ((sx + i) >> 1) * (CMUL);                       \
+            for (int k = 0; k < 16; k++)                                                \
+            {                                                                           \
+                ya[k] = py[k * (YMUL)];                                                 \
+                ua[k] = pu[(k >> 1) * (CMUL)];                                          \
+                va[k] = pv[(k >> 1) * (CMUL)];                                          \
+            }                                                                           \
+            conv16(ya, ua, va, out + i);                                                \
+        }                                                                               \
+        for (; i < n; i++)                                                              \
+        {                                                                               \
+            uint32_t c = ((sx + i) >> 1) * (CMUL);                                      \
+            int32_t cu = rs->u[c] - 128, cv = rs->v[c] - 128;                           \
+            out[i] = pixel(s_yy[rs->y[(sx + i) * (YMUL) + (YADD)]], 409 * cv,           \
+                           -100 * cu - 208 * cv, 516 * cu);                             \
+        }                                                                               \
+    }
+
+#define ROW_VEC(name, span, fallback)                                                   \
+    static void name(const row_src_t *rs, uint16_t *d, int n, uint32_t acc, uint32_t step) \
+    {                                                                                   \
+        if (step == 0x10000 && !((acc >> 16) & 1))                                      \
+        {                                                                               \
+            span(rs, acc >> 16, n, d);                                                  \
+            return;                                                                     \
+        }                                                                               \
+        if (step > SPAN_MAX_STEP)                                                       \
+        {                                                                               \
+            fallback(rs, d, n, acc, step);                                              \
+            return;                                                                     \
+        }                                                                               \
+        uint16_t buf[SPAN_CHUNK];                                                       \
+        while (n > 0)                                                                   \
+        {                                                                               \
+            uint32_t sx0 = (acc >> 16) & ~1u;                                           \
+            uint64_t lim = (uint64_t)(sx0 + SPAN_CHUNK) << 16;                          \
+            int m = (int)((lim - acc + step - 1) / step);                               \
+            if (m > n)                                                                  \
+                m = n;                                                                  \
+            uint32_t span_n = ((acc + (uint32_t)(m - 1) * step) >> 16) - sx0 + 1;       \
+            span(rs, sx0, (int)span_n, buf);                                            \
+            for (int i = 0; i < m; i++, acc += step)                                    \
+                d[i] = buf[(acc >> 16) - sx0];                                          \
+            d += m;                                                                     \
+            n -= m;                                                                     \
+        }                                                                               \
+    }
+
+SPAN_VEC(span_cbycry_vec, 2, 1, 4)
+SPAN_VEC(span_nv12_vec, 1, 0, 2)
+SPAN_VEC(span_i420_vec, 1, 0, 1)
+ROW_VEC(row_cbycry_vec, span_cbycry_vec, row_cbycry_c)
+ROW_VEC(row_nv12_vec, span_nv12_vec, row_nv12_c)
+ROW_VEC(row_i420_vec, span_i420_vec, row_i420_c)
+#else
+#define row_cbycry_vec row_cbycry_c
+#define row_nv12_vec row_nv12_c
+#define row_i420_vec row_i420_c
+#endif
+
+static row_fn_t pick_row(video_pix_fmt_t fmt, bool vec)
+{
+    switch (fmt)
+    {
+    case VIDEO_PIX_CBYCRY:
+        return vec ? row_cbycry_vec : row_cbycry_c;
+    case VIDEO_PIX_NV12:
+        return vec ? row_nv12_vec : row_nv12_c;
+    case VIDEO_PIX_I420:
+        return vec ? row_i420_vec : row_i420_c;
+    default:
+        return row_rgb565;
+    }
+}
+
+static void blit_rect(const video_image_t *src, uint16_t *dst, int dst_w, int dst_h, int dst_stride,
+                      int rx, int ry, int rw, int rh, bool vec)
+{
+    if (!s_tables_ready)
+        tables_init();
+
+    // 矩形裁到 dst 内
+    int x0 = rx < 0 ? 0 : rx, x1 = rx + rw > dst_w ? dst_w : rx + rw;
+    int y0 = ry < 0 ? 0 : ry, y1 = ry + rh > dst_h ? dst_h : ry + rh;
+    if (rw <= 0 || rh <= 0 || src->w <= 0 || src->h <= 0 || x0 >= x1 || y0 >= y1)
+    {
+        for (int y = 0; y < dst_h; y++)
+            memset(dst + (size_t)y * dst_stride, 0, (size_t)dst_w * 2);
+        return;
+    }
+
+    uint32_t xstep = (uint32_t)(((uint64_t)src->w << 16) / rw);
+    uint32_t ystep = (uint32_t)(((uint64_t)src->h << 16) / rh);
+    uint32_t xacc = (uint32_t)(x0 - rx) * xstep + xstep / 2; // 取像素中心
+    row_fn_t row = pick_row(src->fmt, vec);
+    row_src_t rs;
+
+    for (int y = 0; y < dst_h; y++)
+    {
+        uint16_t *d = dst + (size_t)y * dst_stride;
+        if (y < y0 || y >= y1)
+        {
+            memset(d, 0, (size_t)dst_w * 2);
+            continue;
+        }
+        if (x0 > 0)
+            memset(d, 0, (size_t)x0 * 2);
+
+        uint32_t sy = (uint32_t)(((uint64_t)(y - ry) * ystep + ystep / 2) >> 16);
+        setup_row(src, (int)sy, &rs);
+        row(&rs, d + x0, x1 - x0, xacc, xstep);
+
+        if (x1 < dst_w)
+            memset(d + x1, 0, (size_t)(dst_w - x1) * 2);
+    }
+}
+
+void yuv2rgb_blit_rect_c(const video_image_t *src, uint16_t *dst, int dst_w, int dst_h, int dst_stride,
+                         int rx, int ry, int rw, int rh)
+{
+    blit_rect(src, dst, dst_w, dst_h, dst_stride, rx, ry, rw, rh, false);
+}
+
+void yuv2rgb_blit_rect_vec(const video_image_t *src, uint16_t *dst, int dst_w, int dst_h, int dst_stride,
+                           int rx, int ry, int rw, int rh)
+{
+    blit_rect(src, dst, dst_w, dst_h, dst_stride, rx, ry, rw, rh, true);
+}
+
+void yuv2rgb_blit_rect(const video_image_t *src, uint16_t *dst, int dst_w, int dst_h, int dst_stride,
+                       int rx, int ry, int rw, int rh)
+{
+    // 默认查表版，见文件头；YUV2RGB_VECTOR 留给有宽 SIMD 且 bench 证明更快的目标
+#if defined(__GNUC__) && defined(YUV2RGB_VECTOR)
+    blit_rect(src, dst, dst_w, dst_h, dst_stride, rx, ry, rw, rh, true);
+#else
+    blit_rect(src, dst, dst_w, dst_h, dst_stride, rx, ry, rw, rh, false);
+#endif
+}
+
+void yuv2rgb_blit_fit(const video_image_t *src, uint16_t *dst, int dst_w, int dst_h, int dst_stride)
+{
+    int rw = dst_w, rh = dst_h;
+    if (src->w > 0 && src->h > 0)
+    {
+        if ((int64_t)src->w * dst_h > (int64_t)src->h * dst_w)
+            rh = (int)((int64_t)src->h * dst_w / src->w);
+        else
+            rw = (int)((int64_t)src->w * dst_h / src->h);
+    }
+    yuv2rgb_blit_rect(src, dst, dst_w, dst_h, dst_stride, (dst_w - rw) / 2, (dst_h - rh) / 2, rw, rh);
+}
@@ -1,48 +1,269 @@
 #include <inttypes.h>
+#include <string.h>
 #include "audio_player.h"
+#include "audio_mixer.h"
+#include "audio_dsp.h"
+#include "audio_playlist.h"
+#include "spectrum.h"
+#include "ui.h"
+#include "bsp.h"
 #include "esp_log.h"
+#include "esp_codec_dev.h"
+#include "esp_codec_dev_defaults.h"
 #include "driver/i2s_std.h"
 
 static const char *TAG = "audio_player";
-extern i2s_chan_handle_t i2s_tx_handle;
 
+#define MUSIC_DIR "/sdcard/music"
+#define AUDIO_OUT_RATE BSP_AUDIO_SAMPLE_RATE
+extern i2s_chan_handle_t i2s_tx_handle; // main.c 的 app_audio_init() 建好并启用，失败时为 NULL
+
+#define MUTE_RAMP_MS 30 // 静音/取消静音的音量斜坡
+
+static audio_mixer_source_handle_t music_src;
+
+// I2S 输出走 esp_codec_dev：软件音量在写入/提交时处理，改时钟走 close/open，借出的缓冲随之作废
+// 借出 DMA 缓冲时混音器直接混进去，省掉一次拷贝；借不到时回落到 esp_codec_dev_write
+static const audio_codec_data_if_t *i2s_data;
+static esp_codec_dev_handle_t i2s_out;
+static bool i2s_lent;
+
+// 解码后的音乐先过效果链（均衡、音量、限幅）再进混音器
+static audio_dsp_handle_t music_dsp;
+static bool music_dsp_on = true; // 只处理 16 bit 立体声，播放器输出的都是这种
+static bool music_muted = true;
+static uint16_t music_volume = AUDIO_DSP_VOLUME_UNITY;
+static uint8_t music_volume_pct = 100;
+static uint32_t music_rate = AUDIO_OUT_RATE;
+
+// 五段均衡，默认全平，由 mp3_set_eq() 调节
+static const audio_dsp_eq_band_t eq_bands[] = {
+    { AUDIO_DSP_EQ_LOW_SHELF,  60,    0, 0    },
+    { AUDIO_DSP_EQ_PEAK,       230,   0, 1.0f },
+    { AUDIO_DSP_EQ_PEAK,       910,   0, 1.0f },
+    { AUDIO_DSP_EQ_PEAK,       3600,  0, 1.0f },
+    { AUDIO_DSP_EQ_HIGH_SHELF, 14000, 0, 0    },
+};
+#define EQ_BANDS (sizeof(eq_bands) / sizeof(eq_bands[0]))
+
+// 播放器在开始和结束播放时调用：软件音量斜坡代替功放静音，不会有咔哒声
 static esp_err_t my_mute(AUDIO_PLAYER_MUTE_SETTING setting) {
     ESP_LOGI(TAG, "mute = %d", setting);
+    music_muted = (setting == AUDIO_PLAYER_MUTE);
+    audio_dsp_set_volume(music_dsp, music_muted ? 0 : music_volume, MUTE_RAMP_MS);
     return ESP_OK;
 }
 
-static esp_err_t my_clk_set(uint32_t rate, uint32_t bits_cfg, i2s_slot_mode_t mode) {
+static esp_err_t i2s_clk_set(uint32_t rate, uint32_t bits_cfg, i2s_slot_mode_t mode) {
     ESP_LOGI(TAG, "set clk: %" PRIu32 " Hz, %" PRIu32 " bits, mode %d", rate, bits_cfg, mode);
-    i2s_std_clk_config_t clk_cfg = I2S_STD_CLK_DEFAULT_CONFIG(rate);
-    return i2s_channel_reconfig_std_clock(i2s_tx_handle, &clk_cfg);
+    // 关再开：通道停下后改格式和时钟，排队中和借出的 DMA 缓冲一起丢掉，不会把旧缓冲再借出去
+    esp_codec_dev_sample_info_t fs = {
+        .bits_per_sample = (uint8_t)bits_cfg,
+        .channel         = (mode == I2S_SLOT_MODE_MONO) ? 1 : 2,
+        .sample_rate     = rate,
+    };
+    esp_codec_dev_close(i2s_out);
+    return esp_codec_dev_open(i2s_out, &fs) == ESP_CODEC_DEV_OK ? ESP_OK : ESP_FAIL;
+}
+
+static esp_err_t i2s_write(void *audio_buffer, size_t len, size_t *bytes_written, uint32_t timeout_ms) {
+    *bytes_written = 0;
+    if (esp_codec_dev_write(i2s_out, audio_buffer, (int)len) != ESP_CODEC_DEV_OK) {
+        return ESP_FAIL;
+    }
+    *bytes_written = len;
+    return ESP_OK;
+}
+
+static esp_err_t i2s_acquire(void **buffer, size_t *len, uint32_t timeout_ms) {
+    int size;
+    if (esp_codec_dev_acquire_write(i2s_out, buffer, &size, timeout_ms) != ESP_CODEC_DEV_OK) {
+        return ESP_ERR_TIMEOUT;
+    }
+    *len = (size_t)size;
+    return ESP_OK;
+}
+
+static esp_err_t i2s_commit(size_t len) {
+    return esp_codec_dev_commit_write(i2s_out, (int)len) == ESP_CODEC_DEV_OK ? ESP_OK : ESP_FAIL;
+}
+
+static void i2s_out_delete(void) {
+    esp_codec_dev_delete(i2s_out);
+    audio_codec_delete_data_if(i2s_data);
+    i2s_out = NULL;
+    i2s_data = NULL;
+}
+
+// 播放器的输出接到混音器的 music 源：换格式只影响这一路，I2S 时钟不动
+static esp_err_t my_clk_set(uint32_t rate, uint32_t bits_cfg, i2s_slot_mode_t mode) {
+    music_dsp_on = (bits_cfg == 16) && (mode == I2S_SLOT_MODE_STEREO);
+    music_rate = rate;
+    audio_dsp_set_rate(music_dsp, rate);
+    return audio_mixer_source_set_format(music_src, rate, bits_cfg, mode == I2S_SLOT_MODE_MONO ? 1 : 2);
 }
 
 static esp_err_t my_write(void *audio_buffer, size_t len, size_t *bytes_written, uint32_t timeout_ms) {
-    return i2s_channel_write(i2s_tx_handle, audio_buffer, len, bytes_written, pdMS_TO_TICKS(timeout_ms));
+    if (music_dsp_on) {
+        size_t frames = len / (2 * sizeof(int16_t));
+        audio_dsp_process(music_dsp, (int16_t *)audio_buffer, frames);
+        // 频谱看的是效果链之后、真正送出去的声音；音乐页没打开时直接返回
+        spectrum_feed((const int16_t *)audio_buffer, frames, music_rate);
+    }
+    return audio_mixer_source_write(music_src, audio_buffer, len, bytes_written, timeout_ms);
 }
 
-void mp3_play_start(void) {
-    audio_player_config_t cfg = {
-        .mute_fn   = my_mute,
-        .clk_set_fn = my_clk_set,
-        .write_fn  = my_write,
-        .priority  = 5,
-        .coreID    = 0,
-    };
+bool audio_out_init(void) {
+    static bool mixer_ready = false;
 
-    if (audio_player_new(cfg) != ESP_OK) {
-        ESP_LOGE(TAG, "audio_player_new failed");
-        return;
+    if (!mixer_ready) {
+        if (!i2s_tx_handle) {
+            ESP_LOGE(TAG, "no I2S output");
+            return false;
+        }
+
+        // 一次交给 DMA 一个混音块，DMA 缓冲本身的大小由 TX 通道的 dma_frame_num 决定
+        audio_codec_i2s_cfg_t i2s_cfg = {
+            .tx_handle      = i2s_tx_handle,
+            .out_lend       = true,
+            .out_batch_size = CONFIG_AUDIO_PLAYER_MIXER_BLOCK_FRAMES * 2 * sizeof(int16_t),
+        };
+        i2s_data = audio_codec_new_i2s_data(&i2s_cfg);
+        i2s_lent = (i2s_data != NULL);
+        if (!i2s_lent) {
+            ESP_LOGW(TAG, "DMA buffers not lent, mixing through esp_codec_dev_write");
+            i2s_cfg.out_lend = false;
+            i2s_data = audio_codec_new_i2s_data(&i2s_cfg);
+        }
+        // ES8311 由 main.c 配好，这里只接数据接口，总音量用 esp_codec_dev 的软件音量
+        esp_codec_dev_cfg_t dev_cfg = {
+            .dev_type = ESP_CODEC_DEV_TYPE_OUT,
+            .data_if  = i2s_data,
+        };
+        i2s_out = i2s_data ? esp_codec_dev_new(&dev_cfg) : NULL;
+        if (!i2s_out) {
+            ESP_LOGE(TAG, "I2S output device failed");
+            audio_codec_delete_data_if(i2s_data);
+            i2s_data = NULL;
+            return false;
+        }
+        // 打开前设的音量在 open 时生效；音乐自己的音量和静音在 audio_dsp 里
+        esp_codec_dev_set_out_vol(i2s_out, 100);
+
+        // 混音器建好时调 i2s_clk_set 打开输出，之后不再改格式
+        audio_mixer_config_t cfg = {
+            .clk_set_fn   = i2s_clk_set,
+            .write_fn     = i2s_write,
+            .acquire_fn   = i2s_lent ? i2s_acquire : NULL,
+            .commit_fn    = i2s_lent ? i2s_commit : NULL,
+            .sample_rate  = AUDIO_OUT_RATE,
+            .block_frames = 0,
+            .priority     = 7, // 高于播放器的写入任务（5 + 1）
+            .coreID       = 0,
+        };
+
+        if (audio_mixer_new(&cfg) != ESP_OK) {
+            ESP_LOGE(TAG, "audio_mixer_new failed");
+            i2s_out_delete();
+            return false;
+        }
+        mixer_ready = true;
     }
+    return true;
+}
 
-    FILE *fp = fopen("/sdcard/test.mp3", "rb");
-    if (!fp) {
-        ESP_LOGE(TAG, "fopen failed");
-        return;
+bool audio_out_get_dma_stats(esp_codec_dev_out_buf_stats_t *out) {
+    return i2s_lent && esp_codec_dev_get_write_stats(i2s_out, out) == ESP_CODEC_DEV_OK;
+}
+
+bool mp3_play_start(void) {
+    static bool player_ready = false;
+
+    if (!player_ready) {
+        if (!audio_out_init()) {
+            return false;
+        }
+
+        // 每一步只做一次：上次中途失败时，已经建好的不再重复创建
+        if (!music_src) {
+            audio_mixer_source_config_t src_cfg = {
+                .name            = "music",
+                .sample_rate     = AUDIO_OUT_RATE,
+                .channels        = 2,
+                .bits_per_sample = 16,
+                .gain            = AUDIO_MIXER_GAIN_UNITY,
+                .low_latency     = false,
+                .buffer_ms       = 0,
+            };
+            if (audio_mixer_source_new(&src_cfg, &music_src) != ESP_OK) {
+                ESP_LOGE(TAG, "music source failed");
+                music_src = NULL;
+                return false;
+            }
+        }
+
+        // 从静音开始，第一次取消静音时音量斜坡上来
+        if (!music_dsp) {
+            audio_dsp_config_t dsp_cfg = {
+                .sample_rate  = AUDIO_OUT_RATE,
+                .bands        = EQ_BANDS,
+                .volume       = 0,
+                .limit_db     = -1.0f,
+                .lookahead_ms = 2,
+                .release_ms   = 100,
+            };
+            memcpy(dsp_cfg.band, eq_bands, sizeof(eq_bands));
+            music_dsp = audio_dsp_new(&dsp_cfg);
+            if (!music_dsp) {
+                ESP_LOGE(TAG, "audio_dsp_new failed");
+                return false;
+            }
+        }
+
+        audio_player_config_t cfg = {
+            .mute_fn   = my_mute,
+            .clk_set_fn = my_clk_set,
+            .write_fn  = my_write,
+            .priority  = 5,
+            .coreID    = 0,
+        };
+
+        if (audio_player_new(cfg) != ESP_OK) {
+            ESP_LOGE(TAG, "audio_player_new failed");
+            return false;
+        }
+        player_ready = true;
+    }
+
+    // 整个目录作为播放列表，曲目之间无缝衔接
+    if (!audio_playlist_open(MUSIC_DIR, NULL, NULL)) {
+        ESP_LOGE(TAG, "no tracks in %s", MUSIC_DIR);
+        return false;
+    }
+    return audio_playlist_play(0);
+}
+
+void mp3_set_volume(uint8_t percent) {
+    if (percent > 100) {
+        percent = 100;
     }
+    music_volume_pct = percent;
+    // 平方律，听感上更均匀
+    music_volume = (uint16_t)((uint32_t)percent * percent * AUDIO_DSP_VOLUME_UNITY / 10000);
+    if (music_dsp && !music_muted) {
+        audio_dsp_set_volume(music_dsp, music_volume, MUTE_RAMP_MS);
+    }
+}
 
-    audio_player_play(fp);
-    fclose(fp);
+uint8_t mp3_get_volume(void) {
+    return music_volume_pct;
+}
 
-    audio_player_delete();
-}
\ No newline at end of file
+void mp3_set_eq(uint8_t band, int8_t gain_db) {
+    if (!music_dsp || band >= EQ_BANDS) {
+        return;
+    }
+    audio_dsp_eq_band_t b = eq_bands[band];
+    b.gain_db = gain_db;
+    audio_dsp_set_band(music_dsp, band, &b);
+}
@@ -0,0 +1,430 @@
+// audio_playlist.c — 音乐播放列表：顺序 / 随机 / 插队，上一首 / 下一首
+// 切歌有两条路径：
+//   1) 自然放完：audio_player 在音频任务里调 next_cb，下一首接着解进同一个 PCM 环（无缝）
+//   2) 手动切歌：audio_player_play() 打断当前曲目
+// 两条路径都先把目标记为 pending，等 audio_player 报告它真正开始出声时才改 current
+
+#include "audio_playlist.h"
+#include "audio_player.h"
+#include "media_index.h"
+
+#include "esp_log.h"
+#include "esp_random.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static const char *TAG = "playlist";
+
+typedef struct
+{
+    media_index_t *list; // 可播放文件（自然排序），对外的 index 就是它的下标
+    size_t *order;       // 播放顺序：index 的排列，随机时洗牌
+    size_t n;
+    size_t pos;     // current 在 order 里的位置
+    size_t current; // 正在出声的曲目
+    size_t pending; // 已交给解码器、还没出声的曲目
+    size_t pending_pos;
+    size_t queue[AUDIO_PLAYLIST_QUEUE_LEN]; // 插队 FIFO
+    size_t q_head, q_len;
+    bool shuffle, repeat, paused;
+    audio_playlist_cb_t cb;
+    void *user_ctx;
+} playlist_t;
+
+static playlist_t s_pl = {.current = AUDIO_PLAYLIST_NONE, .pending = AUDIO_PLAYLIST_NONE};
+static SemaphoreHandle_t s_lock = NULL; // s_pl 同时被 UI 线程和音频任务访问
+
+static inline void pl_lock(void) { xSemaphoreTakeRecursive(s_lock, portMAX_DELAY); }
+static inline void pl_unlock(void) { xSemaphoreGiveRecursive(s_lock); }
+
+// =====================================================
+// 顺序
+// =====================================================
+// 重新生成播放顺序，first 放在最前（随机时）或保持原位（顺序时）；返回 first 的位置
+static size_t build_order(size_t first)
+{
+    for (size_t i = 0; i < s_pl.n; i++)
+        s_pl.order[i] = i;
+    if (!s_pl.shuffle)
+        return first < s_pl.n ? first : 0;
+
+    // Fisher-Yates
+    for (size_t i = s_pl.n - 1; i > 0; i--)
+    {
+        size_t j = esp_random() % (i + 1);
+        size_t t = s_pl.order[i];
+        s_pl.order[i] = s_pl.order[j];
+        s_pl.order[j] = t;
+    }
+    if (first < s_pl.n)
+    {
+        for (size_t i = 0; i < s_pl.n; i++)
+        {
+            if (s_pl.order[i] == first)
+            {
+                s_pl.order[i] = s_pl.order[0];
+                s_pl.order[0] = first;
+                break;
+            }
+        }
+    }
+    return 0;
+}
+
+static size_t order_pos_of(size_t index)
+{
+    for (size_t i = 0; i < s_pl.n; i++)
+    {
+        if (s_pl.order[i] == index)
+            return i;
+    }
+    return 0;
+}
+
+// 从 pos 往后走一步；到尾时循环或结束
+static bool step_pos(size_t *pos, int dir)
+{
+    if (dir > 0)
+    {
+        if (*pos + 1 < s_pl.n)
+            *pos += 1;
+        else if (s_pl.repeat)
+            *pos = 0;
+        else
+            return false;
+    }
+    else
+    {
+        if (*pos > 0)
+            *pos -= 1;
+        else if (s_pl.repeat)
+            *pos = s_pl.n - 1;
+        else
+            return false;
+    }
+    return true;
+}
+
+static FILE *open_track(size_t index)
+{
+    const char *path = media_index_path(s_pl.list, index);
+    if (!path)
+        return NULL;
+    FILE *fp = fopen(path, "rb");
+    if (!fp)
+        ESP_LOGW(TAG, "open %s failed", path);
+    return fp;
+}
+
+// 取下一首并打开：插队优先，其次按 order；打不开的跳过（最多试一圈）
+static FILE *open_next(size_t *index, size_t *pos)
+{
+    size_t p = s_pl.pending != AUDIO_PLAYLIST_NONE ? s_pl.pending_pos : s_pl.pos;
+
+    while (s_pl.q_len > 0)
+    {
+        size_t idx = s_pl.queue[s_pl.q_head];
+        s_pl.q_head = (s_pl.q_head + 1) % AUDIO_PLAYLIST_QUEUE_LEN;
+        s_pl.q_len--;
+        FILE *fp = open_track(idx);
+        if (fp)
+        {
+            // 插队曲目放完后从原位置继续
+            *index = idx;
+            *pos = p;
+            return fp;
+        }
+    }
+
+    for (size_t tries = 0; tries < s_pl.n && step_pos(&p, 1); tries++)
+    {
+        FILE *fp = open_track(s_pl.order[p]);
+        if (fp)
+        {
+            *index = s_pl.order[p];
+            *pos = p;
+            return fp;
+        }
+    }
+    return NULL;
+}
+
+// =====================================================
+// audio_player 回调（音频任务）
+// =====================================================
+// 当前曲目解码完：打开下一首，接在 PCM 环里当前曲目的尾巴后面
+static FILE *next_cb(void *user_ctx)
+{
+    size_t index, pos;
+
+    pl_lock();
+    FILE *fp = s_pl.n ? open_next(&index, &pos) : NULL;
+    if (fp)
+    {
+        s_pl.pending = index;
+        s_pl.pending_pos = pos;
+        ESP_LOGI(TAG, "prefetch %s", audio_playlist_name(index));
+    }
+    pl_unlock();
+    return fp;
+}
+
+static void player_cb(audio_player_cb_ctx_t *ctx)
+{
+    audio_playlist_event_t evt;
+    size_t index = AUDIO_PLAYLIST_NONE;
+
+    pl_lock();
+    switch (ctx->audio_event)
+    {
+    case AUDIO_PLAYER_CALLBACK_EVENT_PLAYING:
+    case AUDIO_PLAYER_CALLBACK_EVENT_COMPLETED_PLAYING_NEXT:
+        if (s_pl.pending != AUDIO_PLAYLIST_NONE)
+        {
+            // pending 的曲目开始出声
+            s_pl.current = s_pl.pending;
+            s_pl.pos = s_pl.pending_pos;
+            s_pl.pending = AUDIO_PLAYLIST_NONE;
+            s_pl.paused = false;
+            evt = AUDIO_PLAYLIST_EVT_TRACK;
+            index = s_pl.current;
+        }
+        else if (s_pl.paused && ctx->audio_event == AUDIO_PLAYER_CALLBACK_EVENT_PLAYING)
+        {
+            s_pl.paused = false;
+            evt = AUDIO_PLAYLIST_EVT_RESUME;
+            index = s_pl.current;
+        }
+        else
+        {
+            pl_unlock();
+            return;
+        }
+        break;
+    case AUDIO_PLAYER_CALLBACK_EVENT_PAUSE:
+        s_pl.paused = true;
+        evt = AUDIO_PLAYLIST_EVT_PAUSE;
+        index = s_pl.current;
+        break;
+    case AUDIO_PLAYER_CALLBACK_EVENT_IDLE:
+        s_pl.current = AUDIO_PLAYLIST_NONE;
+        s_pl.paused = false;
+        evt = AUDIO_PLAYLIST_EVT_STOP;
+        break;
+    default:
+        pl_unlock();
+        return;
+    }
+    audio_playlist_cb_t cb = s_pl.cb;
+    void *user_ctx = s_pl.user_ctx;
+    pl_unlock();
+
+    // 锁外回调，回调里可以再调用 audio_playlist_*
+    if (cb)
+        cb(evt, index, user_ctx);
+}
+
+// =====================================================
+// 公共接口
+// =====================================================
+bool audio_playlist_open(const char *dir, audio_playlist_cb_t cb, void *user_ctx)
+{
+    if (!s_lock)
+    {
+        s_lock = xSemaphoreCreateRecursiveMutex();
+        if (!s_lock)
+            return false;
+    }
+    audio_playlist_close();
+
+    static const char *const exts[] = {".mp3", ".wav", NULL};
+    const media_index_config_t cfg = {.exts = exts, .natural_sort = true, .cache = true};
+    media_index_t *list = media_index_open(dir, &cfg);
+    if (!list)
+    {
+        ESP_LOGE(TAG, "scan %s failed", dir);
+        return false;
+    }
+
+    size_t n = media_index_count(list);
+    size_t *order = (size_t *)malloc((n ? n : 1) * sizeof(size_t));
+    if (!order)
+    {
+        media_index_close(list);
+        return false;
+    }
+    ESP_LOGI(TAG, "%s: %u tracks", dir, (unsigned)n);
+
+    pl_lock();
+    s_pl.list = list;
+    s_pl.order = order;
+    s_pl.n = n;
+    s_pl.current = AUDIO_PLAYLIST_NONE;
+    s_pl.pending = AUDIO_PLAYLIST_NONE;
+    s_pl.q_head = s_pl.q_len = 0;
+    s_pl.paused = false;
+    s_pl.cb = cb;
+    s_pl.user_ctx = user_ctx;
+    s_pl.pos = build_order(0);
+    pl_unlock();
+
+    audio_player_callback_register(player_cb, NULL);
+    audio_player_next_register(next_cb, NULL);
+    return n > 0;
+}
+
+void audio_playlist_close(void)
+{
+    if (!s_lock)
+        return;
+
+    audio_player_next_register(NULL, NULL);
+    if (s_pl.current != AUDIO_PLAYLIST_NONE || s_pl.pending != AUDIO_PLAYLIST_NONE)
+        audio_player_stop();
+
+    pl_lock();
+    media_index_close(s_pl.list);
+    free(s_pl.order);
+    s_pl.list = NULL;
+    s_pl.order = NULL;
+    s_pl.n = 0;
+    s_pl.current = AUDIO_PLAYLIST_NONE;
+    s_pl.pending = AUDIO_PLAYLIST_NONE;
+    s_pl.cb = NULL;
+    pl_unlock();
+}
+
+size_t audio_playlist_count(void)
+{
+    return s_pl.n;
+}
+
+const char *audio_playlist_name(size_t index)
+{
+    if (index >= s_pl.n)
+        return NULL;
+    return media_index_name(s_pl.list, index);
+}
+
+size_t audio_playlist_current(void)
+{
+    return s_pl.current;
+}
+
+bool audio_playlist_play(size_t index)
+{
+    if (!s_lock || index >= s_pl.n)
+        return false;
+
+    pl_lock();
+    FILE *fp = open_track(index);
+    bool ok = false;
+    if (fp)
+    {
+        // 锁住直到请求进队，音频任务的 next_cb 不会插到中间改 pending
+        s_pl.pending = index;
+        s_pl.pending_pos = order_pos_of(index);
+        ok = audio_player_play(fp) == ESP_OK;
+        if (!ok)
+        {
+            s_pl.pending = AUDIO_PLAYLIST_NONE;
+            fclose(fp);
+        }
+    }
+    pl_unlock();
+    return ok;
+}
+
+bool audio_playlist_next(void)
+{
+    if (!s_lock || s_pl.n == 0)
+        return false;
+
+    pl_lock();
+    size_t index = AUDIO_PLAYLIST_NONE;
+    if (s_pl.q_len > 0)
+    {
+        index = s_pl.queue[s_pl.q_head];
+        s_pl.q_head = (s_pl.q_head + 1) % AUDIO_PLAYLIST_QUEUE_LEN;
+        s_pl.q_len--;
+    }
+    else if (s_pl.current == AUDIO_PLAYLIST_NONE)
+    {
+        index = s_pl.order[0];
+    }
+    else
+    {
+        size_t p = s_pl.pos;
+        if (step_pos(&p, 1))
+            index = s_pl.order[p];
+    }
+    bool ok = index != AUDIO_PLAYLIST_NONE && audio_playlist_play(index);
+    pl_unlock();
+    return ok;
+}
+
+bool audio_playlist_prev(void)
+{
+    if (!s_lock || s_pl.n == 0)
+        return false;
+
+    pl_lock();
+    size_t p = s_pl.current != AUDIO_PLAYLIST_NONE ? s_pl.pos : 0;
+    bool ok = step_pos(&p, -1) && audio_playlist_play(s_pl.order[p]);
+    pl_unlock();
+    return ok;
+}
+
+bool audio_playlist_queue(size_t index)
+{
+    if (!s_lock || index >= s_pl.n)
+        return false;
+
+    pl_lock();
+    bool ok = s_pl.q_len < AUDIO_PLAYLIST_QUEUE_LEN;
+    if (ok)
+    {
+        s_pl.queue[(s_pl.q_head + s_pl.q_len) % AUDIO_PLAYLIST_QUEUE_LEN] = index;
+        s_pl.q_len++;
+    }
+    pl_unlock();
+    return ok;
+}
+
+void audio_playlist_set_shuffle(bool on)
+{
+    if (!s_lock)
+        return;
+
+    pl_lock();
+    if (s_pl.shuffle != on && s_pl.n > 0)
+    {
+        s_pl.shuffle = on;
+        // 已经预取的曲目照常播放，之后按新顺序从当前曲目往后走
+        size_t first = s_pl.current != AUDIO_PLAYLIST_NONE ? s_pl.current : 0;
+        s_pl.pos = build_order(first);
+        if (s_pl.pending != AUDIO_PLAYLIST_NONE)
+            s_pl.pending_pos = s_pl.pos;
+    }
+    s_pl.shuffle = on;
+    pl_unlock();
+}
+
+bool audio_playlist_get_shuffle(void)
+{
+    return s_pl.shuffle;
+}
+
+void audio_playlist_set_repeat(bool on)
+{
+    s_pl.repeat = on;
+}
+
+bool audio_playlist_get_repeat(void)
+{
+    return s_pl.repeat;
+}
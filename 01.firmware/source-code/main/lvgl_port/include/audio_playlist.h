@@ -0,0 +1,58 @@
+#pragma once
+#include <stdbool.h>
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// 音乐目录播放列表（基于 media_index，自然排序），配合 esp-audio-player 无缝衔接：
+// 当前曲目解码完时由音频任务取下一首，接着解进同一个 PCM 环形缓冲，中间没有空白
+
+#ifndef AUDIO_PLAYLIST_QUEUE_LEN
+#define AUDIO_PLAYLIST_QUEUE_LEN 16 // 插队（queue）上限
+#endif
+
+#define AUDIO_PLAYLIST_NONE ((size_t)-1)
+
+typedef enum
+{
+    AUDIO_PLAYLIST_EVT_TRACK = 0, // 开始播放（听得到）index 曲目
+    AUDIO_PLAYLIST_EVT_PAUSE,
+    AUDIO_PLAYLIST_EVT_RESUME,
+    AUDIO_PLAYLIST_EVT_STOP, // 播放列表走完或被停止，index = AUDIO_PLAYLIST_NONE
+} audio_playlist_event_t;
+
+// 在音频任务里回调，不要在里面做耗时操作；改 UI 需要自己拿 LVGL 锁
+typedef void (*audio_playlist_cb_t)(audio_playlist_event_t event, size_t index, void *user_ctx);
+
+/**
+ * 扫描目录里的 .mp3 / .wav 并接管 audio_player 的回调
+ * audio_player_new() 之后调用；重复调用会先关闭旧列表
+ */
+bool audio_playlist_open(const char *dir, audio_playlist_cb_t cb, void *user_ctx);
+void audio_playlist_close(void);
+
+size_t audio_playlist_count(void);
+const char *audio_playlist_name(size_t index); // 文件名（不含目录）
+size_t audio_playlist_current(void);           // 正在播放的曲目，没有时 AUDIO_PLAYLIST_NONE
+
+// 立即切歌（打断当前曲目）
+bool audio_playlist_play(size_t index);
+bool audio_playlist_next(void);
+bool audio_playlist_prev(void);
+
+// 插队：当前曲目放完后先放 index，再回到原来的顺序
+bool audio_playlist_queue(size_t index);
+
+// 随机：打开时以当前曲目为起点重新洗牌；关闭时回到目录顺序
+void audio_playlist_set_shuffle(bool on);
+bool audio_playlist_get_shuffle(void);
+
+// 循环：放完最后一首后从头开始
+void audio_playlist_set_repeat(bool on);
+bool audio_playlist_get_repeat(void);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,52 @@
+#pragma once
+#include "lvgl.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// 同时解码的工作线程数（所有视频实例共享）
+#ifndef LV_VIDEO_WORKERS
+#define LV_VIDEO_WORKERS 2
+#endif
+
+typedef struct
+{
+    uint32_t frames;      // 已显示帧数
+    uint32_t dropped;     // 丢帧数（解码池忙 / 拿不到 UI 锁 / 解码失败）
+    uint32_t decode_us;   // 最近一帧解码耗时
+    uint8_t cpu_percent;  // 最近 1s 内解码占用（单核百分比）
+    uint16_t src_w, src_h;   // 视频原始分辨率
+    uint16_t surf_w, surf_h; // 实际显示尺寸
+} lv_video_stats_t;
+
+// 播放结束回调：在播放器任务中调用，不要在里面调用 lv_*
+typedef void (*lv_video_end_cb_t)(lv_obj_t *video, void *user_data);
+
+/**
+ * 创建一个视频控件（本质是 canvas，每个实例有自己的播放器、解码器和双缓冲）
+ * w/h > 0：固定显示尺寸，视频等比缩放到该尺寸（任意比例），不足部分黑边居中
+ * w/h = 0：跟随视频原始分辨率
+ * 必须在 UI 线程 / 持有 lvgl_port_lock 时调用
+ */
+lv_obj_t *lv_video_create(lv_obj_t *parent, int w, int h);
+
+// 开始播放（可在任意线程调用，包括结束回调内），会先停掉当前播放
+bool lv_video_play(lv_obj_t *video, const char *avi_path);
+
+// 播放结束后自动从头重播
+void lv_video_set_loop(lv_obj_t *video, bool loop);
+
+// 播放视频里的 PCM 声音（默认关闭，缩略图不出声）；需要先 audio_out_init() 建好混音器
+void lv_video_set_audio(lv_obj_t *video, bool on);
+
+void lv_video_set_end_cb(lv_obj_t *video, lv_video_end_cb_t cb, void *user_data);
+
+// 停止播放，保留最后一帧；删除控件时会自动停止并释放资源
+void lv_video_stop(lv_obj_t *video);
+
+void lv_video_get_stats(lv_obj_t *video, lv_video_stats_t *out);
+
+#ifdef __cplusplus
+}
+#endif
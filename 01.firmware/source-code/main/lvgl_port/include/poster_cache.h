@@ -0,0 +1,35 @@
+#pragma once
+#include "lvgl.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// 缩略图缓存目录：文件名 = hash(路径, mtime, 文件大小, 尺寸, 关键帧序号)
+#ifndef POSTER_CACHE_DIR
+#define POSTER_CACHE_DIR "/sdcard/.thumbs"
+#endif
+
+// 待处理请求上限，超过时 poster_cache_request 返回 false（保持占位图）
+#ifndef POSTER_CACHE_QUEUE_LEN
+#define POSTER_CACHE_QUEUE_LEN 64
+#endif
+
+/**
+ * 请求一张 AVI 海报帧，后台任务依次处理：
+ *   1) 命中 SD 卡缓存（路径+mtime 一致）：直接读出 RGB565
+ *   2) 未命中：按 idx1 索引定位第 key_index 个关键帧（无索引时只跳读块头），
+ *      JPEG 按比例缩小解码、黑边居中，写回缓存
+ * 完成后在 UI 锁内拷贝进 canvas 的缓冲并刷新。
+ * canvas 必须是 w*h 的 LV_IMG_CF_TRUE_COLOR canvas；必须在 UI 线程调用。
+ */
+bool poster_cache_request(lv_obj_t *canvas, const char *avi_path, uint32_t key_index);
+
+/**
+ * 作废所有尚未交付的请求（删除网格前在 UI 线程调用），之后不会再写任何旧 canvas
+ */
+void poster_cache_cancel_all(void);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,45 @@
+#pragma once
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// 音乐频谱 / 电平分析：在音频任务里把 PCM 抽取成单声道副本，每秒 SPECTRUM_FPS 次
+// 做 SPECTRUM_FFT_N 点定点实数 FFT，按对数频率分成 SPECTRUM_BARS 条；
+// 结果放在无锁快照里（seqlock），UI 随时读取，不会阻塞音频
+
+#define SPECTRUM_BARS 32
+#define SPECTRUM_FFT_N 512
+#define SPECTRUM_FPS 30
+
+typedef struct
+{
+    uint8_t bars[SPECTRUM_BARS]; // 0~255 对应 -60~0 dBFS，频率 50 Hz 起对数分布
+    uint8_t vu[2];               // 左右声道峰值，同样的刻度
+    uint32_t seq;                // 每次分析加一，没变时 UI 不用重画
+} spectrum_snapshot_t;
+
+typedef struct
+{
+    uint16_t cpu_permille; // 最近 1s 内分析占用（单核千分比，包括逐采样的抽取）
+    uint32_t fft_us;       // 最近一次加窗 + FFT + 分带耗时
+    uint32_t frames;       // 分析次数
+} spectrum_stats_t;
+
+// 没有页面在看时关掉，spectrum_feed() 直接返回
+void spectrum_set_enabled(bool on);
+
+// 音频任务调用：16 位立体声，只读
+void spectrum_feed(const int16_t *pcm, size_t frames, uint32_t sample_rate);
+
+// 任意任务调用；写入方正好在更新时返回 false，下次再读
+bool spectrum_read(spectrum_snapshot_t *out);
+
+void spectrum_get_stats(spectrum_stats_t *out);
+
+#ifdef __cplusplus
+}
+#endif
@@ -2,6 +2,7 @@
 #define _UI_LED_H_
 
 #include "lvgl.h"
+#include "esp_codec_dev_types.h"
 
 
 lv_obj_t* show_jpg_on_canvas(lv_obj_t *parent, const char *jpg_path, int canvas_w, int canvas_h);
@@ -9,12 +10,25 @@ lv_obj_t* show_jpg_on_canvas(lv_obj_t *parent, const char *jpg_path, int canvas_
 bool avi_play_start(const char *avi_path);
 bool avi_playlist_start(const char *dir_path, bool loop);
 
-void mp3_play_start(void);
+// 创建混音器并接管 I2S（只做一次），音乐和视频声音都经过它输出
+bool audio_out_init(void);
+// 混音器直接写 DMA 缓冲时的填充耗时和截止余量，用来权衡 DMA 缓冲个数和延迟；没借到缓冲时返回 false
+bool audio_out_get_dma_stats(esp_codec_dev_out_buf_stats_t *out);
+bool mp3_play_start(void); // 没有音频输出或没有曲目时返回 false
+// 音乐音量 0~100；五段均衡（60/230/910/3.6k/14k Hz），每段 ±15 dB
+void mp3_set_volume(uint8_t percent);
+uint8_t mp3_get_volume(void);
+void mp3_set_eq(uint8_t band, int8_t gain_db);
 void avi_playlist_stop(void);
 void avi_play_stop_and_deinit(void);
 
 lv_obj_t *photo_album_create(const char *dir, int canvas_w, int canvas_h, bool loop);
 lv_obj_t *video_page_create(const char *path, bool is_dir, bool loop);
+lv_obj_t *video_grid_create(lv_obj_t *parent, const char *dir_path, int cols);
+lv_obj_t *video_poster_grid_create(lv_obj_t *parent, const char *dir_path, int cols);
+lv_obj_t *video_grid_page_create(const char *dir_path);
+// 音乐页：播放控制 + 频谱 / 电平，进入时若没在放就开始放 /sdcard/music
+lv_obj_t *music_page_create(void);
 
 // void load_page_cb(lv_event_t *e);
 
@@ -0,0 +1,675 @@
+// lv_video.c — 多实例视频控件（MJPEG / AVI）
+// 每个实例：独立 avi_player（解复用任务）+ 独立解码器（MJPEG / H.264）+ 独立双缓冲 canvas
+// 解码：所有实例共享 LV_VIDEO_WORKERS 个解码线程（有界），缩略图网格/画中画可同时播放
+
+#include "lv_video.h"
+#include "video_decoder.h"
+#include "avi_player.h"
+#include "audio_mixer.h"
+#include "audio_pcm.h"
+#include "audio_adpcm.h"
+#include "sdkconfig.h"
+#if CONFIG_AUDIO_PLAYER_ENABLE_MP3
+#include "audio_mp3_stream.h"
+#endif
+
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "esp_heap_caps.h"
+#include "esp_idf_version.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/queue.h"
+#include "freertos/semphr.h"
+
+#include <string.h>
+#include <stdio.h>
+#include <stdatomic.h>
+
+#include "esp_lvgl_port.h"
+
+static const char *TAG = "lv_video";
+
+#define LV_VIDEO_QUEUE_LEN (LV_VIDEO_WORKERS * 2)
+#define LV_VIDEO_SUBMIT_TIMEOUT_MS 20 // 解码池忙时最多等这么久，超时丢帧
+#define LV_VIDEO_DECODE_TIMEOUT_MS 200 // 等一帧解完最多等这么久，超时丢帧
+#define LV_VIDEO_DEINIT_TRIES 3        // 释放时 avi_player_deinit 的重试上限，每次最多等 1 秒
+#define LV_VIDEO_RELEASE_TRIES 20      // 释放时等解码线程放手的次数上限，每次 LV_VIDEO_DECODE_TIMEOUT_MS / 4
+#define LV_VIDEO_CPU_WINDOW_US (1000 * 1000)
+#define LV_VIDEO_AUDIO_TIMEOUT_MS 40 // 混音器的环满了最多等这么久，超时丢掉这段声音
+#define LV_VIDEO_AUDIO_CHUNK 240      // 非 16 位立体声的 PCM 每次在栈上转换的采样数
+
+typedef struct
+{
+    lv_obj_t *canvas; // 仅 UI 线程创建/删除
+
+    avi_player_handle_t avi;
+    video_decoder_t *dec; // 按当前片段格式创建，格式变化时重建
+
+    bool fixed;       // true：固定显示尺寸
+    int surf_w, surf_h;
+    lv_color_t *buf[2];
+    int front, back;
+
+    char path[256];
+    bool loop;
+    volatile bool playing;
+    volatile bool stop;
+    lv_video_end_cb_t end_cb;
+    void *end_user;
+
+    // 声音：打开后由播放器任务按片段格式建混音器源
+    volatile bool audio;
+    audio_mixer_source_handle_t audio_src;
+    uint32_t audio_rate;
+    uint8_t audio_ch;
+    audio_pcm_dither_t audio_dither; // 24/32 位收窄到 16 位时的抖动
+    int16_t *audio_block;            // ADPCM 一个块解出来的采样，按块大小分配
+    size_t audio_block_len;          // audio_block 能放的采样数
+#if CONFIG_AUDIO_PLAYER_ENABLE_MP3
+    audio_mp3_stream_t *mp3; // MP3 音轨：第一次遇到时创建，跨块的帧在里面拼整
+#endif
+
+    // 当前解码任务（同一实例同时最多一个）
+    // job_state：IDLE -> QUEUED（video_cb 送入）-> RUNNING（解码线程接手）-> IDLE（做完）
+    // 等超时时还在排队就撤回（QUEUED -> IDLE），已经在解就让它做完，结果作废
+    atomic_int job_state;
+    atomic_int in_pool; // 队列里 + 正在解的条目数，撤回的条目也留在队列里，归零前 v 不能释放
+    SemaphoreHandle_t done;
+    const uint8_t *job_data;
+    size_t job_len;
+    video_frame_info_t job_info;
+    bool job_ok;
+    bool job_pending; // 数据已送入但没出图，不算丢帧
+
+    // 统计
+    uint32_t frames, dropped, decode_us;
+    uint16_t src_w, src_h;
+    int64_t win_start, win_busy;
+    uint8_t cpu_percent;
+} lv_video_t;
+
+enum
+{
+    JOB_IDLE,
+    JOB_QUEUED,
+    JOB_RUNNING,
+};
+
+static QueueHandle_t s_pool_q = NULL;
+
+// =====================================================
+// 小工具：帧缓冲分配（内部RAM优先，不足回落PSRAM）
+// =====================================================
+static lv_color_t *alloc_framebuf(size_t pixels)
+{
+    lv_color_t *p = heap_caps_aligned_calloc(16, pixels, sizeof(lv_color_t),
+                                             MALLOC_CAP_INTERNAL | MALLOC_CAP_DMA | MALLOC_CAP_8BIT);
+    if (!p)
+        p = heap_caps_aligned_calloc(16, pixels, sizeof(lv_color_t), MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+    return p;
+}
+
+static void free_framebufs(lv_video_t *v)
+{
+    for (int i = 0; i < 2; i++)
+    {
+        if (v->buf[i])
+        {
+            heap_caps_free(v->buf[i]);
+            v->buf[i] = NULL;
+        }
+    }
+}
+
+static bool alloc_framebufs(lv_video_t *v, int w, int h)
+{
+    free_framebufs(v);
+    v->buf[0] = alloc_framebuf((size_t)w * h);
+    v->buf[1] = alloc_framebuf((size_t)w * h);
+    if (!v->buf[0] || !v->buf[1])
+    {
+        free_framebufs(v);
+        ESP_LOGE(TAG, "no frame buffers for %dx%d", w, h);
+        return false;
+    }
+    v->surf_w = w;
+    v->surf_h = h;
+    v->front = 0;
+    v->back = 1;
+    return true;
+}
+
+// =====================================================
+// 解码一帧到 back（解码线程调用）— 不调用任何 lv_*，除了首帧绑定 canvas
+// =====================================================
+static bool decode_frame(lv_video_t *v)
+{
+    v->job_pending = false;
+    if (v->dec && v->dec->format != v->job_info.frame_format)
+    {
+        video_decoder_destroy(v->dec);
+        v->dec = NULL;
+    }
+    if (!v->dec)
+    {
+        v->dec = video_decoder_create(v->job_info.frame_format, v->job_info.width, v->job_info.height);
+        if (!v->dec)
+            return false;
+    }
+
+    video_dec_status_t st = video_decoder_feed(v->dec, v->job_data, v->job_len);
+    if (st == VIDEO_DEC_PENDING)
+        v->job_pending = true;
+    if (st != VIDEO_DEC_FRAME)
+        return false;
+
+    // 首帧 / 分辨率变化
+    if (v->src_w != v->dec->src_w || v->src_h != v->dec->src_h || !v->buf[0])
+    {
+        v->src_w = v->dec->src_w;
+        v->src_h = v->dec->src_h;
+
+        if (!v->fixed)
+        {
+            if (!alloc_framebufs(v, v->src_w, v->src_h))
+                return false;
+            if (!lvgl_port_lock(pdMS_TO_TICKS(5)))
+                return false;
+            if (!v->stop && v->canvas)
+            {
+                lv_canvas_set_buffer(v->canvas, v->buf[v->front], v->surf_w, v->surf_h, LV_IMG_CF_TRUE_COLOR);
+                lv_obj_center(v->canvas);
+            }
+            lvgl_port_unlock();
+        }
+        ESP_LOGI(TAG, "%p: %s %ux%u -> %dx%d", v, v->dec->ops->name, v->src_w, v->src_h, v->surf_w, v->surf_h);
+    }
+
+    return video_decoder_output(v->dec, v->buf[v->back], v->surf_w, v->surf_h);
+}
+
+// =====================================================
+// 共享解码线程池
+// =====================================================
+static void decode_worker_task(void *arg)
+{
+    (void)arg;
+    lv_video_t *v;
+    for (;;)
+    {
+        if (xQueueReceive(s_pool_q, &v, portMAX_DELAY) != pdTRUE)
+            continue;
+        // 已被 video_cb 撤回，或同一实例的任务已被前一个队列项接走
+        int expected = JOB_QUEUED;
+        if (!atomic_compare_exchange_strong(&v->job_state, &expected, JOB_RUNNING))
+        {
+            atomic_fetch_sub(&v->in_pool, 1);
+            continue;
+        }
+
+        int64_t t0 = esp_timer_get_time();
+        v->job_ok = !v->stop && decode_frame(v);
+        int64_t t1 = esp_timer_get_time();
+
+        v->decode_us = (uint32_t)(t1 - t0);
+        v->win_busy += t1 - t0;
+        if (v->win_start == 0)
+            v->win_start = t0;
+        if (t1 - v->win_start >= LV_VIDEO_CPU_WINDOW_US)
+        {
+            v->cpu_percent = (uint8_t)(v->win_busy * 100 / (t1 - v->win_start));
+            v->win_start = t1;
+            v->win_busy = 0;
+        }
+        atomic_store(&v->job_state, JOB_IDLE);
+        xSemaphoreGive(v->done);
+        atomic_fetch_sub(&v->in_pool, 1); // 之后不再碰 v
+    }
+}
+
+static bool pool_init_once(void)
+{
+    if (s_pool_q)
+        return true;
+    s_pool_q = xQueueCreate(LV_VIDEO_QUEUE_LEN, sizeof(lv_video_t *));
+    if (!s_pool_q)
+        return false;
+    for (int i = 0; i < LV_VIDEO_WORKERS; i++)
+    {
+        char name[16];
+        snprintf(name, sizeof(name), "lv_video_dec%d", i);
+        xTaskCreatePinnedToCore(decode_worker_task, name, 8 * 1024, NULL, 6, NULL, i % portNUM_PROCESSORS);
+    }
+    return true;
+}
+
+// =====================================================
+// avi_player 回调（各实例自己的播放器任务）
+// =====================================================
+static void video_cb(frame_data_t *frame, void *arg)
+{
+    lv_video_t *v = (lv_video_t *)arg;
+    if (v->stop)
+        return;
+    if (!frame || frame->type != FRAME_TYPE_VIDEO || !frame->data || frame->data_bytes == 0)
+        return;
+
+    // 上一帧超时后还在解：它还占着解码器和 back，这一帧丢掉
+    if (atomic_load(&v->job_state) != JOB_IDLE)
+    {
+        v->dropped++;
+        return;
+    }
+    xSemaphoreTake(v->done, 0); // 清掉超时那一帧晚到的完成信号
+
+    // 帧数据只在回调期间有效：交给解码池后在这里等它做完
+    v->job_data = frame->data;
+    v->job_len = frame->data_bytes;
+    v->job_info = frame->video_info;
+    atomic_store(&v->job_state, JOB_QUEUED);
+    atomic_fetch_add(&v->in_pool, 1);
+    if (xQueueSend(s_pool_q, &v, pdMS_TO_TICKS(LV_VIDEO_SUBMIT_TIMEOUT_MS)) != pdTRUE)
+    {
+        atomic_fetch_sub(&v->in_pool, 1);
+        atomic_store(&v->job_state, JOB_IDLE);
+        v->dropped++;
+        return;
+    }
+    if (xSemaphoreTake(v->done, pdMS_TO_TICKS(LV_VIDEO_DECODE_TIMEOUT_MS)) != pdTRUE)
+    {
+        int expected = JOB_QUEUED;
+        if (atomic_compare_exchange_strong(&v->job_state, &expected, JOB_IDLE))
+            ESP_LOGW(TAG, "%p: decode pool busy for %d ms, frame dropped", v, LV_VIDEO_DECODE_TIMEOUT_MS);
+        else
+            ESP_LOGW(TAG, "%p: decode took over %d ms, frame dropped", v, LV_VIDEO_DECODE_TIMEOUT_MS);
+        v->dropped++;
+        return;
+    }
+    if (!v->job_ok)
+    {
+        if (!v->job_pending)
+            v->dropped++;
+        return;
+    }
+
+    // UI 锁内交换 front/back、重绑 canvas
+    if (!lvgl_port_lock(pdMS_TO_TICKS(5)))
+    {
+        v->dropped++;
+        return;
+    }
+    if (!v->stop && v->canvas)
+    {
+        int old_front = v->front;
+        v->front = v->back;
+        v->back = old_front;
+        lv_canvas_set_buffer(v->canvas, v->buf[v->front], v->surf_w, v->surf_h, LV_IMG_CF_TRUE_COLOR);
+        lv_obj_invalidate(v->canvas);
+        v->frames++;
+    }
+    lvgl_port_unlock();
+}
+
+// 按 rate/channel 建混音器源或改格式，多声道缩混成立体声再进混音器
+static bool audio_src_ensure(lv_video_t *v, uint32_t rate, uint8_t channel)
+{
+    uint8_t src_ch = (channel == 1) ? 1 : 2;
+    if (!v->audio_src)
+    {
+        audio_mixer_source_config_t cfg = {
+            .name = "video",
+            .sample_rate = rate,
+            .channels = src_ch,
+            .bits_per_sample = 16,
+            .gain = AUDIO_MIXER_GAIN_UNITY,
+            .low_latency = false,
+            .buffer_ms = 0,
+        };
+        if (audio_mixer_source_new(&cfg, &v->audio_src) != ESP_OK)
+        {
+            ESP_LOGW(TAG, "no mixer source for %u Hz %u ch, playing muted", (unsigned)rate, channel);
+            v->audio = false;
+            return false;
+        }
+    }
+    else if (rate != v->audio_rate || channel != v->audio_ch)
+    {
+        if (audio_mixer_source_set_format(v->audio_src, rate, 16, src_ch) != ESP_OK)
+            return false;
+    }
+    v->audio_rate = rate;
+    v->audio_ch = channel;
+    return true;
+}
+
+#if CONFIG_AUDIO_PLAYER_ENABLE_MP3
+// MP3 解出一帧：格式以帧头为准，strf 里写的不一定对
+static void mp3_pcm_cb(const int16_t *pcm, size_t frames, uint32_t sample_rate, uint8_t channels, void *arg)
+{
+    lv_video_t *v = (lv_video_t *)arg;
+    if (v->stop || !audio_src_ensure(v, sample_rate, channels))
+        return;
+    audio_mixer_source_write(v->audio_src, pcm, frames * channels * sizeof(int16_t), NULL, LV_VIDEO_AUDIO_TIMEOUT_MS);
+}
+
+static void audio_mp3(lv_video_t *v, const frame_data_t *data)
+{
+    if (!v->mp3)
+    {
+        v->mp3 = audio_mp3_stream_new();
+        if (!v->mp3)
+        {
+            ESP_LOGW(TAG, "no memory for mp3 decoder, playing muted");
+            v->audio = false;
+            return;
+        }
+    }
+    audio_mp3_stream_feed(v->mp3, data->data, data->data_bytes, mp3_pcm_cb, v);
+}
+#endif
+
+static void audio_cb(frame_data_t *data, void *arg)
+{
+    lv_video_t *v = (lv_video_t *)arg;
+    const audio_frame_info_t *info = &data->audio_info;
+
+    // 源只在播放器任务里建/删，和写入不会撞车
+    if (!v->audio)
+    {
+        if (v->audio_src)
+        {
+            audio_mixer_source_delete(v->audio_src);
+            v->audio_src = NULL;
+        }
+        return;
+    }
+#if CONFIG_AUDIO_PLAYER_ENABLE_MP3
+    // MP3 的块不按帧对齐，交给流式解码器
+    if (info->format == FORMAT_MP3)
+    {
+        if (!v->stop)
+            audio_mp3(v, data);
+        return;
+    }
+#endif
+    // PCM 和 G.711 按采样转换；ADPCM 按块解码，块头里带着解码器状态，每块单独解
+    audio_pcm_format_t fmt = AUDIO_PCM_S16;
+    audio_adpcm_format_t adpcm;
+    bool is_adpcm = (info->format == FORMAT_ADPCM_IMA || info->format == FORMAT_ADPCM_MS);
+    bool ok;
+    if (is_adpcm)
+        ok = audio_adpcm_format_from_wav(info->format_tag, info->channel, info->block_align, info->bits_per_sample,
+                                         info->samples_per_block, &adpcm);
+    else
+        ok = (info->format != FORMAT_AUDIO_OTHER) && audio_pcm_format_from_wav(info->format_tag, info->bits_per_sample, &fmt);
+    if (v->stop || !ok || info->channel < 1 || info->channel > AUDIO_PCM_MAX_CHANNELS)
+        return;
+    if (!audio_src_ensure(v, info->sample_rate, info->channel))
+        return;
+    uint8_t src_ch = (info->channel == 1) ? 1 : 2;
+
+    if (is_adpcm)
+    {
+        size_t need = (size_t)adpcm.samples_per_block * adpcm.channels;
+        if (need > v->audio_block_len)
+        {
+            free(v->audio_block);
+            v->audio_block = malloc(need * sizeof(int16_t));
+            v->audio_block_len = v->audio_block ? need : 0;
+            if (!v->audio_block)
+                return;
+        }
+        // 一段数据里是整数个块，最后一块可能短一些
+        for (size_t off = 0; off < data->data_bytes; off += adpcm.block_align)
+        {
+            size_t bytes = data->data_bytes - off;
+            size_t frames = audio_adpcm_decode_block(&adpcm, v->audio_block, data->data + off,
+                                                     bytes < adpcm.block_align ? bytes : adpcm.block_align);
+            if (frames == 0 ||
+                audio_mixer_source_write(v->audio_src, v->audio_block, frames * src_ch * sizeof(int16_t), NULL,
+                                         LV_VIDEO_AUDIO_TIMEOUT_MS) != ESP_OK)
+                break;
+        }
+        return;
+    }
+
+    if (fmt == AUDIO_PCM_S16 && info->channel <= 2)
+    {
+        audio_mixer_source_write(v->audio_src, data->data, data->data_bytes, NULL, LV_VIDEO_AUDIO_TIMEOUT_MS);
+        return;
+    }
+
+    // 其它位深/G.711/声道数：按整帧分段转成 16 位，再缩混
+    int16_t pcm[LV_VIDEO_AUDIO_CHUNK];
+    size_t size = audio_pcm_format_bytes(fmt);
+    size_t frames = data->data_bytes / (size * info->channel);
+    for (size_t done = 0; done < frames;)
+    {
+        size_t n = frames - done;
+        if (n > LV_VIDEO_AUDIO_CHUNK / info->channel)
+            n = LV_VIDEO_AUDIO_CHUNK / info->channel;
+        audio_pcm_to_s16(pcm, data->data + done * size * info->channel, fmt, n * info->channel, &v->audio_dither);
+        if (info->channel > 2)
+            audio_pcm_downmix_s16(pcm, pcm, info->channel, n);
+        if (audio_mixer_source_write(v->audio_src, pcm, n * src_ch * sizeof(int16_t), NULL, LV_VIDEO_AUDIO_TIMEOUT_MS) != ESP_OK)
+            break;
+        done += n;
+    }
+}
+
+static void end_cb(void *arg)
+{
+    lv_video_t *v = (lv_video_t *)arg;
+#if CONFIG_AUDIO_PLAYER_ENABLE_MP3
+    if (v->mp3)
+        audio_mp3_stream_reset(v->mp3); // 下一遍/下一段从头找帧，不拿上一段剩的半帧去拼
+#endif
+    v->playing = false;
+    if (v->stop)
+        return;
+
+    if (v->loop)
+    {
+        v->playing = (avi_player_play_from_file(v->avi, v->path) == ESP_OK);
+        if (v->playing)
+            return;
+    }
+    if (v->end_cb)
+        v->end_cb(v->canvas, v->end_user);
+}
+
+static bool player_init_once(lv_video_t *v)
+{
+    if (v->avi)
+        return true;
+    if (!pool_init_once())
+        return false;
+
+    avi_player_config_t cfg = {
+        .buffer_size = 384 * 1024,
+        .video_cb = video_cb,
+        .audio_cb = audio_cb,
+        .avi_play_end_cb = end_cb,
+        .priority = 7,
+        .coreID = 1,
+        .user_data = v,
+        .stack_size = 4 * 1024, // 只做解复用，解码在线程池
+#if ESP_IDF_VERSION >= ESP_IDF_VERSION_VAL(5, 1, 0)
+        .stack_in_psram = false,
+#endif
+    };
+    if (v->fixed && (size_t)v->surf_w * v->surf_h < 320 * 240)
+        cfg.buffer_size = 128 * 1024; // 缩略图一般是小码率片段
+
+    if (avi_player_init(cfg, &v->avi) != ESP_OK)
+    {
+        v->avi = NULL;
+        ESP_LOGE(TAG, "avi_player_init failed");
+        return false;
+    }
+    return true;
+}
+
+// =====================================================
+// 释放（删除控件时）
+// =====================================================
+static void video_release(lv_video_t *v)
+{
+    v->stop = true;
+    if (v->avi)
+    {
+        avi_player_play_stop(v->avi);
+        // 播放器任务还在回调里时 deinit 会超时返回，任务仍在用 v：等到它确认退出才能往下释放
+        int tries = 0;
+        while (avi_player_deinit(v->avi) == ESP_ERR_TIMEOUT)
+        {
+            if (++tries >= LV_VIDEO_DEINIT_TRIES)
+            {
+                // 宁可漏掉这一个实例，也不能释放还在被用的内存
+                ESP_LOGE(TAG, "%p: player task did not exit, leaking the instance", v);
+                return;
+            }
+            ESP_LOGW(TAG, "player task still busy, waiting");
+        }
+        v->avi = NULL;
+    }
+    // 超时丢掉的那一帧可能还在解码线程里，撤回的条目也还在队列里（stop 已置位，轮到时马上跳过）
+    for (int tries = 0; atomic_load(&v->in_pool) != 0; tries++)
+    {
+        if (tries >= LV_VIDEO_RELEASE_TRIES)
+        {
+            ESP_LOGE(TAG, "%p: decode pool still holds the instance, leaking it", v);
+            return;
+        }
+        vTaskDelay(pdMS_TO_TICKS(LV_VIDEO_DECODE_TIMEOUT_MS / 4));
+    }
+    if (v->audio_src)
+        audio_mixer_source_delete(v->audio_src);
+    free(v->audio_block);
+#if CONFIG_AUDIO_PLAYER_ENABLE_MP3
+    audio_mp3_stream_delete(v->mp3);
+#endif
+    video_decoder_destroy(v->dec);
+    v->dec = NULL;
+    free_framebufs(v);
+    if (v->done)
+        vSemaphoreDelete(v->done);
+    free(v);
+}
+
+static void video_delete_cb(lv_event_t *e)
+{
+    lv_obj_t *obj = lv_event_get_target(e);
+    lv_video_t *v = (lv_video_t *)lv_obj_get_user_data(obj);
+    lv_obj_set_user_data(obj, NULL);
+    if (!v)
+        return;
+    v->canvas = NULL; // 先断开，避免晚到的回调再碰它
+    video_release(v);
+}
+
+// =====================================================
+// 对外接口
+// =====================================================
+lv_obj_t *lv_video_create(lv_obj_t *parent, int w, int h)
+{
+    lv_video_t *v = (lv_video_t *)calloc(1, sizeof(lv_video_t));
+    if (!v)
+        return NULL;
+    v->done = xSemaphoreCreateBinary();
+    v->fixed = (w > 0 && h > 0);
+    if (!v->done || (v->fixed && !alloc_framebufs(v, w, h)))
+    {
+        if (v->done)
+            vSemaphoreDelete(v->done);
+        free(v);
+        return NULL;
+    }
+
+    v->canvas = lv_canvas_create(parent);
+    lv_obj_set_user_data(v->canvas, v);
+    lv_obj_add_event_cb(v->canvas, video_delete_cb, LV_EVENT_DELETE, NULL);
+    if (v->fixed)
+        lv_canvas_set_buffer(v->canvas, v->buf[v->front], w, h, LV_IMG_CF_TRUE_COLOR);
+    return v->canvas;
+}
+
+bool lv_video_play(lv_obj_t *video, const char *avi_path)
+{
+    lv_video_t *v = (lv_video_t *)lv_obj_get_user_data(video);
+    if (!v || !avi_path)
+        return false;
+    if (!player_init_once(v))
+        return false;
+
+    // 正在播：先停，等结束回调把 playing 清掉
+    if (v->playing)
+    {
+        v->stop = true;
+        avi_player_play_stop(v->avi);
+        for (int i = 0; i < 50 && v->playing; i++)
+            vTaskDelay(pdMS_TO_TICKS(5));
+    }
+    if (v->audio_src)
+        audio_mixer_source_flush(v->audio_src); // 上一段没放完的声音不要带到新片段
+
+    snprintf(v->path, sizeof(v->path), "%s", avi_path);
+    v->stop = false;
+    v->playing = true;
+    if (avi_player_play_from_file(v->avi, v->path) != ESP_OK)
+    {
+        v->playing = false;
+        ESP_LOGE(TAG, "play failed: %s", v->path);
+        return false;
+    }
+    return true;
+}
+
+void lv_video_set_loop(lv_obj_t *video, bool loop)
+{
+    lv_video_t *v = (lv_video_t *)lv_obj_get_user_data(video);
+    if (v)
+        v->loop = loop;
+}
+
+void lv_video_set_audio(lv_obj_t *video, bool on)
+{
+    lv_video_t *v = (lv_video_t *)lv_obj_get_user_data(video);
+    if (v)
+        v->audio = on;
+}
+
+void lv_video_set_end_cb(lv_obj_t *video, lv_video_end_cb_t cb, void *user_data)
+{
+    lv_video_t *v = (lv_video_t *)lv_obj_get_user_data(video);
+    if (!v)
+        return;
+    v->end_cb = cb;
+    v->end_user = user_data;
+}
+
+void lv_video_stop(lv_obj_t *video)
+{
+    lv_video_t *v = (lv_video_t *)lv_obj_get_user_data(video);
+    if (!v || !v->avi)
+        return;
+    v->stop = true;
+    avi_player_play_stop(v->avi);
+}
+
+void lv_video_get_stats(lv_obj_t *video, lv_video_stats_t *out)
+{
+    lv_video_t *v = (lv_video_t *)lv_obj_get_user_data(video);
+    memset(out, 0, sizeof(*out));
+    if (!v)
+        return;
+    out->frames = v->frames;
+    out->dropped = v->dropped;
+    out->decode_us = v->decode_us;
+    out->cpu_percent = v->cpu_percent;
+    out->src_w = v->src_w;
+    out->src_h = v->src_h;
+    out->surf_w = v->surf_w;
+    out->surf_h = v->surf_h;
+}
@@ -16,6 +16,7 @@ static lv_obj_t *s_main_page = NULL;
 static void video_page_delete_cb(lv_event_t *e);
 static void video_back_btn_cb(lv_event_t *e);
 static void video_gesture_cb(lv_event_t *e);
+static void grid_back_btn_cb(lv_event_t *e);
 
 typedef struct
 {
@@ -132,7 +133,22 @@ void video_btn_cb(lv_event_t *e)
     {
         ESP_LOGI(TAG, "Video 被点击");
         // video_page_create("/sdcard/nr/gc4.avi", false, false);
-        video_page_create("/sdcard/nr", true, true);
+        // video_page_create("/sdcard/nr", true, true);
+        video_grid_page_create("/sdcard/nr");
+    }
+}
+
+// music btn
+void music_btn_cb(lv_event_t *e)
+{
+    if (lv_event_get_code(e) == LV_EVENT_CLICKED)
+    {
+        ESP_LOGI(TAG, "Music 被点击");
+        lv_obj_t *new_scr = music_page_create();
+        if (new_scr)
+        {
+            lv_scr_load_anim(new_scr, LV_SCR_LOAD_ANIM_FADE_IN, 120, 0, true);
+        }
     }
 }
 
@@ -235,7 +251,7 @@ lv_obj_t *page_main_create(void)
     /* 事件回调 */
     lv_obj_add_event_cb(s_pic_button, pic_btn_cb, LV_EVENT_ALL, NULL);
     lv_obj_add_event_cb(s_video_button, video_btn_cb, LV_EVENT_CLICKED, NULL);
-    // lv_obj_add_event_cb(s_music_button, music_btn_cb, LV_EVENT_CLICKED, NULL); // 有的话加上
+    lv_obj_add_event_cb(s_music_button, music_btn_cb, LV_EVENT_CLICKED, NULL);
 
     lv_obj_add_event_cb(s_main_page, load_page_cb, LV_EVENT_ALL, NULL);
     return s_main_page;
@@ -378,4 +394,87 @@ static void video_page_delete_cb(lv_event_t *e)
     avi_play_stop_and_deinit();
     if (ctx)
         lv_mem_free(ctx);
-}
\ No newline at end of file
+}
+// 视频浏览页：默认海报网格（静态、可滚动），右上角 Live 切换为实时播放的小窗口，点击进入全屏
+static char s_grid_dir[128];
+
+static void grid_fill_body(lv_obj_t *body, bool live)
+{
+    lv_obj_t *grid = live ? video_grid_create(body, s_grid_dir, 3) : video_poster_grid_create(body, s_grid_dir, 3);
+    if (!grid)
+    {
+        ESP_LOGE(TAG, "video grid (%s) failed", s_grid_dir);
+        lv_obj_t *empty = lv_label_create(body);
+        lv_label_set_text(empty, "No AVI found");
+        lv_obj_set_style_text_color(empty, lv_color_white(), 0);
+        lv_obj_center(empty);
+    }
+}
+
+static void grid_live_btn_cb(lv_event_t *e)
+{
+    lv_obj_t *btn = lv_event_get_target(e);
+    lv_obj_t *body = (lv_obj_t *)lv_event_get_user_data(e);
+    // 删除旧网格时海报请求作废 / 视频控件自己停止
+    lv_obj_clean(body);
+    grid_fill_body(body, lv_obj_has_state(btn, LV_STATE_CHECKED));
+}
+
+lv_obj_t *video_grid_page_create(const char *dir_path)
+{
+    lv_obj_t *scr = lv_obj_create(NULL);
+    lv_obj_set_style_bg_opa(scr, LV_OPA_COVER, 0);
+    lv_obj_set_style_bg_color(scr, lv_color_black(), 0);
+    lv_obj_clear_flag(scr, LV_OBJ_FLAG_SCROLLABLE);
+
+    lv_obj_t *bar = lv_obj_create(scr);
+    lv_obj_set_size(bar, LV_PCT(100), 48);
+    lv_obj_set_style_bg_opa(bar, LV_OPA_60, 0);
+    lv_obj_set_style_bg_color(bar, lv_color_black(), 0);
+    lv_obj_align(bar, LV_ALIGN_TOP_MID, 0, 0);
+
+    lv_obj_t *btn = lv_btn_create(bar);
+    lv_obj_set_size(btn, 64, 36);
+    lv_obj_align(btn, LV_ALIGN_LEFT_MID, 8, 0);
+    lv_obj_add_event_cb(btn, grid_back_btn_cb, LV_EVENT_CLICKED, NULL);
+
+    lv_obj_t *lbl = lv_label_create(btn);
+    lv_label_set_text(lbl, LV_SYMBOL_LEFT "  Back");
+    lv_obj_center(lbl);
+
+    lv_obj_t *title = lv_label_create(bar);
+    lv_label_set_text(title, "Videos");
+    lv_obj_align(title, LV_ALIGN_CENTER, 0, 0);
+
+    snprintf(s_grid_dir, sizeof(s_grid_dir), "%s", dir_path);
+
+    lv_obj_t *body = lv_obj_create(scr);
+    lv_obj_set_size(body, EXAMPLE_LCD_H_RES, EXAMPLE_LCD_V_RES - 48);
+    lv_obj_align(body, LV_ALIGN_BOTTOM_MID, 0, 0);
+    lv_obj_set_style_bg_opa(body, LV_OPA_TRANSP, 0);
+    lv_obj_set_style_border_width(body, 0, 0);
+    lv_obj_set_style_pad_all(body, 0, 0);
+
+    lv_obj_t *live = lv_btn_create(bar);
+    lv_obj_set_size(live, 64, 36);
+    lv_obj_align(live, LV_ALIGN_RIGHT_MID, -8, 0);
+    lv_obj_add_flag(live, LV_OBJ_FLAG_CHECKABLE);
+    lv_obj_add_event_cb(live, grid_live_btn_cb, LV_EVENT_VALUE_CHANGED, body);
+
+    lbl = lv_label_create(live);
+    lv_label_set_text(lbl, "Live");
+    lv_obj_center(lbl);
+
+    grid_fill_body(body, false);
+
+    lv_scr_load_anim(scr, LV_SCR_LOAD_ANIM_FADE_IN, 120, 0, true);
+    return scr;
+}
+
+static void grid_back_btn_cb(lv_event_t *e)
+{
+    LV_UNUSED(e);
+    // 删除旧屏时各视频控件自己停止并释放
+    lv_obj_t *home = page_main_create();
+    lv_scr_load_anim(home, LV_SCR_LOAD_ANIM_MOVE_BOTTOM, 120, 0, true);
+}
@@ -0,0 +1,448 @@
+// music_page.c — 音乐播放页：曲名、频谱 / 电平条、上一首 / 播放暂停 / 下一首、音量
+// 频谱数据由音频任务里的 spectrum.c 算好，这里只按 30 fps 读快照、做下落动画，
+// 并且只重画变化了的那一截柱子（按 4 条一组合并脏区，不会超出 LVGL 的 32 个脏区上限）
+
+#include "lvgl.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "audio_player.h"
+#include "audio_playlist.h"
+#include "spectrum.h"
+#include "ui.h"
+#include "bsp.h"
+
+#include <stdio.h>
+#include <string.h>
+
+static const char *TAG = "music_page";
+
+#define VIS_W 668
+#define VIS_BAR_H 300   // 柱子区域高度
+#define VIS_GAP 4       // 柱子间距
+#define VIS_BAR_W ((VIS_W - (SPECTRUM_BARS - 1) * VIS_GAP) / SPECTRUM_BARS)
+#define VIS_CAP_H 3     // 峰值帽高度
+#define VIS_VU_Y (VIS_BAR_H + 16)
+#define VIS_VU_H 10
+#define VIS_VU_GAP 6
+#define VIS_H (VIS_VU_Y + 2 * VIS_VU_H + VIS_VU_GAP)
+#define VIS_GROUP 4     // 每组 4 条一起刷新：最多 8 个柱子脏区 + 1 个电平脏区
+
+#define BAR_FALL 8      // 每帧下落（0~255 刻度）
+#define CAP_HOLD 15     // 峰值帽停留帧数
+#define CAP_FALL 3
+#define UI_PERIOD_MS (1000 / SPECTRUM_FPS)
+#define CPU_WINDOW_US (1000 * 1000)
+
+typedef struct
+{
+    lv_obj_t *vis;
+    lv_obj_t *title;
+    lv_obj_t *play_lbl;
+    lv_obj_t *stats;
+    lv_timer_t *timer;
+
+    uint32_t seq;
+    size_t track;
+    uint8_t bar[SPECTRUM_BARS]; // 当前显示高度（0~255）
+    uint8_t cap[SPECTRUM_BARS];
+    uint8_t cap_hold[SPECTRUM_BARS];
+    uint8_t vu[2];
+
+    // UI 侧占用：定时器 + 绘制，按 1s 窗口统计
+    int64_t win_start, win_busy;
+    uint16_t ui_permille;
+} music_page_ctx_t;
+
+static void music_back_btn_cb(lv_event_t *e);
+
+static inline lv_coord_t bar_px(uint8_t v)
+{
+    return (lv_coord_t)(v * (VIS_BAR_H - VIS_CAP_H) / 255); // 满格时峰值帽也在区域内
+}
+
+static inline lv_coord_t vu_px(uint8_t v)
+{
+    return (lv_coord_t)(v * VIS_W / 255);
+}
+
+static void ui_busy_add(music_page_ctx_t *ctx, int64_t t0)
+{
+    ctx->win_busy += esp_timer_get_time() - t0;
+}
+
+// 每秒一次更新占用率文字（只在定时器里改控件，绘制过程中不能再产生脏区）
+static void ui_stats_tick(music_page_ctx_t *ctx)
+{
+    int64_t now = esp_timer_get_time();
+    if (ctx->win_start == 0)
+        ctx->win_start = now;
+    if (now - ctx->win_start < CPU_WINDOW_US)
+        return;
+    ctx->ui_permille = (uint16_t)(ctx->win_busy * 1000 / (now - ctx->win_start));
+    ctx->win_start = now;
+    ctx->win_busy = 0;
+
+    spectrum_stats_t st;
+    spectrum_get_stats(&st);
+    lv_label_set_text_fmt(ctx->stats, "FFT %u.%u%%  UI %u.%u%%",
+                          st.cpu_permille / 10, st.cpu_permille % 10,
+                          ctx->ui_permille / 10, ctx->ui_permille % 10);
+}
+
+// =====================================================
+// 绘制：只画和本次裁剪区相交的柱子
+// =====================================================
+static void vis_draw_cb(lv_event_t *e)
+{
+    int64_t t0 = esp_timer_get_time();
+    music_page_ctx_t *ctx = (music_page_ctx_t *)lv_event_get_user_data(e);
+    lv_obj_t *obj = lv_event_get_target(e);
+    lv_draw_ctx_t *draw_ctx = lv_event_get_draw_ctx(e);
+    const lv_area_t *clip = draw_ctx->clip_area;
+
+    lv_area_t coords;
+    lv_obj_get_coords(obj, &coords);
+    lv_coord_t base = coords.y1 + VIS_BAR_H;
+
+    lv_draw_rect_dsc_t dsc;
+    lv_draw_rect_dsc_init(&dsc);
+    dsc.bg_opa = LV_OPA_COVER;
+
+    for (int b = 0; b < SPECTRUM_BARS; b++)
+    {
+        lv_area_t a;
+        a.x1 = coords.x1 + b * (VIS_BAR_W + VIS_GAP);
+        a.x2 = a.x1 + VIS_BAR_W - 1;
+        a.y1 = coords.y1;
+        a.y2 = base - 1;
+        if (a.x2 < clip->x1 || a.x1 > clip->x2)
+            continue;
+
+        // 低频红 → 高频蓝
+        lv_coord_t h = bar_px(ctx->bar[b]);
+        if (h > 0)
+        {
+            a.y1 = base - h;
+            dsc.bg_color = lv_color_hsv_to_rgb((uint16_t)(b * 240 / SPECTRUM_BARS), 90, 100);
+            lv_draw_rect(draw_ctx, &dsc, &a);
+        }
+        lv_coord_t c = bar_px(ctx->cap[b]);
+        if (c > 0)
+        {
+            a.y1 = base - c - VIS_CAP_H;
+            a.y2 = a.y1 + VIS_CAP_H - 1;
+            dsc.bg_color = lv_color_white();
+            lv_draw_rect(draw_ctx, &dsc, &a);
+        }
+    }
+
+    dsc.bg_color = lv_palette_main(LV_PALETTE_GREEN);
+    for (int ch = 0; ch < 2; ch++)
+    {
+        lv_coord_t w = vu_px(ctx->vu[ch]);
+        if (w <= 0)
+            continue;
+        lv_area_t a;
+        a.x1 = coords.x1;
+        a.x2 = coords.x1 + w - 1;
+        a.y1 = coords.y1 + VIS_VU_Y + ch * (VIS_VU_H + VIS_VU_GAP);
+        a.y2 = a.y1 + VIS_VU_H - 1;
+        lv_draw_rect(draw_ctx, &dsc, &a);
+    }
+
+    ui_busy_add(ctx, t0);
+}
+
+// =====================================================
+// 30 fps：读快照、下落动画、按组提交脏区
+// =====================================================
+static void update_play_label(music_page_ctx_t *ctx)
+{
+    bool playing = audio_player_get_state() == AUDIO_PLAYER_STATE_PLAYING;
+    lv_label_set_text(ctx->play_lbl, playing ? LV_SYMBOL_PAUSE : LV_SYMBOL_PLAY);
+}
+
+static void vis_timer_cb(lv_timer_t *t)
+{
+    int64_t t0 = esp_timer_get_time();
+    music_page_ctx_t *ctx = (music_page_ctx_t *)t->user_data;
+
+    size_t track = audio_playlist_current();
+    if (track != ctx->track)
+    {
+        ctx->track = track;
+        const char *name = track == AUDIO_PLAYLIST_NONE ? NULL : audio_playlist_name(track);
+        lv_label_set_text(ctx->title, name ? name : "-");
+        update_play_label(ctx);
+    }
+
+    // 没有新分析（暂停、停止）时按零输入继续下落，落到底就不再有脏区
+    spectrum_snapshot_t snap;
+    if (!spectrum_read(&snap) || snap.seq == ctx->seq)
+        memset(&snap, 0, sizeof(snap));
+    else
+        ctx->seq = snap.seq;
+
+    lv_area_t coords;
+    lv_obj_get_coords(ctx->vis, &coords);
+    lv_coord_t base = coords.y1 + VIS_BAR_H;
+
+    for (int g = 0; g < SPECTRUM_BARS / VIS_GROUP; g++)
+    {
+        lv_coord_t top = LV_COORD_MAX, bottom = LV_COORD_MIN;
+        for (int b = g * VIS_GROUP; b < (g + 1) * VIS_GROUP; b++)
+        {
+            uint8_t old_bar = ctx->bar[b], old_cap = ctx->cap[b];
+
+            uint8_t v = snap.bars[b];
+            if (v < old_bar)
+                v = old_bar > BAR_FALL ? old_bar - BAR_FALL : 0;
+            ctx->bar[b] = v;
+
+            if (v >= old_cap)
+            {
+                ctx->cap[b] = v;
+                ctx->cap_hold[b] = CAP_HOLD;
+            }
+            else if (ctx->cap_hold[b])
+            {
+                ctx->cap_hold[b]--;
+            }
+            else
+            {
+                ctx->cap[b] = old_cap > CAP_FALL ? old_cap - CAP_FALL : 0;
+                if (ctx->cap[b] < v)
+                    ctx->cap[b] = v;
+            }
+
+            if (v == old_bar && ctx->cap[b] == old_cap)
+                continue;
+            // 变化的只是新旧柱顶之间那一截，加上新旧峰值帽
+            lv_coord_t hi = LV_MAX(LV_MAX(bar_px(v), bar_px(old_bar)),
+                                   LV_MAX(bar_px(ctx->cap[b]), bar_px(old_cap)) + VIS_CAP_H);
+            lv_coord_t lo = LV_MIN(LV_MIN(bar_px(v), bar_px(old_bar)),
+                                   LV_MIN(bar_px(ctx->cap[b]), bar_px(old_cap)));
+            top = LV_MIN(top, base - hi);
+            bottom = LV_MAX(bottom, base - lo);
+        }
+        if (top > bottom)
+            continue;
+
+        lv_area_t a;
+        a.x1 = coords.x1 + g * VIS_GROUP * (VIS_BAR_W + VIS_GAP);
+        a.x2 = a.x1 + VIS_GROUP * (VIS_BAR_W + VIS_GAP) - VIS_GAP - 1;
+        a.y1 = LV_MAX(top, coords.y1);
+        a.y2 = LV_MIN(bottom, base) - 1;
+        if (a.y2 >= a.y1)
+            lv_obj_invalidate_area(ctx->vis, &a);
+    }
+
+    // 两行电平合成一个脏区，只覆盖新旧长度之间
+    lv_coord_t x_lo = LV_COORD_MAX, x_hi = LV_COORD_MIN;
+    for (int ch = 0; ch < 2; ch++)
+    {
+        uint8_t old = ctx->vu[ch];
+        uint8_t v = snap.vu[ch];
+        if (v < old)
+            v = old > BAR_FALL ? old - BAR_FALL : 0;
+        ctx->vu[ch] = v;
+        if (v == old)
+            continue;
+        x_lo = LV_MIN(x_lo, LV_MIN(vu_px(v), vu_px(old)));
+        x_hi = LV_MAX(x_hi, LV_MAX(vu_px(v), vu_px(old)));
+    }
+    if (x_hi > x_lo)
+    {
+        lv_area_t a;
+        a.x1 = coords.x1 + x_lo;
+        a.x2 = coords.x1 + x_hi - 1;
+        a.y1 = coords.y1 + VIS_VU_Y;
+        a.y2 = coords.y1 + VIS_H - 1;
+        lv_obj_invalidate_area(ctx->vis, &a);
+    }
+
+    ui_busy_add(ctx, t0);
+    ui_stats_tick(ctx);
+}
+
+// =====================================================
+// 按钮
+// =====================================================
+static void music_prev_btn_cb(lv_event_t *e)
+{
+    LV_UNUSED(e);
+    audio_playlist_prev();
+}
+
+static void music_next_btn_cb(lv_event_t *e)
+{
+    LV_UNUSED(e);
+    audio_playlist_next();
+}
+
+static void music_play_btn_cb(lv_event_t *e)
+{
+    music_page_ctx_t *ctx = (music_page_ctx_t *)lv_event_get_user_data(e);
+    bool playing = false;
+    switch (audio_player_get_state())
+    {
+    case AUDIO_PLAYER_STATE_PLAYING:
+        audio_player_pause();
+        break;
+    case AUDIO_PLAYER_STATE_PAUSE:
+        audio_player_resume();
+        playing = true;
+        break;
+    default:
+        playing = mp3_play_start();
+        break;
+    }
+    // 状态在播放器任务里切换，这里按点击后的预期显示
+    lv_label_set_text(ctx->play_lbl, playing ? LV_SYMBOL_PAUSE : LV_SYMBOL_PLAY);
+}
+
+static void music_volume_cb(lv_event_t *e)
+{
+    lv_obj_t *slider = lv_event_get_target(e);
+    mp3_set_volume((uint8_t)lv_slider_get_value(slider));
+}
+
+static void music_page_delete_cb(lv_event_t *e)
+{
+    music_page_ctx_t *ctx = (music_page_ctx_t *)lv_event_get_user_data(e);
+    // 没人看时不做分析，音乐继续放
+    spectrum_set_enabled(false);
+    if (!ctx)
+        return;
+    if (ctx->timer)
+        lv_timer_del(ctx->timer);
+    lv_mem_free(ctx);
+}
+
+static lv_obj_t *round_btn(lv_obj_t *parent, int size, const char *symbol, lv_event_cb_t cb, void *user_data,
+                           lv_obj_t **label)
+{
+    lv_obj_t *btn = lv_btn_create(parent);
+    lv_obj_set_size(btn, size, size);
+    lv_obj_set_style_radius(btn, LV_RADIUS_CIRCLE, 0);
+    lv_obj_add_event_cb(btn, cb, LV_EVENT_CLICKED, user_data);
+
+    lv_obj_t *lbl = lv_label_create(btn);
+    lv_label_set_text(lbl, symbol);
+    lv_obj_center(lbl);
+    if (label)
+        *label = lbl;
+    return btn;
+}
+
+lv_obj_t *music_page_create(void)
+{
+    music_page_ctx_t *ctx = (music_page_ctx_t *)lv_mem_alloc(sizeof(music_page_ctx_t));
+    if (!ctx)
+        return NULL;
+    memset(ctx, 0, sizeof(*ctx));
+    ctx->track = AUDIO_PLAYLIST_NONE - 1; // 第一次定时器必定刷新曲名
+
+    lv_obj_t *scr = lv_obj_create(NULL);
+    lv_obj_set_style_bg_opa(scr, LV_OPA_COVER, 0);
+    lv_obj_set_style_bg_color(scr, lv_color_black(), 0);
+    lv_obj_clear_flag(scr, LV_OBJ_FLAG_SCROLLABLE);
+
+    // 顶部工具条（返回 + 标题）
+    lv_obj_t *bar = lv_obj_create(scr);
+    lv_obj_set_size(bar, LV_PCT(100), 48);
+    lv_obj_set_style_bg_opa(bar, LV_OPA_60, 0);
+    lv_obj_set_style_bg_color(bar, lv_color_black(), 0);
+    lv_obj_align(bar, LV_ALIGN_TOP_MID, 0, 0);
+
+    lv_obj_t *btn = lv_btn_create(bar);
+    lv_obj_set_size(btn, 64, 36);
+    lv_obj_align(btn, LV_ALIGN_LEFT_MID, 8, 0);
+    lv_obj_add_event_cb(btn, music_back_btn_cb, LV_EVENT_CLICKED, NULL);
+
+    lv_obj_t *lbl = lv_label_create(btn);
+    lv_label_set_text(lbl, LV_SYMBOL_LEFT "  Back");
+    lv_obj_center(lbl);
+
+    lbl = lv_label_create(bar);
+    lv_label_set_text(lbl, "Music");
+    lv_obj_align(lbl, LV_ALIGN_CENTER, 0, 0);
+
+    // 曲名
+    ctx->title = lv_label_create(scr);
+    lv_obj_set_width(ctx->title, VIS_W);
+    lv_label_set_long_mode(ctx->title, LV_LABEL_LONG_SCROLL_CIRCULAR);
+    lv_obj_set_style_text_align(ctx->title, LV_TEXT_ALIGN_CENTER, 0);
+    lv_obj_set_style_text_color(ctx->title, lv_color_white(), 0);
+    lv_label_set_text(ctx->title, "-");
+    lv_obj_align(ctx->title, LV_ALIGN_TOP_MID, 0, 72);
+
+    // 频谱：透明、不可点击，内容全部在 DRAW_MAIN 里自己画
+    ctx->vis = lv_obj_create(scr);
+    lv_obj_remove_style_all(ctx->vis);
+    lv_obj_set_size(ctx->vis, VIS_W, VIS_H);
+    lv_obj_align(ctx->vis, LV_ALIGN_TOP_MID, 0, 112);
+    lv_obj_clear_flag(ctx->vis, LV_OBJ_FLAG_CLICKABLE | LV_OBJ_FLAG_SCROLLABLE);
+    lv_obj_add_event_cb(ctx->vis, vis_draw_cb, LV_EVENT_DRAW_MAIN, ctx);
+
+    // 控制按钮
+    lv_obj_t *row = lv_obj_create(scr);
+    lv_obj_set_size(row, VIS_W, 100);
+    lv_obj_align(row, LV_ALIGN_TOP_MID, 0, 112 + VIS_H + 24);
+    lv_obj_set_style_bg_opa(row, LV_OPA_TRANSP, 0);
+    lv_obj_set_style_border_width(row, 0, 0);
+    lv_obj_set_style_pad_all(row, 0, 0);
+    lv_obj_clear_flag(row, LV_OBJ_FLAG_SCROLLABLE);
+    lv_obj_set_layout(row, LV_LAYOUT_FLEX);
+    lv_obj_set_flex_flow(row, LV_FLEX_FLOW_ROW);
+    lv_obj_set_flex_align(row, LV_FLEX_ALIGN_SPACE_EVENLY, LV_FLEX_ALIGN_CENTER, LV_FLEX_ALIGN_CENTER);
+
+    round_btn(row, 64, LV_SYMBOL_PREV, music_prev_btn_cb, NULL, NULL);
+    round_btn(row, 88, LV_SYMBOL_PLAY, music_play_btn_cb, ctx, &ctx->play_lbl);
+    round_btn(row, 64, LV_SYMBOL_NEXT, music_next_btn_cb, NULL, NULL);
+
+    // 音量
+    lbl = lv_label_create(scr);
+    lv_label_set_text(lbl, LV_SYMBOL_VOLUME_MAX);
+    lv_obj_set_style_text_color(lbl, lv_color_white(), 0);
+    lv_obj_align(lbl, LV_ALIGN_BOTTOM_LEFT, 36, -62);
+
+    lv_obj_t *slider = lv_slider_create(scr);
+    lv_obj_set_width(slider, VIS_W - 80);
+    lv_slider_set_range(slider, 0, 100);
+    lv_slider_set_value(slider, mp3_get_volume(), LV_ANIM_OFF);
+    lv_obj_align(slider, LV_ALIGN_BOTTOM_MID, 20, -66);
+    lv_obj_add_event_cb(slider, music_volume_cb, LV_EVENT_VALUE_CHANGED, NULL);
+
+    // 占用率：分析在音频任务（Core 0），UI 是定时器 + 绘制
+    ctx->stats = lv_label_create(scr);
+    lv_obj_set_style_text_color(ctx->stats, lv_palette_main(LV_PALETTE_GREY), 0);
+    lv_label_set_text(ctx->stats, "FFT -  UI -");
+    lv_obj_align(ctx->stats, LV_ALIGN_BOTTOM_RIGHT, -12, -12);
+
+    lv_obj_add_event_cb(scr, music_page_delete_cb, LV_EVENT_DELETE, ctx);
+
+    spectrum_set_enabled(true);
+    ctx->timer = lv_timer_create(vis_timer_cb, UI_PERIOD_MS, ctx);
+
+    // 第一次进入时开始放音乐目录；已经在放（或暂停）就接着用
+    audio_player_state_t st = audio_player_get_state();
+    if (st != AUDIO_PLAYER_STATE_PLAYING && st != AUDIO_PLAYER_STATE_PAUSE)
+    {
+        ESP_LOGI(TAG, "start music");
+        if (!mp3_play_start())
+        {
+            ESP_LOGW(TAG, "music not started");
+        }
+    }
+    update_play_label(ctx);
+
+    return scr;
+}
+
+static void music_back_btn_cb(lv_event_t *e)
+{
+    LV_UNUSED(e);
+    lv_obj_t *home = page_main_create();
+    lv_scr_load_anim(home, LV_SCR_LOAD_ANIM_MOVE_BOTTOM, 120, 0, true);
+}
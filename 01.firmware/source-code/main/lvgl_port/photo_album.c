@@ -7,11 +7,11 @@
 #include <stdio.h>
 #include <string.h>
 #include <stdlib.h>
-#include <dirent.h>
 #include <sys/stat.h>
 #include <ctype.h>
 
 #include "ui.h"
+#include "media_index.h"
 #include "esp_log.h"
 
 // ============================= 配置项 =============================
@@ -38,7 +38,7 @@ typedef struct
     int decode_cap;
 
     // 文件列表
-    char **paths;
+    media_index_t *list;
     int count;
     int index;
 
@@ -69,138 +69,49 @@ static void safe_free_align(void *p)
     if (p)
         jpeg_free_align(p);
 }
-static bool has_ext_icase(const char *name, const char *ext) // ext: ".jpg" / ".jpeg"
+// 扫描目录，收集 .jpg/.jpeg（自然排序，结果缓存在目录里）；
+// path 是单个 JPG 时打开它所在的目录，从这张开始
+static esp_err_t build_jpg_list(const char *path, media_index_t **out_list, int *out_n, int *out_first)
 {
-    const char *dot = strrchr(name, '.');
-    if (!dot)
-        return false;
-    while (*ext && *dot)
-    {
-        char a = (char)tolower((unsigned char)*dot++);
-        char b = (char)tolower((unsigned char)*ext++);
-        if (a != b)
-            return false;
-    }
-    return *dot == '\0' && *ext == '\0';
-}
-
-static void free_list(char **list, int n)
-{
-    if (!list)
-        return;
-    for (int i = 0; i < n; i++)
-        free(list[i]);
-    free(list);
-}
+    static const char *const exts[] = {".jpg", ".jpeg", NULL};
+    const media_index_config_t cfg = {.exts = exts, .natural_sort = true, .cache = true};
 
-// 扫描目录，收集 .jpg/.jpeg
-static esp_err_t build_jpg_list(const char *path, char ***out_list, int *out_n)
-{
     *out_list = NULL;
     *out_n = 0;
+    *out_first = 0;
 
-    DIR *dir = opendir(path);
-    if (!dir)
+    struct stat st;
+    bool single = stat(path, &st) == 0 && S_ISREG(st.st_mode);
+    char dir[256];
+    snprintf(dir, sizeof(dir), "%s", path);
+    if (single)
     {
-        // 支持单文件路径
-        struct stat st;
-        if (stat(path, &st) == 0 && S_ISREG(st.st_mode) &&
-            (has_ext_icase(path, ".jpg") || has_ext_icase(path, ".jpeg")))
-        {
-            char **one = (char **)calloc(1, sizeof(char *));
-            if (!one)
-                return ESP_ERR_NO_MEM;
-            one[0] = strdup(path);
-            if (!one[0])
-            {
-                free(one);
-                return ESP_ERR_NO_MEM;
-            }
-            *out_list = one;
-            *out_n = 1;
-            return ESP_OK;
-        }
-        ALBUM_LOG("opendir(%s) failed", path);
-        return ESP_FAIL;
+        char *slash = strrchr(dir, '/');
+        if (!slash)
+            return ESP_FAIL;
+        *slash = '\0';
     }
 
-    // 统计
-    int cnt = 0;
-    struct dirent *ent;
-    while ((ent = readdir(dir)) != NULL)
-    {
-        if (ent->d_name[0] == '.')
-            continue;
-        if (has_ext_icase(ent->d_name, ".jpg") || has_ext_icase(ent->d_name, ".jpeg"))
-            cnt++;
-    }
-    if (cnt == 0)
+    media_index_t *list = media_index_open(dir, &cfg);
+    if (!list)
     {
-        closedir(dir);
-        ALBUM_LOG("no jpg in %s", path);
+        ALBUM_LOG("opendir(%s) failed", dir);
         return ESP_FAIL;
     }
-
-    char **list = (char **)calloc((size_t)cnt, sizeof(char *));
-    if (!list)
+    if (media_index_count(list) == 0)
     {
-        closedir(dir);
-        return ESP_ERR_NO_MEM;
+        media_index_close(list);
+        ALBUM_LOG("no jpg in %s", dir);
+        return ESP_FAIL;
     }
-
-    rewinddir(dir);
-    int idx = 0;
-    while ((ent = readdir(dir)) != NULL)
+    if (single)
     {
-        if (ent->d_name[0] == '.')
-            continue;
-        if (!(has_ext_icase(ent->d_name, ".jpg") || has_ext_icase(ent->d_name, ".jpeg")))
-            continue;
-
-        size_t dlen = strlen(path), flen = strlen(ent->d_name);
-        bool has_sep = (dlen > 0 && (path[dlen - 1] == '/' || path[dlen - 1] == '\\'));
-        size_t need = dlen + (has_sep ? 0 : 1) + flen + 1;
-        char *full = (char *)malloc(need);
-        if (!full)
-        {
-            closedir(dir);
-            free_list(list, idx);
-            return ESP_ERR_NO_MEM;
-        }
-        if (has_sep)
-            snprintf(full, need, "%s%s", path, ent->d_name);
-        else
-            snprintf(full, need, "%s/%s", path, ent->d_name);
-
-        // 轻量 SOI 校验：不是 JPEG 就丢弃
-        FILE *fp = fopen(full, "rb");
-        bool ok = false;
-        if (fp)
-        {
-            unsigned char soi[2] = {0};
-            if (fread(soi, 1, 2, fp) == 2 && soi[0] == 0xFF && soi[1] == 0xD8)
-                ok = true;
-            fclose(fp);
-        }
-        if (!ok)
-        {
-            ESP_LOGW("album", "ignore non-jpeg: %s", full);
-            free(full);
-            continue;
-        }
-
-        list[idx++] = full;
+        size_t first = media_index_find(list, path);
+        *out_first = first == MEDIA_INDEX_NONE ? 0 : (int)first;
     }
-    closedir(dir);
 
-    if (idx == 0)
-    {
-        free(list);
-        ALBUM_LOG("no valid jpg in %s", path);
-        return ESP_FAIL;
-    }
     *out_list = list;
-    *out_n = idx; // ← 用实际数量
+    *out_n = (int)media_index_count(list);
     return ESP_OK;
 }
 
@@ -425,7 +336,7 @@ static void album_event_cb(lv_event_t *e)
         // —— 水平优先：显著水平才认作左右滑
         if (abs(dx) >= abs(dy))
         {
-            if (!c || c->count <= 0 || !c->paths)
+            if (!c || c->count <= 0 || !c->list)
             {
                 // 没有相册内容时忽略
                 break;
@@ -450,7 +361,7 @@ static void album_event_cb(lv_event_t *e)
             if (next != c->index)
             {
                 c->index = next;
-                (void)load_jpg(c, c->paths[c->index]); // 失败也不致崩
+                (void)load_jpg(c, media_index_path(c->list, c->index)); // 失败也不致崩
             }
         }
         else
@@ -536,10 +447,10 @@ lv_obj_t *photo_album_create(const char *dir, int canvas_w, int canvas_h, bool l
         c->decode_buf = NULL;
         c->decode_cap = 0;
     }
-    if (c->paths)
+    if (c->list)
     {
-        free_list(c->paths, c->count);
-        c->paths = NULL;
+        media_index_close(c->list);
+        c->list = NULL;
         c->count = 0;
     }
     if (c->j)
@@ -552,13 +463,12 @@ lv_obj_t *photo_album_create(const char *dir, int canvas_w, int canvas_h, bool l
     c->ch = canvas_h;
     c->loop = loop;
 
-    if (build_jpg_list(dir, &c->paths, &c->count) != ESP_OK)
+    if (build_jpg_list(dir, &c->list, &c->count, &c->index) != ESP_OK)
     {
         ALBUM_LOG("build list fail: %s", dir);
         return NULL;
     }
 
-    c->index = 0;
     c->page = lv_obj_create(NULL);
     lv_obj_set_size(c->page, canvas_w, canvas_h);
     lv_obj_set_style_bg_opa(c->page, LV_OPA_COVER, 0);
@@ -569,7 +479,7 @@ lv_obj_t *photo_album_create(const char *dir, int canvas_w, int canvas_h, bool l
     lv_obj_add_event_cb(c->page, album_page_delete_cb, LV_EVENT_DELETE, NULL);
 
     // 首张
-    if (!load_jpg(c, c->paths[c->index]))
+    if (!load_jpg(c, media_index_path(c->list, c->index)))
     {
         ALBUM_LOG("first image load failed");
     }
@@ -603,10 +513,10 @@ void photo_album_destroy(void)
         c->decode_buf = NULL;
         c->decode_cap = 0;
     }
-    if (c->paths)
+    if (c->list)
     {
-        free_list(c->paths, c->count);
-        c->paths = NULL;
+        media_index_close(c->list);
+        c->list = NULL;
         c->count = 0;
     }
     if (c->j)
@@ -631,10 +541,10 @@ static void album_free_resources_only(void)
         c->decode_buf = NULL;
         c->decode_cap = 0;
     }
-    if (c->paths)
+    if (c->list)
     {
-        free_list(c->paths, c->count);
-        c->paths = NULL;
+        media_index_close(c->list);
+        c->list = NULL;
         c->count = 0;
     }
     if (c->j)
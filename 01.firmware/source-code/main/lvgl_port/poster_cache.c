@@ -0,0 +1,280 @@
+// poster_cache.c — AVI 海报帧提取 + SD 卡缩略图缓存
+// 后台任务：idx1 定位关键帧（不扫整个 movi）→ 缩小解码 → 黑边居中 → 写 /sdcard/.thumbs
+// 交付：UI 锁内按代号校验后拷进 canvas，网格删除时整体作废
+
+#include "poster_cache.h"
+#include "video_decoder.h"
+
+#include "esp_log.h"
+#include "esp_heap_caps.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/queue.h"
+
+#include <string.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <errno.h>
+#include <sys/stat.h>
+
+#include "esp_lvgl_port.h"
+
+static const char *TAG = "poster_cache";
+
+#define POSTER_MAGIC 0x52545350u      // 'PSTR'
+#define POSTER_FRAME_BUF_INIT (64 * 1024)
+#define POSTER_IO_BUF 4096
+
+typedef struct
+{
+    char *path;
+    lv_obj_t *canvas;
+    uint16_t w, h;
+    uint32_t key_index;
+    uint32_t gen;
+} poster_job_t;
+
+// 缓存文件头，后面紧跟 w*h 个 RGB565 像素
+typedef struct
+{
+    uint32_t magic;
+    uint16_t w, h;
+    uint32_t key_index;
+    uint32_t mtime;
+    uint32_t size;
+} poster_file_hdr_t;
+
+static QueueHandle_t s_queue = NULL;
+static volatile uint32_t s_gen = 0; // 仅 UI 线程修改
+
+// 以下仅后台任务访问
+static uint8_t *s_frame_buf = NULL;
+static size_t s_frame_cap = 0;
+
+// =====================================================
+// 缓存键：FNV-1a(路径, mtime, 大小, 尺寸, 关键帧)
+// =====================================================
+static uint32_t fnv1a(uint32_t h, const void *data, size_t len)
+{
+    const uint8_t *p = (const uint8_t *)data;
+    for (size_t i = 0; i < len; i++)
+    {
+        h ^= p[i];
+        h *= 16777619u;
+    }
+    return h;
+}
+
+static void cache_file_name(char *out, size_t cap, const poster_job_t *job, const poster_file_hdr_t *hdr)
+{
+    uint32_t h = 2166136261u;
+    h = fnv1a(h, job->path, strlen(job->path));
+    h = fnv1a(h, hdr, sizeof(*hdr));
+    snprintf(out, cap, POSTER_CACHE_DIR "/%08lx.565", (unsigned long)h);
+}
+
+static bool cache_load(const char *name, const poster_file_hdr_t *want, lv_color_t *pixels)
+{
+    FILE *fp = fopen(name, "rb");
+    if (!fp)
+        return false;
+
+    poster_file_hdr_t hdr;
+    size_t bytes = (size_t)want->w * want->h * sizeof(lv_color_t);
+    bool ok = fread(&hdr, 1, sizeof(hdr), fp) == sizeof(hdr) && memcmp(&hdr, want, sizeof(hdr)) == 0 &&
+              fread(pixels, 1, bytes, fp) == bytes;
+    fclose(fp);
+    return ok;
+}
+
+static void cache_store(const char *name, const poster_file_hdr_t *hdr, const lv_color_t *pixels)
+{
+    // 先写临时文件再改名，掉电/拔卡不会留下半张图
+    char tmp[64];
+    snprintf(tmp, sizeof(tmp), "%.*s.tmp", (int)(sizeof(tmp) - 5), name);
+    FILE *fp = fopen(tmp, "wb");
+    if (!fp)
+    {
+        ESP_LOGW(TAG, "cannot create %s", tmp);
+        return;
+    }
+    size_t bytes = (size_t)hdr->w * hdr->h * sizeof(lv_color_t);
+    bool ok = fwrite(hdr, 1, sizeof(*hdr), fp) == sizeof(*hdr) && fwrite(pixels, 1, bytes, fp) == bytes;
+    fclose(fp);
+    remove(name);
+    if (!ok || rename(tmp, name) != 0)
+    {
+        ESP_LOGW(TAG, "write %s failed", name);
+        remove(tmp);
+    }
+}
+
+// =====================================================
+// 提取：只读头部 + idx1 + 一帧
+// =====================================================
+static bool read_key_frame(const poster_job_t *job, size_t *len, video_frame_info_t *info)
+{
+    avi_stream_t stream;
+    if (avi_stream_open_file(job->path, POSTER_IO_BUF, &stream) != ESP_OK)
+        return false;
+
+    esp_err_t ret = ESP_ERR_NO_MEM;
+    for (int tries = 0; tries < 2 && ret == ESP_ERR_NO_MEM; tries++)
+    {
+        if (!s_frame_buf)
+        {
+            size_t cap = s_frame_cap ? s_frame_cap : POSTER_FRAME_BUF_INIT;
+            s_frame_buf = heap_caps_malloc(cap, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+            s_frame_cap = s_frame_buf ? cap : 0;
+            if (!s_frame_buf)
+                break;
+        }
+        *len = s_frame_cap;
+        ret = avi_player_read_key_frame(&stream, job->key_index, s_frame_buf, len, info);
+        if (ret == ESP_ERR_NO_MEM)
+        {
+            // 帧比缓冲大：按返回的大小重新分配再读一次
+            heap_caps_free(s_frame_buf);
+            s_frame_buf = NULL;
+            s_frame_cap = *len;
+        }
+    }
+    stream.close(stream.ctx);
+    return ret == ESP_OK;
+}
+
+// MJPEG / H.264 统一走 video_decoder：等比缩小、黑边居中到 w*h
+static bool decode_poster(const uint8_t *data, size_t len, const video_frame_info_t *info,
+                          lv_color_t *pixels, int w, int h)
+{
+    video_decoder_t *dec = video_decoder_create(info->frame_format, info->width, info->height);
+    if (!dec)
+        return false;
+    bool ok = video_decoder_feed(dec, data, len) == VIDEO_DEC_FRAME && video_decoder_output(dec, pixels, w, h);
+    video_decoder_destroy(dec);
+    return ok;
+}
+
+// =====================================================
+// 后台任务
+// =====================================================
+static bool make_poster(const poster_job_t *job, lv_color_t *pixels)
+{
+    struct stat st;
+    if (stat(job->path, &st) != 0)
+        return false;
+
+    poster_file_hdr_t hdr = {
+        .magic = POSTER_MAGIC,
+        .w = job->w,
+        .h = job->h,
+        .key_index = job->key_index,
+        .mtime = (uint32_t)st.st_mtime,
+        .size = (uint32_t)st.st_size,
+    };
+    char name[64];
+    cache_file_name(name, sizeof(name), job, &hdr);
+    if (cache_load(name, &hdr, pixels))
+        return true;
+
+    size_t len = 0;
+    video_frame_info_t info = {0};
+    if (!read_key_frame(job, &len, &info))
+    {
+        ESP_LOGW(TAG, "no key frame in %s", job->path);
+        return false;
+    }
+    if (!decode_poster(s_frame_buf, len, &info, pixels, job->w, job->h))
+    {
+        ESP_LOGW(TAG, "decode poster of %s failed", job->path);
+        return false;
+    }
+    cache_store(name, &hdr, pixels);
+    return true;
+}
+
+static void poster_task(void *arg)
+{
+    (void)arg;
+    if (mkdir(POSTER_CACHE_DIR, 0775) != 0 && errno != EEXIST)
+        ESP_LOGW(TAG, "mkdir %s failed (%d), cache disabled", POSTER_CACHE_DIR, errno);
+
+    lv_color_t *pixels = NULL;
+    size_t pixels_cap = 0;
+    poster_job_t job;
+
+    while (xQueueReceive(s_queue, &job, portMAX_DELAY) == pdTRUE)
+    {
+        size_t need = (size_t)job.w * job.h;
+        if (job.gen != s_gen)
+            goto next; // 网格已删除，跳过
+
+        if (need > pixels_cap)
+        {
+            heap_caps_free(pixels);
+            pixels = heap_caps_malloc(need * sizeof(lv_color_t), MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+            pixels_cap = pixels ? need : 0;
+            if (!pixels)
+                goto next;
+        }
+
+        if (!make_poster(&job, pixels))
+            goto next;
+
+        // 代号在 UI 锁内校验：作废同样在 UI 线程，拿到锁后 canvas 一定还活着（0 = 一直等）
+        if (lvgl_port_lock(0))
+        {
+            if (job.gen == s_gen)
+            {
+                lv_img_dsc_t *img = lv_canvas_get_img(job.canvas);
+                memcpy((void *)img->data, pixels, need * sizeof(lv_color_t));
+                lv_obj_invalidate(job.canvas);
+            }
+            lvgl_port_unlock();
+        }
+    next:
+        free(job.path);
+    }
+}
+
+// =====================================================
+// 对外接口（UI 线程）
+// =====================================================
+bool poster_cache_request(lv_obj_t *canvas, const char *avi_path, uint32_t key_index)
+{
+    if (!s_queue)
+    {
+        s_queue = xQueueCreate(POSTER_CACHE_QUEUE_LEN, sizeof(poster_job_t));
+        if (!s_queue)
+            return false;
+        if (xTaskCreatePinnedToCore(poster_task, "poster", 6 * 1024, NULL, 3, NULL, 1) != pdPASS)
+        {
+            vQueueDelete(s_queue);
+            s_queue = NULL;
+            return false;
+        }
+    }
+
+    lv_img_dsc_t *img = lv_canvas_get_img(canvas);
+    poster_job_t job = {
+        .path = strdup(avi_path),
+        .canvas = canvas,
+        .w = img->header.w,
+        .h = img->header.h,
+        .key_index = key_index,
+        .gen = s_gen,
+    };
+    if (!job.path)
+        return false;
+    if (xQueueSend(s_queue, &job, 0) != pdTRUE)
+    {
+        free(job.path);
+        return false;
+    }
+    return true;
+}
+
+void poster_cache_cancel_all(void)
+{
+    s_gen++;
+}
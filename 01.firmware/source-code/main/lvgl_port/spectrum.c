@@ -0,0 +1,302 @@
+// spectrum.c — 音乐频谱分析（定点实数 FFT）
+// 音频写入任务（Core 0）里运行：抽取 → 环形缓冲 → 每帧一次加窗 FFT → 分带 → 快照
+// 分析采样率约 22 kHz，512 点，每个 bin 约 43 Hz；30 fps 时每秒约 3 ms CPU
+
+#include "spectrum.h"
+
+#include "esp_timer.h"
+
+#include <math.h>
+#include <string.h>
+#include <stdatomic.h>
+
+#define FFT_M (SPECTRUM_FFT_N / 2)  // 实数 FFT 折成这么多点的复数 FFT
+#define FFT_MASK (SPECTRUM_FFT_N - 1)
+#define ANALYSIS_MAX_RATE 24000     // 抽取到不超过这个采样率
+#define BAR_LO_HZ 50.0f
+#define BAR_HI_HZ 16000.0f
+#define CPU_WINDOW_US (1000 * 1000)
+
+// 电平刻度：功率的 log2，Q4（每倍频程 16 级）
+#define RANGE_Q4 (20 * 16)   // 20 个功率倍频程 ≈ 60 dB，再往下是定点 FFT 的噪声
+#define FFT_REF_Q4 (26 * 16) // 0 dBFS 正弦落在一条里的功率（加窗、逐级缩放之后，实测）
+#define VU_REF_Q4 (30 * 16)  // 32767^2
+
+typedef struct
+{
+    int16_t re, im;
+} cpx16_t;
+
+static struct
+{
+    atomic_bool enabled;
+    bool tables_ready;
+
+    // 抽取
+    uint32_t rate;
+    uint32_t shift; // 抽取 1 << shift 倍（盒式平均，只做显示，混叠无所谓）
+    int32_t acc;
+    uint32_t acc_n;
+    int16_t ring[SPECTRUM_FFT_N];
+    uint32_t pos;
+    uint32_t since; // 上次分析后新来的抽取样本
+    uint32_t hop;   // 分析采样率 / SPECTRUM_FPS
+    uint16_t edge[SPECTRUM_BARS + 1];
+    int32_t peak[2];
+
+    // FFT 表和工作区
+    int16_t hann[SPECTRUM_FFT_N];
+    int16_t cos_t[FFT_M]; // cos(2πk/N)
+    int16_t sin_t[FFT_M]; // sin(2πk/N)
+    cpx16_t buf[FFT_M];
+
+    // 快照：seq 为奇数表示正在写
+    atomic_uint seq;
+    spectrum_snapshot_t snap;
+
+    // 统计
+    int64_t win_start, win_busy;
+    spectrum_stats_t stats;
+} s_sp;
+
+static void build_tables(void)
+{
+    for (int n = 0; n < SPECTRUM_FFT_N; n++)
+    {
+        s_sp.hann[n] = (int16_t)lrintf(32767.0f * (0.5f - 0.5f * cosf(2.0f * (float)M_PI * n / SPECTRUM_FFT_N)));
+    }
+    for (int k = 0; k < FFT_M; k++)
+    {
+        s_sp.cos_t[k] = (int16_t)lrintf(32767.0f * cosf(2.0f * (float)M_PI * k / SPECTRUM_FFT_N));
+        s_sp.sin_t[k] = (int16_t)lrintf(32767.0f * sinf(2.0f * (float)M_PI * k / SPECTRUM_FFT_N));
+    }
+    s_sp.tables_ready = true;
+}
+
+// 采样率变化时重新算抽取倍数和每条的 bin 范围
+static void set_rate(uint32_t rate)
+{
+    s_sp.rate = rate;
+    s_sp.shift = 0;
+    while ((rate >> s_sp.shift) > ANALYSIS_MAX_RATE)
+    {
+        s_sp.shift++;
+    }
+    uint32_t fs = rate >> s_sp.shift;
+    s_sp.hop = fs / SPECTRUM_FPS;
+    s_sp.acc = 0;
+    s_sp.acc_n = 0;
+    s_sp.since = 0;
+
+    float hi = 0.45f * fs < BAR_HI_HZ ? 0.45f * fs : BAR_HI_HZ;
+    float bin_hz = (float)fs / SPECTRUM_FFT_N;
+    uint16_t last = 0;
+    for (int b = 0; b <= SPECTRUM_BARS; b++)
+    {
+        float f = BAR_LO_HZ * powf(hi / BAR_LO_HZ, (float)b / SPECTRUM_BARS);
+        uint16_t e = (uint16_t)lrintf(f / bin_hz);
+        // 低频的条比一个 bin 还窄时，每条至少占一个 bin
+        if (b > 0 && e <= last)
+            e = last + 1;
+        if (e > FFT_M)
+            e = FFT_M;
+        s_sp.edge[b] = e;
+        last = e;
+    }
+}
+
+// 基 2 时间抽取，原地；每级右移一位，不会溢出
+static void fft_c16(cpx16_t *x)
+{
+    for (uint32_t i = 1, j = 0; i < FFT_M; i++)
+    {
+        uint32_t bit = FFT_M >> 1;
+        for (; j & bit; bit >>= 1)
+            j ^= bit;
+        j ^= bit;
+        if (i < j)
+        {
+            cpx16_t t = x[i];
+            x[i] = x[j];
+            x[j] = t;
+        }
+    }
+
+    for (uint32_t len = 2; len <= FFT_M; len <<= 1)
+    {
+        uint32_t half = len >> 1;
+        uint32_t tw = SPECTRUM_FFT_N / len; // W_len^k = W_N^(k * tw)
+        for (uint32_t i = 0; i < FFT_M; i += len)
+        {
+            for (uint32_t k = 0; k < half; k++)
+            {
+                int32_t c = s_sp.cos_t[k * tw];
+                int32_t s = s_sp.sin_t[k * tw];
+                cpx16_t *a = &x[i + k];
+                cpx16_t *b = &x[i + k + half];
+                int32_t tr = (b->re * c + b->im * s) >> 15;
+                int32_t ti = (b->im * c - b->re * s) >> 15;
+                int32_t ar = a->re, ai = a->im;
+                a->re = (int16_t)((ar + tr) >> 1);
+                a->im = (int16_t)((ai + ti) >> 1);
+                b->re = (int16_t)((ar - tr) >> 1);
+                b->im = (int16_t)((ai - ti) >> 1);
+            }
+        }
+    }
+}
+
+// 功率的 log2，Q4，尾数线性近似（误差 < 0.3 dB）
+static int32_t log2_q4(uint64_t p)
+{
+    if (!p)
+        return 0;
+    int msb = 63 - __builtin_clzll(p);
+    uint32_t frac = (msb >= 4) ? (uint32_t)(p >> (msb - 4)) : (uint32_t)(p << (4 - msb));
+    return msb * 16 + (frac & 15);
+}
+
+static uint8_t level(uint64_t power, int32_t ref_q4)
+{
+    int32_t l = (log2_q4(power) - (ref_q4 - RANGE_Q4)) * 255 / RANGE_Q4;
+    return (uint8_t)(l < 0 ? 0 : l > 255 ? 255 : l);
+}
+
+static void publish(const spectrum_snapshot_t *next)
+{
+    unsigned s = atomic_load_explicit(&s_sp.seq, memory_order_relaxed);
+    atomic_store_explicit(&s_sp.seq, s + 1, memory_order_relaxed);
+    atomic_thread_fence(memory_order_release);
+    memcpy(&s_sp.snap, next, sizeof(*next));
+    atomic_store_explicit(&s_sp.seq, s + 2, memory_order_release);
+}
+
+static void analyze(void)
+{
+    int64_t t0 = esp_timer_get_time();
+    spectrum_snapshot_t next;
+
+    // 最近 N 个样本加窗（再减半，给复数打包留余量），偶数点做实部、奇数点做虚部
+    for (uint32_t n = 0; n < FFT_M; n++)
+    {
+        uint32_t i = (s_sp.pos + 2 * n) & FFT_MASK;
+        s_sp.buf[n].re = (int16_t)((s_sp.ring[i] * s_sp.hann[2 * n]) >> 16);
+        s_sp.buf[n].im = (int16_t)((s_sp.ring[(i + 1) & FFT_MASK] * s_sp.hann[2 * n + 1]) >> 16);
+    }
+    fft_c16(s_sp.buf);
+
+    // 拆出实数序列的频谱：X[k] = E[k] + W^k·O[k]，按条累加功率
+    int b = 0;
+    uint64_t sum = 0;
+    for (uint32_t k = s_sp.edge[0]; k < s_sp.edge[SPECTRUM_BARS]; k++)
+    {
+        const cpx16_t z = s_sp.buf[k];
+        const cpx16_t m = s_sp.buf[(FFT_M - k) & (FFT_M - 1)];
+        int32_t er = (z.re + m.re) >> 1;
+        int32_t ei = (z.im - m.im) >> 1;
+        int32_t orr = (z.im + m.im) >> 1; // O = -j·(Z[k] - conj(Z[M-k])) / 2
+        int32_t oi = -((z.re - m.re) >> 1);
+        int32_t c = s_sp.cos_t[k], s = s_sp.sin_t[k];
+        int32_t xr = er + ((c * orr + s * oi) >> 15);
+        int32_t xi = ei + ((c * oi - s * orr) >> 15);
+        sum += (uint64_t)((int64_t)xr * xr) + (uint64_t)((int64_t)xi * xi);
+
+        if (k + 1 == s_sp.edge[b + 1])
+        {
+            next.bars[b] = level(sum, FFT_REF_Q4);
+            sum = 0;
+            // 后面几条可能从同一个 bin 开始（只在频率上限很低时）
+            while (++b < SPECTRUM_BARS && s_sp.edge[b + 1] <= k + 1)
+                next.bars[b] = next.bars[b - 1];
+        }
+    }
+    for (; b < SPECTRUM_BARS; b++)
+        next.bars[b] = 0;
+
+    for (int ch = 0; ch < 2; ch++)
+    {
+        next.vu[ch] = level((uint64_t)((int64_t)s_sp.peak[ch] * s_sp.peak[ch]), VU_REF_Q4);
+        s_sp.peak[ch] = 0;
+    }
+    next.seq = ++s_sp.stats.frames;
+    publish(&next);
+
+    s_sp.stats.fft_us = (uint32_t)(esp_timer_get_time() - t0);
+}
+
+void spectrum_set_enabled(bool on)
+{
+    if (on && !s_sp.tables_ready)
+        build_tables();
+    atomic_store(&s_sp.enabled, on);
+}
+
+void spectrum_feed(const int16_t *pcm, size_t frames, uint32_t sample_rate)
+{
+    if (!atomic_load_explicit(&s_sp.enabled, memory_order_relaxed) || !sample_rate)
+        return;
+
+    int64_t t0 = esp_timer_get_time();
+    if (sample_rate != s_sp.rate)
+        set_rate(sample_rate);
+
+    const uint32_t n = 1u << s_sp.shift;
+    int32_t pl = s_sp.peak[0], pr = s_sp.peak[1];
+    for (size_t k = 0; k < frames; k++)
+    {
+        int32_t l = pcm[2 * k], r = pcm[2 * k + 1];
+        int32_t al = l < 0 ? -l : l;
+        int32_t ar = r < 0 ? -r : r;
+        pl = al > pl ? al : pl;
+        pr = ar > pr ? ar : pr;
+
+        s_sp.acc += l + r;
+        if (++s_sp.acc_n < n)
+            continue;
+        s_sp.ring[s_sp.pos] = (int16_t)(s_sp.acc >> (s_sp.shift + 1));
+        s_sp.pos = (s_sp.pos + 1) & FFT_MASK;
+        s_sp.acc = 0;
+        s_sp.acc_n = 0;
+        if (++s_sp.since >= s_sp.hop)
+        {
+            s_sp.since = 0;
+            s_sp.peak[0] = pl;
+            s_sp.peak[1] = pr;
+            analyze();
+            pl = pr = 0;
+        }
+    }
+    s_sp.peak[0] = pl;
+    s_sp.peak[1] = pr;
+
+    // 占用率：与 lv_video 一样按 1s 窗口统计忙碌时间
+    int64_t t1 = esp_timer_get_time();
+    s_sp.win_busy += t1 - t0;
+    if (t1 - s_sp.win_start >= CPU_WINDOW_US)
+    {
+        if (s_sp.win_start)
+            s_sp.stats.cpu_permille = (uint16_t)(s_sp.win_busy * 1000 / (t1 - s_sp.win_start));
+        s_sp.win_start = t1;
+        s_sp.win_busy = 0;
+    }
+}
+
+bool spectrum_read(spectrum_snapshot_t *out)
+{
+    for (int tries = 0; tries < 4; tries++)
+    {
+        unsigned s0 = atomic_load_explicit(&s_sp.seq, memory_order_acquire);
+        if (s0 & 1)
+            continue;
+        memcpy(out, &s_sp.snap, sizeof(*out));
+        atomic_thread_fence(memory_order_acquire);
+        if (atomic_load_explicit(&s_sp.seq, memory_order_relaxed) == s0)
+            return true;
+    }
+    return false;
+}
+
+void spectrum_get_stats(spectrum_stats_t *out)
+{
+    *out = s_sp.stats;
+}
@@ -12,6 +12,8 @@
 
 #include "esp_lcd_st7703.h"
 #include "esp_lcd_touch_gt911.h"
+#include "driver/i2s_std.h"
+#include "esp_codec_dev_defaults.h"
 
 #include "bsp.h"
 
@@ -84,6 +86,9 @@ static esp_lcd_touch_handle_t touch_handle = NULL;
 static lv_display_t *lvgl_disp = NULL;
 static lv_indev_t *lvgl_touch_indev = NULL;
 
+/* Audio output, used by lvgl_port/audio_player.c */
+i2s_chan_handle_t i2s_tx_handle = NULL;
+
 static void list_sdcard_dir(const char *path)
 {
     DIR *dir = opendir(path);
@@ -152,6 +157,10 @@ static esp_err_t app_lcd_init(void)
 
     // 创建ST7703控制面板
     esp_lcd_dpi_panel_config_t dpi_config = ST7703_720_720_PANEL_60HZ_DPI_CONFIG(MIPI_DPI_PX_FORMAT);
+#if CONFIG_BSP_DISPLAY_LVGL_AVOID_TEAR
+    // LVGL 直接绘制到两个帧缓冲，垂直同步时切换
+    dpi_config.num_fbs = 2;
+#endif
 
     st7703_vendor_config_t vendor_config = {
         .mipi_config = {
@@ -197,11 +206,23 @@ static esp_err_t app_touch_init(void)
     ESP_RETURN_ON_ERROR(i2c_driver_install(EXAMPLE_TOUCH_I2C_NUM, i2c_conf.mode, 0, 0, 0), TAG, "I2C initialization failed");
 
     /* Initialize touch HW */
+    const esp_lcd_panel_io_i2c_config_t tp_io_config = ESP_LCD_TOUCH_IO_I2C_GT911_CONFIG();
+    esp_lcd_touch_io_gt911_config_t tp_gt911_config = {
+        .dev_addr = tp_io_config.dev_addr,
+        .report_period_ms = CONFIG_BSP_TOUCH_GT911_REPORT_PERIOD_MS,
+        .flags = {
+#if CONFIG_BSP_TOUCH_GT911_BURST_READ
+            .burst_read = 1,
+#else
+            .burst_read = 0,
+#endif
+        },
+    };
     const esp_lcd_touch_config_t tp_cfg = {
         .x_max = EXAMPLE_LCD_H_RES,
         .y_max = EXAMPLE_LCD_V_RES,
         .rst_gpio_num = GPIO_NUM_NC,
-        .int_gpio_num = GPIO_NUM_NC,
+        .int_gpio_num = CONFIG_BSP_TOUCH_INT_GPIO,
         .levels = {
             .reset = 0,
             .interrupt = 0,
@@ -211,13 +232,92 @@ static esp_err_t app_touch_init(void)
             .mirror_x = 0,
             .mirror_y = 0,
         },
+        .driver_data = &tp_gt911_config,
     };
     esp_lcd_panel_io_handle_t tp_io_handle = NULL;
-    const esp_lcd_panel_io_i2c_config_t tp_io_config = ESP_LCD_TOUCH_IO_I2C_GT911_CONFIG();
     ESP_RETURN_ON_ERROR(esp_lcd_new_panel_io_i2c((esp_lcd_i2c_bus_handle_t)EXAMPLE_TOUCH_I2C_NUM, &tp_io_config, &tp_io_handle), TAG, "");
     return esp_lcd_touch_new_i2c_gt911(tp_io_handle, &tp_cfg, &touch_handle);
 }
 
+#if CONFIG_BSP_AUDIO_ENABLE
+static esp_err_t app_audio_init(void)
+{
+    esp_err_t ret = ESP_OK;
+    const audio_codec_ctrl_if_t *ctrl_if = NULL;
+    const audio_codec_if_t *codec_if = NULL;
+
+    /* I2S TX, one DMA buffer per mixer block, silence on underrun */
+    i2s_chan_config_t chan_cfg = I2S_CHANNEL_DEFAULT_CONFIG(BSP_I2S_NUM, I2S_ROLE_MASTER);
+    chan_cfg.dma_frame_num = CONFIG_AUDIO_PLAYER_MIXER_BLOCK_FRAMES;
+    chan_cfg.auto_clear = true;
+    ESP_RETURN_ON_ERROR(i2s_new_channel(&chan_cfg, &i2s_tx_handle, NULL), TAG, "I2S channel creation failed");
+
+    const i2s_std_config_t std_cfg = {
+        .clk_cfg = I2S_STD_CLK_DEFAULT_CONFIG(BSP_AUDIO_SAMPLE_RATE),
+        .slot_cfg = I2S_STD_PHILIPS_SLOT_DEFAULT_CONFIG(I2S_DATA_BIT_WIDTH_16BIT, I2S_SLOT_MODE_STEREO),
+        .gpio_cfg = {
+            .mclk = (gpio_num_t)BSP_I2S_MCLK,
+            .bclk = (gpio_num_t)BSP_I2S_SCLK,
+            .ws = (gpio_num_t)BSP_I2S_LRCK,
+            .dout = (gpio_num_t)BSP_I2S_DOUT,
+            .din = GPIO_NUM_NC,
+        },
+    };
+    ESP_GOTO_ON_ERROR(i2s_channel_init_std_mode(i2s_tx_handle, &std_cfg), err, TAG, "I2S STD mode initialization failed");
+
+    /* Codec runs from MCLK, start the channel before it */
+    ESP_GOTO_ON_ERROR(i2s_channel_enable(i2s_tx_handle), err, TAG, "I2S enable failed");
+
+    /* Codec on the touch I2C bus (installed by app_touch_init) */
+    audio_codec_i2c_cfg_t i2c_cfg = {
+        .port = EXAMPLE_TOUCH_I2C_NUM,
+        .addr = ES8311_CODEC_DEFAULT_ADDR,
+    };
+    ctrl_if = audio_codec_new_i2c_ctrl(&i2c_cfg);
+    ESP_GOTO_ON_FALSE(ctrl_if, ESP_FAIL, err, TAG, "Codec I2C control creation failed");
+
+    es8311_codec_cfg_t es8311_cfg = {
+        .ctrl_if = ctrl_if,
+        .gpio_if = audio_codec_new_gpio(),
+        .codec_mode = ESP_CODEC_DEV_WORK_MODE_DAC,
+        .pa_pin = BSP_POWER_AMP_IO,
+        .pa_reverted = false,
+        .master_mode = false,
+        .use_mclk = (BSP_I2S_MCLK >= 0),
+        .hw_gain = {
+            .pa_voltage = 5.0,
+            .codec_dac_voltage = 3.3,
+        },
+    };
+    codec_if = es8311_codec_new(&es8311_cfg);
+    ESP_GOTO_ON_FALSE(codec_if, ESP_FAIL, err, TAG, "ES8311 initialization failed");
+
+    /* Volume is set by the software DSP, the codec stays at 0 dB */
+    esp_codec_dev_sample_info_t fs = {
+        .bits_per_sample = 16,
+        .channel = 2,
+        .sample_rate = BSP_AUDIO_SAMPLE_RATE,
+    };
+    ESP_GOTO_ON_FALSE(codec_if->set_fs(codec_if, &fs) == ESP_CODEC_DEV_OK, ESP_FAIL, err, TAG, "Codec format failed");
+    ESP_GOTO_ON_FALSE(codec_if->set_vol(codec_if, 0) == ESP_CODEC_DEV_OK, ESP_FAIL, err, TAG, "Codec volume failed");
+    ESP_GOTO_ON_FALSE(codec_if->enable(codec_if, true) == ESP_CODEC_DEV_OK, ESP_FAIL, err, TAG, "Codec enable failed");
+    return ESP_OK;
+
+err:
+    /* Without a channel audio_out_init() fails and the pages stay silent */
+    if (codec_if) {
+        audio_codec_delete_codec_if(codec_if);
+    }
+    if (ctrl_if) {
+        audio_codec_delete_ctrl_if(ctrl_if);
+    }
+    i2s_channel_disable(i2s_tx_handle);
+    i2s_del_channel(i2s_tx_handle);
+    i2s_tx_handle = NULL;
+    return ret;
+}
+#endif // CONFIG_BSP_AUDIO_ENABLE
+
 static esp_err_t app_lvgl_init(void)
 {
     /* Initialize LVGL */
@@ -243,8 +343,11 @@ static esp_err_t app_lvgl_init(void)
             .buff_dma = false,
             .buff_spiram = true,
             .sw_rotate = false,
-            .full_refresh = false,
-            .direct_mode = false,
+#if CONFIG_BSP_DISPLAY_LVGL_FULL_REFRESH
+            .full_refresh = true,
+#elif CONFIG_BSP_DISPLAY_LVGL_DIRECT_MODE
+            .direct_mode = true,
+#endif
         }};
 
     const lvgl_port_display_dsi_cfg_t dpi_cfg = {
@@ -262,6 +365,13 @@ static esp_err_t app_lvgl_init(void)
     const lvgl_port_touch_cfg_t touch_cfg = {
         .disp = lvgl_disp,
         .handle = touch_handle,
+#if CONFIG_BSP_TOUCH_TASK
+        /* Touch is read over I2C by own task, LVGL gets timestamped samples from queue */
+        .task = {
+            .task_priority = CONFIG_BSP_TOUCH_TASK_PRIORITY,
+            .period_ms = CONFIG_BSP_TOUCH_TASK_PERIOD_MS,
+        },
+#endif
     };
     lvgl_touch_indev = lvgl_port_add_touch(&touch_cfg);
 
@@ -281,7 +391,8 @@ void app_main(void)
 #else
         .format_if_mount_failed = false,
 #endif // EXAMPLE_FORMAT_IF_MOUNT_FAILED
-        .max_files = 5,
+        // One AVI per video grid tile (up to 9), plus poster cache, photos, music and playlist scan
+        .max_files = 16,
         .allocation_unit_size = 16 * 1024};
     sdmmc_card_t *card;
     const char mount_point[] = MOUNT_POINT;
@@ -381,6 +492,15 @@ void app_main(void)
     /* Touch initialization */
     ESP_ERROR_CHECK(app_touch_init());
 
+    /* Audio initialization, the UI works without sound */
+#if CONFIG_BSP_AUDIO_ENABLE
+    if (app_audio_init() != ESP_OK) {
+        ESP_LOGW(TAG, "Audio output not available");
+    }
+#else
+    ESP_LOGI(TAG, "Audio output disabled (CONFIG_BSP_AUDIO_ENABLE)");
+#endif
+
     /* LVGL initialization */
     ESP_ERROR_CHECK(app_lvgl_init());
 
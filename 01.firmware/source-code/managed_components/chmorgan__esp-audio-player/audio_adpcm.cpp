@@ -0,0 +1,269 @@
+/**
+ * @file
+ * @version 0.1
+ *
+ * @copyright Copyright 2021 Espressif Systems (Shanghai) Co. Ltd.
+ * @copyright Copyright 2022 Chris Morgan <chmorgan@gmail.com>
+ *
+ *      Licensed under the Apache License, Version 2.0 (the "License");
+ *      you may not use this file except in compliance with the License.
+ *      You may obtain a copy of the License at
+ *
+ *               http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *      Unless required by applicable law or agreed to in writing, software
+ *      distributed under the License is distributed on an "AS IS" BASIS,
+ *      WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *      See the License for the specific language governing permissions and
+ *      limitations under the License.
+ */
+
+#include "audio_adpcm.h"
+
+#define IMA_STEPS       89
+#define MS_COEFS        7
+
+static inline int32_t clamp16(int32_t v)
+{
+    return (v > INT16_MAX) ? INT16_MAX : (v < INT16_MIN) ? INT16_MIN : v;
+}
+
+static inline int16_t load_s16(const uint8_t *p)
+{
+    return (int16_t)(p[0] | (p[1] << 8));
+}
+
+/* **************** IMA **************** */
+
+constexpr int16_t ima_steps[IMA_STEPS] = {
+    7, 8, 9, 10, 11, 12, 13, 14, 16, 17, 19, 21, 23, 25, 28, 31, 34, 37, 41, 45,
+    50, 55, 60, 66, 73, 80, 88, 97, 107, 118, 130, 143, 157, 173, 190, 209, 230, 253, 279, 307,
+    337, 371, 408, 449, 494, 544, 598, 658, 724, 796, 876, 963, 1060, 1166, 1282, 1411, 1552, 1707, 1878, 2066,
+    2272, 2499, 2749, 3024, 3327, 3660, 4026, 4428, 4871, 5358, 5894, 6484, 7132, 7845, 8630, 9493, 10442, 11487, 12635, 13899,
+    15289, 16818, 18500, 20350, 22385, 24623, 27086, 29794, 32767,
+};
+
+constexpr int8_t ima_index_adjust[8] = { -1, -1, -1, -1, 2, 4, 6, 8 };
+
+/**
+ * Difference and next step index for every step index and nibble magnitude,
+ * the difference summed from step / 8, step / 4, step / 2 and step exactly as
+ * the reference decoder does it bit by bit
+ */
+struct ima_table {
+    uint16_t diff[IMA_STEPS][8];
+    uint8_t next[IMA_STEPS][8];
+
+    constexpr ima_table() : diff{}, next{}
+    {
+        for(int i = 0; i < IMA_STEPS; i++) {
+            int step = ima_steps[i];
+            for(int m = 0; m < 8; m++) {
+                int d = step >> 3;
+                if(m & 4) {
+                    d += step;
+                }
+                if(m & 2) {
+                    d += step >> 1;
+                }
+                if(m & 1) {
+                    d += step >> 2;
+                }
+                diff[i][m] = (uint16_t)d;
+                int n = i + ima_index_adjust[m];
+                next[i][m] = (uint8_t)((n < 0) ? 0 : (n >= IMA_STEPS) ? IMA_STEPS - 1 : n);
+            }
+        }
+    }
+};
+
+constexpr ima_table ima;
+
+typedef struct {
+    int32_t pred;
+    uint32_t index;
+} ima_channel_t;
+
+static inline int16_t ima_nibble(ima_channel_t &c, uint32_t nib)
+{
+    int32_t diff = ima.diff[c.index][nib & 7];
+    int32_t sign = -(int32_t)(nib >> 3);
+    c.pred = clamp16(c.pred + ((diff ^ sign) - sign));
+    c.index = ima.next[c.index][nib & 7];
+    return (int16_t)c.pred;
+}
+
+/**
+ * Header of 4 bytes per channel (first sample, step index, reserved), then
+ * groups of 4 bytes per channel in turn, 8 samples each, low nibble first
+ */
+static void ima_decode(const audio_adpcm_format_t *fmt, int16_t *dst, const uint8_t *block, size_t frames)
+{
+    const size_t ch = fmt->channels;
+    ima_channel_t c[AUDIO_ADPCM_MAX_CHANNELS];
+    for(size_t k = 0; k < ch; k++) {
+        c[k].pred = load_s16(block + 4 * k);
+        c[k].index = (block[4 * k + 2] < IMA_STEPS) ? block[4 * k + 2] : IMA_STEPS - 1;
+        dst[k] = (int16_t)c[k].pred;
+    }
+
+    const uint8_t *p = block + 4 * ch;
+    for(size_t f = 1; f < frames; f += 8, p += 4 * ch) {
+        size_t n = (frames - f < 8) ? frames - f : 8;
+        for(size_t k = 0; k < ch; k++) {
+            const uint8_t *q = p + 4 * k;
+            int16_t *out = dst + f * ch + k;
+            if(n == 8) {
+                for(size_t j = 0; j < 4; j++) {
+                    out[2 * j * ch] = ima_nibble(c[k], q[j] & 0x0f);
+                    out[(2 * j + 1) * ch] = ima_nibble(c[k], q[j] >> 4);
+                }
+            } else {
+                for(size_t j = 0; j < n; j++) {
+                    out[j * ch] = ima_nibble(c[k], (q[j >> 1] >> ((j & 1) * 4)) & 0x0f);
+                }
+            }
+        }
+    }
+}
+
+/* **************** MICROSOFT **************** */
+
+static const int16_t ms_coef[MS_COEFS][2] = {
+    { 256, 0 }, { 512, -256 }, { 0, 0 }, { 192, 64 }, { 240, 0 }, { 460, -208 }, { 392, -232 },
+};
+
+static const int16_t ms_adapt[16] = {
+    230, 230, 230, 230, 307, 409, 512, 614, 768, 614, 512, 409, 307, 230, 230, 230,
+};
+
+/** Beyond this the step would overflow on the next adaptation, only reached by broken files */
+#define MS_DELTA_MAX    (INT32_MAX / 768)
+
+typedef struct {
+    int32_t c1, c2;
+    int32_t delta;
+    int32_t s1, s2;
+} ms_channel_t;
+
+static inline int16_t ms_nibble(ms_channel_t &c, uint32_t nib)
+{
+    int32_t pred = (c.s1 * c.c1 + c.s2 * c.c2) / 256;
+    int32_t s = clamp16(pred + ((int32_t)(nib << 28) >> 28) * c.delta);
+    int32_t d = (ms_adapt[nib] * c.delta) >> 8;
+    c.delta = (d < 16) ? 16 : (d > MS_DELTA_MAX) ? MS_DELTA_MAX : d;
+    c.s2 = c.s1;
+    c.s1 = s;
+    return (int16_t)s;
+}
+
+/**
+ * Header of the predictor indices, initial steps, second and first samples,
+ * each for all channels in turn, then one nibble per sample, high nibble
+ * first, channels alternating
+ */
+static void ms_decode(const audio_adpcm_format_t *fmt, int16_t *dst, const uint8_t *block, size_t frames)
+{
+    const size_t ch = fmt->channels;
+    ms_channel_t c[AUDIO_ADPCM_MAX_CHANNELS];
+    for(size_t k = 0; k < ch; k++) {
+        const int16_t *coef = ms_coef[(block[k] < MS_COEFS) ? block[k] : 0];
+        c[k].c1 = coef[0];
+        c[k].c2 = coef[1];
+        c[k].delta = load_s16(block + ch + 2 * k);
+        c[k].s1 = load_s16(block + 3 * ch + 2 * k);
+        c[k].s2 = load_s16(block + 5 * ch + 2 * k);
+        dst[k] = (int16_t)c[k].s2;
+        dst[ch + k] = (int16_t)c[k].s1;
+    }
+
+    // mono takes both nibbles of a byte, stereo the high one for left
+    ms_channel_t &hi = c[0];
+    ms_channel_t &lo = c[ch - 1];
+    const uint8_t *p = block + 7 * ch;
+    int16_t *out = dst + 2 * ch;
+    const size_t n = (frames - 2) * ch;
+    for(size_t j = 0; j + 1 < n; j += 2, p++) {
+        out[j] = ms_nibble(hi, *p >> 4);
+        out[j + 1] = ms_nibble(lo, *p & 0x0f);
+    }
+    if(n & 1) {
+        out[n - 1] = ms_nibble(hi, *p >> 4);
+    }
+}
+
+/* **************** BLOCKS **************** */
+
+static size_t header_bytes(audio_adpcm_codec_t codec, size_t channels)
+{
+    return ((codec == AUDIO_ADPCM_IMA) ? 4 : 7) * channels;
+}
+
+/** Frames that fit into 'bytes', whole groups of 8 for IMA */
+static size_t frames_in(audio_adpcm_codec_t codec, size_t channels, size_t bytes)
+{
+    size_t header = header_bytes(codec, channels);
+    if(bytes < header) {
+        return 0;
+    }
+    if(codec == AUDIO_ADPCM_IMA) {
+        return 1 + (bytes - header) / (4 * channels) * 8;
+    }
+    return 2 + (bytes - header) * 2 / channels;
+}
+
+bool audio_adpcm_format_from_wav(uint16_t format_tag, uint16_t channels, uint16_t block_align,
+                                 uint16_t bits_per_sample, uint16_t samples_per_block,
+                                 audio_adpcm_format_t *fmt)
+{
+    audio_adpcm_codec_t codec;
+    if(format_tag == 0x11) {
+        codec = AUDIO_ADPCM_IMA;
+    } else if(format_tag == 0x02) {
+        codec = AUDIO_ADPCM_MS;
+    } else {
+        return false;
+    }
+    if((bits_per_sample != 4) || (channels < 1) || (channels > AUDIO_ADPCM_MAX_CHANNELS)) {
+        return false;
+    }
+
+    size_t frames = frames_in(codec, channels, block_align);
+    if((frames == 0) || (frames > UINT16_MAX)) {
+        return false;
+    }
+    // at least the samples held in the header
+    if((samples_per_block >= ((codec == AUDIO_ADPCM_IMA) ? 1 : 2)) && (samples_per_block < frames)) {
+        frames = samples_per_block;
+    }
+
+    fmt->codec = codec;
+    fmt->channels = channels;
+    fmt->block_align = block_align;
+    fmt->samples_per_block = (uint16_t)frames;
+    return true;
+}
+
+size_t audio_adpcm_block_frames(const audio_adpcm_format_t *fmt, size_t bytes)
+{
+    if(bytes > fmt->block_align) {
+        bytes = fmt->block_align;
+    }
+    size_t frames = frames_in(fmt->codec, fmt->channels, bytes);
+    return (frames < fmt->samples_per_block) ? frames : fmt->samples_per_block;
+}
+
+size_t audio_adpcm_decode_block(const audio_adpcm_format_t *fmt, int16_t *dst, const uint8_t *block,
+                                size_t bytes)
+{
+    size_t frames = audio_adpcm_block_frames(fmt, bytes);
+    if(frames == 0) {
+        return 0;
+    }
+    if(fmt->codec == AUDIO_ADPCM_IMA) {
+        ima_decode(fmt, dst, block, frames);
+    } else {
+        ms_decode(fmt, dst, block, frames);
+    }
+    return frames;
+}
@@ -0,0 +1,579 @@
+/**
+ * @file
+ * @version 0.1
+ *
+ * @copyright Copyright 2021 Espressif Systems (Shanghai) Co. Ltd.
+ * @copyright Copyright 2022 Chris Morgan <chmorgan@gmail.com>
+ *
+ *      Licensed under the Apache License, Version 2.0 (the "License");
+ *      you may not use this file except in compliance with the License.
+ *      You may obtain a copy of the License at
+ *
+ *               http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *      Unless required by applicable law or agreed to in writing, software
+ *      distributed under the License is distributed on an "AS IS" BASIS,
+ *      WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *      See the License for the specific language governing permissions and
+ *      limitations under the License.
+ */
+
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+#include <atomic>
+#include <mutex>
+#include <new>
+
+#if defined(ESP_PLATFORM)
+#include "esp_cpu.h"
+#elif defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#else
+#include <time.h>
+#endif
+
+#include "audio_dsp.h"
+
+#define DSP_DEFAULT_RATE        44100
+#define DSP_MAX_RATE            48000   /**< the look-ahead delay is sized for this, higher rates get less */
+#define GUARD_BITS              8       /**< work samples are 16 bit << GUARD_BITS, headroom for EQ boosts */
+#define WORK_MAX                (1 << 30)
+#define COEF_BITS               28      /**< biquad coefficients, Q3.28 */
+#define VOL_SHIFT               15      /**< vol_acc is the Q15 volume << VOL_SHIFT */
+#define LIM_BITS                30      /**< limiter gain, Q30 */
+#define LIM_UNITY               (1 << LIM_BITS)
+#define ZC_TIMEOUT_US           20000   /**< down to 25 Hz crosses zero within this */
+#define ZC_QUIET                (4 << GUARD_BITS)   /**< this close to zero counts as a crossing */
+
+#define CHANGED_RATE            (1 << 0)
+#define CHANGED_EQ              (1 << 1)
+#define CHANGED_VOLUME          (1 << 2)
+#define CHANGED_RESET           (1 << 3)
+
+typedef struct {
+    int32_t b0, b1, b2, a1, a2;     /**< normalized to a0 = 1 */
+} biquad_coef_t;
+
+typedef struct {
+    int32_t x1, x2, y1, y2;
+    int32_t err;                    /**< fraction dropped from the last output, fed back into the next */
+} biquad_state_t;
+
+struct audio_dsp {
+    /* processing side */
+    uint32_t sample_rate;
+    int32_t *work;                          /**< AUDIO_DSP_BLOCK_FRAMES stereo frames */
+
+    uint8_t active;                         /**< biquads that are not flat */
+    biquad_coef_t coef[AUDIO_DSP_MAX_BANDS];
+    uint8_t slot[AUDIO_DSP_MAX_BANDS];      /**< band of coef[k], states stay with their band */
+    biquad_state_t state[AUDIO_DSP_MAX_BANDS][2];
+
+    int32_t vol_acc;
+    int32_t vol_step;                       /**< per frame while ramping */
+    uint32_t vol_frames;                    /**< left in the ramp */
+    uint16_t vol_target;
+    int32_t vol_gain[2];                    /**< Q15 applied to each channel */
+    int32_t vol_prev[2];                    /**< last sample, for finding crossings */
+    uint32_t vol_wait[2];                   /**< frames the channel has waited for a crossing */
+    uint32_t zc_timeout;
+
+    int32_t ceiling;                        /**< in work units */
+    uint32_t look;                          /**< look-ahead frames */
+    uint32_t look_cap;
+    int32_t *delay;                         /**< look frames, a ring at delay_pos */
+    uint32_t delay_pos;
+    int32_t *peak_val;                      /**< window maxima, decreasing from the front */
+    uint32_t *peak_at;
+    uint32_t peak_head;
+    uint32_t peaks;
+    uint32_t now;                           /**< frame counter */
+    int32_t last_peak;
+    int32_t last_target;
+    int32_t lim_gain;                       /**< Q30 */
+    int32_t lim_floor;                      /**< target of the present attack */
+    int32_t lim_step;
+    int32_t release;                        /**< Q30 one-pole coefficient */
+
+    audio_dsp_stats_t stats;
+
+    /* setter side, under lock */
+    std::mutex lock;
+    std::atomic<uint32_t> dirty;
+    audio_dsp_config_t config;
+    uint32_t ramp_ms;
+    audio_dsp_stats_t shown;                /**< stats as of the end of a process call */
+};
+
+static inline uint32_t dsp_cycles(void)
+{
+#if defined(ESP_PLATFORM)
+    return esp_cpu_get_cycle_count();
+#elif defined(__x86_64__) || defined(__i386__)
+    return (uint32_t)__rdtsc();
+#else
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint32_t)(ts.tv_sec * 1000000000ull + ts.tv_nsec);
+#endif
+}
+
+static inline int16_t sat16(int32_t v)
+{
+    return (v > INT16_MAX) ? INT16_MAX : (v < INT16_MIN) ? INT16_MIN : (int16_t)v;
+}
+
+static inline int32_t clamp_work(int64_t v)
+{
+    return (v > WORK_MAX) ? WORK_MAX : (v < -WORK_MAX) ? -WORK_MAX : (int32_t)v;
+}
+
+/* **************** EQUALIZER **************** */
+
+/**
+ * RBJ audio EQ cookbook coefficients, in double since this runs only when a
+ * band or the rate changes.
+ *
+ * @return false when the band is flat
+ */
+static bool eq_design(const audio_dsp_eq_band_t *band, uint32_t rate, biquad_coef_t *coef)
+{
+    double gain = band->gain_db;
+    if(gain > AUDIO_DSP_EQ_MAX_DB) {
+        gain = AUDIO_DSP_EQ_MAX_DB;
+    } else if(gain < -AUDIO_DSP_EQ_MAX_DB) {
+        gain = -AUDIO_DSP_EQ_MAX_DB;
+    }
+    if(fabs(gain) < 0.01) {
+        return false;
+    }
+    double freq = band->freq;
+    if(freq < 10) {
+        freq = 10;
+    } else if(freq > 0.45 * rate) {
+        freq = 0.45 * rate;
+    }
+    double q = (band->q > 0) ? band->q : 0.707;
+    if(q < 0.1) {
+        q = 0.1;
+    } else if(q > 20) {
+        q = 20;
+    }
+
+    const double a = pow(10, gain / 40);
+    const double w0 = 2 * M_PI * freq / rate;
+    const double cs = cos(w0);
+    const double alpha = sin(w0) / (2 * q);
+    const double sa = 2 * sqrt(a) * alpha;
+    double b0, b1, b2, a0, a1, a2;
+    switch(band->type) {
+    case AUDIO_DSP_EQ_LOW_SHELF:
+        b0 = a * ((a + 1) - (a - 1) * cs + sa);
+        b1 = 2 * a * ((a - 1) - (a + 1) * cs);
+        b2 = a * ((a + 1) - (a - 1) * cs - sa);
+        a0 = (a + 1) + (a - 1) * cs + sa;
+        a1 = -2 * ((a - 1) + (a + 1) * cs);
+        a2 = (a + 1) + (a - 1) * cs - sa;
+        break;
+    case AUDIO_DSP_EQ_HIGH_SHELF:
+        b0 = a * ((a + 1) + (a - 1) * cs + sa);
+        b1 = -2 * a * ((a - 1) + (a + 1) * cs);
+        b2 = a * ((a + 1) + (a - 1) * cs - sa);
+        a0 = (a + 1) - (a - 1) * cs + sa;
+        a1 = 2 * ((a - 1) - (a + 1) * cs);
+        a2 = (a + 1) - (a - 1) * cs - sa;
+        break;
+    case AUDIO_DSP_EQ_PEAK:
+    default:
+        b0 = 1 + alpha * a;
+        b1 = -2 * cs;
+        b2 = 1 - alpha * a;
+        a0 = 1 + alpha / a;
+        a1 = -2 * cs;
+        a2 = 1 - alpha / a;
+        break;
+    }
+
+    // at +-AUDIO_DSP_EQ_MAX_DB every coefficient is well inside Q3.28
+    const double scale = (double)(1 << COEF_BITS) / a0;
+    coef->b0 = (int32_t)lround(b0 * scale);
+    coef->b1 = (int32_t)lround(b1 * scale);
+    coef->b2 = (int32_t)lround(b2 * scale);
+    coef->a1 = (int32_t)lround(a1 * scale);
+    coef->a2 = (int32_t)lround(a2 * scale);
+    return true;
+}
+
+/** Pick up the bands of config, under the lock */
+static void eq_update(audio_dsp *d)
+{
+    d->active = 0;
+    for(uint8_t b = 0; b < d->config.bands; b++) {
+        if(eq_design(&d->config.band[b], d->sample_rate, &d->coef[d->active])) {
+            d->slot[d->active++] = b;
+        } else {
+            // a band that comes back starts from silence rather than from a stale state
+            memset(d->state[b], 0, sizeof(d->state[b]));
+        }
+    }
+}
+
+/** Direct form I, the fraction of the previous output saved and added back (first order error feedback) */
+static inline int32_t biquad(const biquad_coef_t *c, biquad_state_t *s, int32_t x)
+{
+    int64_t acc = (int64_t)c->b0 * x + (int64_t)c->b1 * s->x1 + (int64_t)c->b2 * s->x2
+                - (int64_t)c->a1 * s->y1 - (int64_t)c->a2 * s->y2 + s->err;
+    int32_t y = clamp_work(acc >> COEF_BITS);
+    s->err = (int32_t)(acc & ((1 << COEF_BITS) - 1));
+    s->x2 = s->x1;
+    s->x1 = x;
+    s->y2 = s->y1;
+    s->y1 = y;
+    return y;
+}
+
+/** Reads the caller's frames into the work block, every band in turn on each frame */
+static void eq_run(audio_dsp *d, const int16_t *__restrict in, int32_t *__restrict out, size_t frames)
+{
+    const int bands = d->active;
+    if(!bands) {
+        for(size_t k = 0; k < 2 * frames; k++) {
+            out[k] = (int32_t)in[k] << GUARD_BITS;
+        }
+        return;
+    }
+
+    for(size_t k = 0; k < frames; k++) {
+        int32_t l = (int32_t)in[2 * k] << GUARD_BITS;
+        int32_t r = (int32_t)in[2 * k + 1] << GUARD_BITS;
+        for(int b = 0; b < bands; b++) {
+            biquad_state_t *st = d->state[d->slot[b]];
+            l = biquad(&d->coef[b], &st[0], l);
+            r = biquad(&d->coef[b], &st[1], r);
+        }
+        out[2 * k] = l;
+        out[2 * k + 1] = r;
+    }
+}
+
+/* **************** VOLUME **************** */
+
+static void volume_ramp(audio_dsp *d, uint16_t target, uint32_t ramp_ms)
+{
+    d->vol_target = target;
+    d->vol_frames = (uint32_t)((uint64_t)ramp_ms * d->sample_rate / 1000);
+    if(d->vol_frames) {
+        d->vol_step = (((int32_t)target << VOL_SHIFT) - d->vol_acc) / (int32_t)d->vol_frames;
+    } else {
+        d->vol_acc = (int32_t)target << VOL_SHIFT;
+    }
+}
+
+static void volume_run(audio_dsp *d, int32_t *w, size_t frames)
+{
+    const int32_t target = d->vol_target;
+    if(!d->vol_frames && (d->vol_gain[0] == target) && (d->vol_gain[1] == target)) {
+        if(target != AUDIO_DSP_VOLUME_UNITY) {
+            for(size_t k = 0; k < 2 * frames; k++) {
+                w[k] = (int32_t)(((int64_t)w[k] * target) >> 15);
+            }
+        }
+        return;
+    }
+
+    for(size_t k = 0; k < frames; k++) {
+        if(d->vol_frames) {
+            d->vol_acc += d->vol_step;
+            if(!--d->vol_frames) {
+                d->vol_acc = target << VOL_SHIFT;
+            }
+            d->vol_gain[0] = d->vol_gain[1] = d->vol_acc >> VOL_SHIFT;
+        }
+        for(int ch = 0; ch < 2; ch++) {
+            int32_t x = w[2 * k + ch];
+            if(d->vol_gain[ch] != target) {
+                // a change without a ramp is a step, where the signal crosses zero it does not click
+                bool crossing = ((x ^ d->vol_prev[ch]) < 0) || (x <= ZC_QUIET && x >= -ZC_QUIET);
+                if(crossing || (++d->vol_wait[ch] >= d->zc_timeout)) {
+                    d->vol_gain[ch] = target;
+                    d->vol_wait[ch] = 0;
+                }
+            }
+            d->vol_prev[ch] = x;
+            w[2 * k + ch] = (int32_t)(((int64_t)x * d->vol_gain[ch]) >> 15);
+        }
+    }
+}
+
+/* **************** LIMITER **************** */
+
+static void limiter_clear(audio_dsp *d)
+{
+    memset(d->delay, 0, 2 * d->look_cap * sizeof(int32_t));
+    d->delay_pos = 0;
+    d->peaks = 0;
+    d->last_peak = -1;
+    d->lim_gain = d->lim_floor = d->last_target = LIM_UNITY;
+    d->lim_step = 0;
+}
+
+/** Writes the work block back to the caller's frames, delayed by the look-ahead */
+static void limiter_run(audio_dsp *d, const int32_t *__restrict w, int16_t *__restrict out, size_t frames)
+{
+    const uint32_t look = d->look;
+    const uint32_t cap = d->look_cap + 2;
+    uint32_t limited = 0;
+
+    for(size_t k = 0; k < frames; k++) {
+        const int32_t l = w[2 * k];
+        const int32_t r = w[2 * k + 1];
+        const int32_t al = (l < 0) ? -l : l;
+        const int32_t ar = (r < 0) ? -r : r;
+        const int32_t a = (al > ar) ? al : ar;
+
+        // running maximum over this frame and those in the delay
+        while(d->peaks) {
+            uint32_t back = d->peak_head + d->peaks - 1;
+            back -= (back >= cap) ? cap : 0;
+            if(d->peak_val[back] > a) {
+                break;
+            }
+            d->peaks--;
+        }
+        uint32_t in = d->peak_head + d->peaks;
+        in -= (in >= cap) ? cap : 0;
+        d->peak_val[in] = a;
+        d->peak_at[in] = d->now;
+        d->peaks++;
+        if(d->now - d->peak_at[d->peak_head] > look) {
+            d->peak_head = (d->peak_head + 1 == cap) ? 0 : d->peak_head + 1;
+            d->peaks--;
+        }
+        d->now++;
+
+        const int32_t peak = d->peak_val[d->peak_head];
+        if(peak != d->last_peak) {
+            d->last_peak = peak;
+            d->last_target = (peak > d->ceiling) ? (int32_t)(((int64_t)d->ceiling << LIM_BITS) / peak) : LIM_UNITY;
+        }
+        const int32_t target = d->last_target;
+
+        if(target < d->lim_gain) {
+            if(target != d->lim_floor) {
+                // a new peak entered the delay, be down to its target when it leaves,
+                // and no slower than before for the peaks already in there
+                int32_t step = (d->lim_gain - target + look) / (int32_t)(look + 1);
+                d->lim_floor = target;
+                d->lim_step = (step > d->lim_step) ? step : d->lim_step;
+            }
+            d->lim_gain -= d->lim_step;
+            if(d->lim_gain <= target) {
+                d->lim_gain = target;
+                d->lim_step = 0;
+            }
+        } else {
+            d->lim_floor = target;
+            d->lim_step = 0;
+            d->lim_gain += (int32_t)(((int64_t)(target - d->lim_gain) * d->release) >> LIM_BITS) + 1;
+            if(d->lim_gain > target) {
+                d->lim_gain = target;
+            }
+        }
+
+        int32_t dl = l;
+        int32_t dr = r;
+        if(look) {
+            int32_t *slot = d->delay + 2 * d->delay_pos;
+            dl = slot[0];
+            dr = slot[1];
+            slot[0] = l;
+            slot[1] = r;
+            d->delay_pos = (d->delay_pos + 1 == look) ? 0 : d->delay_pos + 1;
+        }
+        const int64_t round = (int64_t)1 << (LIM_BITS + GUARD_BITS - 1);
+        out[2 * k] = sat16((int32_t)(((int64_t)dl * d->lim_gain + round) >> (LIM_BITS + GUARD_BITS)));
+        out[2 * k + 1] = sat16((int32_t)(((int64_t)dr * d->lim_gain + round) >> (LIM_BITS + GUARD_BITS)));
+        limited += (d->lim_gain < LIM_UNITY);
+    }
+    d->stats.limited_frames += limited;
+}
+
+/* **************** CHAIN **************** */
+
+/** Everything that depends on the rate, under the lock */
+static void dsp_set_times(audio_dsp *d)
+{
+    d->sample_rate = d->config.sample_rate;
+    d->zc_timeout = (uint32_t)((uint64_t)ZC_TIMEOUT_US * d->sample_rate / 1000000);
+
+    uint32_t look = (uint32_t)((uint64_t)d->config.lookahead_ms * d->sample_rate / 1000);
+    if(look > d->look_cap) {
+        look = d->look_cap;
+    }
+    if(look != d->look) {
+        d->look = look;
+        limiter_clear(d);
+    }
+    double frames = (double)d->config.release_ms * d->sample_rate / 1000;
+    d->release = (int32_t)lround((1 - exp(-1 / frames)) * LIM_UNITY);
+}
+
+/** Take over what the setters changed, unless one of them is busy right now */
+static void dsp_apply(audio_dsp *d)
+{
+    if(!d->dirty.load(std::memory_order_relaxed) || !d->lock.try_lock()) {
+        return;
+    }
+    uint32_t dirty = d->dirty.exchange(0);
+    if(dirty & CHANGED_RESET) {
+        memset(d->state, 0, sizeof(d->state));
+        limiter_clear(d);
+    }
+    if(dirty & CHANGED_RATE) {
+        dsp_set_times(d);
+    }
+    if(dirty & (CHANGED_RATE | CHANGED_EQ)) {
+        eq_update(d);
+    }
+    if(dirty & CHANGED_VOLUME) {
+        volume_ramp(d, d->config.volume, d->ramp_ms);
+    }
+    d->lock.unlock();
+}
+
+audio_dsp_handle_t audio_dsp_new(const audio_dsp_config_t *config)
+{
+    if(!config || (config->bands > AUDIO_DSP_MAX_BANDS)) {
+        return NULL;
+    }
+    audio_dsp *d = new (std::nothrow) audio_dsp();
+    if(!d) {
+        return NULL;
+    }
+
+    d->config = *config;
+    audio_dsp_config_t *c = &d->config;
+    if(!c->sample_rate) {
+        c->sample_rate = DSP_DEFAULT_RATE;
+    }
+    if(c->limit_db >= 0) {
+        c->limit_db = -1.0f;
+    }
+    if(!c->lookahead_ms) {
+        c->lookahead_ms = 2;
+    }
+    if(!c->release_ms) {
+        c->release_ms = 100;
+    }
+
+    d->look_cap = c->lookahead_ms * DSP_MAX_RATE / 1000;
+    d->work = static_cast<int32_t*>(malloc(2 * AUDIO_DSP_BLOCK_FRAMES * sizeof(int32_t)));
+    d->delay = static_cast<int32_t*>(malloc((2 * d->look_cap + 1) * sizeof(int32_t)));
+    d->peak_val = static_cast<int32_t*>(malloc((d->look_cap + 2) * sizeof(int32_t)));
+    d->peak_at = static_cast<uint32_t*>(malloc((d->look_cap + 2) * sizeof(uint32_t)));
+    if(!d->work || !d->delay || !d->peak_val || !d->peak_at) {
+        audio_dsp_delete(d);
+        return NULL;
+    }
+
+    d->ceiling = (int32_t)lround(32767.0 * pow(10, c->limit_db / 20.0)) << GUARD_BITS;
+    d->look = UINT32_MAX;
+    dsp_set_times(d);
+    eq_update(d);
+    d->vol_target = c->volume;
+    d->vol_acc = (int32_t)c->volume << VOL_SHIFT;
+    d->vol_gain[0] = d->vol_gain[1] = c->volume;
+    return d;
+}
+
+void audio_dsp_delete(audio_dsp_handle_t d)
+{
+    if(!d) {
+        return;
+    }
+    free(d->work);
+    free(d->delay);
+    free(d->peak_val);
+    free(d->peak_at);
+    delete d;
+}
+
+void audio_dsp_process(audio_dsp_handle_t d, int16_t *frames, size_t count)
+{
+    dsp_apply(d);
+
+    while(count) {
+        size_t n = (count < AUDIO_DSP_BLOCK_FRAMES) ? count : AUDIO_DSP_BLOCK_FRAMES;
+        uint32_t t0 = dsp_cycles();
+        eq_run(d, frames, d->work, n);
+        uint32_t t1 = dsp_cycles();
+        volume_run(d, d->work, n);
+        uint32_t t2 = dsp_cycles();
+        limiter_run(d, d->work, frames, n);
+        uint32_t t3 = dsp_cycles();
+
+        d->stats.cycles[AUDIO_DSP_STAGE_EQ] += t1 - t0;
+        d->stats.cycles[AUDIO_DSP_STAGE_VOLUME] += t2 - t1;
+        d->stats.cycles[AUDIO_DSP_STAGE_LIMITER] += t3 - t2;
+        d->stats.frames += n;
+        frames += 2 * n;
+        count -= n;
+    }
+
+    d->stats.limiter_gain = (uint16_t)(d->lim_gain >> (LIM_BITS - 15));
+    d->stats.volume = (uint16_t)(d->vol_acc >> VOL_SHIFT);
+    if(d->lock.try_lock()) {
+        d->shown = d->stats;
+        d->lock.unlock();
+    }
+}
+
+void audio_dsp_reset(audio_dsp_handle_t d)
+{
+    std::lock_guard<std::mutex> guard(d->lock);
+    d->dirty.fetch_or(CHANGED_RESET);
+}
+
+void audio_dsp_set_rate(audio_dsp_handle_t d, uint32_t sample_rate)
+{
+    std::lock_guard<std::mutex> guard(d->lock);
+    if(sample_rate && (sample_rate != d->config.sample_rate)) {
+        d->config.sample_rate = sample_rate;
+        d->dirty.fetch_or(CHANGED_RATE);
+    }
+}
+
+bool audio_dsp_set_band(audio_dsp_handle_t d, uint8_t index, const audio_dsp_eq_band_t *band)
+{
+    if((index >= AUDIO_DSP_MAX_BANDS) || !band) {
+        return false;
+    }
+    std::lock_guard<std::mutex> guard(d->lock);
+    for(uint8_t b = d->config.bands; b < index; b++) {
+        memset(&d->config.band[b], 0, sizeof(d->config.band[b]));
+    }
+    if(index >= d->config.bands) {
+        d->config.bands = index + 1;
+    }
+    d->config.band[index] = *band;
+    d->dirty.fetch_or(CHANGED_EQ);
+    return true;
+}
+
+void audio_dsp_set_volume(audio_dsp_handle_t d, uint16_t volume, uint32_t ramp_ms)
+{
+    if(volume > AUDIO_DSP_VOLUME_UNITY) {
+        volume = AUDIO_DSP_VOLUME_UNITY;
+    }
+    std::lock_guard<std::mutex> guard(d->lock);
+    d->config.volume = volume;
+    d->ramp_ms = ramp_ms;
+    d->dirty.fetch_or(CHANGED_VOLUME);
+}
+
+void audio_dsp_get_stats(audio_dsp_handle_t d, audio_dsp_stats_t *stats)
+{
+    std::lock_guard<std::mutex> guard(d->lock);
+    *stats = d->shown;
+}
@@ -0,0 +1,788 @@
+/**
+ * @file
+ * @version 0.1
+ *
+ * @copyright Copyright 2021 Espressif Systems (Shanghai) Co. Ltd.
+ * @copyright Copyright 2022 Chris Morgan <chmorgan@gmail.com>
+ *
+ *      Licensed under the Apache License, Version 2.0 (the "License");
+ *      you may not use this file except in compliance with the License.
+ *      You may obtain a copy of the License at
+ *
+ *               http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *      Unless required by applicable law or agreed to in writing, software
+ *      distributed under the License is distributed on an "AS IS" BASIS,
+ *      WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *      See the License for the specific language governing permissions and
+ *      limitations under the License.
+ */
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <atomic>
+#include <new>
+#include <utility>
+
+#include "esp_check.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/semphr.h"
+#include "freertos/ringbuf.h"
+
+#include "sdkconfig.h"
+
+#include "audio_mixer.h"
+#include "audio_log.h"
+#include "audio_pcm.h"
+#include "audio_resample.h"
+
+static const char *TAG = "mixer";
+
+#define MIXER_DEFAULT_RATE          44100
+#define MIXER_FRAME_BYTES           (2 * sizeof(int16_t))   /**< mixer rings and output are 16 bit stereo */
+#define MIXER_STAGE_FRAMES          256     /**< frames converted per ring write */
+#define MIXER_IDLE_BLOCKS           4       /**< silent blocks written before the task sleeps */
+#define MIXER_LOW_LATENCY_BLOCKS    4       /**< default ring of a low-latency source */
+#define MIXER_MAX_BLOCK_FRAMES      2048
+#define MIXER_MAX_RATIO             8       /**< source rate / output rate */
+#define MIXER_STOP_RETRIES          10
+
+#define GAIN_SHIFT                  16      /**< gain_acc is the Q15 gain << GAIN_SHIFT */
+
+struct audio_mixer_source {
+    struct audio_mixer_source *next;
+    const char *name;
+    bool low_latency;
+
+    /* producer side */
+    uint32_t channels;                      /**< of the writes */
+    int16_t *stage;                         /**< MIXER_STAGE_FRAMES converted to stereo */
+    std::atomic<TickType_t> last_write;
+
+    RingbufHandle_t ring;                   /**< 16 bit stereo at sample_rate */
+    size_t ring_size;
+    size_t prefill;                         /**< buffered bytes before a regular source is mixed */
+
+    /* mixer side, under the mixer lock */
+    uint32_t sample_rate;
+    resampler_t rs;                         /**< to the output rate, passthrough at the same rate */
+    int16_t *pull;                          /**< ring frames on their way into rs, NULL when passthrough */
+    bool primed;
+    bool ready;                             /**< takes part in the current block */
+
+    uint32_t gain_acc;
+    int32_t gain_step;                      /**< per frame while ramping */
+    uint32_t ramp_frames;                   /**< left in the ramp */
+    uint16_t gain_target;
+
+    uint32_t underruns;
+    uint64_t frames_mixed;
+};
+
+typedef struct {
+    audio_mixer_config_t config;
+    SemaphoreHandle_t lock;                 /**< sources list and the mixer side of each source */
+    struct audio_mixer_source *sources;
+    TaskHandle_t task;
+    std::atomic<bool> exit;
+
+    int16_t *out;                           /**< block_frames, written to write_fn, NULL with acquire_fn */
+    int16_t *render;                        /**< one source resampled, when mixing several */
+    int32_t *acc;
+    bool pending;                           /**< some source holds audio that is not mixed yet */
+
+    /* statistics, under the lock */
+    uint32_t block_us;
+    uint32_t mix_us_last;
+    uint32_t mix_us_avg;
+    uint32_t mix_us_max;
+    uint32_t active;
+    uint32_t single_blocks;
+    uint64_t blocks;
+} mixer_instance_t;
+
+static mixer_instance_t mixer;
+
+static uint32_t source_fill(const struct audio_mixer_source *s)
+{
+    return s->ring_size - xRingbufferGetCurFreeSize(s->ring);
+}
+
+static TickType_t mixer_block_ticks(const mixer_instance_t *m)
+{
+    return pdMS_TO_TICKS(m->block_us / 1000) + 1;
+}
+
+/* **************** FIXED-POINT KERNELS **************** */
+
+static inline int16_t sat16(int32_t v)
+{
+    return (v > INT16_MAX) ? INT16_MAX : (v < INT16_MIN) ? INT16_MIN : (int16_t)v;
+}
+
+/** acc += x * gain over 'samples' interleaved samples, gain constant */
+static void mix_add(int32_t *acc, const int16_t *x, size_t samples, int32_t gain)
+{
+    if(gain == AUDIO_MIXER_GAIN_UNITY) {
+        for(size_t k = 0; k < samples; k++) {
+            acc[k] += x[k];
+        }
+    } else if(gain != 0) {
+        for(size_t k = 0; k < samples; k++) {
+            acc[k] += (x[k] * gain) >> 15;
+        }
+    }
+}
+
+/** x *= gain in place, gain constant and at most unity so nothing can clip */
+static void mix_scale(int16_t *x, size_t samples, int32_t gain)
+{
+    if(gain == AUDIO_MIXER_GAIN_UNITY) {
+        return;
+    }
+    for(size_t k = 0; k < samples; k++) {
+        x[k] = (int16_t)((x[k] * gain) >> 15);
+    }
+}
+
+static void mix_saturate(int16_t *out, const int32_t *acc, size_t samples)
+{
+    for(size_t k = 0; k < samples; k++) {
+        out[k] = sat16(acc[k]);
+    }
+}
+
+/**
+ * Apply the gain of s to 'frames' stereo frames, either into acc or, with acc
+ * NULL, in place. The ramp advances per frame, the rest runs at a constant gain.
+ */
+static void source_apply_gain(struct audio_mixer_source *s, int32_t *acc, int16_t *x, size_t frames)
+{
+    size_t k = 0;
+    for(; (k < frames) && s->ramp_frames; k++) {
+        int32_t gain = s->gain_acc >> GAIN_SHIFT;
+        if(acc) {
+            acc[2 * k] += (x[2 * k] * gain) >> 15;
+            acc[2 * k + 1] += (x[2 * k + 1] * gain) >> 15;
+        } else {
+            x[2 * k] = (int16_t)((x[2 * k] * gain) >> 15);
+            x[2 * k + 1] = (int16_t)((x[2 * k + 1] * gain) >> 15);
+        }
+        s->gain_acc += (uint32_t)s->gain_step;
+        if(--s->ramp_frames == 0) {
+            s->gain_acc = (uint32_t)s->gain_target << GAIN_SHIFT;
+        }
+    }
+
+    int32_t gain = s->gain_acc >> GAIN_SHIFT;
+    if(acc) {
+        mix_add(acc + 2 * k, x + 2 * k, 2 * (frames - k), gain);
+    } else {
+        mix_scale(x + 2 * k, 2 * (frames - k), gain);
+    }
+}
+
+/* **************** SOURCE RENDERING **************** */
+
+/** Move up to 'frames' frames out of the ring of s */
+static size_t source_pull(struct audio_mixer_source *s, int16_t *dst, size_t frames)
+{
+    size_t want = frames * MIXER_FRAME_BYTES;
+    size_t got = 0;
+
+    // a byte ring hands out at most the contiguous part, so twice around the wrap
+    while(got < want) {
+        size_t size = 0;
+        void *item = xRingbufferReceiveUpTo(s->ring, &size, 0, want - got);
+        if(!item) {
+            break;
+        }
+        memcpy(reinterpret_cast<uint8_t*>(dst) + got, item, size);
+        vRingbufferReturnItem(s->ring, item);
+        got += size;
+    }
+    return got / MIXER_FRAME_BYTES;
+}
+
+static void source_reset(struct audio_mixer_source *s)
+{
+    resampler_reset(&s->rs);
+    s->primed = false;
+}
+
+/**
+ * Whether s takes part in the next block. Regular sources wait for their
+ * prefill, or for the producer to have gone quiet, before they are mixed.
+ */
+static bool source_ready(const mixer_instance_t *m, struct audio_mixer_source *s)
+{
+    uint32_t fill = source_fill(s);
+    if(fill == 0) {
+        s->primed = s->low_latency;
+        // the filter still holds the end of the audio, silence plays it out
+        return s->rs.tail != 0;
+    }
+    if(!s->primed) {
+        TickType_t quiet = xTaskGetTickCount() - s->last_write;
+        if((fill < s->prefill) && (quiet <= 2 * mixer_block_ticks(m))) {
+            return false;
+        }
+        s->primed = true;
+    }
+    return true;
+}
+
+/**
+ * Render up to 'frames' output frames of s into dst, resampled to the output
+ * rate by the polyphase filter. Returns the frames rendered, fewer when the
+ * ring ran dry.
+ */
+static size_t source_render(struct audio_mixer_source *s, int16_t *dst, size_t frames)
+{
+    if(s->rs.passthrough) {
+        // same rate: straight out of the ring
+        size_t n = source_pull(s, dst, frames);
+        s->frames_mixed += n;
+        if(n < frames) {
+            s->underruns++;
+        }
+        return n;
+    }
+
+    size_t need = resampler_need(&s->rs, frames);
+    size_t n = source_pull(s, s->pull, need);
+    resampler_push(&s->rs, s->pull, n);
+    s->frames_mixed += n;
+    if(n < need) {
+        // ran dry: silence lets the filter play out the frames it looks ahead for
+        resampler_push_silence(&s->rs, need - n);
+        if(n) {
+            s->underruns++;
+        }
+    }
+    return resampler_run(&s->rs, dst, frames);
+}
+
+/**
+ * Mix one block of all ready sources into out, at most block_frames.
+ *
+ * @return number of sources that contributed
+ */
+static uint32_t mix_block(mixer_instance_t *m, int16_t *out, size_t frames)
+{
+    struct audio_mixer_source *single = NULL;
+    uint32_t ready = 0;
+
+    m->pending = false;
+    for(struct audio_mixer_source *s = m->sources; s; s = s->next) {
+        s->ready = source_ready(m, s);
+        if(s->ready) {
+            single = s;
+            ready++;
+        } else if(source_fill(s)) {
+            m->pending = true;
+        }
+    }
+
+    if(ready == 0) {
+        memset(out, 0, frames * MIXER_FRAME_BYTES);
+        return 0;
+    }
+
+    if(ready == 1) {
+        // nothing to sum: render into the output and scale in place
+        size_t n = source_render(single, out, frames);
+        source_apply_gain(single, NULL, out, n);
+        memset(out + 2 * n, 0, (frames - n) * MIXER_FRAME_BYTES);
+        m->single_blocks++;
+        return 1;
+    }
+
+    memset(m->acc, 0, frames * 2 * sizeof(int32_t));
+    ready = 0;
+    for(struct audio_mixer_source *s = m->sources; s; s = s->next) {
+        if(!s->ready) {
+            continue;
+        }
+        size_t n = source_render(s, m->render, frames);
+        source_apply_gain(s, m->acc, m->render, n);
+        ready += (n != 0);
+    }
+    mix_saturate(out, m->acc, frames * 2);
+    return ready;
+}
+
+/**
+ * Output space for the next block: m->out, or space lent by the output,
+ * which may be shorter than a block. NULL when the output lent nothing in
+ * time.
+ */
+static int16_t *mixer_acquire(mixer_instance_t *m, size_t *frames)
+{
+    *frames = m->config.block_frames;
+    if(!m->config.acquire_fn) {
+        return m->out;
+    }
+    void *buf = NULL;
+    size_t len = 0;
+    // bounded, so that a stopped output does not keep audio_mixer_delete() waiting
+    if(m->config.acquire_fn(&buf, &len, 2 * m->block_us / 1000 + 1) != ESP_OK || len < MIXER_FRAME_BYTES) {
+        return NULL;
+    }
+    if(len / MIXER_FRAME_BYTES < *frames) {
+        *frames = len / MIXER_FRAME_BYTES;
+    }
+    return static_cast<int16_t*>(buf);
+}
+
+static void mixer_task(void *pvParam)
+{
+    mixer_instance_t *m = static_cast<mixer_instance_t*>(pvParam);
+    uint32_t silent = 0;
+
+    while(!m->exit) {
+        size_t frames;
+        int16_t *out = mixer_acquire(m, &frames);
+        if(!out) {
+            vTaskDelay(mixer_block_ticks(m));
+            continue;
+        }
+
+        xSemaphoreTake(m->lock, portMAX_DELAY);
+        int64_t start = esp_timer_get_time();
+        uint32_t active = mix_block(m, out, frames);
+        uint32_t us = (uint32_t)(esp_timer_get_time() - start);
+        bool pending = m->pending;
+        m->active = active;
+        if(active) {
+            m->mix_us_last = us;
+            m->mix_us_avg = m->mix_us_avg ? m->mix_us_avg + ((int32_t)(us - m->mix_us_avg) / 16) : us;
+            if(us > m->mix_us_max) {
+                m->mix_us_max = us;
+            }
+        }
+        xSemaphoreGive(m->lock);
+
+        if(m->config.acquire_fn) {
+            // lent space is given back even when idle, it holds silence
+            m->config.commit_fn(frames * MIXER_FRAME_BYTES);
+        }
+
+        if(active) {
+            silent = 0;
+        } else if(++silent > MIXER_IDLE_BLOCKS) {
+            // the DMA has played out silence, wait for a write (or a prefill timing out)
+            ulTaskNotifyTake(pdTRUE, pending ? mixer_block_ticks(m) : portMAX_DELAY);
+            continue;
+        }
+
+        if(!m->config.acquire_fn) {
+            size_t written = 0;
+            m->config.write_fn(out, frames * MIXER_FRAME_BYTES, &written, portMAX_DELAY);
+        }
+        m->blocks++;
+    }
+
+    m->task = NULL;
+    vTaskDelete(NULL);
+}
+
+/* **************** MIXER **************** */
+
+static void mixer_free(mixer_instance_t *m)
+{
+    if(m->lock) vSemaphoreDelete(m->lock);
+    free(m->out);
+    free(m->render);
+    free(m->acc);
+    m->lock = NULL;
+    m->out = NULL;
+    m->render = NULL;
+    m->acc = NULL;
+}
+
+esp_err_t audio_mixer_new(const audio_mixer_config_t *config)
+{
+    ESP_RETURN_ON_FALSE(config && config->clk_set_fn, ESP_ERR_INVALID_ARG, TAG, "clk_set_fn is required");
+    ESP_RETURN_ON_FALSE(config->write_fn || (config->acquire_fn && config->commit_fn), ESP_ERR_INVALID_ARG,
+        TAG, "write_fn, or acquire_fn and commit_fn, are required");
+    ESP_RETURN_ON_FALSE(NULL == mixer.lock, ESP_ERR_INVALID_STATE, TAG, "mixer already created");
+
+    mixer_instance_t *m = &mixer;
+    m->config = *config;
+    m->sources = NULL;
+    m->exit = false;
+    m->mix_us_last = m->mix_us_avg = m->mix_us_max = 0;
+    m->active = m->single_blocks = 0;
+    m->blocks = 0;
+    if(m->config.sample_rate == 0) {
+        m->config.sample_rate = MIXER_DEFAULT_RATE;
+    }
+    if(m->config.block_frames == 0) {
+        m->config.block_frames = CONFIG_AUDIO_PLAYER_MIXER_BLOCK_FRAMES;
+    }
+    if(m->config.block_frames > MIXER_MAX_BLOCK_FRAMES) {
+        m->config.block_frames = MIXER_MAX_BLOCK_FRAMES;
+    }
+    m->block_us = (uint64_t)m->config.block_frames * 1000000 / m->config.sample_rate;
+
+    esp_err_t ret = ESP_OK;
+    BaseType_t task_val;
+    size_t samples = m->config.block_frames * 2;
+    m->out = m->config.acquire_fn ? NULL : static_cast<int16_t*>(malloc(samples * sizeof(int16_t)));
+    m->render = static_cast<int16_t*>(malloc(samples * sizeof(int16_t)));
+    m->acc = static_cast<int32_t*>(malloc(samples * sizeof(int32_t)));
+    ESP_GOTO_ON_FALSE((m->out || m->config.acquire_fn) && m->render && m->acc, ESP_ERR_NO_MEM, cleanup,
+        TAG, "Failed allocate mix buffers");
+
+    ret = m->config.clk_set_fn(m->config.sample_rate, 16, I2S_SLOT_MODE_STEREO);
+    ESP_GOTO_ON_FALSE(ESP_OK == ret, ret, cleanup, TAG, "clk_set_fn %d", ret);
+
+    m->lock = xSemaphoreCreateMutex();
+    ESP_GOTO_ON_FALSE(NULL != m->lock, ESP_ERR_NO_MEM, cleanup,
+        TAG, "Failed create mutex");
+
+    task_val = xTaskCreatePinnedToCore(
+        (TaskFunction_t)        mixer_task,
+                                "Audio Mixer",
+                                3 * 1024,
+                                m,
+        (UBaseType_t)           m->config.priority,
+        (TaskHandle_t * const)  &m->task,
+        (BaseType_t)            m->config.coreID);
+    ESP_GOTO_ON_FALSE(pdPASS == task_val, ESP_ERR_NO_MEM, cleanup,
+        TAG, "Failed create mixer task");
+
+    LOGI_1("mixer %u Hz, %u frames per block (%u us)", (unsigned)m->config.sample_rate,
+        (unsigned)m->config.block_frames, (unsigned)m->block_us);
+    return ESP_OK;
+
+// cppcheck-suppress unusedLabelConfiguration
+cleanup:
+    mixer_free(m);
+    return ret;
+}
+
+esp_err_t audio_mixer_delete(void)
+{
+    mixer_instance_t *m = &mixer;
+    ESP_RETURN_ON_FALSE(NULL != m->lock, ESP_ERR_INVALID_STATE, TAG, "mixer not created");
+    ESP_RETURN_ON_FALSE(NULL == m->sources, ESP_ERR_INVALID_STATE, TAG, "sources left");
+
+    int retries = MIXER_STOP_RETRIES;
+    m->exit = true;
+    while(m->task && retries) {
+        xTaskNotifyGive(m->task);
+        vTaskDelay(mixer_block_ticks(m) * 2);
+        retries--;
+    }
+    if(m->task) {
+        ESP_LOGE(TAG, "mixer task did not exit");
+        return ESP_FAIL;
+    }
+
+    mixer_free(m);
+    return ESP_OK;
+}
+
+esp_err_t audio_mixer_get_stats(audio_mixer_stats_t *stats)
+{
+    mixer_instance_t *m = &mixer;
+    ESP_RETURN_ON_FALSE(NULL != stats, ESP_ERR_INVALID_ARG, TAG, "stats is NULL");
+    ESP_RETURN_ON_FALSE(NULL != m->lock, ESP_ERR_INVALID_STATE, TAG, "mixer not created");
+
+    xSemaphoreTake(m->lock, portMAX_DELAY);
+    stats->sample_rate = m->config.sample_rate;
+    stats->block_frames = m->config.block_frames;
+    stats->block_us = m->block_us;
+    stats->mix_us_last = m->mix_us_last;
+    stats->mix_us_avg = m->mix_us_avg;
+    stats->mix_us_max = m->mix_us_max;
+    stats->cpu_permille = m->block_us ? m->mix_us_avg * 1000 / m->block_us : 0;
+    stats->sources = 0;
+    for(struct audio_mixer_source *s = m->sources; s; s = s->next) {
+        stats->sources++;
+    }
+    stats->active = m->active;
+    stats->single_blocks = m->single_blocks;
+    stats->blocks = m->blocks;
+    xSemaphoreGive(m->lock);
+
+    return ESP_OK;
+}
+
+/* **************** SOURCES **************** */
+
+static bool source_format_valid(const mixer_instance_t *m, uint32_t rate, uint32_t bits, uint32_t channels)
+{
+    return (bits == 16) && ((channels == 1) || (channels == 2)) &&
+        (rate > 0) && (rate <= MIXER_MAX_RATIO * m->config.sample_rate);
+}
+
+/** Set up the resampler from 'rate' and its pull buffer, for blocks of the mixer */
+static bool source_alloc_rs(const mixer_instance_t *m, uint32_t rate, resampler_t *rs, int16_t **pull)
+{
+    *pull = NULL;
+    if(!resampler_init(rs, rate, m->config.sample_rate, m->config.block_frames)) {
+        return false;
+    }
+    if(!rs->passthrough) {
+        *pull = static_cast<int16_t*>(malloc(rs->capacity * MIXER_FRAME_BYTES));
+        if(!*pull) {
+            resampler_free(rs);
+            return false;
+        }
+    }
+    return true;
+}
+
+static void source_free(struct audio_mixer_source *s)
+{
+    if(s->ring) vRingbufferDelete(s->ring);
+    free(s->stage);
+    free(s->pull);
+    resampler_free(&s->rs);
+    delete s;
+}
+
+esp_err_t audio_mixer_source_new(const audio_mixer_source_config_t *config, audio_mixer_source_handle_t *handle)
+{
+    mixer_instance_t *m = &mixer;
+    ESP_RETURN_ON_FALSE(config && handle, ESP_ERR_INVALID_ARG, TAG, "NULL argument");
+    ESP_RETURN_ON_FALSE(NULL != m->lock, ESP_ERR_INVALID_STATE, TAG, "mixer not created");
+    ESP_RETURN_ON_FALSE(source_format_valid(m, config->sample_rate, config->bits_per_sample, config->channels),
+        ESP_ERR_INVALID_ARG, TAG, "unsupported format %u Hz %u bit %u ch", (unsigned)config->sample_rate,
+        (unsigned)config->bits_per_sample, (unsigned)config->channels);
+
+    struct audio_mixer_source *s = new (std::nothrow) audio_mixer_source();
+    ESP_RETURN_ON_FALSE(NULL != s, ESP_ERR_NO_MEM, TAG, "Failed allocate source");
+
+    s->name = config->name ? config->name : "";
+    s->low_latency = config->low_latency;
+    s->channels = config->channels;
+    s->sample_rate = config->sample_rate;
+    s->last_write = xTaskGetTickCount();
+
+    uint32_t ms = config->buffer_ms;
+    if(ms == 0) {
+        ms = s->low_latency ? (MIXER_LOW_LATENCY_BLOCKS * m->block_us + 999) / 1000 : CONFIG_AUDIO_PLAYER_MIXER_SOURCE_MS;
+    }
+    s->ring_size = (size_t)ms * s->sample_rate / 1000 * MIXER_FRAME_BYTES;
+    if(s->ring_size < 2 * MIXER_STAGE_FRAMES * MIXER_FRAME_BYTES) {
+        s->ring_size = 2 * MIXER_STAGE_FRAMES * MIXER_FRAME_BYTES;
+    }
+    s->prefill = s->low_latency ? 0 : s->ring_size / 2;
+
+    uint16_t gain = config->gain ? config->gain : AUDIO_MIXER_GAIN_UNITY;
+    if(gain > AUDIO_MIXER_GAIN_UNITY) {
+        gain = AUDIO_MIXER_GAIN_UNITY;
+    }
+    s->gain_target = gain;
+    s->gain_acc = (uint32_t)gain << GAIN_SHIFT;
+
+    esp_err_t ret = ESP_OK;
+    s->stage = static_cast<int16_t*>(malloc(MIXER_STAGE_FRAMES * MIXER_FRAME_BYTES));
+    bool rs_ok = source_alloc_rs(m, s->sample_rate, &s->rs, &s->pull);
+    s->ring = xRingbufferCreate(s->ring_size, RINGBUF_TYPE_BYTEBUF);
+    ESP_GOTO_ON_FALSE(s->stage && rs_ok && s->ring, ESP_ERR_NO_MEM, cleanup,
+        TAG, "Failed allocate source buffers");
+    source_reset(s);
+
+    xSemaphoreTake(m->lock, portMAX_DELAY);
+    s->next = m->sources;
+    m->sources = s;
+    xSemaphoreGive(m->lock);
+
+    LOGI_1("source '%s' %u Hz %u ch, ring %u bytes%s", s->name, (unsigned)s->sample_rate,
+        (unsigned)s->channels, (unsigned)s->ring_size, s->low_latency ? ", low latency" : "");
+    *handle = s;
+    return ESP_OK;
+
+// cppcheck-suppress unusedLabelConfiguration
+cleanup:
+    source_free(s);
+    return ret;
+}
+
+esp_err_t audio_mixer_source_delete(audio_mixer_source_handle_t handle)
+{
+    mixer_instance_t *m = &mixer;
+    ESP_RETURN_ON_FALSE(NULL != handle, ESP_ERR_INVALID_ARG, TAG, "handle is NULL");
+    ESP_RETURN_ON_FALSE(NULL != m->lock, ESP_ERR_INVALID_STATE, TAG, "mixer not created");
+
+    xSemaphoreTake(m->lock, portMAX_DELAY);
+    for(struct audio_mixer_source **p = &m->sources; *p; p = &(*p)->next) {
+        if(*p == handle) {
+            *p = handle->next;
+            break;
+        }
+    }
+    xSemaphoreGive(m->lock);
+
+    source_free(handle);
+    return ESP_OK;
+}
+
+esp_err_t audio_mixer_source_write(audio_mixer_source_handle_t handle, const void *data, size_t len,
+                                   size_t *bytes_written, uint32_t timeout_ms)
+{
+    ESP_RETURN_ON_FALSE(handle && (data || !len), ESP_ERR_INVALID_ARG, TAG, "NULL argument");
+
+    struct audio_mixer_source *s = handle;
+    const int16_t *in = static_cast<const int16_t*>(data);
+    const size_t in_frame_bytes = s->channels * sizeof(int16_t);
+    const size_t frames = len / in_frame_bytes;
+    const TickType_t wait = (timeout_ms == portMAX_DELAY) ? portMAX_DELAY : pdMS_TO_TICKS(timeout_ms);
+    const TickType_t start = xTaskGetTickCount();
+    esp_err_t ret = ESP_OK;
+    size_t done = 0;
+
+    while(done < frames) {
+        size_t n = frames - done;
+        if(n > MIXER_STAGE_FRAMES) {
+            n = MIXER_STAGE_FRAMES;
+        }
+
+        const int16_t *item = in + done * 2;
+        if(s->channels == 1) {
+            audio_pcm_mono_to_stereo_s16(s->stage, in + done, n);
+            item = s->stage;
+        }
+
+        TickType_t left = wait;
+        if(wait != portMAX_DELAY) {
+            TickType_t elapsed = xTaskGetTickCount() - start;
+            left = (elapsed < wait) ? wait - elapsed : 0;
+        }
+        if(pdTRUE != xRingbufferSend(s->ring, item, n * MIXER_FRAME_BYTES, left)) {
+            ret = ESP_ERR_TIMEOUT;
+            break;
+        }
+        done += n;
+        s->last_write = xTaskGetTickCount();
+
+        // wakes the mixer if it went idle, a no-op count otherwise
+        if(mixer.task) {
+            xTaskNotifyGive(mixer.task);
+        }
+    }
+
+    if(bytes_written) {
+        *bytes_written = done * in_frame_bytes;
+    }
+    return ret;
+}
+
+esp_err_t audio_mixer_source_set_format(audio_mixer_source_handle_t handle, uint32_t sample_rate,
+                                        uint32_t bits_per_sample, uint32_t channels)
+{
+    mixer_instance_t *m = &mixer;
+    ESP_RETURN_ON_FALSE(NULL != handle, ESP_ERR_INVALID_ARG, TAG, "handle is NULL");
+    ESP_RETURN_ON_FALSE(source_format_valid(m, sample_rate, bits_per_sample, channels),
+        ESP_ERR_INVALID_ARG, TAG, "unsupported format %u Hz %u bit %u ch", (unsigned)sample_rate,
+        (unsigned)bits_per_sample, (unsigned)channels);
+
+    struct audio_mixer_source *s = handle;
+
+    // only the producer converts channels, the ring is stereo either way
+    s->channels = channels;
+    if(sample_rate == s->sample_rate) {
+        return ESP_OK;
+    }
+
+    // play out what was buffered at the old rate, giving up after twice the ring length
+    uint32_t ring_ms = s->ring_size / MIXER_FRAME_BYTES * 1000 / s->sample_rate;
+    TickType_t start = xTaskGetTickCount();
+    while(source_fill(s) && (xTaskGetTickCount() - start) < pdMS_TO_TICKS(2 * ring_ms) + 1) {
+        vTaskDelay(mixer_block_ticks(m));
+    }
+
+    resampler_t rs;
+    int16_t *pull;
+    ESP_RETURN_ON_FALSE(source_alloc_rs(m, sample_rate, &rs, &pull), ESP_ERR_NO_MEM, TAG,
+        "Failed allocate resampler");
+
+    xSemaphoreTake(m->lock, portMAX_DELAY);
+    size_t size = 0;
+    void *item;
+    while((item = xRingbufferReceiveUpTo(s->ring, &size, 0, s->ring_size))) {
+        vRingbufferReturnItem(s->ring, item);
+    }
+    std::swap(s->rs, rs);
+    std::swap(s->pull, pull);
+    s->sample_rate = sample_rate;
+    source_reset(s);
+    xSemaphoreGive(m->lock);
+    resampler_free(&rs);
+    free(pull);
+
+    LOGI_1("source '%s' now %u Hz", s->name, (unsigned)sample_rate);
+    return ESP_OK;
+}
+
+esp_err_t audio_mixer_source_set_gain(audio_mixer_source_handle_t handle, uint16_t gain, uint32_t ramp_ms)
+{
+    mixer_instance_t *m = &mixer;
+    ESP_RETURN_ON_FALSE(NULL != handle, ESP_ERR_INVALID_ARG, TAG, "handle is NULL");
+    if(gain > AUDIO_MIXER_GAIN_UNITY) {
+        gain = AUDIO_MIXER_GAIN_UNITY;
+    }
+
+    struct audio_mixer_source *s = handle;
+    uint32_t frames = (uint64_t)ramp_ms * m->config.sample_rate / 1000;
+
+    xSemaphoreTake(m->lock, portMAX_DELAY);
+    s->gain_target = gain;
+    if(frames == 0) {
+        s->gain_acc = (uint32_t)gain << GAIN_SHIFT;
+        s->ramp_frames = 0;
+    } else {
+        int64_t diff = ((int64_t)gain << GAIN_SHIFT) - (int64_t)s->gain_acc;
+        s->gain_step = (int32_t)(diff / frames);
+        s->ramp_frames = frames;
+    }
+    xSemaphoreGive(m->lock);
+
+    return ESP_OK;
+}
+
+esp_err_t audio_mixer_source_flush(audio_mixer_source_handle_t handle)
+{
+    mixer_instance_t *m = &mixer;
+    ESP_RETURN_ON_FALSE(NULL != handle, ESP_ERR_INVALID_ARG, TAG, "handle is NULL");
+
+    struct audio_mixer_source *s = handle;
+    xSemaphoreTake(m->lock, portMAX_DELAY);
+    size_t size = 0;
+    void *item;
+    while((item = xRingbufferReceiveUpTo(s->ring, &size, 0, s->ring_size))) {
+        vRingbufferReturnItem(s->ring, item);
+    }
+    source_reset(s);
+    xSemaphoreGive(m->lock);
+
+    return ESP_OK;
+}
+
+esp_err_t audio_mixer_source_get_stats(audio_mixer_source_handle_t handle, audio_mixer_source_stats_t *stats)
+{
+    mixer_instance_t *m = &mixer;
+    ESP_RETURN_ON_FALSE(handle && stats, ESP_ERR_INVALID_ARG, TAG, "NULL argument");
+
+    struct audio_mixer_source *s = handle;
+    xSemaphoreTake(m->lock, portMAX_DELAY);
+    stats->buffer_bytes = s->ring_size;
+    stats->fill_bytes = source_fill(s);
+    stats->latency_ms = (uint64_t)(stats->fill_bytes / MIXER_FRAME_BYTES + s->rs.held) * 1000 / s->sample_rate +
+        m->block_us / 1000;
+    stats->underruns = s->underruns;
+    stats->frames_mixed = s->frames_mixed;
+    xSemaphoreGive(m->lock);
+
+    return ESP_OK;
+}
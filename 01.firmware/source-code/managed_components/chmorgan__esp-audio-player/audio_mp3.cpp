@@ -1,9 +1,208 @@
 #include <string.h>
+#include <stdlib.h>
+#include "sdkconfig.h"
 #include "audio_log.h"
 #include "audio_mp3.h"
+#include "audio_mp3_stream.h"
+#include "audio_pcm.h"
 
 static const char *TAG = "mp3";
 
+/** libhelix output lags the input by this many samples, on top of the encoder delay */
+#define MP3_DECODER_DELAY   529
+
+#define XING_FLAG_FRAMES    0x01
+#define XING_FLAG_BYTES     0x02
+#define XING_FLAG_TOC       0x04
+#define XING_FLAG_QUALITY   0x08
+
+/** The VBRI tag sits at a fixed offset behind the frame header */
+#define VBRI_OFFSET         (4 + 32)
+
+/**
+ * Ahead of a seek target enough frames are decoded and dropped to refill the
+ * bit reservoir, which reaches up to 511 bytes back, and one more for the
+ * IMDCT overlap.
+ */
+#define MP3_RESERVOIR_BYTES     511
+#define MP3_SEEK_PRIME_MAX      8
+
+#define MP3_INDEX_STEP          16      /**< frames per index entry, ~0.4 s at 44.1 kHz */
+#define MP3_INDEX_BLOCK         4096    /**< bytes read per scan block */
+#define MP3_INDEX_BLOCKS        4       /**< scan blocks per mp3_index_step() call */
+
+#ifndef CONFIG_AUDIO_PLAYER_MP3_INDEX_CACHE
+#define CONFIG_AUDIO_PLAYER_MP3_INDEX_CACHE 0
+#endif
+
+typedef struct {
+    uint32_t sample_rate;
+    uint32_t bitrate;           /**< bits per second */
+    uint16_t samples;           /**< per channel */
+    uint16_t length;            /**< bytes including the header */
+    uint8_t version;            /**< 0 MPEG1, 1 MPEG2, 2 MPEG2.5 */
+    uint8_t channels;
+} mp3_frame_header_t;
+
+static uint32_t read_be32(const uint8_t *p) {
+    return ((uint32_t)p[0] << 24) | ((uint32_t)p[1] << 16) | ((uint32_t)p[2] << 8) | p[3];
+}
+
+static uint16_t read_be16(const uint8_t *p) {
+    return (p[0] << 8) | p[1];
+}
+
+/**
+ * Decode a layer III frame header without touching the decoder state, so that
+ * headers can be looked at ahead of and away from the decode position.
+ *
+ * @return false for anything but a layer III header with a known bitrate
+ */
+static bool mp3_frame_header(const uint8_t *h, mp3_frame_header_t *fh) {
+    static const uint16_t bitrate_kbps[2][15] = {
+        { 0, 32, 40, 48, 56, 64, 80, 96, 112, 128, 160, 192, 224, 256, 320 },
+        { 0, 8, 16, 24, 32, 40, 48, 56, 64, 80, 96, 112, 128, 144, 160 },
+    };
+    static const uint32_t sample_rate[3] = { 44100, 48000, 32000 };
+
+    if(h[0] != 0xff || (h[1] & 0xe0) != 0xe0) {
+        return false;
+    }
+    int version_bits = (h[1] >> 3) & 0x03;
+    int layer_bits = (h[1] >> 1) & 0x03;
+    int bitrate_index = h[2] >> 4;
+    int rate_index = (h[2] >> 2) & 0x03;
+    if(version_bits == 1 || layer_bits != 1 || bitrate_index == 0 || bitrate_index == 15 || rate_index == 3) {
+        return false;
+    }
+
+    fh->version = (version_bits == 3) ? 0 : (version_bits == 2) ? 1 : 2;
+    fh->sample_rate = sample_rate[rate_index] >> fh->version;
+    fh->bitrate = bitrate_kbps[fh->version ? 1 : 0][bitrate_index] * 1000;
+    fh->samples = fh->version ? 576 : 1152;
+    fh->length = (fh->samples / 8) * fh->bitrate / fh->sample_rate + ((h[2] >> 1) & 0x01);
+    fh->channels = ((h[3] >> 6) == 3) ? 1 : 2;
+    return true;
+}
+
+/**
+ * A sync word in the middle of frame data is only accepted once another
+ * frame of the same stream follows it where the header says it ends.
+ */
+static bool mp3_check_sync(const uint8_t *buf, size_t len, uint32_t sample_rate) {
+    mp3_frame_header_t fh, next;
+    if(len < 4 || !mp3_frame_header(buf, &fh) || (sample_rate && fh.sample_rate != sample_rate)) {
+        return false;
+    }
+    if((size_t)fh.length + 4 > len) {
+        // the end of the stream, or of the buffer: take the header on its own
+        return true;
+    }
+    return mp3_frame_header(buf + fh.length, &next) && next.sample_rate == fh.sample_rate;
+}
+
+bool mp3_parse_info_tag(const uint8_t *buf, size_t len, mp3_info_tag_t *tag, size_t *frame_len) {
+    mp3_frame_header_t fh;
+
+    if(len < 4 || !mp3_frame_header(buf, &fh) || fh.length > len) {
+        return false;
+    }
+
+    bool mpeg1 = (fh.version == 0);
+    size_t side_info_len = mpeg1 ? ((fh.channels == 1) ? 17 : 32) : ((fh.channels == 1) ? 9 : 17);
+    size_t crc_len = (buf[1] & 0x01) ? 0 : 2;
+
+    const uint8_t *p = buf + 4 + crc_len + side_info_len;
+    const uint8_t *end = buf + fh.length;
+    memset(tag, 0, sizeof(*tag));
+
+    if(buf + VBRI_OFFSET + 26 <= end && memcmp(buf + VBRI_OFFSET, "VBRI", 4) == 0) {
+        p = buf + VBRI_OFFSET;
+        tag->vbri = true;
+        tag->bytes = read_be32(p + 10);
+        tag->frames = read_be32(p + 14);
+        tag->vbri_entries = read_be16(p + 18);
+        tag->vbri_scale = read_be16(p + 20);
+        tag->vbri_entry_size = read_be16(p + 22);
+        tag->vbri_frames_per_entry = read_be16(p + 24);
+        tag->vbri_toc = p + 26;
+        if(tag->vbri_entry_size < 1 || tag->vbri_entry_size > 4 || tag->vbri_frames_per_entry == 0 ||
+           tag->vbri_toc + tag->vbri_entries * tag->vbri_entry_size > end) {
+            tag->vbri_entries = 0;
+        }
+        LOGI_1("vbri tag: frames %u, bytes %u, %d entries of %d frames",
+               (unsigned)tag->frames, (unsigned)tag->bytes, tag->vbri_entries, tag->vbri_frames_per_entry);
+        *frame_len = fh.length;
+        return true;
+    }
+
+    if(p + 8 > end || (memcmp(p, "Xing", 4) != 0 && memcmp(p, "Info", 4) != 0)) {
+        return false;
+    }
+
+    tag->cbr = (memcmp(p, "Info", 4) == 0);
+    uint32_t flags = read_be32(p + 4);
+    p += 8;
+    if((flags & XING_FLAG_FRAMES) && p + 4 <= end) {
+        tag->frames = read_be32(p);
+        p += 4;
+    }
+    if((flags & XING_FLAG_BYTES) && p + 4 <= end) {
+        tag->bytes = read_be32(p);
+        p += 4;
+    }
+    if(flags & XING_FLAG_TOC) {
+        if(p + 100 <= end) {
+            tag->toc = p;
+        }
+        p += 100;
+    }
+    if(flags & XING_FLAG_QUALITY) {
+        p += 4;
+    }
+
+    // LAME extension: 9 character encoder version, 12 bit delay and padding at offset 21
+    if(p + 24 <= end &&
+       (memcmp(p, "LAME", 4) == 0 || memcmp(p, "Lavc", 4) == 0 ||
+        memcmp(p, "Lavf", 4) == 0 || memcmp(p, "GOGO", 4) == 0)) {
+        tag->lame = true;
+        tag->enc_delay = (p[21] << 4) | (p[22] >> 4);
+        tag->enc_padding = ((p[22] & 0x0f) << 8) | p[23];
+    }
+
+    LOGI_1("info tag: frames %u, bytes %u, toc %d, delay %d, padding %d",
+           (unsigned)tag->frames, (unsigned)tag->bytes, tag->toc != NULL, tag->enc_delay, tag->enc_padding);
+
+    *frame_len = fh.length;
+    return true;
+}
+
+/**
+ * Drop the encoder / decoder delay from the start of the file and the encoder
+ * padding from its end.
+ */
+static void mp3_trim(decode_data *pData, mp3_instance *pInstance) {
+    size_t frame_bytes = pData->fmt.channels * (pData->fmt.bits_per_sample / BITS_PER_BYTE);
+
+    size_t skip = pData->frame_count;
+    if(skip > pInstance->skip_frames) {
+        skip = pInstance->skip_frames;
+    }
+    if(skip) {
+        pInstance->skip_frames -= skip;
+        pData->frame_count -= skip;
+        memmove(pData->samples, pData->samples + skip * frame_bytes, pData->frame_count * frame_bytes);
+    }
+
+    if(pInstance->valid_frames) {
+        uint64_t remaining = pInstance->valid_frames - pInstance->frames_out;
+        if(pData->frame_count > remaining) {
+            pData->frame_count = remaining;
+        }
+    }
+    pInstance->frames_out += pData->frame_count;
+}
+
 bool is_mp3(FILE *fp) {
     bool is_mp3_file = false;
 
@@ -48,33 +247,462 @@ bool is_mp3(FILE *fp) {
 }
 
 /**
- * @return true if data remains, false on error or end of file
+ * Indexes of recently played files, so that going back to one of them seeks
+ * exactly right away. Only touched from the audio task.
  */
-DECODE_STATUS decode_mp3(HMP3Decoder mp3_decoder, FILE *fp, decode_data *pData, mp3_instance *pInstance) {
-    MP3FrameInfo frame_info;
+#if CONFIG_AUDIO_PLAYER_MP3_INDEX_CACHE > 0
+typedef struct {
+    uint32_t key;
+    long size;
+    uint32_t frames;
+    uint32_t last_use;
+    mp3_frame_index_t index;
+} mp3_index_cache_entry_t;
+
+static mp3_index_cache_entry_t index_cache[CONFIG_AUDIO_PLAYER_MP3_INDEX_CACHE];
+static uint32_t index_cache_clock;
+
+static mp3_index_cache_entry_t *index_cache_find(uint32_t key, long size) {
+    for(int n = 0; n < CONFIG_AUDIO_PLAYER_MP3_INDEX_CACHE; n++) {
+        mp3_index_cache_entry_t *e = &index_cache[n];
+        if(e->index.offset && e->key == key && e->size == size) {
+            e->last_use = ++index_cache_clock;
+            return e;
+        }
+    }
+    return NULL;
+}
+
+static void index_cache_add(mp3_instance *pInstance) {
+    mp3_index_cache_entry_t *e = &index_cache[0];
+    for(int n = 1; n < CONFIG_AUDIO_PLAYER_MP3_INDEX_CACHE; n++) {
+        if(index_cache[n].last_use < e->last_use) {
+            e = &index_cache[n];
+        }
+    }
+    free(e->index.offset);
+
+    e->key = pInstance->index.key;
+    e->size = pInstance->audio_end;
+    e->frames = pInstance->total_frames;
+    e->last_use = ++index_cache_clock;
+    e->index = pInstance->index;
+    e->index.scan_buf = NULL;
+    pInstance->index.cached = true;
+}
+#endif
 
+/** FNV-1a */
+static uint32_t mp3_hash(uint32_t h, const uint8_t *p, size_t len) {
+    while(len--) {
+        h = (h ^ *p++) * 16777619u;
+    }
+    return h;
+}
+
+static bool index_append(mp3_frame_index_t *index, uint32_t offset) {
+    if(index->count == index->capacity) {
+        uint32_t capacity = index->capacity ? index->capacity * 2 : 64;
+        uint32_t *grown = static_cast<uint32_t*>(realloc(index->offset, capacity * sizeof(uint32_t)));
+        if(!grown) {
+            return false;
+        }
+        index->offset = grown;
+        index->capacity = capacity;
+    }
+    index->offset[index->count++] = offset;
+    return true;
+}
+
+/** Turn the VBRI table of compressed sizes into offsets */
+static void index_from_vbri(mp3_instance *pInstance, const mp3_info_tag_t *tag) {
+    mp3_frame_index_t *index = &pInstance->index;
+    uint32_t offset = pInstance->audio_start;
+
+    index->step = tag->vbri_frames_per_entry;
+    for(int n = 0; n < tag->vbri_entries; n++) {
+        if(!index_append(index, offset)) {
+            break;
+        }
+        const uint8_t *e = tag->vbri_toc + n * tag->vbri_entry_size;
+        uint32_t size = 0;
+        for(int b = 0; b < tag->vbri_entry_size; b++) {
+            size = (size << 8) | e[b];
+        }
+        offset += size * tag->vbri_scale;
+    }
+    index->complete = true;
+}
+
+static void mp3_fill(FILE *fp, mp3_instance *pInstance) {
     size_t unread_bytes = pInstance->bytes_in_data_buf - (pInstance->read_ptr - pInstance->data_buf);
+    uint8_t *write_ptr = pInstance->data_buf + unread_bytes;
+    size_t free_space = pInstance->data_buf_size - unread_bytes;
 
-    /* somewhat arbitrary trigger to refill buffer - should always be enough for a full frame */
-    if (unread_bytes < 1.25 * MAINBUF_SIZE && !pInstance->eof_reached) {
-        uint8_t *write_ptr = pInstance->data_buf + unread_bytes;
-        size_t free_space = pInstance->data_buf_size - unread_bytes;
+    /* move last, small chunk from end of buffer to start,
+       then fill with new data */
+    pInstance->buf_pos += pInstance->read_ptr - pInstance->data_buf;
+    memmove(pInstance->data_buf, pInstance->read_ptr, unread_bytes);
+
+    size_t nRead = fread(write_ptr, 1, free_space, fp);
+
+    pInstance->bytes_in_data_buf = unread_bytes + nRead;
+    pInstance->read_ptr = pInstance->data_buf;
+
+    if ((nRead == 0) || feof(fp)) {
+        pInstance->eof_reached = true;
+    }
+
+    LOGI_2("pos %ld, nRead %d, eof %d", ftell(fp), nRead, pInstance->eof_reached);
+}
+
+void mp3_stop(mp3_instance *pInstance) {
+    mp3_frame_index_t *index = &pInstance->index;
+    if(!index->cached) {
+        free(index->offset);
+    }
+    free(index->scan_buf);
+    memset(index, 0, sizeof(*index));
+}
+
+void mp3_start(FILE *fp, mp3_instance *pInstance) {
+    mp3_stop(pInstance);
+
+    pInstance->bytes_in_data_buf = 0;
+    pInstance->read_ptr = pInstance->data_buf;
+    pInstance->eof_reached = false;
+    pInstance->skip_frames = 0;
+    pInstance->valid_frames = 0;
+    pInstance->frames_out = 0;
+    pInstance->sample_rate = 0;
+    pInstance->samples_per_frame = 0;
+    pInstance->bitrate = 0;
+    pInstance->total_frames = 0;
+    pInstance->delay = 0;
+    pInstance->cbr = false;
+    pInstance->has_toc = false;
+    pInstance->toc_bytes = 0;
+    pInstance->discard_frames = 0;
+    pInstance->resync = false;
+
+    // skip an ID3v2 tag, a sync word inside of it would be taken for the first frame
+    mp3_id3_header_v2_t tag;
+    long offset = 0;
+    fseek(fp, 0, SEEK_SET);
+    if((sizeof(tag) == fread(&tag, 1, sizeof(tag), fp)) && (memcmp("ID3", tag.header, sizeof(tag.header)) == 0)) {
+        offset = ((long)(tag.size[0] & 0x7f) << 21) | ((tag.size[1] & 0x7f) << 14) |
+                 ((tag.size[2] & 0x7f) << 7) | (tag.size[3] & 0x7f);
+        offset += sizeof(tag);
+        // footer present
+        if(tag.flag & 0x10) {
+            offset += sizeof(tag);
+        }
+        LOGI_1("skipping %ld byte ID3v2 tag", offset);
+    }
+
+    // the audio ends where an ID3v1 tag starts
+    char v1[3] = { 0 };
+    fseek(fp, 0, SEEK_END);
+    long size = ftell(fp);
+    pInstance->audio_end = size;
+    if(size >= (long)sizeof(mp3_id3_header_v1_t) + offset) {
+        fseek(fp, size - sizeof(mp3_id3_header_v1_t), SEEK_SET);
+        if(sizeof(v1) == fread(v1, 1, sizeof(v1), fp) && memcmp(v1, "TAG", sizeof(v1)) == 0) {
+            pInstance->audio_end -= sizeof(mp3_id3_header_v1_t);
+        }
+    }
+
+    fseek(fp, offset, SEEK_SET);
+    pInstance->buf_pos = offset;
+    mp3_fill(fp, pInstance);
+
+    // the first frame, which may be a Xing / VBRI tag instead of audio
+    uint8_t *frame = NULL;
+    uint8_t *end = pInstance->data_buf + pInstance->bytes_in_data_buf;
+    for(uint8_t *p = pInstance->data_buf; p < end; p++) {
+        int sync = MP3FindSyncWord(p, end - p);
+        if(sync < 0) {
+            break;
+        }
+        p += sync;
+        if(mp3_check_sync(p, end - p, 0)) {
+            frame = p;
+            break;
+        }
+    }
+    if(!frame) {
+        // leave it to decode_mp3() to drop what is not an mp3 frame
+        LOGI_1("no frame in the first %d bytes", (int)pInstance->bytes_in_data_buf);
+        pInstance->audio_start = offset;
+        return;
+    }
+    pInstance->read_ptr = frame;
+    pInstance->tag_start = pInstance->buf_pos + (frame - pInstance->data_buf);
+
+    mp3_info_tag_t info;
+    size_t tag_len = 0;
+    bool tagged = mp3_parse_info_tag(frame, end - frame, &info, &tag_len);
+    if(tagged) {
+        // the tag frame carries no audio but tells how much of it to play
+        pInstance->read_ptr = frame + tag_len;
+    }
+    pInstance->audio_start = pInstance->buf_pos + (pInstance->read_ptr - pInstance->data_buf);
+
+    mp3_frame_header_t fh;
+    uint8_t *first = pInstance->read_ptr;
+    if(!(first + 4 <= end && mp3_frame_header(first, &fh))) {
+        mp3_frame_header(frame, &fh);
+    }
+    pInstance->sample_rate = fh.sample_rate;
+    pInstance->samples_per_frame = fh.samples;
+    pInstance->bitrate = fh.bitrate;
 
-    	/* move last, small chunk from end of buffer to start,
-           then fill with new data */
-        memmove(pInstance->data_buf, pInstance->read_ptr, unread_bytes);
+    if(tagged) {
+        pInstance->total_frames = info.frames;
+        pInstance->cbr = info.cbr;
+        if(info.lame) {
+            uint64_t total = (uint64_t)info.frames * fh.samples;
 
-        size_t nRead = fread(write_ptr, 1, free_space, fp);
+            pInstance->delay = info.enc_delay + MP3_DECODER_DELAY;
+            pInstance->skip_frames = pInstance->delay;
+            if(total > (uint64_t)info.enc_delay + info.enc_padding) {
+                pInstance->valid_frames = total - info.enc_delay - info.enc_padding;
+            }
+        }
+        if(info.toc) {
+            pInstance->has_toc = true;
+            memcpy(pInstance->toc, info.toc, sizeof(pInstance->toc));
+            pInstance->toc_bytes = info.bytes ? info.bytes : pInstance->audio_end - pInstance->tag_start;
+        }
+        if(info.vbri && info.vbri_entries) {
+            index_from_vbri(pInstance, &info);
+        }
+    }
 
-        pInstance->bytes_in_data_buf = unread_bytes + nRead;
-        pInstance->read_ptr = pInstance->data_buf;
+    // without a TOC nor a constant bitrate the frame headers get scanned for an index
+    mp3_frame_index_t *index = &pInstance->index;
+    if(!pInstance->has_toc && !pInstance->cbr && !index->complete) {
+        uint8_t mid[32];
+        uint32_t key = mp3_hash(2166136261u, reinterpret_cast<uint8_t*>(&size), sizeof(size));
+        key = mp3_hash(key, pInstance->read_ptr, (end - pInstance->read_ptr) < 64 ? end - pInstance->read_ptr : 64);
+        long resume = ftell(fp);
+        fseek(fp, size / 2, SEEK_SET);
+        key = mp3_hash(key, mid, fread(mid, 1, sizeof(mid), fp));
+        fseek(fp, resume, SEEK_SET);
 
-        if ((nRead == 0) || feof(fp)) {
-            pInstance->eof_reached = true;
+        index->key = key;
+        index->exact = true;
+        index->step = MP3_INDEX_STEP;
+        index->scan_pos = pInstance->audio_start;
+#if CONFIG_AUDIO_PLAYER_MP3_INDEX_CACHE > 0
+        mp3_index_cache_entry_t *cached = index_cache_find(key, pInstance->audio_end);
+        if(cached) {
+            LOGI_1("frame index from cache, %u frames", (unsigned)cached->frames);
+            *index = cached->index;
+            index->cached = true;
+            if(!pInstance->total_frames) {
+                pInstance->total_frames = cached->frames;
+            }
         }
+#endif
+    }
 
-        LOGI_2("pos %ld, nRead %d, eof %d", ftell(fp), nRead, pInstance->eof_reached);
+    LOGI_1("audio at %ld - %ld, %u Hz, %u kbps, %u frames, toc %d, index %u/%d",
+           pInstance->audio_start, pInstance->audio_end, (unsigned)pInstance->sample_rate,
+           (unsigned)(pInstance->bitrate / 1000), (unsigned)pInstance->total_frames,
+           pInstance->has_toc, (unsigned)index->count, index->complete);
+}
+
+bool mp3_index_step(FILE *fp, mp3_instance *pInstance) {
+    mp3_frame_index_t *index = &pInstance->index;
+    if(!index->exact || index->complete) {
+        return false;
+    }
+    if(!index->scan_buf) {
+        index->scan_buf = static_cast<uint8_t*>(malloc(MP3_INDEX_BLOCK));
+        if(!index->scan_buf) {
+            return false;
+        }
+    }
+
+    long resume = ftell(fp);
+    for(int block = 0; block < MP3_INDEX_BLOCKS && !index->complete; block++) {
+        fseek(fp, index->scan_pos, SEEK_SET);
+        size_t len = fread(index->scan_buf, 1, MP3_INDEX_BLOCK, fp);
+        if(len > (size_t)(pInstance->audio_end - index->scan_pos)) {
+            len = pInstance->audio_end - index->scan_pos;
+        }
 
+        size_t pos = 0;
+        while(pos + 4 <= len) {
+            mp3_frame_header_t fh;
+            if(!mp3_frame_header(index->scan_buf + pos, &fh) || fh.sample_rate != pInstance->sample_rate) {
+                // junk between frames, look for the next header
+                pos++;
+                continue;
+            }
+            if((index->scan_frames % index->step) == 0 &&
+               !index_append(index, index->scan_pos + pos)) {
+                // out of memory: keep seeking on the estimates
+                ESP_LOGE(TAG, "frame index stopped at %u frames", (unsigned)index->scan_frames);
+                free(index->offset);
+                free(index->scan_buf);
+                memset(index, 0, sizeof(*index));
+                fseek(fp, resume, SEEK_SET);
+                return false;
+            }
+            index->scan_frames++;
+            pos += fh.length;
+        }
+        index->scan_pos += pos;
+        if(len < MP3_INDEX_BLOCK || index->scan_pos + 4 > pInstance->audio_end) {
+            index->complete = true;
+        }
+    }
+    fseek(fp, resume, SEEK_SET);
+
+    if(!index->complete) {
+        return false;
+    }
+
+    free(index->scan_buf);
+    index->scan_buf = NULL;
+    if(!pInstance->total_frames) {
+        pInstance->total_frames = index->scan_frames;
+    }
+    LOGI_1("frame index complete, %u frames in %u entries",
+           (unsigned)index->scan_frames, (unsigned)index->count);
+#if CONFIG_AUDIO_PLAYER_MP3_INDEX_CACHE > 0
+    index_cache_add(pInstance);
+#endif
+    return true;
+}
+
+uint32_t mp3_duration_ms(const mp3_instance *pInstance) {
+    if(!pInstance->sample_rate) {
+        return 0;
+    }
+    if(pInstance->total_frames) {
+        // decoding ends with the last frame, short of the final decoder delay
+        uint64_t frames = (uint64_t)pInstance->total_frames * pInstance->samples_per_frame;
+        frames = (frames > pInstance->delay) ? frames - pInstance->delay : 0;
+        if(pInstance->valid_frames && pInstance->valid_frames < frames) {
+            frames = pInstance->valid_frames;
+        }
+        return frames * 1000 / pInstance->sample_rate;
+    }
+    if(pInstance->valid_frames) {
+        return pInstance->valid_frames * 1000 / pInstance->sample_rate;
+    }
+    if(pInstance->bitrate) {
+        return (uint64_t)(pInstance->audio_end - pInstance->audio_start) * 8000 / pInstance->bitrate;
+    }
+    return 0;
+}
+
+bool mp3_seek(FILE *fp, mp3_instance *pInstance, uint32_t position_ms, uint32_t *actual_ms) {
+    if(!pInstance->sample_rate) {
+        return false;
+    }
+
+    uint32_t spf = pInstance->samples_per_frame;
+    uint64_t target = (uint64_t)position_ms * pInstance->sample_rate / 1000;
+    if(pInstance->valid_frames && target > pInstance->valid_frames) {
+        target = pInstance->valid_frames;
+    }
+
+    // frames with a VBR stream's lower bitrates hold less of the reservoir
+    uint32_t frame_len = spf / 8 * pInstance->bitrate / pInstance->sample_rate;
+    if(!pInstance->cbr) {
+        frame_len /= 2;
+    }
+    uint32_t prime = 1 + (MP3_RESERVOIR_BYTES + frame_len - 1) / (frame_len ? frame_len : 1);
+    if(prime > MP3_SEEK_PRIME_MAX) {
+        prime = MP3_SEEK_PRIME_MAX;
+    }
+
+    // the mp3 frame whose output holds the target, and the one decoding starts at
+    uint64_t sample = target + pInstance->delay;
+    uint32_t frame = sample / spf;
+    uint32_t first = (frame > prime) ? frame - prime : 0;
+    uint64_t offset;
+
+    const mp3_frame_index_t *index = &pInstance->index;
+    if(index->exact && index->count && (first / index->step) < index->count) {
+        // decode from the indexed frame, at most step frames ahead of the target
+        uint32_t e = first / index->step;
+        offset = index->offset[e];
+        first = e * index->step;
+    } else if(pInstance->cbr) {
+        // frames are padded to keep the stream at the nominal bitrate, back off
+        // a little so that the resync finds the header of this very frame
+        offset = pInstance->audio_start + (uint64_t)first * spf * (pInstance->bitrate / 8) / pInstance->sample_rate;
+        offset = (offset > 4) ? offset - 4 : 0;
+    } else if(pInstance->has_toc && pInstance->total_frames) {
+        // percent of the duration, 8 fractional bits, interpolated between TOC entries
+        uint32_t pct = ((uint64_t)first * 100 * 256) / pInstance->total_frames;
+        uint32_t i = pct >> 8;
+        if(i > 99) {
+            i = 99;
+            pct = 99 << 8 | 255;
+        }
+        uint32_t a = pInstance->toc[i];
+        uint32_t b = (i < 99) ? pInstance->toc[i + 1] : 256;
+        uint32_t pos = a * 256 + (b - a) * (pct & 0xff);
+        offset = pInstance->tag_start + (uint64_t)pos * pInstance->toc_bytes / (256 * 256);
+    } else if(!index->exact && index->count) {
+        // VBRI: sizes of each step frames, interpolated inside of an entry
+        uint32_t e = first / index->step;
+        if(e >= index->count) {
+            e = index->count - 1;
+        }
+        uint32_t next = (e + 1 < index->count) ? index->offset[e + 1] : pInstance->audio_end;
+        uint32_t into = first - e * index->step;
+        if(into > index->step) {
+            into = index->step;
+        }
+        offset = index->offset[e] + (uint64_t)(next - index->offset[e]) * into / index->step;
+    } else {
+        // no TOC: an estimate until the index has been scanned this far
+        offset = pInstance->audio_start + (uint64_t)first * spf * (pInstance->bitrate / 8) / pInstance->sample_rate;
+    }
+    if(offset < (uint64_t)pInstance->audio_start) {
+        offset = pInstance->audio_start;
+    }
+    if(offset > (uint64_t)pInstance->audio_end) {
+        offset = pInstance->audio_end;
+    }
+
+    if(fseek(fp, offset, SEEK_SET) != 0) {
+        return false;
+    }
+    pInstance->buf_pos = offset;
+    pInstance->bytes_in_data_buf = 0;
+    pInstance->read_ptr = pInstance->data_buf;
+    pInstance->eof_reached = false;
+
+    pInstance->resync = (offset != (uint64_t)pInstance->audio_start);
+    pInstance->discard_frames = frame - first;
+    pInstance->skip_frames = sample - (uint64_t)frame * spf;
+    pInstance->frames_out = target;
+
+    *actual_ms = target * 1000 / pInstance->sample_rate;
+    LOGI_1("seek %u ms: frame %u from %u at offset %u", (unsigned)position_ms,
+           (unsigned)frame, (unsigned)first, (unsigned)offset);
+    return true;
+}
+
+/**
+ * @return true if data remains, false on error or end of file
+ */
+DECODE_STATUS decode_mp3(HMP3Decoder mp3_decoder, FILE *fp, decode_data *pData, mp3_instance *pInstance) {
+    MP3FrameInfo frame_info;
+
+    size_t unread_bytes = pInstance->bytes_in_data_buf - (pInstance->read_ptr - pInstance->data_buf);
+
+    /* somewhat arbitrary trigger to refill buffer - should always be enough for a full frame */
+    if (unread_bytes < 1.25 * MAINBUF_SIZE && !pInstance->eof_reached) {
+        mp3_fill(fp, pInstance);
         unread_bytes = pInstance->bytes_in_data_buf;
     }
 
@@ -85,6 +713,11 @@ DECODE_STATUS decode_mp3(HMP3Decoder mp3_decoder, FILE *fp, decode_data *pData,
         return DECODE_STATUS_DONE;
     }
 
+    if(pInstance->valid_frames && (pInstance->frames_out >= pInstance->valid_frames)) {
+        LOGI_1("end of gapless audio, status done");
+        return DECODE_STATUS_DONE;
+    }
+
     /* Find MP3 sync word from read buffer */
     int offset = MP3FindSyncWord(pInstance->read_ptr, unread_bytes);
 
@@ -96,11 +729,27 @@ DECODE_STATUS decode_mp3(HMP3Decoder mp3_decoder, FILE *fp, decode_data *pData,
         uint8_t *read_ptr = pInstance->read_ptr + offset; /*!< Data start point */
         unread_bytes -= offset;
         LOGI_3("read 0x%p, unread %d", read_ptr, unread_bytes);
+
+        // after a seek the data is entered at an arbitrary byte
+        if(pInstance->resync) {
+            if(!mp3_check_sync(read_ptr, unread_bytes, pInstance->sample_rate)) {
+                pInstance->read_ptr = read_ptr + 1;
+                return DECODE_STATUS_NO_DATA_CONTINUE;
+            }
+            pInstance->resync = false;
+        }
+
         int mp3_dec_err = MP3Decode(mp3_decoder, &read_ptr, (int*)&unread_bytes, reinterpret_cast<int16_t *>(pData->samples), 
 0);
 
         pInstance->read_ptr = read_ptr;
 
+        if(pInstance->discard_frames) {
+            // frames ahead of a seek target only prime the decoder
+            pInstance->discard_frames--;
+            return DECODE_STATUS_NO_DATA_CONTINUE;
+        }
+
         if(mp3_dec_err == ERR_MP3_NONE) {
             /* Get MP3 frame info */
             MP3GetLastFrameInfo(mp3_decoder, &frame_info);
@@ -110,6 +759,14 @@ DECODE_STATUS decode_mp3(HMP3Decoder mp3_decoder, FILE *fp, decode_data *pData,
             pData->fmt.channels = frame_info.nChans;
 
             pData->frame_count = (frame_info.outputSamps / frame_info.nChans);
+            mp3_trim(pData, pInstance);
+
+            // stereo out either way, samples_capacity_max leaves room to double a mono frame in place
+            if(pData->fmt.channels == 1) {
+                int16_t *pcm = reinterpret_cast<int16_t *>(pData->samples);
+                audio_pcm_mono_to_stereo_s16(pcm, pcm, pData->frame_count);
+                pData->fmt.channels = 2;
+            }
 
             LOGI_3("mp3: channels %d, sr %d, bps %d, frame_count %d, processed %d",
                 pData->fmt.channels,
@@ -117,6 +774,10 @@ DECODE_STATUS decode_mp3(HMP3Decoder mp3_decoder, FILE *fp, decode_data *pData,
                 pData->fmt.bits_per_sample,
                 frame_info.outputSamps,
                 starting_unread_bytes - unread_bytes);
+
+            if(pData->frame_count == 0) {
+                return DECODE_STATUS_NO_DATA_CONTINUE;
+            }
         } else {
             if (pInstance->eof_reached) {
                 ESP_LOGE(TAG, "status error %d, but EOF", mp3_dec_err);
@@ -167,3 +828,135 @@ DECODE_STATUS decode_mp3(HMP3Decoder mp3_decoder, FILE *fp, decode_data *pData,
 
     return DECODE_STATUS_CONTINUE;
 }
+
+/* **************** STREAMING **************** */
+
+/** Holds the longest frame (1441 bytes) with room to see the header after it */
+#define MP3_STREAM_BUF      (2 * MAINBUF_SIZE)
+
+struct audio_mp3_stream {
+    HMP3Decoder decoder;
+    size_t fill;                /**< bytes in buf */
+    bool synced;                /**< the last frame decoded, the next header can be trusted */
+    audio_mp3_stream_stats_t stats;
+    uint8_t buf[MP3_STREAM_BUF];
+    int16_t pcm[MAX_NCHAN * MAX_NGRAN * MAX_NSAMP];
+};
+
+audio_mp3_stream_t *audio_mp3_stream_new(void) {
+    audio_mp3_stream_t *s = static_cast<audio_mp3_stream_t*>(calloc(1, sizeof(audio_mp3_stream_t)));
+    if(!s) {
+        return NULL;
+    }
+    s->decoder = MP3InitDecoder();
+    if(!s->decoder) {
+        free(s);
+        return NULL;
+    }
+    return s;
+}
+
+void audio_mp3_stream_delete(audio_mp3_stream_t *s) {
+    if(!s) {
+        return;
+    }
+    if(s->decoder) {
+        MP3FreeDecoder(s->decoder);
+    }
+    free(s);
+}
+
+void audio_mp3_stream_reset(audio_mp3_stream_t *s) {
+    // libhelix has no reset, a new decoder forgets the bit reservoir of the old stream
+    if(s->decoder) {
+        MP3FreeDecoder(s->decoder);
+    }
+    s->decoder = MP3InitDecoder();
+    s->fill = 0;
+    s->synced = false;
+}
+
+size_t audio_mp3_stream_feed(audio_mp3_stream_t *s, const uint8_t *data, size_t len, audio_mp3_stream_cb_t cb,
+                             void *arg) {
+    size_t total = 0;
+    if(!s->decoder) {
+        return 0;
+    }
+
+    // bytes before 'carried' came with an earlier piece
+    size_t carried = s->fill;
+    while(true) {
+        size_t n = (len < MP3_STREAM_BUF - s->fill) ? len : MP3_STREAM_BUF - s->fill;
+        memcpy(s->buf + s->fill, data, n);
+        s->fill += n;
+        data += n;
+        len -= n;
+
+        size_t pos = 0;
+        while(s->fill - pos >= 4) {
+            uint8_t *p = s->buf + pos;
+            size_t avail = s->fill - pos;
+            mp3_frame_header_t fh;
+            bool ok = mp3_frame_header(p, &fh);
+            if(ok && !s->synced) {
+                if((size_t)fh.length + 4 > avail) {
+                    // see the header of the next frame before trusting this one
+                    break;
+                }
+                ok = mp3_check_sync(p, avail, 0);
+            }
+            if(!ok) {
+                int offset = MP3FindSyncWord(p + 1, avail - 1);
+                size_t skip = (offset >= 0) ? offset + 1 : avail - 3;
+                s->stats.skipped += skip;
+                s->synced = false;
+                pos += skip;
+                continue;
+            }
+            if(fh.length > avail) {
+                // the rest of the frame comes with the next piece
+                break;
+            }
+            if((pos < carried) && (pos + fh.length > carried)) {
+                s->stats.split++;
+            }
+
+            unsigned char *in = p;
+            int left = avail;
+            int err = MP3Decode(s->decoder, &in, &left, s->pcm, 0);
+            if(err == ERR_MP3_NONE) {
+                MP3FrameInfo info;
+                MP3GetLastFrameInfo(s->decoder, &info);
+                size_t frames = info.outputSamps / info.nChans;
+                s->stats.frames++;
+                s->synced = true;
+                pos += fh.length;
+                if(frames) {
+                    cb(s->pcm, frames, info.samprate, info.nChans, arg);
+                    total += frames;
+                }
+            } else if(err == ERR_MP3_MAINDATA_UNDERFLOW) {
+                // the bit reservoir reaches back before the first frame we had
+                s->synced = true;
+                pos += fh.length;
+            } else {
+                LOGI_1("stream frame error %d", err);
+                s->stats.errors++;
+                s->synced = false;
+                pos += 1;
+            }
+        }
+
+        memmove(s->buf, s->buf + pos, s->fill - pos);
+        s->fill -= pos;
+        carried = (carried > pos) ? carried - pos : 0;
+        if(len == 0) {
+            break;
+        }
+    }
+    return total;
+}
+
+void audio_mp3_stream_get_stats(const audio_mp3_stream_t *s, audio_mp3_stream_stats_t *out) {
+    *out = s->stats;
+}
@@ -22,6 +22,26 @@ typedef struct {
     char size[4];       /*!< TAG size */
 } __attribute__((packed)) mp3_id3_header_v2_t;
 
+/**
+ * Sparse map from mp3 frame number to file offset, built from a VBRI table or
+ * by scanning the frame headers of files without a TOC.
+ */
+typedef struct {
+    uint32_t *offset;           /**< file offset of frame n * step */
+    uint32_t count;
+    uint32_t capacity;
+    uint32_t step;              /**< mp3 frames between entries */
+    bool exact;                 /**< offsets are frame headers, not byte estimates */
+    bool complete;              /**< covers the whole file */
+    bool cached;                /**< offset belongs to the index cache */
+    uint32_t key;               /**< identifies the file in the index cache */
+
+    /* header scan state */
+    uint8_t *scan_buf;
+    long scan_pos;              /**< file offset of the next header to visit */
+    uint32_t scan_frames;       /**< frames visited so far */
+} mp3_frame_index_t;
+
 typedef struct {
     // Constants below
     uint8_t *data_buf;
@@ -42,7 +62,97 @@ typedef struct {
 
     // set to true if the end of file has been reached
     bool eof_reached;
+
+    /**
+     * Gapless playback, from the Xing / LAME tag if the file has one.
+     * Counted in frames of decoder output (one sample per channel).
+     */
+    uint32_t skip_frames;       /**< encoder + decoder delay still to be dropped */
+    uint64_t valid_frames;      /**< frames of real audio following the delay, 0 if unknown */
+    uint64_t frames_out;        /**< frames passed on since the delay was dropped */
+
+    /** Stream layout found by mp3_start(), used for seeking */
+    long buf_pos;               /**< file offset of data_buf[0] */
+    long tag_start;             /**< file offset of the Xing / VBRI tag frame, the TOC base */
+    long audio_start;           /**< file offset of the first audio frame */
+    long audio_end;             /**< end of the audio frames, before an ID3v1 tag */
+    uint32_t sample_rate;
+    uint32_t samples_per_frame;
+    uint32_t bitrate;           /**< of the first audio frame, bits per second */
+    uint32_t total_frames;      /**< mp3 frames after the tag frame, 0 if unknown */
+    uint32_t delay;             /**< decoder output frames ahead of the first one played */
+    bool cbr;                   /**< "Info" tag, the encoder wrote a constant bitrate */
+    bool has_toc;
+    uint8_t toc[100];           /**< Xing TOC, byte position at each percent of the duration */
+    uint32_t toc_bytes;         /**< stream length the TOC is scaled to */
+    mp3_frame_index_t index;
+
+    uint32_t discard_frames;    /**< mp3 frames to decode and drop after a seek */
+    bool resync;                /**< check for a following frame before trusting a sync word */
 } mp3_instance;
 
+/** Xing / Info or VBRI tag found in place of the first audio frame */
+typedef struct {
+    uint32_t frames;            /**< audio frames in the stream (not counting this one), 0 if absent */
+    uint32_t bytes;             /**< stream length in bytes, 0 if absent */
+    bool lame;                  /**< LAME extension present, enc_delay / enc_padding valid */
+    uint16_t enc_delay;         /**< samples the encoder prepended */
+    uint16_t enc_padding;       /**< samples the encoder appended */
+    bool cbr;                   /**< "Info" rather than "Xing" */
+    const uint8_t *toc;         /**< 100 entry Xing TOC inside of the parsed buffer, NULL if absent */
+
+    bool vbri;                  /**< Fraunhofer VBRI tag, the fields below are valid */
+    uint16_t vbri_entries;
+    uint16_t vbri_scale;
+    uint16_t vbri_entry_size;   /**< bytes per entry, 1 - 4 */
+    uint16_t vbri_frames_per_entry;
+    const uint8_t *vbri_toc;    /**< compressed sizes of each vbri_frames_per_entry frames */
+} mp3_info_tag_t;
+
+/**
+ * Parse the frame at buf as a Xing / Info or VBRI tag frame.
+ *
+ * @param frame_len - set to the length of the tag frame if it is one
+ * @return true if buf holds a tag frame, which must then not be played
+ */
+bool mp3_parse_info_tag(const uint8_t *buf, size_t len, mp3_info_tag_t *tag, size_t *frame_len);
+
 bool is_mp3(FILE *fp);
+
+/**
+ * Reset pInstance for a new file, skip any ID3v2 tag and read the stream
+ * layout from the first frames.
+ */
+void mp3_start(FILE *fp, mp3_instance *pInstance);
+
+/** Release what mp3_start() allocated for the present file */
+void mp3_stop(mp3_instance *pInstance);
+
 DECODE_STATUS decode_mp3(HMP3Decoder mp3_decoder, FILE *fp, decode_data *pData, mp3_instance *pInstance);
+
+/**
+ * @return length of the stream as far as known: exact with a Xing / VBRI
+ *         frame count or a complete index, estimated from the bitrate
+ *         otherwise, 0 if unknown
+ */
+uint32_t mp3_duration_ms(const mp3_instance *pInstance);
+
+/**
+ * Reposition fp so that decode_mp3() continues at position_ms.
+ *
+ * Uses the frame index if one covers the position, else the Xing TOC or
+ * VBRI table, else the bitrate of the first frame.
+ *
+ * @param actual_ms - position decoding will continue at
+ * @return false if the stream layout is unknown
+ */
+bool mp3_seek(FILE *fp, mp3_instance *pInstance, uint32_t position_ms, uint32_t *actual_ms);
+
+/**
+ * Scan a few more frame headers into the index of a file without a TOC.
+ * Meant to be called while the decoder has nothing to do, fp is left where
+ * it was.
+ *
+ * @return true once the scan completed, mp3_duration_ms() is then exact
+ */
+bool mp3_index_step(FILE *fp, mp3_instance *pInstance);
@@ -0,0 +1,552 @@
+/**
+ * @file
+ * @version 0.1
+ *
+ * @copyright Copyright 2021 Espressif Systems (Shanghai) Co. Ltd.
+ * @copyright Copyright 2022 Chris Morgan <chmorgan@gmail.com>
+ *
+ *      Licensed under the Apache License, Version 2.0 (the "License");
+ *      you may not use this file except in compliance with the License.
+ *      You may obtain a copy of the License at
+ *
+ *               http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *      Unless required by applicable law or agreed to in writing, software
+ *      distributed under the License is distributed on an "AS IS" BASIS,
+ *      WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *      See the License for the specific language governing permissions and
+ *      limitations under the License.
+ */
+
+#include <math.h>
+#include <string.h>
+
+#include "audio_pcm.h"
+
+#define BOUNCE_BYTES    512     /**< source bytes copied out per chunk when converting in place */
+
+/** Two 16 bit samples, the first one in the low half (little-endian) */
+typedef uint32_t __attribute__((may_alias)) pcm_word_t;
+
+static inline bool word_aligned(const void *p)
+{
+    return ((uintptr_t)p & 3) == 0;
+}
+
+static inline int32_t clamp16(int32_t v)
+{
+    return (v > INT16_MAX) ? INT16_MAX : (v < INT16_MIN) ? INT16_MIN : v;
+}
+
+/** xorshift32, TPDF noise is the difference of two of its uniform halves */
+static inline uint32_t dither_next(audio_pcm_dither_t *d)
+{
+    uint32_t x = d->state ? d->state : 0x9e3779b9;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    d->state = x;
+    return x;
+}
+
+/** TPDF noise of +-1 LSB of 16 bits, in 32 bit units */
+static inline int32_t dither_s32(audio_pcm_dither_t *d)
+{
+    uint32_t r = dither_next(d);
+    return (int32_t)(r >> 16) - (int32_t)(r & 0xffff);
+}
+
+/** TPDF noise of +-1 LSB of 8 bits, in 16 bit units */
+static inline int32_t dither_s16(audio_pcm_dither_t *d)
+{
+    uint32_t r = dither_next(d);
+    return (int32_t)((r >> 24) & 0xff) - (int32_t)((r >> 16) & 0xff);
+}
+
+/**
+ * Run kernel(dst, src, n) over 'samples' source units of src_size bytes that
+ * become dst_size bytes each. With dst and src being the same buffer the
+ * source is copied out a chunk at a time, front to back when narrowing and
+ * back to front when widening, so nothing is overwritten before it is read
+ * and the kernels never see overlapping buffers.
+ */
+template<typename K>
+static void run(void *dst, size_t dst_size, const void *src, size_t src_size, size_t samples, K kernel)
+{
+    uint8_t *d = static_cast<uint8_t*>(dst);
+    const uint8_t *s = static_cast<const uint8_t*>(src);
+    if((d >= s + samples * src_size) || (s >= d + samples * dst_size)) {
+        kernel(d, s, samples);
+        return;
+    }
+
+    alignas(4) uint8_t bounce[BOUNCE_BYTES];
+    const size_t chunk = BOUNCE_BYTES / src_size;
+    if(dst_size <= src_size) {
+        for(size_t k = 0; k < samples; k += chunk) {
+            size_t n = (samples - k < chunk) ? samples - k : chunk;
+            memcpy(bounce, s + k * src_size, n * src_size);
+            kernel(d + k * dst_size, bounce, n);
+        }
+    } else {
+        for(size_t end = samples; end > 0;) {
+            size_t n = (end < chunk) ? end : chunk;
+            size_t k = end - n;
+            memcpy(bounce, s + k * src_size, n * src_size);
+            kernel(d + k * dst_size, bounce, n);
+            end = k;
+        }
+    }
+}
+
+/* **************** FORMATS **************** */
+
+size_t audio_pcm_format_bytes(audio_pcm_format_t fmt)
+{
+    switch(fmt) {
+        case AUDIO_PCM_U8:  return 1;
+        case AUDIO_PCM_S16: return 2;
+        case AUDIO_PCM_S24: return 3;
+        case AUDIO_PCM_S32: return 4;
+        case AUDIO_PCM_F32: return 4;
+        case AUDIO_PCM_ALAW:  return 1;
+        case AUDIO_PCM_MULAW: return 1;
+    }
+    return 0;
+}
+
+bool audio_pcm_format_from_wav(uint16_t format_tag, uint16_t bits_per_sample, audio_pcm_format_t *fmt)
+{
+    if(format_tag == 1) {
+        switch(bits_per_sample) {
+            case 8:  *fmt = AUDIO_PCM_U8;  return true;
+            case 16: *fmt = AUDIO_PCM_S16; return true;
+            case 24: *fmt = AUDIO_PCM_S24; return true;
+            case 32: *fmt = AUDIO_PCM_S32; return true;
+        }
+    } else if((format_tag == 3) && (bits_per_sample == 32)) {
+        *fmt = AUDIO_PCM_F32;
+        return true;
+    } else if((format_tag == 6) && (bits_per_sample == 8)) {
+        *fmt = AUDIO_PCM_ALAW;
+        return true;
+    } else if((format_tag == 7) && (bits_per_sample == 8)) {
+        *fmt = AUDIO_PCM_MULAW;
+        return true;
+    }
+    return false;
+}
+
+/* **************** G.711 **************** */
+
+/** The 16 bit value of every A-law or mu-law code, decoded as G.711 specifies */
+struct g711_table {
+    int16_t v[256];
+
+    constexpr g711_table(bool alaw) : v{}
+    {
+        for(int code = 0; code < 256; code++) {
+            int32_t t = 0;
+            if(alaw) {
+                int a = code ^ 0x55;
+                int seg = (a >> 4) & 7;
+                t = ((a & 0x0f) << 4) + 8;
+                if(seg > 0) {
+                    t = (t + 0x100) << (seg - 1);
+                }
+                v[code] = (int16_t)((a & 0x80) ? t : -t);
+            } else {
+                int u = ~code & 0xff;
+                t = (((u & 0x0f) << 3) + 0x84) << ((u >> 4) & 7);
+                v[code] = (int16_t)((u & 0x80) ? 0x84 - t : t - 0x84);
+            }
+        }
+    }
+};
+
+constexpr g711_table alaw_table(true);
+constexpr g711_table mulaw_table(false);
+
+static void g711_to_s16(int16_t *__restrict dst, const uint8_t *__restrict src, const int16_t *table, size_t n)
+{
+    for(size_t k = 0; k < n; k++) {
+        dst[k] = table[src[k]];
+    }
+}
+
+/** Segment of a magnitude: how far its top bit is above 'base' bits, 0 below */
+static inline int g711_segment(int32_t mag, int base)
+{
+    int seg = (31 - __builtin_clz((uint32_t)mag | 1)) - base + 1;
+    return (seg > 0) ? seg : 0;
+}
+
+static inline uint8_t s16_to_alaw(int16_t s)
+{
+    int32_t v = s >> 3;
+    int mask = 0xd5;
+    if(v < 0) {
+        v = -v - 1;
+        mask = 0x55;
+    }
+    int seg = g711_segment(v, 5);
+    int a = (seg << 4) | ((v >> ((seg > 1) ? seg : 1)) & 0x0f);
+    return (uint8_t)(a ^ mask);
+}
+
+static inline uint8_t s16_to_mulaw(int16_t s)
+{
+    int32_t v = s >> 2;
+    int mask = 0xff;
+    if(v < 0) {
+        v = -v;
+        mask = 0x7f;
+    }
+    // clipped one below G.711's 8159 so that the top code comes out of segment 7
+    v = ((v > 8158) ? 8158 : v) + 33;
+    int seg = g711_segment(v, 6);
+    int u = (seg << 4) | ((v >> (seg + 1)) & 0x0f);
+    return (uint8_t)(u ^ mask);
+}
+
+/* **************** TO 16 BIT **************** */
+
+static void u8_to_s16(int16_t *__restrict dst, const uint8_t *__restrict src, size_t n)
+{
+    for(size_t k = 0; k < n; k++) {
+        dst[k] = (int16_t)((src[k] - 128) * 256);
+    }
+}
+
+static inline int32_t load_s24(const uint8_t *p)
+{
+    return (int32_t)((uint32_t)p[0] << 8 | (uint32_t)p[1] << 16 | (uint32_t)p[2] << 24) >> 8;
+}
+
+static void s24_to_s16(int16_t *__restrict dst, const uint8_t *__restrict src, size_t n)
+{
+    for(size_t k = 0; k < n; k++) {
+        int32_t x = load_s24(src + 3 * k);
+        dst[k] = (int16_t)clamp16((x + 128) >> 8);
+    }
+}
+
+static void s32_to_s16(int16_t *__restrict dst, const int32_t *__restrict src, size_t n)
+{
+    for(size_t k = 0; k < n; k++) {
+        // rounded without a 64 bit add, only +32768 needs the clamp
+        int32_t v = (src[k] >> 16) + ((src[k] >> 15) & 1);
+        dst[k] = (int16_t)((v > INT16_MAX) ? INT16_MAX : v);
+    }
+}
+
+static void f32_to_s16(int16_t *__restrict dst, const float *__restrict src, size_t n)
+{
+    for(size_t k = 0; k < n; k++) {
+        // fmaxf() first also sends NaN to the floor; offset to positive so truncation rounds
+        float v = fminf(fmaxf(src[k] * 32768.0f, -32768.0f), 32767.0f);
+        dst[k] = (int16_t)((int32_t)(v + 32768.5f) - 32768);
+    }
+}
+
+/** 32 bit scale in, dither and round to 16 bits; shared by the 24 and 32 bit paths */
+static inline int16_t dither_to_s16(int32_t x, audio_pcm_dither_t *d)
+{
+    int64_t v = ((int64_t)x + dither_s32(d) + 0x8000) >> 16;
+    return (int16_t)((v > INT16_MAX) ? INT16_MAX : (v < INT16_MIN) ? INT16_MIN : v);
+}
+
+void audio_pcm_to_s16(int16_t *dst, const void *src, audio_pcm_format_t fmt, size_t samples,
+                      audio_pcm_dither_t *dither)
+{
+    const size_t size = audio_pcm_format_bytes(fmt);
+
+    switch(fmt) {
+        case AUDIO_PCM_U8:
+            run(dst, 2, src, size, samples, [](uint8_t *d, const uint8_t *s, size_t n) {
+                u8_to_s16(reinterpret_cast<int16_t*>(d), s, n);
+            });
+            break;
+        case AUDIO_PCM_S16:
+            if(dst != src) {
+                memmove(dst, src, samples * sizeof(int16_t));
+            }
+            break;
+        case AUDIO_PCM_S24:
+            if(dither) {
+                run(dst, 2, src, size, samples, [dither](uint8_t *d, const uint8_t *s, size_t n) {
+                    int16_t *out = reinterpret_cast<int16_t*>(d);
+                    for(size_t k = 0; k < n; k++) {
+                        out[k] = dither_to_s16(load_s24(s + 3 * k) * 256, dither);
+                    }
+                });
+            } else {
+                run(dst, 2, src, size, samples, [](uint8_t *d, const uint8_t *s, size_t n) {
+                    s24_to_s16(reinterpret_cast<int16_t*>(d), s, n);
+                });
+            }
+            break;
+        case AUDIO_PCM_S32:
+            if(dither) {
+                run(dst, 2, src, size, samples, [dither](uint8_t *d, const uint8_t *s, size_t n) {
+                    int16_t *out = reinterpret_cast<int16_t*>(d);
+                    const int32_t *in = reinterpret_cast<const int32_t*>(s);
+                    for(size_t k = 0; k < n; k++) {
+                        out[k] = dither_to_s16(in[k], dither);
+                    }
+                });
+            } else {
+                run(dst, 2, src, size, samples, [](uint8_t *d, const uint8_t *s, size_t n) {
+                    s32_to_s16(reinterpret_cast<int16_t*>(d), reinterpret_cast<const int32_t*>(s), n);
+                });
+            }
+            break;
+        case AUDIO_PCM_F32:
+            if(dither) {
+                run(dst, 2, src, size, samples, [dither](uint8_t *d, const uint8_t *s, size_t n) {
+                    int16_t *out = reinterpret_cast<int16_t*>(d);
+                    const float *in = reinterpret_cast<const float*>(s);
+                    for(size_t k = 0; k < n; k++) {
+                        float v = fminf(fmaxf(in[k] * 32768.0f, -32768.0f), 32767.0f);
+                        out[k] = dither_to_s16((int32_t)(v * 65536.0f), dither);
+                    }
+                });
+            } else {
+                run(dst, 2, src, size, samples, [](uint8_t *d, const uint8_t *s, size_t n) {
+                    f32_to_s16(reinterpret_cast<int16_t*>(d), reinterpret_cast<const float*>(s), n);
+                });
+            }
+            break;
+        case AUDIO_PCM_ALAW:
+        case AUDIO_PCM_MULAW: {
+            const int16_t *table = (fmt == AUDIO_PCM_ALAW) ? alaw_table.v : mulaw_table.v;
+            run(dst, 2, src, size, samples, [table](uint8_t *d, const uint8_t *s, size_t n) {
+                g711_to_s16(reinterpret_cast<int16_t*>(d), s, table, n);
+            });
+            break;
+        }
+    }
+}
+
+/* **************** FROM 16 BIT **************** */
+
+static void s16_to_u8(uint8_t *__restrict dst, const int16_t *__restrict src, size_t n)
+{
+    for(size_t k = 0; k < n; k++) {
+        int32_t v = (src[k] + 128) >> 8;
+        dst[k] = (uint8_t)(((v > INT8_MAX) ? INT8_MAX : v) + 128);
+    }
+}
+
+static void s16_to_s24(uint8_t *__restrict dst, const int16_t *__restrict src, size_t n)
+{
+    for(size_t k = 0; k < n; k++) {
+        dst[3 * k] = 0;
+        dst[3 * k + 1] = (uint8_t)src[k];
+        dst[3 * k + 2] = (uint8_t)(src[k] >> 8);
+    }
+}
+
+static void s16_to_s32(int32_t *__restrict dst, const int16_t *__restrict src, size_t n)
+{
+    for(size_t k = 0; k < n; k++) {
+        dst[k] = src[k] * 65536;
+    }
+}
+
+static void s16_to_f32(float *__restrict dst, const int16_t *__restrict src, size_t n)
+{
+    for(size_t k = 0; k < n; k++) {
+        dst[k] = src[k] * (1.0f / 32768.0f);
+    }
+}
+
+void audio_pcm_from_s16(void *dst, audio_pcm_format_t fmt, const int16_t *src, size_t samples,
+                        audio_pcm_dither_t *dither)
+{
+    const size_t size = audio_pcm_format_bytes(fmt);
+
+    switch(fmt) {
+        case AUDIO_PCM_U8:
+            if(dither) {
+                run(dst, size, src, 2, samples, [dither](uint8_t *d, const uint8_t *s, size_t n) {
+                    const int16_t *in = reinterpret_cast<const int16_t*>(s);
+                    for(size_t k = 0; k < n; k++) {
+                        int32_t v = (in[k] + dither_s16(dither) + 128) >> 8;
+                        d[k] = (uint8_t)(((v > INT8_MAX) ? INT8_MAX : (v < INT8_MIN) ? INT8_MIN : v) + 128);
+                    }
+                });
+            } else {
+                run(dst, size, src, 2, samples, [](uint8_t *d, const uint8_t *s, size_t n) {
+                    s16_to_u8(d, reinterpret_cast<const int16_t*>(s), n);
+                });
+            }
+            break;
+        case AUDIO_PCM_S16:
+            if(dst != src) {
+                memmove(dst, src, samples * sizeof(int16_t));
+            }
+            break;
+        case AUDIO_PCM_S24:
+            run(dst, size, src, 2, samples, [](uint8_t *d, const uint8_t *s, size_t n) {
+                s16_to_s24(d, reinterpret_cast<const int16_t*>(s), n);
+            });
+            break;
+        case AUDIO_PCM_S32:
+            run(dst, size, src, 2, samples, [](uint8_t *d, const uint8_t *s, size_t n) {
+                s16_to_s32(reinterpret_cast<int32_t*>(d), reinterpret_cast<const int16_t*>(s), n);
+            });
+            break;
+        case AUDIO_PCM_F32:
+            run(dst, size, src, 2, samples, [](uint8_t *d, const uint8_t *s, size_t n) {
+                s16_to_f32(reinterpret_cast<float*>(d), reinterpret_cast<const int16_t*>(s), n);
+            });
+            break;
+        case AUDIO_PCM_ALAW:
+            run(dst, size, src, 2, samples, [](uint8_t *d, const uint8_t *s, size_t n) {
+                const int16_t *in = reinterpret_cast<const int16_t*>(s);
+                for(size_t k = 0; k < n; k++) {
+                    d[k] = s16_to_alaw(in[k]);
+                }
+            });
+            break;
+        case AUDIO_PCM_MULAW:
+            run(dst, size, src, 2, samples, [](uint8_t *d, const uint8_t *s, size_t n) {
+                const int16_t *in = reinterpret_cast<const int16_t*>(s);
+                for(size_t k = 0; k < n; k++) {
+                    d[k] = s16_to_mulaw(in[k]);
+                }
+            });
+            break;
+    }
+}
+
+/* **************** CHANNELS **************** */
+
+static void mono_to_stereo(int16_t *__restrict dst, const int16_t *__restrict src, size_t n)
+{
+    if(word_aligned(dst)) {
+        pcm_word_t *out = reinterpret_cast<pcm_word_t*>(dst);
+        for(size_t k = 0; k < n; k++) {
+            uint32_t v = (uint16_t)src[k];
+            out[k] = v | (v << 16);
+        }
+    } else {
+        for(size_t k = 0; k < n; k++) {
+            dst[2 * k] = src[k];
+            dst[2 * k + 1] = src[k];
+        }
+    }
+}
+
+static void stereo_to_mono(int16_t *__restrict dst, const int16_t *__restrict src, size_t n)
+{
+    if(word_aligned(src)) {
+        const pcm_word_t *in = reinterpret_cast<const pcm_word_t*>(src);
+        for(size_t k = 0; k < n; k++) {
+            int32_t l = (int16_t)in[k];
+            int32_t r = (int32_t)in[k] >> 16;
+            dst[k] = (int16_t)((l + r) >> 1);
+        }
+    } else {
+        for(size_t k = 0; k < n; k++) {
+            dst[k] = (int16_t)((src[2 * k] + src[2 * k + 1]) >> 1);
+        }
+    }
+}
+
+void audio_pcm_mono_to_stereo_s16(int16_t *dst, const int16_t *src, size_t frames)
+{
+    run(dst, 2 * sizeof(int16_t), src, sizeof(int16_t), frames, [](uint8_t *d, const uint8_t *s, size_t n) {
+        mono_to_stereo(reinterpret_cast<int16_t*>(d), reinterpret_cast<const int16_t*>(s), n);
+    });
+}
+
+void audio_pcm_stereo_to_mono_s16(int16_t *dst, const int16_t *src, size_t frames)
+{
+    run(dst, sizeof(int16_t), src, 2 * sizeof(int16_t), frames, [](uint8_t *d, const uint8_t *s, size_t n) {
+        stereo_to_mono(reinterpret_cast<int16_t*>(d), reinterpret_cast<const int16_t*>(s), n);
+    });
+}
+
+void audio_pcm_downmix_s16(int16_t *dst, const int16_t *src, size_t channels, size_t frames)
+{
+    if(channels == 1) {
+        audio_pcm_mono_to_stereo_s16(dst, src, frames);
+        return;
+    }
+    if(channels > AUDIO_PCM_MAX_CHANNELS) {
+        return;
+    }
+    if(channels == 2) {
+        if(dst != src) {
+            memmove(dst, src, frames * 2 * sizeof(int16_t));
+        }
+        return;
+    }
+
+    // ITU-R BS.775 weights per WAV channel position, Q15
+    static const int32_t left[AUDIO_PCM_MAX_CHANNELS] = { 32768, 0, 23170, 0, 23170, 0, 23170, 0 };
+    static const int32_t right[AUDIO_PCM_MAX_CHANNELS] = { 0, 32768, 23170, 0, 0, 23170, 0, 23170 };
+    int32_t sum = 0;
+    for(size_t c = 0; c < channels; c++) {
+        sum += left[c];
+    }
+
+    struct {
+        int32_t l[AUDIO_PCM_MAX_CHANNELS];
+        int32_t r[AUDIO_PCM_MAX_CHANNELS];
+        size_t channels;
+    } g;
+    for(size_t c = 0; c < channels; c++) {
+        g.l[c] = (int32_t)(((int64_t)left[c] << 15) / sum);
+        g.r[c] = (int32_t)(((int64_t)right[c] << 15) / sum);
+    }
+    g.channels = channels;
+
+    run(dst, 2 * sizeof(int16_t), src, channels * sizeof(int16_t), frames, [&g](uint8_t *d, const uint8_t *s, size_t n) {
+        int16_t *out = reinterpret_cast<int16_t*>(d);
+        const int16_t *in = reinterpret_cast<const int16_t*>(s);
+        for(size_t k = 0; k < n; k++) {
+            const int16_t *x = in + k * g.channels;
+            int32_t l = 0, r = 0;
+            for(size_t c = 0; c < g.channels; c++) {
+                l += x[c] * g.l[c];
+                r += x[c] * g.r[c];
+            }
+            out[2 * k] = (int16_t)clamp16(l >> 15);
+            out[2 * k + 1] = (int16_t)clamp16(r >> 15);
+        }
+    });
+}
+
+void audio_pcm_interleave_s16(int16_t *dst, const int16_t *left, const int16_t *right, size_t frames)
+{
+    if(word_aligned(dst)) {
+        pcm_word_t *out = reinterpret_cast<pcm_word_t*>(dst);
+        for(size_t k = 0; k < frames; k++) {
+            out[k] = (uint32_t)(uint16_t)left[k] | ((uint32_t)(uint16_t)right[k] << 16);
+        }
+    } else {
+        for(size_t k = 0; k < frames; k++) {
+            dst[2 * k] = left[k];
+            dst[2 * k + 1] = right[k];
+        }
+    }
+}
+
+void audio_pcm_deinterleave_s16(int16_t *left, int16_t *right, const int16_t *src, size_t frames)
+{
+    if(word_aligned(src)) {
+        const pcm_word_t *in = reinterpret_cast<const pcm_word_t*>(src);
+        for(size_t k = 0; k < frames; k++) {
+            left[k] = (int16_t)in[k];
+            right[k] = (int16_t)(in[k] >> 16);
+        }
+    } else {
+        for(size_t k = 0; k < frames; k++) {
+            left[k] = src[2 * k];
+            right[k] = src[2 * k + 1];
+        }
+    }
+}
@@ -25,12 +25,15 @@
 #include <string.h>
 #include <sys/unistd.h>
 #include <sys/stat.h>
+#include <atomic>
 
 #include "esp_check.h"
 #include "esp_log.h"
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
 #include "freertos/queue.h"
+#include "freertos/semphr.h"
+#include "freertos/ringbuf.h"
 
 #include "sdkconfig.h"
 
@@ -48,6 +51,7 @@ typedef enum {
     AUDIO_PLAYER_REQUEST_PLAY,               /**< initiate playing a new file */
     AUDIO_PLAYER_REQUEST_STOP,               /**< stop playback */
     AUDIO_PLAYER_REQUEST_SHUTDOWN_THREAD,    /**< shutdown audio playback thread */
+    AUDIO_PLAYER_REQUEST_SEEK,               /**< continue the present file elsewhere */
     AUDIO_PLAYER_REQUEST_MAX
 } audio_player_event_type_t;
 
@@ -56,8 +60,38 @@ typedef struct {
 
     // valid if type == AUDIO_PLAYER_EVENT_TYPE_PLAY
     FILE* fp;
+
+    // valid if type == AUDIO_PLAYER_REQUEST_SEEK
+    uint32_t position_ms;
 } audio_player_event_t;
 
+/**
+ * The ring is sized for the largest format the decoders emit, so that
+ * CONFIG_AUDIO_PLAYER_PCM_RING_MS is a lower bound on the buffered time.
+ */
+#define PCM_RING_SIZING_RATE    48000
+#define PCM_RING_POLL_MS        10      /**< writer / decoder wake-up period while waiting on the ring */
+#define PCM_RING_PREFILL_DIV    2       /**< writer starts once 1/N of the ring is filled */
+
+#define PCM_CHUNK_EOS           (1 << 0)
+#define PCM_CHUNK_TRACK         (1 << 1)    /**< boundary to a track queued through next_cb */
+#define PCM_CHUNK_POSITION      (1 << 2)    /**< pcm_chunk_pos_t, the following audio starts there */
+#define PCM_CHUNK_SEEK          (1 << 3)    /**< with PCM_CHUNK_POSITION: same file, keep the clock */
+
+/** Header in front of every item in the pcm ring */
+typedef struct {
+    uint32_t generation;    /**< items from an older generation are discarded by the writer */
+    uint32_t flags;
+    format fmt;
+} pcm_chunk_hdr_t;
+
+/** Payload of a PCM_CHUNK_POSITION chunk */
+typedef struct {
+    uint32_t position_ms;
+    uint32_t duration_ms;
+    uint32_t file_seq;      /**< tells apart files, for later duration updates */
+} pcm_chunk_pos_t;
+
 typedef enum {
     FILE_TYPE_UNKNOWN,
 #if defined(CONFIG_AUDIO_PLAYER_ENABLE_MP3)
@@ -84,8 +118,43 @@ typedef struct audio_instance {
     void *audio_cb_usrt_ctx;
     audio_player_state_t state;
 
+    /* **************** GAPLESS NEXT TRACK **************** */
+    audio_player_next_cb_t next_cb;
+    void *next_cb_ctx;
+    uint32_t tracks_queued;                 /**< track boundaries pushed into the ring */
+    std::atomic<uint32_t> tracks_started;   /**< ... the writer has played through */
+    uint32_t tracks_reported;               /**< ... and reported via COMPLETED_PLAYING_NEXT */
+
+    /* **************** POSITION / SEEK **************** */
+    FILE *fp;                           /**< file being decoded */
+    FILE_TYPE file_type;
+    uint32_t decode_seq;                /**< file_seq of fp */
+    std::atomic<uint32_t> play_seq;     /**< file_seq of the audio being written */
+    std::atomic<uint32_t> position_ms;  /**< of the last PCM_CHUNK_POSITION the writer passed */
+    std::atomic<uint32_t> position_frames; /**< frames written since then */
+    std::atomic<uint32_t> duration_ms;  /**< of the audio being written, 0 if unknown */
+
     audio_player_config_t config;
 
+    /* ************* DECODE-AHEAD PCM RING ************* */
+    RingbufHandle_t pcm_ring;
+    size_t pcm_ring_size;
+    TaskHandle_t writer_task;
+    SemaphoreHandle_t eos_done;         /**< given by the writer when it reaches an EOS chunk */
+    std::atomic<uint32_t> generation;   /**< bumped whenever buffered audio is thrown away */
+    std::atomic<bool> streaming;        /**< writer may drain the ring */
+    std::atomic<bool> paused;
+    std::atomic<bool> writer_exit;
+    std::atomic<esp_err_t> writer_err;
+
+    /* statistics, bytes_in/bytes_out count pcm payload and may wrap */
+    std::atomic<uint32_t> bytes_in;
+    std::atomic<uint32_t> bytes_out;
+    std::atomic<uint32_t> fill_min;
+    std::atomic<uint32_t> underruns;
+    uint64_t bytes_written;
+    format out_fmt;                     /**< format last configured via clk_set_fn */
+
 #if defined(CONFIG_AUDIO_PLAYER_ENABLE_WAV)
     wav_instance wav_data;
 #endif
@@ -117,6 +186,14 @@ esp_err_t audio_player_callback_register(audio_player_cb_t call_back, void *user
     return ESP_OK;
 }
 
+esp_err_t audio_player_next_register(audio_player_next_cb_t next_cb, void *user_ctx)
+{
+    instance.next_cb_ctx = user_ctx;
+    instance.next_cb = next_cb;
+
+    return ESP_OK;
+}
+
 // This function is used in some optional logging functions so we don't want to
 // have a cppcheck warning here
 // cppcheck-suppress unusedFunction
@@ -191,153 +268,364 @@ static void audio_instance_init(audio_instance_t &i) {
     i.s_audio_cb = NULL;
     i.audio_cb_usrt_ctx = NULL;
     i.state = AUDIO_PLAYER_STATE_IDLE;
+
+    i.next_cb = NULL;
+    i.next_cb_ctx = NULL;
+    i.tracks_queued = 0;
+    i.tracks_started = 0;
+    i.tracks_reported = 0;
+
+    i.fp = NULL;
+    i.file_type = FILE_TYPE_UNKNOWN;
+    i.decode_seq = 0;
+    i.play_seq = 0;
+    i.position_ms = 0;
+    i.position_frames = 0;
+    i.duration_ms = 0;
+
+    i.pcm_ring = NULL;
+    i.pcm_ring_size = 0;
+    i.writer_task = NULL;
+    i.eos_done = NULL;
+    i.generation = 0;
+    i.streaming = false;
+    i.paused = false;
+    i.writer_exit = false;
+    i.writer_err = ESP_OK;
+    i.bytes_in = 0;
+    i.bytes_out = 0;
+    i.fill_min = 0;
+    i.underruns = 0;
+    i.bytes_written = 0;
+    memset(&i.out_fmt, 0, sizeof(i.out_fmt));
 }
 
-static esp_err_t mono_to_stereo(uint32_t output_bits_per_sample, decode_data &adata)
+static uint32_t pcm_fill(const audio_instance_t *i)
 {
-    size_t data = adata.frame_count * (output_bits_per_sample / BITS_PER_BYTE);
-    data *= 2;
+    return i->bytes_in - i->bytes_out;
+}
 
-    // do we have enough space in the output buffer to convert mono to stereo?
-    if(data > adata.samples_capacity_max) {
-        ESP_LOGE(TAG, "insufficient space in output.samples to convert mono to stereo, need %d, have %d", data, adata.samples_capacity_max);
-        return ESP_ERR_NO_MEM;
+/**
+ * Tracks continued through next_cb are only announced once the writer gets
+ * to them, that is when they become audible.
+ */
+static void report_track_changes(audio_instance_t *i)
+{
+    // a seek may have moved tracks_started past a boundary still in the writer's hands
+    while((int32_t)(i->tracks_started - i->tracks_reported) > 0) {
+        i->tracks_reported++;
+        dispatch_callback(i, AUDIO_PLAYER_CALLBACK_EVENT_COMPLETED_PLAYING_NEXT);
     }
+}
+
+static void seek_file(audio_instance_t *i, uint32_t position_ms);
+
+/**
+ * Handle pending requests while a file is being played.
+ *
+ * PAUSE blocks here until the playback is resumed, stopped or replaced, the
+ * writer holds off for as long as i->paused is set so the buffered audio is
+ * kept for the resume.
+ *
+ * SEEK is carried out right here, i->generation changes if it succeeded.
+ *
+ * @return true if the current file should be abandoned (STOP or PLAY pending,
+ *         left on the queue for audio_task)
+ */
+static bool process_events(audio_instance_t *i)
+{
+    audio_player_event_t audio_event;
+
+    report_track_changes(i);
+
+    while (pdPASS == xQueuePeek(i->event_queue, &audio_event, 0)) {
+        LOGI_2("event in queue");
+        if (AUDIO_PLAYER_REQUEST_PAUSE == audio_event.type) {
+            // receive the pause event to take it off of the queue
+            xQueueReceive(i->event_queue, &audio_event, 0);
+
+            i->paused = true;
+            set_state(i, AUDIO_PLAYER_STATE_PAUSE);
+
+            // wait until an event is received that will cause playback to resume,
+            // stop, or change file
+            while(1) {
+                xQueuePeek(i->event_queue, &audio_event, portMAX_DELAY);
+
+                if(AUDIO_PLAYER_REQUEST_SEEK == audio_event.type) {
+                    // stay paused at the new position
+                    xQueueReceive(i->event_queue, &audio_event, 0);
+                    seek_file(i, audio_event.position_ms);
+                } else if((AUDIO_PLAYER_REQUEST_PLAY != audio_event.type) &&
+                   (AUDIO_PLAYER_REQUEST_STOP != audio_event.type) &&
+                   (AUDIO_PLAYER_REQUEST_RESUME != audio_event.type))
+                {
+                    // receive to discard the event
+                    xQueueReceive(i->event_queue, &audio_event, 0);
+                } else {
+                    break;
+                }
+            }
+
+            if(AUDIO_PLAYER_REQUEST_RESUME == audio_event.type) {
+                // receive to discard the event
+                xQueueReceive(i->event_queue, &audio_event, 0);
+                i->paused = false;
+                set_state(i, AUDIO_PLAYER_STATE_PLAYING);
+                xTaskNotifyGive(i->writer_task);
+                continue;
+            }
 
-    size_t new_sample_count = adata.frame_count * 2;
+            // else fall out of this condition and let the below logic
+            // handle the other event types
+        }
 
-    // convert from back to front to allow conversion in-place
-    //
-    // NOTE: -1 is because we want to shift to the sample at position X
-    //       but if we do (ptr + X) we end up at the sample at index X instead
-    //       which is one further
-    int16_t *out = reinterpret_cast<int16_t*>(adata.samples) + (new_sample_count - 1);
-    int16_t *in = reinterpret_cast<int16_t*>(adata.samples) + (adata.frame_count - 1);
-    size_t samples = adata.frame_count;
-    while(samples) {
-        // write right channel
-        *out = *in;
-        out--;
+        if ((AUDIO_PLAYER_REQUEST_STOP == audio_event.type) ||
+            (AUDIO_PLAYER_REQUEST_PLAY == audio_event.type)) {
+            return true;
+        }
 
-        // write left channel
-        *out = *in;
-        out--;
+        if (AUDIO_PLAYER_REQUEST_SEEK == audio_event.type) {
+            xQueueReceive(i->event_queue, &audio_event, 0);
+            seek_file(i, audio_event.position_ms);
+            continue;
+        }
 
-        // move input buffer back and decrement samples
-        in--;
-        samples--;
+        // receive to discard the event, this event has no
+        // impact on the state of playback
+        xQueueReceive(i->event_queue, &audio_event, 0);
     }
 
-    // adjust channels to 2
-    adata.fmt.channels = 2;
+    return false;
+}
 
-    return ESP_OK;
+static void pcm_start_streaming(audio_instance_t *i)
+{
+    if(!i->streaming) {
+        LOGI_2("pcm ring primed, %u bytes", (unsigned)pcm_fill(i));
+        i->streaming = true;
+        xTaskNotifyGive(i->writer_task);
+    }
 }
 
-static esp_err_t aplay_file(audio_instance_t *i, FILE *fp)
+/**
+ * Work for the audio task while it waits on the writer, not urgent for the
+ * file being decoded.
+ */
+static void idle_work(audio_instance_t *i)
 {
-    LOGI_1("start to decode");
+#if defined(CONFIG_AUDIO_PLAYER_ENABLE_MP3)
+    if(i->file_type == FILE_TYPE_MP3 && mp3_index_step(i->fp, &i->mp3_data)) {
+        uint32_t duration = mp3_duration_ms(&i->mp3_data);
+        LOGI_1("duration %u ms", (unsigned)duration);
+        if(i->play_seq == i->decode_seq) {
+            i->duration_ms = duration;
+        }
+    }
+#endif
+}
 
-    format i2s_format;
-    memset(&i2s_format, 0, sizeof(i2s_format));
+static void pcm_put(audio_instance_t *i, void *item, const format &fmt, const void *data, size_t len, uint32_t flags)
+{
+    pcm_chunk_hdr_t *hdr = static_cast<pcm_chunk_hdr_t*>(item);
+    hdr->generation = i->generation;
+    hdr->flags = flags;
+    hdr->fmt = fmt;
+    if(len) {
+        memcpy(hdr + 1, data, len);
+    }
+    xRingbufferSendComplete(i->pcm_ring, item);
+    i->bytes_in += len;
+}
 
-    esp_err_t ret = ESP_OK;
-    audio_player_event_t audio_event = { .type = AUDIO_PLAYER_REQUEST_NONE, .fp = NULL };
+/**
+ * Queue a chunk for the writer task, blocking while the ring is full.
+ *
+ * @return
+ *    - ESP_OK: chunk queued
+ *    - ESP_ERR_INVALID_STATE: playback of this file was stopped or replaced
+ *    - ESP_ERR_NOT_FINISHED: the file was seeked meanwhile, the chunk is stale and was dropped
+ */
+static esp_err_t pcm_push(audio_instance_t *i, const format &fmt, const void *data, size_t len, uint32_t flags)
+{
+    uint32_t generation = i->generation;
+    void *item = NULL;
+    while(pdTRUE != xRingbufferSendAcquire(i->pcm_ring, &item, sizeof(pcm_chunk_hdr_t) + len,
+                                           pdMS_TO_TICKS(PCM_RING_POLL_MS))) {
+        if(process_events(i)) {
+            return ESP_ERR_INVALID_STATE;
+        }
+        if(generation != i->generation) {
+            return ESP_ERR_NOT_FINISHED;
+        }
 
-    FILE_TYPE file_type = FILE_TYPE_UNKNOWN;
+        // a fragmented ring can be full below the prefill level
+        pcm_start_streaming(i);
+        idle_work(i);
+    }
 
-#if defined(CONFIG_AUDIO_PLAYER_ENABLE_MP3)
-    if(is_mp3(fp)) {
-        file_type = FILE_TYPE_MP3;
-        LOGI_1("file is mp3");
+    pcm_put(i, item, fmt, data, len, flags);
 
-        // initialize mp3_instance
-        i->mp3_data.bytes_in_data_buf = 0;
-        i->mp3_data.read_ptr = i->mp3_data.data_buf;
-        i->mp3_data.eof_reached = false;
+    if(pcm_fill(i) >= i->pcm_ring_size / PCM_RING_PREFILL_DIV) {
+        pcm_start_streaming(i);
     }
-#endif
 
-#if defined(CONFIG_AUDIO_PLAYER_ENABLE_WAV)
-    // This can be a pointless condition depending on the build options, no reason to warn about it
-    // cppcheck-suppress knownConditionTrueFalse
-    if(file_type == FILE_TYPE_UNKNOWN)
-    {
-        if(is_wav(fp, &i->wav_data)) {
-            file_type = FILE_TYPE_WAV;
-            LOGI_1("file is wav");
+    return ESP_OK;
+}
+
+/**
+ * Wait for the writer to play out everything decoded so far.
+ *
+ * @return same as pcm_push()
+ */
+static esp_err_t pcm_drain(audio_instance_t *i, const format &fmt)
+{
+    uint32_t generation = i->generation;
+    esp_err_t ret = pcm_push(i, fmt, NULL, 0, PCM_CHUNK_EOS);
+    if(ret != ESP_OK) {
+        return ret;
+    }
+
+    // short files may never reach the prefill level
+    pcm_start_streaming(i);
+
+    while(pdTRUE != xSemaphoreTake(i->eos_done, pdMS_TO_TICKS(PCM_RING_POLL_MS))) {
+        if(process_events(i)) {
+            return ESP_ERR_INVALID_STATE;
+        }
+        if(generation != i->generation) {
+            return ESP_ERR_NOT_FINISHED;
         }
     }
-#endif
+    report_track_changes(i);
 
-    // cppcheck-suppress knownConditionTrueFalse
-    if(file_type == FILE_TYPE_UNKNOWN) {
-        ESP_LOGE(TAG, "unknown file type, cleaning up");
-        dispatch_callback(i, AUDIO_PLAYER_CALLBACK_EVENT_UNKNOWN_FILE_TYPE);
-        goto clean_up;
+    return ESP_OK;
+}
+
+/**
+ * Throw away any buffered audio, chunks the writer is already holding are
+ * dropped through the generation check.
+ */
+static void pcm_flush(audio_instance_t *i)
+{
+    i->streaming = false;
+    i->generation++;
+    // a boundary that was thrown away is never reached
+    i->tracks_started = i->tracks_queued;
+    i->tracks_reported = i->tracks_queued;
+
+    size_t size = 0;
+    void *item;
+    while((item = xRingbufferReceive(i->pcm_ring, &size, 0)) != NULL) {
+        vRingbufferReturnItem(i->pcm_ring, item);
+        i->bytes_out += size - sizeof(pcm_chunk_hdr_t);
     }
 
-    do {
-        /* Process audio event sent from other task */
-        if (pdPASS == xQueuePeek(i->event_queue, &audio_event, 0)) {
-            LOGI_2("event in queue");
-            if (AUDIO_PLAYER_REQUEST_PAUSE == audio_event.type) {
-                // receive the pause event to take it off of the queue
-                xQueueReceive(i->event_queue, &audio_event, 0);
+    i->paused = false;
+}
 
-                set_state(i, AUDIO_PLAYER_STATE_PAUSE);
+/**
+ * Tell the writer where the audio that follows sits in its file.
+ */
+static esp_err_t pcm_push_position(audio_instance_t *i, uint32_t position_ms, uint32_t duration_ms, uint32_t flags)
+{
+    pcm_chunk_pos_t pos = { .position_ms = position_ms, .duration_ms = duration_ms, .file_seq = i->decode_seq };
+    return pcm_push(i, i->output.fmt, &pos, sizeof(pos), PCM_CHUNK_POSITION | flags);
+}
 
-                // wait until an event is received that will cause playback to resume,
-                // stop, or change file
-                while(1) {
-                    xQueuePeek(i->event_queue, &audio_event, portMAX_DELAY);
+static uint32_t file_duration_ms(audio_instance_t *i)
+{
+    switch(i->file_type) {
+#if defined(CONFIG_AUDIO_PLAYER_ENABLE_MP3)
+        case FILE_TYPE_MP3:
+            return mp3_duration_ms(&i->mp3_data);
+#endif
+#if defined(CONFIG_AUDIO_PLAYER_ENABLE_WAV)
+        case FILE_TYPE_WAV:
+            return wav_duration_ms(&i->wav_data);
+#endif
+        default:
+            return 0;
+    }
+}
 
-                    if((AUDIO_PLAYER_REQUEST_PLAY != audio_event.type) &&
-                       (AUDIO_PLAYER_REQUEST_STOP != audio_event.type) &&
-                       (AUDIO_PLAYER_REQUEST_RESUME != audio_event.type))
-                    {
-                        // receive to discard the event
-                        xQueueReceive(i->event_queue, &audio_event, 0);
-                    } else {
-                        break;
-                    }
-                }
+/**
+ * Continue decoding i->fp at position_ms. What is buffered is thrown away,
+ * pause is kept, and a boundary to this file still in the ring counts as
+ * passed since the file is audible right away.
+ */
+static void seek_file(audio_instance_t *i, uint32_t position_ms)
+{
+    bool seeked = false;
+    uint32_t actual_ms = position_ms;
 
-                if(AUDIO_PLAYER_REQUEST_RESUME == audio_event.type) {
-                    // receive to discard the event
-                    xQueueReceive(i->event_queue, &audio_event, 0);
-                    continue;
-                }
+    switch(i->file_type) {
+#if defined(CONFIG_AUDIO_PLAYER_ENABLE_MP3)
+        case FILE_TYPE_MP3:
+            seeked = mp3_seek(i->fp, &i->mp3_data, position_ms, &actual_ms);
+            break;
+#endif
+#if defined(CONFIG_AUDIO_PLAYER_ENABLE_WAV)
+        case FILE_TYPE_WAV:
+            seeked = wav_seek(i->fp, &i->wav_data, position_ms, &actual_ms);
+            break;
+#endif
+        default:
+            break;
+    }
+    if(!seeked) {
+        ESP_LOGE(TAG, "unable to seek to %u ms", (unsigned)position_ms);
+        return;
+    }
 
-                // else fall out of this condition and let the below logic
-                // handle the other event types
-            }
+    bool paused = i->paused;
+    uint32_t reported = i->tracks_reported;
+    pcm_flush(i);
+    i->paused = paused;
+    xSemaphoreTake(i->eos_done, 0);
+    i->tracks_reported = reported;
+    report_track_changes(i);
+
+    // the ring was just emptied, there is room for the marker
+    void *item = NULL;
+    if(pdTRUE == xRingbufferSendAcquire(i->pcm_ring, &item, sizeof(pcm_chunk_hdr_t) + sizeof(pcm_chunk_pos_t), 0)) {
+        pcm_chunk_pos_t pos = { .position_ms = actual_ms, .duration_ms = file_duration_ms(i), .file_seq = i->decode_seq };
+        pcm_put(i, item, i->output.fmt, &pos, sizeof(pos), PCM_CHUNK_POSITION | PCM_CHUNK_SEEK);
+    }
+    LOGI_1("seeked to %u ms", (unsigned)actual_ms);
+}
 
-            if ((AUDIO_PLAYER_REQUEST_STOP == audio_event.type) ||
-                (AUDIO_PLAYER_REQUEST_PLAY == audio_event.type)) {
-                ret = ESP_OK;
-                goto clean_up;
-            } else {
-                // receive to discard the event, this event has no
-                // impact on the state of playback
-                xQueueReceive(i->event_queue, &audio_event, 0);
-                continue;
-            }
+/**
+ * Decode i->fp into the pcm ring up to its end, seeks are carried out on the way.
+ *
+ * @return
+ *    - ESP_OK: end of file reached
+ *    - ESP_ERR_INVALID_STATE: playback of this file was stopped or replaced
+ *    - Others: decode or output error
+ */
+static esp_err_t decode_file(audio_instance_t *i)
+{
+    esp_err_t ret = ESP_OK;
+
+    do {
+        /* Process audio event sent from other task */
+        if (process_events(i)) {
+            return ESP_ERR_INVALID_STATE;
         }
 
         set_state(i, AUDIO_PLAYER_STATE_PLAYING);
 
         DECODE_STATUS decode_status = DECODE_STATUS_ERROR;
 
-        switch(file_type) {
+        switch(i->file_type) {
 #if defined(CONFIG_AUDIO_PLAYER_ENABLE_MP3)
             case FILE_TYPE_MP3:
-                decode_status = decode_mp3(i->mp3_decoder, fp, &i->output, &i->mp3_data);
+                decode_status = decode_mp3(i->mp3_decoder, i->fp, &i->output, &i->mp3_data);
                 break;
 #endif
 #if defined(CONFIG_AUDIO_PLAYER_ENABLE_WAV)
             case FILE_TYPE_WAV:
-                decode_status = decode_wav(fp, &i->output, &i->wav_data);
+                decode_status = decode_wav(i->fp, &i->output, &i->wav_data);
                 break;
 #endif
             case FILE_TYPE_UNKNOWN:
@@ -348,50 +636,32 @@ static esp_err_t aplay_file(audio_instance_t *i, FILE *fp)
         // break out and exit if we aren't supposed to continue decoding
         if(decode_status == DECODE_STATUS_CONTINUE)
         {
-            // if mono, convert to stereo as es8311 requires stereo input
+            // the decoders hand out 16 bit stereo (audio_pcm.h), as es8311 requires stereo input
             // even though it is mono output
-            if(i->output.fmt.channels ==  1) {
-                LOGI_3("c == 1, mono -> stereo");
-                ret = mono_to_stereo(i->output.fmt.bits_per_sample, i->output);
-                if(ret != ESP_OK) {
-                    goto clean_up;
-                }
-            }
-
-            /* Configure I2S clock if the output format changed */
-            if ((i2s_format.sample_rate != i->output.fmt.sample_rate) ||
-                    (i2s_format.channels != i->output.fmt.channels) ||
-                    (i2s_format.bits_per_sample != i->output.fmt.bits_per_sample)) {
-                i2s_format = i->output.fmt;
-                LOGI_1("format change: sr=%d, bit=%d, ch=%d",
-                        i2s_format.sample_rate,
-                        i2s_format.bits_per_sample,
-                        i2s_format.channels);
-                i2s_slot_mode_t channel_setting = (i2s_format.channels == 1) ? I2S_SLOT_MODE_MONO : I2S_SLOT_MODE_STEREO;
-                ret = i->config.clk_set_fn(i2s_format.sample_rate,
-                            i2s_format.bits_per_sample,
-                            channel_setting);
-                ESP_GOTO_ON_ERROR(ret, clean_up, TAG, "i2s_set_clk");
-            }
 
             /**
-             * Block until all data has been accepted into the i2s driver, however
-             * the i2s driver has been configured with a buffer to allow for the next round of
-             * audio decoding to occur while the previous set of samples is finishing playback, in order
-             * to ensure playback without interruption.
+             * Hand the samples to the writer task. This only blocks once the
+             * ring is full, i.e. while CONFIG_AUDIO_PLAYER_PCM_RING_MS of audio
+             * is already waiting for the i2s driver.
              */
-            size_t i2s_bytes_written = 0;
-            size_t bytes_to_write = i->output.frame_count * i->output.fmt.channels * (i2s_format.bits_per_sample / 8);
+            size_t bytes_to_write = i->output.frame_count * i->output.fmt.channels * (i->output.fmt.bits_per_sample / 8);
             LOGI_2("c %d, bps %d, bytes %d, frame_count %d",
                 i->output.fmt.channels,
-                i2s_format.bits_per_sample,
+                i->output.fmt.bits_per_sample,
                 bytes_to_write,
                 i->output.frame_count);
 
-            i->config.write_fn(i->output.samples, bytes_to_write, &i2s_bytes_written, portMAX_DELAY);
-            if(bytes_to_write != i2s_bytes_written) {
-                ESP_LOGE(TAG, "to write %d != written %d", bytes_to_write, i2s_bytes_written);
+            ret = pcm_push(i, i->output.fmt, i->output.samples, bytes_to_write, 0);
+            if(ret == ESP_ERR_NOT_FINISHED) {
+                // decoded before a seek
+                ret = ESP_OK;
+                continue;
+            } else if(ret != ESP_OK) {
+                return ret;
             }
+
+            ret = i->writer_err;
+            ESP_RETURN_ON_ERROR(ret, TAG, "i2s_set_clk");
         } else if(decode_status == DECODE_STATUS_NO_DATA_CONTINUE)
         {
             LOGI_2("no data");
@@ -401,10 +671,253 @@ static esp_err_t aplay_file(audio_instance_t *i, FILE *fp)
         }
     } while (true);
 
+    return ESP_OK;
+}
+
+/**
+ * Decode fp into the pcm ring.
+ *
+ * @param next_fp - set if fp played to the end and next_cb returned a file to
+ *                  continue with. The tail of fp is then left in the ring for
+ *                  the writer and the caller goes on with *next_fp right away.
+ */
+static esp_err_t aplay_file(audio_instance_t *i, FILE *fp, FILE **next_fp)
+{
+    LOGI_1("start to decode");
+
+    esp_err_t ret = ESP_OK;
+    FILE *next = NULL;
+
+    i->fp = fp;
+    i->file_type = FILE_TYPE_UNKNOWN;
+    i->decode_seq++;
+
+    // a late EOS from a flushed file must not complete this one
+    xSemaphoreTake(i->eos_done, 0);
+    i->fill_min = i->pcm_ring_size;
+    i->writer_err = ESP_OK;
+
+#if defined(CONFIG_AUDIO_PLAYER_ENABLE_MP3)
+    if(is_mp3(fp)) {
+        i->file_type = FILE_TYPE_MP3;
+        LOGI_1("file is mp3");
+
+        // initialize mp3_instance
+        mp3_start(fp, &i->mp3_data);
+    }
+#endif
+
+#if defined(CONFIG_AUDIO_PLAYER_ENABLE_WAV)
+    // This can be a pointless condition depending on the build options, no reason to warn about it
+    // cppcheck-suppress knownConditionTrueFalse
+    if(i->file_type == FILE_TYPE_UNKNOWN)
+    {
+        if(is_wav(fp, &i->wav_data)) {
+            i->file_type = FILE_TYPE_WAV;
+            LOGI_1("file is wav");
+        }
+    }
+#endif
+
+    // cppcheck-suppress knownConditionTrueFalse
+    if(i->file_type == FILE_TYPE_UNKNOWN) {
+        ESP_LOGE(TAG, "unknown file type, cleaning up");
+        dispatch_callback(i, AUDIO_PLAYER_CALLBACK_EVENT_UNKNOWN_FILE_TYPE);
+        // a track continued through next_cb still has its predecessor's tail to play
+        pcm_drain(i, i->output.fmt);
+        goto clean_up;
+    }
+
+    // position and duration, as the writer reaches the start of this file
+    ret = pcm_push_position(i, 0, file_duration_ms(i), 0);
+    if(ret == ESP_ERR_INVALID_STATE) {
+        ret = ESP_OK;
+        goto clean_up;
+    }
+
+    while(true) {
+        ret = decode_file(i);
+        if(ret != ESP_OK) {
+            if(ret == ESP_ERR_INVALID_STATE) {
+                ret = ESP_OK;
+            }
+            goto clean_up;
+        }
+
+        // gapless: queue the next track right behind the tail of this one
+        if(i->next_cb && !next) {
+            uint32_t generation = i->generation;
+            if(process_events(i)) {
+                goto clean_up;
+            }
+            if(generation != i->generation) {
+                continue;
+            }
+            next = i->next_cb(i->next_cb_ctx);
+        }
+        if(next) {
+            uint32_t boundary = i->tracks_queued + 1;
+            ret = pcm_push(i, i->output.fmt, &boundary, sizeof(boundary), PCM_CHUNK_TRACK);
+            if(ret == ESP_ERR_NOT_FINISHED) {
+                // seeked back into this file, next is kept for when it ends again
+                ret = ESP_OK;
+                continue;
+            } else if(ret != ESP_OK) {
+                ret = ESP_OK;
+                goto clean_up;
+            }
+            i->tracks_queued = boundary;
+            LOGI_1("continuing with the next track");
+            *next_fp = next;
+            goto stop;
+        }
+
+        // let the writer play out the tail before reporting completion
+        if(pcm_drain(i, i->output.fmt) != ESP_ERR_NOT_FINISHED) {
+            break;
+        }
+    }
+
 clean_up:
+    if(next) {
+        fclose(next);
+    }
+    pcm_flush(i);
+    LOGI_1("pcm ring: %u underruns, min fill %u/%u bytes",
+           (unsigned)i->underruns, (unsigned)i->fill_min, (unsigned)i->pcm_ring_size);
+stop:
+#if defined(CONFIG_AUDIO_PLAYER_ENABLE_MP3)
+    if(i->file_type == FILE_TYPE_MP3) {
+        mp3_stop(&i->mp3_data);
+    }
+#endif
+    i->file_type = FILE_TYPE_UNKNOWN;
+    i->fp = NULL;
     return ret;
 }
 
+static esp_err_t pcm_write(audio_instance_t *i, const pcm_chunk_hdr_t *hdr, size_t len)
+{
+    esp_err_t ret = ESP_OK;
+
+    /* Configure I2S clock if the output format changed */
+    if ((i->out_fmt.sample_rate != hdr->fmt.sample_rate) ||
+            (i->out_fmt.channels != hdr->fmt.channels) ||
+            (i->out_fmt.bits_per_sample != hdr->fmt.bits_per_sample)) {
+        i->out_fmt = hdr->fmt;
+        LOGI_1("format change: sr=%d, bit=%d, ch=%d",
+                i->out_fmt.sample_rate,
+                i->out_fmt.bits_per_sample,
+                i->out_fmt.channels);
+        i2s_slot_mode_t channel_setting = (i->out_fmt.channels == 1) ? I2S_SLOT_MODE_MONO : I2S_SLOT_MODE_STEREO;
+        ret = i->config.clk_set_fn(i->out_fmt.sample_rate,
+                    i->out_fmt.bits_per_sample,
+                    channel_setting);
+        if(ret != ESP_OK) {
+            ESP_LOGE(TAG, "i2s_set_clk %d", ret);
+            return ret;
+        }
+    }
+
+    /**
+     * Block until all data has been accepted into the i2s driver, the ring in
+     * front of us keeps the decoder running in the meantime.
+     */
+    size_t i2s_bytes_written = 0;
+    i->config.write_fn(const_cast<pcm_chunk_hdr_t*>(hdr) + 1, len, &i2s_bytes_written, portMAX_DELAY);
+    if(len != i2s_bytes_written) {
+        ESP_LOGE(TAG, "to write %d != written %d", len, i2s_bytes_written);
+    }
+    i->bytes_written += i2s_bytes_written;
+    i->position_frames += i2s_bytes_written / (hdr->fmt.channels * (hdr->fmt.bits_per_sample / BITS_PER_BYTE));
+
+    return ret;
+}
+
+static void pcm_writer_task(void *pvParam)
+{
+    audio_instance_t *i = static_cast<audio_instance_t*>(pvParam);
+    uint32_t out_generation = i->generation - 1;
+    bool starved = false;
+
+    while(!i->writer_exit) {
+        if(!i->streaming || i->paused) {
+            starved = false;
+            ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(PCM_RING_POLL_MS));
+            continue;
+        }
+
+        size_t size = 0;
+        pcm_chunk_hdr_t *hdr = static_cast<pcm_chunk_hdr_t*>(
+            xRingbufferReceive(i->pcm_ring, &size, pdMS_TO_TICKS(PCM_RING_POLL_MS)));
+        if(!hdr) {
+            // the decoder fell behind, count each dry spell once
+            if(i->streaming && !i->paused && !starved) {
+                starved = true;
+                i->underruns++;
+                LOGI_1("pcm ring underrun (%u)", (unsigned)i->underruns);
+            }
+            continue;
+        }
+        starved = false;
+
+        size_t len = size - sizeof(pcm_chunk_hdr_t);
+        if(hdr->generation == i->generation) {
+            // reprogram the clock at the start of each file, as before the ring existed
+            if(hdr->generation != out_generation) {
+                out_generation = hdr->generation;
+                if(!(hdr->flags & PCM_CHUNK_SEEK)) {
+                    memset(&i->out_fmt, 0, sizeof(i->out_fmt));
+                }
+            }
+
+            if(hdr->flags & PCM_CHUNK_EOS) {
+                i->streaming = false;
+                xSemaphoreGive(i->eos_done);
+            } else if(hdr->flags & PCM_CHUNK_TRACK) {
+                i->tracks_started = *reinterpret_cast<const uint32_t*>(hdr + 1);
+            } else if(hdr->flags & PCM_CHUNK_POSITION) {
+                const pcm_chunk_pos_t *pos = reinterpret_cast<const pcm_chunk_pos_t*>(hdr + 1);
+                i->position_frames = 0;
+                i->position_ms = pos->position_ms;
+                i->duration_ms = pos->duration_ms;
+                i->play_seq = pos->file_seq;
+            } else {
+                esp_err_t ret = pcm_write(i, hdr, len);
+                if(ret != ESP_OK) {
+                    i->writer_err = ret;
+                }
+            }
+        }
+        vRingbufferReturnItem(i->pcm_ring, hdr);
+        i->bytes_out += len;
+
+        uint32_t fill = pcm_fill(i);
+        if(fill < i->fill_min) {
+            i->fill_min = fill;
+        }
+    }
+
+    i->writer_task = NULL;
+    vTaskDelete(NULL);
+}
+
+static void pcm_writer_stop(audio_instance_t *i)
+{
+    const int MAX_RETRIES = 10;
+    int retries = MAX_RETRIES;
+
+    i->writer_exit = true;
+    while(i->writer_task && retries) {
+        xTaskNotifyGive(i->writer_task);
+        vTaskDelay(pdMS_TO_TICKS(PCM_RING_POLL_MS));
+        retries--;
+    }
+    if(i->writer_task) {
+        ESP_LOGE(TAG, "pcm writer task did not exit");
+    }
+}
+
 static void audio_task(void *pvParam)
 {
     audio_instance_t *i = static_cast<audio_instance_t*>(pvParam);
@@ -434,6 +947,7 @@ static void audio_task(void *pvParam)
 
                     break;
                 } else if(AUDIO_PLAYER_REQUEST_SHUTDOWN_THREAD == audio_event.type) {
+                    pcm_writer_stop(i);
                     set_state(i, AUDIO_PLAYER_STATE_SHUTDOWN);
                     i->running = false;
 
@@ -452,14 +966,18 @@ static void audio_task(void *pvParam)
         }
 
         i->config.mute_fn(AUDIO_PLAYER_UNMUTE);
-        esp_err_t ret_val = aplay_file(i, audio_event.fp);
-        if(ret_val != ESP_OK)
-        {
-            ESP_LOGE(TAG, "aplay_file() %d", ret_val);
+        FILE *fp = audio_event.fp;
+        while(fp) {
+            FILE *next_fp = NULL;
+            esp_err_t ret_val = aplay_file(i, fp, &next_fp);
+            if(ret_val != ESP_OK)
+            {
+                ESP_LOGE(TAG, "aplay_file() %d", ret_val);
+            }
+            fclose(fp);
+            fp = next_fp;
         }
         i->config.mute_fn(AUDIO_PLAYER_MUTE);
-
-        if(audio_event.fp) fclose(audio_event.fp);
     }
 }
 
@@ -479,31 +997,83 @@ static esp_err_t audio_send_event(audio_instance_t *i, audio_player_event_t even
 esp_err_t audio_player_play(FILE *fp)
 {
     LOGI_1("%s", __FUNCTION__);
-    audio_player_event_t event = { .type = AUDIO_PLAYER_REQUEST_PLAY, .fp = fp };
+    audio_player_event_t event = { .type = AUDIO_PLAYER_REQUEST_PLAY, .fp = fp, .position_ms = 0 };
     return audio_send_event(&instance, event);
 }
 
 esp_err_t audio_player_pause(void)
 {
     LOGI_1("%s", __FUNCTION__);
-    audio_player_event_t event = { .type = AUDIO_PLAYER_REQUEST_PAUSE, .fp = NULL };
+    audio_player_event_t event = { .type = AUDIO_PLAYER_REQUEST_PAUSE, .fp = NULL, .position_ms = 0 };
     return audio_send_event(&instance, event);
 }
 
 esp_err_t audio_player_resume(void)
 {
     LOGI_1("%s", __FUNCTION__);
-    audio_player_event_t event = { .type = AUDIO_PLAYER_REQUEST_RESUME, .fp = NULL };
+    audio_player_event_t event = { .type = AUDIO_PLAYER_REQUEST_RESUME, .fp = NULL, .position_ms = 0 };
     return audio_send_event(&instance, event);
 }
 
 esp_err_t audio_player_stop(void)
 {
     LOGI_1("%s", __FUNCTION__);
-    audio_player_event_t event = { .type = AUDIO_PLAYER_REQUEST_STOP, .fp = NULL };
+    audio_player_event_t event = { .type = AUDIO_PLAYER_REQUEST_STOP, .fp = NULL, .position_ms = 0 };
     return audio_send_event(&instance, event);
 }
 
+esp_err_t audio_player_seek(uint32_t position_ms)
+{
+    LOGI_1("%s %u", __FUNCTION__, (unsigned)position_ms);
+    ESP_RETURN_ON_FALSE((instance.state == AUDIO_PLAYER_STATE_PLAYING) || (instance.state == AUDIO_PLAYER_STATE_PAUSE),
+        ESP_ERR_INVALID_STATE, TAG, "Not playing");
+    audio_player_event_t event = { .type = AUDIO_PLAYER_REQUEST_SEEK, .fp = NULL, .position_ms = position_ms };
+    return audio_send_event(&instance, event);
+}
+
+esp_err_t audio_player_get_position(uint32_t *position_ms)
+{
+    ESP_RETURN_ON_FALSE(NULL != position_ms, ESP_ERR_INVALID_ARG, TAG, "position_ms is NULL");
+    ESP_RETURN_ON_FALSE((instance.state == AUDIO_PLAYER_STATE_PLAYING) || (instance.state == AUDIO_PLAYER_STATE_PAUSE),
+        ESP_ERR_INVALID_STATE, TAG, "Not playing");
+
+    uint32_t rate = instance.out_fmt.sample_rate;
+    uint32_t frames = instance.position_frames;
+    *position_ms = instance.position_ms + (rate ? (uint64_t)frames * 1000 / rate : 0);
+
+    return ESP_OK;
+}
+
+esp_err_t audio_player_get_duration(uint32_t *duration_ms)
+{
+    ESP_RETURN_ON_FALSE(NULL != duration_ms, ESP_ERR_INVALID_ARG, TAG, "duration_ms is NULL");
+    ESP_RETURN_ON_FALSE((instance.state == AUDIO_PLAYER_STATE_PLAYING) || (instance.state == AUDIO_PLAYER_STATE_PAUSE),
+        ESP_ERR_INVALID_STATE, TAG, "Not playing");
+
+    *duration_ms = instance.duration_ms;
+
+    return ESP_OK;
+}
+
+esp_err_t audio_player_get_stats(audio_player_stats_t *stats)
+{
+    ESP_RETURN_ON_FALSE(NULL != stats, ESP_ERR_INVALID_ARG, TAG, "stats is NULL");
+    ESP_RETURN_ON_FALSE(NULL != instance.pcm_ring, ESP_ERR_INVALID_STATE,
+        TAG, "Audio task not started yet");
+
+    format fmt = instance.out_fmt;
+    uint32_t bytes_per_ms = fmt.sample_rate * fmt.channels * (fmt.bits_per_sample / BITS_PER_BYTE) / 1000;
+
+    stats->underruns = instance.underruns;
+    stats->ring_size = instance.pcm_ring_size;
+    stats->fill_bytes = pcm_fill(&instance);
+    stats->fill_min_bytes = instance.fill_min;
+    stats->fill_ms = bytes_per_ms ? stats->fill_bytes / bytes_per_ms : 0;
+    stats->bytes_written = instance.bytes_written;
+
+    return ESP_OK;
+}
+
 /**
  * Can only shut down the playback thread if the thread is not presently playing audio.
  * Call audio_player_stop()
@@ -511,7 +1081,7 @@ esp_err_t audio_player_stop(void)
 static esp_err_t _internal_audio_player_shutdown_thread(void)
 {
     LOGI_1("%s", __FUNCTION__);
-    audio_player_event_t event = { .type = AUDIO_PLAYER_REQUEST_SHUTDOWN_THREAD, .fp = NULL };
+    audio_player_event_t event = { .type = AUDIO_PLAYER_REQUEST_SHUTDOWN_THREAD, .fp = NULL, .position_ms = 0 };
     return audio_send_event(&instance, event);
 }
 
@@ -522,6 +1092,15 @@ static void cleanup_memory(audio_instance_t &i)
     if(i.mp3_data.data_buf) free(i.mp3_data.data_buf);
 #endif
     if(i.output.samples) free(i.output.samples);
+#if defined(CONFIG_AUDIO_PLAYER_ENABLE_WAV)
+    wav_release(&i.wav_data);
+#endif
+
+    if(i.writer_task) pcm_writer_stop(&i);
+    if(i.pcm_ring) vRingbufferDelete(i.pcm_ring);
+    i.pcm_ring = NULL;
+    if(i.eos_done) vSemaphoreDelete(i.eos_done);
+    i.eos_done = NULL;
 
     vQueueDelete(i.event_queue);
 }
@@ -529,6 +1108,7 @@ static void cleanup_memory(audio_instance_t &i)
 esp_err_t audio_player_new(audio_player_config_t config)
 {
     BaseType_t task_val;
+    UBaseType_t writer_priority;
 
     audio_instance_init(instance);
 
@@ -558,6 +1138,42 @@ esp_err_t audio_player_new(audio_player_config_t config)
         TAG, "Failed create MP3 decoder");
 #endif
 
+    {
+        uint32_t ring_ms = instance.config.pcm_ring_ms ? instance.config.pcm_ring_ms : CONFIG_AUDIO_PLAYER_PCM_RING_MS;
+        instance.pcm_ring_size = ring_ms * (PCM_RING_SIZING_RATE / 1000) * 2 * sizeof(int16_t);
+
+        // room for a few of the largest chunks (mono -> stereo expanded) with their headers
+        size_t min_size = 4 * (instance.output.samples_capacity_max + sizeof(pcm_chunk_hdr_t) + 8);
+        if(instance.pcm_ring_size < min_size) {
+            instance.pcm_ring_size = min_size;
+        }
+        LOGI_1("pcm ring %d ms, %d bytes", (int)ring_ms, (int)instance.pcm_ring_size);
+    }
+    instance.pcm_ring = xRingbufferCreate(instance.pcm_ring_size, RINGBUF_TYPE_NOSPLIT);
+    ESP_GOTO_ON_FALSE(NULL != instance.pcm_ring, ESP_ERR_NO_MEM, cleanup,
+        TAG, "Failed create pcm ring");
+
+    instance.eos_done = xSemaphoreCreateBinary();
+    ESP_GOTO_ON_FALSE(NULL != instance.eos_done, ESP_ERR_NO_MEM, cleanup,
+        TAG, "Failed create semaphore");
+
+    // above the decoder so a full ring never delays the i2s writes
+    writer_priority = instance.config.priority + 1;
+    if(writer_priority >= configMAX_PRIORITIES) {
+        writer_priority = configMAX_PRIORITIES - 1;
+    }
+    task_val = xTaskCreatePinnedToCore(
+        (TaskFunction_t)        pcm_writer_task,
+                                "Audio Writer",
+                                3 * 1024,
+                                &instance,
+        (UBaseType_t)           writer_priority,
+        (TaskHandle_t * const)  &instance.writer_task,
+        (BaseType_t)            instance.config.coreID);
+
+    ESP_GOTO_ON_FALSE(pdPASS == task_val, ESP_ERR_NO_MEM, cleanup,
+        TAG, "Failed create audio writer task");
+
     instance.running = true;
     task_val = xTaskCreatePinnedToCore(
         (TaskFunction_t)        audio_task,
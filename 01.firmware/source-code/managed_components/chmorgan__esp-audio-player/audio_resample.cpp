@@ -0,0 +1,259 @@
+#include <stdlib.h>
+#include <string.h>
+
+#include "audio_resample.h"
+
+#define HALF_TAPS       (RESAMPLE_TAPS / 2)
+#define PHASE_BITS      8
+#define MU_BITS         15      /**< interpolation between neighbouring phases */
+
+static_assert(RESAMPLE_PHASES == (1 << PHASE_BITS), "RESAMPLE_PHASES must be 1 << PHASE_BITS");
+
+/* **************** COMPILE-TIME FILTER DESIGN **************** */
+
+namespace {
+
+constexpr double PI = 3.14159265358979323846;
+
+constexpr double cx_sqrt(double x)
+{
+    if(x <= 0) {
+        return 0;
+    }
+    double g = (x > 1) ? x : 1;
+    for(int i = 0; i < 64; i++) {
+        g = 0.5 * (g + x / g);
+    }
+    return g;
+}
+
+constexpr double cx_sin(double x)
+{
+    while(x > PI) {
+        x -= 2 * PI;
+    }
+    while(x < -PI) {
+        x += 2 * PI;
+    }
+    double term = x;
+    double sum = x;
+    for(int n = 1; n < 16; n++) {
+        term *= -x * x / ((2 * n) * (2 * n + 1));
+        sum += term;
+    }
+    return sum;
+}
+
+/** Modified Bessel function of the first kind, order 0 */
+constexpr double cx_i0(double x)
+{
+    double term = 1;
+    double sum = 1;
+    for(int k = 1; k < 64; k++) {
+        double q = x / (2 * k);
+        term *= q * q;
+        sum += term;
+    }
+    return sum;
+}
+
+constexpr double cx_sinc(double x)
+{
+    return (x == 0) ? 1 : cx_sin(PI * x) / (PI * x);
+}
+
+constexpr int32_t cx_round(double x)
+{
+    return (int32_t)((x >= 0) ? x + 0.5 : x - 0.5);
+}
+
+/**
+ * Rows are phases p / RESAMPLE_PHASES of the way from hist[i] to hist[i + 1],
+ * tap k weighs hist[i - HALF_TAPS + 1 + k]. The extra last row is the first
+ * one moved by a frame, for interpolating past the last phase. Every row is
+ * normalized to a DC gain of exactly 1.0 (32768) after rounding.
+ *
+ * @param cutoff - in cycles per input frame
+ * @param beta - Kaiser window shape, ~9.5 for 95 dB stopband
+ */
+struct fir_table {
+    int16_t h[RESAMPLE_PHASES + 1][RESAMPLE_TAPS];
+
+    constexpr fir_table(double cutoff, double beta) : h{}
+    {
+        const double i0_beta = cx_i0(beta);
+        for(int p = 0; p <= RESAMPLE_PHASES; p++) {
+            double v[RESAMPLE_TAPS] = {};
+            double sum = 0;
+            for(int k = 0; k < RESAMPLE_TAPS; k++) {
+                double t = (HALF_TAPS - 1 - k) + (double)p / RESAMPLE_PHASES;
+                double r = t / HALF_TAPS;
+                double w = (r * r < 1) ? cx_i0(beta * cx_sqrt(1 - r * r)) / i0_beta : 0;
+                v[k] = 2 * cutoff * cx_sinc(2 * cutoff * t) * w;
+                sum += v[k];
+            }
+
+            int32_t q[RESAMPLE_TAPS] = {};
+            int32_t qsum = 0;
+            int peak = 0;
+            for(int k = 0; k < RESAMPLE_TAPS; k++) {
+                q[k] = cx_round(v[k] / sum * 32768);
+                qsum += q[k];
+                if(v[k] > v[peak]) {
+                    peak = k;
+                }
+            }
+            q[peak] += 32768 - qsum;
+
+            for(int k = 0; k < RESAMPLE_TAPS; k++) {
+                h[p][k] = (int16_t)((q[k] > 32767) ? 32767 : q[k]);
+            }
+        }
+    }
+};
+
+/** Up-sampling: everything below the input Nyquist frequency */
+constexpr fir_table up_table(0.5, 9.5);
+
+/** Down-sampling, sized for 48 -> 44.1 kHz: just under the output Nyquist frequency */
+constexpr fir_table down_table(0.45, 9.5);
+
+} // namespace
+
+/* **************** STREAMING **************** */
+
+static inline int16_t sat16(int32_t v)
+{
+    return (v > INT16_MAX) ? INT16_MAX : (v < INT16_MIN) ? INT16_MIN : (int16_t)v;
+}
+
+/** The kernel: a plain MAC loop over contiguous int16, left for the compiler to vectorize */
+static inline int32_t dot(const int16_t *h, const int16_t *x)
+{
+    int32_t acc = 0;
+    for(int k = 0; k < RESAMPLE_TAPS; k++) {
+        acc += h[k] * x[k];
+    }
+    return acc;
+}
+
+bool resampler_init(resampler_t *r, uint32_t in_rate, uint32_t out_rate, size_t max_out_frames)
+{
+    memset(r, 0, sizeof(*r));
+    if(in_rate == out_rate) {
+        r->passthrough = true;
+        return true;
+    }
+
+    r->table = (in_rate < out_rate) ? &up_table.h[0][0] : &down_table.h[0][0];
+    r->step = ((uint64_t)in_rate << 32) / out_rate;
+    r->capacity = (size_t)((max_out_frames * r->step) >> 32) + RESAMPLE_TAPS + 4;
+    r->hist[0] = static_cast<int16_t*>(malloc(2 * r->capacity * sizeof(int16_t)));
+    if(!r->hist[0]) {
+        return false;
+    }
+    r->hist[1] = r->hist[0] + r->capacity;
+    resampler_reset(r);
+    return true;
+}
+
+void resampler_free(resampler_t *r)
+{
+    free(r->hist[0]);
+    r->hist[0] = r->hist[1] = NULL;
+}
+
+void resampler_reset(resampler_t *r)
+{
+    if(r->passthrough) {
+        return;
+    }
+    // silence in front of the first frame, so that it is the centre of the first output
+    r->held = HALF_TAPS - 1;
+    memset(r->hist[0], 0, r->held * sizeof(int16_t));
+    memset(r->hist[1], 0, r->held * sizeof(int16_t));
+    r->pos = (uint64_t)(HALF_TAPS - 1) << 32;
+    r->tail = 0;
+}
+
+size_t resampler_need(const resampler_t *r, size_t out_frames)
+{
+    if(r->passthrough || !out_frames) {
+        return out_frames;
+    }
+    uint64_t last = r->pos + (out_frames - 1) * r->step;
+    size_t total = (size_t)(last >> 32) + HALF_TAPS + 1;
+    if(total > r->capacity) {
+        total = r->capacity;
+    }
+    return (total > r->held) ? total - r->held : 0;
+}
+
+void resampler_push(resampler_t *r, const int16_t *in, size_t frames)
+{
+    if(frames > r->capacity - r->held) {
+        frames = r->capacity - r->held;
+    }
+    int16_t *l = r->hist[0] + r->held;
+    int16_t *rt = r->hist[1] + r->held;
+    for(size_t k = 0; k < frames; k++) {
+        l[k] = in[2 * k];
+        rt[k] = in[2 * k + 1];
+    }
+    r->held += frames;
+    if(frames) {
+        // the last frame is in every output up to HALF_TAPS frames past it
+        r->tail = RESAMPLE_TAPS;
+    }
+}
+
+void resampler_push_silence(resampler_t *r, size_t frames)
+{
+    if(frames > r->capacity - r->held) {
+        frames = r->capacity - r->held;
+    }
+    memset(r->hist[0] + r->held, 0, frames * sizeof(int16_t));
+    memset(r->hist[1] + r->held, 0, frames * sizeof(int16_t));
+    r->held += frames;
+    r->tail = (frames < r->tail) ? r->tail - frames : 0;
+}
+
+size_t resampler_run(resampler_t *r, int16_t *out, size_t out_frames)
+{
+    int16_t h[RESAMPLE_TAPS];
+    size_t k = 0;
+
+    for(; k < out_frames; k++) {
+        size_t i = (size_t)(r->pos >> 32);
+        if(i + HALF_TAPS >= r->held) {
+            break;
+        }
+
+        uint32_t frac = (uint32_t)r->pos;
+        const int16_t *h0 = r->table + (frac >> (32 - PHASE_BITS)) * RESAMPLE_TAPS;
+        const int16_t *h1 = h0 + RESAMPLE_TAPS;
+        int32_t mu = (frac >> (32 - PHASE_BITS - MU_BITS)) & ((1 << MU_BITS) - 1);
+        // rounded, a truncated step would ripple the gain from phase to phase
+        for(int t = 0; t < RESAMPLE_TAPS; t++) {
+            h[t] = (int16_t)(h0[t] + (((h1[t] - h0[t]) * mu + (1 << (MU_BITS - 1))) >> MU_BITS));
+        }
+
+        size_t base = i - (HALF_TAPS - 1);
+        out[2 * k] = sat16((dot(h, r->hist[0] + base) + (1 << 14)) >> 15);
+        out[2 * k + 1] = sat16((dot(h, r->hist[1] + base) + (1 << 14)) >> 15);
+        r->pos += r->step;
+    }
+
+    // drop the frames no later output reaches back to
+    size_t drop = (size_t)(r->pos >> 32) - (HALF_TAPS - 1);
+    if(drop > r->held) {
+        drop = r->held;
+    }
+    if(drop) {
+        r->held -= drop;
+        memmove(r->hist[0], r->hist[0] + drop, r->held * sizeof(int16_t));
+        memmove(r->hist[1], r->hist[1] + drop, r->held * sizeof(int16_t));
+        r->pos -= (uint64_t)drop << 32;
+    }
+    return k;
+}
@@ -0,0 +1,64 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * Streaming polyphase sample-rate converter, 16 bit stereo in and out.
+ *
+ * A Kaiser windowed sinc of RESAMPLE_TAPS taps is tabulated at
+ * RESAMPLE_PHASES fractional positions per input frame (Q15, built at compile
+ * time). Each output frame interpolates the coefficients of its two nearest
+ * phases and then runs one dot product per channel over the deinterleaved
+ * history, a plain multiply-accumulate loop the compiler can vectorize.
+ *
+ * Up-sampling cuts off at the input Nyquist frequency, down-sampling at the
+ * output Nyquist frequency of the 48 -> 44.1 kHz case; larger down-sampling
+ * ratios alias a little. Works for any pair of rates, equal rates are not
+ * meant to be run through it (see resampler_init()).
+ *
+ * The first output frame lines up with the first input frame, but every
+ * output frame needs RESAMPLE_TAPS / 2 input frames after it: a stream has
+ * to be followed by that much silence to be played out completely.
+ */
+
+#define RESAMPLE_TAPS       40
+#define RESAMPLE_PHASES     256
+
+typedef struct {
+    const int16_t *table;       /**< [RESAMPLE_PHASES + 1][RESAMPLE_TAPS], NULL when passthrough */
+    uint64_t step;              /**< input frames per output frame, Q32 */
+    uint64_t pos;               /**< position of the next output frame in hist, Q32 */
+    int16_t *hist[2];           /**< deinterleaved input, left and right */
+    size_t held;                /**< frames in hist */
+    size_t capacity;
+    size_t tail;                /**< silent frames still needed to play out the last input */
+    bool passthrough;           /**< equal rates, nothing allocated */
+} resampler_t;
+
+/**
+ * @param max_out_frames - largest out_frames that resampler_run() will be asked for
+ * @return false if out of memory
+ */
+bool resampler_init(resampler_t *r, uint32_t in_rate, uint32_t out_rate, size_t max_out_frames);
+void resampler_free(resampler_t *r);
+
+/** Forget the history, the next input starts a new stream */
+void resampler_reset(resampler_t *r);
+
+/** Input frames to resampler_push() before resampler_run() can produce out_frames */
+size_t resampler_need(const resampler_t *r, size_t out_frames);
+
+/** Append interleaved stereo frames, at most resampler_need() of them */
+void resampler_push(resampler_t *r, const int16_t *in, size_t frames);
+
+/** Append silent frames, at the end of a stream or when the input ran dry */
+void resampler_push_silence(resampler_t *r, size_t frames);
+
+/**
+ * Produce up to out_frames interleaved stereo frames
+ *
+ * @return frames produced, fewer than out_frames if the history ran out
+ */
+size_t resampler_run(resampler_t *r, int16_t *out, size_t out_frames);
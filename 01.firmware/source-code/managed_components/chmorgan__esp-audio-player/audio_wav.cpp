@@ -1,9 +1,34 @@
 #include <string.h>
 #include <stdio.h>
+#include <stdlib.h>
 #include "audio_wav.h"
 
 static const char *TAG = "wav";
 
+#define WAV_FMT_OFFSET          20      /**< of the 'fmt ' chunk data in the file */
+#define WAV_FORMAT_EXTENSIBLE   0xFFFE
+#define WAV_SUBFORMAT_OFFSET    24      /**< of the sub-format GUID in WAVEFORMATEXTENSIBLE */
+#define WAV_EXTENSION_OFFSET    16      /**< of cbSize and the format specific fields in WAVEFORMATEX */
+
+/** Room for one decoded block and the block itself */
+static bool block_alloc(wav_instance *pInstance)
+{
+    const audio_adpcm_format_t *fmt = &pInstance->adpcm_format;
+    size_t size = fmt->samples_per_block * fmt->channels * sizeof(int16_t) + fmt->block_align;
+    if(size > pInstance->block_size) {
+        wav_release(pInstance);
+        pInstance->block = static_cast<uint8_t*>(malloc(size));
+        if(!pInstance->block) {
+            ESP_LOGE(TAG, "no memory for a %d byte block", fmt->block_align);
+            return false;
+        }
+        pInstance->block_size = size;
+    }
+    pInstance->block_frames = 0;
+    pInstance->block_pos = 0;
+    return true;
+}
+
 /**
  * @param fp
  * @param pInstance - Values can be considered valid if true is returned
@@ -25,6 +50,42 @@ bool is_wav(FILE *fp, wav_instance *pInstance) {
         return false;
     }
 
+    // WAVEFORMATEXTENSIBLE keeps the actual format in the first two bytes of its sub-format GUID
+    uint16_t format_tag = wav_head->AudioFormat;
+    if((format_tag == WAV_FORMAT_EXTENSIBLE) && (wav_head->Subchunk1Size >= WAV_SUBFORMAT_OFFSET + 2)) {
+        fseek(fp, WAV_FMT_OFFSET + WAV_SUBFORMAT_OFFSET, SEEK_SET);
+        if(fread(&format_tag, 1, sizeof(format_tag), fp) != sizeof(format_tag)) {
+            return false;
+        }
+    }
+
+    // ADPCM keeps wSamplesPerBlock after cbSize
+    uint16_t extension[2] = { 0, 0 };
+    if(wav_head->Subchunk1Size >= WAV_EXTENSION_OFFSET + (int32_t)sizeof(extension)) {
+        fseek(fp, WAV_FMT_OFFSET + WAV_EXTENSION_OFFSET, SEEK_SET);
+        if(fread(extension, 1, sizeof(extension), fp) != sizeof(extension)) {
+            return false;
+        }
+    }
+    pInstance->adpcm = audio_adpcm_format_from_wav(format_tag, wav_head->NumChannels, wav_head->BlockAlign,
+                                                   wav_head->BitsPerSample, (extension[0] >= 2) ? extension[1] : 0,
+                                                   &pInstance->adpcm_format);
+    if(pInstance->adpcm) {
+        if(!block_alloc(pInstance)) {
+            return false;
+        }
+    } else if(!audio_pcm_format_from_wav(format_tag, wav_head->BitsPerSample, &pInstance->pcm_format) ||
+        (wav_head->NumChannels < 1) || (wav_head->NumChannels > AUDIO_PCM_MAX_CHANNELS))
+    {
+        ESP_LOGE(TAG, "unsupported format %d, %d bit, %d channels", format_tag, wav_head->BitsPerSample,
+                 wav_head->NumChannels);
+        return false;
+    }
+    pInstance->dither.state = 1;
+
+    // the 'fmt ' chunk is longer than wav_header_t for anything but plain PCM
+    fseek(fp, WAV_FMT_OFFSET + wav_head->Subchunk1Size, SEEK_SET);
+
     // decode chunks until we find the 'data' one
     wav_subchunk_header_t subchunk;
     while(true) {
@@ -35,43 +96,95 @@ bool is_wav(FILE *fp, wav_instance *pInstance) {
 
         if(memcmp(subchunk.SubchunkID, "data", 4) == 0)
         {
+            pInstance->data_start = ftell(fp);
+            pInstance->data_size = subchunk.SubchunkSize;
             break;
         } else {
-            // advance beyond this subchunk, it could be a 'LIST' chunk with file info or some other unhandled subchunk
-            fseek(fp, subchunk.SubchunkSize, SEEK_CUR);
+            // advance beyond this subchunk, it could be a 'LIST' chunk with file info or some other unhandled subchunk,
+            // chunks are padded to an even size
+            fseek(fp, subchunk.SubchunkSize + (subchunk.SubchunkSize & 1), SEEK_CUR);
         }
     }
 
-    LOGI_2("sample_rate=%d, channels=%d, bps=%d",
+    LOGI_2("sample_rate=%d, channels=%d, bps=%d, format %d",
             wav_head->SampleRate,
             wav_head->NumChannels,
-            wav_head->BitsPerSample);
+            wav_head->BitsPerSample,
+            format_tag);
 
     return true;
 }
 
 /**
+ * ADPCM decodes a block at a time into pInstance->block and hands it out in
+ * pieces that fit pData->samples. Reading stops at the end of the 'data'
+ * chunk, what follows it would decode to noise.
+ */
+static DECODE_STATUS decode_wav_adpcm(FILE *fp, decode_data *pData, wav_instance *pInstance) {
+    const audio_adpcm_format_t *fmt = &pInstance->adpcm_format;
+    int16_t *block_pcm = reinterpret_cast<int16_t*>(pInstance->block);
+
+    pData->frame_count = 0;
+    if(pInstance->block_pos == pInstance->block_frames) {
+        uint8_t *raw = pInstance->block + fmt->samples_per_block * fmt->channels * sizeof(int16_t);
+        long remaining = pInstance->data_start + (long)pInstance->data_size - ftell(fp);
+        size_t bytes_to_read = (remaining < fmt->block_align) ? ((remaining > 0) ? remaining : 0) : fmt->block_align;
+        size_t bytes_read = fread(raw, 1, bytes_to_read, fp);
+        pInstance->block_frames = audio_adpcm_decode_block(fmt, block_pcm, raw, bytes_read);
+        pInstance->block_pos = 0;
+        if(pInstance->block_frames == 0) {
+            return DECODE_STATUS_DONE;
+        }
+    }
+
+    // stereo out, mono doubles into samples_capacity_max
+    size_t frames = pInstance->block_frames - pInstance->block_pos;
+    size_t frames_max = pData->samples_capacity / (sizeof(int16_t) * fmt->channels);
+    if(frames > frames_max) {
+        frames = frames_max;
+    }
+    audio_pcm_downmix_s16(reinterpret_cast<int16_t*>(pData->samples), block_pcm + pInstance->block_pos * fmt->channels,
+                          fmt->channels, frames);
+    pInstance->block_pos += frames;
+
+    pData->frame_count = frames;
+    pData->fmt.channels = 2;
+    pData->fmt.bits_per_sample = 16;
+    pData->fmt.sample_rate = pInstance->header.SampleRate;
+    return DECODE_STATUS_CONTINUE;
+}
+
+/**
+ * Samples come out as 16 bit stereo whatever the file holds: narrower and
+ * wider samples are converted (with dither), mono is doubled and more
+ * channels are down-mixed, all in place in pData->samples.
+ *
  * @return true if data remains, false on error or end of file
  */
 DECODE_STATUS decode_wav(FILE *fp, decode_data *pData, wav_instance *pInstance) {
+    if(pInstance->adpcm) {
+        return decode_wav_adpcm(fp, pData, pInstance);
+    }
+
     // read an even multiple of frames that can fit into output_samples buffer, otherwise
-    // we would have to manage what happens with partial frames in the output buffer
-    size_t bytes_per_frame = (pInstance->header.BitsPerSample / BITS_PER_BYTE) * pInstance->header.NumChannels;
-    size_t frames_to_read = pData->samples_capacity / bytes_per_frame;
+    // we would have to manage what happens with partial frames in the output buffer;
+    // 8 bit samples double in size on the way to 16 bit, mono doubles into samples_capacity_max
+    size_t channels = pInstance->header.NumChannels;
+    size_t bytes_per_frame = audio_pcm_format_bytes(pInstance->pcm_format) * channels;
+    size_t s16_bytes_per_frame = sizeof(int16_t) * channels;
+    size_t frames_to_read = pData->samples_capacity / ((bytes_per_frame > s16_bytes_per_frame) ? bytes_per_frame : s16_bytes_per_frame);
     size_t bytes_to_read = frames_to_read * bytes_per_frame;
 
     size_t bytes_read = fread(pData->samples, 1, bytes_to_read, fp);
 
-    pData->fmt.channels = pInstance->header.NumChannels;
-    pData->fmt.bits_per_sample = pInstance->header.BitsPerSample;
-    pData->fmt.sample_rate = pInstance->header.SampleRate;
+    int16_t *pcm = reinterpret_cast<int16_t*>(pData->samples);
+    pData->frame_count = bytes_read / bytes_per_frame;
+    audio_pcm_to_s16(pcm, pcm, pInstance->pcm_format, pData->frame_count * channels, &pInstance->dither);
+    audio_pcm_downmix_s16(pcm, pcm, channels, pData->frame_count);
 
-    if(bytes_read != 0)
-    {
-        pData->frame_count = (bytes_read / (pInstance->header.BitsPerSample / BITS_PER_BYTE)) / pInstance->header.NumChannels;
-    } else {
-        pData->frame_count = 0;
-    }
+    pData->fmt.channels = 2;
+    pData->fmt.bits_per_sample = 16;
+    pData->fmt.sample_rate = pInstance->header.SampleRate;
 
     LOGI_2("bytes_per_frame %d, bytes_to_read %d, bytes_read %d, frame_count %d",
             bytes_per_frame, bytes_to_read, bytes_read,
@@ -79,3 +192,61 @@ DECODE_STATUS decode_wav(FILE *fp, decode_data *pData, wav_instance *pInstance)
 
     return (bytes_read == 0) ? DECODE_STATUS_DONE : DECODE_STATUS_CONTINUE;
 }
+
+uint32_t wav_duration_ms(const wav_instance *pInstance) {
+    if(pInstance->adpcm) {
+        const audio_adpcm_format_t *fmt = &pInstance->adpcm_format;
+        if(pInstance->header.SampleRate <= 0) {
+            return 0;
+        }
+        uint64_t frames = (uint64_t)(pInstance->data_size / fmt->block_align) * fmt->samples_per_block +
+                          audio_adpcm_block_frames(fmt, pInstance->data_size % fmt->block_align);
+        return frames * 1000 / pInstance->header.SampleRate;
+    }
+    if(pInstance->header.ByteRate <= 0) {
+        return 0;
+    }
+    return (uint64_t)pInstance->data_size * 1000 / pInstance->header.ByteRate;
+}
+
+bool wav_seek(FILE *fp, wav_instance *pInstance, uint32_t position_ms, uint32_t *actual_ms) {
+    if(pInstance->header.SampleRate <= 0 || pInstance->header.BlockAlign <= 0) {
+        return false;
+    }
+
+    uint64_t frame = (uint64_t)position_ms * pInstance->header.SampleRate / 1000;
+    if(pInstance->adpcm) {
+        // blocks decode on their own, start at the one holding the position
+        const audio_adpcm_format_t *fmt = &pInstance->adpcm_format;
+        uint64_t block = frame / fmt->samples_per_block;
+        uint64_t blocks = pInstance->data_size / fmt->block_align;
+        if(block > blocks) {
+            block = blocks;
+        }
+        if(fseek(fp, pInstance->data_start + block * fmt->block_align, SEEK_SET) != 0) {
+            return false;
+        }
+        pInstance->block_frames = 0;
+        pInstance->block_pos = 0;
+        *actual_ms = block * fmt->samples_per_block * 1000 / pInstance->header.SampleRate;
+        LOGI_1("seek %u ms: block %u", (unsigned)position_ms, (unsigned)block);
+        return true;
+    }
+    uint64_t frames = pInstance->data_size / pInstance->header.BlockAlign;
+    if(frame > frames) {
+        frame = frames;
+    }
+    if(fseek(fp, pInstance->data_start + frame * pInstance->header.BlockAlign, SEEK_SET) != 0) {
+        return false;
+    }
+
+    *actual_ms = frame * 1000 / pInstance->header.SampleRate;
+    LOGI_1("seek %u ms: frame %u", (unsigned)position_ms, (unsigned)frame);
+    return true;
+}
+
+void wav_release(wav_instance *pInstance) {
+    free(pInstance->block);
+    pInstance->block = NULL;
+    pInstance->block_size = 0;
+}
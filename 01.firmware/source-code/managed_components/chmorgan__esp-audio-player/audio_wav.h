@@ -3,6 +3,8 @@
 #include <stdio.h>
 #include "audio_log.h"
 #include "audio_decode_types.h"
+#include "audio_pcm.h"
+#include "audio_adpcm.h"
 
 typedef struct {
     // The "RIFF" chunk descriptor
@@ -28,7 +30,28 @@ typedef struct {
 
 typedef struct {
     wav_header_t header;
+    long data_start;        /**< file offset of the first sample */
+    uint32_t data_size;     /**< bytes in the 'data' chunk */
+    audio_pcm_format_t pcm_format;
+    audio_pcm_dither_t dither;
+    bool adpcm;             /**< 'data' holds ADPCM blocks, pcm_format is unused */
+    audio_adpcm_format_t adpcm_format;
+    uint8_t *block;         /**< the samples of one block followed by the block as read, kept for the next file */
+    size_t block_size;      /**< bytes allocated at block */
+    size_t block_frames;    /**< decoded frames in block */
+    size_t block_pos;       /**< the next of them to hand out */
 } wav_instance;
 
 bool is_wav(FILE *fp, wav_instance *pInstance);
 DECODE_STATUS decode_wav(FILE *fp, decode_data *pData, wav_instance *pInstance);
+uint32_t wav_duration_ms(const wav_instance *pInstance);
+
+/**
+ * Reposition fp to the sample frame at position_ms.
+ *
+ * @param actual_ms - position decoding will continue at
+ */
+bool wav_seek(FILE *fp, wav_instance *pInstance, uint32_t position_ms, uint32_t *actual_ms);
+
+/** Free the block buffer of compressed files */
+void wav_release(wav_instance *pInstance);
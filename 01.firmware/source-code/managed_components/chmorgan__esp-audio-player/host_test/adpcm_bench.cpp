@@ -0,0 +1,545 @@
+/*
+ * Host benchmark of the compressed sample formats (audio_adpcm.cpp and the
+ * G.711 part of audio_pcm.cpp)
+ *
+ * Encodes a test signal with plain reference encoders, checks that the table
+ * driven decoders give exactly what the bit by bit reference decoders give,
+ * full blocks and short last blocks, mono and stereo, and that the result is
+ * close enough to the signal. Then reports decoding speed in output samples
+ * per microsecond next to 16 bit PCM passthrough, the cost the compressed
+ * formats are weighed against. Exits 1 on a mismatch.
+ *
+ *   adpcm_bench [-n loops] [-s frames] [-b block_align]
+ */
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <functional>
+#include <vector>
+
+#include "audio_adpcm.h"
+#include "audio_pcm.h"
+
+static int fails;
+
+static double now_us(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e6 + ts.tv_nsec / 1e3;
+}
+
+static void check(bool ok, const char *what)
+{
+    if(!ok) {
+        printf("FAIL: %s\n", what);
+        fails++;
+    }
+}
+
+/** Best of 'loops' runs of fn, as samples per microsecond */
+static double rate(int loops, size_t samples, const std::function<void()> &fn)
+{
+    double best = 1e30;
+    for(int l = 0; l < loops; l++) {
+        double start = now_us();
+        fn();
+        double us = now_us() - start;
+        if(us < best) {
+            best = us;
+        }
+    }
+    return samples / (best > 0 ? best : 1e-3);
+}
+
+static int32_t clamp16(int32_t v)
+{
+    return (v > INT16_MAX) ? INT16_MAX : (v < INT16_MIN) ? INT16_MIN : v;
+}
+
+/** Two tones and a little noise at about -6 dBFS, channels in different phase */
+static std::vector<int16_t> signal(size_t frames, size_t channels)
+{
+    std::vector<int16_t> v(frames * channels);
+    uint32_t x = 12345;
+    for(size_t f = 0; f < frames; f++) {
+        for(size_t c = 0; c < channels; c++) {
+            x = x * 1664525 + 1013904223;
+            double t = f / 44100.0;
+            double s = 10000 * sin(2 * M_PI * 440 * t + c) + 6000 * sin(2 * M_PI * 3150 * t) + (int32_t)(x >> 24) - 128;
+            v[f * channels + c] = (int16_t)lrint(s);
+        }
+    }
+    return v;
+}
+
+/** Signal to error ratio in dB */
+static double snr(const int16_t *ref, const int16_t *out, size_t n)
+{
+    double sig = 0, err = 0;
+    for(size_t k = 0; k < n; k++) {
+        sig += (double)ref[k] * ref[k];
+        err += (double)(ref[k] - out[k]) * (ref[k] - out[k]);
+    }
+    return 10 * log10(sig / (err > 0 ? err : 1));
+}
+
+/* **************** IMA reference **************** */
+
+static const int ima_steps[89] = {
+    7, 8, 9, 10, 11, 12, 13, 14, 16, 17, 19, 21, 23, 25, 28, 31, 34, 37, 41, 45,
+    50, 55, 60, 66, 73, 80, 88, 97, 107, 118, 130, 143, 157, 173, 190, 209, 230, 253, 279, 307,
+    337, 371, 408, 449, 494, 544, 598, 658, 724, 796, 876, 963, 1060, 1166, 1282, 1411, 1552, 1707, 1878, 2066,
+    2272, 2499, 2749, 3024, 3327, 3660, 4026, 4428, 4871, 5358, 5894, 6484, 7132, 7845, 8630, 9493, 10442, 11487, 12635, 13899,
+    15289, 16818, 18500, 20350, 22385, 24623, 27086, 29794, 32767,
+};
+static const int ima_adjust[16] = { -1, -1, -1, -1, 2, 4, 6, 8, -1, -1, -1, -1, 2, 4, 6, 8 };
+
+struct ima_state {
+    int pred;
+    int index;
+};
+
+static int16_t ima_ref_decode(ima_state &s, int nib)
+{
+    int step = ima_steps[s.index];
+    int diff = step >> 3;
+    if(nib & 4) {
+        diff += step;
+    }
+    if(nib & 2) {
+        diff += step >> 1;
+    }
+    if(nib & 1) {
+        diff += step >> 2;
+    }
+    s.pred = clamp16((nib & 8) ? s.pred - diff : s.pred + diff);
+    s.index += ima_adjust[nib];
+    s.index = (s.index < 0) ? 0 : (s.index > 88) ? 88 : s.index;
+    return (int16_t)s.pred;
+}
+
+static int ima_ref_encode(ima_state &s, int16_t sample)
+{
+    int diff = sample - s.pred;
+    int nib = 0;
+    if(diff < 0) {
+        nib = 8;
+        diff = -diff;
+    }
+    int step = ima_steps[s.index];
+    if(diff >= step) {
+        nib |= 4;
+        diff -= step;
+    }
+    step >>= 1;
+    if(diff >= step) {
+        nib |= 2;
+        diff -= step;
+    }
+    step >>= 1;
+    if(diff >= step) {
+        nib |= 1;
+    }
+    ima_ref_decode(s, nib);
+    return nib;
+}
+
+/** Blocks of block_align bytes, the last one cut short if the frames run out */
+static std::vector<uint8_t> ima_encode(const std::vector<int16_t> &pcm, size_t channels, size_t block_align)
+{
+    const size_t spb = 1 + (block_align - 4 * channels) / (4 * channels) * 8;
+    const size_t frames = pcm.size() / channels;
+    std::vector<uint8_t> out;
+    ima_state st[2] = {};
+    for(size_t f0 = 0; f0 < frames; f0 += spb) {
+        size_t n = (frames - f0 < spb) ? frames - f0 : spb;
+        for(size_t c = 0; c < channels; c++) {
+            st[c].pred = pcm[f0 * channels + c];
+            out.push_back((uint8_t)st[c].pred);
+            out.push_back((uint8_t)(st[c].pred >> 8));
+            out.push_back((uint8_t)st[c].index);
+            out.push_back(0);
+        }
+        for(size_t g = 1; g < n; g += 8) {
+            for(size_t c = 0; c < channels; c++) {
+                for(size_t j = 0; j < 8; j += 2) {
+                    int lo = (g + j < n) ? ima_ref_encode(st[c], pcm[(f0 + g + j) * channels + c]) : 0;
+                    int hi = (g + j + 1 < n) ? ima_ref_encode(st[c], pcm[(f0 + g + j + 1) * channels + c]) : 0;
+                    out.push_back((uint8_t)(lo | (hi << 4)));
+                }
+            }
+        }
+    }
+    return out;
+}
+
+static std::vector<int16_t> ima_ref(const std::vector<uint8_t> &data, size_t channels, size_t block_align)
+{
+    std::vector<int16_t> out;
+    for(size_t b = 0; b < data.size(); b += block_align) {
+        const uint8_t *p = data.data() + b;
+        size_t bytes = (data.size() - b < block_align) ? data.size() - b : block_align;
+        size_t groups = (bytes - 4 * channels) / (4 * channels);
+        ima_state st[2];
+        std::vector<int16_t> blk((1 + 8 * groups) * channels);
+        for(size_t c = 0; c < channels; c++) {
+            st[c].pred = (int16_t)(p[4 * c] | (p[4 * c + 1] << 8));
+            st[c].index = p[4 * c + 2];
+            blk[c] = (int16_t)st[c].pred;
+        }
+        for(size_t g = 0; g < groups; g++) {
+            for(size_t c = 0; c < channels; c++) {
+                const uint8_t *q = p + 4 * channels + (g * channels + c) * 4;
+                for(size_t j = 0; j < 8; j++) {
+                    blk[(1 + 8 * g + j) * channels + c] = ima_ref_decode(st[c], (q[j / 2] >> (4 * (j & 1))) & 15);
+                }
+            }
+        }
+        out.insert(out.end(), blk.begin(), blk.end());
+    }
+    return out;
+}
+
+/* **************** Microsoft reference **************** */
+
+static const int ms_coef[7][2] = { { 256, 0 }, { 512, -256 }, { 0, 0 }, { 192, 64 }, { 240, 0 }, { 460, -208 }, { 392, -232 } };
+static const int ms_adapt[16] = { 230, 230, 230, 230, 307, 409, 512, 614, 768, 614, 512, 409, 307, 230, 230, 230 };
+
+struct ms_state {
+    int c1, c2, delta, s1, s2;
+};
+
+static int16_t ms_ref_decode(ms_state &s, int nib)
+{
+    int pred = (s.s1 * s.c1 + s.s2 * s.c2) / 256;
+    int snib = (nib & 8) ? nib - 16 : nib;
+    int v = clamp16(pred + snib * s.delta);
+    s.delta = ms_adapt[nib] * s.delta / 256;
+    if(s.delta < 16) {
+        s.delta = 16;
+    }
+    s.s2 = s.s1;
+    s.s1 = v;
+    return (int16_t)v;
+}
+
+static int ms_ref_encode(ms_state &s, int16_t sample)
+{
+    int pred = (s.s1 * s.c1 + s.s2 * s.c2) / 256;
+    int e = sample - pred;
+    int nib = (int)lrint((double)e / s.delta);
+    nib = (nib < -8) ? -8 : (nib > 7) ? 7 : nib;
+    nib &= 15;
+    ms_ref_decode(s, nib);
+    return nib;
+}
+
+/** Each block and channel with the predictor of the least squared error */
+static std::vector<uint8_t> ms_encode(const std::vector<int16_t> &pcm, size_t channels, size_t block_align)
+{
+    const size_t spb = 2 + (block_align - 7 * channels) * 2 / channels;
+    const size_t frames = pcm.size() / channels;
+    std::vector<uint8_t> out;
+    for(size_t f0 = 0; f0 + 2 <= frames; f0 += spb) {
+        size_t n = (frames - f0 < spb) ? frames - f0 : spb;
+        ms_state st[2];
+        int best_p[2] = { 0, 0 };
+        for(size_t c = 0; c < channels; c++) {
+            double best = 1e300;
+            for(int p = 0; p < 7; p++) {
+                ms_state s = { ms_coef[p][0], ms_coef[p][1], 16, pcm[(f0 + 1) * channels + c], pcm[f0 * channels + c] };
+                double err = 0;
+                for(size_t f = 2; f < n; f++) {
+                    int16_t ref = pcm[(f0 + f) * channels + c];
+                    ms_ref_encode(s, ref);
+                    err += (double)(s.s1 - ref) * (s.s1 - ref);
+                }
+                if(err < best) {
+                    best = err;
+                    best_p[c] = p;
+                }
+            }
+            st[c] = { ms_coef[best_p[c]][0], ms_coef[best_p[c]][1], 16, pcm[(f0 + 1) * channels + c], pcm[f0 * channels + c] };
+        }
+        for(size_t c = 0; c < channels; c++) {
+            out.push_back((uint8_t)best_p[c]);
+        }
+        for(size_t c = 0; c < channels; c++) {
+            out.push_back((uint8_t)st[c].delta);
+            out.push_back((uint8_t)(st[c].delta >> 8));
+        }
+        for(size_t c = 0; c < channels; c++) {
+            out.push_back((uint8_t)st[c].s1);
+            out.push_back((uint8_t)(st[c].s1 >> 8));
+        }
+        for(size_t c = 0; c < channels; c++) {
+            out.push_back((uint8_t)st[c].s2);
+            out.push_back((uint8_t)(st[c].s2 >> 8));
+        }
+        std::vector<int> nibs;
+        for(size_t f = 2; f < n; f++) {
+            for(size_t c = 0; c < channels; c++) {
+                nibs.push_back(ms_ref_encode(st[c], pcm[(f0 + f) * channels + c]));
+            }
+        }
+        for(size_t k = 0; k < nibs.size(); k += 2) {
+            out.push_back((uint8_t)((nibs[k] << 4) | ((k + 1 < nibs.size()) ? nibs[k + 1] : 0)));
+        }
+    }
+    return out;
+}
+
+static std::vector<int16_t> ms_ref(const std::vector<uint8_t> &data, size_t channels, size_t block_align)
+{
+    std::vector<int16_t> out;
+    for(size_t b = 0; b < data.size(); b += block_align) {
+        const uint8_t *p = data.data() + b;
+        size_t bytes = (data.size() - b < block_align) ? data.size() - b : block_align;
+        ms_state st[2];
+        for(size_t c = 0; c < channels; c++) {
+            st[c].c1 = ms_coef[p[c]][0];
+            st[c].c2 = ms_coef[p[c]][1];
+            st[c].delta = (int16_t)(p[channels + 2 * c] | (p[channels + 2 * c + 1] << 8));
+            st[c].s1 = (int16_t)(p[3 * channels + 2 * c] | (p[3 * channels + 2 * c + 1] << 8));
+            st[c].s2 = (int16_t)(p[5 * channels + 2 * c] | (p[5 * channels + 2 * c + 1] << 8));
+        }
+        for(size_t c = 0; c < channels; c++) {
+            out.push_back((int16_t)st[c].s2);
+        }
+        for(size_t c = 0; c < channels; c++) {
+            out.push_back((int16_t)st[c].s1);
+        }
+        size_t nibs = (bytes - 7 * channels) * 2;
+        for(size_t k = 0; k < nibs; k++) {
+            int nib = (k & 1) ? p[7 * channels + k / 2] & 15 : p[7 * channels + k / 2] >> 4;
+            out.push_back(ms_ref_decode(st[k % channels], nib));
+        }
+    }
+    return out;
+}
+
+/* **************** G.711 reference (ITU-T G.711 / Sun g711.c) **************** */
+
+static int16_t alaw_ref(uint8_t code)
+{
+    int a = code ^ 0x55;
+    int t = (a & 15) << 4;
+    int seg = (a & 0x70) >> 4;
+    switch(seg) {
+        case 0: t += 8; break;
+        case 1: t += 0x108; break;
+        default: t += 0x108; t <<= seg - 1; break;
+    }
+    return (int16_t)((a & 0x80) ? t : -t);
+}
+
+static int16_t mulaw_ref(uint8_t code)
+{
+    int u = ~code & 0xff;
+    int t = ((u & 15) << 3) + 0x84;
+    t <<= (u & 0x70) >> 4;
+    return (int16_t)((u & 0x80) ? 0x84 - t : t - 0x84);
+}
+
+static int segment(int v, const int *end)
+{
+    for(int k = 0; k < 8; k++) {
+        if(v <= end[k]) {
+            return k;
+        }
+    }
+    return 8;
+}
+
+static uint8_t alaw_ref_encode(int16_t pcm)
+{
+    static const int end[8] = { 0x1f, 0x3f, 0x7f, 0xff, 0x1ff, 0x3ff, 0x7ff, 0xfff };
+    int v = pcm >> 3, mask = 0xd5;
+    if(v < 0) {
+        mask = 0x55;
+        v = -v - 1;
+    }
+    int seg = segment(v, end);
+    if(seg >= 8) {
+        return (uint8_t)(0x7f ^ mask);
+    }
+    int a = seg << 4;
+    a |= (seg < 2) ? (v >> 1) & 15 : (v >> seg) & 15;
+    return (uint8_t)(a ^ mask);
+}
+
+static uint8_t mulaw_ref_encode(int16_t pcm)
+{
+    static const int end[8] = { 0x3f, 0x7f, 0xff, 0x1ff, 0x3ff, 0x7ff, 0xfff, 0x1fff };
+    int v = pcm >> 2, mask = 0xff;
+    if(v < 0) {
+        v = -v;
+        mask = 0x7f;
+    }
+    v = ((v > 8159) ? 8159 : v) + 33;
+    int seg = segment(v, end);
+    if(seg >= 8) {
+        return (uint8_t)(0x7f ^ mask);
+    }
+    return (uint8_t)(((seg << 4) | ((v >> (seg + 1)) & 15)) ^ mask);
+}
+
+/* **************** main **************** */
+
+/** Decode a stream a block at a time, as the players do */
+static size_t decode_stream(const audio_adpcm_format_t *fmt, int16_t *dst, const std::vector<uint8_t> &data)
+{
+    size_t frames = 0;
+    for(size_t b = 0; b < data.size(); b += fmt->block_align) {
+        size_t bytes = (data.size() - b < fmt->block_align) ? data.size() - b : fmt->block_align;
+        frames += audio_adpcm_decode_block(fmt, dst + frames * fmt->channels, data.data() + b, bytes);
+    }
+    return frames;
+}
+
+int main(int argc, char **argv)
+{
+    int loops = 20;
+    size_t frames = 44100;
+    size_t block_align = 1024;
+    int opt;
+    while((opt = getopt(argc, argv, "n:s:b:")) != -1) {
+        switch(opt) {
+        case 'n': loops = atoi(optarg); break;
+        case 's': frames = strtoul(optarg, NULL, 0); break;
+        case 'b': block_align = strtoul(optarg, NULL, 0); break;
+        default:
+            fprintf(stderr, "usage: %s [-n loops] [-s frames] [-b block_align]\n", argv[0]);
+            return 2;
+        }
+    }
+    block_align &= ~(size_t)7;
+    if(block_align < 64) {
+        block_align = 64;
+    }
+
+    // the block sizes of the formats, and what is refused
+    {
+        audio_adpcm_format_t f;
+        check(audio_adpcm_format_from_wav(0x11, 2, 2048, 4, 0, &f) && (f.samples_per_block == 2041), "IMA stereo 2048 byte blocks hold 2041 frames");
+        check(audio_adpcm_format_from_wav(0x11, 1, 512, 4, 1017, &f) && (f.samples_per_block == 1017), "IMA mono 512 byte blocks hold 1017 frames");
+        check(audio_adpcm_format_from_wav(0x02, 2, 1024, 4, 1012, &f) && (f.samples_per_block == 1012), "MS stereo 1024 byte blocks hold 1012 frames");
+        check(audio_adpcm_format_from_wav(0x02, 1, 256, 4, 4000, &f) && (f.samples_per_block == 500), "MS samples_per_block beyond the block is cut");
+        check(audio_adpcm_block_frames(&f, 7) == 2 && audio_adpcm_block_frames(&f, 6) == 0, "MS header only block");
+        check(!audio_adpcm_format_from_wav(0x11, 3, 2048, 4, 0, &f), "three channels refused");
+        check(!audio_adpcm_format_from_wav(0x11, 2, 4, 4, 0, &f), "block smaller than the header refused");
+        check(!audio_adpcm_format_from_wav(0x02, 1, 256, 3, 0, &f), "3 bit refused");
+        check(!audio_adpcm_format_from_wav(0x01, 1, 2, 16, 0, &f), "PCM is not ADPCM");
+        audio_pcm_format_t p;
+        check(audio_pcm_format_from_wav(6, 8, &p) && (p == AUDIO_PCM_ALAW) && audio_pcm_format_from_wav(7, 8, &p) &&
+              (p == AUDIO_PCM_MULAW) && !audio_pcm_format_from_wav(7, 16, &p), "G.711 format tags");
+    }
+
+    // G.711: every code, every 16 bit value
+    {
+        uint8_t codes[256];
+        int16_t out[256];
+        for(int k = 0; k < 256; k++) {
+            codes[k] = (uint8_t)k;
+        }
+        bool a_ok = true, u_ok = true;
+        audio_pcm_to_s16(out, codes, AUDIO_PCM_ALAW, 256, NULL);
+        for(int k = 0; k < 256; k++) {
+            a_ok &= (out[k] == alaw_ref((uint8_t)k));
+        }
+        audio_pcm_to_s16(out, codes, AUDIO_PCM_MULAW, 256, NULL);
+        for(int k = 0; k < 256; k++) {
+            u_ok &= (out[k] == mulaw_ref((uint8_t)k));
+        }
+        check(a_ok, "A-law expansion");
+        check(u_ok, "mu-law expansion");
+
+        std::vector<int16_t> all(65536);
+        std::vector<uint8_t> enc(65536);
+        for(int k = 0; k < 65536; k++) {
+            all[k] = (int16_t)(k - 32768);
+        }
+        a_ok = u_ok = true;
+        audio_pcm_from_s16(enc.data(), AUDIO_PCM_ALAW, all.data(), all.size(), NULL);
+        for(int k = 0; k < 65536; k++) {
+            a_ok &= (enc[k] == alaw_ref_encode(all[k]));
+        }
+        audio_pcm_from_s16(enc.data(), AUDIO_PCM_MULAW, all.data(), all.size(), NULL);
+        for(int k = 0; k < 65536; k++) {
+            u_ok &= (enc[k] == mulaw_ref_encode(all[k]));
+        }
+        check(a_ok, "A-law compression");
+        check(u_ok, "mu-law compression");
+    }
+
+    printf("%-28s %12s %8s %8s\n", "decoder", "samples/us", "vs PCM", "SNR dB");
+
+    // 16 bit PCM passthrough: what the players do with a plain WAV or AVI soundtrack
+    const std::vector<int16_t> ref2 = signal(frames, 2);
+    std::vector<int16_t> out(2 * frames + 16);
+    const double pcm_rate = rate(loops, 2 * frames, [&] { audio_pcm_to_s16(out.data(), ref2.data(), AUDIO_PCM_S16, 2 * frames, NULL); });
+    printf("%-28s %12.1f %8s %8s\n", "s16 passthrough", pcm_rate, "1.00", "-");
+
+    static const struct {
+        audio_pcm_format_t fmt;
+        const char *name;
+    } g711[] = { { AUDIO_PCM_ALAW, "A-law" }, { AUDIO_PCM_MULAW, "mu-law" } };
+    for(const auto &g : g711) {
+        std::vector<uint8_t> enc(2 * frames);
+        audio_pcm_from_s16(enc.data(), g.fmt, ref2.data(), 2 * frames, NULL);
+        double r = rate(loops, 2 * frames, [&] { audio_pcm_to_s16(out.data(), enc.data(), g.fmt, 2 * frames, NULL); });
+        double s = snr(ref2.data(), out.data(), 2 * frames);
+        char name[64];
+        snprintf(name, sizeof(name), "%s -> s16", g.name);
+        check(s > 30, name);
+        printf("%-28s %12.1f %8.2f %8.1f\n", name, r, r / pcm_rate, s);
+    }
+
+    static const struct {
+        uint16_t tag;
+        const char *name;
+        double min_snr;
+    } codecs[] = { { 0x11, "IMA", 20 }, { 0x02, "MS", 20 } };
+    for(const auto &c : codecs) {
+        for(size_t channels = 1; channels <= 2; channels++) {
+            // an odd length leaves a short last block
+            const size_t n = frames | 1;
+            const std::vector<int16_t> ref = signal(n, channels);
+            const size_t ba = block_align * channels;
+            audio_adpcm_format_t fmt;
+            if(!audio_adpcm_format_from_wav(c.tag, channels, ba, 4, 0, &fmt)) {
+                check(false, "format");
+                continue;
+            }
+            std::vector<uint8_t> enc = (c.tag == 0x11) ? ima_encode(ref, channels, ba) : ms_encode(ref, channels, ba);
+            std::vector<int16_t> expect = (c.tag == 0x11) ? ima_ref(enc, channels, ba) : ms_ref(enc, channels, ba);
+            std::vector<int16_t> dec((n + fmt.samples_per_block) * channels);
+            size_t got = decode_stream(&fmt, dec.data(), enc);
+
+            char name[64];
+            snprintf(name, sizeof(name), "%s %s matches the reference", c.name, (channels == 1) ? "mono" : "stereo");
+            check((got * channels == expect.size()) && (memcmp(dec.data(), expect.data(), expect.size() * sizeof(int16_t)) == 0), name);
+
+            size_t cmp = (got < n) ? got : n;
+            double s = snr(ref.data(), dec.data(), cmp * channels);
+            snprintf(name, sizeof(name), "%s %s SNR", c.name, (channels == 1) ? "mono" : "stereo");
+            check(s > c.min_snr, name);
+
+            double r = rate(loops, got * channels, [&] { decode_stream(&fmt, dec.data(), enc); });
+            snprintf(name, sizeof(name), "%s %s -> s16", c.name, (channels == 1) ? "mono" : "stereo");
+            printf("%-28s %12.1f %8.2f %8.1f\n", name, r, r / pcm_rate, s);
+        }
+    }
+
+    if(fails) {
+        printf("%d FAILED\n", fails);
+        return 1;
+    }
+    printf("all checks passed\n");
+    return 0;
+}
@@ -0,0 +1,377 @@
+/*
+ * Host benchmark of the effects chain (audio_dsp.cpp)
+ *
+ * Runs the fixed-point chain next to a double precision model of the same
+ * chain (RBJ biquads, volume, look-ahead limiter) and reports the difference
+ * in dBFS, then checks the limiter ceiling, that a flat chain only delays,
+ * that a volume ramp adds no steps to a low tone, and reports the CPU cost of
+ * each stage per frame (TSC cycles on x86). Exits 1 on a failed check.
+ *
+ *   dsp_bench [-n loops] [-e max_error_dbfs]
+ */
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <deque>
+#include <vector>
+
+#include "audio_dsp.h"
+
+#define RATE            44100
+#define LOOKAHEAD_MS    2
+#define RELEASE_MS      100
+#define LIMIT_DB        -1.0
+
+static int fails;
+
+static void check(bool ok, const char *what)
+{
+    printf("%-44s %s\n", what, ok ? "ok" : "FAIL");
+    fails += !ok;
+}
+
+/** Five bands of the kind a tone control sets, cuts and boosts */
+static const audio_dsp_eq_band_t bands5[] = {
+    { AUDIO_DSP_EQ_LOW_SHELF, 80, 6, 0 },
+    { AUDIO_DSP_EQ_PEAK, 250, -4, 1.0f },
+    { AUDIO_DSP_EQ_PEAK, 1000, 3, 1.4f },
+    { AUDIO_DSP_EQ_PEAK, 4000, -6, 2.0f },
+    { AUDIO_DSP_EQ_HIGH_SHELF, 12000, 8, 0 },
+};
+
+/** Ten octave bands, all boosted or cut */
+static audio_dsp_eq_band_t bands10[10];
+
+/* **************** DOUBLE PRECISION MODEL **************** */
+
+struct ref_biquad {
+    double b0, b1, b2, a1, a2;
+    double x1[2], x2[2], y1[2], y2[2];
+
+    explicit ref_biquad(const audio_dsp_eq_band_t &band) : x1{}, x2{}, y1{}, y2{}
+    {
+        const double a = pow(10, band.gain_db / 40);
+        const double w0 = 2 * M_PI * band.freq / RATE;
+        const double q = band.q > 0 ? band.q : 0.707;
+        const double cs = cos(w0), alpha = sin(w0) / (2 * q), sa = 2 * sqrt(a) * alpha;
+        double a0;
+        if(band.type == AUDIO_DSP_EQ_LOW_SHELF) {
+            b0 = a * ((a + 1) - (a - 1) * cs + sa);
+            b1 = 2 * a * ((a - 1) - (a + 1) * cs);
+            b2 = a * ((a + 1) - (a - 1) * cs - sa);
+            a0 = (a + 1) + (a - 1) * cs + sa;
+            a1 = -2 * ((a - 1) + (a + 1) * cs);
+            a2 = (a + 1) + (a - 1) * cs - sa;
+        } else if(band.type == AUDIO_DSP_EQ_HIGH_SHELF) {
+            b0 = a * ((a + 1) + (a - 1) * cs + sa);
+            b1 = -2 * a * ((a - 1) + (a + 1) * cs);
+            b2 = a * ((a + 1) + (a - 1) * cs - sa);
+            a0 = (a + 1) - (a - 1) * cs + sa;
+            a1 = 2 * ((a - 1) - (a + 1) * cs);
+            a2 = (a + 1) - (a - 1) * cs - sa;
+        } else {
+            b0 = 1 + alpha * a;
+            b1 = -2 * cs;
+            b2 = 1 - alpha * a;
+            a0 = 1 + alpha / a;
+            a1 = -2 * cs;
+            a2 = 1 - alpha / a;
+        }
+        b0 /= a0; b1 /= a0; b2 /= a0; a1 /= a0; a2 /= a0;
+    }
+
+    double run(int ch, double x)
+    {
+        double y = b0 * x + b1 * x1[ch] + b2 * x2[ch] - a1 * y1[ch] - a2 * y2[ch];
+        x2[ch] = x1[ch]; x1[ch] = x;
+        y2[ch] = y1[ch]; y1[ch] = y;
+        return y;
+    }
+};
+
+/** The chain at a fixed volume, output in 16 bit units but not rounded */
+static std::vector<double> reference(const std::vector<int16_t> &in, const audio_dsp_eq_band_t *bands, int nb,
+                                     double volume)
+{
+    std::vector<ref_biquad> eq;
+    for(int b = 0; b < nb; b++) {
+        eq.emplace_back(bands[b]);
+    }
+    const size_t look = LOOKAHEAD_MS * RATE / 1000;
+    const double ceiling = round(32767 * pow(10, LIMIT_DB / 20));
+    const double release = 1 - exp(-1 / ((double)RELEASE_MS * RATE / 1000));
+    std::deque<std::pair<double, size_t>> window;
+    std::vector<double> delay(2 * look), out(in.size());
+    double gain = 1, floor = 1, step = 0;
+
+    for(size_t k = 0; k < in.size() / 2; k++) {
+        double x[2] = { (double)in[2 * k], (double)in[2 * k + 1] };
+        for(auto &bq : eq) {
+            x[0] = bq.run(0, x[0]);
+            x[1] = bq.run(1, x[1]);
+        }
+        x[0] *= volume;
+        x[1] *= volume;
+
+        double a = fmax(fabs(x[0]), fabs(x[1]));
+        while(!window.empty() && window.back().first <= a) {
+            window.pop_back();
+        }
+        window.emplace_back(a, k);
+        if(k - window.front().second > look) {
+            window.pop_front();
+        }
+        double peak = window.front().first;
+        double target = (peak > ceiling) ? ceiling / peak : 1;
+        if(target < gain) {
+            if(target != floor) {
+                floor = target;
+                step = fmax(step, (gain - target) / (look + 1));
+            }
+            gain -= step;
+            if(gain <= target) {
+                gain = target;
+                step = 0;
+            }
+        } else {
+            floor = target;
+            step = 0;
+            gain = fmin(gain + (target - gain) * release, target);
+        }
+
+        size_t pos = k % look;
+        for(int ch = 0; ch < 2; ch++) {
+            out[2 * k + ch] = delay[2 * pos + ch] * gain;
+            delay[2 * pos + ch] = x[ch];
+        }
+    }
+    return out;
+}
+
+/* **************** HELPERS **************** */
+
+static audio_dsp_handle_t chain(const audio_dsp_eq_band_t *bands, int nb, uint16_t volume)
+{
+    audio_dsp_config_t cfg = {};
+    cfg.sample_rate = RATE;
+    cfg.bands = nb;
+    memcpy(cfg.band, bands, nb * sizeof(bands[0]));
+    cfg.volume = volume;
+    cfg.limit_db = LIMIT_DB;
+    cfg.lookahead_ms = LOOKAHEAD_MS;
+    cfg.release_ms = RELEASE_MS;
+    audio_dsp_handle_t dsp = audio_dsp_new(&cfg);
+    if(!dsp) {
+        fprintf(stderr, "out of memory\n");
+        exit(2);
+    }
+    return dsp;
+}
+
+/** In place, in pieces of the odd sizes the player writes */
+static void process(audio_dsp_handle_t dsp, std::vector<int16_t> &pcm)
+{
+    static const size_t sizes[] = { 1152, 576, 1000, 1, 300 };
+    size_t frames = pcm.size() / 2;
+    for(size_t done = 0, i = 0; done < frames; i++) {
+        size_t n = sizes[i % 5];
+        if(n > frames - done) {
+            n = frames - done;
+        }
+        audio_dsp_process(dsp, &pcm[2 * done], n);
+        done += n;
+    }
+}
+
+/** Pink-ish noise: white noise through a one-pole low-pass, mixed with the white */
+static std::vector<int16_t> noise(size_t frames, double rms_dbfs)
+{
+    std::vector<double> v(2 * frames);
+    uint32_t x = 2463534242u;
+    double lp[2] = {}, sum = 0;
+    for(size_t k = 0; k < v.size(); k++) {
+        x ^= x << 13; x ^= x >> 17; x ^= x << 5;
+        double w = (double)(int32_t)x / 2147483648.0;
+        lp[k & 1] = 0.98 * lp[k & 1] + 0.2 * w;
+        v[k] = lp[k & 1] + 0.3 * w;
+        sum += v[k] * v[k];
+    }
+    double scale = 32767 * pow(10, rms_dbfs / 20) / sqrt(sum / v.size());
+    std::vector<int16_t> out(v.size());
+    for(size_t k = 0; k < v.size(); k++) {
+        double s = round(v[k] * scale);
+        out[k] = (int16_t)fmax(-32768, fmin(32767, s));
+    }
+    return out;
+}
+
+static std::vector<int16_t> sine(size_t frames, double freq, double dbfs)
+{
+    std::vector<int16_t> out(2 * frames);
+    double amp = 32767 * pow(10, dbfs / 20);
+    for(size_t k = 0; k < frames; k++) {
+        out[2 * k] = out[2 * k + 1] = (int16_t)lround(amp * sin(2 * M_PI * freq * k / RATE));
+    }
+    return out;
+}
+
+/** RMS of fixed - reference in dBFS, skipping the first 'skip' frames */
+static double error_dbfs(const std::vector<int16_t> &fixed, const std::vector<double> &ref, size_t skip)
+{
+    double sum = 0;
+    for(size_t k = 2 * skip; k < fixed.size(); k++) {
+        double e = fixed[k] - ref[k];
+        sum += e * e;
+    }
+    return 20 * log10(sqrt(sum / (fixed.size() - 2 * skip)) / 32768 + 1e-12);
+}
+
+static int16_t peak(const std::vector<int16_t> &v)
+{
+    int p = 0;
+    for(int16_t s : v) {
+        p = (abs(s) > p) ? abs(s) : p;
+    }
+    return (int16_t)p;
+}
+
+int main(int argc, char **argv)
+{
+    int loops = 5;
+    double max_err = -86;
+    int opt;
+    while((opt = getopt(argc, argv, "n:e:")) != -1) {
+        switch(opt) {
+        case 'n': loops = atoi(optarg); break;
+        case 'e': max_err = atof(optarg); break;
+        default:
+            fprintf(stderr, "usage: %s [-n loops] [-e max_error_dbfs]\n", argv[0]);
+            return 2;
+        }
+    }
+    for(int b = 0; b < 10; b++) {
+        bands10[b] = { AUDIO_DSP_EQ_PEAK, 31.25f * (1 << b), (b & 1) ? -5.0f : 4.0f, 1.4f };
+    }
+    bands10[0].type = AUDIO_DSP_EQ_LOW_SHELF;
+    bands10[9].type = AUDIO_DSP_EQ_HIGH_SHELF;
+
+    const size_t frames = 5 * RATE;
+    const size_t settle = RATE / 10;
+    char name[96];
+
+    // against the double model: below the limiter, then limiting hard
+    static const struct {
+        const audio_dsp_eq_band_t *bands;
+        int nb;
+        double rms_dbfs;
+        uint16_t volume;
+    } cases[] = {
+        { bands5, 5, -30, 16384 },
+        { bands10, 10, -30, 23170 },
+        { bands5, 5, -6, AUDIO_DSP_VOLUME_UNITY },
+        { bands10, 10, -3, AUDIO_DSP_VOLUME_UNITY },
+    };
+    for(const auto &c : cases) {
+        std::vector<int16_t> pcm = noise(frames, c.rms_dbfs);
+        std::vector<double> ref = reference(pcm, c.bands, c.nb, c.volume / 32768.0);
+        audio_dsp_handle_t dsp = chain(c.bands, c.nb, c.volume);
+        process(dsp, pcm);
+        audio_dsp_stats_t st;
+        audio_dsp_get_stats(dsp, &st);
+        audio_dsp_delete(dsp);
+
+        double err = error_dbfs(pcm, ref, settle);
+        snprintf(name, sizeof(name), "%2d bands, %3.0f dBFS in, %4.1f%% limited: %6.1f dBFS", c.nb, c.rms_dbfs,
+                 100.0 * st.limited_frames / st.frames, err);
+        check(err <= max_err, name);
+        if(st.limited_frames) {
+            const int16_t ceiling = (int16_t)lround(32767 * pow(10, LIMIT_DB / 20));
+            snprintf(name, sizeof(name), "  peak %d, ceiling %d", peak(pcm), ceiling);
+            check(peak(pcm) <= ceiling + 1, name);
+        }
+    }
+
+    // flat and at unity the chain is a delay line
+    {
+        std::vector<int16_t> in = noise(frames, -20), pcm = in;
+        audio_dsp_handle_t dsp = chain(NULL, 0, AUDIO_DSP_VOLUME_UNITY);
+        audio_dsp_set_band(dsp, 3, &bands5[2]);
+        audio_dsp_eq_band_t flat = bands5[2];
+        flat.gain_db = 0;
+        audio_dsp_set_band(dsp, 3, &flat);
+        process(dsp, pcm);
+        audio_dsp_delete(dsp);
+        const size_t look = LOOKAHEAD_MS * RATE / 1000;
+        check(memcmp(&pcm[2 * look], &in[0], (in.size() - 2 * look) * sizeof(int16_t)) == 0,
+              "flat chain below the ceiling only delays");
+    }
+
+    // ramping a low tone down and back up takes no step bigger than the tone's own
+    {
+        std::vector<int16_t> pcm = sine(RATE, 60, -3);
+        int max_in = 0;
+        for(size_t k = 2; k < pcm.size(); k += 2) {
+            max_in = std::max(max_in, abs(pcm[k] - pcm[k - 2]));
+        }
+        audio_dsp_handle_t dsp = chain(NULL, 0, AUDIO_DSP_VOLUME_UNITY);
+        const size_t piece = 441;
+        int max_out = 0;
+        int16_t last = 0;
+        for(size_t done = 0; done < RATE; done += piece) {
+            if(done == RATE / 4) {
+                audio_dsp_set_volume(dsp, 0, 20);
+            } else if(done == RATE / 2) {
+                audio_dsp_set_volume(dsp, AUDIO_DSP_VOLUME_UNITY / 2, 0);
+            }
+            audio_dsp_process(dsp, &pcm[2 * done], piece);
+            for(size_t k = done; k < done + piece; k++) {
+                max_out = std::max(max_out, abs(pcm[2 * k] - last));
+                last = pcm[2 * k];
+            }
+        }
+        audio_dsp_stats_t st;
+        audio_dsp_get_stats(dsp, &st);
+        audio_dsp_delete(dsp);
+        snprintf(name, sizeof(name), "volume ramps: step %d, the tone's %d", max_out, max_in);
+        check((max_out <= max_in + 2) && (st.volume == AUDIO_DSP_VOLUME_UNITY / 2), name);
+    }
+
+    // cost per frame of each stage, the best of 'loops' runs
+    printf("\n%-28s %10s %10s %10s\n", "cycles/frame", "eq", "volume", "limiter");
+    static const struct {
+        const char *name;
+        const audio_dsp_eq_band_t *bands;
+        int nb;
+        bool ramp;
+    } costs[] = {
+        { "flat, unity", NULL, 0, false },
+        { "5 bands", bands5, 5, false },
+        { "10 bands", bands10, 10, false },
+        { "10 bands, ramping", bands10, 10, true },
+    };
+    for(const auto &c : costs) {
+        const std::vector<int16_t> in = noise(frames, -6);
+        double best[AUDIO_DSP_STAGE_MAX] = { 1e30, 1e30, 1e30 };
+        for(int l = 0; l < loops; l++) {
+            std::vector<int16_t> pcm = in;
+            audio_dsp_handle_t dsp = chain(c.bands, c.nb, c.ramp ? 0 : AUDIO_DSP_VOLUME_UNITY);
+            if(c.ramp) {
+                audio_dsp_set_volume(dsp, AUDIO_DSP_VOLUME_UNITY, 5000);
+            }
+            process(dsp, pcm);
+            audio_dsp_stats_t st;
+            audio_dsp_get_stats(dsp, &st);
+            audio_dsp_delete(dsp);
+            for(int s = 0; s < AUDIO_DSP_STAGE_MAX; s++) {
+                best[s] = fmin(best[s], (double)st.cycles[s] / st.frames);
+            }
+        }
+        printf("%-28s %10.1f %10.1f %10.1f\n", c.name, best[0], best[1], best[2]);
+    }
+
+    printf("%s\n", fails ? "FAILED" : "ok");
+    return fails ? 1 : 0;
+}
@@ -0,0 +1,209 @@
+/*
+ * Host benchmark of the PCM format conversions (audio_pcm.cpp)
+ *
+ * Checks each conversion against a plain reference, in place and between
+ * separate buffers, aligned and not, then reports its speed in samples per
+ * microsecond (output samples for the channel conversions). Exits 1 on a
+ * mismatch.
+ *
+ *   pcm_bench [-n loops] [-s samples]
+ */
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <functional>
+#include <vector>
+
+#include "audio_pcm.h"
+
+static int fails;
+
+static double now_us(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e6 + ts.tv_nsec / 1e3;
+}
+
+static void check(bool ok, const char *what)
+{
+    if(!ok) {
+        printf("FAIL: %s\n", what);
+        fails++;
+    }
+}
+
+/** Best of 'loops' runs of fn, as samples per microsecond */
+static double rate(int loops, size_t samples, const std::function<void()> &fn)
+{
+    double best = 1e30;
+    for(int l = 0; l < loops; l++) {
+        double start = now_us();
+        fn();
+        double us = now_us() - start;
+        if(us < best) {
+            best = us;
+        }
+    }
+    return samples / (best > 0 ? best : 1e-3);
+}
+
+static std::vector<int16_t> noise16(size_t n)
+{
+    std::vector<int16_t> v(n);
+    uint32_t x = 12345;
+    for(size_t k = 0; k < n; k++) {
+        x = x * 1664525 + 1013904223;
+        v[k] = (int16_t)(x >> 16);
+    }
+    v[0] = INT16_MIN;
+    v[1] = INT16_MAX;
+    return v;
+}
+
+int main(int argc, char **argv)
+{
+    int loops = 20;
+    size_t n = 48000;
+    int opt;
+    while((opt = getopt(argc, argv, "n:s:")) != -1) {
+        switch(opt) {
+        case 'n': loops = atoi(optarg); break;
+        case 's': n = strtoul(optarg, NULL, 0); break;
+        default:
+            fprintf(stderr, "usage: %s [-n loops] [-s samples]\n", argv[0]);
+            return 2;
+        }
+    }
+    n &= ~(size_t)1;
+
+    const std::vector<int16_t> ref = noise16(n);
+    std::vector<uint8_t> wide(4 * n + 8);
+    std::vector<int16_t> out(2 * n + 4), back(2 * n + 4);
+    audio_pcm_dither_t dither = { 1 };
+
+    printf("%-28s %12s\n", "conversion", "samples/us");
+
+    // widening and back is lossless for 24, 32 bit and float, 8 bit keeps the high byte
+    static const struct {
+        audio_pcm_format_t fmt;
+        const char *name;
+    } formats[] = {
+        { AUDIO_PCM_U8, "u8" }, { AUDIO_PCM_S24, "s24" }, { AUDIO_PCM_S32, "s32" }, { AUDIO_PCM_F32, "f32" },
+    };
+    for(const auto &f : formats) {
+        char name[64];
+        audio_pcm_from_s16(wide.data(), f.fmt, ref.data(), n, NULL);
+        audio_pcm_to_s16(back.data(), wide.data(), f.fmt, n, NULL);
+        bool ok = true;
+        for(size_t k = 0; k < n; k++) {
+            int32_t expect = ref[k];
+            if(f.fmt == AUDIO_PCM_U8) {
+                expect = ((ref[k] + 128) >> 8);
+                expect = ((expect > 127) ? 127 : expect) * 256;
+            }
+            ok &= (back[k] == expect);
+        }
+        snprintf(name, sizeof(name), "s16 <-> %s round trip", f.name);
+        check(ok, name);
+
+        // the same in place, widening back to front
+        std::vector<uint8_t> inplace(4 * n + 8);
+        memcpy(inplace.data(), ref.data(), n * sizeof(int16_t));
+        audio_pcm_from_s16(inplace.data(), f.fmt, reinterpret_cast<int16_t*>(inplace.data()), n, NULL);
+        snprintf(name, sizeof(name), "s16 -> %s in place", f.name);
+        check(memcmp(inplace.data(), wide.data(), n * audio_pcm_format_bytes(f.fmt)) == 0, name);
+        audio_pcm_to_s16(reinterpret_cast<int16_t*>(inplace.data()), inplace.data(), f.fmt, n, NULL);
+        snprintf(name, sizeof(name), "%s -> s16 in place", f.name);
+        check(memcmp(inplace.data(), back.data(), n * sizeof(int16_t)) == 0, name);
+
+        snprintf(name, sizeof(name), "s16 -> %s", f.name);
+        printf("%-28s %12.1f\n", name, rate(loops, n, [&] { audio_pcm_from_s16(wide.data(), f.fmt, ref.data(), n, NULL); }));
+        snprintf(name, sizeof(name), "%s -> s16", f.name);
+        printf("%-28s %12.1f\n", name, rate(loops, n, [&] { audio_pcm_to_s16(out.data(), wide.data(), f.fmt, n, NULL); }));
+        snprintf(name, sizeof(name), "%s -> s16 dithered", f.name);
+        if(f.fmt != AUDIO_PCM_U8) {
+            printf("%-28s %12.1f\n", name, rate(loops, n, [&] { audio_pcm_to_s16(out.data(), wide.data(), f.fmt, n, &dither); }));
+        } else {
+            snprintf(name, sizeof(name), "s16 -> %s dithered", f.name);
+            printf("%-28s %12.1f\n", name, rate(loops, n, [&] { audio_pcm_from_s16(wide.data(), f.fmt, ref.data(), n, &dither); }));
+        }
+    }
+
+    // dither: 32 bit input halfway between two 16 bit steps averages out, stays within one step
+    {
+        std::vector<int32_t> half(n, (1000 << 16) + 0x8000);
+        audio_pcm_to_s16(out.data(), half.data(), AUDIO_PCM_S32, n, &dither);
+        double sum = 0;
+        bool bounded = true;
+        for(size_t k = 0; k < n; k++) {
+            sum += out[k];
+            bounded &= (out[k] >= 999) && (out[k] <= 1002);
+        }
+        check(bounded && fabs(sum / n - 1000.5) < 0.05, "s32 -> s16 dither is +-1 LSB TPDF");
+    }
+
+    // channel layouts, in place against separate buffers
+    {
+        std::vector<int16_t> l(n / 2), r(n / 2), il(n + 2);
+        audio_pcm_deinterleave_s16(l.data(), r.data(), ref.data(), n / 2);
+        audio_pcm_interleave_s16(il.data(), l.data(), r.data(), n / 2);
+        check(memcmp(il.data(), ref.data(), n * sizeof(int16_t)) == 0, "deinterleave / interleave");
+        audio_pcm_interleave_s16(il.data() + 1, l.data(), r.data(), n / 2);
+        check(memcmp(il.data() + 1, ref.data(), n * sizeof(int16_t)) == 0, "interleave, unaligned");
+
+        printf("%-28s %12.1f\n", "interleave", rate(loops, n, [&] { audio_pcm_interleave_s16(il.data(), l.data(), r.data(), n / 2); }));
+        printf("%-28s %12.1f\n", "interleave, unaligned", rate(loops, n, [&] { audio_pcm_interleave_s16(il.data() + 1, l.data(), r.data(), n / 2); }));
+        printf("%-28s %12.1f\n", "deinterleave", rate(loops, n, [&] { audio_pcm_deinterleave_s16(l.data(), r.data(), ref.data(), n / 2); }));
+    }
+    {
+        std::vector<int16_t> st(2 * n + 2);
+        audio_pcm_mono_to_stereo_s16(st.data(), ref.data(), n);
+        bool ok = true;
+        for(size_t k = 0; k < n; k++) {
+            ok &= (st[2 * k] == ref[k]) && (st[2 * k + 1] == ref[k]);
+        }
+        check(ok, "mono -> stereo");
+        std::vector<int16_t> inplace(2 * n + 2);
+        memcpy(inplace.data() + 1, ref.data(), n * sizeof(int16_t));
+        audio_pcm_mono_to_stereo_s16(inplace.data() + 1, inplace.data() + 1, n);
+        check(memcmp(inplace.data() + 1, st.data(), 2 * n * sizeof(int16_t)) == 0, "mono -> stereo in place, unaligned");
+
+        audio_pcm_stereo_to_mono_s16(out.data(), ref.data(), n / 2);
+        ok = true;
+        for(size_t k = 0; k < n / 2; k++) {
+            ok &= (out[k] == ((ref[2 * k] + ref[2 * k + 1]) >> 1));
+        }
+        check(ok, "stereo -> mono");
+
+        printf("%-28s %12.1f\n", "mono -> stereo", rate(loops, 2 * n, [&] { audio_pcm_mono_to_stereo_s16(st.data(), ref.data(), n); }));
+        printf("%-28s %12.1f\n", "mono -> stereo, unaligned", rate(loops, 2 * n, [&] { audio_pcm_mono_to_stereo_s16(st.data() + 1, ref.data(), n); }));
+        printf("%-28s %12.1f\n", "mono -> stereo in place", rate(loops, 2 * n, [&] {
+            memcpy(inplace.data(), ref.data(), n * sizeof(int16_t));
+            audio_pcm_mono_to_stereo_s16(inplace.data(), inplace.data(), n);
+        }));
+        printf("%-28s %12.1f\n", "stereo -> mono", rate(loops, n / 2, [&] { audio_pcm_stereo_to_mono_s16(out.data(), ref.data(), n / 2); }));
+    }
+    {
+        // 5.1 full scale on every channel: no clipping, centre and back at -3 dB
+        const size_t frames = n / 6;
+        std::vector<int16_t> six(6 * frames, 20000), st(2 * frames);
+        audio_pcm_downmix_s16(st.data(), six.data(), 6, frames);
+        check(abs(st[0] - 20000) <= 2 && st[0] == st[1], "5.1 down-mix keeps the level");
+        for(size_t k = 0; k < frames; k++) {
+            six[6 * k] = 30000;
+            six[6 * k + 1] = six[6 * k + 2] = six[6 * k + 3] = six[6 * k + 4] = six[6 * k + 5] = 0;
+        }
+        audio_pcm_downmix_s16(six.data(), six.data(), 6, frames);
+        check(six[0] > 12000 && six[0] < 13000 && six[1] == 0, "5.1 down-mix in place, front left alone");
+
+        printf("%-28s %12.1f\n", "5.1 -> stereo", rate(loops, 2 * frames, [&] { audio_pcm_downmix_s16(st.data(), six.data(), 6, frames); }));
+    }
+
+    printf("%s\n", fails ? "FAILED" : "ok");
+    return fails ? 1 : 0;
+}
@@ -0,0 +1,171 @@
+/*
+ * Host benchmark of the polyphase resampler (audio_resample.cpp)
+ *
+ * For every supported source rate to each output rate: THD+N of a 1 kHz and
+ * of a high passband tone at -1 dBFS, and the time per 1000 output frames
+ * (stereo), fed in the mixer's block size. Exits 1 if a THD+N figure misses
+ * the target.
+ *
+ *   resample_bench [-n loops] [-t thdn_db] [-u max_us_per_1k]
+ */
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <vector>
+
+#include "audio_resample.h"
+
+#define BLOCK_FRAMES    256
+
+static const uint32_t in_rates[] = { 8000, 11025, 16000, 22050, 32000, 44100, 48000 };
+static const uint32_t out_rates[] = { 44100, 48000 };
+
+static double now_us(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e6 + ts.tv_nsec / 1e3;
+}
+
+/** Run 'in' (interleaved stereo) through a resampler the way the mixer does, block by block */
+static std::vector<int16_t> convert(uint32_t in_rate, uint32_t out_rate, const std::vector<int16_t> &in, double *us)
+{
+    resampler_t r;
+    std::vector<int16_t> out;
+    if(!resampler_init(&r, in_rate, out_rate, BLOCK_FRAMES)) {
+        fprintf(stderr, "out of memory\n");
+        exit(2);
+    }
+
+    size_t frames = in.size() / 2;
+    size_t used = 0;
+    int16_t block[2 * BLOCK_FRAMES];
+    double start = now_us();
+    while(true) {
+        size_t need = resampler_need(&r, BLOCK_FRAMES);
+        if(need > frames - used) {
+            need = frames - used;
+        }
+        resampler_push(&r, &in[2 * used], need);
+        used += need;
+        size_t n = resampler_run(&r, block, BLOCK_FRAMES);
+        out.insert(out.end(), block, block + 2 * n);
+        if(n < BLOCK_FRAMES) {
+            break;
+        }
+    }
+    *us = now_us() - start;
+    resampler_free(&r);
+    return out;
+}
+
+/**
+ * THD+N of the left channel: least-squares fit of a sine at the known
+ * frequency (plus DC), everything else is distortion and noise. The first
+ * and last 1000 frames are left out to skip the filter's run-in.
+ */
+static double thdn_db(const std::vector<int16_t> &pcm, double freq, uint32_t rate)
+{
+    size_t frames = pcm.size() / 2;
+    size_t a = 1000, b = frames - 1000;
+    double w = 2 * M_PI * freq / rate;
+
+    // normal equations for [sin, cos, 1]
+    double m[3][4] = {};
+    for(size_t k = a; k < b; k++) {
+        double v[3] = { sin(w * k), cos(w * k), 1 };
+        double y = pcm[2 * k];
+        for(int i = 0; i < 3; i++) {
+            for(int j = 0; j < 3; j++) {
+                m[i][j] += v[i] * v[j];
+            }
+            m[i][3] += v[i] * y;
+        }
+    }
+    for(int i = 0; i < 3; i++) {
+        for(int r = 0; r < 3; r++) {
+            if(r != i) {
+                double f = m[r][i] / m[i][i];
+                for(int c = 0; c < 4; c++) {
+                    m[r][c] -= f * m[i][c];
+                }
+            }
+        }
+    }
+    double s = m[0][3] / m[0][0], c = m[1][3] / m[1][1], dc = m[2][3] / m[2][2];
+
+    double sig = 0, err = 0;
+    for(size_t k = a; k < b; k++) {
+        double fit = s * sin(w * k) + c * cos(w * k);
+        double e = pcm[2 * k] - fit - dc;
+        sig += fit * fit;
+        err += e * e;
+    }
+    return 10 * log10(err / sig);
+}
+
+static std::vector<int16_t> tone(double freq, uint32_t rate, size_t frames)
+{
+    std::vector<int16_t> pcm(2 * frames);
+    double amp = 32767 * pow(10, -1 / 20.0);
+    for(size_t k = 0; k < frames; k++) {
+        pcm[2 * k] = pcm[2 * k + 1] = (int16_t)lrint(amp * sin(2 * M_PI * freq * k / rate));
+    }
+    return pcm;
+}
+
+int main(int argc, char **argv)
+{
+    int loops = 5;
+    double target_db = -80;
+    double max_us = 0;
+    int opt;
+    while((opt = getopt(argc, argv, "n:t:u:")) != -1) {
+        switch(opt) {
+        case 'n': loops = atoi(optarg); break;
+        case 't': target_db = atof(optarg); break;
+        case 'u': max_us = atof(optarg); break;
+        default:
+            fprintf(stderr, "usage: %s [-n loops] [-t thdn_db] [-u max_us_per_1k]\n", argv[0]);
+            return 2;
+        }
+    }
+
+    int fail = 0;
+    printf("%6s -> %6s  %12s  %16s  %10s\n", "in", "out", "THD+N 1k", "THD+N high", "us/1k");
+    for(uint32_t out_rate : out_rates) {
+        for(uint32_t in_rate : in_rates) {
+            if(in_rate == out_rate) {
+                continue;
+            }
+            // 'high' is 0.4 of the lower rate, inside the flat part of the passband
+            double high = 0.4 * ((in_rate < out_rate) ? in_rate : out_rate);
+            double us;
+            std::vector<int16_t> low_out = convert(in_rate, out_rate, tone(1000, in_rate, in_rate), &us);
+            std::vector<int16_t> high_out = convert(in_rate, out_rate, tone(high, in_rate, in_rate), &us);
+            double low_db = thdn_db(low_out, 1000, out_rate);
+            double high_db = thdn_db(high_out, high, out_rate);
+
+            double best = 1e30;
+            std::vector<int16_t> in = tone(1000, in_rate, in_rate);
+            for(int l = 0; l < loops; l++) {
+                std::vector<int16_t> o = convert(in_rate, out_rate, in, &us);
+                double per_1k = us * 1000 / (o.size() / 2);
+                if(per_1k < best) {
+                    best = per_1k;
+                }
+            }
+
+            bool ok = (low_db <= target_db) && (high_db <= target_db) && (max_us == 0 || best <= max_us);
+            printf("%6u -> %6u  %9.1f dB  %9.1f dB @%5.0f  %10.2f%s\n", in_rate, out_rate, low_db, high_db,
+                   high, best, ok ? "" : "  FAIL");
+            fail |= !ok;
+        }
+    }
+    printf("target THD+N %.0f dB%s\n", target_db, fail ? ": FAILED" : ": ok");
+    return fail;
+}
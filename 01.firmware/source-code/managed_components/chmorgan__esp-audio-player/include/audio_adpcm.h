@@ -0,0 +1,90 @@
+/**
+ * @file
+ * @version 0.1
+ *
+ * @copyright Copyright 2021 Espressif Systems (Shanghai) Co. Ltd.
+ * @copyright Copyright 2022 Chris Morgan <chmorgan@gmail.com>
+ *
+ *      Licensed under the Apache License, Version 2.0 (the "License");
+ *      you may not use this file except in compliance with the License.
+ *      You may obtain a copy of the License at
+ *
+ *               http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *      Unless required by applicable law or agreed to in writing, software
+ *      distributed under the License is distributed on an "AS IS" BASIS,
+ *      WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *      See the License for the specific language governing permissions and
+ *      limitations under the License.
+ */
+
+/**
+ * ADPCM block decoders
+ *
+ * The 4 bit IMA (DVI) and Microsoft ADPCM of WAV and AVI files, a quarter of
+ * the size of 16 bit PCM for a few table lookups per sample. Both come in
+ * blocks of block_align bytes that start with a header holding the decoder
+ * state, so every block decodes on its own and seeking is by block.
+ *
+ * - The per-sample work is a lookup of the step (IMA) or adaptation (MS)
+ * table, one add and a saturation, without branches on the nibble value.
+ *
+ * - Output is interleaved 16 bit, 1 or 2 channels as the file has them.
+ *
+ * - Microsoft ADPCM is decoded with the seven standard predictor
+ * coefficient pairs, which every encoder writes.
+ */
+
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef enum {
+    AUDIO_ADPCM_IMA,    /*< WAVE_FORMAT_IMA_ADPCM (0x11) */
+    AUDIO_ADPCM_MS,     /*< WAVE_FORMAT_ADPCM (0x02) */
+} audio_adpcm_codec_t;
+
+#define AUDIO_ADPCM_MAX_CHANNELS    2
+
+typedef struct {
+    audio_adpcm_codec_t codec;
+    uint16_t channels;          /*< 1 or 2 */
+    uint16_t block_align;       /*< bytes per block, header included */
+    uint16_t samples_per_block; /*< frames a whole block decodes to */
+} audio_adpcm_format_t;
+
+/**
+ * @brief ADPCM format of a WAVEFORMATEX
+ *
+ * @param format_tag - 0x11 (IMA) or 0x02 (MS)
+ * @param samples_per_block - wSamplesPerBlock of the format extension, 0 if there is none
+ * @return false for other tags, bit depths but 4, more than two channels or a block_align
+ *         too small for the header; samples_per_block beyond what block_align holds is
+ *         cut down to it
+ */
+bool audio_adpcm_format_from_wav(uint16_t format_tag, uint16_t channels, uint16_t block_align,
+                                 uint16_t bits_per_sample, uint16_t samples_per_block,
+                                 audio_adpcm_format_t *fmt);
+
+/** Frames a block of 'bytes' decodes to, less than samples_per_block for a short last block */
+size_t audio_adpcm_block_frames(const audio_adpcm_format_t *fmt, size_t bytes);
+
+/**
+ * @brief Decode one block
+ *
+ * @param dst - room for samples_per_block * channels samples
+ * @param bytes - block_align, or less for the last block of a stream
+ * @return frames written, 0 if bytes does not cover the block header
+ */
+size_t audio_adpcm_decode_block(const audio_adpcm_format_t *fmt, int16_t *dst, const uint8_t *block,
+                                size_t bytes);
+
+#ifdef __cplusplus
+}
+#endif
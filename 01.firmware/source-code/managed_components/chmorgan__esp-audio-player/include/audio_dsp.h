@@ -0,0 +1,145 @@
+/**
+ * @file
+ * @version 0.1
+ *
+ * @copyright Copyright 2021 Espressif Systems (Shanghai) Co. Ltd.
+ * @copyright Copyright 2022 Chris Morgan <chmorgan@gmail.com>
+ *
+ *      Licensed under the Apache License, Version 2.0 (the "License");
+ *      you may not use this file except in compliance with the License.
+ *      You may obtain a copy of the License at
+ *
+ *               http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *      Unless required by applicable law or agreed to in writing, software
+ *      distributed under the License is distributed on an "AS IS" BASIS,
+ *      WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *      See the License for the specific language governing permissions and
+ *      limitations under the License.
+ */
+
+/**
+ * Post-decode effects chain: equalizer, volume, limiter
+ *
+ * Runs in place on 16 bit stereo, in the writing task, e.g. from the
+ * write_fn of the audio player before the PCM goes on to the mixer or i2s.
+ *
+ * - Equalizer: up to AUDIO_DSP_MAX_BANDS biquads (RBJ peaking and shelving
+ * filters) in series, Q28 coefficients, 64 bit accumulators and error
+ * feedback, so low bands at 44.1 kHz stay clean. Flat bands cost nothing.
+ *
+ * - Volume: Q15 gain ramped linearly, frame by frame, over the requested
+ * time. A change without a ramp is taken by each channel where its signal
+ * crosses zero (or after 20 ms without a crossing), so it does not click.
+ *
+ * - Limiter: look-ahead peak limiter, both channels linked. The gain is
+ * brought down linearly over the look-ahead time, ahead of each peak, and
+ * recovers over the release time. The output is delayed by the look-ahead.
+ *
+ * Audio goes through in blocks of AUDIO_DSP_BLOCK_FRAMES: the equalizer
+ * reads the caller's buffer into a 32 bit work block, the volume scales it in
+ * place and the limiter writes it back, so the caller's buffer is read and
+ * written once whatever is enabled. The CPU cycles of each stage are counted
+ * (TSC or nanoseconds in a host build).
+ *
+ * The setters may be called from any task. Changes are picked up at the start
+ * of the next audio_dsp_process(), which never waits for them.
+ */
+
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define AUDIO_DSP_MAX_BANDS         10
+#define AUDIO_DSP_BLOCK_FRAMES      256
+#define AUDIO_DSP_VOLUME_UNITY      32768   /**< volumes are Q15, 0 mutes */
+#define AUDIO_DSP_EQ_MAX_DB         15      /**< band gains are clamped to +-this */
+
+typedef enum {
+    AUDIO_DSP_EQ_PEAK,
+    AUDIO_DSP_EQ_LOW_SHELF,
+    AUDIO_DSP_EQ_HIGH_SHELF,
+} audio_dsp_eq_type_t;
+
+typedef struct {
+    audio_dsp_eq_type_t type;
+    float freq;                 /*< centre or corner frequency in Hz */
+    float gain_db;              /*< 0 for flat */
+    float q;                    /*< 0 for 0.707 */
+} audio_dsp_eq_band_t;
+
+typedef struct {
+    uint32_t sample_rate;       /*< 0 for 44100, see audio_dsp_set_rate() */
+    uint8_t bands;              /*< in band[], up to AUDIO_DSP_MAX_BANDS */
+    audio_dsp_eq_band_t band[AUDIO_DSP_MAX_BANDS];
+    uint16_t volume;            /*< Q15 starting volume, 0 starts muted */
+    float limit_db;             /*< limiter ceiling in dBFS, 0 for -1.0 */
+    uint32_t lookahead_ms;      /*< 0 for 2 */
+    uint32_t release_ms;        /*< 0 for 100 */
+} audio_dsp_config_t;
+
+typedef struct audio_dsp *audio_dsp_handle_t;
+
+typedef enum {
+    AUDIO_DSP_STAGE_EQ,
+    AUDIO_DSP_STAGE_VOLUME,
+    AUDIO_DSP_STAGE_LIMITER,
+    AUDIO_DSP_STAGE_MAX,
+} audio_dsp_stage_t;
+
+typedef struct {
+    uint64_t frames;                        /*< processed */
+    uint64_t cycles[AUDIO_DSP_STAGE_MAX];   /*< spent in each stage over those frames */
+    uint32_t limited_frames;                /*< that left the limiter with the gain reduced */
+    uint16_t limiter_gain;                  /*< Q15, the present gain reduction */
+    uint16_t volume;                        /*< Q15, where the volume ramp is */
+} audio_dsp_stats_t;
+
+/**
+ * @brief Create an effects chain
+ *
+ * @return NULL if out of memory
+ */
+audio_dsp_handle_t audio_dsp_new(const audio_dsp_config_t *config);
+void audio_dsp_delete(audio_dsp_handle_t dsp);
+
+/**
+ * @brief Process 16 bit stereo frames in place
+ *
+ * Not to be called from two tasks at once.
+ */
+void audio_dsp_process(audio_dsp_handle_t dsp, int16_t *frames, size_t count);
+
+/** Clear the filters and the look-ahead delay, e.g. before an unrelated stream */
+void audio_dsp_reset(audio_dsp_handle_t dsp);
+
+/** Recompute the filters and times for a new rate, call it between writes of the old and new rate */
+void audio_dsp_set_rate(audio_dsp_handle_t dsp, uint32_t sample_rate);
+
+/**
+ * @brief Change one equalizer band
+ *
+ * @param index - below AUDIO_DSP_MAX_BANDS, bands up to it that were not set are flat
+ * @return false if index is out of range
+ */
+bool audio_dsp_set_band(audio_dsp_handle_t dsp, uint8_t index, const audio_dsp_eq_band_t *band);
+
+/**
+ * @brief Ramp the volume
+ *
+ * @param volume - Q15, AUDIO_DSP_VOLUME_UNITY for unchanged, 0 mutes
+ * @param ramp_ms - time to get there, 0 for the next zero crossing
+ */
+void audio_dsp_set_volume(audio_dsp_handle_t dsp, uint16_t volume, uint32_t ramp_ms);
+
+void audio_dsp_get_stats(audio_dsp_handle_t dsp, audio_dsp_stats_t *stats);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,225 @@
+/**
+ * @file
+ * @version 0.1
+ *
+ * @copyright Copyright 2021 Espressif Systems (Shanghai) Co. Ltd.
+ * @copyright Copyright 2022 Chris Morgan <chmorgan@gmail.com>
+ *
+ *      Licensed under the Apache License, Version 2.0 (the "License");
+ *      you may not use this file except in compliance with the License.
+ *      You may obtain a copy of the License at
+ *
+ *               http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *      Unless required by applicable law or agreed to in writing, software
+ *      distributed under the License is distributed on an "AS IS" BASIS,
+ *      WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *      See the License for the specific language governing permissions and
+ *      limitations under the License.
+ */
+
+/**
+ * Design notes
+ *
+ * - The mixer owns the output. It programs the i2s clock once, at a fixed
+ * rate, 16 bit stereo, and a mixer task writes one block of
+ * block_frames at a time. Any number of sources (music from the audio player,
+ * video sound tracks, UI sounds) feed it in their own format.
+ *
+ * - Each source is a byte ring that its producer writes into, converted to
+ * 16 bit stereo on the way in. The mixer task resamples each source to the
+ * output rate (fixed-point polyphase filter, 8 to 48 kHz at better than
+ * -80 dB THD+N), applies its gain and sums them in 32 bits, saturating once
+ * into the output block. When only one source has data it is rendered
+ * straight into the output block without the sum.
+ *
+ * - Gain changes are ramped per frame over the requested time, so that
+ * ducking the music under a UI sound or muting a video does not click.
+ *
+ * - Regular sources are mixed once half of their ring is filled, and again
+ * after running dry, so a producer that stutters does not turn into crackle.
+ * Low-latency sources (UI sounds) have a short ring and are mixed from the
+ * first frame, they are heard one block after they were written.
+ *
+ * - With no source playing the mixer writes a few silent blocks to flush the
+ * i2s DMA and then sleeps until a source is written to.
+ *
+ * - Instead of write_fn the output can lend its DMA buffers (acquire_fn /
+ * commit_fn, e.g. esp_codec_dev_acquire_write()): blocks are then mixed
+ * straight into them, saving the copy of each block into the DMA buffer.
+ *
+ * Typical use with the audio player: pass a write_fn that forwards to
+ * audio_mixer_source_write() and a clk_set_fn that forwards to
+ * audio_mixer_source_set_format() for the music source.
+ */
+
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "esp_err.h"
+#include "freertos/FreeRTOS.h"
+#include "audio_player.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define AUDIO_MIXER_GAIN_UNITY  32768   /**< gains are Q15, 0 mutes */
+
+/**
+ * @brief Lend output space to mix into, blocking until the output has some
+ *
+ * The same space is returned until it is committed.
+ */
+typedef esp_err_t (*audio_mixer_acquire_fn)(void **buffer, size_t *len, uint32_t timeout_ms);
+
+/** @brief Hand the first 'len' bytes of the acquired space to the output */
+typedef esp_err_t (*audio_mixer_commit_fn)(size_t len);
+
+typedef struct {
+    audio_reconfig_std_clock clk_set_fn; /*< called once, with sample_rate, 16 bit, stereo */
+    audio_player_write_fn write_fn;      /*< receives 16 bit stereo blocks, unless acquire_fn is set */
+    audio_mixer_acquire_fn acquire_fn;   /*< optional, mix in place into lent output buffers */
+    audio_mixer_commit_fn commit_fn;     /*< required with acquire_fn */
+    uint32_t sample_rate;                /*< output rate, 0 for 44100 */
+    uint32_t block_frames;               /*< frames mixed per block, 0 for CONFIG_AUDIO_PLAYER_MIXER_BLOCK_FRAMES */
+    UBaseType_t priority;                /*< FreeRTOS task priority, above the producers */
+    BaseType_t coreID;                   /*< ESP32 core ID */
+} audio_mixer_config_t;
+
+/**
+ * @brief Create the mixer and start its task
+ *
+ * @return
+ *    - ESP_OK: Success
+ *    - ESP_ERR_INVALID_ARG: clk_set_fn missing, or neither write_fn nor acquire_fn with commit_fn
+ *    - ESP_ERR_INVALID_STATE: already created
+ *    - ESP_ERR_NO_MEM: out of memory
+ *    - Others: error from clk_set_fn
+ */
+esp_err_t audio_mixer_new(const audio_mixer_config_t *config);
+
+/**
+ * @brief Stop the mixer task and free its memory
+ *
+ * All sources must have been deleted.
+ *
+ * @return
+ *    - ESP_OK: Success
+ *    - ESP_ERR_INVALID_STATE: not created, or sources left
+ */
+esp_err_t audio_mixer_delete(void);
+
+typedef struct audio_mixer_source *audio_mixer_source_handle_t;
+
+typedef struct {
+    const char *name;          /*< for logs, not copied */
+    uint32_t sample_rate;
+    uint8_t channels;          /*< 1 or 2 */
+    uint8_t bits_per_sample;   /*< 16 */
+    uint16_t gain;             /*< Q15, AUDIO_MIXER_GAIN_UNITY for unchanged, 0 is taken as unity */
+    bool low_latency;          /*< short ring, mixed from the first frame on */
+    uint32_t buffer_ms;        /*< ring length, 0 for the default of the kind of source */
+} audio_mixer_source_config_t;
+
+/**
+ * @brief Add a source to the mix
+ *
+ * @return
+ *    - ESP_OK: Success
+ *    - ESP_ERR_INVALID_ARG: bad format or NULL pointers
+ *    - ESP_ERR_INVALID_STATE: mixer not created
+ *    - ESP_ERR_NO_MEM: out of memory
+ */
+esp_err_t audio_mixer_source_new(const audio_mixer_source_config_t *config, audio_mixer_source_handle_t *handle);
+
+/**
+ * @brief Remove a source from the mix, dropping what it has buffered
+ *
+ * Not to be called while another task is inside audio_mixer_source_write() for it.
+ */
+esp_err_t audio_mixer_source_delete(audio_mixer_source_handle_t handle);
+
+/**
+ * @brief Queue PCM for mixing
+ *
+ * Same contract as audio_player_write_fn: blocks while the ring is full, for
+ * at most timeout_ms. Only one task may write to a source.
+ *
+ * @param data - frames in the format of the source
+ * @param len - in bytes, whole frames
+ * @param bytes_written - set to the bytes accepted, may be NULL
+ * @return
+ *    - ESP_OK: all of it accepted
+ *    - ESP_ERR_TIMEOUT: the ring stayed full, see bytes_written
+ *    - ESP_ERR_INVALID_ARG: bad arguments
+ */
+esp_err_t audio_mixer_source_write(audio_mixer_source_handle_t handle, const void *data, size_t len,
+                                   size_t *bytes_written, uint32_t timeout_ms);
+
+/**
+ * @brief Change the format of the following writes
+ *
+ * A rate change waits until the buffered audio of the old rate has been
+ * mixed, so call it from the writing task, between writes.
+ *
+ * @return
+ *    - ESP_OK: Success
+ *    - ESP_ERR_INVALID_ARG: unsupported format
+ *    - ESP_ERR_NO_MEM: out of memory
+ */
+esp_err_t audio_mixer_source_set_format(audio_mixer_source_handle_t handle, uint32_t sample_rate,
+                                        uint32_t bits_per_sample, uint32_t channels);
+
+/**
+ * @brief Ramp the gain of a source
+ *
+ * @param gain - Q15, AUDIO_MIXER_GAIN_UNITY for unchanged, 0 mutes
+ * @param ramp_ms - time to get there, 0 for the next block
+ */
+esp_err_t audio_mixer_source_set_gain(audio_mixer_source_handle_t handle, uint16_t gain, uint32_t ramp_ms);
+
+/**
+ * @brief Drop the audio buffered for a source, e.g. when its producer stops or seeks
+ */
+esp_err_t audio_mixer_source_flush(audio_mixer_source_handle_t handle);
+
+typedef struct {
+    uint32_t buffer_bytes;     /*< ring capacity, in 16 bit stereo at the source rate */
+    uint32_t fill_bytes;       /*< presently buffered */
+    uint32_t latency_ms;       /*< buffered audio plus one mixer block, before the i2s DMA */
+    uint32_t underruns;        /*< times the ring ran dry while being mixed */
+    uint64_t frames_mixed;     /*< source frames consumed */
+} audio_mixer_source_stats_t;
+
+esp_err_t audio_mixer_source_get_stats(audio_mixer_source_handle_t handle, audio_mixer_source_stats_t *stats);
+
+typedef struct {
+    uint32_t sample_rate;
+    uint32_t block_frames;
+    uint32_t block_us;         /*< duration of one block, the latency the mixer adds */
+    uint32_t mix_us_last;      /*< CPU time of the last block, write_fn excluded */
+    uint32_t mix_us_avg;       /*< running average over ~16 blocks */
+    uint32_t mix_us_max;
+    uint32_t cpu_permille;     /*< mix_us_avg / block_us */
+    uint32_t sources;          /*< registered */
+    uint32_t active;           /*< mixed into the last block */
+    uint32_t single_blocks;    /*< blocks that took the single-source path */
+    uint64_t blocks;           /*< blocks written, silent ones included */
+} audio_mixer_stats_t;
+
+/**
+ * @brief Get mixer load and latency
+ *
+ * @return
+ *    - ESP_OK: Success
+ *    - ESP_ERR_INVALID_ARG: stats is NULL
+ *    - ESP_ERR_INVALID_STATE: mixer not created
+ */
+esp_err_t audio_mixer_get_stats(audio_mixer_stats_t *stats);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,82 @@
+/**
+ * @file
+ * @version 0.1
+ *
+ * @copyright Copyright 2021 Espressif Systems (Shanghai) Co. Ltd.
+ * @copyright Copyright 2022 Chris Morgan <chmorgan@gmail.com>
+ *
+ *      Licensed under the Apache License, Version 2.0 (the "License");
+ *      you may not use this file except in compliance with the License.
+ *      You may obtain a copy of the License at
+ *
+ *               http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *      Unless required by applicable law or agreed to in writing, software
+ *      distributed under the License is distributed on an "AS IS" BASIS,
+ *      WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *      See the License for the specific language governing permissions and
+ *      limitations under the License.
+ */
+
+/**
+ * Streaming MP3 decoding
+ *
+ * For mp3 that arrives in pieces cut without regard to frame boundaries,
+ * such as the audio chunks of an AVI file (format tag 0x55). Bytes are
+ * collected until a whole frame is there, so frames split across pieces
+ * decode as if they had come in one. Decoded frames are handed to a
+ * callback as 16 bit interleaved PCM.
+ *
+ * - Only available with CONFIG_AUDIO_PLAYER_ENABLE_MP3.
+ *
+ * - A stream keeps a libhelix decoder, about 24 KB, plus 8 KB of buffers.
+ */
+
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct audio_mp3_stream audio_mp3_stream_t;
+
+/**
+ * @brief Decoded frame
+ *
+ * @param pcm - frames * channels samples, only valid during the call
+ */
+typedef void (*audio_mp3_stream_cb_t)(const int16_t *pcm, size_t frames, uint32_t sample_rate, uint8_t channels,
+                                      void *arg);
+
+typedef struct {
+    uint32_t frames;        /*< mp3 frames decoded */
+    uint32_t split;         /*< of those, frames that arrived in more than one piece */
+    uint32_t errors;        /*< frames the decoder refused, skipped */
+    uint32_t skipped;       /*< bytes dropped looking for a frame header */
+} audio_mp3_stream_stats_t;
+
+/** @return NULL if out of memory */
+audio_mp3_stream_t *audio_mp3_stream_new(void);
+
+void audio_mp3_stream_delete(audio_mp3_stream_t *s);
+
+/** Drop buffered bytes and the bit reservoir, for a new stream or after a jump in this one */
+void audio_mp3_stream_reset(audio_mp3_stream_t *s);
+
+/**
+ * @brief Decode what 'data' completes, keep the rest for the next call
+ *
+ * @return frames handed to cb (one sample per channel each)
+ */
+size_t audio_mp3_stream_feed(audio_mp3_stream_t *s, const uint8_t *data, size_t len, audio_mp3_stream_cb_t cb,
+                             void *arg);
+
+void audio_mp3_stream_get_stats(const audio_mp3_stream_t *s, audio_mp3_stream_stats_t *out);
+
+#ifdef __cplusplus
+}
+#endif
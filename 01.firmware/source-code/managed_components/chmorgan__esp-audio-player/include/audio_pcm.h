@@ -0,0 +1,122 @@
+/**
+ * @file
+ * @version 0.1
+ *
+ * @copyright Copyright 2021 Espressif Systems (Shanghai) Co. Ltd.
+ * @copyright Copyright 2022 Chris Morgan <chmorgan@gmail.com>
+ *
+ *      Licensed under the Apache License, Version 2.0 (the "License");
+ *      you may not use this file except in compliance with the License.
+ *      You may obtain a copy of the License at
+ *
+ *               http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *      Unless required by applicable law or agreed to in writing, software
+ *      distributed under the License is distributed on an "AS IS" BASIS,
+ *      WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *      See the License for the specific language governing permissions and
+ *      limitations under the License.
+ */
+
+/**
+ * PCM format conversions
+ *
+ * Between the little-endian sample formats of WAV and AVI files and the 16 bit
+ * signed samples the player and the mixer work in, plus channel layout
+ * changes. Counts are in samples or frames, never bytes.
+ *
+ * - Unless noted otherwise dst may be the same buffer as src, for in-place
+ * conversion, but must not overlap it in any other way. In-place conversions
+ * that widen the data run back to front.
+ *
+ * - The loops are plain enough for the compiler to vectorize. Buffers
+ * aligned to 4 bytes take paths that move two 16 bit samples per word.
+ *
+ * - Narrowing to fewer bits rounds, or adds triangular (TPDF) dither of
+ * +-1 LSB first when given a dither state.
+ *
+ * - G.711 A-law and mu-law expand through a 256 entry table and compress
+ * as ITU-T G.711 does, without dither.
+ */
+
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef enum {
+    AUDIO_PCM_U8,       /*< unsigned, 128 is silence */
+    AUDIO_PCM_S16,
+    AUDIO_PCM_S24,      /*< packed in 3 bytes */
+    AUDIO_PCM_S32,
+    AUDIO_PCM_F32,      /*< -1.0 to 1.0 */
+    AUDIO_PCM_ALAW,     /*< G.711 A-law, 8 bit companded */
+    AUDIO_PCM_MULAW,    /*< G.711 mu-law, 8 bit companded */
+} audio_pcm_format_t;
+
+#define AUDIO_PCM_MAX_CHANNELS  8
+
+/** Dither noise generator, any seed will do */
+typedef struct {
+    uint32_t state;
+} audio_pcm_dither_t;
+
+/** Bytes per sample */
+size_t audio_pcm_format_bytes(audio_pcm_format_t fmt);
+
+/**
+ * @brief Sample format of a WAVEFORMAT(EX) format tag and bit depth
+ *
+ * @param format_tag - 1 (PCM), 3 (IEEE float), 6 (A-law) or 7 (mu-law), the sub-format for
+ *                     WAVE_FORMAT_EXTENSIBLE
+ * @return false if not one of audio_pcm_format_t
+ */
+bool audio_pcm_format_from_wav(uint16_t format_tag, uint16_t bits_per_sample, audio_pcm_format_t *fmt);
+
+/**
+ * @brief Convert to 16 bit
+ *
+ * @param dither - NULL to round
+ */
+void audio_pcm_to_s16(int16_t *dst, const void *src, audio_pcm_format_t fmt, size_t samples,
+                      audio_pcm_dither_t *dither);
+
+/**
+ * @brief Convert from 16 bit
+ *
+ * @param dither - only used for AUDIO_PCM_U8, NULL to round
+ */
+void audio_pcm_from_s16(void *dst, audio_pcm_format_t fmt, const int16_t *src, size_t samples,
+                        audio_pcm_dither_t *dither);
+
+/** dst gets 2 * frames samples, each mono sample on both channels */
+void audio_pcm_mono_to_stereo_s16(int16_t *dst, const int16_t *src, size_t frames);
+
+/** dst gets the average of left and right */
+void audio_pcm_stereo_to_mono_s16(int16_t *dst, const int16_t *src, size_t frames);
+
+/**
+ * @brief Down-mix WAV channel order (FL FR FC LFE BL BR SL SR) to stereo
+ *
+ * Centre, back and side channels go in at -3 dB, LFE is dropped, the result
+ * is scaled so that it cannot clip. One channel goes to both sides, two are
+ * copied as they are.
+ *
+ * @param channels - 1 to AUDIO_PCM_MAX_CHANNELS, nothing is written for more
+ */
+void audio_pcm_downmix_s16(int16_t *dst, const int16_t *src, size_t channels, size_t frames);
+
+/** Stereo frames from two channel arrays, dst must not overlap the sources */
+void audio_pcm_interleave_s16(int16_t *dst, const int16_t *left, const int16_t *right, size_t frames);
+
+/** Two channel arrays from stereo frames, the destinations must not overlap src */
+void audio_pcm_deinterleave_s16(int16_t *left, int16_t *right, const int16_t *src, size_t frames);
+
+#ifdef __cplusplus
+}
+#endif
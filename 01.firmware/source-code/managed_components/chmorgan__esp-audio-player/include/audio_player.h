@@ -27,6 +27,28 @@
  * vs. detecting that the audio file transitioned by looking at
  * events indicating IDLE and then PLAYING within a short period of time.
  *
+ * - Decoding and output are decoupled. The audio task decodes ahead into a
+ * PCM ring (CONFIG_AUDIO_PLAYER_PCM_RING_MS long) and a writer task, one
+ * priority level above it, drains the ring into write_fn. A slow read from
+ * the file system therefore only eats into the buffered audio instead of
+ * starving the i2s DMA. See audio_player_get_stats().
+ *
+ * - Gapless playback. With a next-track callback registered (see
+ * audio_player_next_register()) the following file is opened and decoded
+ * into the same ring while the previous one is still playing out of it, so
+ * there is no gap and no i2s clock change unless the format differs.
+ * The encoder delay and padding recorded in LAME / Xing tags are dropped.
+ * COMPLETED_PLAYING_NEXT is sent when the new track becomes audible.
+ *
+ * - Seeking. audio_player_seek() drops the buffered audio and repositions the
+ * decoder: wav files and mp3 files with an "Info" (constant bitrate) tag by
+ * arithmetic, VBR mp3 files through their Xing or VBRI table of contents.
+ * mp3 files with neither get their frame headers scanned into a sparse index
+ * while the decoder waits on a full ring. Until the scan has come far enough
+ * the position is estimated from the bitrate, after that it is sample exact,
+ * and the indexes of the last CONFIG_AUDIO_PLAYER_MP3_INDEX_CACHE files are
+ * kept. Position and duration refer to the audio being written, not decoded.
+ *
  * State machine diagram
  *
  * cb is the callback function registered with audio_player_callback_register()
@@ -133,6 +155,48 @@ esp_err_t audio_player_resume(void);
  */
 esp_err_t audio_player_stop(void);
 
+/**
+ * @brief Continue the present file at another position
+ *
+ * Buffered audio is dropped, the new position becomes audible once the
+ * decoder has refilled part of the ring. A paused player stays paused.
+ *
+ * @param position_ms - from the start of the file, clamped to its end
+ * @return
+ *    - ESP_OK: Success in queuing seek request
+ *    - ESP_ERR_INVALID_STATE: not playing or paused
+ *    - Others: Fail
+ */
+esp_err_t audio_player_seek(uint32_t position_ms);
+
+/**
+ * @brief Get the playback position within the present file
+ *
+ * Counted from what has been handed to write_fn, so it excludes the audio
+ * buffered in the ring.
+ *
+ * @return
+ *    - ESP_OK: Success
+ *    - ESP_ERR_INVALID_ARG: position_ms is NULL
+ *    - ESP_ERR_INVALID_STATE: not playing or paused
+ */
+esp_err_t audio_player_get_position(uint32_t *position_ms);
+
+/**
+ * @brief Get the length of the present file
+ *
+ * Exact for wav files and for mp3 files with a Xing / VBRI frame count, an
+ * estimate from the bitrate for other mp3 files until their frame index
+ * is complete.
+ *
+ * @param duration_ms - set to the length, 0 if unknown
+ * @return
+ *    - ESP_OK: Success
+ *    - ESP_ERR_INVALID_ARG: duration_ms is NULL
+ *    - ESP_ERR_INVALID_STATE: not playing or paused
+ */
+esp_err_t audio_player_get_duration(uint32_t *duration_ms);
+
 /**
  * @brief Register callback for audio event
  *
@@ -144,6 +208,28 @@ esp_err_t audio_player_stop(void);
  */
 esp_err_t audio_player_callback_register(audio_player_cb_t call_back, void *user_ctx);
 
+/**
+ * Next-track callback type, see audio_player_next_register()
+ *
+ * @return FILE* to continue with, handled like the fp passed to audio_player_play(),
+ *         or NULL to finish playback
+ */
+typedef FILE *(*audio_player_next_cb_t)(void *user_ctx);
+
+/**
+ * @brief Register callback supplying the next file for gapless playback
+ *
+ * Called from the audio task when the present file has been decoded to the end,
+ * while its last CONFIG_AUDIO_PLAYER_PCM_RING_MS of audio are still buffered, so
+ * it must return quickly. Not called for files that were stopped or replaced.
+ *
+ * @param next_cb Call back function, NULL to disable gapless playback
+ * @param user_ctx User context
+ * @return
+ *    - ESP_OK: Success
+ */
+esp_err_t audio_player_next_register(audio_player_next_cb_t next_cb, void *user_ctx);
+
 typedef enum {
     AUDIO_PLAYER_MUTE,
     AUDIO_PLAYER_UNMUTE
@@ -157,8 +243,9 @@ typedef struct {
     audio_player_mute_fn mute_fn;
     audio_reconfig_std_clock clk_set_fn;
     audio_player_write_fn write_fn;
-    UBaseType_t priority; /*< FreeRTOS task priority */
+    UBaseType_t priority; /*< FreeRTOS task priority, the pcm writer task runs at priority + 1 */
     BaseType_t coreID; /*< ESP32 core ID */
+    uint32_t pcm_ring_ms; /*< decode-ahead buffer length, 0 for CONFIG_AUDIO_PLAYER_PCM_RING_MS */
 } audio_player_config_t;
 
 /**
@@ -170,6 +257,28 @@ typedef struct {
  */
 esp_err_t audio_player_new(audio_player_config_t config);
 
+typedef struct {
+    uint32_t underruns;      /*< times the writer found the ring empty while playing */
+    uint32_t ring_size;      /*< capacity of the decode-ahead ring in bytes */
+    uint32_t fill_bytes;     /*< PCM bytes presently buffered */
+    uint32_t fill_min_bytes; /*< lowest fill seen since the current file started playing */
+    uint32_t fill_ms;        /*< fill_bytes expressed in ms of the current output format */
+    uint64_t bytes_written;  /*< total PCM bytes handed to write_fn */
+} audio_player_stats_t;
+
+/**
+ * @brief Get decode-ahead buffer statistics
+ *
+ * Safe to call from any task while the player is running.
+ *
+ * @param stats - filled with a snapshot of the present values
+ * @return
+ *    - ESP_OK: Success
+ *    - ESP_ERR_INVALID_ARG: stats is NULL
+ *    - ESP_ERR_INVALID_STATE: audio_player_new() has not been called
+ */
+esp_err_t audio_player_get_stats(audio_player_stats_t *stats);
+
 /**
  * @brief Shut down audio task, free allocated memory.
  *
@@ -0,0 +1,257 @@
+// Copyright 2020 Espressif Systems (Shanghai) Co. Ltd.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <stdio.h>
+#include <string.h>
+#include "esp_log.h"
+#include "unity.h"
+#include "audio_mixer.h"
+#include "freertos/task.h"
+
+static const char *TAG = "AUDIO MIXER TEST";
+
+#define MIX_RATE        44100
+#define MIX_BLOCK       256
+
+/*
+ * Sink running at the real-time rate of 44.1 kHz 16 bit stereo, remembering
+ * the peak and the number of non-silent frames it was handed.
+ */
+static uint32_t sink_frames;
+static uint32_t sink_loud_frames;
+static int16_t sink_peak;
+static int16_t sink_last;
+
+static esp_err_t sink_write(void *audio_buffer, size_t len, size_t *bytes_written, uint32_t timeout_ms)
+{
+    static uint32_t carry;
+    const int16_t *pcm = (const int16_t *)audio_buffer;
+    size_t frames = len / (2 * sizeof(int16_t));
+
+    for (size_t k = 0; k < frames; k++) {
+        int16_t l = pcm[2 * k];
+        if (l != 0) {
+            sink_loud_frames++;
+            sink_last = l;
+        }
+        if (l > sink_peak) {
+            sink_peak = l;
+        }
+    }
+    sink_frames += frames;
+
+    carry += frames;
+    uint32_t ms = carry * 1000 / MIX_RATE;
+    carry -= ms * MIX_RATE / 1000;
+    vTaskDelay(pdMS_TO_TICKS(ms));
+
+    *bytes_written = len;
+    return ESP_OK;
+}
+
+static esp_err_t sink_clk(uint32_t rate, uint32_t bits_cfg, i2s_slot_mode_t ch)
+{
+    TEST_ASSERT_EQUAL(MIX_RATE, rate);
+    TEST_ASSERT_EQUAL(16, bits_cfg);
+    TEST_ASSERT_EQUAL(I2S_SLOT_MODE_STEREO, ch);
+    return ESP_OK;
+}
+
+static void sink_reset(void)
+{
+    sink_frames = 0;
+    sink_loud_frames = 0;
+    sink_peak = 0;
+    sink_last = 0;
+}
+
+static void mixer_start(void)
+{
+    audio_mixer_config_t config = { .clk_set_fn = sink_clk,
+                                    .write_fn = sink_write,
+                                    .sample_rate = MIX_RATE,
+                                    .block_frames = MIX_BLOCK,
+                                    .priority = 6,
+                                    .coreID = 0 };
+    TEST_ASSERT_EQUAL(ESP_OK, audio_mixer_new(&config));
+    sink_reset();
+}
+
+static void write_dc(audio_mixer_source_handle_t src, int16_t value, uint32_t channels, uint32_t frames)
+{
+    int16_t buf[2 * 128];
+    for (size_t k = 0; k < sizeof(buf) / sizeof(buf[0]); k++) {
+        buf[k] = value;
+    }
+    while (frames) {
+        uint32_t n = frames > 128 ? 128 : frames;
+        size_t written = 0;
+        TEST_ASSERT_EQUAL(ESP_OK, audio_mixer_source_write(src, buf, n * channels * sizeof(int16_t), &written, 1000));
+        TEST_ASSERT_EQUAL(n * channels * sizeof(int16_t), written);
+        frames -= n;
+    }
+}
+
+TEST_CASE("audio mixer saturates the sum and ramps gain", "[audio mixer]")
+{
+    audio_mixer_source_handle_t a, b;
+    audio_mixer_source_config_t config = { .name = "a",
+                                           .sample_rate = MIX_RATE,
+                                           .channels = 2,
+                                           .bits_per_sample = 16,
+                                           .gain = AUDIO_MIXER_GAIN_UNITY,
+                                           .low_latency = true,
+                                           .buffer_ms = 200 };
+    mixer_start();
+    TEST_ASSERT_EQUAL(ESP_OK, audio_mixer_source_new(&config, &a));
+    config.name = "b";
+    TEST_ASSERT_EQUAL(ESP_OK, audio_mixer_source_new(&config, &b));
+
+    // 20000 + 20000 does not fit in 16 bits
+    write_dc(a, 20000, 2, MIX_RATE / 10);
+    write_dc(b, 20000, 2, MIX_RATE / 10);
+    vTaskDelay(pdMS_TO_TICKS(200));
+    TEST_ASSERT_EQUAL(INT16_MAX, sink_peak);
+
+    audio_mixer_stats_t stats;
+    TEST_ASSERT_EQUAL(ESP_OK, audio_mixer_get_stats(&stats));
+    ESP_LOGI(TAG, "%u blocks of %u us, mix %u us avg %u us max, %u permille",
+             (unsigned)stats.blocks, (unsigned)stats.block_us, (unsigned)stats.mix_us_avg,
+             (unsigned)stats.mix_us_max, (unsigned)stats.cpu_permille);
+    TEST_ASSERT_EQUAL(2, stats.sources);
+    TEST_ASSERT_GREATER_THAN(0, stats.blocks);
+    TEST_ASSERT_LESS_THAN(1000, stats.cpu_permille);
+
+    // alone and at half gain: the single-source path scales without summing
+    TEST_ASSERT_EQUAL(ESP_OK, audio_mixer_source_delete(b));
+    TEST_ASSERT_EQUAL(ESP_OK, audio_mixer_source_set_gain(a, AUDIO_MIXER_GAIN_UNITY / 2, 0));
+    sink_reset();
+    write_dc(a, 20000, 2, MIX_RATE / 10);
+    vTaskDelay(pdMS_TO_TICKS(200));
+    TEST_ASSERT_INT_WITHIN(1, 10000, sink_peak);
+    TEST_ASSERT_EQUAL(ESP_OK, audio_mixer_get_stats(&stats));
+    TEST_ASSERT_GREATER_THAN(0, stats.single_blocks);
+
+    // a 50 ms ramp to silence fades out instead of cutting the audio
+    TEST_ASSERT_EQUAL(ESP_OK, audio_mixer_source_set_gain(a, AUDIO_MIXER_GAIN_UNITY, 0));
+    sink_reset();
+    write_dc(a, 20000, 2, MIX_RATE / 5);
+    TEST_ASSERT_EQUAL(ESP_OK, audio_mixer_source_set_gain(a, 0, 50));
+    vTaskDelay(pdMS_TO_TICKS(300));
+    TEST_ASSERT_EQUAL(20000, sink_peak);
+    TEST_ASSERT_LESS_THAN(20000 / 10, sink_last);
+    TEST_ASSERT_LESS_THAN(MIX_RATE / 10, sink_loud_frames);
+
+    TEST_ASSERT_EQUAL(ESP_OK, audio_mixer_source_delete(a));
+    TEST_ASSERT_EQUAL(ESP_OK, audio_mixer_delete());
+}
+
+TEST_CASE("audio mixer resamples sources to the output rate", "[audio mixer]")
+{
+    audio_mixer_source_handle_t src;
+    audio_mixer_source_stats_t src_stats;
+    audio_mixer_source_config_t config = { .name = "mono 22k",
+                                           .sample_rate = 22050,
+                                           .channels = 1,
+                                           .bits_per_sample = 16,
+                                           .gain = 0,
+                                           .low_latency = false,
+                                           .buffer_ms = 0 };
+    mixer_start();
+    TEST_ASSERT_EQUAL(ESP_OK, audio_mixer_source_new(&config, &src));
+
+    // half a second at 22.05 kHz mono is half a second at 44.1 kHz stereo,
+    // plus the filter ringing after the end, the steps at either end overshoot
+    write_dc(src, 1000, 1, 22050 / 2);
+    vTaskDelay(pdMS_TO_TICKS(800));
+    TEST_ASSERT_EQUAL(ESP_OK, audio_mixer_source_get_stats(src, &src_stats));
+    TEST_ASSERT_EQUAL(0, src_stats.fill_bytes);
+    TEST_ASSERT_UINT32_WITHIN(2, 22050 / 2, (uint32_t)src_stats.frames_mixed);
+    TEST_ASSERT_UINT32_WITHIN(40, MIX_RATE / 2 + 40, sink_loud_frames);
+    TEST_ASSERT_INT_WITHIN(150, 1000, sink_peak);
+
+    // a rate change waits for the old audio, 48 kHz stereo then plays at 44.1 kHz
+    sink_reset();
+    TEST_ASSERT_EQUAL(ESP_OK, audio_mixer_source_set_format(src, 48000, 16, 2));
+    write_dc(src, 1000, 2, 48000 / 2);
+    vTaskDelay(pdMS_TO_TICKS(800));
+    TEST_ASSERT_UINT32_WITHIN(40, MIX_RATE / 2 + 40, sink_loud_frames);
+    TEST_ASSERT_EQUAL(ESP_OK, audio_mixer_source_get_stats(src, &src_stats));
+    ESP_LOGI(TAG, "latency %u ms, %u underruns", (unsigned)src_stats.latency_ms, (unsigned)src_stats.underruns);
+
+    TEST_ASSERT_EQUAL(ESP_ERR_INVALID_ARG, audio_mixer_source_set_format(src, 48000, 12, 2));
+    TEST_ASSERT_EQUAL(ESP_ERR_INVALID_STATE, audio_mixer_delete());
+
+    TEST_ASSERT_EQUAL(ESP_OK, audio_mixer_source_delete(src));
+    TEST_ASSERT_EQUAL(ESP_OK, audio_mixer_delete());
+}
+
+/*
+ * Output lending pieces shorter than a block, the way esp_codec_dev lends a
+ * DMA buffer, committed into the real-time sink
+ */
+#define LEND_FRAMES     100
+
+static int16_t lend_buf[2 * LEND_FRAMES];
+static uint32_t lend_commits;
+
+static esp_err_t lend_acquire(void **buffer, size_t *len, uint32_t timeout_ms)
+{
+    *buffer = lend_buf;
+    *len = sizeof(lend_buf);
+    return ESP_OK;
+}
+
+static esp_err_t lend_commit(size_t len)
+{
+    size_t written = 0;
+    lend_commits++;
+    return sink_write(lend_buf, len, &written, 0);
+}
+
+TEST_CASE("audio mixer mixes into lent output buffers", "[audio mixer]")
+{
+    audio_mixer_source_handle_t src;
+    audio_mixer_source_config_t src_config = { .name = "lent",
+                                               .sample_rate = MIX_RATE,
+                                               .channels = 2,
+                                               .bits_per_sample = 16,
+                                               .gain = AUDIO_MIXER_GAIN_UNITY,
+                                               .low_latency = true,
+                                               .buffer_ms = 200 };
+    audio_mixer_config_t config = { .clk_set_fn = sink_clk,
+                                    .acquire_fn = lend_acquire,
+                                    .commit_fn = lend_commit,
+                                    .sample_rate = MIX_RATE,
+                                    .block_frames = MIX_BLOCK,
+                                    .priority = 6,
+                                    .coreID = 0 };
+    TEST_ASSERT_EQUAL(ESP_OK, audio_mixer_new(&config));
+    sink_reset();
+    lend_commits = 0;
+    TEST_ASSERT_EQUAL(ESP_OK, audio_mixer_source_new(&src_config, &src));
+
+    write_dc(src, 1000, 2, MIX_RATE / 10);
+    vTaskDelay(pdMS_TO_TICKS(200));
+    TEST_ASSERT_EQUAL(1000, sink_peak);
+    TEST_ASSERT_UINT32_WITHIN(LEND_FRAMES, MIX_RATE / 10, sink_loud_frames);
+    TEST_ASSERT_GREATER_THAN(MIX_RATE / 10 / LEND_FRAMES, lend_commits);
+
+    TEST_ASSERT_EQUAL(ESP_OK, audio_mixer_source_delete(src));
+    TEST_ASSERT_EQUAL(ESP_OK, audio_mixer_delete());
+
+    // lending needs both halves
+    config.commit_fn = NULL;
+    TEST_ASSERT_EQUAL(ESP_ERR_INVALID_ARG, audio_mixer_new(&config));
+}
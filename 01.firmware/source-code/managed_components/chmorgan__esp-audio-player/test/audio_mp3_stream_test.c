@@ -0,0 +1,91 @@
+// Copyright 2020 Espressif Systems (Shanghai) Co. Ltd.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "esp_log.h"
+#include "unity.h"
+#include "audio_mp3_stream.h"
+
+static const char *TAG = "AUDIO MP3 STREAM TEST";
+
+/*
+ * Sums the output so that two decodes of the same stream can be compared
+ * without keeping the PCM.
+ */
+typedef struct {
+    size_t samples;
+    uint32_t hash;
+    uint32_t sample_rate;
+    uint8_t channels;
+} pcm_sum_t;
+
+static void pcm_sum(const int16_t *pcm, size_t frames, uint32_t sample_rate, uint8_t channels, void *arg)
+{
+    pcm_sum_t *sum = (pcm_sum_t *)arg;
+    for (size_t k = 0; k < frames * channels; k++) {
+        sum->hash = (sum->hash ^ (uint16_t)pcm[k]) * 16777619;
+    }
+    sum->samples += frames * channels;
+    sum->sample_rate = sample_rate;
+    sum->channels = channels;
+}
+
+TEST_CASE("mp3 stream decodes frames split across pieces as a whole", "[audio mp3 stream]")
+{
+    extern const char mp3_start[] asm("_binary_gs_16b_1c_44100hz_mp3_start");
+    extern const char mp3_end[]   asm("_binary_gs_16b_1c_44100hz_mp3_end");
+    // cppcheck-suppress comparePointers
+    size_t mp3_size = (mp3_end - mp3_start) - 1;
+    const uint8_t *mp3 = (const uint8_t *)mp3_start;
+
+    audio_mp3_stream_t *s = audio_mp3_stream_new();
+    TEST_ASSERT_NOT_NULL(s);
+
+    pcm_sum_t whole = { .hash = 2166136261 };
+    size_t frames = audio_mp3_stream_feed(s, mp3, mp3_size, pcm_sum, &whole);
+    TEST_ASSERT_GREATER_THAN(0, frames);
+    TEST_ASSERT_EQUAL(frames * whole.channels, whole.samples);
+    TEST_ASSERT_EQUAL(44100, whole.sample_rate);
+    TEST_ASSERT_EQUAL(1, whole.channels);
+
+    // pieces of odd sizes, as AVI audio chunks cut an mp3 stream
+    audio_mp3_stream_reset(s);
+    pcm_sum_t pieces = { .hash = 2166136261 };
+    srand(1);
+    for (size_t off = 0; off < mp3_size;) {
+        size_t n = 1 + rand() % 900;
+        if (n > mp3_size - off) {
+            n = mp3_size - off;
+        }
+        audio_mp3_stream_feed(s, mp3 + off, n, pcm_sum, &pieces);
+        off += n;
+    }
+    audio_mp3_stream_stats_t stats;
+    audio_mp3_stream_get_stats(s, &stats);
+    ESP_LOGI(TAG, "%u mp3 frames, %u split, %u errors, %u bytes skipped", (unsigned)stats.frames,
+             (unsigned)stats.split, (unsigned)stats.errors, (unsigned)stats.skipped);
+    TEST_ASSERT_GREATER_THAN(0, stats.split);
+    TEST_ASSERT_EQUAL(whole.samples, pieces.samples);
+    TEST_ASSERT_EQUAL_HEX32(whole.hash, pieces.hash);
+
+    // entering in the middle of a frame finds the next one
+    audio_mp3_stream_reset(s);
+    pcm_sum_t middle = { .hash = 2166136261 };
+    audio_mp3_stream_feed(s, mp3 + mp3_size / 2 + 7, mp3_size / 4, pcm_sum, &middle);
+    TEST_ASSERT_GREATER_THAN(0, middle.samples);
+
+    audio_mp3_stream_delete(s);
+}
@@ -12,6 +12,9 @@
 // See the License for the specific language governing permissions and
 // limitations under the License.
 
+#define _GNU_SOURCE     // fopencookie()
+#include <stdio.h>
+#include <string.h>
 #include "esp_log.h"
 #include "esp_check.h"
 #include "unity.h"
@@ -148,6 +151,287 @@ static esp_err_t bsp_audio_init(const i2s_std_config_t *i2s_config, i2s_chan_han
     return ESP_OK;
 }
 
+/*
+ * Simulated source and sink for the decode-ahead ring, no i2s hardware needed.
+ *
+ * The sink consumes PCM at the real-time rate of the configured format, the
+ * source serves the embedded mp3 in small reads and stalls every
+ * slow_src_stall_every reads for slow_src_stall_ms, like an SD card doing
+ * housekeeping.
+ */
+typedef struct {
+    const char *data;
+    size_t size;
+    size_t pos;
+    int reads;
+} slow_src_t;
+
+static int slow_src_stall_every;
+static int slow_src_stall_ms;
+static uint32_t sim_sink_bytes_per_ms;
+
+static ssize_t slow_src_read(void *cookie, char *buf, size_t size)
+{
+    slow_src_t *src = (slow_src_t *)cookie;
+    if (slow_src_stall_every && (++src->reads % slow_src_stall_every) == 0) {
+        vTaskDelay(pdMS_TO_TICKS(slow_src_stall_ms));
+    }
+    size_t n = src->size - src->pos;
+    if (n > size) {
+        n = size;
+    }
+    memcpy(buf, src->data + src->pos, n);
+    src->pos += n;
+    return n;
+}
+
+static int slow_src_seek(void *cookie, off_t *offset, int whence)
+{
+    slow_src_t *src = (slow_src_t *)cookie;
+    off_t base = (whence == SEEK_SET) ? 0 : (whence == SEEK_CUR) ? (off_t)src->pos : (off_t)src->size;
+    if (base + *offset < 0 || base + *offset > (off_t)src->size) {
+        return -1;
+    }
+    src->pos = base + *offset;
+    *offset = src->pos;
+    return 0;
+}
+
+static FILE *slow_src_open(slow_src_t *src, const char *data, size_t size)
+{
+    *src = (slow_src_t) { .data = data, .size = size };
+    cookie_io_functions_t io = { .read = slow_src_read, .seek = slow_src_seek };
+    FILE *fp = fopencookie(src, "rb", io);
+    if (fp) {
+        // small reads so that a stall hits between mp3 frames
+        setvbuf(fp, NULL, _IOFBF, 512);
+    }
+    return fp;
+}
+
+static esp_err_t sim_sink_write(void *audio_buffer, size_t len, size_t *bytes_written, uint32_t timeout_ms)
+{
+    static uint32_t carry;
+    if (sim_sink_bytes_per_ms) {
+        carry += len;
+        uint32_t ms = carry / sim_sink_bytes_per_ms;
+        carry -= ms * sim_sink_bytes_per_ms;
+        vTaskDelay(pdMS_TO_TICKS(ms));
+    }
+    *bytes_written = len;
+    return ESP_OK;
+}
+
+static esp_err_t sim_sink_clk(uint32_t rate, uint32_t bits_cfg, i2s_slot_mode_t ch)
+{
+    // the player always hands stereo to the sink
+    sim_sink_bytes_per_ms = rate * 2 * (bits_cfg / 8) / 1000;
+    return ESP_OK;
+}
+
+static void play_slow_source(int stall_every, int stall_ms, int play_ms, audio_player_stats_t *stats)
+{
+    extern const char mp3_start[] asm("_binary_gs_16b_1c_44100hz_mp3_start");
+    extern const char mp3_end[]   asm("_binary_gs_16b_1c_44100hz_mp3_end");
+    // cppcheck-suppress comparePointers
+    size_t mp3_size = (mp3_end - mp3_start) - 1;
+
+    audio_player_config_t config = { .mute_fn = audio_mute_function,
+                                     .clk_set_fn = sim_sink_clk,
+                                     .write_fn = sim_sink_write,
+                                     .priority = 5,
+                                     .coreID = 0,
+                                     .pcm_ring_ms = 300 };
+    TEST_ASSERT_EQUAL(ESP_OK, audio_player_new(config));
+
+    slow_src_stall_every = stall_every;
+    slow_src_stall_ms = stall_ms;
+
+    slow_src_t src;
+    FILE *fp = slow_src_open(&src, mp3_start, mp3_size);
+    TEST_ASSERT_NOT_NULL(fp);
+    TEST_ASSERT_EQUAL(ESP_OK, audio_player_play(fp));
+
+    vTaskDelay(pdMS_TO_TICKS(play_ms));
+    TEST_ASSERT_EQUAL(ESP_OK, audio_player_get_stats(stats));
+    ESP_LOGI(TAG, "stall %d ms every %d reads: underruns %u, fill %u/%u bytes (%u ms), min fill %u",
+             stall_ms, stall_every, (unsigned)stats->underruns, (unsigned)stats->fill_bytes,
+             (unsigned)stats->ring_size, (unsigned)stats->fill_ms, (unsigned)stats->fill_min_bytes);
+
+    // let the decoder come out of a stall before tearing the player down
+    TEST_ASSERT_EQUAL(ESP_OK, audio_player_stop());
+    vTaskDelay(pdMS_TO_TICKS(stall_ms + 100));
+    TEST_ASSERT_EQUAL(ESP_OK, audio_player_delete());
+    sim_sink_bytes_per_ms = 0;
+}
+
+TEST_CASE("audio player decode-ahead ring absorbs a slow source", "[audio player]")
+{
+    audio_player_stats_t stats;
+
+    // 100 ms stalls fit in the 300 ms ring: the sink never runs dry
+    play_slow_source(16, 100, 3000, &stats);
+    TEST_ASSERT_EQUAL(0, stats.underruns);
+    TEST_ASSERT_GREATER_THAN(0, stats.fill_min_bytes);
+    TEST_ASSERT_GREATER_THAN(0, stats.bytes_written);
+
+    // stalls longer than the ring show up as underruns
+    play_slow_source(16, 500, 3000, &stats);
+    TEST_ASSERT_GREATER_THAN(0, stats.underruns);
+}
+
+/**
+ * The test file carries an Info tag with a LAME extension: 608 frames of 1152
+ * samples, 576 samples encoder delay and no padding. Gapless playback drops the
+ * delay plus the 529 sample decoder delay and plays everything else.
+ */
+#define GS_MP3_GAPLESS_FRAMES   (608 * 1152 - 576 - 529)
+
+static uint32_t count_sink_clk_sets;
+
+static esp_err_t count_sink_write(void *audio_buffer, size_t len, size_t *bytes_written, uint32_t timeout_ms)
+{
+    *bytes_written = len;
+    return ESP_OK;
+}
+
+static esp_err_t count_sink_clk(uint32_t rate, uint32_t bits_cfg, i2s_slot_mode_t ch)
+{
+    count_sink_clk_sets++;
+    return ESP_OK;
+}
+
+static int gapless_files_left;
+static QueueHandle_t gapless_events;
+
+static FILE *gapless_next(void *user_ctx)
+{
+    extern const char mp3_start[] asm("_binary_gs_16b_1c_44100hz_mp3_start");
+    extern const char mp3_end[]   asm("_binary_gs_16b_1c_44100hz_mp3_end");
+    // cppcheck-suppress comparePointers
+    size_t mp3_size = (mp3_end - mp3_start) - 1;
+
+    if (gapless_files_left == 0) {
+        return NULL;
+    }
+    gapless_files_left--;
+    return fmemopen((void*)mp3_start, mp3_size, "rb");
+}
+
+static void gapless_callback(audio_player_cb_ctx_t *ctx)
+{
+    xQueueSend(gapless_events, &ctx->audio_event, 0);
+}
+
+TEST_CASE("audio player plays queued files back to back without a gap", "[audio player]")
+{
+    audio_player_callback_event_t event;
+    audio_player_stats_t stats;
+
+    audio_player_config_t config = { .mute_fn = audio_mute_function,
+                                     .clk_set_fn = count_sink_clk,
+                                     .write_fn = count_sink_write,
+                                     .priority = 5,
+                                     .coreID = 0 };
+    TEST_ASSERT_EQUAL(ESP_OK, audio_player_new(config));
+
+    gapless_events = xQueueCreate(8, sizeof(audio_player_callback_event_t));
+    TEST_ASSERT_NOT_NULL(gapless_events);
+    TEST_ASSERT_EQUAL(ESP_OK, audio_player_callback_register(gapless_callback, NULL));
+    TEST_ASSERT_EQUAL(ESP_OK, audio_player_next_register(gapless_next, NULL));
+
+    count_sink_clk_sets = 0;
+    gapless_files_left = 2;
+    FILE *fp = gapless_next(NULL);
+    TEST_ASSERT_NOT_NULL(fp);
+    TEST_ASSERT_EQUAL(ESP_OK, audio_player_play(fp));
+
+    // the sink does not pace the writer, three files decode in a few seconds
+    const audio_player_callback_event_t expected[] = {
+        AUDIO_PLAYER_CALLBACK_EVENT_PLAYING,
+        AUDIO_PLAYER_CALLBACK_EVENT_COMPLETED_PLAYING_NEXT,
+        AUDIO_PLAYER_CALLBACK_EVENT_COMPLETED_PLAYING_NEXT,
+        AUDIO_PLAYER_CALLBACK_EVENT_IDLE,
+    };
+    for (size_t n = 0; n < sizeof(expected) / sizeof(expected[0]); n++) {
+        TEST_ASSERT_EQUAL(pdPASS, xQueueReceive(gapless_events, &event, pdMS_TO_TICKS(20000)));
+        TEST_ASSERT_EQUAL(expected[n], event);
+    }
+
+    // every sample of the three files, nothing more: delay and tag frame dropped,
+    // and the clock is only set up once since the format does not change
+    TEST_ASSERT_EQUAL(ESP_OK, audio_player_get_stats(&stats));
+    TEST_ASSERT_EQUAL_UINT64(3ULL * GS_MP3_GAPLESS_FRAMES * 2 * sizeof(int16_t), stats.bytes_written);
+    TEST_ASSERT_EQUAL(1, count_sink_clk_sets);
+    TEST_ASSERT_EQUAL(0, gapless_files_left);
+
+    TEST_ASSERT_EQUAL(ESP_OK, audio_player_delete());
+    vQueueDelete(gapless_events);
+}
+
+/** GS_MP3_GAPLESS_FRAMES at 44.1 kHz */
+#define GS_MP3_DURATION_MS      15857
+
+TEST_CASE("audio player seeks and reports position and duration", "[audio player]")
+{
+    audio_player_callback_event_t event;
+    uint32_t duration_ms, position_ms;
+
+    extern const char mp3_start[] asm("_binary_gs_16b_1c_44100hz_mp3_start");
+    extern const char mp3_end[]   asm("_binary_gs_16b_1c_44100hz_mp3_end");
+    // cppcheck-suppress comparePointers
+    size_t mp3_size = (mp3_end - mp3_start) - 1;
+
+    // the sim sink plays in real time, so the position moves with the clock
+    audio_player_config_t config = { .mute_fn = audio_mute_function,
+                                     .clk_set_fn = sim_sink_clk,
+                                     .write_fn = sim_sink_write,
+                                     .priority = 5,
+                                     .coreID = 0 };
+    TEST_ASSERT_EQUAL(ESP_OK, audio_player_new(config));
+
+    gapless_events = xQueueCreate(8, sizeof(audio_player_callback_event_t));
+    TEST_ASSERT_NOT_NULL(gapless_events);
+    TEST_ASSERT_EQUAL(ESP_OK, audio_player_callback_register(gapless_callback, NULL));
+
+    TEST_ASSERT_EQUAL(ESP_ERR_INVALID_STATE, audio_player_seek(1000));
+
+    FILE *fp = fmemopen((void*)mp3_start, mp3_size, "rb");
+    TEST_ASSERT_NOT_NULL(fp);
+    TEST_ASSERT_EQUAL(ESP_OK, audio_player_play(fp));
+    TEST_ASSERT_EQUAL(pdPASS, xQueueReceive(gapless_events, &event, pdMS_TO_TICKS(100)));
+    TEST_ASSERT_EQUAL(AUDIO_PLAYER_CALLBACK_EVENT_PLAYING, event);
+
+    // the Info tag gives the exact length
+    vTaskDelay(pdMS_TO_TICKS(500));
+    TEST_ASSERT_EQUAL(ESP_OK, audio_player_get_duration(&duration_ms));
+    TEST_ASSERT_UINT32_WITHIN(1, GS_MP3_DURATION_MS, duration_ms);
+    TEST_ASSERT_EQUAL(ESP_OK, audio_player_get_position(&position_ms));
+    TEST_ASSERT_UINT32_WITHIN(300, 500, position_ms);
+
+    // jump close to the end: the position follows right away and the rest plays out
+    TickType_t seeked = xTaskGetTickCount();
+    TEST_ASSERT_EQUAL(ESP_OK, audio_player_seek(14000));
+    vTaskDelay(pdMS_TO_TICKS(200));
+    TEST_ASSERT_EQUAL(ESP_OK, audio_player_get_position(&position_ms));
+    ESP_LOGI(TAG, "200 ms after seeking to 14000 ms: position %u ms", (unsigned)position_ms);
+    TEST_ASSERT_UINT32_WITHIN(200, 14100, position_ms);
+
+    TEST_ASSERT_EQUAL(pdPASS, xQueueReceive(gapless_events, &event, pdMS_TO_TICKS(4000)));
+    TEST_ASSERT_EQUAL(AUDIO_PLAYER_CALLBACK_EVENT_IDLE, event);
+    uint32_t rest_ms = pdTICKS_TO_MS(xTaskGetTickCount() - seeked);
+    ESP_LOGI(TAG, "played out %u ms after the seek", (unsigned)rest_ms);
+    TEST_ASSERT_UINT32_WITHIN(400, GS_MP3_DURATION_MS - 14000, rest_ms);
+
+    // seeking is refused once the player is idle again
+    TEST_ASSERT_EQUAL(ESP_ERR_INVALID_STATE, audio_player_seek(0));
+    TEST_ASSERT_EQUAL(ESP_ERR_INVALID_STATE, audio_player_get_position(&position_ms));
+
+    TEST_ASSERT_EQUAL(ESP_OK, audio_player_delete());
+    vQueueDelete(gapless_events);
+    sim_sink_bytes_per_ms = 0;
+}
+
 static audio_player_callback_event_t expected_event;
 static QueueHandle_t event_queue;
 
@@ -18,6 +18,7 @@
  */
 
 #include <dirent.h>
+#include <stdlib.h>
 #include <string.h>
 #include "esp_check.h"
 #include "esp_log.h"
@@ -34,6 +35,8 @@ static esp_err_t file_scan(file_iterator_instance_t *i, const char *base_path)
     i->count = 0;
     struct dirent *p_dirent = NULL;
     DIR *p_dir_stream = opendir(base_path);
+    ESP_RETURN_ON_FALSE(NULL != p_dir_stream, ESP_ERR_NOT_FOUND,
+        TAG, "Failed to open %s", base_path);
 
     do {    /* Get total file count */
         p_dirent = readdir(p_dir_stream);
@@ -135,6 +138,19 @@ esp_err_t file_iterator_prev(file_iterator_instance_t *i)
     return ESP_OK;
 }
 
+void file_iterator_delete(file_iterator_instance_t *i)
+{
+    if (NULL == i) {
+        return;
+    }
+    for (size_t file_index = 0; file_index < i->count; file_index++) {
+        free(i->list[file_index]);
+    }
+    free(i->list);
+    free((void *)i->directory_path);
+    free(i);
+}
+
 file_iterator_instance_t* file_iterator_new(const char *base_path)
 {
     file_iterator_instance_t *i = NULL;
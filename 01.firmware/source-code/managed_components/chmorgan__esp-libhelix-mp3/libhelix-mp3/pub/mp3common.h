@@ -51,15 +51,15 @@
 #define NGRANS_MPEG1	2
 #define NGRANS_MPEG2	1
 
+#ifdef HELIX_FEATURE_MPEG25
 /* 11-bit syncword if MPEG 2.5 extensions are enabled */
-/*
 #define	SYNCWORDH		0xff
 #define	SYNCWORDL		0xe0
-*/
-
+#else
 /* 12-bit syncword if MPEG 1,2 only are supported */
 #define	SYNCWORDH		0xff
 #define	SYNCWORDL		0xf0
+#endif
 
 typedef struct _MP3DecInfo {
 	/* pointers to platform-specific data structures */
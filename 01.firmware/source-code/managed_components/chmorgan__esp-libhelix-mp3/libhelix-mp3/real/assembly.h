@@ -356,11 +356,13 @@ static __inline int CLZ(int x)
 
 typedef long long Word64;
 
+/* plain C on purpose: gcc emits a single mulh here (and a mul/mulh pair for MADD64),
+ * but unlike asm volatile it is free to schedule, hoist and CSE them, which matters
+ * on the in-order RV32 cores where a multiply result is not available next cycle
+ */
 static __inline int MULSHIFT32(int x, int y)
 {
-	unsigned int result = 0;
-	asm volatile ("mulh %0, %1, %2" : "=r"(result): "r"(x), "r"(y));
-	return result;
+	return (int)(((Word64)x * y) >> 32);
 }
 
 static __inline int FASTABS(int x) 
@@ -376,32 +378,15 @@ static __inline int FASTABS(int x)
 
 static __inline int CLZ(int x)
 {
-	int numZeros;
-
 	if (!x)
 		return (sizeof(int) * 8);
 
-	numZeros = 0;
-	while (!(x & 0x80000000)) {
-		numZeros++;
-		x <<= 1;
-	} 
-
-	return numZeros;
+	return __builtin_clz(x);
 }
 
-static __inline Word64 MADD64(Word64 sum, int a, int b)
+static __inline Word64 MADD64(Word64 sum, int x, int y)
 {
-	unsigned int result_hi = 0;
-	unsigned int result_lo = 0;
-	asm volatile ("mulh %0, %1, %2" : "=r"(result_hi): "r"(a), "r"(b));
-	asm volatile ("mul  %0, %1, %2" : "=r"(result_lo): "r"(a), "r"(b));
-
-	Word64 result = result_hi;
-	result <<= 32;
-	result += result_lo;
-	result += sum;
-	return result;
+	return (sum + ((Word64)x * y));
 }
 
 static __inline Word64 SHL64(Word64 x, int n)
@@ -475,6 +460,50 @@ static __inline int CLZ(int x)
     return __builtin_clz(x);
 }
 
+#elif defined(__GNUC__)
+
+/* generic 64-bit capable host (x86-64, aarch64 Linux/macOS), used by the testwrap tools */
+typedef long long Word64;
+
+static __inline int MULSHIFT32(int x, int y)
+{
+	return (int)(((Word64)x * y) >> 32);
+}
+
+static __inline int FASTABS(int x)
+{
+	int sign;
+
+	sign = x >> (sizeof(int) * 8 - 1);
+	x ^= sign;
+	x -= sign;
+
+	return x;
+}
+
+static __inline int CLZ(int x)
+{
+	if (!x)
+		return (sizeof(int) * 8);
+
+	return __builtin_clz(x);
+}
+
+static __inline Word64 MADD64(Word64 sum, int x, int y)
+{
+	return (sum + ((Word64)x * y));
+}
+
+static __inline Word64 SHL64(Word64 x, int n)
+{
+	return (x<<n);
+}
+
+static __inline Word64 SAR64(Word64 x, int n)
+{
+	return (x >> n);
+}
+
 #else
 
 #error Unsupported platform in assembly.h
@@ -42,12 +42,15 @@
  *
  * This is the C reference version using __int64
  * Look in the appropriate subdirectories for optimized asm implementations 
- *   (e.g. arm/asmpoly.s)
+ *   (e.g. arm/asmpoly.s, riscv/asmpoly_rv.S)
  **************************************************************************************/
 
 #include "coder.h"
 #include "assembly.h"
 
+/* RV32 builds link riscv/asmpoly_rv.S instead, unless HELIX_C_POLYPHASE is defined */
+#if !(defined(__riscv) && (__riscv_xlen == 32) && !defined(HELIX_C_POLYPHASE))
+
 /* input to Polyphase = Q(DQ_FRACBITS_OUT-2), gain 2 bits in convolution
  *  we also have the implicit bias of 2^15 to add back, so net fraction bits = 
  *    DQ_FRACBITS_OUT - 2 - 2 - 15
@@ -293,3 +296,5 @@ void PolyphaseStereo(short *pcm, int *vbuf, const int *coefBase)
 		pcm += 2;
 	}
 }
+
+#endif	/* !RV32 asm */
@@ -0,0 +1,277 @@
+/* ***** BEGIN LICENSE BLOCK ***** 
+ * Version: RCSL 1.0/RPSL 1.0 
+ *  
+ * Portions Copyright (c) 1995-2002 RealNetworks, Inc. All Rights Reserved. 
+ *      
+ * The contents of this file, and the files included with this file, are 
+ * subject to the current version of the RealNetworks Public Source License 
+ * Version 1.0 (the "RPSL") available at 
+ * http://www.helixcommunity.org/content/rpsl unless you have licensed 
+ * the file under the RealNetworks Community Source License Version 1.0 
+ * (the "RCSL") available at http://www.helixcommunity.org/content/rcsl, 
+ * in which case the RCSL will apply. You may also obtain the license terms 
+ * directly from RealNetworks.  You may not use this file except in 
+ * compliance with the RPSL or, if you have a valid RCSL with RealNetworks 
+ * applicable to this file, the RCSL.  Please see the applicable RPSL or 
+ * RCSL for the rights, obligations and limitations governing use of the 
+ * contents of the file.  
+ *  
+ * This file is part of the Helix DNA Technology. RealNetworks is the 
+ * developer of the Original Code and owns the copyrights in the portions 
+ * it created. 
+ *  
+ * This file, and the files included with this file, is distributed and made 
+ * available on an 'AS IS' basis, WITHOUT WARRANTY OF ANY KIND, EITHER 
+ * EXPRESS OR IMPLIED, AND REALNETWORKS HEREBY DISCLAIMS ALL SUCH WARRANTIES, 
+ * INCLUDING WITHOUT LIMITATION, ANY WARRANTIES OF MERCHANTABILITY, FITNESS 
+ * FOR A PARTICULAR PURPOSE, QUIET ENJOYMENT OR NON-INFRINGEMENT. 
+ * 
+ * Technology Compatibility Kit Test Suite(s) Location: 
+ *    http://www.helixcommunity.org/content/tck 
+ * 
+ * Contributor(s): 
+ *  
+ * ***** END LICENSE BLOCK ***** */ 
+
+
+/**************************************************************************************
+ * Fixed-point MP3 decoder
+ *
+ * bench.c - cycles-per-frame benchmark and bit-exactness check, built from main.c
+ *
+ * usage: mp3bench [-n loops] [-r ref.pcm] [-o out.pcm] infile.mp3
+ *
+ *   -n  decode the file this many times, keep the fastest time per frame
+ *   -r  compare the decoded PCM against a reference (e.g. written by mp3dec, or by
+ *         mp3bench_c = this tool built with -DHELIX_C_POLYPHASE) and fail on any difference
+ *   -o  write the decoded PCM
+ *
+ * the cycle counter is rdcycle on RISC-V, rdtsc on x86 and the monotonic clock (ns)
+ *   elsewhere, so numbers are only comparable between builds on the same machine
+ **************************************************************************************/
+
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <time.h>
+
+#include "mp3dec.h"
+
+#define READBUF_SIZE		(1024*16)	/* feel free to change this, but keep big enough for >= one frame at high bitrates */
+#define MAX_FRAMES			(1 << 16)
+
+#if defined(__riscv)
+static uint64_t ReadCycles(void)
+{
+#if __riscv_xlen == 32
+	uint32_t hi, lo, hi2;
+	do {
+		__asm__ volatile ("rdcycleh %0" : "=r" (hi));
+		__asm__ volatile ("rdcycle %0" : "=r" (lo));
+		__asm__ volatile ("rdcycleh %0" : "=r" (hi2));
+	} while (hi != hi2);
+	return ((uint64_t)hi << 32) | lo;
+#else
+	uint64_t c;
+	__asm__ volatile ("rdcycle %0" : "=r" (c));
+	return c;
+#endif
+}
+#define CYCLE_UNIT	"cycles"
+#elif defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+static uint64_t ReadCycles(void)
+{
+	return __rdtsc();
+}
+#define CYCLE_UNIT	"tsc ticks"
+#else
+static uint64_t ReadCycles(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec * 1000000000ull + ts.tv_nsec;
+}
+#define CYCLE_UNIT	"ns"
+#endif
+
+static int FillReadBuffer(unsigned char *readBuf, unsigned char *readPtr, int bufSize, int bytesLeft, FILE *infile)
+{
+	int nRead;
+
+	/* move last, small chunk from end of buffer to start, then fill with new data */
+	memmove(readBuf, readPtr, bytesLeft);
+	nRead = fread(readBuf + bytesLeft, 1, bufSize - bytesLeft, infile);
+	/* zero-pad to avoid finding false sync word after last frame (from old data in readBuf) */
+	if (nRead < bufSize - bytesLeft)
+		memset(readBuf + bytesLeft + nRead, 0, bufSize - bytesLeft - nRead);
+
+	return nRead;
+}
+
+/* decode the whole file once, frameTime[i] = min(frameTime[i], cycles for frame i) */
+static int DecodeFile(FILE *infile, uint64_t *frameTime, FILE *refFile, FILE *outFile,
+					  MP3FrameInfo *info, long *mismatch)
+{
+	int bytesLeft, nRead, err, offset, eofReached, nFrames;
+	unsigned char readBuf[READBUF_SIZE], *readPtr;
+	short outBuf[MAX_NCHAN * MAX_NGRAN * MAX_NSAMP], refBuf[MAX_NCHAN * MAX_NGRAN * MAX_NSAMP];
+	HMP3Decoder hMP3Decoder;
+	uint64_t t0, t1;
+	long sampleIdx = 0;
+	int i;
+
+	if ( (hMP3Decoder = MP3InitDecoder()) == 0 )
+		return -1;
+
+	rewind(infile);
+	bytesLeft = 0;
+	eofReached = 0;
+	readPtr = readBuf;
+	nFrames = 0;
+	do {
+		if (bytesLeft < 2*MAINBUF_SIZE && !eofReached) {
+			nRead = FillReadBuffer(readBuf, readPtr, READBUF_SIZE, bytesLeft, infile);
+			bytesLeft += nRead;
+			readPtr = readBuf;
+			if (nRead == 0)
+				eofReached = 1;
+		}
+
+		offset = MP3FindSyncWord(readPtr, bytesLeft);
+		if (offset < 0)
+			break;
+		readPtr += offset;
+		bytesLeft -= offset;
+
+		t0 = ReadCycles();
+		err = MP3Decode(hMP3Decoder, &readPtr, &bytesLeft, outBuf, 0);
+		t1 = ReadCycles();
+
+		if (err == ERR_MP3_MAINDATA_UNDERFLOW)
+			continue;
+		if (err)
+			break;
+
+		if (nFrames < MAX_FRAMES && t1 - t0 < frameTime[nFrames])
+			frameTime[nFrames] = t1 - t0;
+		nFrames++;
+
+		MP3GetLastFrameInfo(hMP3Decoder, info);
+		if (outFile)
+			fwrite(outBuf, sizeof(short), info->outputSamps, outFile);
+		if (refFile) {
+			int nRef = (int)fread(refBuf, sizeof(short), info->outputSamps, refFile);
+			for (i = 0; i < info->outputSamps; i++) {
+				if (i >= nRef || refBuf[i] != outBuf[i]) {
+					if (*mismatch < 0)
+						*mismatch = sampleIdx + i;
+				}
+			}
+			sampleIdx += info->outputSamps;
+		}
+	} while (1);
+
+	MP3FreeDecoder(hMP3Decoder);
+	return nFrames;
+}
+
+int main(int argc, char **argv)
+{
+	FILE *infile, *refFile = 0, *outFile = 0;
+	const char *refName = 0, *outName = 0;
+	MP3FrameInfo info;
+	uint64_t *frameTime, total, worst;
+	long mismatch = -1;
+	int loops = 1, nFrames = 0, i, n;
+	double framesPerSec;
+
+	for (i = 1; i < argc - 1; i++) {
+		if (!strcmp(argv[i], "-n"))
+			loops = atoi(argv[++i]);
+		else if (!strcmp(argv[i], "-r"))
+			refName = argv[++i];
+		else if (!strcmp(argv[i], "-o"))
+			outName = argv[++i];
+		else
+			break;
+	}
+	if (i != argc - 1 || loops < 1) {
+		printf("usage: mp3bench [-n loops] [-r ref.pcm] [-o out.pcm] infile.mp3\n");
+		return -1;
+	}
+
+	infile = fopen(argv[argc - 1], "rb");
+	if (!infile) {
+		printf("file open error\n");
+		return -1;
+	}
+	frameTime = malloc(MAX_FRAMES * sizeof(uint64_t));
+	if (!frameTime)
+		return -2;
+	memset(frameTime, 0xff, MAX_FRAMES * sizeof(uint64_t));
+	memset(&info, 0, sizeof(info));
+
+	for (n = 0; n < loops; n++) {
+		/* PCM is identical on every pass, only check / write it once */
+		if (n == 0 && refName && !(refFile = fopen(refName, "rb"))) {
+			printf("file open error\n");
+			return -1;
+		}
+		if (n == 0 && outName && !(outFile = fopen(outName, "wb"))) {
+			printf("file open error\n");
+			return -1;
+		}
+		nFrames = DecodeFile(infile, frameTime, refFile, outFile, &info, &mismatch);
+		if (nFrames < 0)
+			return -2;
+		if (refFile) {
+			/* reference longer than our output is a mismatch as well */
+			if (fgetc(refFile) != EOF && mismatch < 0)
+				mismatch = -2;
+			fclose(refFile);
+			refFile = 0;
+		}
+		if (outFile) {
+			fclose(outFile);
+			outFile = 0;
+		}
+	}
+	fclose(infile);
+
+	if (nFrames == 0) {
+		printf("no frames decoded\n");
+		return -1;
+	}
+	if (nFrames > MAX_FRAMES)
+		nFrames = MAX_FRAMES;
+
+	total = worst = 0;
+	for (i = 0; i < nFrames; i++) {
+		total += frameTime[i];
+		if (frameTime[i] > worst)
+			worst = frameTime[i];
+	}
+	framesPerSec = (double)info.samprate * info.nChans / info.outputSamps;
+
+	printf("frames = %d, %d Hz, %d ch, %d kbps\n", nFrames, info.samprate, info.nChans, info.bitrate / 1000);
+	printf("%s/frame: avg %.0f, worst %llu (best of %d)\n", CYCLE_UNIT, (double)total / nFrames,
+		   (unsigned long long)worst, loops);
+	printf("%s/s of audio: %.2f M\n", CYCLE_UNIT, (double)total / nFrames * framesPerSec / 1e6);
+	free(frameTime);
+
+	if (refName) {
+		if (mismatch == -1) {
+			printf("bit-exact with %s\n", refName);
+		} else {
+			if (mismatch == -2)
+				printf("MISMATCH: %s is longer than the decoded output\n", refName);
+			else
+				printf("MISMATCH: first difference at sample %ld\n", mismatch);
+			return 1;
+		}
+	}
+
+	return 0;
+}
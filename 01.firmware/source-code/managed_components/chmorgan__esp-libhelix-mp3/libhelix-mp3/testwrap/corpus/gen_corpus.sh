@@ -0,0 +1,45 @@
+#!/bin/sh
+# Generate the LAME streams for mp3regress (see ../regress.c and manifest_lame.txt).
+# The checked-in corpus (manifest.txt) does not need this, its streams come from ../synth.c.
+#
+# Needs ffmpeg built with libmp3lame. Each stream is encoded from the same synthetic
+# source (a log sweep on the left, amplitude-modulated tones on the right, -6 dBFS) and
+# decoded once more with ffmpeg's floating-point decoder into <name>.pcm, which is the
+# SNR reference. The CRCs would depend on the LAME version, so manifest_lame.txt only
+# checks the SNR.
+
+set -e
+cd "$(dirname "$0")"
+FFMPEG=${FFMPEG:-ffmpeg}
+SECS=${SECS:-10}
+
+# name            rate   ch  encoder options
+STREAMS="
+m1_cbr128_js_44k  44100  2   -b:a 128k
+m1_cbr192_st_44k  44100  2   -b:a 192k -joint_stereo 0
+m1_cbr320_js_48k  48000  2   -b:a 320k
+m1_cbr64_m_32k    32000  1   -b:a 64k
+m1_vbr2_js_44k    44100  2   -q:a 2
+m1_vbr5_m_48k     48000  1   -q:a 5
+m2_cbr64_js_22k   22050  2   -b:a 64k
+m2_cbr32_m_16k    16000  1   -b:a 32k
+m2_vbr4_js_24k    24000  2   -q:a 4
+m25_cbr32_js_11k  11025  2   -b:a 32k
+m25_cbr16_m_8k    8000   1   -b:a 16k
+m25_vbr6_m_12k    12000  1   -q:a 6
+"
+
+echo "$STREAMS" | while read -r name rate ch opts; do
+	[ -n "$name" ] || continue
+	left="0.5*sin(2*PI*40*$SECS/log($rate*0.45/40)*(exp(t/$SECS*log($rate*0.45/40))-1))"
+	right="0.25*(1+0.8*sin(2*PI*3*t))*(sin(2*PI*440*t)+0.5*sin(2*PI*2637*t))"
+	if [ "$ch" = 1 ]; then
+		expr="0.5*($left+$right)"
+	else
+		expr="$left|$right"
+	fi
+	echo "$name"
+	"$FFMPEG" -v error -y -f lavfi -i "aevalsrc=$expr:s=$rate:d=$SECS" -ac "$ch" \
+		-c:a libmp3lame $opts -write_xing 1 -id3v2_version 0 "$name.mp3"
+	"$FFMPEG" -v error -y -c:a mp3float -i "$name.mp3" -c:a pcm_s16le -f s16le "$name.pcm"
+done
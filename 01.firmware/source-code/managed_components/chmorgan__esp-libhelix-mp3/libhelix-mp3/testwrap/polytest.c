@@ -0,0 +1,200 @@
+/* ***** BEGIN LICENSE BLOCK ***** 
+ * Version: RCSL 1.0/RPSL 1.0 
+ *  
+ * Portions Copyright (c) 1995-2002 RealNetworks, Inc. All Rights Reserved. 
+ *      
+ * The contents of this file, and the files included with this file, are 
+ * subject to the current version of the RealNetworks Public Source License 
+ * Version 1.0 (the "RPSL") available at 
+ * http://www.helixcommunity.org/content/rpsl unless you have licensed 
+ * the file under the RealNetworks Community Source License Version 1.0 
+ * (the "RCSL") available at http://www.helixcommunity.org/content/rcsl, 
+ * in which case the RCSL will apply. You may also obtain the license terms 
+ * directly from RealNetworks.  You may not use this file except in 
+ * compliance with the RPSL or, if you have a valid RCSL with RealNetworks 
+ * applicable to this file, the RCSL.  Please see the applicable RPSL or 
+ * RCSL for the rights, obligations and limitations governing use of the 
+ * contents of the file.  
+ *  
+ * This file is part of the Helix DNA Technology. RealNetworks is the 
+ * developer of the Original Code and owns the copyrights in the portions 
+ * it created. 
+ *  
+ * This file, and the files included with this file, is distributed and made 
+ * available on an 'AS IS' basis, WITHOUT WARRANTY OF ANY KIND, EITHER 
+ * EXPRESS OR IMPLIED, AND REALNETWORKS HEREBY DISCLAIMS ALL SUCH WARRANTIES, 
+ * INCLUDING WITHOUT LIMITATION, ANY WARRANTIES OF MERCHANTABILITY, FITNESS 
+ * FOR A PARTICULAR PURPOSE, QUIET ENJOYMENT OR NON-INFRINGEMENT. 
+ * 
+ * Technology Compatibility Kit Test Suite(s) Location: 
+ *    http://www.helixcommunity.org/content/tck 
+ * 
+ * Contributor(s): 
+ *  
+ * ***** END LICENSE BLOCK ***** */ 
+
+
+
+/**************************************************************************************
+ * Fixed-point MP3 decoder
+ *
+ * polytest.c - bit-exactness check of the polyphase filter linked into the decoder
+ *   (real/riscv/asmpoly_rv.S on RV32) against the C reference in real/polyphase.c
+ *
+ * usage: mp3polytest [-n blocks] [-s seed]
+ *
+ * PolyphaseMono and PolyphaseStereo run on the same vbuf and coefficients as
+ *   ref_PolyphaseMono / ref_PolyphaseStereo (polyphase.c built into this file with
+ *   HELIX_C_POLYPHASE), every output sample must match. Inputs are the real polyCoef
+ *   table and random tables, with vbuf values in the decoder range, over the full int
+ *   range (exercises the 64-bit carry chains and the output clipping) and at the extremes.
+ *   Exits nonzero on the first mismatch.
+ *
+ * on a host build both sides are the C version, run it with a RV32 cross compiler
+ *   (make check-poly CC=riscv32-linux-gcc RUN=qemu-riscv32) to test the assembly
+ **************************************************************************************/
+
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <stdint.h>
+
+#include "coder.h"
+
+/* linked version, asm on RV32 */
+#if defined(__riscv) && (__riscv_xlen == 32) && !defined(HELIX_C_POLYPHASE)
+#define LINKED_POLYPHASE	"asmpoly_rv.S"
+#else
+#define LINKED_POLYPHASE	"C polyphase"
+#endif
+static void (*const polyMono)(short *, int *, const int *) = PolyphaseMono;
+static void (*const polyStereo)(short *, int *, const int *) = PolyphaseStereo;
+
+/* C reference, the same source under other names */
+#undef PolyphaseMono
+#undef PolyphaseStereo
+#define PolyphaseMono		ref_PolyphaseMono
+#define PolyphaseStereo		ref_PolyphaseStereo
+#ifndef HELIX_C_POLYPHASE
+#define HELIX_C_POLYPHASE
+#endif
+#include "polyphase.c"
+
+#define VBUF_INTS	(2 * VBUF_LENGTH)		/* both halves of the double-sized FIFO */
+#define NCOEF		264
+
+enum { FILL_DECODER, FILL_FULL, FILL_EXTREME, FILL_MODES };
+static const char *fillName[FILL_MODES] = { "decoder", "full", "extreme" };
+
+static uint32_t rngState;
+
+static uint32_t Rand32(void)
+{
+	/* xorshift32 */
+	rngState ^= rngState << 13;
+	rngState ^= rngState >> 17;
+	rngState ^= rngState << 5;
+	return rngState;
+}
+
+static int RandValue(int mode)
+{
+	switch (mode) {
+	case FILL_DECODER:
+		/* Q(DQ_FRACBITS_OUT-2) with a few guard bits, like FDCT32 output */
+		return (int)Rand32() >> 6;
+	case FILL_FULL:
+		return (int)Rand32();
+	default:
+		switch (Rand32() & 3) {
+		case 0:		return INT32_MAX;
+		case 1:		return INT32_MIN;
+		case 2:		return -1;
+		default:	return 0;
+		}
+	}
+}
+
+static int Compare(const char *name, const short *pcm, const short *ref, int n, long block, int mode, int realCoef)
+{
+	int i;
+
+	for (i = 0; i < n; i++) {
+		if (pcm[i] != ref[i]) {
+			printf("FAIL %s block %ld vbuf %s coef %s: pcm[%d] = %d, C reference %d\n",
+				name, block, fillName[mode], realCoef ? "polyCoef" : "random", i, pcm[i], ref[i]);
+			return -1;
+		}
+	}
+	return 0;
+}
+
+int main(int argc, char **argv)
+{
+	static int vbuf[VBUF_INTS], vbufRef[VBUF_INTS];
+	static int coef[NCOEF];
+	short pcm[2 * NBANDS], ref[2 * NBANDS];
+	long blocks = 20000, b;
+	int i, mode, realCoef, vindex, half;
+	int *vb, *vbRef;
+	const int *c;
+
+	rngState = 0x2545f491;
+	for (i = 1; i < argc - 1; i++) {
+		if (!strcmp(argv[i], "-n"))
+			blocks = atol(argv[++i]);
+		else if (!strcmp(argv[i], "-s"))
+			rngState = (uint32_t)strtoul(argv[++i], 0, 0);
+		else
+			break;
+	}
+	if (i != argc || blocks < 1 || rngState == 0) {
+		printf("usage: mp3polytest [-n blocks] [-s seed]\n");
+		return -1;
+	}
+
+	for (b = 0; b < blocks; b++) {
+		mode = (int)(b % FILL_MODES);
+		realCoef = (int)((b / FILL_MODES) & 1);
+		vindex = (int)(b & 7);
+		half = (int)((b >> 3) & 1);
+
+		for (i = 0; i < VBUF_INTS; i++)
+			vbuf[i] = RandValue(mode);
+		memcpy(vbufRef, vbuf, sizeof(vbuf));
+		if (realCoef) {
+			c = polyCoef;
+		} else {
+			for (i = 0; i < NCOEF; i++)
+				coef[i] = RandValue(mode == FILL_DECODER ? FILL_FULL : mode);
+			c = coef;
+		}
+		/* same offsets as Subband() */
+		vb = vbuf + vindex + VBUF_LENGTH * half;
+		vbRef = vbufRef + (vb - vbuf);
+
+		/* guard value past the output catches writes beyond 32 / 64 samples */
+		memset(pcm, 0x5a, sizeof(pcm));
+		memset(ref, 0x5a, sizeof(ref));
+		polyMono(pcm, vb, c);
+		ref_PolyphaseMono(ref, vbRef, c);
+		if (Compare("PolyphaseMono", pcm, ref, 2 * NBANDS, b, mode, realCoef))
+			return -1;
+
+		memset(pcm, 0x5a, sizeof(pcm));
+		memset(ref, 0x5a, sizeof(ref));
+		polyStereo(pcm, vb, c);
+		ref_PolyphaseStereo(ref, vbRef, c);
+		if (Compare("PolyphaseStereo", pcm, ref, 2 * NBANDS, b, mode, realCoef))
+			return -1;
+
+		/* the filters only read vbuf */
+		if (memcmp(vbuf, vbufRef, sizeof(vbuf))) {
+			printf("FAIL block %ld: vbuf modified\n", b);
+			return -1;
+		}
+	}
+
+	printf("%s bit-exact with polyphase.c: %ld blocks, mono + stereo\n", LINKED_POLYPHASE, blocks);
+	return 0;
+}
@@ -0,0 +1,412 @@
+/* ***** BEGIN LICENSE BLOCK ***** 
+ * Version: RCSL 1.0/RPSL 1.0 
+ *  
+ * Portions Copyright (c) 1995-2002 RealNetworks, Inc. All Rights Reserved. 
+ *      
+ * The contents of this file, and the files included with this file, are 
+ * subject to the current version of the RealNetworks Public Source License 
+ * Version 1.0 (the "RPSL") available at 
+ * http://www.helixcommunity.org/content/rpsl unless you have licensed 
+ * the file under the RealNetworks Community Source License Version 1.0 
+ * (the "RCSL") available at http://www.helixcommunity.org/content/rcsl, 
+ * in which case the RCSL will apply. You may also obtain the license terms 
+ * directly from RealNetworks.  You may not use this file except in 
+ * compliance with the RPSL or, if you have a valid RCSL with RealNetworks 
+ * applicable to this file, the RCSL.  Please see the applicable RPSL or 
+ * RCSL for the rights, obligations and limitations governing use of the 
+ * contents of the file.  
+ *  
+ * This file is part of the Helix DNA Technology. RealNetworks is the 
+ * developer of the Original Code and owns the copyrights in the portions 
+ * it created. 
+ *  
+ * This file, and the files included with this file, is distributed and made 
+ * available on an 'AS IS' basis, WITHOUT WARRANTY OF ANY KIND, EITHER 
+ * EXPRESS OR IMPLIED, AND REALNETWORKS HEREBY DISCLAIMS ALL SUCH WARRANTIES, 
+ * INCLUDING WITHOUT LIMITATION, ANY WARRANTIES OF MERCHANTABILITY, FITNESS 
+ * FOR A PARTICULAR PURPOSE, QUIET ENJOYMENT OR NON-INFRINGEMENT. 
+ * 
+ * Technology Compatibility Kit Test Suite(s) Location: 
+ *    http://www.helixcommunity.org/content/tck 
+ * 
+ * Contributor(s): 
+ *  
+ * ***** END LICENSE BLOCK ***** */ 
+
+
+/**************************************************************************************
+ * Fixed-point MP3 decoder
+ *
+ * regress.c - corpus regression and throughput test
+ *
+ * usage: mp3regress [-b] [-k] [-n loops] manifest.txt
+ *
+ * each manifest line is   stream.mp3  crc32|-  min_snr_db|-
+ *   paths are relative to the manifest, '#' starts a comment
+ *
+ * every stream is decoded from memory (best of n loops) and reported with frames/s and
+ *   the speed relative to real time. the PCM must match the stored CRC32 exactly; if
+ *   stream.pcm exists next to the stream (16-bit PCM from a floating-point decoder, see
+ *   corpus/gen_corpus.sh) the SNR against it must also reach min_snr_db. the offset
+ *   between the two decodes (encoder delay, Xing frame, gapless trimming) is found by
+ *   searching for the smallest squared error.
+ *
+ * every stream needs a reference: a CRC32, or a min_snr_db with its .pcm present. a stream
+ *   without one fails, and so does a missing stream unless -k (keep going) is given, which
+ *   skips streams that are not there (e.g. the encoder streams of gen_corpus.sh).
+ * -b (bless) prints the manifest back to stdout with the CRCs of this build filled in.
+ * any failure makes the exit code non-zero.
+ **************************************************************************************/
+
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <math.h>
+#include <time.h>
+
+#include "mp3dec.h"
+
+#define MAX_LINE		512
+#define MAX_LAG			4096		/* covers LAME delay + Xing frame + decoder delay */
+#define LAG_WINDOW		16384		/* reference samples (per channel) used to find the lag */
+
+typedef struct _StreamResult {
+	MP3FrameInfo info;
+	int nFrames;
+	int nErrors;
+	int nChans;
+	int samprate;
+	long nSamps;					/* total output samples, all channels */
+	long bitrateSum;
+	unsigned int crc;
+	double secs;					/* best decode time */
+} StreamResult;
+
+static unsigned int crcTab[256];
+
+static void InitCRC(void)
+{
+	unsigned int c;
+	int i, j;
+
+	for (i = 0; i < 256; i++) {
+		c = i;
+		for (j = 0; j < 8; j++)
+			c = (c & 1) ? 0xedb88320 ^ (c >> 1) : c >> 1;
+		crcTab[i] = c;
+	}
+}
+
+static unsigned int UpdateCRC(unsigned int crc, const short *pcm, int nSamps)
+{
+	int i;
+
+	/* hash as little-endian bytes so the result does not depend on the host */
+	for (i = 0; i < nSamps; i++) {
+		crc = crcTab[(crc ^ pcm[i]) & 0xff] ^ (crc >> 8);
+		crc = crcTab[(crc ^ (pcm[i] >> 8)) & 0xff] ^ (crc >> 8);
+	}
+	return crc;
+}
+
+static double Now(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static unsigned char *LoadFile(const char *name, long *len)
+{
+	FILE *f;
+	unsigned char *buf;
+
+	if (!(f = fopen(name, "rb")))
+		return 0;
+	fseek(f, 0, SEEK_END);
+	*len = ftell(f);
+	fseek(f, 0, SEEK_SET);
+	buf = malloc(*len > 0 ? *len : 1);
+	if (buf && (long)fread(buf, 1, *len, f) != *len) {
+		free(buf);
+		buf = 0;
+	}
+	fclose(f);
+	return buf;
+}
+
+/* skip an ID3v2 tag, so a sync word inside it is not mistaken for a frame */
+static long SkipID3v2(const unsigned char *buf, long len)
+{
+	long size;
+
+	if (len < 10 || buf[0] != 'I' || buf[1] != 'D' || buf[2] != '3')
+		return 0;
+	size = ((long)(buf[6] & 0x7f) << 21) | ((buf[7] & 0x7f) << 14) | ((buf[8] & 0x7f) << 7) | (buf[9] & 0x7f);
+	size += (buf[5] & 0x10) ? 20 : 10;
+	return size < len ? size : len;
+}
+
+/* decode a whole stream from memory, optionally keeping the PCM */
+static int DecodeStream(unsigned char *mp3, long mp3Len, StreamResult *res, short **pcmOut)
+{
+	HMP3Decoder hMP3Decoder;
+	unsigned char *readPtr;
+	short outBuf[MAX_NCHAN * MAX_NGRAN * MAX_NSAMP];
+	short *pcm = 0;
+	long pcmCap = 0;
+	int bytesLeft, offset, err;
+	double t0;
+
+	if ( (hMP3Decoder = MP3InitDecoder()) == 0 )
+		return -1;
+
+	memset(res, 0, sizeof(StreamResult));
+	res->crc = 0xffffffff;
+	readPtr = mp3 + SkipID3v2(mp3, mp3Len);
+	bytesLeft = (int)(mp3 + mp3Len - readPtr);
+
+	t0 = Now();
+	while (bytesLeft > 0) {
+		offset = MP3FindSyncWord(readPtr, bytesLeft);
+		if (offset < 0)
+			break;
+		readPtr += offset;
+		bytesLeft -= offset;
+
+		err = MP3Decode(hMP3Decoder, &readPtr, &bytesLeft, outBuf, 0);
+		if (err == ERR_MP3_INDATA_UNDERFLOW)
+			break;
+		if (err == ERR_MP3_MAINDATA_UNDERFLOW)
+			continue;
+		if (err) {
+			/* false sync or damaged frame: step past it and resync */
+			res->nErrors++;
+			readPtr++;
+			bytesLeft--;
+			continue;
+		}
+
+		MP3GetLastFrameInfo(hMP3Decoder, &res->info);
+		if (res->nFrames == 0) {
+			res->nChans = res->info.nChans;
+			res->samprate = res->info.samprate;
+		}
+		res->nFrames++;
+		res->bitrateSum += res->info.bitrate;
+		res->crc = UpdateCRC(res->crc, outBuf, res->info.outputSamps);
+		if (pcmOut) {
+			if (res->nSamps + res->info.outputSamps > pcmCap) {
+				pcmCap = 2 * pcmCap + MAX_NCHAN * MAX_NGRAN * MAX_NSAMP;
+				pcm = realloc(pcm, pcmCap * sizeof(short));
+				if (!pcm)
+					return -2;
+			}
+			memcpy(pcm + res->nSamps, outBuf, res->info.outputSamps * sizeof(short));
+		}
+		res->nSamps += res->info.outputSamps;
+	}
+	res->secs = Now() - t0;
+	res->crc ^= 0xffffffff;
+
+	MP3FreeDecoder(hMP3Decoder);
+	if (pcmOut)
+		*pcmOut = pcm;
+	return 0;
+}
+
+/**************************************************************************************
+ * Function:    MeasureSNR
+ *
+ * Description: SNR of the decoded PCM against a reference decode of the same stream
+ *
+ * Inputs:      interleaved PCM and reference (same channel count), lengths in samples
+ *
+ * Outputs:     lag (in sample frames) at which pcm[n + lag] lines up with ref[n]
+ *
+ * Return:      SNR in dB, 999 if identical over the overlap, -1 if too short to align
+ **************************************************************************************/
+static double MeasureSNR(const short *pcm, long nPcm, const short *ref, long nRef, int nChans, int *lagOut)
+{
+	long nA = nPcm / nChans, nR = nRef / nChans, n, start, end;
+	int lag, bestLag = 0, ch;
+	double err, bestErr = -1, d, sig, noise;
+
+	if (nR < 2 * LAG_WINDOW)
+		return -1;
+
+	/* search a window away from the start so the leading silence does not dominate */
+	start = nR / 4;
+	end = start + LAG_WINDOW;
+	for (lag = -MAX_LAG; lag <= MAX_LAG; lag++) {
+		if (start + lag < 0 || end + lag > nA)
+			continue;
+		err = 0;
+		for (n = start; n < end && (bestErr < 0 || err < bestErr); n++) {
+			d = (double)pcm[(n + lag) * nChans] - ref[n * nChans];
+			err += d * d;
+		}
+		if (bestErr < 0 || err < bestErr) {
+			bestErr = err;
+			bestLag = lag;
+		}
+	}
+	if (bestErr < 0)
+		return -1;
+
+	sig = noise = 0;
+	for (n = 0; n < nR; n++) {
+		if (n + bestLag < 0 || n + bestLag >= nA)
+			continue;
+		for (ch = 0; ch < nChans; ch++) {
+			d = ref[n * nChans + ch];
+			sig += d * d;
+			d -= pcm[(n + bestLag) * nChans + ch];
+			noise += d * d;
+		}
+	}
+	*lagOut = bestLag;
+	if (noise == 0)
+		return 999;
+	return sig > 0 ? 10 * log10(sig / noise) : 0;
+}
+
+static const char *VersionName(int version)
+{
+	return version == MPEG1 ? "1" : (version == MPEG2 ? "2" : "2.5");
+}
+
+int main(int argc, char **argv)
+{
+	FILE *manifest;
+	char line[MAX_LINE], name[MAX_LINE], crcStr[MAX_LINE], snrStr[MAX_LINE], path[2*MAX_LINE], dir[MAX_LINE];
+	const char *slash;
+	unsigned char *mp3;
+	short *pcm, *ref;
+	long mp3Len, refLen;
+	StreamResult res, best;
+	double snr, snrMin, audioSecs;
+	int bless = 0, skipMissing = 0, loops = 3, i, n, lag, ok, checked, nPass = 0, nFail = 0, nSkip = 0;
+	FILE *log;
+
+	for (i = 1; i < argc - 1; i++) {
+		if (!strcmp(argv[i], "-b"))
+			bless = 1;
+		else if (!strcmp(argv[i], "-k"))
+			skipMissing = 1;
+		else if (!strcmp(argv[i], "-n"))
+			loops = atoi(argv[++i]);
+		else
+			break;
+	}
+	if (i != argc - 1 || loops < 1) {
+		printf("usage: mp3regress [-b] [-k] [-n loops] manifest.txt\n");
+		return -1;
+	}
+	if (!(manifest = fopen(argv[argc - 1], "r"))) {
+		printf("file open error\n");
+		return -1;
+	}
+	slash = strrchr(argv[argc - 1], '/');
+	n = slash ? (int)(slash - argv[argc - 1] + 1) : 0;
+	memcpy(dir, argv[argc - 1], n);
+	dir[n] = 0;
+
+	/* with -b the manifest goes to stdout, the report to stderr */
+	log = bless ? stderr : stdout;
+	InitCRC();
+
+	fprintf(log, "%-28s %-4s %6s %2s %5s %6s %9s %8s %8s %7s  %s\n",
+			"stream", "mpeg", "Hz", "ch", "kbps", "frames", "frames/s", "xRT", "crc32", "snr", "result");
+
+	while (fgets(line, sizeof(line), manifest)) {
+		if (sscanf(line, "%s %s %s", name, crcStr, snrStr) != 3 || name[0] == '#') {
+			if (bless)
+				fputs(line, stdout);
+			continue;
+		}
+		snprintf(path, sizeof(path), "%s%s", dir, name);
+		if (!(mp3 = LoadFile(path, &mp3Len))) {
+			if (bless)
+				fputs(line, stdout);
+			if (skipMissing || bless) {
+				fprintf(log, "%-28s missing, skipped\n", name);
+				nSkip++;
+			} else {
+				fprintf(log, "%-28s FAIL (missing)\n", name);
+				nFail++;
+			}
+			continue;
+		}
+
+		/* first pass keeps the PCM, the rest only time the decode */
+		pcm = 0;
+		if (DecodeStream(mp3, mp3Len, &best, &pcm))
+			return -2;
+		for (n = 1; n < loops; n++) {
+			if (DecodeStream(mp3, mp3Len, &res, 0))
+				return -2;
+			if (res.secs < best.secs)
+				best.secs = res.secs;
+		}
+		free(mp3);
+
+		ok = (best.nFrames > 0 && best.nErrors == 0);
+		checked = (bless || strcmp(crcStr, "-"));
+		if (!bless && strcmp(crcStr, "-") && strtoul(crcStr, 0, 16) != best.crc)
+			ok = 0;
+
+		/* optional reference decode next to the stream: name.mp3 -> name.pcm */
+		snr = -1;
+		snrMin = 0;
+		lag = 0;
+		n = (int)strlen(path);
+		if (n > 4 && strcmp(snrStr, "-")) {
+			strcpy(path + n - 4, ".pcm");
+			ref = (short *)LoadFile(path, &refLen);
+			if (ref) {
+				snr = MeasureSNR(pcm, best.nSamps, ref, refLen / (long)sizeof(short), best.nChans, &lag);
+				snrMin = atof(snrStr);
+				if (snr < snrMin)
+					ok = 0;
+				checked = 1;
+				free(ref);
+			}
+		}
+		free(pcm);
+		if (!checked)
+			ok = 0;
+
+		audioSecs = best.nChans && best.samprate ? (double)best.nSamps / best.nChans / best.samprate : 0;
+		fprintf(log, "%-28s %-4s %6d %2d %5ld %6d %9.0f %8.1f %08x ",
+				name, VersionName(best.info.version), best.samprate, best.nChans,
+				best.nFrames ? best.bitrateSum / best.nFrames / 1000 : 0, best.nFrames,
+				best.secs > 0 ? best.nFrames / best.secs : 0, best.secs > 0 ? audioSecs / best.secs : 0, best.crc);
+		if (snr >= 0)
+			fprintf(log, "%7.1f  ", snr);
+		else
+			fprintf(log, "%7s  ", "-");
+		if (best.nErrors)
+			fprintf(log, "FAIL (%d decode errors)\n", best.nErrors);
+		else if (snr >= 0 && snr < snrMin)
+			fprintf(log, "FAIL (snr < %s dB, lag %d)\n", snrStr, lag);
+		else if (!checked)
+			fprintf(log, "FAIL (no crc32 and no .pcm reference)\n");
+		else if (!ok)
+			fprintf(log, "FAIL (expected %s)\n", crcStr);
+		else
+			fprintf(log, "ok\n");
+
+		if (bless)
+			fprintf(stdout, "%-28s %08x  %s\n", name, best.crc, snrStr);
+		if (ok)
+			nPass++;
+		else
+			nFail++;
+	}
+	fclose(manifest);
+
+	fprintf(log, "%d passed, %d failed, %d skipped\n", nPass, nFail, nSkip);
+	return nFail ? 1 : 0;
+}
@@ -0,0 +1,844 @@
+/* ***** BEGIN LICENSE BLOCK ***** 
+ * Version: RCSL 1.0/RPSL 1.0 
+ *  
+ * Portions Copyright (c) 1995-2002 RealNetworks, Inc. All Rights Reserved. 
+ *      
+ * The contents of this file, and the files included with this file, are 
+ * subject to the current version of the RealNetworks Public Source License 
+ * Version 1.0 (the "RPSL") available at 
+ * http://www.helixcommunity.org/content/rpsl unless you have licensed 
+ * the file under the RealNetworks Community Source License Version 1.0 
+ * (the "RCSL") available at http://www.helixcommunity.org/content/rcsl, 
+ * in which case the RCSL will apply. You may also obtain the license terms 
+ * directly from RealNetworks.  You may not use this file except in 
+ * compliance with the RPSL or, if you have a valid RCSL with RealNetworks 
+ * applicable to this file, the RCSL.  Please see the applicable RPSL or 
+ * RCSL for the rights, obligations and limitations governing use of the 
+ * contents of the file.  
+ *  
+ * This file is part of the Helix DNA Technology. RealNetworks is the 
+ * developer of the Original Code and owns the copyrights in the portions 
+ * it created. 
+ *  
+ * This file, and the files included with this file, is distributed and made 
+ * available on an 'AS IS' basis, WITHOUT WARRANTY OF ANY KIND, EITHER 
+ * EXPRESS OR IMPLIED, AND REALNETWORKS HEREBY DISCLAIMS ALL SUCH WARRANTIES, 
+ * INCLUDING WITHOUT LIMITATION, ANY WARRANTIES OF MERCHANTABILITY, FITNESS 
+ * FOR A PARTICULAR PURPOSE, QUIET ENJOYMENT OR NON-INFRINGEMENT. 
+ * 
+ * Technology Compatibility Kit Test Suite(s) Location: 
+ *    http://www.helixcommunity.org/content/tck 
+ * 
+ * Contributor(s): 
+ *  
+ * ***** END LICENSE BLOCK ***** */ 
+
+
+
+/**************************************************************************************
+ * Fixed-point MP3 decoder
+ *
+ * synth.c - writes the synthetic Layer III streams of the in-tree regression corpus
+ *
+ * usage: mp3synth outdir
+ *
+ * the streams in corpus/synth/ do not come from an encoder: quantized spectra, scale
+ *   factors, block types, stereo modes and bitrates are drawn from a seeded random
+ *   generator and packed into valid frames, so every path of the decoder is hit
+ *   (MPEG 1/2/2.5, all Huffman pair tables incl. linbits, both quad tables, long, start,
+ *   short, mixed and stop blocks, scfsi, preflag, subblock gain, M/S and intensity
+ *   stereo, dual channel, CRC, VBR and the bit reservoir) within a few KB per stream.
+ *   the output is deterministic, the streams and their CRCs in corpus/manifest.txt
+ *   are checked in and only need regenerating when this file changes.
+ *
+ * the Huffman code tables are read back from the decoder's tables (huffman.c is built
+ *   into this file for its static decode functions) and every granule is decoded again
+ *   before it is written, so the streams follow the bitstream syntax exactly as this
+ *   decoder reads it. the decoded audio is noise-like; it is a fixture for bit-exact
+ *   regression testing, not a listening test
+ **************************************************************************************/
+
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+
+#include "huffman.c"
+
+#define SYN_MAXBITS		20			/* longest pair codeword is 19 bits */
+#define SYN_MAXFRAMES	64
+#define SYN_MAXFRAMEBYTES	1441
+
+#define SYN_SHORT		0x01		/* start / short / stop block sequences */
+#define SYN_MIXED		0x02		/* some short blocks mixed */
+#define SYN_SCFSI		0x04		/* MPEG 1: reuse granule 0 scale factors */
+#define SYN_CRC			0x08		/* protection bit, CRC-16 after the header */
+
+typedef struct _StreamDef {
+	const char *name;
+	MPEGVersion ver;
+	int samprate;
+	StereoMode mode;
+	int modeExt;					/* joint stereo: bits the frames may set (1 = intensity, 2 = M/S) */
+	int brMin, brMax;				/* kbps, equal for CBR */
+	int flags;
+	int resv;						/* largest main_data_begin */
+	int gain;						/* typical global gain */
+	int nFrames;
+	unsigned int seed;
+} StreamDef;
+
+static const StreamDef streamDefs[] = {
+	{ "syn_m1_44k_st_128.mp3",      MPEG1,  44100, Stereo, 0, 128, 128, 0,                                 511, 140, 40, 0x6d2b79f5 },
+	{ "syn_m1_48k_js_ms_192.mp3",   MPEG1,  48000, Joint,  2, 192, 192, SYN_SHORT | SYN_MIXED,             511, 138, 40, 0x1b873593 },
+	{ "syn_m1_32k_js_is_96.mp3",    MPEG1,  32000, Joint,  3,  96,  96, SYN_SHORT,                         300, 140, 40, 0xcc9e2d51 },
+	{ "syn_m1_44k_m_vbr_crc.mp3",   MPEG1,  44100, Mono,   0,  32, 320, SYN_SHORT | SYN_SCFSI | SYN_CRC,   511, 138, 40, 0x85ebca6b },
+	{ "syn_m1_44k_dual_160.mp3",    MPEG1,  44100, Dual,   0, 160, 160, SYN_SHORT | SYN_MIXED | SYN_SCFSI,   0, 136, 40, 0xc2b2ae35 },
+	{ "syn_m2_22k_js_msis_64.mp3",  MPEG2,  22050, Joint,  3,  64,  64, SYN_SHORT | SYN_MIXED,             255, 140, 40, 0x27d4eb2f },
+	{ "syn_m2_24k_m_vbr_crc.mp3",   MPEG2,  24000, Mono,   0,   8, 160, SYN_SHORT | SYN_CRC,               255, 150, 40, 0x165667b1 },
+	{ "syn_m2_16k_st_48.mp3",       MPEG2,  16000, Stereo, 0,  48,  48, SYN_SHORT | SYN_MIXED,             100, 145, 40, 0xd3a2646c },
+	{ "syn_m25_11k_js_is_32.mp3",   MPEG25, 11025, Joint,  3,  32,  32, SYN_SHORT,                         255, 140, 40, 0xfd7046c5 },
+	{ "syn_m25_8k_m_16.mp3",        MPEG25,  8000, Mono,   0,  16,  16, 0,                                 255, 142, 40, 0xb55a4f09 },
+	{ "syn_m25_12k_st_vbr.mp3",     MPEG25, 12000, Stereo, 0,   8,  64, SYN_SHORT | SYN_MIXED,             200, 138, 40, 0x9e3779b9 },
+};
+
+typedef struct _HuffCode {
+	unsigned int code;
+	int len;
+} HuffCode;
+
+static HuffCode pairCode[HUFF_PAIRTABS][16][16];
+static HuffCode quadCode[2][16];
+static int maxVal[HUFF_PAIRTABS];		/* largest |value| per table, -1 = invalid table */
+
+typedef struct _BitWriter {
+	unsigned char *buf;
+	long size;
+	long pos;						/* bits */
+} BitWriter;
+
+/* one granule of one channel, spec[] in bitstream order */
+typedef struct _Granule {
+	int part23Length, bigVals, globalGain, sfCompress, winSwitch, blockType, mixed;
+	int table[3], subBlockGain[3], region0, region1, preFlag, sfScale, count1Table;
+	int nCount1;					/* values in the count1 region (multiple of 4) */
+	int nSF;						/* scale factors in bitstream order */
+	int sfLen[64], sfVal[64];
+	int spec[MAX_NSAMP];
+} Granule;
+
+static unsigned int rngState;
+
+static unsigned int Rand32(void)
+{
+	/* xorshift32 */
+	rngState ^= rngState << 13;
+	rngState ^= rngState >> 17;
+	rngState ^= rngState << 5;
+	return rngState;
+}
+
+/* 0 .. n-1 */
+static int RandInt(int n)
+{
+	return n > 0 ? (int)(Rand32() % (unsigned int)n) : 0;
+}
+
+/* true with probability pct / 100 */
+static int RandPct(int pct)
+{
+	return RandInt(100) < pct;
+}
+
+static void PutBits(BitWriter *bw, unsigned int val, int n)
+{
+	while (n-- > 0) {
+		if ((bw->pos >> 3) >= bw->size) {
+			printf("bit writer overflow\n");
+			exit(1);
+		}
+		if ((val >> n) & 0x01)
+			bw->buf[bw->pos >> 3] |= 0x80 >> (bw->pos & 0x07);
+		bw->pos++;
+	}
+}
+
+/**************************************************************************************
+ * Function:    BuildCodes
+ *
+ * Description: derive the encoder code tables from the decoder tables
+ *
+ * Notes:       a pair codeword is found by decoding every 20-bit prefix (trailing sign
+ *                and linbits read as 0), then skipping all prefixes that start with it;
+ *                the quad tables are direct lookups of maxBits
+ **************************************************************************************/
+static void BuildCodes(void)
+{
+	unsigned char buf[16];
+	int xy[2], t, x, y, used, len, linBits, n;
+	unsigned int p, idx;
+	const unsigned char *tBase;
+
+	for (t = 0; t < HUFF_PAIRTABS; t++) {
+		maxVal[t] = (huffTabLookup[t].tabType == invalidTab ? -1 : 0);
+		if (huffTabLookup[t].tabType == invalidTab || huffTabLookup[t].tabType == noBits)
+			continue;
+
+		linBits = huffTabLookup[t].linBits;
+		for (p = 0; p < (1u << SYN_MAXBITS); p += 1u << (SYN_MAXBITS - len)) {
+			memset(buf, 0, sizeof(buf));
+			buf[0] = (unsigned char)(p >> (SYN_MAXBITS - 8));
+			buf[1] = (unsigned char)(p >> (SYN_MAXBITS - 16));
+			buf[2] = (unsigned char)(p << (24 - SYN_MAXBITS));
+			used = DecodeHuffmanPairs(xy, 2, t, 8 * (int)sizeof(buf), buf, 0);
+			x = xy[0];
+			y = xy[1];
+			len = used - (x != 0) - (y != 0) - (linBits && x == 15 ? linBits : 0) - (linBits && y == 15 ? linBits : 0);
+			if (used < 0 || x < 0 || y < 0 || x > 15 || y > 15 || len < 1 || len > SYN_MAXBITS) {
+				printf("table %d: cannot read codeword at prefix %05x\n", t, p);
+				exit(1);
+			}
+			if (pairCode[t][x][y].len == 0) {
+				pairCode[t][x][y].code = p >> (SYN_MAXBITS - len);
+				pairCode[t][x][y].len = len;
+			}
+			if (x > maxVal[t])
+				maxVal[t] = x;
+		}
+
+		/* every pair up to the largest value must have a codeword */
+		for (x = 0, n = 0; x <= maxVal[t]; x++)
+			for (y = 0; y <= maxVal[t]; y++)
+				n += (pairCode[t][x][y].len == 0);
+		if (n) {
+			printf("table %d: %d pairs without codeword\n", t, n);
+			exit(1);
+		}
+		if (linBits)
+			maxVal[t] = 15 + (1 << linBits) - 1;
+	}
+
+	for (t = 0; t < 2; t++) {
+		tBase = quadTable + quadTabOffset[t];
+		for (idx = 0; idx < (1u << quadTabMaxBits[t]); idx++) {
+			len = GetHLenQ(tBase[idx]);
+			n = tBase[idx] & 0x0f;
+			if (quadCode[t][n].len == 0) {
+				quadCode[t][n].code = idx >> (quadTabMaxBits[t] - len);
+				quadCode[t][n].len = len;
+			}
+		}
+	}
+}
+
+/* region boundaries of the big values, as DecodeHuffman() computes them */
+static void RegionEnds(const Granule *g, const SFBandTable *sfBand, MPEGVersion ver, int rEnd[4])
+{
+	int r1Start, r2Start, w;
+
+	if (g->winSwitch && g->blockType == 2) {
+		if (g->mixed == 0) {
+			r1Start = sfBand->s[(g->region0 + 1)/3] * 3;
+		} else if (ver == MPEG1) {
+			r1Start = sfBand->l[g->region0 + 1];
+		} else {
+			w = sfBand->s[4] - sfBand->s[3];
+			r1Start = sfBand->l[6] + 2*w;
+		}
+		r2Start = MAX_NSAMP;
+	} else {
+		r1Start = sfBand->l[g->region0 + 1];
+		r2Start = sfBand->l[g->region0 + 1 + g->region1 + 1];
+	}
+	rEnd[3] = MIN(MAX_NSAMP, 2 * g->bigVals);
+	rEnd[2] = MIN(r2Start, rEnd[3]);
+	rEnd[1] = MIN(r1Start, rEnd[3]);
+	rEnd[0] = 0;
+}
+
+static void PutPair(BitWriter *bw, int t, int x, int y)
+{
+	int linBits = huffTabLookup[t].linBits;
+	int ax = abs(x), ay = abs(y);
+	int cx = (linBits && ax >= 15 ? 15 : ax);
+	int cy = (linBits && ay >= 15 ? 15 : ay);
+
+	PutBits(bw, pairCode[t][cx][cy].code, pairCode[t][cx][cy].len);
+	if (linBits && cx == 15)
+		PutBits(bw, ax - 15, linBits);
+	if (ax)
+		PutBits(bw, x < 0, 1);
+	if (linBits && cy == 15)
+		PutBits(bw, ay - 15, linBits);
+	if (ay)
+		PutBits(bw, y < 0, 1);
+}
+
+static void PutHuffman(BitWriter *bw, const Granule *g, const SFBandTable *sfBand, MPEGVersion ver)
+{
+	int rEnd[4], r, i, n;
+
+	RegionEnds(g, sfBand, ver, rEnd);
+	for (r = 0; r < 3; r++) {
+		if (g->table[r] == 0)
+			continue;
+		for (i = rEnd[r]; i < rEnd[r+1]; i += 2)
+			PutPair(bw, g->table[r], g->spec[i], g->spec[i+1]);
+	}
+	for (i = rEnd[3]; i < rEnd[3] + g->nCount1; i += 4) {
+		n = (abs(g->spec[i]) << 3) | (abs(g->spec[i+1]) << 2) | (abs(g->spec[i+2]) << 1) | abs(g->spec[i+3]);
+		PutBits(bw, quadCode[g->count1Table][n].code, quadCode[g->count1Table][n].len);
+		for (n = 0; n < 4; n++) {
+			if (g->spec[i+n])
+				PutBits(bw, g->spec[i+n] < 0, 1);
+		}
+	}
+}
+
+static void PutScaleFactors(BitWriter *bw, const Granule *g)
+{
+	int i;
+
+	for (i = 0; i < g->nSF; i++)
+		PutBits(bw, g->sfVal[i], g->sfLen[i]);
+}
+
+/* decode the Huffman data of a granule again and compare with what was written */
+static void VerifyHuffman(const Granule *g, const SFBandTable *sfBand, MPEGVersion ver, unsigned char *buf, int nBits)
+{
+	int out[MAX_NSAMP + 4], rEnd[4], r, i, used, bitOffset = 0, bitsLeft = nBits, n;
+
+	memset(out, 0, sizeof(out));
+	RegionEnds(g, sfBand, ver, rEnd);
+	for (r = 0; r < 3; r++) {
+		used = DecodeHuffmanPairs(out + rEnd[r], rEnd[r+1] - rEnd[r], g->table[r], bitsLeft, buf, bitOffset);
+		if (used < 0 || used > bitsLeft) {
+			printf("verify: region %d overruns\n", r);
+			exit(1);
+		}
+		buf += (used + bitOffset) >> 3;
+		bitOffset = (used + bitOffset) & 0x07;
+		bitsLeft -= used;
+	}
+	n = DecodeHuffmanQuads(out + rEnd[3], MAX_NSAMP - rEnd[3], g->count1Table, bitsLeft, buf, bitOffset);
+	if (n != g->nCount1) {
+		printf("verify: %d count1 values, wrote %d\n", n, g->nCount1);
+		exit(1);
+	}
+	for (i = 0; i < MAX_NSAMP; i++) {
+		/* the decoder returns sign and magnitude */
+		if (out[i] < 0)
+			out[i] = -(out[i] & 0x7fffffff);
+		if (out[i] != g->spec[i]) {
+			printf("verify: value %d decodes to %d, wrote %d\n", i, out[i], g->spec[i]);
+			exit(1);
+		}
+	}
+}
+
+/* |value| for a Huffman table, mostly small like a real spectrum */
+static int RandMag(int maxV)
+{
+	unsigned int u;
+
+	if (maxV <= 0 || RandPct(35))
+		return 0;
+	if (maxV > 15 && RandPct(90))
+		maxV = 15;
+	u = Rand32() >> 16;
+	/* u^3 in 0..1 scaled to maxV */
+	return (int)(((unsigned long long)u * u * u * (maxV + 1)) >> 48);
+}
+
+/* NRTab[] of scalfact.c: scale factor bands per partition, [sfcIdx][block type][partition], short blocks / 3 */
+static const char NRTab[6][3][4] = {
+	{ {6, 5, 5, 5},   {3, 3, 3, 3}, {6, 3, 3, 3} },
+	{ {6, 5, 7, 3},   {3, 3, 4, 2}, {6, 3, 4, 2} },
+	{ {11, 10, 0, 0}, {6, 6, 0, 0}, {6, 3, 6, 0} },
+	{ {7, 7, 7, 0},   {4, 4, 4, 0}, {6, 5, 4, 0} },
+	{ {6, 6, 6, 3},   {4, 3, 3, 2}, {6, 4, 3, 2} },
+	{ {8, 8, 5, 0},   {5, 4, 3, 0}, {6, 6, 3, 0} },
+};
+
+/* scale factor lengths and band counts of an MPEG 2 sfCompress, as UnpackSFMPEG2() reads them */
+static int SlenMPEG2(int sfCompress, int isRight, int blockType, int mixed, int slen[4], int nr[4])
+{
+	int i, sfcIdx, btIdx;
+
+	if (!isRight) {
+		if (sfCompress < 400) {
+			slen[0] = (sfCompress >> 4) / 5;
+			slen[1] = (sfCompress >> 4) % 5;
+			slen[2] = (sfCompress & 0x0f) >> 2;
+			slen[3] = (sfCompress & 0x03);
+			sfcIdx = 0;
+		} else if (sfCompress < 500) {
+			sfCompress -= 400;
+			slen[0] = (sfCompress >> 2) / 5;
+			slen[1] = (sfCompress >> 2) % 5;
+			slen[2] = (sfCompress & 0x03);
+			slen[3] = 0;
+			sfcIdx = 1;
+		} else {
+			sfCompress -= 500;
+			slen[0] = sfCompress / 3;
+			slen[1] = sfCompress % 3;
+			slen[2] = slen[3] = 0;
+			if (mixed) {
+				slen[2] = slen[1];
+				slen[1] = slen[0];
+			}
+			sfcIdx = 2;
+		}
+	} else {
+		sfCompress >>= 1;
+		if (sfCompress < 180) {
+			slen[0] = (sfCompress / 36);
+			slen[1] = (sfCompress % 36) / 6;
+			slen[2] = (sfCompress % 36) % 6;
+			slen[3] = 0;
+			sfcIdx = 3;
+		} else if (sfCompress < 244) {
+			sfCompress -= 180;
+			slen[0] = (sfCompress & 0x3f) >> 4;
+			slen[1] = (sfCompress & 0x0f) >> 2;
+			slen[2] = (sfCompress & 0x03);
+			slen[3] = 0;
+			sfcIdx = 4;
+		} else {
+			sfCompress -= 244;
+			slen[0] = (sfCompress / 3);
+			slen[1] = (sfCompress % 3);
+			slen[2] = slen[3] = 0;
+			sfcIdx = 5;
+		}
+	}
+	btIdx = (blockType == 2 ? (mixed ? 2 : 1) : 0);
+	for (i = 0; i < 4; i++)
+		nr[i] = (int)NRTab[sfcIdx][btIdx][i];
+	return sfcIdx;
+}
+
+/* pick sfCompress and the scale factors in bitstream order */
+static void MakeScaleFactors(Granule *g, MPEGVersion ver, int gr, const int *scfsi, int isRight, int small)
+{
+	static const char slenMPEG1[16][2] = {
+		{0, 0}, {0, 1}, {0, 2}, {0, 3}, {3, 0}, {1, 1}, {1, 2}, {1, 3},
+		{2, 1}, {2, 2}, {2, 3}, {3, 1}, {3, 2}, {3, 3}, {4, 2}, {4, 3},
+	};
+	int slen[4], nr[4], i, j, k, sfb, s0, s1, s2, s3;
+
+	g->nSF = 0;
+	if (ver == MPEG1) {
+		g->sfCompress = (small ? 0 : RandInt(16));
+		s0 = slenMPEG1[g->sfCompress][0];
+		s1 = slenMPEG1[g->sfCompress][1];
+		if (g->blockType == 2) {
+			if (g->mixed) {
+				for (sfb = 0; sfb < 8; sfb++)
+					g->sfLen[g->nSF++] = s0;
+				sfb = 3;
+			} else {
+				sfb = 0;
+			}
+			for ( ; sfb < 12; sfb++)
+				for (j = 0; j < 3; j++)
+					g->sfLen[g->nSF++] = (sfb < 6 ? s0 : s1);
+		} else {
+			for (sfb = 0; sfb < 21; sfb++) {
+				/* scfsi groups 0-5, 6-10, 11-15, 16-20 are not sent again in granule 1 */
+				k = (sfb < 6 ? 0 : (sfb < 11 ? 1 : (sfb < 16 ? 2 : 3)));
+				if (gr == 1 && scfsi[k])
+					continue;
+				g->sfLen[g->nSF++] = (sfb < 11 ? s0 : s1);
+			}
+		}
+	} else {
+		if (small) {
+			g->sfCompress = (isRight ? Rand32() & 0x01 : 0);
+		} else if (!isRight) {
+			switch (RandInt(3)) {
+			case 0:
+				s0 = RandInt(5); s1 = RandInt(5); s2 = RandInt(4); s3 = RandInt(4);
+				g->sfCompress = ((s0 * 5 + s1) << 4) + (s2 << 2) + s3;
+				break;
+			case 1:
+				s0 = RandInt(5); s1 = RandInt(5); s2 = RandInt(4);
+				g->sfCompress = 400 + ((s0 * 5 + s1) << 2) + s2;
+				break;
+			default:
+				s0 = RandInt(4); s1 = RandInt(3);
+				g->sfCompress = 500 + s0 * 3 + s1;
+				break;
+			}
+		} else {
+			switch (RandInt(3)) {
+			case 0:
+				s0 = RandInt(5); s1 = RandInt(6); s2 = RandInt(6);
+				g->sfCompress = s0 * 36 + s1 * 6 + s2;
+				break;
+			case 1:
+				s0 = RandInt(4); s1 = RandInt(4); s2 = RandInt(4);
+				g->sfCompress = 180 + (s0 << 4) + (s1 << 2) + s2;
+				break;
+			default:
+				s0 = RandInt(4); s1 = RandInt(3);
+				g->sfCompress = 244 + s0 * 3 + s1;
+				break;
+			}
+			/* intensity scale in bit 0 */
+			g->sfCompress = (g->sfCompress << 1) | (Rand32() & 0x01);
+		}
+		SlenMPEG2(g->sfCompress, isRight, g->blockType, g->mixed, slen, nr);
+		if (g->blockType == 2) {
+			k = 0;
+			if (g->mixed) {
+				for (sfb = 0; sfb < 6; sfb++)
+					g->sfLen[g->nSF++] = slen[0];
+				k = 1;
+			}
+			for ( ; k < 4; k++)
+				for (i = 0; i < nr[k]; i++)
+					for (j = 0; j < 3; j++)
+						g->sfLen[g->nSF++] = slen[k];
+		} else {
+			for (k = 0; k < 4; k++)
+				for (i = 0; i < nr[k]; i++)
+					g->sfLen[g->nSF++] = slen[k];
+		}
+	}
+	for (i = 0; i < g->nSF; i++)
+		g->sfVal[i] = RandInt(1 << g->sfLen[i]);
+}
+
+static int ScaleFactorBits(const Granule *g)
+{
+	int i, n = 0;
+
+	for (i = 0; i < g->nSF; i++)
+		n += g->sfLen[i];
+	return n;
+}
+
+/**************************************************************************************
+ * Function:    MakeGranule
+ *
+ * Description: fill one granule of one channel with random content of at most maxBits
+ *                (scale factors + Huffman data)
+ *
+ * Inputs:      block type and mixed flag in g, scfsi of the channel (MPEG 1 granule 1),
+ *              isRight = intensity coded right channel (narrow band, is_pos scale factors)
+ **************************************************************************************/
+static void MakeGranule(Granule *g, const StreamDef *def, const SFBandTable *sfBand, int gr, const int *scfsi,
+						int isRight, int maxBits)
+{
+	static const int pairTabs[] = { 0, 1, 2, 3, 5, 6, 7, 8, 9, 10, 11, 12, 13, 15,
+									16, 17, 18, 19, 20, 21, 22, 23, 24, 25, 26, 27, 28, 29, 30, 31 };
+	unsigned char scratch[MAX_NSAMP * 8];
+	BitWriter bw;
+	int rEnd[4], r, i, nz, hBits, sfBits;
+
+	g->globalGain = def->gain + RandInt(17) - 8 + (RandPct(5) ? 24 : 0);
+	g->sfScale = RandInt(2);
+	g->preFlag = (def->ver == MPEG1 && g->blockType != 2 ? RandInt(2) : 0);
+	g->count1Table = RandInt(2);
+	g->winSwitch = (g->blockType != 0);
+	if (g->winSwitch) {
+		for (i = 0; i < 3; i++)
+			g->subBlockGain[i] = (g->blockType == 2 ? RandInt(4) : 0);
+		g->region0 = (g->blockType == 2 && !g->mixed ? 8 : 7);
+		g->region1 = 20 - g->region0;
+	} else {
+		g->region0 = RandInt(16);
+		g->region1 = RandInt(MIN(8, 21 - g->region0));
+	}
+
+	/* small budgets go to the spectrum, not the scale factors */
+	MakeScaleFactors(g, def->ver, gr, scfsi, isRight, maxBits < 150);
+	sfBits = ScaleFactorBits(g);
+	if (sfBits > maxBits) {
+		MakeScaleFactors(g, def->ver, gr, scfsi, isRight, 1);
+		sfBits = ScaleFactorBits(g);
+	}
+	if (def->ver != MPEG1)
+		g->preFlag = (!isRight && g->sfCompress >= 500);
+
+	/* spectrum: big values up to nz, then count1 quads, the intensity coded channel stays narrow */
+	nz = 64 + RandInt(MAX_NSAMP - 64);
+	if (isRight)
+		nz = nz / 4;
+	g->bigVals = RandInt(nz / 2 + 1);
+	g->nCount1 = 4 * RandInt((MIN(nz, MAX_NSAMP) - 2 * g->bigVals) / 4 + 1);
+	for (r = 0; r < 3; r++)
+		g->table[r] = pairTabs[RandInt(sizeof(pairTabs) / sizeof(pairTabs[0]))];
+	if (g->winSwitch)
+		g->table[2] = 0;
+
+	memset(g->spec, 0, sizeof(g->spec));
+	RegionEnds(g, sfBand, def->ver, rEnd);
+	for (r = 0; r < 3; r++) {
+		for (i = rEnd[r]; i < rEnd[r+1]; i++) {
+			g->spec[i] = RandMag(maxVal[g->table[r]]);
+			if (g->spec[i] && RandPct(50))
+				g->spec[i] = -g->spec[i];
+		}
+	}
+	for (i = rEnd[3]; i < rEnd[3] + g->nCount1; i++)
+		g->spec[i] = (RandPct(50) ? 0 : (RandPct(50) ? 1 : -1));
+
+	/* shrink until it fits: count1 first, then the big values */
+	for (;;) {
+		memset(scratch, 0, sizeof(scratch));
+		bw.buf = scratch;
+		bw.size = sizeof(scratch);
+		bw.pos = 0;
+		PutHuffman(&bw, g, sfBand, def->ver);
+		hBits = (int)bw.pos;
+		if (sfBits + hBits <= maxBits && sfBits + hBits < 4096)
+			break;
+
+		RegionEnds(g, sfBand, def->ver, rEnd);
+		if (g->nCount1) {
+			g->nCount1 = (g->nCount1 / 8) * 4;
+			for (i = rEnd[3] + g->nCount1; i < MAX_NSAMP; i++)
+				g->spec[i] = 0;
+		} else {
+			g->bigVals = g->bigVals * 3 / 4;
+			for (i = 2 * g->bigVals; i < MAX_NSAMP; i++)
+				g->spec[i] = 0;
+		}
+	}
+	VerifyHuffman(g, sfBand, def->ver, scratch, hBits);
+	g->part23Length = sfBits + hBits;
+}
+
+/* next block type of a channel: long, or start -> short (1..3 granules) -> stop */
+static int NextBlockType(int prev, int *shortLeft, int flags)
+{
+	if (!(flags & SYN_SHORT))
+		return 0;
+	switch (prev) {
+	case 0:
+	case 3:
+		if (RandPct(15)) {
+			*shortLeft = 1 + RandInt(3);
+			return 1;
+		}
+		return 0;
+	case 1:
+		return 2;
+	default:
+		return (--(*shortLeft) > 0 ? 2 : 3);
+	}
+}
+
+static unsigned int CRC16(unsigned int crc, const unsigned char *buf, int n)
+{
+	int i;
+
+	while (n-- > 0) {
+		crc ^= (unsigned int)(*buf++) << 8;
+		for (i = 0; i < 8; i++)
+			crc = (crc & 0x8000) ? ((crc << 1) ^ 0x8005) : (crc << 1);
+		crc &= 0xffff;
+	}
+	return crc;
+}
+
+static int WriteStream(const StreamDef *def, const char *path)
+{
+	static unsigned char frameHdr[SYN_MAXFRAMES][6 + SIBYTES_MPEG1_STEREO];
+	static int frameHdrLen[SYN_MAXFRAMES], frameSlots[SYN_MAXFRAMES];
+	static unsigned char mainData[SYN_MAXFRAMES * SYN_MAXFRAMEBYTES];
+	static Granule gran[MAX_NGRAN][MAX_NCHAN];
+	const SFBandTable *sfBand;
+	BitWriter md, si;
+	FILE *f;
+	int srIdx, brIdx, br, nChans, nGrans, spf, side, crc, pad, nSlots, modeExt, maxBegin;
+	int fr, gr, ch, i, k, parts, left, target, slotStart, mdBegin, mdEnd, start;
+	int blockType[MAX_NCHAN], shortLeft[MAX_NCHAN], scfsi[MAX_NCHAN][MAX_SCFBD];
+	long padRem = 0, bytesNum;
+	unsigned char hdr[4];
+
+	rngState = def->seed;
+	for (srIdx = 0; srIdx < 3 && samplerateTab[def->ver][srIdx] != def->samprate; srIdx++)
+		;
+	if (srIdx == 3 || def->nFrames > SYN_MAXFRAMES)
+		return -1;
+	sfBand = &sfBandTable[def->ver][srIdx];
+	nChans = (def->mode == Mono ? 1 : 2);
+	nGrans = (def->ver == MPEG1 ? NGRANS_MPEG1 : NGRANS_MPEG2);
+	spf = samplesPerFrameTab[def->ver][2];
+	side = sideBytesTab[def->ver][nChans - 1];
+	crc = (def->flags & SYN_CRC) ? 1 : 0;
+	maxBegin = MIN(def->resv, def->ver == MPEG1 ? 511 : 255);
+
+	memset(mainData, 0, sizeof(mainData));
+	md.buf = mainData;
+	md.size = sizeof(mainData);
+	md.pos = 0;
+	slotStart = 0;
+	mdEnd = 0;
+	memset(blockType, 0, sizeof(blockType));
+	memset(shortLeft, 0, sizeof(shortLeft));
+
+	for (fr = 0; fr < def->nFrames; fr++) {
+		/* bitrate, padding like an encoder keeping the average rate */
+		do {
+			brIdx = 1 + RandInt(14);
+			br = bitrateTab[def->ver][2][brIdx];
+		} while (br < def->brMin || br > def->brMax);
+		bytesNum = (long)spf / 8 * br * 1000;
+		padRem += bytesNum % def->samprate;
+		pad = (def->brMin == def->brMax && padRem >= def->samprate) || (def->brMin != def->brMax && RandPct(30));
+		if (padRem >= def->samprate)
+			padRem -= def->samprate;
+		nSlots = slotTab[def->ver][srIdx][brIdx] - side - 4 - 2 * crc + pad;
+		modeExt = (def->mode == Joint ? def->modeExt & RandInt(4) : 0);
+
+		/* block types of the frame, joint stereo channels share them */
+		for (gr = 0; gr < nGrans; gr++) {
+			for (ch = 0; ch < nChans; ch++) {
+				if (ch == 1 && def->mode == Joint) {
+					gran[gr][1].blockType = gran[gr][0].blockType;
+					gran[gr][1].mixed = gran[gr][0].mixed;
+					continue;
+				}
+				blockType[ch] = NextBlockType(blockType[ch], &shortLeft[ch], def->flags);
+				gran[gr][ch].blockType = blockType[ch];
+				gran[gr][ch].mixed = (blockType[ch] == 2 && (def->flags & SYN_MIXED) && RandPct(50));
+			}
+		}
+		for (ch = 0; ch < nChans; ch++) {
+			for (k = 0; k < MAX_SCFBD; k++) {
+				scfsi[ch][k] = (def->ver == MPEG1 && (def->flags & SYN_SCFSI) && gran[0][ch].blockType != 2 &&
+								gran[1][ch].blockType != 2 && RandPct(50));
+			}
+		}
+
+		/* main data starts as early as the reservoir allows */
+		start = MAX(mdEnd, slotStart - maxBegin);
+		mdBegin = slotStart - start;
+		md.pos = (long)start * 8;
+
+		/* split the bits, now and then a nearly empty frame refills the reservoir */
+		left = (slotStart + nSlots - start) * 8;
+		if (RandPct(15))
+			left = left / 10;
+		parts = nGrans * nChans;
+		for (gr = 0; gr < nGrans; gr++) {
+			for (ch = 0; ch < nChans; ch++, parts--) {
+				target = left / parts;
+				target = target / 2 + RandInt(target / 2 + 1);
+				if (parts == 1)
+					target = left;
+				MakeGranule(&gran[gr][ch], def, sfBand, gr, scfsi[ch],
+							(ch == 1 && (modeExt & 0x01)), target);
+				PutScaleFactors(&md, &gran[gr][ch]);
+				PutHuffman(&md, &gran[gr][ch], sfBand, def->ver);
+				left -= gran[gr][ch].part23Length;
+			}
+		}
+		mdEnd = (int)((md.pos + 7) >> 3);
+		if (mdEnd > slotStart + nSlots) {
+			printf("%s frame %d: main data overruns the frame\n", def->name, fr);
+			return -1;
+		}
+
+		/* header */
+		hdr[0] = 0xff;
+		hdr[1] = 0xe0 | ((def->ver == MPEG1 ? 3 : (def->ver == MPEG2 ? 2 : 0)) << 3) | (1 << 1) | (crc ? 0 : 1);
+		hdr[2] = (brIdx << 4) | (srIdx << 2) | (pad << 1) | RandInt(2);
+		hdr[3] = (def->mode << 6) | (modeExt << 4) | (RandInt(2) << 3) | (RandInt(2) << 2);
+
+		/* side info */
+		memset(frameHdr[fr], 0, sizeof(frameHdr[fr]));
+		memcpy(frameHdr[fr], hdr, 4);
+		si.buf = frameHdr[fr] + 4 + 2 * crc;
+		si.size = side;
+		si.pos = 0;
+		if (def->ver == MPEG1) {
+			PutBits(&si, mdBegin, 9);
+			PutBits(&si, RandInt(1 << (nChans == 1 ? 5 : 3)), nChans == 1 ? 5 : 3);
+			for (ch = 0; ch < nChans; ch++)
+				for (k = 0; k < MAX_SCFBD; k++)
+					PutBits(&si, scfsi[ch][k], 1);
+		} else {
+			PutBits(&si, mdBegin, 8);
+			PutBits(&si, RandInt(1 << nChans), nChans);
+		}
+		for (gr = 0; gr < nGrans; gr++) {
+			for (ch = 0; ch < nChans; ch++) {
+				Granule *g = &gran[gr][ch];
+				PutBits(&si, g->part23Length, 12);
+				PutBits(&si, g->bigVals, 9);
+				PutBits(&si, g->globalGain, 8);
+				PutBits(&si, g->sfCompress, def->ver == MPEG1 ? 4 : 9);
+				PutBits(&si, g->winSwitch, 1);
+				if (g->winSwitch) {
+					PutBits(&si, g->blockType, 2);
+					PutBits(&si, g->mixed, 1);
+					PutBits(&si, g->table[0], 5);
+					PutBits(&si, g->table[1], 5);
+					for (i = 0; i < 3; i++)
+						PutBits(&si, g->subBlockGain[i], 3);
+				} else {
+					for (i = 0; i < 3; i++)
+						PutBits(&si, g->table[i], 5);
+					PutBits(&si, g->region0, 4);
+					PutBits(&si, g->region1, 3);
+				}
+				if (def->ver == MPEG1)
+					PutBits(&si, g->preFlag, 1);
+				PutBits(&si, g->sfScale, 1);
+				PutBits(&si, g->count1Table, 1);
+			}
+		}
+		if (si.pos != side * 8) {
+			printf("%s frame %d: %ld side info bits\n", def->name, fr, si.pos);
+			return -1;
+		}
+		if (crc) {
+			/* CRC-16 over the last two header bytes and the side info */
+			unsigned int c = CRC16(0xffff, hdr + 2, 2);
+			c = CRC16(c, si.buf, side);
+			frameHdr[fr][4] = (unsigned char)(c >> 8);
+			frameHdr[fr][5] = (unsigned char)c;
+		}
+		frameHdrLen[fr] = 4 + 2 * crc + side;
+		frameSlots[fr] = nSlots;
+		slotStart += nSlots;
+	}
+
+	/* the main data of a frame may sit in earlier frames, so the frames are put together last */
+	if (!(f = fopen(path, "wb")))
+		return -1;
+	slotStart = 0;
+	for (fr = 0; fr < def->nFrames; fr++) {
+		fwrite(frameHdr[fr], 1, frameHdrLen[fr], f);
+		fwrite(mainData + slotStart, 1, frameSlots[fr], f);
+		slotStart += frameSlots[fr];
+	}
+	fclose(f);
+	printf("%-28s %d frames, %d bytes\n", def->name, def->nFrames, slotStart);
+	return 0;
+}
+
+int main(int argc, char **argv)
+{
+	char path[1024];
+	int i;
+
+	if (argc != 2) {
+		printf("usage: mp3synth outdir\n");
+		return -1;
+	}
+	BuildCodes();
+	for (i = 0; i < (int)(sizeof(streamDefs) / sizeof(streamDefs[0])); i++) {
+		snprintf(path, sizeof(path), "%s/%s", argv[1], streamDefs[i].name);
+		if (WriteStream(&streamDefs[i], path)) {
+			printf("%s: failed\n", path);
+			return -1;
+		}
+	}
+	return 0;
+}
@@ -0,0 +1,156 @@
+/*
+ * SPDX-FileCopyrightText: 2025 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <inttypes.h>
+#include "esp_log.h"
+#include "esp_check.h"
+
+#include "avifile.h"
+#include "avi_player.h"
+
+static const char *TAG = "avi index";
+
+#define AVI_INDEX_HEADER_SIZE  (32 * 1024)   /*!< hdrl plus JUNK padding of common muxers */
+#define AVI_INDEX_BATCH        64            /*!< idx1 entries read per batch */
+#define IDX1_ID                _REV(0x69647831)
+#define AVIIF_KEYFRAME         0x00000010
+
+static uint32_t _REV(uint32_t value)
+{
+    return (value & 0x000000FFU) << 24 | (value & 0x0000FF00U) << 8 |
+           (value & 0x00FF0000U) >> 8 | (value & 0xFF000000U) >> 24;
+}
+
+static bool read_at(const avi_stream_t *stream, uint32_t offset, void *buf, size_t len)
+{
+    if (stream->map) {
+        const uint8_t *p = stream->map(stream->ctx, offset, len);
+        if (p) {
+            memcpy(buf, p, len);
+            return true;
+        }
+    }
+    return stream->seek(stream->ctx, offset) == ESP_OK && stream->read(stream->ctx, buf, len) == len;
+}
+
+/**
+ * @brief Look the frame up in idx1, only reading index entries up to the wanted one
+ */
+static esp_err_t find_in_idx1(const avi_stream_t *stream, const avi_typedef *avi, uint32_t key_index,
+                              uint32_t *offset, uint32_t *size)
+{
+    uint32_t movi_list = avi->movi_start - 4;              /*!< position of the 'movi' fourcc */
+    uint32_t idx1_pos = movi_list + avi->movi_size;
+    idx1_pos += idx1_pos & 1;
+
+    AVI_CHUNK_HEAD head;
+    if (idx1_pos + sizeof(head) > stream->size(stream->ctx) || !read_at(stream, idx1_pos, &head, sizeof(head)) ||
+            head.FourCC != IDX1_ID) {
+        return ESP_ERR_NOT_FOUND;
+    }
+
+    AVI_IDX1 entries[AVI_INDEX_BATCH];
+    uint32_t total = head.size / sizeof(AVI_IDX1);
+    uint32_t pos = idx1_pos + sizeof(head);
+    uint32_t video_seen = 0;
+    int base = -1;                                          /*!< idx1 offsets are either movi-relative or absolute */
+
+    for (uint32_t i = 0; i < total; i += AVI_INDEX_BATCH) {
+        uint32_t n = total - i < AVI_INDEX_BATCH ? total - i : AVI_INDEX_BATCH;
+        if (!read_at(stream, pos, entries, n * sizeof(AVI_IDX1))) {
+            return ESP_FAIL;
+        }
+        pos += n * sizeof(AVI_IDX1);
+
+        for (uint32_t j = 0; j < n; j++) {
+            if (base < 0) {
+                base = entries[j].chunkoffset < avi->movi_start ? 1 : 0;
+            }
+            if ((entries[j].FourCC & 0xFFFF0000) != DC_ID || !(entries[j].flags & AVIIF_KEYFRAME)) {
+                continue;
+            }
+            if (video_seen++ == key_index) {
+                *offset = (base ? movi_list : 0) + entries[j].chunkoffset + sizeof(AVI_CHUNK_HEAD);
+                *size = entries[j].chunklength;
+                return ESP_OK;
+            }
+        }
+    }
+    return ESP_ERR_INVALID_ARG;
+}
+
+/**
+ * @brief No index: hop from chunk head to chunk head, never reading chunk payloads
+ *
+ * Without idx1 flags every video chunk counts as a key frame, which holds for MJPEG.
+ */
+static esp_err_t find_by_walking(const avi_stream_t *stream, const avi_typedef *avi, uint32_t key_index,
+                                 uint32_t *offset, uint32_t *size)
+{
+    uint32_t pos = avi->movi_start;
+    uint32_t end = avi->movi_start - 4 + avi->movi_size;
+    uint32_t video_seen = 0;
+
+    while (pos + sizeof(AVI_CHUNK_HEAD) <= end) {
+        AVI_CHUNK_HEAD head;
+        if (!read_at(stream, pos, &head, sizeof(head))) {
+            return ESP_FAIL;
+        }
+        if (head.FourCC == LIST_ID) {
+            pos += sizeof(AVI_LIST_HEAD);                   /*!< descend into 'rec ' lists */
+            continue;
+        }
+        if ((head.FourCC & 0xFFFF0000) == DC_ID && video_seen++ == key_index) {
+            *offset = pos + sizeof(head);
+            *size = head.size;
+            return ESP_OK;
+        }
+        pos += sizeof(head) + head.size + (head.size & 1);
+    }
+    return ESP_ERR_INVALID_ARG;
+}
+
+esp_err_t avi_player_read_key_frame(const avi_stream_t *stream, uint32_t key_index, uint8_t *buffer,
+                                      size_t *buffer_size, video_frame_info_t *info)
+{
+    ESP_RETURN_ON_FALSE(stream != NULL && buffer != NULL && buffer_size != NULL, ESP_ERR_INVALID_ARG, TAG, "invalid argument");
+
+    uint32_t header_len = stream->size(stream->ctx);
+    if (header_len > AVI_INDEX_HEADER_SIZE) {
+        header_len = AVI_INDEX_HEADER_SIZE;
+    }
+    uint8_t *header = malloc(header_len);
+    ESP_RETURN_ON_FALSE(header != NULL, ESP_ERR_NO_MEM, TAG, "Cannot alloc header buffer");
+
+    avi_typedef avi = {0};
+    bool ok = read_at(stream, 0, header, header_len) && avi_parser(&avi, header, header_len) == 0;
+    free(header);
+    ESP_RETURN_ON_FALSE(ok, ESP_ERR_INVALID_RESPONSE, TAG, "parse header failed");
+
+    uint32_t offset = 0, size = 0;
+    esp_err_t ret = find_in_idx1(stream, &avi, key_index, &offset, &size);
+    if (ret == ESP_ERR_NOT_FOUND || ret == ESP_FAIL) {
+        ESP_LOGD(TAG, "no usable idx1, walking movi");
+        ret = find_by_walking(stream, &avi, key_index, &offset, &size);
+    }
+    ESP_RETURN_ON_ERROR(ret, TAG, "key frame %"PRIu32" not found", key_index);
+
+    if (*buffer_size < size) {
+        *buffer_size = size;
+        return ESP_ERR_NO_MEM;
+    }
+    ESP_RETURN_ON_FALSE(read_at(stream, offset, buffer, size), ESP_FAIL, TAG, "read frame failed");
+    *buffer_size = size;
+
+    if (info) {
+        info->width = avi.vids_width;
+        info->height = avi.vids_height;
+        info->frame_format = avi.vids_format;
+    }
+    return ESP_OK;
+}
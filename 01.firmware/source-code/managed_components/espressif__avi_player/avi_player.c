@@ -31,11 +31,6 @@ static const char *TAG = "avi player";
 
 #define EVENT_ALL          (EVENT_FPS_TIME_UP | EVENT_START_PLAY | EVENT_STOP_PLAY | EVENT_DEINIT)
 
-typedef enum {
-    PLAY_FILE,
-    PLAY_MEMORY,
-} play_mode_t;
-
 typedef enum {
     AVI_PARSER_NONE,
     AVI_PARSER_HEADER,
@@ -44,18 +39,10 @@ typedef enum {
 } avi_play_state_t;
 
 typedef struct {
-    play_mode_t mode;
-    union {
-        struct {
-            uint8_t *data;
-            uint32_t size;
-            uint32_t read_offset;
-        } memory;
-        struct {
-            FILE *avi_file;
-        } file;
-    };
+    avi_stream_t stream;
+    uint32_t offset;          /*!< Current read position in the stream */
     uint8_t *pbuffer;
+    const uint8_t *frame;     /*!< Current frame, points into pbuffer or into a mapped source */
     uint32_t str_size;
     avi_play_state_t state;
     avi_typedef AVI_file;
@@ -74,23 +61,41 @@ static uint32_t _REV(uint32_t value)
            (value & 0x00FF0000U) >> 8 | (value & 0xFF000000U) >> 24;
 }
 
-static uint32_t read_frame(avi_data_t *avi, uint8_t *buffer, uint32_t length, uint32_t *fourcc)
+static size_t stream_read(avi_data_t *avi, void *buffer, size_t length)
 {
-    AVI_CHUNK_HEAD head;
+    size_t got = avi->stream.read(avi->stream.ctx, buffer, length);
+    avi->offset += got;
+    return got;
+}
 
-    if (avi->mode == PLAY_MEMORY) {
-        if (sizeof(AVI_CHUNK_HEAD) > (avi->memory.size - avi->memory.read_offset)) {
-            ESP_LOGE(TAG, "not enough data for chunk head");
-            return 0;
-        }
-        memcpy(&head, avi->memory.data + avi->memory.read_offset, sizeof(AVI_CHUNK_HEAD));
-        avi->memory.read_offset += sizeof(AVI_CHUNK_HEAD);
-    } else if (avi->mode == PLAY_FILE) {
-        fread(&head, sizeof(AVI_CHUNK_HEAD), 1, avi->file.avi_file);
+static esp_err_t stream_seek(avi_data_t *avi, uint32_t offset)
+{
+    if (offset == avi->offset) {
+        return ESP_OK;
+    }
+    esp_err_t ret = avi->stream.seek(avi->stream.ctx, offset);
+    if (ret == ESP_OK) {
+        avi->offset = offset;
     }
+    return ret;
+}
 
-    if (head.FourCC) {
-        /* handle FourCC if needed */
+static void stream_close(avi_data_t *avi)
+{
+    if (avi->stream.close) {
+        avi->stream.close(avi->stream.ctx);
+    }
+    memset(&avi->stream, 0, sizeof(avi->stream));
+}
+
+static uint32_t read_frame(avi_data_t *avi, uint8_t *buffer, uint32_t length, uint32_t *fourcc)
+{
+    AVI_CHUNK_HEAD head;
+
+    if (stream_read(avi, &head, sizeof(AVI_CHUNK_HEAD)) != sizeof(AVI_CHUNK_HEAD)) {
+        ESP_LOGE(TAG, "not enough data for chunk head");
+        *fourcc = 0;
+        return 0;
     }
     *fourcc = head.FourCC;
 
@@ -98,24 +103,38 @@ static uint32_t read_frame(avi_data_t *avi, uint8_t *buffer, uint32_t length, ui
         head.size++;    /*!< add a byte if size is odd */
     }
 
-    if (avi->mode == PLAY_MEMORY) {
-        if (head.size > (avi->memory.size - avi->memory.read_offset) || length < head.size) {
-            ESP_LOGE(TAG, "frame size %"PRIu32" exceeds available data", head.size);
-            return 0;
-        }
-        memcpy(buffer, avi->memory.data + avi->memory.read_offset, head.size);
-        avi->memory.read_offset += head.size;
-    } else if (avi->mode == PLAY_FILE) {
-        if (length < head.size) {
-            ESP_LOGE(TAG, "frame size %"PRIu32" exceeds available data", head.size);
-            return 0;
+    /*!< Mappable sources hand out the chunk in place, no copy and no buffer size limit */
+    if (avi->stream.map) {
+        const uint8_t *p = avi->stream.map(avi->stream.ctx, avi->offset, head.size);
+        if (p != NULL && stream_seek(avi, avi->offset + head.size) == ESP_OK) {
+            avi->frame = p;
+            return head.size;
         }
-        fread(buffer, head.size, 1, avi->file.avi_file);
     }
 
+    if (length < head.size) {
+        ESP_LOGE(TAG, "frame size %"PRIu32" exceeds available data", head.size);
+        return 0;
+    }
+    if (stream_read(avi, buffer, head.size) != head.size) {
+        ESP_LOGE(TAG, "short read on frame of %"PRIu32" bytes", head.size);
+        return 0;
+    }
+    avi->frame = buffer;
     return head.size;
 }
 
+static void get_audio_info(const avi_typedef *avi, audio_frame_info_t *info)
+{
+    info->channel = avi->auds_channels;
+    info->bits_per_sample = avi->auds_bits;
+    info->sample_rate = avi->auds_sample_rate;
+    info->format = avi->auds_format;
+    info->format_tag = avi->auds_format_tag;
+    info->block_align = avi->auds_block_align;
+    info->samples_per_block = avi->auds_samples_per_block;
+}
+
 static esp_err_t avi_player(avi_player_handle_t handle, size_t *BytesRD, uint32_t *Strtype)
 {
     avi_player_t *player = (avi_player_t *)handle;
@@ -124,25 +143,32 @@ static esp_err_t avi_player(avi_player_handle_t handle, size_t *BytesRD, uint32_
 
     switch (player->avi_data.state) {
     case AVI_PARSER_HEADER: {
-        if (player->avi_data.mode == PLAY_MEMORY) {
-            memcpy(player->avi_data.pbuffer, player->avi_data.memory.data, buffer_size);
-            *BytesRD = buffer_size;
-        } else {
-            *BytesRD = fread(player->avi_data.pbuffer, buffer_size, 1, player->avi_data.file.avi_file);
+        avi_data_t *avi = &player->avi_data;
+        uint32_t stream_size = avi->stream.size(avi->stream.ctx);
+        *BytesRD = stream_size < buffer_size ? stream_size : buffer_size;
+        const uint8_t *header = avi->stream.map ? avi->stream.map(avi->stream.ctx, 0, *BytesRD) : NULL;
+        if (header == NULL) {
+            *BytesRD = stream_read(avi, avi->pbuffer, *BytesRD);
+            header = avi->pbuffer;
         }
 
-        ret = avi_parser(&player->avi_data.AVI_file, player->avi_data.pbuffer, *BytesRD);
+        ret = avi_parser(&player->avi_data.AVI_file, header, *BytesRD);
         if (0 > ret) {
             ESP_LOGE(TAG, "parse failed (%d)", ret);
             xEventGroupSetBits(player->event_group, EVENT_STOP_PLAY);
             return ESP_FAIL;
         }
 
-        /*!< Set the video callback */
+        /*!< Set the audio clock, compressed formats by the width they decode to */
         if (player->config.audio_set_clock_cb) {
+            audio_frame_format format = player->avi_data.AVI_file.auds_format;
+            uint32_t bits = player->avi_data.AVI_file.auds_bits;
+            if (format != FORMAT_PCM && format != FORMAT_AUDIO_OTHER) {
+                bits = 16;
+            }
             player->config.audio_set_clock_cb(
                               player->avi_data.AVI_file.auds_sample_rate,
-                              player->avi_data.AVI_file.auds_bits,
+                              bits,
                               player->avi_data.AVI_file.auds_channels,
                               player->config.user_data);
         }
@@ -151,10 +177,10 @@ static esp_err_t avi_player(avi_player_handle_t handle, size_t *BytesRD, uint32_
         ESP_LOGD(TAG, "vids_fps=%d", player->avi_data.AVI_file.vids_fps);
         esp_timer_start_periodic(player->timer_handle, fps_time);
 
-        if (player->avi_data.mode == PLAY_MEMORY) {
-            player->avi_data.memory.read_offset = player->avi_data.AVI_file.movi_start;
-        } else {
-            fseek(player->avi_data.file.avi_file, player->avi_data.AVI_file.movi_start, SEEK_SET);
+        if (stream_seek(avi, player->avi_data.AVI_file.movi_start) != ESP_OK) {
+            ESP_LOGE(TAG, "seek to movi failed");
+            xEventGroupSetBits(player->event_group, EVENT_STOP_PLAY);
+            return ESP_FAIL;
         }
 
         player->avi_data.state = AVI_PARSER_DATA;
@@ -168,7 +194,7 @@ static esp_err_t avi_player(avi_player_handle_t handle, size_t *BytesRD, uint32_
             ESP_LOGD(TAG, "type=%"PRIu32", size=%"PRIu32"", *Strtype, player->avi_data.str_size);
             *BytesRD += player->avi_data.str_size + 8;
 
-            if (*BytesRD >= player->avi_data.AVI_file.movi_size) {
+            if (*BytesRD >= player->avi_data.AVI_file.movi_size || player->avi_data.str_size == 0) {
                 ESP_LOGI(TAG, "play end");
                 player->avi_data.state = AVI_PARSER_END;
                 xEventGroupSetBits(player->event_group, EVENT_STOP_PLAY);
@@ -179,7 +205,7 @@ static esp_err_t avi_player(avi_player_handle_t handle, size_t *BytesRD, uint32_
                 int64_t fr_end = esp_timer_get_time();
                 if (player->config.video_cb) {
                     frame_data_t data = {
-                        .data = player->avi_data.pbuffer,
+                        .data = (uint8_t *)player->avi_data.frame,
                         .data_bytes = player->avi_data.str_size,
                         .type = FRAME_TYPE_VIDEO,
                         .video_info.width = player->avi_data.AVI_file.vids_width,
@@ -191,17 +217,14 @@ static esp_err_t avi_player(avi_player_handle_t handle, size_t *BytesRD, uint32_
                 xEventGroupSetBits(player->event_group, EVENT_VIDEO_BUF_READY);
                 ESP_LOGD(TAG, "Draw %"PRIu32"ms", (uint32_t)((esp_timer_get_time() - fr_end) / 1000));
                 break;
-            } else if ((*Strtype & 0xFFFF0000) == WB_ID) { // Audio output
+            } else if ((*Strtype & 0xFFFF0000) == WB_ID || (*Strtype & 0xFFFF0000) == WC_ID) { // Audio output
                 if (player->config.audio_cb) {
                     frame_data_t data = {
-                        .data = player->avi_data.pbuffer,
+                        .data = (uint8_t *)player->avi_data.frame,
                         .data_bytes = player->avi_data.str_size,
                         .type = FRAME_TYPE_AUDIO,
-                        .audio_info.channel = player->avi_data.AVI_file.auds_channels,
-                        .audio_info.bits_per_sample = player->avi_data.AVI_file.auds_bits,
-                        .audio_info.sample_rate = player->avi_data.AVI_file.auds_sample_rate,
-                        .audio_info.format = FORMAT_PCM,
                     };
+                    get_audio_info(&player->avi_data.AVI_file, &data.audio_info);
                     player->config.audio_cb(&data, player->config.user_data);
                 }
                 xEventGroupSetBits(player->event_group, EVENT_AUDIO_BUF_READY);
@@ -215,9 +238,7 @@ static esp_err_t avi_player(avi_player_handle_t handle, size_t *BytesRD, uint32_
     }
     case AVI_PARSER_END:
         esp_timer_stop(player->timer_handle);
-        if (player->avi_data.mode == PLAY_FILE) {
-            fclose(player->avi_data.file.avi_file);
-        }
+        stream_close(&player->avi_data);
 
         player->avi_data.state = AVI_PARSER_NONE;
         if (player->config.avi_play_end_cb) {
@@ -295,7 +316,7 @@ esp_err_t avi_player_get_video_buffer(avi_player_handle_t handle, void **buffer,
         return ESP_ERR_NO_MEM;
     }
 
-    memcpy(*buffer, player->avi_data.pbuffer, player->avi_data.str_size);
+    memcpy(*buffer, player->avi_data.frame, player->avi_data.str_size);
     *buffer_size = player->avi_data.str_size;
     info->width = player->avi_data.AVI_file.vids_width;
     info->height = player->avi_data.AVI_file.vids_height;
@@ -321,40 +342,54 @@ esp_err_t avi_player_get_audio_buffer(avi_player_handle_t handle, void **buffer,
         return ESP_ERR_NO_MEM;
     }
 
-    memcpy(*buffer, player->avi_data.pbuffer, player->avi_data.str_size);
+    memcpy(*buffer, player->avi_data.frame, player->avi_data.str_size);
     *buffer_size = player->avi_data.str_size;
-    info->channel = player->avi_data.AVI_file.auds_channels;
-    info->bits_per_sample = player->avi_data.AVI_file.auds_bits;
-    info->sample_rate = player->avi_data.AVI_file.auds_sample_rate;
-    info->format = FORMAT_PCM;
+    get_audio_info(&player->avi_data.AVI_file, info);
     return ESP_OK;
 }
 
-esp_err_t avi_player_play_from_memory(avi_player_handle_t handle, uint8_t *avi_data, size_t avi_size)
+esp_err_t avi_player_play_from_stream(avi_player_handle_t handle, const avi_stream_t *stream)
 {
     avi_player_t *player = (avi_player_t *)handle;
+    ESP_RETURN_ON_FALSE(stream != NULL && stream->read != NULL && stream->seek != NULL && stream->size != NULL,
+                        ESP_ERR_INVALID_ARG, TAG, "stream must provide read, seek and size");
     ESP_RETURN_ON_FALSE(player->avi_data.state == AVI_PARSER_NONE, ESP_ERR_INVALID_STATE, TAG, "AVI player not ready");
-    player->avi_data.mode = PLAY_MEMORY;
-    player->avi_data.memory.data = avi_data;
-    player->avi_data.memory.size = avi_size;
-    player->avi_data.memory.read_offset = 0;
+
+    player->avi_data.stream = *stream;
+    player->avi_data.offset = 0;
+    player->avi_data.frame = player->avi_data.pbuffer;
     xEventGroupSetBits(player->event_group, EVENT_START_PLAY);
     return ESP_OK;
 }
 
+esp_err_t avi_player_play_from_memory(avi_player_handle_t handle, uint8_t *avi_data, size_t avi_size)
+{
+    avi_player_t *player = (avi_player_t *)handle;
+    ESP_RETURN_ON_FALSE(player->avi_data.state == AVI_PARSER_NONE, ESP_ERR_INVALID_STATE, TAG, "AVI player not ready");
+
+    avi_stream_t stream;
+    ESP_RETURN_ON_ERROR(avi_stream_open_memory(avi_data, avi_size, &stream), TAG, "open memory stream failed");
+    esp_err_t ret = avi_player_play_from_stream(handle, &stream);
+    if (ret != ESP_OK) {
+        stream.close(stream.ctx);
+    }
+    return ret;
+}
+
 esp_err_t  avi_player_play_from_file(avi_player_handle_t handle, const char *filename)
 {
     avi_player_t *player = (avi_player_t *)handle;
     ESP_RETURN_ON_FALSE(player->avi_data.state == AVI_PARSER_NONE, ESP_ERR_INVALID_STATE, TAG, "AVI player not ready");
 
-    player->avi_data.mode = PLAY_FILE;
-    player->avi_data.file.avi_file = fopen(filename, "rb");
-    if (player->avi_data.file.avi_file == NULL) {
-        ESP_LOGE(TAG, "Cannot open %s", filename);
+    avi_stream_t stream;
+    if (avi_stream_open_file(filename, 0, &stream) != ESP_OK) {
         return ESP_FAIL;
     }
-    xEventGroupSetBits(player->event_group, EVENT_START_PLAY);
-    return ESP_OK;
+    esp_err_t ret = avi_player_play_from_stream(handle, &stream);
+    if (ret != ESP_OK) {
+        stream.close(stream.ctx);
+    }
+    return ret;
 }
 
 esp_err_t avi_player_play_stop(avi_player_handle_t handle)
@@ -433,6 +468,9 @@ esp_err_t avi_player_deinit(avi_player_handle_t handle)
         esp_timer_delete(player->timer_handle);
     }
 
+    /*!< Deinit while playing leaves the source open */
+    stream_close(&player->avi_data);
+
     if (player->avi_data.pbuffer != NULL) {
         free(player->avi_data.pbuffer);
     }
@@ -0,0 +1,426 @@
+/*
+ * SPDX-FileCopyrightText: 2025 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <string.h>
+#include <inttypes.h>
+#include <stdatomic.h>
+#include <sys/stat.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/stream_buffer.h"
+#include "esp_log.h"
+#include "esp_check.h"
+#include "esp_heap_caps.h"
+#include "esp_idf_version.h"
+#include "esp_partition.h"
+
+#include "avi_def.h"
+#include "avi_stream.h"
+
+static const char *TAG = "avi stream";
+
+#if ESP_IDF_VERSION < ESP_IDF_VERSION_VAL(5, 0, 0)
+#define esp_partition_mmap_handle_t spi_flash_mmap_handle_t
+#define ESP_PARTITION_MMAP_DATA     SPI_FLASH_MMAP_DATA
+#define esp_partition_munmap        spi_flash_munmap
+#endif
+
+/* ------------------------------------------------------------------ file */
+
+typedef struct {
+    FILE *fp;
+    uint8_t *io_buffer;
+    uint32_t size;
+} file_source_t;
+
+static size_t file_read(void *ctx, void *buf, size_t len)
+{
+    file_source_t *src = (file_source_t *)ctx;
+    return fread(buf, 1, len, src->fp);
+}
+
+static esp_err_t file_seek(void *ctx, uint32_t offset)
+{
+    file_source_t *src = (file_source_t *)ctx;
+    return fseek(src->fp, offset, SEEK_SET) == 0 ? ESP_OK : ESP_FAIL;
+}
+
+static uint32_t file_size(void *ctx)
+{
+    file_source_t *src = (file_source_t *)ctx;
+    return src->size;
+}
+
+static void file_close(void *ctx)
+{
+    file_source_t *src = (file_source_t *)ctx;
+    fclose(src->fp);
+    free(src->io_buffer);
+    free(src);
+}
+
+esp_err_t avi_stream_open_file(const char *filename, size_t io_buffer_size, avi_stream_t *stream)
+{
+    ESP_RETURN_ON_FALSE(filename != NULL && stream != NULL, ESP_ERR_INVALID_ARG, TAG, "invalid argument");
+
+    file_source_t *src = (file_source_t *)calloc(1, sizeof(file_source_t));
+    ESP_RETURN_ON_FALSE(src != NULL, ESP_ERR_NO_MEM, TAG, "Cannot alloc file source");
+
+    src->fp = fopen(filename, "rb");
+    if (src->fp == NULL) {
+        ESP_LOGE(TAG, "Cannot open %s", filename);
+        free(src);
+        return ESP_ERR_NOT_FOUND;
+    }
+
+    if (io_buffer_size > 0) {
+        /*!< Must be set before the first read; chunk heads are 8 bytes so a larger buffer saves most small reads */
+        src->io_buffer = heap_caps_malloc(io_buffer_size, MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
+        if (src->io_buffer == NULL || setvbuf(src->fp, (char *)src->io_buffer, _IOFBF, io_buffer_size) != 0) {
+            ESP_LOGW(TAG, "Cannot set io buffer of %u bytes, using default", (unsigned)io_buffer_size);
+            free(src->io_buffer);
+            src->io_buffer = NULL;
+        }
+    }
+
+    struct stat st;
+    if (fstat(fileno(src->fp), &st) == 0) {
+        src->size = (uint32_t)st.st_size;
+    } else {
+        fseek(src->fp, 0, SEEK_END);
+        src->size = (uint32_t)ftell(src->fp);
+        fseek(src->fp, 0, SEEK_SET);
+    }
+
+    *stream = (avi_stream_t) {
+        .read = file_read,
+        .seek = file_seek,
+        .size = file_size,
+        .close = file_close,
+        .ctx = src,
+    };
+    return ESP_OK;
+}
+
+/* ---------------------------------------------------------------- memory */
+
+typedef struct {
+    const uint8_t *data;
+    uint32_t size;
+    uint32_t offset;
+    void *owned;                               /*!< Freed on close, NULL for borrowed data */
+    esp_partition_mmap_handle_t mmap_handle;   /*!< Unmapped on close when mapped is set */
+    bool mapped;
+} memory_source_t;
+
+static size_t memory_read(void *ctx, void *buf, size_t len)
+{
+    memory_source_t *src = (memory_source_t *)ctx;
+    size_t left = src->size - src->offset;
+    if (len > left) {
+        len = left;
+    }
+    memcpy(buf, src->data + src->offset, len);
+    src->offset += len;
+    return len;
+}
+
+static esp_err_t memory_seek(void *ctx, uint32_t offset)
+{
+    memory_source_t *src = (memory_source_t *)ctx;
+    if (offset > src->size) {
+        return ESP_ERR_INVALID_SIZE;
+    }
+    src->offset = offset;
+    return ESP_OK;
+}
+
+static uint32_t memory_size(void *ctx)
+{
+    memory_source_t *src = (memory_source_t *)ctx;
+    return src->size;
+}
+
+static const uint8_t *memory_map(void *ctx, uint32_t offset, size_t len)
+{
+    memory_source_t *src = (memory_source_t *)ctx;
+    if (offset > src->size || len > src->size - offset) {
+        return NULL;
+    }
+    return src->data + offset;
+}
+
+static void memory_close(void *ctx)
+{
+    memory_source_t *src = (memory_source_t *)ctx;
+    if (src->mapped) {
+        esp_partition_munmap(src->mmap_handle);
+    }
+    if (src->owned) {
+        heap_caps_free(src->owned);
+    }
+    free(src);
+}
+
+static void memory_fill_stream(memory_source_t *src, avi_stream_t *stream)
+{
+    *stream = (avi_stream_t) {
+        .read = memory_read,
+        .seek = memory_seek,
+        .size = memory_size,
+        .map = memory_map,
+        .close = memory_close,
+        .ctx = src,
+    };
+}
+
+esp_err_t avi_stream_open_memory(const uint8_t *data, size_t size, avi_stream_t *stream)
+{
+    ESP_RETURN_ON_FALSE(data != NULL && stream != NULL, ESP_ERR_INVALID_ARG, TAG, "invalid argument");
+
+    memory_source_t *src = (memory_source_t *)calloc(1, sizeof(memory_source_t));
+    ESP_RETURN_ON_FALSE(src != NULL, ESP_ERR_NO_MEM, TAG, "Cannot alloc memory source");
+    src->data = data;
+    src->size = (uint32_t)size;
+    memory_fill_stream(src, stream);
+    return ESP_OK;
+}
+
+esp_err_t avi_stream_open_psram(const char *filename, avi_stream_t *stream)
+{
+    ESP_RETURN_ON_FALSE(filename != NULL && stream != NULL, ESP_ERR_INVALID_ARG, TAG, "invalid argument");
+
+    FILE *fp = fopen(filename, "rb");
+    if (fp == NULL) {
+        ESP_LOGE(TAG, "Cannot open %s", filename);
+        return ESP_ERR_NOT_FOUND;
+    }
+
+    struct stat st;
+    if (fstat(fileno(fp), &st) != 0 || st.st_size <= 0) {
+        fclose(fp);
+        return ESP_FAIL;
+    }
+
+    uint8_t *clip = heap_caps_malloc(st.st_size, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+    if (clip == NULL) {
+        ESP_LOGE(TAG, "Cannot alloc %ld bytes of PSRAM for %s", (long)st.st_size, filename);
+        fclose(fp);
+        return ESP_ERR_NO_MEM;
+    }
+
+    size_t got = fread(clip, 1, st.st_size, fp);
+    fclose(fp);
+    if (got != (size_t)st.st_size) {
+        ESP_LOGE(TAG, "Short read %u/%ld on %s", (unsigned)got, (long)st.st_size, filename);
+        heap_caps_free(clip);
+        return ESP_FAIL;
+    }
+
+    memory_source_t *src = (memory_source_t *)calloc(1, sizeof(memory_source_t));
+    if (src == NULL) {
+        heap_caps_free(clip);
+        return ESP_ERR_NO_MEM;
+    }
+    src->data = clip;
+    src->size = (uint32_t)got;
+    src->owned = clip;
+    memory_fill_stream(src, stream);
+    return ESP_OK;
+}
+
+esp_err_t avi_stream_open_partition(const char *label, avi_stream_t *stream)
+{
+    ESP_RETURN_ON_FALSE(label != NULL && stream != NULL, ESP_ERR_INVALID_ARG, TAG, "invalid argument");
+
+    const esp_partition_t *part = esp_partition_find_first(ESP_PARTITION_TYPE_DATA, ESP_PARTITION_SUBTYPE_ANY, label);
+    ESP_RETURN_ON_FALSE(part != NULL, ESP_ERR_NOT_FOUND, TAG, "partition %s not found", label);
+
+    const void *ptr = NULL;
+    esp_partition_mmap_handle_t handle;
+    esp_err_t ret = esp_partition_mmap(part, 0, part->size, ESP_PARTITION_MMAP_DATA, &ptr, &handle);
+    ESP_RETURN_ON_ERROR(ret, TAG, "mmap partition %s failed", label);
+
+    /*!< The partition is usually larger than the clip, trust the RIFF size instead */
+    const AVI_LIST_HEAD *riff = (const AVI_LIST_HEAD *)ptr;
+    if (memcmp(&riff->List, "RIFF", 4) != 0 || riff->size + 8 > part->size) {
+        ESP_LOGE(TAG, "partition %s does not hold an AVI file", label);
+        esp_partition_munmap(handle);
+        return ESP_ERR_INVALID_SIZE;
+    }
+
+    memory_source_t *src = (memory_source_t *)calloc(1, sizeof(memory_source_t));
+    if (src == NULL) {
+        esp_partition_munmap(handle);
+        return ESP_ERR_NO_MEM;
+    }
+    src->data = (const uint8_t *)ptr;
+    src->size = riff->size + 8;
+    src->mmap_handle = handle;
+    src->mapped = true;
+    memory_fill_stream(src, stream);
+    ESP_LOGI(TAG, "partition %s mapped, clip %"PRIu32" bytes", label, src->size);
+    return ESP_OK;
+}
+
+/* -------------------------------------------------------------- loopback */
+
+struct avi_loopback_t {
+    StreamBufferHandle_t sb;
+    uint8_t *history;
+    size_t history_size;
+    uint32_t received;          /*!< Bytes taken out of the stream buffer so far */
+    uint32_t offset;
+    uint32_t size;
+    TickType_t read_timeout;
+    atomic_bool closed;         /*!< Set by the player side, makes further writes return 0 */
+    atomic_int refs;            /*!< Player and producer, freed when both are gone */
+};
+
+static void loopback_unref(struct avi_loopback_t *src)
+{
+    if (atomic_fetch_sub(&src->refs, 1) != 1) {
+        return;
+    }
+    vStreamBufferDelete(src->sb);
+    free(src->history);
+    free(src);
+}
+
+static size_t loopback_pull(struct avi_loopback_t *src, uint8_t *buf, size_t len)
+{
+    size_t got = 0;
+    while (got < len && src->received < src->size) {
+        size_t n = xStreamBufferReceive(src->sb, buf + got, len - got, src->read_timeout);
+        if (n == 0) {
+            ESP_LOGW(TAG, "loopback starved at %"PRIu32"/%"PRIu32, src->received, src->size);
+            break;
+        }
+        if (src->received < src->history_size) {
+            size_t keep = src->history_size - src->received;
+            memcpy(src->history + src->received, buf + got, n < keep ? n : keep);
+        }
+        src->received += n;
+        got += n;
+    }
+    return got;
+}
+
+static size_t loopback_read(void *ctx, void *buf, size_t len)
+{
+    struct avi_loopback_t *src = (struct avi_loopback_t *)ctx;
+    size_t got = 0;
+    if (src->offset < src->received) {
+        /*!< Replay from history, loopback_seek only lets the offset back in while it is inside */
+        uint32_t kept = src->received < src->history_size ? src->received : src->history_size;
+        got = kept - src->offset;
+        got = got < len ? got : len;
+        memcpy(buf, src->history + src->offset, got);
+        src->offset += got;
+        if (src->offset < src->received) {
+            if (got < len) {
+                ESP_LOGE(TAG, "loopback read past history at %"PRIu32, src->offset);
+            }
+            return got;
+        }
+    }
+    size_t n = loopback_pull(src, (uint8_t *)buf + got, len - got);
+    src->offset += n;
+    return got + n;
+}
+
+static esp_err_t loopback_seek(void *ctx, uint32_t offset)
+{
+    struct avi_loopback_t *src = (struct avi_loopback_t *)ctx;
+    if (offset < src->received) {
+        ESP_RETURN_ON_FALSE(offset < src->history_size, ESP_ERR_NOT_SUPPORTED, TAG,
+                            "loopback cannot rewind to %"PRIu32, offset);
+        src->offset = offset;
+        return ESP_OK;
+    }
+
+    /*!< Forward seeks drop data, the stream cannot be skipped any other way */
+    uint8_t skip[256];
+    src->offset = src->received;
+    while (src->offset < offset) {
+        size_t want = offset - src->offset;
+        if (loopback_read(ctx, skip, want < sizeof(skip) ? want : sizeof(skip)) == 0) {
+            return ESP_FAIL;
+        }
+    }
+    return ESP_OK;
+}
+
+static uint32_t loopback_size(void *ctx)
+{
+    struct avi_loopback_t *src = (struct avi_loopback_t *)ctx;
+    return src->size;
+}
+
+static void loopback_close(void *ctx)
+{
+    struct avi_loopback_t *src = (struct avi_loopback_t *)ctx;
+    atomic_store(&src->closed, true);
+    loopback_unref(src);
+}
+
+esp_err_t avi_stream_open_loopback(const avi_loopback_config_t *config, avi_stream_t *stream, avi_loopback_handle_t *loopback)
+{
+    ESP_RETURN_ON_FALSE(config != NULL && stream != NULL && loopback != NULL, ESP_ERR_INVALID_ARG, TAG, "invalid argument");
+    ESP_RETURN_ON_FALSE(config->size > 0 && config->buffer_size > 0 && config->history_size > 0,
+                        ESP_ERR_INVALID_ARG, TAG, "loopback sizes must not be 0");
+
+    esp_err_t ret = ESP_OK;
+    struct avi_loopback_t *src = (struct avi_loopback_t *)calloc(1, sizeof(struct avi_loopback_t));
+    ESP_RETURN_ON_FALSE(src != NULL, ESP_ERR_NO_MEM, TAG, "Cannot alloc loopback source");
+
+    src->history = malloc(config->history_size);
+    ESP_GOTO_ON_FALSE(src->history != NULL, ESP_ERR_NO_MEM, err, TAG, "Cannot alloc loopback history");
+    src->sb = xStreamBufferCreate(config->buffer_size, 1);
+    ESP_GOTO_ON_FALSE(src->sb != NULL, ESP_ERR_NO_MEM, err, TAG, "Cannot create loopback stream buffer");
+
+    src->history_size = config->history_size;
+    src->size = config->size;
+    src->read_timeout = pdMS_TO_TICKS(config->read_timeout_ms);
+    atomic_init(&src->closed, false);
+    atomic_init(&src->refs, 2);
+
+    *stream = (avi_stream_t) {
+        .read = loopback_read,
+        .seek = loopback_seek,
+        .size = loopback_size,
+        .close = loopback_close,
+        .ctx = src,
+    };
+    *loopback = src;
+    return ESP_OK;
+
+err:
+    free(src->history);
+    free(src);
+    return ret;
+}
+
+size_t avi_stream_loopback_write(avi_loopback_handle_t loopback, const void *data, size_t len, uint32_t timeout_ms)
+{
+    if (loopback == NULL || atomic_load(&loopback->closed)) {
+        return 0;
+    }
+    return xStreamBufferSend(loopback->sb, data, len, pdMS_TO_TICKS(timeout_ms));
+}
+
+bool avi_stream_loopback_closed(avi_loopback_handle_t loopback)
+{
+    return loopback == NULL || atomic_load(&loopback->closed);
+}
+
+void avi_stream_loopback_release(avi_loopback_handle_t loopback)
+{
+    if (loopback) {
+        loopback_unref(loopback);
+    }
+}
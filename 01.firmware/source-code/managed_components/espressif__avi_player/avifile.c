@@ -4,8 +4,10 @@
  * SPDX-License-Identifier: Apache-2.0
  */
 #include <stdio.h>
+#include <stddef.h>
 #include <string.h>
 #include <inttypes.h>
+#include <sys/param.h>
 #include "esp_log.h"
 #include "avifile.h"
 
@@ -123,24 +125,50 @@ static int strl_parser(avi_typedef *AVI_file, const uint8_t *buffer, uint32_t le
     } else if (AUDS_ID == strh->fourcc_type) {
         ESP_LOGI(TAG, "Find a audio stream");
         AVI_AUDS_STRF_CHUNK *strf = (AVI_AUDS_STRF_CHUNK*)pdata;
-        if (strf->FourCC != STRF_ID || (strf->size + 8 != sizeof(AVI_AUDS_STRF_CHUNK) && strf->size + 10 != sizeof(AVI_AUDS_STRF_CHUNK))) {
+        /*!< WAVEFORMAT (16 bytes) or WAVEFORMATEX with cb_size bytes of format specific data */
+        if (strf->FourCC != STRF_ID || strf->size + 8 < offsetof(AVI_AUDS_STRF_CHUNK, cb_size)) {
             ESP_LOGE(TAG, "FourCC=0x%"PRIx32"|%"PRIx32", size=%"PRIu32"|%d", strf->FourCC, STRF_ID, strf->size, sizeof(AVI_AUDS_STRF_CHUNK));
             return -5;
         }
+        const uint8_t *extra = pdata + sizeof(AVI_AUDS_STRF_CHUNK);
+        uint16_t cb_size = 0;
+        if (strf->size + 8 >= sizeof(AVI_AUDS_STRF_CHUNK)) {
+            cb_size = MIN(strf->cb_size, strf->size + 8 - sizeof(AVI_AUDS_STRF_CHUNK));
+        }
+        uint16_t format_tag = strf->format_tag;
+        if (format_tag == WAVE_FORMAT_EXTENSIBLE && cb_size >= 22) {
+            format_tag = extra[6] | (extra[7] << 8); /*!< first two bytes of the sub-format GUID */
+        }
 #ifdef CONFIG_AVI_PLAYER_DEBUG_INFO
         printf("-----audio strf info------\r\n");
         printf("strf data block info(audio stream):");
-        printf("format tag:%d\r\n", strf->format_tag);
+        printf("format tag:%d\r\n", format_tag);
         printf("number of channels:%d\r\n", strf->channels);
         printf("sampling rate:%"PRIu32"\r\n", strf->samples_per_sec);
         printf("bitrate:%"PRIu32"\r\n", strf->avg_bytes_per_sec);
         printf("block align:%d\r\n", strf->block_align);
-        printf("sample size:%"PRIu32"\r\n\n", strf->bits_per_sample);
+        printf("sample size:%d\r\n\n", strf->bits_per_sample);
 #endif
         AVI_file->auds_channels = strf->channels;
         AVI_file->auds_sample_rate = strf->samples_per_sec;
         AVI_file->auds_bits = strf->bits_per_sample;
-        pdata += sizeof(AVI_AUDS_STRF_CHUNK);
+        AVI_file->auds_format_tag = format_tag;
+        AVI_file->auds_block_align = strf->block_align;
+        /*!< IMA and MS ADPCM keep wSamplesPerBlock first */
+        AVI_file->auds_samples_per_block = (cb_size >= 2) ? (extra[0] | (extra[1] << 8)) : 0;
+        switch (format_tag) {
+        case WAVE_FORMAT_PCM:        AVI_file->auds_format = FORMAT_PCM;       break;
+        case WAVE_FORMAT_ADPCM:      AVI_file->auds_format = FORMAT_ADPCM_MS;  break;
+        case WAVE_FORMAT_ALAW:       AVI_file->auds_format = FORMAT_ALAW;      break;
+        case WAVE_FORMAT_MULAW:      AVI_file->auds_format = FORMAT_MULAW;     break;
+        case WAVE_FORMAT_IMA_ADPCM:  AVI_file->auds_format = FORMAT_ADPCM_IMA; break;
+        case WAVE_FORMAT_MPEGLAYER3: AVI_file->auds_format = FORMAT_MP3;       break;
+        default:
+            AVI_file->auds_format = FORMAT_AUDIO_OTHER;
+            ESP_LOGW(TAG, "audio format 0x%x is passed on undecoded", format_tag);
+            break;
+        }
+        pdata += strf->size + 8;
     } else {
         ESP_LOGW(TAG, "Unsupported stream 0x%"PRIu32"", strh->fourcc_type);
     }
@@ -85,6 +85,15 @@ typedef struct {
     uint32_t imp_colors;         /*!< Unclear meaning, set to 0 */
 } __attribute__((packed)) AVI_VIDS_STRF_CHUNK;
 
+/*!< Format tags of audio streams */
+#define WAVE_FORMAT_PCM         0x0001
+#define WAVE_FORMAT_ADPCM       0x0002  /*!< Microsoft ADPCM */
+#define WAVE_FORMAT_ALAW        0x0006
+#define WAVE_FORMAT_MULAW       0x0007
+#define WAVE_FORMAT_IMA_ADPCM   0x0011
+#define WAVE_FORMAT_MPEGLAYER3  0x0055
+#define WAVE_FORMAT_EXTENSIBLE  0xFFFE
+
 /*!< For audio streams, the strf block structure is as follows */
 typedef struct __attribute__((packed))
 {
@@ -95,7 +104,8 @@ typedef struct __attribute__((packed))
     uint32_t samples_per_sec;
     uint32_t avg_bytes_per_sec;
     uint16_t block_align;
-    uint32_t bits_per_sample;
+    uint16_t bits_per_sample;
+    uint16_t cb_size;            /*!< Bytes of format specific data that follow, absent when size is 16 */
 } __attribute__((packed))  AVI_AUDS_STRF_CHUNK;
 
 typedef struct {
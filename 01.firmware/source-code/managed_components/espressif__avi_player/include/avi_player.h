@@ -9,6 +9,7 @@
 #include "esp_err.h"
 #include "freertos/FreeRTOS.h"
 #include "esp_idf_version.h"
+#include "avi_stream.h"
 
 #ifdef __cplusplus
 extern "C" {
@@ -39,6 +40,12 @@ typedef struct {
  */
 typedef enum  {
     FORMAT_PCM = 0,
+    FORMAT_ADPCM_IMA,               /*!< IMA ADPCM (0x11), whole blocks of block_align bytes */
+    FORMAT_ADPCM_MS,                /*!< Microsoft ADPCM (0x02), whole blocks of block_align bytes */
+    FORMAT_ALAW,                    /*!< G.711 A-law (0x06), 8 bit */
+    FORMAT_MULAW,                   /*!< G.711 mu-law (0x07), 8 bit */
+    FORMAT_MP3,                     /*!< MPEG layer 3 (0x55), chunks are not aligned to mp3 frames */
+    FORMAT_AUDIO_OTHER,             /*!< Anything else, see format_tag */
 } audio_frame_format;
 
 /**
@@ -47,9 +54,12 @@ typedef enum  {
  */
 typedef struct {
     uint8_t channel;                /*!< Audio output channel */
-    uint8_t bits_per_sample;        /*!< Audio bits per sample */
+    uint8_t bits_per_sample;        /*!< Audio bits per sample as stored, 4 for ADPCM */
     uint32_t sample_rate;           /*!< Audio sample rate */
     audio_frame_format format;      /*!< Audio format */
+    uint16_t format_tag;            /*!< WAVEFORMATEX format tag of the stream */
+    uint16_t block_align;           /*!< Bytes per block (ADPCM) or per frame */
+    uint16_t samples_per_block;     /*!< Frames per ADPCM block from the stream header, 0 if not given */
 } audio_frame_info_t;
 
 /**
@@ -94,7 +104,7 @@ typedef struct {
     size_t buffer_size;                      /*!< Internal buffer size */
     video_write_cb video_cb;                 /*!< Video frame callback */
     audio_write_cb audio_cb;                 /*!< Audio frame callback */
-    audio_set_clock_cb audio_set_clock_cb;   /*!< Audio set clock callback */
+    audio_set_clock_cb audio_set_clock_cb;   /*!< Audio set clock callback, 16 bits for ADPCM, G.711 and MP3 (decoded width) */
     avi_play_end_cb avi_play_end_cb;         /*!< AVI play end callback */
     UBaseType_t priority;                    /*!< FreeRTOS task priority */
     BaseType_t coreID;                       /*!< ESP32 core ID */
@@ -105,6 +115,22 @@ typedef struct {
 #endif
 } avi_player_config_t;
 
+/**
+ * @brief Plays an AVI file from a byte-stream source. The buffer of the AVI will be passed through the set callback function.
+ *
+ * On success the player owns the stream and closes it when playback ends or is stopped.
+ * Sources that provide `map` deliver frames without copying them into the internal buffer,
+ * so `buffer_size` only has to cover the AVI header.
+ *
+ * @param[in] handle AVI player handle
+ * @param[in] stream Source to read from, see avi_stream.h for the built-in ones
+ * @return
+ *      - ESP_OK: Success
+ *      - ESP_ERR_INVALID_ARG: Stream lacks read, seek or size
+ *      - ESP_ERR_INVALID_STATE: AVI player is already playing
+ */
+esp_err_t avi_player_play_from_stream(avi_player_handle_t handle, const avi_stream_t *stream);
+
 /**
  * @brief Plays an AVI file from memory. The buffer of the AVI will be passed through the set callback function.
  *
@@ -162,6 +188,29 @@ esp_err_t avi_player_get_video_buffer(avi_player_handle_t handle, void **buffer,
  */
 esp_err_t avi_player_get_audio_buffer(avi_player_handle_t handle, void **buffer, size_t *buffer_size, audio_frame_info_t *info, TickType_t ticks_to_wait);
 
+/**
+ * @brief Read one key frame out of an AVI stream without playing it, e.g. for poster thumbnails
+ *
+ * The idx1 index is used when present so only the header, the index entries up to the wanted
+ * frame and the frame itself are read. Without an index the `movi` list is walked chunk head by
+ * chunk head, payloads are skipped with seeks. The stream is left open.
+ *
+ * @param[in] stream Source to read from
+ * @param[in] key_index 0 for the first key frame
+ * @param[out] buffer Buffer to hold the frame
+ * @param[in,out] buffer_size Size of buffer, set to the frame size on return
+ * @param[out] info Optional video info from the stream header
+ *
+ * @return
+ *      - ESP_OK: Success
+ *      - ESP_ERR_INVALID_ARG: NULL arguments or key_index past the end
+ *      - ESP_ERR_INVALID_RESPONSE: Not a valid AVI header
+ *      - ESP_ERR_NO_MEM: buffer too small, buffer_size holds the needed size
+ *      - ESP_FAIL: Read error
+ */
+esp_err_t avi_player_read_key_frame(const avi_stream_t *stream, uint32_t key_index, uint8_t *buffer,
+                                    size_t *buffer_size, video_frame_info_t *info);
+
 /**
  * @brief Stop AVI player
  *
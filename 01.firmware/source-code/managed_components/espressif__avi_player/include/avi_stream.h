@@ -0,0 +1,172 @@
+/*
+ * SPDX-FileCopyrightText: 2025 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+#ifndef __AVI_STREAM_H
+#define __AVI_STREAM_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include "esp_err.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Byte-stream source the AVI player reads from
+ *
+ * The player calls `read`, `seek` and `size`, plus `map` when it is provided; `map` and `close`
+ * are optional. When `map` is provided the player parses headers and hands frames to the callbacks
+ * straight from the returned pointer, so memory and flash sources never copy frame data.
+ *
+ * Ownership of the stream passes to the player on a successful `avi_player_play_from_stream()`,
+ * `close` is called once playback ends or is stopped.
+ */
+typedef struct {
+    size_t (*read)(void *ctx, void *buf, size_t len);                   /*!< Read up to len bytes at the current position, return bytes read */
+    esp_err_t (*seek)(void *ctx, uint32_t offset);                      /*!< Move the read position to an absolute offset */
+    uint32_t (*size)(void *ctx);                                        /*!< Total size of the stream in bytes */
+    const uint8_t *(*map)(void *ctx, uint32_t offset, size_t len);      /*!< Optional: pointer to len bytes at offset, NULL if not mappable */
+    void (*close)(void *ctx);                                           /*!< Optional: release the source */
+    void *ctx;                                                          /*!< Source private context */
+} avi_stream_t;
+
+/**
+ * @brief Handle of a loopback source, used by the producer side to push data
+ */
+typedef struct avi_loopback_t *avi_loopback_handle_t;
+
+/**
+ * @brief Configuration of a loopback source
+ */
+typedef struct {
+    uint32_t size;              /*!< Total size of the clip that will be written */
+    size_t buffer_size;         /*!< Size of the stream buffer between producer and player */
+    size_t history_size;        /*!< Bytes kept from the start of the clip so the player can rewind into the header */
+    uint32_t read_timeout_ms;   /*!< How long a read waits for the producer before returning short */
+} avi_loopback_config_t;
+
+/**
+ * @brief Open a buffered file source
+ *
+ * @param[in] filename Path to the AVI file
+ * @param[in] io_buffer_size stdio buffer size, 0 keeps the libc default
+ * @param[out] stream Stream to fill
+ *
+ * @return
+ *      - ESP_OK: Success
+ *      - ESP_ERR_INVALID_ARG: NULL arguments
+ *      - ESP_ERR_NOT_FOUND: File cannot be opened
+ *      - ESP_ERR_NO_MEM: Cannot allocate context or buffer
+ */
+esp_err_t avi_stream_open_file(const char *filename, size_t io_buffer_size, avi_stream_t *stream);
+
+/**
+ * @brief Open a source over a clip that already lives in memory (internal RAM, PSRAM or mapped flash)
+ *
+ * The data is not copied and must stay valid until the stream is closed.
+ *
+ * @param[in] data Pointer to the AVI data
+ * @param[in] size Size of the AVI data in bytes
+ * @param[out] stream Stream to fill
+ *
+ * @return
+ *      - ESP_OK: Success
+ *      - ESP_ERR_INVALID_ARG: NULL arguments
+ *      - ESP_ERR_NO_MEM: Cannot allocate context
+ */
+esp_err_t avi_stream_open_memory(const uint8_t *data, size_t size, avi_stream_t *stream);
+
+/**
+ * @brief Load a whole file into PSRAM and open a memory source over it
+ *
+ * Meant for short looping clips: after the first load the clip plays with no further SD traffic.
+ * The PSRAM copy is freed when the stream is closed.
+ *
+ * @param[in] filename Path to the AVI file
+ * @param[out] stream Stream to fill
+ *
+ * @return
+ *      - ESP_OK: Success
+ *      - ESP_ERR_INVALID_ARG: NULL arguments
+ *      - ESP_ERR_NOT_FOUND: File cannot be opened
+ *      - ESP_ERR_NO_MEM: Not enough PSRAM for the clip
+ *      - ESP_FAIL: Short read
+ */
+esp_err_t avi_stream_open_psram(const char *filename, avi_stream_t *stream);
+
+/**
+ * @brief Memory-map a raw data partition holding an AVI file and open a source over it
+ *
+ * The clip is flashed as-is at offset 0 of the partition, e.g. with `esptool.py write_flash`
+ * or `esp_partition_write()`. The stream size is taken from the RIFF header.
+ *
+ * @param[in] label Partition label
+ * @param[out] stream Stream to fill
+ *
+ * @return
+ *      - ESP_OK: Success
+ *      - ESP_ERR_INVALID_ARG: NULL arguments
+ *      - ESP_ERR_NOT_FOUND: Partition not found
+ *      - ESP_ERR_INVALID_SIZE: Partition does not start with a RIFF header
+ *      - Others: Error from esp_partition_mmap()
+ */
+esp_err_t avi_stream_open_partition(const char *label, avi_stream_t *stream);
+
+/**
+ * @brief Open a loopback source fed by another task, as a socket or other network stream would be
+ *
+ * The producer pushes the clip in order with `avi_stream_loopback_write()` and calls
+ * `avi_stream_loopback_release()` once it is done or `avi_stream_loopback_closed()` turns true. The source
+ * cannot seek backwards past `history_size`; the player reads `avi_player_config_t::buffer_size`
+ * bytes of header and then rewinds to the `movi` list, so `history_size` must be at least that.
+ *
+ * The source is freed once both the player has closed the stream and the producer has released it.
+ *
+ * @param[in] config Loopback configuration
+ * @param[out] stream Stream to fill
+ * @param[out] loopback Producer handle
+ *
+ * @return
+ *      - ESP_OK: Success
+ *      - ESP_ERR_INVALID_ARG: NULL arguments or zero sizes
+ *      - ESP_ERR_NO_MEM: Cannot allocate context, history or stream buffer
+ */
+esp_err_t avi_stream_open_loopback(const avi_loopback_config_t *config, avi_stream_t *stream, avi_loopback_handle_t *loopback);
+
+/**
+ * @brief Push clip data into a loopback source
+ *
+ * @param[in] loopback Producer handle
+ * @param[in] data Data to push
+ * @param[in] len Number of bytes
+ * @param[in] timeout_ms Maximum time to wait for space in the stream buffer
+ *
+ * @return Number of bytes accepted, 0 when the buffer stayed full for timeout_ms or the player has closed the stream
+ */
+size_t avi_stream_loopback_write(avi_loopback_handle_t loopback, const void *data, size_t len, uint32_t timeout_ms);
+
+/**
+ * @brief Check whether the player has closed a loopback source
+ *
+ * @param[in] loopback Producer handle
+ *
+ * @return true once playback ended or was stopped, the producer should release the handle
+ */
+bool avi_stream_loopback_closed(avi_loopback_handle_t loopback);
+
+/**
+ * @brief Drop the producer reference of a loopback source
+ *
+ * @param[in] loopback Producer handle, must not be used afterwards
+ */
+void avi_stream_loopback_release(avi_loopback_handle_t loopback);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -35,6 +35,7 @@
 #define DB_ID       _REV(0x00006462)  /*!< uncompressed video frame */
 #define DC_ID       _REV(0x00006463)  /*!< compressed video frame */
 #define WB_ID       _REV(0x00007762)  /*!< uncompressed audio data */
+#define WC_ID       _REV(0x00007763)  /*!< compressed audio data */
 #define PC_ID       _REV(0x00007063)  /*!< use new palette */
 
 typedef struct {
@@ -53,8 +54,12 @@ typedef struct {
     video_frame_format vids_format;
 
     uint16_t auds_channels;
-    uint16_t auds_sample_rate;
+    uint32_t auds_sample_rate;
     uint16_t auds_bits;
+    audio_frame_format auds_format;
+    uint16_t auds_format_tag;          /*!< WAVEFORMATEX format tag, the sub-format for WAVE_FORMAT_EXTENSIBLE */
+    uint16_t auds_block_align;
+    uint16_t auds_samples_per_block;   /*!< ADPCM only, 0 if the format extension has none */
 } avi_typedef;
 
 /**
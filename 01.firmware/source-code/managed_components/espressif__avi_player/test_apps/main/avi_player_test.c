@@ -5,6 +5,8 @@
  */
 
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
 #include <inttypes.h>
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
@@ -74,6 +76,84 @@ TEST_CASE("avi_player_test", "[avi_player]")
     vTaskDelay(500 / portTICK_PERIOD_MS);
 }
 
+/**
+ * Feeds the clip into a loopback source in 1 KB pieces, the way a socket would
+ */
+static void loopback_feed_task(void *arg)
+{
+    avi_loopback_handle_t loopback = (avi_loopback_handle_t)arg;
+    FILE *fp = fopen("/spiffs/p4_introduce.avi", "rb");
+    uint8_t chunk[1024];
+    size_t n;
+    while (fp && !avi_stream_loopback_closed(loopback) && (n = fread(chunk, 1, sizeof(chunk), fp)) > 0) {
+        size_t sent = 0;
+        while (sent < n && !avi_stream_loopback_closed(loopback)) {
+            sent += avi_stream_loopback_write(loopback, chunk + sent, n - sent, 20);
+        }
+    }
+    if (fp) {
+        fclose(fp);
+    }
+    avi_stream_loopback_release(loopback);
+    vTaskDelete(NULL);
+}
+
+TEST_CASE("avi_player_stream_test", "[avi_player]")
+{
+    end_play = false;
+    avi_player_config_t config = {
+        .buffer_size = 60 * 1024,
+        .audio_cb = audio_write,
+        .video_cb = video_write,
+        .audio_set_clock_cb = audio_set_clock,
+        .avi_play_end_cb = avi_play_end,
+        .stack_size = 4096,
+#if ESP_IDF_VERSION >= ESP_IDF_VERSION_VAL(5, 1, 0)
+        .stack_in_psram = false,
+#endif
+    };
+
+    avi_player_handle_t handle;
+    TEST_ASSERT_EQUAL(ESP_OK, avi_player_init(config, &handle));
+
+    /*!< PSRAM-resident clip when there is enough PSRAM, plain memory-mapped source either way */
+    avi_stream_t stream;
+    esp_err_t ret = avi_stream_open_psram("/spiffs/p4_introduce.avi", &stream);
+    if (ret == ESP_OK) {
+        TEST_ASSERT_NOT_NULL(stream.map);
+        TEST_ASSERT_EQUAL(ESP_OK, avi_player_play_from_stream(handle, &stream));
+        while (!end_play) {
+            vTaskDelay(500 / portTICK_PERIOD_MS);
+        }
+        end_play = false;
+    } else {
+        ESP_LOGW(TAG, "skip PSRAM source (%s)", esp_err_to_name(ret));
+    }
+
+    /*!< Loopback source fed by another task, as a network stream would be */
+    FILE *fp = fopen("/spiffs/p4_introduce.avi", "rb");
+    TEST_ASSERT_NOT_NULL(fp);
+    fseek(fp, 0, SEEK_END);
+    avi_loopback_config_t loopback_config = {
+        .size = ftell(fp),
+        .buffer_size = 8 * 1024,
+        .history_size = config.buffer_size,
+        .read_timeout_ms = 1000,
+    };
+    fclose(fp);
+    avi_loopback_handle_t loopback;
+    TEST_ASSERT_EQUAL(ESP_OK, avi_stream_open_loopback(&loopback_config, &stream, &loopback));
+    TEST_ASSERT_NULL(stream.map);
+    TEST_ASSERT_EQUAL(pdPASS, xTaskCreate(loopback_feed_task, "loopback_feed", 4096, loopback, 5, NULL));
+
+    TEST_ASSERT_EQUAL(ESP_OK, avi_player_play_from_stream(handle, &stream));
+    while (!end_play) {
+        vTaskDelay(500 / portTICK_PERIOD_MS);
+    }
+    avi_player_deinit(handle);
+    vTaskDelay(500 / portTICK_PERIOD_MS);
+}
+
 static size_t before_free_8bit;
 static size_t before_free_32bit;
 
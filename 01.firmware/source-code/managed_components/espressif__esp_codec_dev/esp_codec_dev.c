@@ -29,6 +29,7 @@ typedef struct {
     bool                         sw_vol_alloced;
     esp_codec_dev_vol_curve_t    vol_curve;
     bool                         disable_when_closed;
+    uint8_t                     *out_lent;
 } codec_dev_t;
 
 static bool _verify_codec_ready(codec_dev_t *dev)
@@ -272,6 +273,58 @@ int esp_codec_dev_write(esp_codec_dev_handle_t handle, void *data, int len)
     return ESP_CODEC_DEV_NOT_SUPPORT;
 }
 
+int esp_codec_dev_acquire_write(esp_codec_dev_handle_t handle, void **data, int *len, uint32_t timeout_ms)
+{
+    codec_dev_t *dev = (codec_dev_t *) handle;
+    if (dev == NULL || data == NULL || len == NULL) {
+        return ESP_CODEC_DEV_INVALID_ARG;
+    }
+    if (dev->output_opened == false) {
+        return ESP_CODEC_DEV_WRONG_STATE;
+    }
+    const audio_codec_data_if_t *data_if = dev->data_if;
+    if (data_if->acquire_write == NULL) {
+        return ESP_CODEC_DEV_NOT_SUPPORT;
+    }
+    int ret = data_if->acquire_write(data_if, (uint8_t **) data, len, timeout_ms);
+    dev->out_lent = (ret == ESP_CODEC_DEV_OK) ? (uint8_t *) *data : NULL;
+    return ret;
+}
+
+int esp_codec_dev_commit_write(esp_codec_dev_handle_t handle, int len)
+{
+    codec_dev_t *dev = (codec_dev_t *) handle;
+    if (dev == NULL) {
+        return ESP_CODEC_DEV_INVALID_ARG;
+    }
+    if (dev->output_opened == false || dev->out_lent == NULL) {
+        return ESP_CODEC_DEV_WRONG_STATE;
+    }
+    const audio_codec_data_if_t *data_if = dev->data_if;
+    if (data_if->commit_write == NULL) {
+        return ESP_CODEC_DEV_NOT_SUPPORT;
+    }
+    // Soft volume in place, same as write
+    if (dev->sw_vol && len > 0) {
+        dev->sw_vol->process(dev->sw_vol, dev->out_lent, len, dev->out_lent, len);
+    }
+    dev->out_lent = NULL;
+    return data_if->commit_write(data_if, len);
+}
+
+int esp_codec_dev_get_write_stats(esp_codec_dev_handle_t handle, esp_codec_dev_out_buf_stats_t *stats)
+{
+    codec_dev_t *dev = (codec_dev_t *) handle;
+    if (dev == NULL || stats == NULL) {
+        return ESP_CODEC_DEV_INVALID_ARG;
+    }
+    const audio_codec_data_if_t *data_if = dev->data_if;
+    if (data_if->get_write_stats == NULL) {
+        return ESP_CODEC_DEV_NOT_SUPPORT;
+    }
+    return data_if->get_write_stats(data_if, stats);
+}
+
 int esp_codec_dev_set_vol_curve(esp_codec_dev_handle_t handle, esp_codec_dev_vol_curve_t *curve)
 {
     codec_dev_t *dev = (codec_dev_t *) handle;
@@ -509,6 +562,8 @@ int esp_codec_dev_close(esp_codec_dev_handle_t handle)
     if (dev->sw_vol) {
         dev->sw_vol->close(dev->sw_vol);
     }
+    // Lent space was dropped when the data interface was disabled
+    dev->out_lent = NULL;
     dev->output_opened = dev->input_opened = false;
     return ESP_CODEC_DEV_OK;
 }
@@ -100,6 +100,46 @@ int esp_codec_dev_read(esp_codec_dev_handle_t codec, void *data, int len);
  */
 int esp_codec_dev_write(esp_codec_dev_handle_t codec, void *data, int len);
 
+/**
+ * @brief         Borrow part of an output DMA buffer to fill in place, saves the copy `esp_codec_dev_write` makes
+ *                Notes: needs data interface created with lending enabled (see `audio_codec_i2s_cfg_t`)
+ *                       Returns the same space until it is committed, at most one batch at a time
+ *                       Must be committed before DMA comes back to it, see `esp_codec_dev_get_write_stats`
+ *                       Space not committed is dropped by `esp_codec_dev_close`, close and open again to change format
+ * @param         codec: Codec device handle
+ * @param[out]    data: Space to fill
+ * @param[out]    len: Bytes of space
+ * @param         timeout_ms: Wait for DMA to release a buffer
+ * @return        ESP_CODEC_DEV_OK: Acquire success
+ *                ESP_CODEC_DEV_INVALID_ARG: Invalid arguments
+ *                ESP_CODEC_DEV_NOT_SUPPORT: Data interface does not lend buffers
+ *                ESP_CODEC_DEV_WRONG_STATE: Driver not open yet
+ *                ESP_CODEC_DEV_WRITE_FAIL: No buffer released in time
+ */
+int esp_codec_dev_acquire_write(esp_codec_dev_handle_t codec, void **data, int *len, uint32_t timeout_ms);
+
+/**
+ * @brief         Hand filled bytes from the start of the acquired space back for playback
+ *                Notes: software volume is applied in place
+ * @param         codec: Codec device handle
+ * @param         len: Bytes filled, whole frames, up to the acquired length
+ * @return        ESP_CODEC_DEV_OK: Commit success
+ *                ESP_CODEC_DEV_INVALID_ARG: Invalid arguments
+ *                ESP_CODEC_DEV_NOT_SUPPORT: Data interface does not lend buffers
+ *                ESP_CODEC_DEV_WRONG_STATE: Nothing acquired
+ */
+int esp_codec_dev_commit_write(esp_codec_dev_handle_t codec, int len);
+
+/**
+ * @brief         Get producer fill latency of lent output buffers, to tune DMA buffer count against latency
+ * @param         codec: Codec device handle
+ * @param[out]    stats: Statistics
+ * @return        ESP_CODEC_DEV_OK: Get success
+ *                ESP_CODEC_DEV_INVALID_ARG: Invalid arguments
+ *                ESP_CODEC_DEV_NOT_SUPPORT: Data interface does not lend buffers
+ */
+int esp_codec_dev_get_write_stats(esp_codec_dev_handle_t codec, esp_codec_dev_out_buf_stats_t *stats);
+
 /**
  * @brief         Set codec hardware gain
  * @param         codec: Codec device handle
@@ -64,9 +64,17 @@ typedef struct {
  * @brief Codec I2S configuration
  */
 typedef struct {
-    uint8_t port;      /*!< I2S port, this port need pre-installed by other modules */
-    void   *rx_handle; /*!< I2S rx handle, need provide on IDF 5.x */
-    void   *tx_handle; /*!< I2S tx handle, need provide on IDF 5.x */
+    uint8_t  port;           /*!< I2S port, this port need pre-installed by other modules */
+    void    *rx_handle;      /*!< I2S rx handle, need provide on IDF 5.x */
+    void    *tx_handle;      /*!< I2S tx handle, need provide on IDF 5.x */
+    bool     out_lend;       /*!< Lend TX DMA buffers to the producer (acquire / commit) instead of copying writes
+                                  Owns the TX event callbacks until closed, IDF 5.x only
+                                  Stop and restart TX only through `esp_codec_dev_close` / `esp_codec_dev_open` */
+    uint32_t out_batch_size; /*!< Bytes of a lent buffer handed to DMA at a time, 0 for whole DMA buffers
+                                  Whole frames, the DMA buffer size is set by `dma_frame_num` of the TX channel */
+    const void *out_cbs;     /*!< `i2s_event_callbacks_t` of the caller for the TX channel when lending, can be NULL
+                                  Called after the lending ones from ISR, restored on the channel when closed */
+    void    *out_cbs_ctx;    /*!< User context of `out_cbs` */
 } audio_codec_i2s_cfg_t;
 
 /**
@@ -72,6 +72,23 @@ typedef enum {
     ESP_CODEC_DEV_WORK_MODE_LINE = (1 << 2),                         /*!< Line mode */
 } esp_codec_dec_work_mode_t;
 
+/**
+ * @brief Statistics of lent output buffers
+ *        Notes: a buffer is lent when DMA has sent it and must be filled before DMA comes back to it,
+ *               that is within (dma_buffers - 1) * period_us; slack_us_min shows how close the producer came
+ */
+typedef struct {
+    uint32_t buffers;      /*!< DMA buffers filled by the producer */
+    uint32_t batches;      /*!< Batches handed to DMA */
+    uint32_t late;         /*!< Buffers DMA came back to before they were filled, played stale */
+    uint32_t dma_buffers;  /*!< DMA buffers seen in the ring */
+    uint32_t period_us;    /*!< Time DMA takes for one buffer */
+    uint32_t fill_us_last; /*!< Time from DMA releasing a buffer to the producer filling it */
+    uint32_t fill_us_avg;  /*!< Running average of fill_us_last */
+    uint32_t fill_us_max;  /*!< Worst fill time */
+    int32_t  slack_us_min; /*!< Least time left before DMA reached a filled buffer, negative when late */
+} esp_codec_dev_out_buf_stats_t;
+
 #ifdef __cplusplus
 }
 #endif
@@ -29,6 +29,11 @@ struct audio_codec_data_if_t {
     int (*read)(const audio_codec_data_if_t *h, uint8_t *data, int size);  /*!< Read data from data interface */
     int (*write)(const audio_codec_data_if_t *h, uint8_t *data, int size); /*!< Write data to data interface */
     int (*close)(const audio_codec_data_if_t *h);                          /*!< Close data interface */
+    int (*acquire_write)(const audio_codec_data_if_t *h, uint8_t **data, int *size,
+                         uint32_t timeout_ms);                             /*!< Borrow output buffer to fill in place (optional) */
+    int (*commit_write)(const audio_codec_data_if_t *h, int size);         /*!< Return filled part of borrowed buffer (optional) */
+    int (*get_write_stats)(const audio_codec_data_if_t *h,
+                           esp_codec_dev_out_buf_stats_t *stats);          /*!< Get lent buffer statistics (optional) */
 };
 
 /**
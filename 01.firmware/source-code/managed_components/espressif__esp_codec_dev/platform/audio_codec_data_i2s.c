@@ -18,9 +18,52 @@
 #endif
 #include "esp_codec_dev_os.h"
 #include "esp_log.h"
+#if ESP_IDF_VERSION >= ESP_IDF_VERSION_VAL(5, 0, 0)
+#include "esp_attr.h"
+#include "esp_timer.h"
+#include "freertos/semphr.h"
+#include "soc/soc_caps.h"
+#if SOC_CACHE_INTERNAL_MEM_VIA_L1CACHE
+#include "esp_cache.h"
+#endif
+#endif
 
 #define TAG "I2S_IF"
 
+/* DMA buffers tracked for lending, more than any TX channel uses */
+#define I2S_LEND_MAX (16)
+
+typedef struct {
+    uint8_t *buf;
+    int      size;
+    int64_t  sent_us;
+} i2s_lend_buf_t;
+
+/*
+ * TX DMA buffers lent to the producer: the `on_sent` callback queues each buffer DMA has finished,
+ * the producer fills the oldest in place and DMA plays it when it comes round again
+ */
+typedef struct {
+    portMUX_TYPE                  lock;                /* Between TX ISR and producer */
+    void                         *ready;               /* Given by TX ISR when a buffer is queued */
+    i2s_lend_buf_t                free[I2S_LEND_MAX];  /* Sent buffers, in order of sending */
+    int                           free_num;
+    uint8_t                      *known[I2S_LEND_MAX]; /* Distinct DMA buffers seen */
+    int                           known_num;
+    int64_t                       last_sent_us;
+    uint32_t                      period_us;
+    uint32_t                      late;
+    i2s_lend_buf_t                lent;                /* Buffer being filled, buf NULL if none */
+    int                           lent_fill;
+    int                           batch_start;         /* Bytes of lent already handed to DMA */
+    int                           batch_size;
+    esp_codec_dev_out_buf_stats_t stats;
+#if ESP_IDF_VERSION >= ESP_IDF_VERSION_VAL(5, 0, 0)
+    i2s_event_callbacks_t         user_cbs;            /* Caller callbacks, the channel has one set */
+    void                         *user_ctx;
+#endif
+} i2s_lend_t;
+
 typedef struct {
     audio_codec_data_if_t       base;
     bool                        is_open;
@@ -36,6 +79,7 @@ typedef struct {
     esp_codec_dev_sample_info_t in_fs;
     esp_codec_dev_sample_info_t out_fs;
     esp_codec_dev_sample_info_t fs;
+    i2s_lend_t                 *lend;
 } i2s_data_t;
 
 static bool _i2s_valid_fmt(esp_codec_dev_sample_info_t *fs)
@@ -57,6 +101,17 @@ static bool _i2s_valid_fmt(esp_codec_dev_sample_info_t *fs)
     return true;
 }
 
+#if ESP_IDF_VERSION >= ESP_IDF_VERSION_VAL(5, 0, 0)
+static void _i2s_lend_reset(i2s_lend_t *lend)
+{
+    portENTER_CRITICAL(&lend->lock);
+    lend->free_num = 0;
+    lend->last_sent_us = 0;
+    lend->lent.buf = NULL;
+    portEXIT_CRITICAL(&lend->lock);
+}
+#endif
+
 static int _i2s_drv_enable(i2s_data_t *i2s_data, bool playback, bool enable)
 {
 #if ESP_IDF_VERSION >= ESP_IDF_VERSION_VAL(5, 0, 0)
@@ -70,6 +125,10 @@ static int _i2s_drv_enable(i2s_data_t *i2s_data, bool playback, bool enable)
         ret = i2s_channel_enable(channel);
     } else {
         ret = i2s_channel_disable(channel);
+        // DMA restarts from the first buffer, drop what was queued or lent
+        if (playback && i2s_data->lend) {
+            _i2s_lend_reset(i2s_data->lend);
+        }
     }
     return ret == ESP_OK ? ESP_CODEC_DEV_OK : ESP_CODEC_DEV_DRV_ERR;
 #endif
@@ -327,6 +386,135 @@ static int check_fs_compatible(i2s_data_t *i2s_data, bool playback, esp_codec_de
 }
 #endif
 
+#if ESP_IDF_VERSION >= ESP_IDF_VERSION_VAL(5, 0, 0)
+static IRAM_ATTR bool _i2s_lend_on_sent(i2s_chan_handle_t handle, i2s_event_data_t *event, void *user_ctx)
+{
+    i2s_lend_t *lend = (i2s_lend_t *) user_ctx;
+#if ESP_IDF_VERSION >= ESP_IDF_VERSION_VAL(5, 4, 0)
+    uint8_t *buf = (uint8_t *) event->dma_buf;
+#else
+    uint8_t *buf = *(uint8_t **) event->data;
+#endif
+    int64_t now = esp_timer_get_time();
+    BaseType_t woken = pdFALSE;
+    int i;
+    portENTER_CRITICAL_ISR(&lend->lock);
+    if (lend->last_sent_us) {
+        lend->period_us = (uint32_t) (now - lend->last_sent_us);
+    }
+    lend->last_sent_us = now;
+    for (i = 0; i < lend->known_num && lend->known[i] != buf; i++);
+    if (i == lend->known_num && i < I2S_LEND_MAX) {
+        lend->known[lend->known_num++] = buf;
+    }
+    if (buf == lend->lent.buf) {
+        // Came round again while being filled, played as it was
+        lend->late++;
+    } else {
+        // Not taken since last time round, move it behind the buffers sent after it
+        for (i = 0; i < lend->free_num && lend->free[i].buf != buf; i++);
+        for (; i + 1 < lend->free_num; i++) {
+            lend->free[i] = lend->free[i + 1];
+        }
+        if (i < lend->free_num) {
+            lend->free_num--;
+        }
+        if (lend->free_num < I2S_LEND_MAX) {
+            i2s_lend_buf_t *item = &lend->free[lend->free_num++];
+            item->buf = buf;
+            item->size = (int) event->size;
+            item->sent_us = now;
+        }
+        xSemaphoreGiveFromISR((SemaphoreHandle_t) lend->ready, &woken);
+    }
+    portEXIT_CRITICAL_ISR(&lend->lock);
+    bool user_woken = false;
+    if (lend->user_cbs.on_sent) {
+        user_woken = lend->user_cbs.on_sent(handle, event, lend->user_ctx);
+    }
+    return woken == pdTRUE || user_woken;
+}
+
+static IRAM_ATTR bool _i2s_lend_on_send_q_ovf(i2s_chan_handle_t handle, i2s_event_data_t *event, void *user_ctx)
+{
+    i2s_lend_t *lend = (i2s_lend_t *) user_ctx;
+    return lend->user_cbs.on_send_q_ovf(handle, event, lend->user_ctx);
+}
+
+static int _i2s_lend_register(i2s_chan_handle_t tx_chan, i2s_event_callbacks_t *cbs, void *user_ctx)
+{
+    // Callbacks can only be changed while the channel is stopped
+    esp_err_t ret = i2s_channel_register_event_callback(tx_chan, cbs, user_ctx);
+    if (ret == ESP_ERR_INVALID_STATE && i2s_channel_disable(tx_chan) == ESP_OK) {
+        ret = i2s_channel_register_event_callback(tx_chan, cbs, user_ctx);
+        i2s_channel_enable(tx_chan);
+    }
+    return ret == ESP_OK ? ESP_CODEC_DEV_OK : ESP_CODEC_DEV_DRV_ERR;
+}
+
+static void _i2s_lend_close(i2s_data_t *i2s_data)
+{
+    i2s_lend_t *lend = i2s_data->lend;
+    if (lend == NULL) {
+        return;
+    }
+    if (i2s_data->out_handle) {
+        // Hand the channel back with the caller callbacks only
+        _i2s_lend_register((i2s_chan_handle_t) i2s_data->out_handle, &lend->user_cbs, lend->user_ctx);
+    }
+    if (lend->ready) {
+        vSemaphoreDelete((SemaphoreHandle_t) lend->ready);
+    }
+    free(lend);
+    i2s_data->lend = NULL;
+}
+
+static int _i2s_lend_open(i2s_data_t *i2s_data, audio_codec_i2s_cfg_t *i2s_cfg)
+{
+    if (i2s_data->out_handle == NULL) {
+        ESP_LOGE(TAG, "Lending output buffers needs tx handle");
+        return ESP_CODEC_DEV_INVALID_ARG;
+    }
+    i2s_lend_t *lend = calloc(1, sizeof(i2s_lend_t));
+    if (lend == NULL) {
+        return ESP_CODEC_DEV_NO_MEM;
+    }
+    portMUX_INITIALIZE(&lend->lock);
+    lend->ready = xSemaphoreCreateBinary();
+    if (lend->ready == NULL) {
+        free(lend);
+        return ESP_CODEC_DEV_NO_MEM;
+    }
+    lend->batch_size = (int) i2s_cfg->out_batch_size;
+    lend->stats.slack_us_min = INT32_MAX;
+    if (i2s_cfg->out_cbs) {
+        memcpy(&lend->user_cbs, i2s_cfg->out_cbs, sizeof(i2s_event_callbacks_t));
+        lend->user_ctx = i2s_cfg->out_cbs_ctx;
+    }
+    i2s_event_callbacks_t cbs = {
+        .on_sent = _i2s_lend_on_sent,
+        .on_send_q_ovf = lend->user_cbs.on_send_q_ovf ? _i2s_lend_on_send_q_ovf : NULL,
+    };
+    int ret = _i2s_lend_register((i2s_chan_handle_t) i2s_data->out_handle, &cbs, lend);
+    if (ret != ESP_CODEC_DEV_OK) {
+        ESP_LOGE(TAG, "Fail to register tx callbacks");
+        vSemaphoreDelete((SemaphoreHandle_t) lend->ready);
+        free(lend);
+        return ret;
+    }
+    i2s_data->lend = lend;
+    return ESP_CODEC_DEV_OK;
+}
+
+/* Make a filled batch visible to DMA */
+static void _i2s_lend_flush(uint8_t *data, int size)
+{
+#if SOC_CACHE_INTERNAL_MEM_VIA_L1CACHE
+    esp_cache_msync(data, size, ESP_CACHE_MSYNC_FLAG_DIR_C2M | ESP_CACHE_MSYNC_FLAG_UNALIGNED);
+#endif
+}
+#endif
+
 static int _i2s_data_open(const audio_codec_data_if_t *h, void *data_cfg, int cfg_size)
 {
     i2s_data_t *i2s_data = (i2s_data_t *) h;
@@ -338,6 +526,14 @@ static int _i2s_data_open(const audio_codec_data_if_t *h, void *data_cfg, int cf
     i2s_data->port = i2s_cfg->port;
     i2s_data->out_handle = i2s_cfg->tx_handle;
     i2s_data->in_handle = i2s_cfg->rx_handle;
+    if (i2s_cfg->out_lend) {
+#if ESP_IDF_VERSION >= ESP_IDF_VERSION_VAL(5, 0, 0)
+        return _i2s_lend_open(i2s_data, i2s_cfg);
+#else
+        ESP_LOGE(TAG, "Lending output buffers needs IDF 5.x");
+        return ESP_CODEC_DEV_NOT_SUPPORT;
+#endif
+    }
     return ESP_CODEC_DEV_OK;
 }
 
@@ -518,6 +714,10 @@ static int _i2s_data_write(const audio_codec_data_if_t *h, uint8_t *data, int si
     if (tx_chan == NULL) {
         return ESP_CODEC_DEV_DRV_ERR;
     }
+    if (i2s_data->lend) {
+        ESP_LOGE(TAG, "Output buffers are lent, use acquire and commit");
+        return ESP_CODEC_DEV_WRONG_STATE;
+    }
     if (i2s_data->out_reconfig) {
         esp_codec_dev_sleep(10);
         return ESP_CODEC_DEV_OK;
@@ -529,6 +729,125 @@ static int _i2s_data_write(const audio_codec_data_if_t *h, uint8_t *data, int si
     return ret == 0 ? ESP_CODEC_DEV_OK : ESP_CODEC_DEV_DRV_ERR;
 }
 
+static int _i2s_data_acquire_write(const audio_codec_data_if_t *h, uint8_t **data, int *size, uint32_t timeout_ms)
+{
+    i2s_data_t *i2s_data = (i2s_data_t *) h;
+    if (i2s_data == NULL || data == NULL || size == NULL) {
+        return ESP_CODEC_DEV_INVALID_ARG;
+    }
+    if (i2s_data->is_open == false) {
+        return ESP_CODEC_DEV_WRONG_STATE;
+    }
+#if ESP_IDF_VERSION >= ESP_IDF_VERSION_VAL(5, 0, 0)
+    i2s_lend_t *lend = i2s_data->lend;
+    if (lend == NULL) {
+        return ESP_CODEC_DEV_NOT_SUPPORT;
+    }
+    if (lend->lent.buf == NULL) {
+        TickType_t wait = (timeout_ms == portMAX_DELAY) ? portMAX_DELAY : pdMS_TO_TICKS(timeout_ms);
+        while (1) {
+            // Oldest first, DMA comes back to it soonest
+            portENTER_CRITICAL(&lend->lock);
+            if (lend->free_num) {
+                lend->lent = lend->free[0];
+                lend->free_num--;
+                memmove(&lend->free[0], &lend->free[1], lend->free_num * sizeof(i2s_lend_buf_t));
+            }
+            portEXIT_CRITICAL(&lend->lock);
+            if (lend->lent.buf) {
+                break;
+            }
+            if (xSemaphoreTake((SemaphoreHandle_t) lend->ready, wait) != pdTRUE) {
+                return ESP_CODEC_DEV_WRITE_FAIL;
+            }
+        }
+        lend->lent_fill = lend->batch_start = 0;
+    }
+    int left = lend->lent.size - lend->lent_fill;
+    int batch_left = lend->batch_start + lend->batch_size - lend->lent_fill;
+    *data = lend->lent.buf + lend->lent_fill;
+    *size = (lend->batch_size && batch_left < left) ? batch_left : left;
+    return ESP_CODEC_DEV_OK;
+#else
+    return ESP_CODEC_DEV_NOT_SUPPORT;
+#endif
+}
+
+static int _i2s_data_commit_write(const audio_codec_data_if_t *h, int size)
+{
+    i2s_data_t *i2s_data = (i2s_data_t *) h;
+    if (i2s_data == NULL) {
+        return ESP_CODEC_DEV_INVALID_ARG;
+    }
+#if ESP_IDF_VERSION >= ESP_IDF_VERSION_VAL(5, 0, 0)
+    i2s_lend_t *lend = i2s_data->lend;
+    if (lend == NULL) {
+        return ESP_CODEC_DEV_NOT_SUPPORT;
+    }
+    if (lend->lent.buf == NULL) {
+        return ESP_CODEC_DEV_WRONG_STATE;
+    }
+    if (size < 0 || size > lend->lent.size - lend->lent_fill) {
+        return ESP_CODEC_DEV_INVALID_ARG;
+    }
+    lend->lent_fill += size;
+    bool full = (lend->lent_fill == lend->lent.size);
+    // Hand over per batch so that small commits do not sync cache each time
+    if (full || (lend->batch_size && lend->lent_fill - lend->batch_start >= lend->batch_size)) {
+        _i2s_lend_flush(lend->lent.buf + lend->batch_start, lend->lent_fill - lend->batch_start);
+        lend->batch_start = lend->lent_fill;
+        lend->stats.batches++;
+    }
+    if (full == false) {
+        return ESP_CODEC_DEV_OK;
+    }
+    int64_t now = esp_timer_get_time();
+    portENTER_CRITICAL(&lend->lock);
+    int64_t due = lend->lent.sent_us + (int64_t) (lend->known_num - 1) * lend->period_us;
+    lend->lent.buf = NULL;
+    portEXIT_CRITICAL(&lend->lock);
+
+    esp_codec_dev_out_buf_stats_t *stats = &lend->stats;
+    uint32_t fill_us = (uint32_t) (now - lend->lent.sent_us);
+    int32_t slack_us = (int32_t) (due - now);
+    stats->buffers++;
+    stats->fill_us_last = fill_us;
+    stats->fill_us_avg = stats->fill_us_avg ? stats->fill_us_avg + ((int32_t) (fill_us - stats->fill_us_avg) / 16) : fill_us;
+    if (fill_us > stats->fill_us_max) {
+        stats->fill_us_max = fill_us;
+    }
+    if (slack_us < stats->slack_us_min) {
+        stats->slack_us_min = slack_us;
+    }
+    return ESP_CODEC_DEV_OK;
+#else
+    return ESP_CODEC_DEV_NOT_SUPPORT;
+#endif
+}
+
+static int _i2s_data_get_write_stats(const audio_codec_data_if_t *h, esp_codec_dev_out_buf_stats_t *stats)
+{
+    i2s_data_t *i2s_data = (i2s_data_t *) h;
+    if (i2s_data == NULL || stats == NULL) {
+        return ESP_CODEC_DEV_INVALID_ARG;
+    }
+#if ESP_IDF_VERSION >= ESP_IDF_VERSION_VAL(5, 0, 0)
+    i2s_lend_t *lend = i2s_data->lend;
+    if (lend == NULL) {
+        return ESP_CODEC_DEV_NOT_SUPPORT;
+    }
+    memcpy(stats, &lend->stats, sizeof(esp_codec_dev_out_buf_stats_t));
+    portENTER_CRITICAL(&lend->lock);
+    stats->late = lend->late;
+    stats->dma_buffers = lend->known_num;
+    stats->period_us = lend->period_us;
+    portEXIT_CRITICAL(&lend->lock);
+    return ESP_CODEC_DEV_OK;
+#else
+    return ESP_CODEC_DEV_NOT_SUPPORT;
+#endif
+}
+
 static int _i2s_data_close(const audio_codec_data_if_t *h)
 {
     i2s_data_t *i2s_data = (i2s_data_t *) h;
@@ -538,6 +857,9 @@ static int _i2s_data_close(const audio_codec_data_if_t *h)
     memset(&i2s_data->fs, 0, sizeof(esp_codec_dev_sample_info_t));
     memset(&i2s_data->in_fs, 0, sizeof(esp_codec_dev_sample_info_t));
     memset(&i2s_data->out_fs, 0, sizeof(esp_codec_dev_sample_info_t));
+#if ESP_IDF_VERSION >= ESP_IDF_VERSION_VAL(5, 0, 0)
+    _i2s_lend_close(i2s_data);
+#endif
     i2s_data->is_open = false;
     return ESP_CODEC_DEV_OK;
 }
@@ -556,6 +878,9 @@ const audio_codec_data_if_t *audio_codec_new_i2s_data(audio_codec_i2s_cfg_t *i2s
     i2s_data->base.write = _i2s_data_write;
     i2s_data->base.set_fmt = _i2s_data_set_fmt;
     i2s_data->base.close = _i2s_data_close;
+    i2s_data->base.acquire_write = _i2s_data_acquire_write;
+    i2s_data->base.commit_write = _i2s_data_commit_write;
+    i2s_data->base.get_write_stats = _i2s_data_get_write_stats;
     int ret = _i2s_data_open(&i2s_data->base, i2s_cfg, sizeof(audio_codec_i2s_cfg_t));
     if (ret != 0) {
         free(i2s_data);
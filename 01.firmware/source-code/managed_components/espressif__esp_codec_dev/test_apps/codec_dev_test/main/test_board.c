@@ -4,11 +4,15 @@
  * SPDX-License-Identifier: Apache-2.0
  */
 
+#include <string.h>
 #include "esp_idf_version.h"
 #if ESP_IDF_VERSION >= ESP_IDF_VERSION_VAL(5, 0, 0)
 #include "driver/i2s_std.h"
 #include "driver/i2s_tdm.h"
 #include "soc/soc_caps.h"
+#include "esp_attr.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
 #else
 #include "driver/i2s.h"
 #endif
@@ -462,3 +466,121 @@ TEST_CASE("Playing while recording use TDM mode", "[esp_codec_dev]")
 #endif
 }
 
+
+#if ESP_IDF_VERSION >= ESP_IDF_VERSION_VAL(5, 0, 0)
+static IRAM_ATTR bool ut_i2s_on_sent(i2s_chan_handle_t handle, i2s_event_data_t *event, void *user_ctx)
+{
+    (*(volatile int *) user_ctx)++;
+    return false;
+}
+#endif
+
+TEST_CASE("Lend I2S output buffers", "[esp_codec_dev]")
+{
+#if ESP_IDF_VERSION >= ESP_IDF_VERSION_VAL(5, 0, 0)
+    // Only I2S is needed, nothing is checked on the codec side
+    int ret = ut_i2s_init(0);
+    TEST_ESP_OK(ret);
+    volatile int sent = 0;
+    i2s_event_callbacks_t cbs = {
+        .on_sent = ut_i2s_on_sent,
+    };
+    audio_codec_i2s_cfg_t i2s_cfg = {
+        .tx_handle = i2s_keep[0]->tx_handle,
+        .out_lend = true,
+        .out_batch_size = 256,
+        .out_cbs = &cbs,
+        .out_cbs_ctx = (void *) &sent,
+    };
+    const audio_codec_data_if_t *data_if = audio_codec_new_i2s_data(&i2s_cfg);
+    TEST_ASSERT_NOT_NULL(data_if);
+    // Without codec interface volume is processed in software
+    esp_codec_dev_cfg_t dev_cfg = {
+        .data_if = data_if,
+        .dev_type = ESP_CODEC_DEV_TYPE_OUT,
+    };
+    esp_codec_dev_handle_t play_dev = esp_codec_dev_new(&dev_cfg);
+    TEST_ASSERT_NOT_NULL(play_dev);
+    // Volume set before open takes effect without transition
+    esp_codec_dev_set_out_vol(play_dev, 0);
+    esp_codec_dev_sample_info_t fs = {
+        .sample_rate = 48000,
+        .channel = 2,
+        .bits_per_sample = 16,
+    };
+    ret = esp_codec_dev_open(play_dev, &fs);
+    TEST_ESP_OK(ret);
+    int16_t samples[4] = {0};
+    TEST_ASSERT_EQUAL(ESP_CODEC_DEV_WRONG_STATE, esp_codec_dev_write(play_dev, samples, sizeof(samples)));
+
+    // Soft volume is applied to the lent space on commit
+    int16_t *data = NULL;
+    int size = 0;
+    ret = esp_codec_dev_acquire_write(play_dev, (void **) &data, &size, 100);
+    TEST_ESP_OK(ret);
+    TEST_ASSERT_EQUAL(256, size);
+    for (int i = 0; i < size / 2; i++) {
+        data[i] = 0x1234;
+    }
+    ret = esp_codec_dev_commit_write(play_dev, size);
+    TEST_ESP_OK(ret);
+    for (int i = 0; i < size / 2; i++) {
+        TEST_ASSERT_EQUAL_INT16(0, data[i]);
+    }
+
+    // Keep up with DMA for one second
+    ret = esp_codec_dev_set_out_vol(play_dev, 60);
+    TEST_ESP_OK(ret);
+    int limit_size = fs.sample_rate * fs.channel * (fs.bits_per_sample >> 3);
+    int got_size = 0;
+    while (got_size < limit_size) {
+        ret = esp_codec_dev_acquire_write(play_dev, (void **) &data, &size, 100);
+        TEST_ESP_OK(ret);
+        TEST_ASSERT(size > 0 && size <= 256);
+        memset(data, 0, size);
+        ret = esp_codec_dev_commit_write(play_dev, size);
+        TEST_ESP_OK(ret);
+        got_size += size;
+    }
+    esp_codec_dev_out_buf_stats_t stats;
+    ret = esp_codec_dev_get_write_stats(play_dev, &stats);
+    TEST_ESP_OK(ret);
+    TEST_ASSERT(stats.buffers > 0);
+    TEST_ASSERT(stats.dma_buffers > 1);
+    TEST_ASSERT(stats.period_us > 0);
+    // Callback of the caller still called
+    TEST_ASSERT(sent > 0);
+
+    // Change sample rate by close and open, space not committed is dropped
+    ret = esp_codec_dev_acquire_write(play_dev, (void **) &data, &size, 100);
+    TEST_ESP_OK(ret);
+    ret = esp_codec_dev_commit_write(play_dev, 64);
+    TEST_ESP_OK(ret);
+    ret = esp_codec_dev_acquire_write(play_dev, (void **) &data, &size, 100);
+    TEST_ESP_OK(ret);
+    ret = esp_codec_dev_close(play_dev);
+    TEST_ESP_OK(ret);
+    TEST_ASSERT_EQUAL(ESP_CODEC_DEV_WRONG_STATE, esp_codec_dev_commit_write(play_dev, size));
+    fs.sample_rate = 16000;
+    ret = esp_codec_dev_open(play_dev, &fs);
+    TEST_ESP_OK(ret);
+    // Starts from a buffer DMA sent after reopen, not the half filled one
+    ret = esp_codec_dev_acquire_write(play_dev, (void **) &data, &size, 100);
+    TEST_ESP_OK(ret);
+    TEST_ASSERT_EQUAL(256, size);
+    ret = esp_codec_dev_commit_write(play_dev, size);
+    TEST_ESP_OK(ret);
+
+    ret = esp_codec_dev_close(play_dev);
+    TEST_ESP_OK(ret);
+    esp_codec_dev_delete(play_dev);
+    audio_codec_delete_data_if(data_if);
+
+    // Channel handed back with the callback of the caller
+    sent = 0;
+    i2s_channel_enable(i2s_keep[0]->tx_handle);
+    vTaskDelay(pdMS_TO_TICKS(50));
+    TEST_ASSERT(sent > 0);
+    ut_i2s_deinit(0);
+#endif
+}
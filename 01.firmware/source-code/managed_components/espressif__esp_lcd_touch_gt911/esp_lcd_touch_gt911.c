@@ -12,22 +12,39 @@
 #include "esp_err.h"
 #include "esp_log.h"
 #include "esp_check.h"
+#include "esp_timer.h"
 #include "driver/gpio.h"
 #include "esp_lcd_panel_io.h"
 #include "esp_lcd_touch.h"
 #include "esp_lcd_touch_gt911.h"
+#include "esp_lcd_touch_gt911_proto.h"
 
 static const char *TAG = "GT911";
 
 /* GT911 registers */
-#define ESP_LCD_TOUCH_GT911_READ_KEY_REG    (0x8093)
-#define ESP_LCD_TOUCH_GT911_READ_XY_REG     (0x814E)
-#define ESP_LCD_TOUCH_GT911_CONFIG_REG      (0x8047)
-#define ESP_LCD_TOUCH_GT911_PRODUCT_ID_REG  (0x8140)
+#define ESP_LCD_TOUCH_GT911_PRODUCT_ID_REG  (GT911_REG_PRODUCT_ID)
 #define ESP_LCD_TOUCH_GT911_ENTER_SLEEP     (0x8040)
 
 /* GT911 support key num */
-#define ESP_GT911_TOUCH_MAX_BUTTONS         (4)
+#define ESP_GT911_TOUCH_MAX_BUTTONS         (GT911_MAX_KEYS)
+#if (CONFIG_ESP_LCD_TOUCH_MAX_BUTTONS > 0)
+#define ESP_GT911_TOUCH_READ_BUTTONS        ((ESP_GT911_TOUCH_MAX_BUTTONS < CONFIG_ESP_LCD_TOUCH_MAX_BUTTONS) ? \
+                                             (ESP_GT911_TOUCH_MAX_BUTTONS) : (CONFIG_ESP_LCD_TOUCH_MAX_BUTTONS))
+#else
+#define ESP_GT911_TOUCH_READ_BUTTONS        (0)
+#endif
+
+/*******************************************************************************
+* Types definitions
+*******************************************************************************/
+
+typedef struct {
+    esp_lcd_touch_t             base;           /* Touch handle points here, must be first (freed by free(tp)) */
+    gt911_bus_t                 bus;            /* Register access through the panel IO */
+    bool                        burst_read;     /* Status and points in one transaction */
+    uint8_t                     burst_points;   /* Points read with the status */
+    esp_lcd_touch_gt911_stats_t stats;          /* Protected by base.data.lock */
+} esp_lcd_touch_gt911_t;
 
 /*******************************************************************************
 * Function definitions
@@ -42,6 +59,9 @@ static esp_err_t esp_lcd_touch_gt911_del(esp_lcd_touch_handle_t tp);
 /* I2C read/write */
 static esp_err_t touch_gt911_i2c_read(esp_lcd_touch_handle_t tp, uint16_t reg, uint8_t *data, uint8_t len);
 static esp_err_t touch_gt911_i2c_write(esp_lcd_touch_handle_t tp, uint16_t reg, uint8_t data);
+static int touch_gt911_bus_read(void *ctx, uint16_t reg, uint8_t *data, size_t len);
+static int touch_gt911_bus_write(void *ctx, uint16_t reg, const uint8_t *data, size_t len);
+static int64_t touch_gt911_bus_time(void *ctx);
 
 /* GT911 reset */
 static esp_err_t touch_gt911_reset(esp_lcd_touch_handle_t tp);
@@ -65,11 +85,16 @@ esp_err_t esp_lcd_touch_new_i2c_gt911(const esp_lcd_panel_io_handle_t io, const
     assert(out_touch != NULL);
 
     /* Prepare main structure */
-    esp_lcd_touch_handle_t esp_lcd_touch_gt911 = heap_caps_calloc(1, sizeof(esp_lcd_touch_t), MALLOC_CAP_DEFAULT);
+    esp_lcd_touch_gt911_t *gt911 = heap_caps_calloc(1, sizeof(esp_lcd_touch_gt911_t), MALLOC_CAP_DEFAULT);
+    esp_lcd_touch_handle_t esp_lcd_touch_gt911 = (gt911 ? &gt911->base : NULL);
     ESP_GOTO_ON_FALSE(esp_lcd_touch_gt911, ESP_ERR_NO_MEM, err, TAG, "no mem for GT911 controller");
 
     /* Communication interface */
     esp_lcd_touch_gt911->io = io;
+    gt911->bus.read = touch_gt911_bus_read;
+    gt911->bus.write = touch_gt911_bus_write;
+    gt911->bus.time_us = touch_gt911_bus_time;
+    gt911->bus.ctx = io;
 
     /* Only supported callbacks are set */
     esp_lcd_touch_gt911->read_data = esp_lcd_touch_gt911_read_data;
@@ -87,6 +112,9 @@ esp_err_t esp_lcd_touch_new_i2c_gt911(const esp_lcd_panel_io_handle_t io, const
     /* Save config */
     memcpy(&esp_lcd_touch_gt911->config, config, sizeof(esp_lcd_touch_config_t));
     esp_lcd_touch_io_gt911_config_t *gt911_config = (esp_lcd_touch_io_gt911_config_t *)esp_lcd_touch_gt911->config.driver_data;
+    /* Driver data may not live longer than this call */
+    gt911->burst_read = (gt911_config && gt911_config->flags.burst_read);
+    gt911->burst_points = (gt911->burst_read && config->int_gpio_num != GPIO_NUM_NC ? 1 : 0);
 
     /* Prepare pin for touch controller reset */
     if (esp_lcd_touch_gt911->config.rst_gpio_num != GPIO_NUM_NC) {
@@ -209,82 +237,71 @@ static esp_err_t esp_lcd_touch_gt911_exit_sleep(esp_lcd_touch_handle_t tp)
 static esp_err_t esp_lcd_touch_gt911_read_data(esp_lcd_touch_handle_t tp)
 {
     esp_err_t err;
-    uint8_t buf[41];
-    uint8_t touch_cnt = 0;
-    uint8_t clear = 0;
+    gt911_report_t report;
+    gt911_bus_usage_t usage;
     size_t i = 0;
 
     assert(tp != NULL);
+    esp_lcd_touch_gt911_t *gt911 = __containerof(tp, esp_lcd_touch_gt911_t, base);
 
-    err = touch_gt911_i2c_read(tp, ESP_LCD_TOUCH_GT911_READ_XY_REG, buf, 1);
-    ESP_RETURN_ON_ERROR(err, TAG, "I2C read error!");
+    err = gt911_read_report(&gt911->bus, gt911->burst_points, CONFIG_ESP_LCD_TOUCH_MAX_POINTS, ESP_GT911_TOUCH_READ_BUTTONS, &report, &usage);
 
-    /* Any touch data? */
-    if ((buf[0] & 0x80) == 0x00) {
-        touch_gt911_i2c_write(tp, ESP_LCD_TOUCH_GT911_READ_XY_REG, clear);
-#if (CONFIG_ESP_LCD_TOUCH_MAX_BUTTONS > 0)
-    } else if ((buf[0] & 0x10) == 0x10) {
-        /* Read all keys */
-        uint8_t key_max = ((ESP_GT911_TOUCH_MAX_BUTTONS < CONFIG_ESP_LCD_TOUCH_MAX_BUTTONS) ? \
-                           (ESP_GT911_TOUCH_MAX_BUTTONS) : (CONFIG_ESP_LCD_TOUCH_MAX_BUTTONS));
-        err = touch_gt911_i2c_read(tp, ESP_LCD_TOUCH_GT911_READ_KEY_REG, &buf[0], key_max);
-        ESP_RETURN_ON_ERROR(err, TAG, "I2C read error!");
+    /* Burst: points of this report are expected in the next one, only the status is read while not touched (polling).
+       With interrupt, the touch is read when there are data, at least one point is expected. */
+    if (gt911->burst_read && err == ESP_OK && report.type == GT911_REPORT_POINTS) {
+        gt911->burst_points = report.points;
+        if (report.points == 0 && tp->config.int_gpio_num != GPIO_NUM_NC) {
+            gt911->burst_points = 1;
+        }
+    }
 
-        /* Clear all */
-        touch_gt911_i2c_write(tp, ESP_LCD_TOUCH_GT911_READ_XY_REG, clear);
-        ESP_RETURN_ON_ERROR(err, TAG, "I2C write error!");
+    portENTER_CRITICAL(&tp->data.lock);
 
-        portENTER_CRITICAL(&tp->data.lock);
+    /* Bus statistics */
+    gt911->stats.samples++;
+    gt911->stats.transactions += usage.transactions;
+    gt911->stats.bytes += usage.bytes;
+    gt911->stats.bus_last_us = usage.bus_us;
+    gt911->stats.bus_total_us += usage.bus_us;
+    if (usage.bus_us > gt911->stats.bus_max_us) {
+        gt911->stats.bus_max_us = usage.bus_us;
+    }
+    if (err != ESP_OK) {
+        gt911->stats.errors++;
+        report.type = GT911_REPORT_NONE;
+    }
 
+#if (CONFIG_ESP_LCD_TOUCH_MAX_BUTTONS > 0)
+    if (report.type == GT911_REPORT_KEYS) {
         /* Buttons count */
-        tp->data.buttons = key_max;
-        for (i = 0; i < key_max; i++) {
-            tp->data.button[i].status = buf[i] ? 1 : 0;
+        tp->data.buttons = report.keys;
+        for (i = 0; i < report.keys; i++) {
+            tp->data.button[i].status = report.key[i];
         }
-
-        portEXIT_CRITICAL(&tp->data.lock);
+    }
 #endif
-    } else if ((buf[0] & 0x80) == 0x80) {
-        portENTER_CRITICAL(&tp->data.lock);
-        /* Invalidate */
-        tp->data.points = 0;
+
+    if (report.type == GT911_REPORT_POINTS) {
 #if (CONFIG_ESP_LCD_TOUCH_MAX_BUTTONS > 0)
         for (i = 0; i < CONFIG_ESP_LCD_TOUCH_MAX_BUTTONS; i++) {
             tp->data.button[i].status = 0;
         }
 #endif
-        portEXIT_CRITICAL(&tp->data.lock);
-        /* Count of touched points */
-        touch_cnt = buf[0] & 0x0f;
-        if (touch_cnt > 5 || touch_cnt == 0) {
-            touch_gt911_i2c_write(tp, ESP_LCD_TOUCH_GT911_READ_XY_REG, clear);
-            return ESP_OK;
-        }
-
-        /* Read all points */
-        err = touch_gt911_i2c_read(tp, ESP_LCD_TOUCH_GT911_READ_XY_REG + 1, &buf[1], touch_cnt * 8);
-        ESP_RETURN_ON_ERROR(err, TAG, "I2C read error!");
-
-        /* Clear all */
-        err = touch_gt911_i2c_write(tp, ESP_LCD_TOUCH_GT911_READ_XY_REG, clear);
-        ESP_RETURN_ON_ERROR(err, TAG, "I2C read error!");
-
-        portENTER_CRITICAL(&tp->data.lock);
-
         /* Number of touched points */
-        touch_cnt = (touch_cnt > CONFIG_ESP_LCD_TOUCH_MAX_POINTS ? CONFIG_ESP_LCD_TOUCH_MAX_POINTS : touch_cnt);
-        tp->data.points = touch_cnt;
+        tp->data.points = (report.points > CONFIG_ESP_LCD_TOUCH_MAX_POINTS ? CONFIG_ESP_LCD_TOUCH_MAX_POINTS : report.points);
 
         /* Fill all coordinates */
-        for (i = 0; i < touch_cnt; i++) {
-            tp->data.coords[i].x = ((uint16_t)buf[(i * 8) + 3] << 8) + buf[(i * 8) + 2];
-            tp->data.coords[i].y = (((uint16_t)buf[(i * 8) + 5] << 8) + buf[(i * 8) + 4]);
-            tp->data.coords[i].strength = (((uint16_t)buf[(i * 8) + 7] << 8) + buf[(i * 8) + 6]);
+        for (i = 0; i < tp->data.points; i++) {
+            tp->data.coords[i].x = report.point[i].x;
+            tp->data.coords[i].y = report.point[i].y;
+            tp->data.coords[i].strength = report.point[i].strength;
         }
-
-        portEXIT_CRITICAL(&tp->data.lock);
     }
 
+    portEXIT_CRITICAL(&tp->data.lock);
+
+    ESP_RETURN_ON_ERROR(err, TAG, "I2C read error!");
+
     return ESP_OK;
 }
 
@@ -338,6 +355,18 @@ static esp_err_t esp_lcd_touch_gt911_get_button_state(esp_lcd_touch_handle_t tp,
 }
 #endif
 
+esp_err_t esp_lcd_touch_gt911_get_stats(esp_lcd_touch_handle_t tp, esp_lcd_touch_gt911_stats_t *stats)
+{
+    ESP_RETURN_ON_FALSE(tp && stats && tp->read_data == esp_lcd_touch_gt911_read_data, ESP_ERR_INVALID_ARG, TAG, "Invalid arguments");
+    esp_lcd_touch_gt911_t *gt911 = __containerof(tp, esp_lcd_touch_gt911_t, base);
+
+    portENTER_CRITICAL(&tp->data.lock);
+    *stats = gt911->stats;
+    portEXIT_CRITICAL(&tp->data.lock);
+
+    return ESP_OK;
+}
+
 static esp_err_t esp_lcd_touch_gt911_del(esp_lcd_touch_handle_t tp)
 {
     assert(tp != NULL);
@@ -381,15 +410,28 @@ static esp_err_t touch_gt911_reset(esp_lcd_touch_handle_t tp)
 
 static esp_err_t touch_gt911_read_cfg(esp_lcd_touch_handle_t tp)
 {
-    uint8_t buf[4];
+    uint8_t buf[3];
+    uint8_t config[GT911_CONFIG_LEN];
 
     assert(tp != NULL);
+    esp_lcd_touch_gt911_t *gt911 = __containerof(tp, esp_lcd_touch_gt911_t, base);
+    const esp_lcd_touch_io_gt911_config_t *gt911_config = (const esp_lcd_touch_io_gt911_config_t *)tp->config.driver_data;
 
     ESP_RETURN_ON_ERROR(touch_gt911_i2c_read(tp, ESP_LCD_TOUCH_GT911_PRODUCT_ID_REG, (uint8_t *)&buf[0], 3), TAG, "GT911 read error!");
-    ESP_RETURN_ON_ERROR(touch_gt911_i2c_read(tp, ESP_LCD_TOUCH_GT911_CONFIG_REG, (uint8_t *)&buf[3], 1), TAG, "GT911 read error!");
+    ESP_RETURN_ON_ERROR(gt911_config_read(&gt911->bus, config), TAG, "GT911 read error!");
 
     ESP_LOGI(TAG, "TouchPad_ID:0x%02x,0x%02x,0x%02x", buf[0], buf[1], buf[2]);
-    ESP_LOGI(TAG, "TouchPad_Config_Version:%d", buf[3]);
+    ESP_LOGI(TAG, "TouchPad_Config_Version:%d", config[0]);
+
+    /* Report rate and resolution, the controller stores changed configuration into its flash */
+    if (gt911_config && gt911_config_set(config, gt911_config->report_period_ms, gt911_config->x_resolution, gt911_config->y_resolution)) {
+        ESP_RETURN_ON_ERROR(gt911_config_write(&gt911->bus, config), TAG, "GT911 config write error!");
+        ESP_LOGI(TAG, "TouchPad_Config updated");
+    }
+    ESP_LOGI(TAG, "TouchPad_Resolution:%dx%d, report period %d ms, %s read",
+             config[GT911_REG_X_OUTPUT_MAX - GT911_REG_CONFIG] | (config[GT911_REG_X_OUTPUT_MAX - GT911_REG_CONFIG + 1] << 8),
+             config[GT911_REG_Y_OUTPUT_MAX - GT911_REG_CONFIG] | (config[GT911_REG_Y_OUTPUT_MAX - GT911_REG_CONFIG + 1] << 8),
+             gt911_config_report_period_ms(config), (gt911->burst_read ? "burst" : "separate"));
 
     return ESP_OK;
 }
@@ -412,3 +454,18 @@ static esp_err_t touch_gt911_i2c_write(esp_lcd_touch_handle_t tp, uint16_t reg,
     return esp_lcd_panel_io_tx_param(tp->io, reg, (uint8_t[]){data}, 1);
     // *INDENT-ON*
 }
+
+static int touch_gt911_bus_read(void *ctx, uint16_t reg, uint8_t *data, size_t len)
+{
+    return esp_lcd_panel_io_rx_param((esp_lcd_panel_io_handle_t)ctx, reg, data, len);
+}
+
+static int touch_gt911_bus_write(void *ctx, uint16_t reg, const uint8_t *data, size_t len)
+{
+    return esp_lcd_panel_io_tx_param((esp_lcd_panel_io_handle_t)ctx, reg, data, len);
+}
+
+static int64_t touch_gt911_bus_time(void *ctx)
+{
+    return esp_timer_get_time();
+}
@@ -0,0 +1,195 @@
+/*
+ * SPDX-FileCopyrightText: 2025 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <string.h>
+#include "esp_lcd_touch_gt911_proto.h"
+
+/*******************************************************************************
+* Private functions
+*******************************************************************************/
+
+static int64_t bus_time(const gt911_bus_t *bus)
+{
+    return (bus->time_us ? bus->time_us(bus->ctx) : 0);
+}
+
+static int bus_read(const gt911_bus_t *bus, uint16_t reg, uint8_t *data, size_t len, gt911_bus_usage_t *usage)
+{
+    const int64_t start = bus_time(bus);
+    const int err = bus->read(bus->ctx, reg, data, len);
+    usage->bus_us += (uint32_t)(bus_time(bus) - start);
+    usage->transactions++;
+    usage->bytes += len;
+    return err;
+}
+
+static int bus_write(const gt911_bus_t *bus, uint16_t reg, const uint8_t *data, size_t len, gt911_bus_usage_t *usage)
+{
+    const int64_t start = bus_time(bus);
+    const int err = bus->write(bus->ctx, reg, data, len);
+    usage->bus_us += (uint32_t)(bus_time(bus) - start);
+    usage->transactions++;
+    usage->bytes += len;
+    return err;
+}
+
+static int clear_status(const gt911_bus_t *bus, gt911_bus_usage_t *usage)
+{
+    const uint8_t clear = 0;
+    return bus_write(bus, GT911_REG_READ_XY, &clear, 1, usage);
+}
+
+/*******************************************************************************
+* Public functions
+*******************************************************************************/
+
+int gt911_read_report(const gt911_bus_t *bus, uint8_t burst_points, uint8_t max_points, uint8_t max_keys,
+                      gt911_report_t *report, gt911_bus_usage_t *usage)
+{
+    /* Status and points, the same layout as the registers from GT911_REG_READ_XY */
+    uint8_t buf[1 + GT911_MAX_POINTS * GT911_POINT_LEN];
+    gt911_bus_usage_t local_usage = {0};
+    uint8_t touch_cnt;
+    int err;
+
+    if (usage == NULL) {
+        usage = &local_usage;
+    }
+    memset(usage, 0, sizeof(*usage));
+    max_points = (max_points > GT911_MAX_POINTS ? GT911_MAX_POINTS : (max_points ? max_points : 1));
+    burst_points = (burst_points > max_points ? max_points : burst_points);
+    max_keys = (max_keys > GT911_MAX_KEYS ? GT911_MAX_KEYS : max_keys);
+    report->type = GT911_REPORT_NONE;
+
+    /* Burst: status with the expected points in one transaction */
+    err = bus_read(bus, GT911_REG_READ_XY, buf, 1 + burst_points * GT911_POINT_LEN, usage);
+    if (err) {
+        return err;
+    }
+
+    /* Any touch data? */
+    if ((buf[0] & 0x80) == 0x00) {
+        return clear_status(bus, usage);
+    }
+
+    if (max_keys > 0 && (buf[0] & 0x10) == 0x10) {
+        /* Read all keys */
+        err = bus_read(bus, GT911_REG_READ_KEY, report->key, max_keys, usage);
+        if (err) {
+            return err;
+        }
+        err = clear_status(bus, usage);
+        if (err) {
+            return err;
+        }
+        for (size_t i = 0; i < max_keys; i++) {
+            report->key[i] = (report->key[i] ? 1 : 0);
+        }
+        report->keys = max_keys;
+        report->type = GT911_REPORT_KEYS;
+        return 0;
+    }
+
+    /* Count of touched points, invalid count releases all */
+    report->type = GT911_REPORT_POINTS;
+    report->points = 0;
+    touch_cnt = buf[0] & 0x0f;
+    if (touch_cnt > GT911_MAX_POINTS || touch_cnt == 0) {
+        return clear_status(bus, usage);
+    }
+    touch_cnt = (touch_cnt > max_points ? max_points : touch_cnt);
+
+    if (touch_cnt > burst_points) {
+        /* Read the points, which were not in the burst */
+        err = bus_read(bus, GT911_REG_READ_XY + 1 + burst_points * GT911_POINT_LEN, &buf[1 + burst_points * GT911_POINT_LEN],
+                       (touch_cnt - burst_points) * GT911_POINT_LEN, usage);
+        if (err) {
+            return err;
+        }
+    }
+
+    /* Clear all */
+    err = clear_status(bus, usage);
+    if (err) {
+        return err;
+    }
+
+    /* Fill all coordinates */
+    for (size_t i = 0; i < touch_cnt; i++) {
+        const uint8_t *p = &buf[1 + i * GT911_POINT_LEN];
+        report->point[i].id = p[0];
+        report->point[i].x = ((uint16_t)p[2] << 8) + p[1];
+        report->point[i].y = ((uint16_t)p[4] << 8) + p[3];
+        report->point[i].strength = ((uint16_t)p[6] << 8) + p[5];
+    }
+    report->points = touch_cnt;
+
+    return 0;
+}
+
+int gt911_config_read(const gt911_bus_t *bus, uint8_t *config)
+{
+    return bus->read(bus->ctx, GT911_REG_CONFIG, config, GT911_CONFIG_LEN);
+}
+
+bool gt911_config_set(uint8_t *config, uint8_t report_period_ms, uint16_t x_res, uint16_t y_res)
+{
+    uint8_t *const refresh = &config[GT911_REG_REFRESH_RATE - GT911_REG_CONFIG];
+    uint8_t *const x_max = &config[GT911_REG_X_OUTPUT_MAX - GT911_REG_CONFIG];
+    uint8_t *const y_max = &config[GT911_REG_Y_OUTPUT_MAX - GT911_REG_CONFIG];
+    bool changed = false;
+
+    if (report_period_ms) {
+        report_period_ms = (report_period_ms < GT911_REPORT_PERIOD_MIN_MS ? GT911_REPORT_PERIOD_MIN_MS : report_period_ms);
+        report_period_ms = (report_period_ms > GT911_REPORT_PERIOD_MAX_MS ? GT911_REPORT_PERIOD_MAX_MS : report_period_ms);
+        /* Upper bits of the register are kept */
+        const uint8_t value = (*refresh & 0xf0) | (report_period_ms - GT911_REPORT_PERIOD_MIN_MS);
+        changed |= (value != *refresh);
+        *refresh = value;
+    }
+    if (x_res && (x_max[0] | (x_max[1] << 8)) != x_res) {
+        x_max[0] = x_res & 0xff;
+        x_max[1] = x_res >> 8;
+        changed = true;
+    }
+    if (y_res && (y_max[0] | (y_max[1] << 8)) != y_res) {
+        y_max[0] = y_res & 0xff;
+        y_max[1] = y_res >> 8;
+        changed = true;
+    }
+
+    return changed;
+}
+
+uint8_t gt911_config_report_period_ms(const uint8_t *config)
+{
+    return GT911_REPORT_PERIOD_MIN_MS + (config[GT911_REG_REFRESH_RATE - GT911_REG_CONFIG] & 0x0f);
+}
+
+uint8_t gt911_config_checksum(const uint8_t *config)
+{
+    uint8_t sum = 0;
+    for (size_t i = 0; i < GT911_CONFIG_LEN; i++) {
+        sum += config[i];
+    }
+    return (uint8_t)(~sum + 1);
+}
+
+int gt911_config_write(const gt911_bus_t *bus, const uint8_t *config)
+{
+    uint8_t buf[GT911_CONFIG_LEN + 1];
+    const uint8_t fresh = 1;
+    int err;
+
+    /* Configuration with checksum in one transaction, then the controller takes it */
+    memcpy(buf, config, GT911_CONFIG_LEN);
+    buf[GT911_CONFIG_LEN] = gt911_config_checksum(config);
+    err = bus->write(bus->ctx, GT911_REG_CONFIG, buf, sizeof(buf));
+    if (err) {
+        return err;
+    }
+    return bus->write(bus->ctx, GT911_REG_CONFIG_FRESH, &fresh, 1);
+}
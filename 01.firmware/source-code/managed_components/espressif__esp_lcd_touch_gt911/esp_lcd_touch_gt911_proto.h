@@ -0,0 +1,146 @@
+/*
+ * SPDX-FileCopyrightText: 2025 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+/**
+ * @file
+ * @brief GT911 register protocol (private)
+ *
+ * Reading of touch reports and editing of the controller configuration over an abstract bus. No ESP-IDF headers
+ * are needed: the driver passes esp_lcd_panel_io, the host test (host_test/) passes a mock I2C with a bus clock.
+ */
+
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* GT911 registers */
+#define GT911_REG_CONFIG            (0x8047)    /* Config_Version, first byte of the configuration */
+#define GT911_REG_X_OUTPUT_MAX      (0x8048)    /* X resolution, 2 bytes little endian */
+#define GT911_REG_Y_OUTPUT_MAX      (0x804A)    /* Y resolution, 2 bytes little endian */
+#define GT911_REG_TOUCH_NUMBER      (0x804C)
+#define GT911_REG_REFRESH_RATE      (0x8056)    /* Bits 3..0: coordinate report period 5 + N ms */
+#define GT911_REG_CONFIG_CHKSUM     (0x80FF)
+#define GT911_REG_CONFIG_FRESH      (0x8100)
+#define GT911_REG_PRODUCT_ID        (0x8140)
+#define GT911_REG_READ_KEY          (0x8093)
+#define GT911_REG_READ_XY           (0x814E)    /* Status, followed by the points */
+
+#define GT911_CONFIG_LEN            (GT911_REG_CONFIG_CHKSUM - GT911_REG_CONFIG)  /* Bytes covered by the checksum */
+#define GT911_MAX_POINTS            (5)
+#define GT911_MAX_KEYS              (4)
+#define GT911_POINT_LEN             (8)
+#define GT911_REPORT_PERIOD_MIN_MS  (5)
+#define GT911_REPORT_PERIOD_MAX_MS  (20)
+
+/**
+ * @brief Bus access, functions return 0 on success (esp_err_t on target)
+ */
+typedef struct {
+    int (*read)(void *ctx, uint16_t reg, uint8_t *data, size_t len);        /*!< One transaction: register write, repeated start, read */
+    int (*write)(void *ctx, uint16_t reg, const uint8_t *data, size_t len); /*!< One transaction: register and data write */
+    int64_t (*time_us)(void *ctx);                                          /*!< Clock for the bus time, may be NULL */
+    void *ctx;
+} gt911_bus_t;
+
+/**
+ * @brief Kind of the touch report
+ */
+typedef enum {
+    GT911_REPORT_NONE,      /*!< Controller has no new data, the previous report stays valid */
+    GT911_REPORT_KEYS,      /*!< Key states updated, points stay valid */
+    GT911_REPORT_POINTS,    /*!< Points updated (0 = released) */
+} gt911_report_type_t;
+
+/**
+ * @brief Touch report
+ */
+typedef struct {
+    gt911_report_type_t type;
+    uint8_t points;                             /*!< Count of points (GT911_REPORT_POINTS) */
+    struct {
+        uint8_t id;
+        uint16_t x;
+        uint16_t y;
+        uint16_t strength;
+    } point[GT911_MAX_POINTS];
+    uint8_t keys;                               /*!< Count of keys (GT911_REPORT_KEYS) */
+    uint8_t key[GT911_MAX_KEYS];                /*!< Key states, 0 = released */
+} gt911_report_t;
+
+/**
+ * @brief Bus usage of one operation
+ */
+typedef struct {
+    uint32_t transactions;                      /*!< I2C transactions */
+    uint32_t bytes;                             /*!< Data bytes read and written, without address and register */
+    uint32_t bus_us;                            /*!< Time spent in the bus functions */
+} gt911_bus_usage_t;
+
+/**
+ * @brief Read one touch report and clear the controller buffer status
+ *
+ * - burst_points = 0: status, then the points, then status clear (3 transactions while touched)
+ * - burst_points > 0: status with burst_points points in one transaction, then status clear (2 transactions,
+ *   when no more points are touched). Every point costs 8 bytes on the bus also when it is not touched, the caller
+ *   selects burst_points by the previous report.
+ *
+ * @param bus          Bus
+ * @param burst_points Points read with the status (0..max_points)
+ * @param max_points   Points to read (1..GT911_MAX_POINTS), more touches are ignored
+ * @param max_keys     Keys to read (0..GT911_MAX_KEYS), 0 = key reports are taken as point reports
+ * @param report       Report output
+ * @param usage        Bus usage output, may be NULL
+ * @return 0 on success, error of the bus function otherwise
+ */
+int gt911_read_report(const gt911_bus_t *bus, uint8_t burst_points, uint8_t max_points, uint8_t max_keys,
+                      gt911_report_t *report, gt911_bus_usage_t *usage);
+
+/**
+ * @brief Read the configuration (GT911_CONFIG_LEN bytes from GT911_REG_CONFIG)
+ *
+ * @return 0 on success, error of the bus function otherwise
+ */
+int gt911_config_read(const gt911_bus_t *bus, uint8_t *config);
+
+/**
+ * @brief Set report period and resolution in the configuration read by gt911_config_read()
+ *
+ * @param config           Configuration
+ * @param report_period_ms Coordinate report period (GT911_REPORT_PERIOD_MIN_MS..GT911_REPORT_PERIOD_MAX_MS), 0 = keep
+ * @param x_res            X resolution, 0 = keep
+ * @param y_res            Y resolution, 0 = keep
+ * @return true if the configuration changed
+ */
+bool gt911_config_set(uint8_t *config, uint8_t report_period_ms, uint16_t x_res, uint16_t y_res);
+
+/**
+ * @brief Report period of the configuration in ms
+ */
+uint8_t gt911_config_report_period_ms(const uint8_t *config);
+
+/**
+ * @brief Checksum of the configuration (value of GT911_REG_CONFIG_CHKSUM)
+ */
+uint8_t gt911_config_checksum(const uint8_t *config);
+
+/**
+ * @brief Write the configuration with its checksum and let the controller take it (Config_Fresh)
+ *
+ * @note The controller stores the configuration into its flash
+ *
+ * @return 0 on success, error of the bus function otherwise
+ */
+int gt911_config_write(const gt911_bus_t *bus, const uint8_t *config);
+
+#ifdef __cplusplus
+}
+#endif
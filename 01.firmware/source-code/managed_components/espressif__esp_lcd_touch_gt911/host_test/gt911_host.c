@@ -0,0 +1,340 @@
+/*
+ * SPDX-FileCopyrightText: 2025 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+/*
+ * Host test of the GT911 register protocol (esp_lcd_touch_gt911_proto.c) on a mock I2C bus.
+ *
+ * The mock is a GT911 register file behind a bus clock: every transaction costs its bits at the bus frequency
+ * (start, address, 16-bit register, repeated start and address for reads, 9 bits per byte, stop) and a fixed
+ * overhead for the driver call and bus turnaround. Reports of separate and burst reads (every count of points read
+ * with the status) are compared with the points written into the registers, the bus time per sample is printed.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include "esp_lcd_touch_gt911_proto.h"
+
+// ------------------------------------------------- Macros and Types --------------------------------------------------
+
+#define MOCK_ERR_FAIL   (0x105)     /* Any non-zero code, ESP_ERR_NOT_FOUND on target */
+
+typedef struct {
+    uint8_t reg[0x10000];           // Register file
+    double now_us;                  // Bus clock
+    double bit_us;                  // One bit at the bus frequency
+    double overhead_us;             // Driver call and turnaround per transaction
+    unsigned int transactions;
+    int fail_at;                    // Transaction which fails (1 = first), 0 = none
+} mock_gt911_t;
+
+typedef struct {
+    const char *name;
+    uint8_t status;                 // Buffer status, count of points in the low nibble
+    uint8_t points;                 // Points written into the registers
+} scenario_t;
+
+// ------------------------------------------------ Static variables ---------------------------------------------------
+
+static const scenario_t scenarios[] = {
+    {"idle",            0x00, 0},
+    {"released",        0x80, 0},
+    {"1 point",         0x81, 1},
+    {"2 points",        0x82, 2},
+    {"5 points",        0x85, 5},
+    {"invalid count",   0x86, 0},
+    {"key",             0x90, 0},
+};
+
+static int failures;
+
+// ------------------------------------------------ Mock I2C -----------------------------------------------------------
+
+static int mock_transaction(mock_gt911_t *mock, unsigned int bits)
+{
+    mock->transactions++;
+    mock->now_us += mock->overhead_us + bits * mock->bit_us;
+    if (mock->fail_at && (int)mock->transactions == mock->fail_at) {
+        return MOCK_ERR_FAIL;
+    }
+    return 0;
+}
+
+static int mock_read(void *ctx, uint16_t reg, uint8_t *data, size_t len)
+{
+    mock_gt911_t *mock = ctx;
+    // S, addr+W, reg H, reg L, Sr, addr+R, data..., P
+    const int err = mock_transaction(mock, 1 + 9 * 3 + 1 + 9 + 9 * len + 1);
+    if (err) {
+        return err;
+    }
+    for (size_t i = 0; i < len; i++) {
+        data[i] = mock->reg[(uint16_t)(reg + i)];
+    }
+    return 0;
+}
+
+static int mock_write(void *ctx, uint16_t reg, const uint8_t *data, size_t len)
+{
+    mock_gt911_t *mock = ctx;
+    // S, addr+W, reg H, reg L, data..., P
+    const int err = mock_transaction(mock, 1 + 9 * 3 + 9 * len + 1);
+    if (err) {
+        return err;
+    }
+    for (size_t i = 0; i < len; i++) {
+        mock->reg[(uint16_t)(reg + i)] = data[i];
+    }
+    return 0;
+}
+
+static int64_t mock_time_us(void *ctx)
+{
+    const mock_gt911_t *mock = ctx;
+    return (int64_t)mock->now_us;
+}
+
+static void mock_init(mock_gt911_t *mock, unsigned int khz, double overhead_us)
+{
+    memset(mock, 0, sizeof(*mock));
+    mock->bit_us = 1000.0 / khz;
+    mock->overhead_us = overhead_us;
+}
+
+// Touch report into the registers, the same values are expected in the report
+static void mock_touch(mock_gt911_t *mock, const scenario_t *sc, unsigned int seed)
+{
+    mock->reg[GT911_REG_READ_XY] = sc->status;
+    for (int i = 0; i < GT911_MAX_POINTS; i++) {
+        uint8_t *p = &mock->reg[GT911_REG_READ_XY + 1 + i * GT911_POINT_LEN];
+        const uint16_t x = (uint16_t)((seed * 37 + i * 101) % 720);
+        const uint16_t y = (uint16_t)((seed * 53 + i * 211) % 1280);
+        const uint16_t strength = (uint16_t)(seed + i * 7);
+        p[0] = (uint8_t)i;
+        p[1] = x & 0xff;
+        p[2] = x >> 8;
+        p[3] = y & 0xff;
+        p[4] = y >> 8;
+        p[5] = strength & 0xff;
+        p[6] = strength >> 8;
+        p[7] = 0;
+    }
+    for (int i = 0; i < GT911_MAX_KEYS; i++) {
+        mock->reg[GT911_REG_READ_KEY + i] = (uint8_t)(((seed >> i) & 1) ? 0x40 : 0);
+    }
+}
+
+// ------------------------------------------------ Checks -------------------------------------------------------------
+
+#define CHECK(cond, ...) do {               \
+        if (!(cond)) {                      \
+            failures++;                     \
+            printf("FAIL: " __VA_ARGS__);   \
+            printf("\n");                   \
+        }                                   \
+    } while (0)
+
+static void check_report(const mock_gt911_t *mock, const scenario_t *sc, uint8_t burst_points, uint8_t max_points, uint8_t max_keys,
+                         const gt911_report_t *report, const gt911_bus_usage_t *usage)
+{
+    char mode[24];
+    snprintf(mode, sizeof(mode), "burst %u", burst_points);
+    const bool key = (max_keys > 0 && sc->status == 0x90);
+
+    CHECK(mock->reg[GT911_REG_READ_XY] == 0, "%s %s: status not cleared", sc->name, mode);
+    if ((sc->status & 0x80) == 0) {
+        CHECK(report->type == GT911_REPORT_NONE, "%s %s: type %d", sc->name, mode, report->type);
+        CHECK(usage->transactions == 2, "%s %s: %u transactions", sc->name, mode, (unsigned)usage->transactions);
+        return;
+    }
+    if (key) {
+        CHECK(report->type == GT911_REPORT_KEYS && report->keys == max_keys, "%s %s: keys", sc->name, mode);
+        for (int i = 0; i < max_keys; i++) {
+            CHECK(report->key[i] == (mock->reg[GT911_REG_READ_KEY + i] ? 1 : 0), "%s %s: key %d", sc->name, mode, i);
+        }
+        return;
+    }
+
+    const uint8_t expected = (sc->points > max_points ? max_points : sc->points);
+    CHECK(report->type == GT911_REPORT_POINTS, "%s %s: type %d", sc->name, mode, report->type);
+    CHECK(report->points == expected, "%s %s max %u: %u points, expected %u", sc->name, mode, max_points, report->points, expected);
+    for (int i = 0; i < report->points && i < expected; i++) {
+        const uint8_t *p = &mock->reg[GT911_REG_READ_XY + 1 + i * GT911_POINT_LEN];
+        CHECK(report->point[i].id == p[0] && report->point[i].x == (p[1] | (p[2] << 8)) && report->point[i].y == (p[3] | (p[4] << 8)) &&
+              report->point[i].strength == (p[5] | (p[6] << 8)), "%s %s: point %d", sc->name, mode, i);
+    }
+    // Status, points which were not in the burst, clear
+    const unsigned int transactions = (burst_points >= expected) ? 2 : 3;
+    CHECK(usage->transactions == transactions, "%s %s: %u transactions, expected %u", sc->name, mode, (unsigned)usage->transactions, transactions);
+}
+
+static void test_reports(void)
+{
+    static const uint8_t max_points_list[] = {1, 2, 5};
+    static const uint8_t max_keys_list[] = {0, 1, 4};
+    mock_gt911_t *mock = malloc(sizeof(mock_gt911_t));
+    const gt911_bus_t bus = {mock_read, mock_write, mock_time_us, mock};
+    unsigned int combinations = 0;
+
+    for (size_t s = 0; s < sizeof(scenarios) / sizeof(scenarios[0]); s++) {
+        for (size_t m = 0; m < sizeof(max_points_list); m++) {
+            for (size_t k = 0; k < sizeof(max_keys_list); k++) {
+                for (uint8_t burst = 0; burst <= max_points_list[m]; burst++) {
+                    gt911_report_t report;
+                    gt911_bus_usage_t usage;
+
+                    mock_init(mock, 400, 0);
+                    mock_touch(mock, &scenarios[s], (unsigned int)(s * 7 + m + 1));
+                    const int err = gt911_read_report(&bus, burst, max_points_list[m], max_keys_list[k], &report, &usage);
+                    CHECK(err == 0, "%s: error %d", scenarios[s].name, err);
+                    CHECK(usage.transactions == mock->transactions, "%s: usage of %u transactions, mock %u", scenarios[s].name,
+                          (unsigned)usage.transactions, mock->transactions);
+                    check_report(mock, &scenarios[s], burst, max_points_list[m], max_keys_list[k], &report, &usage);
+                    combinations++;
+                }
+            }
+        }
+    }
+
+    // A failing transaction is returned, the buffer status stays set for the next reading
+    for (uint8_t burst = 0; burst <= 1; burst++) {
+        for (int fail_at = 1; fail_at <= 3; fail_at++) {
+            gt911_report_t report;
+            mock_init(mock, 400, 0);
+            mock_touch(mock, &scenarios[2], 1);
+            mock->fail_at = fail_at;
+            const int err = gt911_read_report(&bus, burst, 5, 0, &report, NULL);
+            const bool exists = (fail_at <= (burst ? 2 : 3));
+            CHECK(err == (exists ? MOCK_ERR_FAIL : 0), "burst %u fail at %d: error %d", burst, fail_at, err);
+            combinations++;
+        }
+    }
+
+    free(mock);
+    printf("reports: %u combinations\n", combinations);
+}
+
+static void test_config(void)
+{
+    mock_gt911_t *mock = malloc(sizeof(mock_gt911_t));
+    const gt911_bus_t bus = {mock_read, mock_write, mock_time_us, mock};
+    uint8_t config[GT911_CONFIG_LEN];
+    uint8_t sum = 0;
+
+    mock_init(mock, 400, 0);
+    for (int i = 0; i < GT911_CONFIG_LEN; i++) {
+        mock->reg[GT911_REG_CONFIG + i] = (uint8_t)(i * 29 + 3);
+    }
+    mock->reg[GT911_REG_REFRESH_RATE] = 0x35;   // 10 ms, upper bits set
+
+    CHECK(gt911_config_read(&bus, config) == 0, "config read");
+    CHECK(gt911_config_report_period_ms(config) == 10, "report period %u", gt911_config_report_period_ms(config));
+    CHECK(!gt911_config_set(config, 0, 0, 0), "nothing to set");
+    CHECK(!gt911_config_set(config, 10, 0, 0), "same report period");
+    CHECK(gt911_config_set(config, 5, 720, 1280), "report period and resolution");
+    CHECK(config[GT911_REG_REFRESH_RATE - GT911_REG_CONFIG] == 0x30, "refresh rate register 0x%02x", config[GT911_REG_REFRESH_RATE - GT911_REG_CONFIG]);
+    CHECK(!gt911_config_set(config, 5, 720, 1280), "same values");
+    CHECK(!gt911_config_set(config, 1, 0, 0), "period clamped to 5 ms");
+    CHECK(gt911_config_set(config, 30, 0, 0) && gt911_config_report_period_ms(config) == 20, "period clamped to 20 ms");
+    CHECK(gt911_config_set(config, 5, 0, 0), "back to 5 ms");
+
+    CHECK(gt911_config_write(&bus, config) == 0, "config write");
+    for (int reg = GT911_REG_CONFIG; reg <= GT911_REG_CONFIG_CHKSUM; reg++) {
+        sum += mock->reg[reg];
+    }
+    CHECK(sum == 0, "checksum: sum 0x%02x", sum);
+    CHECK(mock->reg[GT911_REG_CONFIG_FRESH] == 1, "config fresh");
+    CHECK(mock->reg[GT911_REG_X_OUTPUT_MAX] == (720 & 0xff) && mock->reg[GT911_REG_X_OUTPUT_MAX + 1] == (720 >> 8), "x resolution");
+    CHECK(mock->reg[GT911_REG_Y_OUTPUT_MAX] == (1280 & 0xff) && mock->reg[GT911_REG_Y_OUTPUT_MAX + 1] == (1280 >> 8), "y resolution");
+    CHECK(mock->transactions == 3, "config: %u transactions", mock->transactions);
+
+    free(mock);
+    printf("config: checksum, report period and resolution\n");
+}
+
+// ------------------------------------------------ Benchmark ----------------------------------------------------------
+
+static double host_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+static void bench(unsigned int khz, double overhead_us, unsigned int loops)
+{
+    static const size_t bench_scenarios[] = {0, 1, 2, 3, 4};
+    static const uint8_t burst_list[] = {0, 1, 2, 5};
+    mock_gt911_t *mock = malloc(sizeof(mock_gt911_t));
+    const gt911_bus_t bus = {mock_read, mock_write, mock_time_us, mock};
+
+    // The driver reads the points of the previous report with the status: the adaptive column is the steady state
+    printf("\nbus time per sample, %u kHz, %.0f us per transaction overhead, 5 points max\n", khz, overhead_us);
+    printf("%-10s %9s %9s %9s %9s %9s %9s\n", "", "separate", "burst 1", "burst 2", "burst 5", "adaptive", "host ns");
+    for (size_t s = 0; s < sizeof(bench_scenarios) / sizeof(bench_scenarios[0]); s++) {
+        const scenario_t *sc = &scenarios[bench_scenarios[s]];
+        double bus_us[sizeof(burst_list) + 1];
+        double ns = 0;
+        for (size_t b = 0; b <= sizeof(burst_list); b++) {
+            const uint8_t burst = (b < sizeof(burst_list) ? burst_list[b] : sc->points);
+            gt911_bus_usage_t usage;
+            gt911_report_t report;
+            uint64_t total = 0;
+
+            mock_init(mock, khz, overhead_us);
+            const double start = host_ns();
+            for (unsigned int i = 0; i < loops; i++) {
+                mock->reg[GT911_REG_READ_XY] = sc->status;
+                gt911_read_report(&bus, burst, GT911_MAX_POINTS, 0, &report, &usage);
+                total += usage.bus_us;
+            }
+            ns += (host_ns() - start) / loops / (sizeof(burst_list) + 1);
+            bus_us[b] = (double)total / loops;
+        }
+        printf("%-10s %7.0fus %7.0fus %7.0fus %7.0fus %7.0fus %9.1f\n", sc->name, bus_us[0], bus_us[1], bus_us[2], bus_us[3], bus_us[4], ns);
+    }
+    free(mock);
+}
+
+// ------------------------------------------------ Main ---------------------------------------------------------------
+
+int main(int argc, char **argv)
+{
+    unsigned int khz = 400;
+    double overhead_us = 50;
+    unsigned int loops = 10000;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "k:o:n:")) != -1) {
+        switch (opt) {
+        case 'k':
+            khz = (unsigned int)atoi(optarg);
+            break;
+        case 'o':
+            overhead_us = atof(optarg);
+            break;
+        case 'n':
+            loops = (unsigned int)atoi(optarg);
+            break;
+        default:
+            fprintf(stderr, "usage: %s [-k bus kHz] [-o overhead us per transaction] [-n loops]\n", argv[0]);
+            return 2;
+        }
+    }
+    if (khz == 0 || loops == 0) {
+        fprintf(stderr, "bus frequency and loops must be positive\n");
+        return 2;
+    }
+
+    test_reports();
+    test_config();
+    bench(khz, overhead_us, loops);
+
+    printf("\n%s: %d failures\n", failures ? "FAILED" : "OK", failures);
+    return failures ? 1 : 0;
+}
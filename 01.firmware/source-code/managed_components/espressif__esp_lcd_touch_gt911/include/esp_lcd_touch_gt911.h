@@ -46,9 +46,40 @@ esp_err_t esp_lcd_touch_new_i2c_gt911(const esp_lcd_panel_io_handle_t io, const
  *
  */
 typedef struct {
-    uint8_t dev_addr;  /*!< I2C device address */
+    uint8_t dev_addr;           /*!< I2C device address */
+    uint8_t report_period_ms;   /*!< Coordinate report period 5..20 ms written into the controller configuration, 0 = keep */
+    uint16_t x_resolution;      /*!< X resolution written into the controller configuration, 0 = keep */
+    uint16_t y_resolution;      /*!< Y resolution written into the controller configuration, 0 = keep */
+    struct {
+        unsigned int burst_read: 1; /*!< Read status with the points of the previous report in one I2C transaction */
+    } flags;
 } esp_lcd_touch_io_gt911_config_t;
 
+/**
+ * @brief GT911 bus statistics
+ *
+ */
+typedef struct {
+    uint32_t samples;           /*!< Calls of esp_lcd_touch_read_data() */
+    uint32_t transactions;      /*!< I2C transactions */
+    uint32_t bytes;             /*!< Data bytes read and written, without address and register */
+    uint32_t errors;            /*!< Failed samples */
+    uint32_t bus_last_us;       /*!< I2C time of the last sample */
+    uint32_t bus_max_us;        /*!< Maximum I2C time of one sample */
+    uint64_t bus_total_us;      /*!< I2C time of all samples */
+} esp_lcd_touch_gt911_stats_t;
+
+/**
+ * @brief Get GT911 bus statistics
+ *
+ * @param tp    Touch instance handle (returned from esp_lcd_touch_new_i2c_gt911)
+ * @param stats Statistics output
+ * @return
+ *      - ESP_OK                    on success
+ *      - ESP_ERR_INVALID_ARG       if the handle is not GT911
+ */
+esp_err_t esp_lcd_touch_gt911_get_stats(esp_lcd_touch_handle_t tp, esp_lcd_touch_gt911_stats_t *stats);
+
 /**
  * @brief Touch IO configuration structure
  *
@@ -85,6 +85,18 @@ typedef struct {
     } flags;
 } lvgl_port_display_dsi_cfg_t;
 
+/**
+ * @brief Copying of changed areas between frame buffers (direct mode with avoid_tearing)
+ */
+typedef struct {
+    uint32_t frames;        /*!< Frames drawn into the frame buffers */
+    uint32_t areas_last;    /*!< Areas copied before the last frame */
+    uint32_t bytes_last;    /*!< Bytes copied before the last frame */
+    uint32_t bytes_max;     /*!< Most bytes copied before one frame */
+    uint64_t bytes_total;   /*!< Bytes copied before all frames */
+    uint64_t bytes_ppa;     /*!< Part of bytes_total copied by PPA */
+} lvgl_port_disp_fb_sync_stats_t;
+
 /**
  * @brief Add I2C/SPI/I8080 display handling to LVGL
  *
@@ -127,6 +139,20 @@ lv_display_t *lvgl_port_add_disp_rgb(const lvgl_port_display_cfg_t *disp_cfg, co
  */
 esp_err_t lvgl_port_remove_disp(lv_display_t *disp);
 
+/**
+ * @brief Get statistics of copying changed areas between frame buffers
+ *
+ * @note Only LVGL8 MIPI-DSI display in direct mode with avoid_tearing copies areas in the port
+ *
+ * @param disp  LVGL display
+ * @param stats Output statistics
+ * @return
+ *      - ESP_OK                    on success
+ *      - ESP_ERR_INVALID_ARG       if argument is NULL
+ *      - ESP_ERR_NOT_SUPPORTED     if the display does not copy areas between frame buffers
+ */
+esp_err_t lvgl_port_disp_get_fb_sync_stats(lv_display_t *disp, lvgl_port_disp_fb_sync_stats_t *stats);
+
 #ifdef __cplusplus
 }
 #endif
@@ -38,8 +38,25 @@ typedef struct {
         float x;
         float y;
     } scale;                        /*!< Touch scale */
+    struct {
+        int      task_priority;     /*!< Priority of the touch reading task, 0 = touch is read in LVGL task (LVGL8 only) */
+        int      task_stack;        /*!< Stack size of the touch reading task, 0 = default */
+        uint32_t period_ms;         /*!< Reading period while pressed or without interrupt pin, 0 = default */
+    } task;                         /*!< Reading the touch in own task, LVGL reads timestamped samples from a queue */
 } lvgl_port_touch_cfg_t;
 
+/**
+ * @brief Statistics of the touch reading task
+ */
+typedef struct {
+    uint32_t samples;               /*!< Samples put into the queue */
+    uint32_t dropped;               /*!< Samples dropped, because the queue was full */
+    uint32_t read_last_us;          /*!< Duration of the last touch controller reading */
+    uint32_t read_max_us;           /*!< Maximum duration of the touch controller reading */
+    uint32_t latency_last_us;       /*!< Time from interrupt (or reading without interrupt) to LVGL of the last sample */
+    uint32_t latency_max_us;        /*!< Maximum time from interrupt to LVGL */
+} lvgl_port_touch_stats_t;
+
 /**
  * @brief Add LCD touch as an input device
  *
@@ -59,6 +76,20 @@ lv_indev_t *lvgl_port_add_touch(const lvgl_port_touch_cfg_t *touch_cfg);
  *      - ESP_OK                    on success
  */
 esp_err_t lvgl_port_remove_touch(lv_indev_t *touch);
+
+/**
+ * @brief Get statistics of the touch reading task
+ *
+ * @note Only for touch added with `task.task_priority` in LVGL8
+ *
+ * @param touch Touch input device (returned from lvgl_port_add_touch)
+ * @param stats Statistics output
+ * @return
+ *      - ESP_OK                    on success
+ *      - ESP_ERR_INVALID_ARG       if the touch is not read by own task
+ *      - ESP_ERR_NOT_SUPPORTED     in LVGL9
+ */
+esp_err_t lvgl_port_touch_get_stats(lv_indev_t *touch, lvgl_port_touch_stats_t *stats);
 #endif
 
 #ifdef __cplusplus
@@ -42,6 +42,13 @@ typedef struct {
  */
 bool lvgl_port_task_notify(uint32_t value);
 
+/**
+ * @brief Wait for flush done notification (lvgl_port_task_notify) instead of busy loop
+ *
+ * @note It is used as LVGL8 display driver wait_cb
+ */
+void lvgl_port_flush_wait(void);
+
 #ifdef __cplusplus
 }
 #endif
@@ -0,0 +1,360 @@
+/*
+ * SPDX-FileCopyrightText: 2025 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <stdbool.h>
+#include <string.h>
+#include "blend_rgb565.h"
+
+/*******************************************************************************
+* Macros
+*******************************************************************************/
+
+#define OPA_MAX         LVGL_PORT_BLEND_RGB565_OPA_MAX
+#define ROUND_OFS       LVGL_PORT_BLEND_RGB565_MIX_ROUND_OFS
+#define ROUND_OFS_X2    (ROUND_OFS * 0x00010001U)
+
+/* LV_UDIV255() */
+#define UDIV255(x)      (((x) * 0x8081U) >> 0x17)
+
+/* R moved to bits 16..20, B stays in bits 0..4: every channel has 16 bits for the products */
+#define RB(p)           ((((uint32_t)(p) & 0xF800U) << 5) | ((uint32_t)(p) & 0x001FU))
+/* G of two pixels (the first one in the low half) to bits 0..5 and 16..21 */
+#define G2(w)           (((uint32_t)(w) >> 5) & 0x003F003FU)
+/* Division by 255 of two 16-bit lanes. Same as UDIV255() for lane values up to 65534, the sums are below 16384. */
+#define DIV255_X2(v)    (((((v) + 0x00010001U + (((v) >> 8) & 0x00FF00FFU)) >> 8)) & 0x00FF00FFU)
+
+/*******************************************************************************
+* Reference
+*******************************************************************************/
+
+/* lv_color_mix() */
+static inline uint16_t mix_ref(uint16_t c1, uint16_t c2, uint32_t mix)
+{
+    const uint32_t mix_inv = 255 - mix;
+    const uint32_t r = UDIV255((uint32_t)(c1 >> 11) * mix + (uint32_t)(c2 >> 11) * mix_inv + ROUND_OFS);
+    const uint32_t g = UDIV255((uint32_t)((c1 >> 5) & 0x3F) * mix + (uint32_t)((c2 >> 5) & 0x3F) * mix_inv + ROUND_OFS);
+    const uint32_t b = UDIV255((uint32_t)(c1 & 0x1F) * mix + (uint32_t)(c2 & 0x1F) * mix_inv + ROUND_OFS);
+
+    return (uint16_t)((r << 11) | (g << 5) | b);
+}
+
+void lvgl_port_blend_rgb565_ref(const lvgl_port_blend_rgb565_dsc_t *dsc)
+{
+    uint16_t *dest = dsc->dest_buf;
+    const uint16_t *src = dsc->src_buf;
+    const uint8_t *mask = dsc->mask_buf;
+    const uint32_t opa = dsc->opa;
+
+    for (int32_t y = 0; y < dsc->dest_h; y++) {
+        for (int32_t x = 0; x < dsc->dest_w; x++) {
+            const uint16_t fg = src ? src[x] : dsc->color;
+            uint32_t a;
+
+            if (mask == NULL) {
+                a = (opa >= OPA_MAX) ? 255 : opa;
+            } else if (mask[x] == 0) {
+                continue;
+            } else if (src == NULL) {
+                /* fill_normal(): above OPA_MAX only the mask matters */
+                if (opa >= OPA_MAX) {
+                    a = mask[x];
+                } else {
+                    a = (mask[x] == 255) ? opa : ((uint32_t)mask[x] * opa) >> 8;
+                }
+            } else {
+                /* map_normal(): note the different limits */
+                if (opa > OPA_MAX) {
+                    a = mask[x];
+                } else {
+                    a = (mask[x] >= OPA_MAX) ? opa : (opa * mask[x]) >> 8;
+                }
+            }
+            dest[x] = (a == 255) ? fg : mix_ref(fg, dest[x], a);
+        }
+        dest += dsc->dest_stride;
+        if (src) {
+            src += dsc->src_stride;
+        }
+        if (mask) {
+            mask += dsc->mask_stride;
+        }
+    }
+}
+
+/*******************************************************************************
+* Optimized
+*******************************************************************************/
+
+/* One pixel */
+static inline uint16_t mix_px(uint32_t fg, uint32_t bg, uint32_t a)
+{
+    const uint32_t a_inv = 255 - a;
+    const uint32_t rb = DIV255_X2(RB(fg) * a + RB(bg) * a_inv + ROUND_OFS_X2);
+    const uint32_t g = DIV255_X2(G2(fg) * a + G2(bg) * a_inv + ROUND_OFS);
+
+    return (uint16_t)(((rb >> 5) & 0xF800) | (g << 5) | (rb & 0x1F));
+}
+
+/* Two pixels (the first one in the low half) with the same alpha, foreground already multiplied and rounded */
+static inline uint32_t mix_px2_premult(uint32_t fg_rb0, uint32_t fg_rb1, uint32_t fg_g2, uint32_t bg2, uint32_t a_inv)
+{
+    const uint32_t rb0 = DIV255_X2(fg_rb0 + RB(bg2 & 0xFFFF) * a_inv);
+    const uint32_t rb1 = DIV255_X2(fg_rb1 + RB(bg2 >> 16) * a_inv);
+    const uint32_t g2 = DIV255_X2(fg_g2 + G2(bg2) * a_inv);
+
+    return (((rb0 >> 5) & 0xF800) | (rb0 & 0x1F)) | ((((rb1 >> 5) & 0xF800) | (rb1 & 0x1F)) << 16) | (g2 << 5);
+}
+
+static void fill_row(uint16_t *dest, uint16_t color, int32_t w)
+{
+    const uint32_t color2 = color | ((uint32_t)color << 16);
+
+    if (((uintptr_t)dest & 0x2) && w > 0) {
+        *dest++ = color;
+        w--;
+    }
+    uint32_t *dest32 = (uint32_t *)dest;
+    for (; w >= 8; w -= 8) {
+        dest32[0] = color2;
+        dest32[1] = color2;
+        dest32[2] = color2;
+        dest32[3] = color2;
+        dest32 += 4;
+    }
+    for (; w >= 2; w -= 2) {
+        *dest32++ = color2;
+    }
+    if (w) {
+        *(uint16_t *)dest32 = color;
+    }
+}
+
+static void fill_opa(const lvgl_port_blend_rgb565_dsc_t *dsc)
+{
+    const uint32_t color = dsc->color;
+    const uint32_t a_inv = 255 - dsc->opa;
+    const uint32_t fg_rb = RB(color) * dsc->opa + ROUND_OFS_X2;
+    const uint32_t fg_g2 = G2(color | (color << 16)) * dsc->opa + ROUND_OFS_X2;
+    uint16_t *dest = dsc->dest_buf;
+
+    /* Backgrounds are mostly plain, the result of the last pixel pair is reused */
+    uint32_t last_bg = 0;
+    uint32_t last_res = mix_px2_premult(fg_rb, fg_rb, fg_g2, last_bg, a_inv);
+
+    for (int32_t y = 0; y < dsc->dest_h; y++) {
+        uint16_t *d = dest;
+        int32_t w = dsc->dest_w;
+
+        if (((uintptr_t)d & 0x2) && w > 0) {
+            *d = (uint16_t)mix_px2_premult(fg_rb, fg_rb, fg_g2, *d, a_inv);
+            d++;
+            w--;
+        }
+        uint32_t *d32 = (uint32_t *)d;
+        for (; w >= 2; w -= 2, d32++) {
+            const uint32_t bg = *d32;
+            if (bg != last_bg) {
+                last_bg = bg;
+                last_res = mix_px2_premult(fg_rb, fg_rb, fg_g2, bg, a_inv);
+            }
+            *d32 = last_res;
+        }
+        if (w) {
+            d = (uint16_t *)d32;
+            *d = (uint16_t)mix_px2_premult(fg_rb, fg_rb, fg_g2, *d, a_inv);
+        }
+        dest += dsc->dest_stride;
+    }
+}
+
+static inline void fill_mask_px(uint16_t *dest, uint32_t color, uint32_t m, uint32_t opa)
+{
+    if (m == 0) {
+        return;
+    }
+    if (opa >= OPA_MAX) {
+        *dest = (m == 255) ? (uint16_t)color : mix_px(color, *dest, m);
+    } else {
+        *dest = mix_px(color, *dest, (m == 255) ? opa : (m * opa) >> 8);
+    }
+}
+
+static void fill_mask(const lvgl_port_blend_rgb565_dsc_t *dsc)
+{
+    const uint32_t color = dsc->color;
+    const uint32_t opa = dsc->opa;
+    const uint32_t a_inv = 255 - opa;
+    const uint32_t fg_rb = RB(color) * opa + ROUND_OFS_X2;
+    const uint32_t fg_g2 = G2(color | (color << 16)) * opa + ROUND_OFS_X2;
+    uint16_t *dest = dsc->dest_buf;
+    const uint8_t *mask = dsc->mask_buf;
+    const int32_t w = dsc->dest_w;
+
+    for (int32_t y = 0; y < dsc->dest_h; y++) {
+        int32_t x = 0;
+
+        for (; x < w && ((uintptr_t)(mask + x) & 0x3); x++) {
+            fill_mask_px(&dest[x], color, mask[x], opa);
+        }
+        /* Four mask values at once, runs of transparent and covering pixels are common */
+        for (; x <= w - 4; x += 4) {
+            const uint32_t mask4 = *(const uint32_t *)(mask + x);
+            if (mask4 == 0) {
+                continue;
+            }
+            if (mask4 == 0xFFFFFFFF) {
+                if (opa >= OPA_MAX) {
+                    dest[x] = color;
+                    dest[x + 1] = color;
+                    dest[x + 2] = color;
+                    dest[x + 3] = color;
+                } else {
+                    for (int i = 0; i < 4; i += 2) {
+                        const uint32_t res = mix_px2_premult(fg_rb, fg_rb, fg_g2, dest[x + i] | ((uint32_t)dest[x + i + 1] << 16), a_inv);
+                        dest[x + i] = (uint16_t)res;
+                        dest[x + i + 1] = (uint16_t)(res >> 16);
+                    }
+                }
+                continue;
+            }
+            fill_mask_px(&dest[x], color, mask[x], opa);
+            fill_mask_px(&dest[x + 1], color, mask[x + 1], opa);
+            fill_mask_px(&dest[x + 2], color, mask[x + 2], opa);
+            fill_mask_px(&dest[x + 3], color, mask[x + 3], opa);
+        }
+        for (; x < w; x++) {
+            fill_mask_px(&dest[x], color, mask[x], opa);
+        }
+        dest += dsc->dest_stride;
+        mask += dsc->mask_stride;
+    }
+}
+
+/* Two image pixels on two destination pixels with the same alpha */
+static inline void dest_px2_mix(uint16_t *dest, const uint16_t *src, uint32_t a)
+{
+    const uint32_t s0 = src[0];
+    const uint32_t s1 = src[1];
+    const uint32_t res = mix_px2_premult(RB(s0) * a + ROUND_OFS_X2, RB(s1) * a + ROUND_OFS_X2,
+                                         G2(s0 | (s1 << 16)) * a + ROUND_OFS_X2,
+                                         dest[0] | ((uint32_t)dest[1] << 16), 255 - a);
+    dest[0] = (uint16_t)res;
+    dest[1] = (uint16_t)(res >> 16);
+}
+
+static void map_opa(const lvgl_port_blend_rgb565_dsc_t *dsc)
+{
+    const uint32_t opa = dsc->opa;
+    uint16_t *dest = dsc->dest_buf;
+    const uint16_t *src = dsc->src_buf;
+    const int32_t w = dsc->dest_w;
+
+    for (int32_t y = 0; y < dsc->dest_h; y++) {
+        int32_t x = 0;
+
+        for (; x <= w - 2; x += 2) {
+            dest_px2_mix(&dest[x], &src[x], opa);
+        }
+        if (x < w) {
+            dest[x] = mix_px(src[x], dest[x], opa);
+        }
+        dest += dsc->dest_stride;
+        src += dsc->src_stride;
+    }
+}
+
+static inline void map_mask_px(uint16_t *dest, uint32_t src, uint32_t m, uint32_t opa)
+{
+    if (m == 0) {
+        return;
+    }
+    if (opa > OPA_MAX) {
+        *dest = (m == 255) ? (uint16_t)src : mix_px(src, *dest, m);
+    } else {
+        *dest = mix_px(src, *dest, (m >= OPA_MAX) ? opa : (opa * m) >> 8);
+    }
+}
+
+static void map_mask(const lvgl_port_blend_rgb565_dsc_t *dsc)
+{
+    const uint32_t opa = dsc->opa;
+    uint16_t *dest = dsc->dest_buf;
+    const uint16_t *src = dsc->src_buf;
+    const uint8_t *mask = dsc->mask_buf;
+    const int32_t w = dsc->dest_w;
+
+    for (int32_t y = 0; y < dsc->dest_h; y++) {
+        int32_t x = 0;
+
+        for (; x < w && ((uintptr_t)(mask + x) & 0x3); x++) {
+            map_mask_px(&dest[x], src[x], mask[x], opa);
+        }
+        for (; x <= w - 4; x += 4) {
+            const uint32_t mask4 = *(const uint32_t *)(mask + x);
+            if (mask4 == 0) {
+                continue;
+            }
+            if (mask4 == 0xFFFFFFFF) {
+                if (opa > OPA_MAX) {
+                    dest[x] = src[x];
+                    dest[x + 1] = src[x + 1];
+                    dest[x + 2] = src[x + 2];
+                    dest[x + 3] = src[x + 3];
+                } else {
+                    for (int i = 0; i < 4; i += 2) {
+                        dest_px2_mix(&dest[x + i], &src[x + i], opa);
+                    }
+                }
+                continue;
+            }
+            map_mask_px(&dest[x], src[x], mask[x], opa);
+            map_mask_px(&dest[x + 1], src[x + 1], mask[x + 1], opa);
+            map_mask_px(&dest[x + 2], src[x + 2], mask[x + 2], opa);
+            map_mask_px(&dest[x + 3], src[x + 3], mask[x + 3], opa);
+        }
+        for (; x < w; x++) {
+            map_mask_px(&dest[x], src[x], mask[x], opa);
+        }
+        dest += dsc->dest_stride;
+        src += dsc->src_stride;
+        mask += dsc->mask_stride;
+    }
+}
+
+void lvgl_port_blend_rgb565_esp(const lvgl_port_blend_rgb565_dsc_t *dsc)
+{
+    if (dsc->dest_w <= 0 || dsc->dest_h <= 0) {
+        return;
+    }
+
+    if (dsc->src_buf == NULL) {
+        if (dsc->mask_buf) {
+            fill_mask(dsc);
+        } else if (dsc->opa >= OPA_MAX) {
+            uint16_t *dest = dsc->dest_buf;
+            for (int32_t y = 0; y < dsc->dest_h; y++) {
+                fill_row(dest, dsc->color, dsc->dest_w);
+                dest += dsc->dest_stride;
+            }
+        } else {
+            fill_opa(dsc);
+        }
+    } else {
+        if (dsc->mask_buf) {
+            map_mask(dsc);
+        } else if (dsc->opa >= OPA_MAX) {
+            uint16_t *dest = dsc->dest_buf;
+            const uint16_t *src = dsc->src_buf;
+            for (int32_t y = 0; y < dsc->dest_h; y++) {
+                memcpy(dest, src, dsc->dest_w * sizeof(uint16_t));
+                dest += dsc->dest_stride;
+                src += dsc->src_stride;
+            }
+        } else {
+            map_opa(dsc);
+        }
+    }
+}
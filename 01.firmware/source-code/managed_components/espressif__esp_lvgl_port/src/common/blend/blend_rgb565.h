@@ -0,0 +1,66 @@
+/*
+ * SPDX-FileCopyrightText: 2025 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+/**
+ * @file
+ * @brief RGB565 blending kernels for LVGL8 software rendering
+ *
+ * Normal blend mode of lv_draw_sw_blend_basic() (LVGL 8.4) for RGB565 without byte swap: fill and image copy,
+ * with and without mask and opacity. The kernels give the same pixels as LVGL with LV_COLOR_MIX_ROUND_OFS
+ * equal to LVGL_PORT_BLEND_RGB565_MIX_ROUND_OFS.
+ *
+ * - lvgl_port_blend_rgb565_ref(): portable C, pixel by pixel as LVGL does it, reference for tests
+ * - lvgl_port_blend_rgb565_esp(): 32-bit stores, two pixels per color mix, for RISC-V targets (esp32p4)
+ *
+ * No LVGL or ESP-IDF headers are needed, the kernels can be built and tested on host.
+ */
+
+#pragma once
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define LVGL_PORT_BLEND_RGB565_OPA_MAX          253 /* LV_OPA_MAX */
+#define LVGL_PORT_BLEND_RGB565_MIX_ROUND_OFS    128 /* LV_COLOR_MIX_ROUND_OFS of 16-bit colors */
+
+/**
+ * @brief Blend descriptor
+ */
+typedef struct {
+    uint16_t        *dest_buf;      /*!< First pixel of the blended area */
+    int32_t         dest_w;         /*!< Width of the blended area in pixels */
+    int32_t         dest_h;         /*!< Height of the blended area in pixels */
+    int32_t         dest_stride;    /*!< Destination line length in pixels */
+    const uint16_t  *src_buf;       /*!< First pixel of the image, NULL for fill with color */
+    int32_t         src_stride;     /*!< Image line length in pixels */
+    const uint8_t   *mask_buf;      /*!< First value of the alpha mask, NULL without mask */
+    int32_t         mask_stride;    /*!< Mask line length */
+    uint16_t        color;          /*!< Fill color */
+    uint8_t         opa;            /*!< Overall opacity (LV_OPA_MIN < opa) */
+} lvgl_port_blend_rgb565_dsc_t;
+
+/**
+ * @brief Blend, portable reference
+ *
+ * @param dsc   Blend descriptor
+ */
+void lvgl_port_blend_rgb565_ref(const lvgl_port_blend_rgb565_dsc_t *dsc);
+
+/**
+ * @brief Blend, optimized
+ *
+ * @note dest_buf and src_buf must be 2-byte aligned (lv_color_t), mask_buf may have any alignment
+ *
+ * @param dsc   Blend descriptor
+ */
+void lvgl_port_blend_rgb565_esp(const lvgl_port_blend_rgb565_dsc_t *dsc);
+
+#ifdef __cplusplus
+}
+#endif
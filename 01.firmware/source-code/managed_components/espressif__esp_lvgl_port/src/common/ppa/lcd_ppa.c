@@ -55,9 +55,11 @@ lvgl_port_ppa_handle_t lvgl_port_ppa_create(const lvgl_port_ppa_cfg_t *cfg)
         buffer_caps |= MALLOC_CAP_DEFAULT;
     }
 
-    ppa_ctx->buffer_size = ALIGN_UP(cfg->buffer_size, CONFIG_CACHE_L2_CACHE_LINE_SIZE);
-    ppa_ctx->buffer = heap_caps_aligned_calloc(CONFIG_CACHE_L2_CACHE_LINE_SIZE, ppa_ctx->buffer_size, sizeof(uint8_t), buffer_caps);
-    assert(ppa_ctx->buffer != NULL);
+    if (cfg->buffer_size > 0) {
+        ppa_ctx->buffer_size = ALIGN_UP(cfg->buffer_size, CONFIG_CACHE_L2_CACHE_LINE_SIZE);
+        ppa_ctx->buffer = heap_caps_aligned_calloc(CONFIG_CACHE_L2_CACHE_LINE_SIZE, ppa_ctx->buffer_size, sizeof(uint8_t), buffer_caps);
+        assert(ppa_ctx->buffer != NULL);
+    }
 
     ppa_client_config_t ppa_client_config = {
         .oper_type = PPA_OPERATION_SRM,
@@ -189,6 +191,44 @@ esp_err_t lvgl_port_ppa_rotate(lvgl_port_ppa_handle_t handle, lvgl_port_ppa_disp
     return ppa_do_scale_rotate_mirror(ppa_ctx->srm_handle, &srm_oper_config);
 }
 
+esp_err_t lvgl_port_ppa_copy(lvgl_port_ppa_handle_t handle, const lvgl_port_ppa_disp_copy_t *copy_cfg)
+{
+    lvgl_port_ppa_t *ppa_ctx = (lvgl_port_ppa_t *)handle;
+    assert(ppa_ctx != NULL);
+    assert(copy_cfg != NULL);
+    const int w = copy_cfg->area.x2 - copy_cfg->area.x1 + 1;
+    const int h = copy_cfg->area.y2 - copy_cfg->area.y1 + 1;
+
+    /* Same block in both frames, no scaling, rotation or conversion */
+    ppa_srm_oper_config_t srm_oper_config = {
+        .in.buffer = copy_cfg->in_buff,
+        .in.pic_w = copy_cfg->disp_size.hres,
+        .in.pic_h = copy_cfg->disp_size.vres,
+        .in.block_w = w,
+        .in.block_h = h,
+        .in.block_offset_x = copy_cfg->area.x1,
+        .in.block_offset_y = copy_cfg->area.y1,
+        .in.srm_cm = ppa_ctx->color_type_id,
+
+        .out.buffer = copy_cfg->out_buff,
+        .out.buffer_size = copy_cfg->out_buff_size,
+        .out.pic_w = copy_cfg->disp_size.hres,
+        .out.pic_h = copy_cfg->disp_size.vres,
+        .out.block_offset_x = copy_cfg->area.x1,
+        .out.block_offset_y = copy_cfg->area.y1,
+        .out.srm_cm = ppa_ctx->color_type_id,
+
+        .rotation_angle = PPA_SRM_ROTATION_ANGLE_0,
+        .scale_x = 1.0,
+        .scale_y = 1.0,
+
+        .mode = copy_cfg->ppa_mode,
+        .user_data = copy_cfg->user_data,
+    };
+
+    return ppa_do_scale_rotate_mirror(ppa_ctx->srm_handle, &srm_oper_config);
+}
+
 #if PPA_LCD_ENABLE_CB
 static bool _lvgl_port_ppa_callback(ppa_client_handle_t ppa_client, ppa_event_data_t *event_data, void *user_data)
 {
@@ -23,7 +23,7 @@ typedef lvgl_port_ppa_t *lvgl_port_ppa_handle_t;
  * @brief Init configuration structure
  */
 typedef struct {
-    uint32_t        buffer_size;  /*!< Size of the buffer for the PPA */
+    uint32_t        buffer_size;  /*!< Size of the buffer for the PPA (0: no output buffer, copy only) */
     color_space_t   color_space;  /*!< Color space of input/output data */
     uint32_t        pixel_format; /*!< Pixel format of input/output data */
     struct {
@@ -63,6 +63,19 @@ typedef struct {
     void                      *user_data;
 } lvgl_port_ppa_disp_rotate_t;
 
+/**
+ * @brief Copy configuration
+ */
+typedef struct {
+    uint8_t                   *in_buff;       /*!< Source frame */
+    uint8_t                   *out_buff;      /*!< Destination frame, same size and format as the source */
+    uint32_t                  out_buff_size;  /*!< Size of the destination frame in bytes */
+    lvgl_port_ppa_disp_area_t area;           /*!< Coordinates of area, same in both frames */
+    lvgl_port_ppa_disp_size_t disp_size;      /*!< Display (frame) size */
+    ppa_trans_mode_t          ppa_mode;       /*!< Blocking or non-blocking mode */
+    void                      *user_data;
+} lvgl_port_ppa_disp_copy_t;
+
 
 /**
  * @brief Initialize PPA
@@ -106,6 +119,20 @@ uint8_t *lvgl_port_ppa_get_output_buffer(lvgl_port_ppa_handle_t handle);
  */
 esp_err_t lvgl_port_ppa_rotate(lvgl_port_ppa_handle_t handle, lvgl_port_ppa_disp_rotate_t *rotate_cfg);
 
+/**
+ * @brief Copy area between two frames
+ *
+ * @note The output buffer of the handle is not used, it can be created with zero buffer_size.
+ *
+ * @param handle   PPA LCD handle
+ * @param copy_cfg   Copy settings
+ *
+ * @return
+ *      - ESP_OK                    on success
+ *      - ESP_ERR_INVALID_ARG       if the area or buffers are not valid for PPA
+ */
+esp_err_t lvgl_port_ppa_copy(lvgl_port_ppa_handle_t handle, const lvgl_port_ppa_disp_copy_t *copy_cfg);
+
 #ifdef __cplusplus
 }
 #endif
@@ -13,6 +13,7 @@
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
 #include "freertos/semphr.h"
+#include "freertos/event_groups.h"
 #include "esp_lvgl_port.h"
 #include "esp_lvgl_port_priv.h"
 #include "lvgl.h"
@@ -20,6 +21,7 @@
 static const char *TAG = "LVGL";
 
 #define ESP_LVGL_PORT_TASK_MUX_DELAY_MS    10000
+#define ESP_LVGL_PORT_FLUSH_WAIT_MS        20
 
 /*******************************************************************************
 * Types definitions
@@ -29,6 +31,7 @@ typedef struct lvgl_port_ctx_s {
     TaskHandle_t        lvgl_task;
     SemaphoreHandle_t   lvgl_mux;
     SemaphoreHandle_t   task_mux;
+    EventGroupHandle_t  lvgl_events;
     esp_timer_handle_t  tick_timer;
     bool                running;
     int                 task_max_sleep_ms;
@@ -75,6 +78,9 @@ esp_err_t lvgl_port_init(const lvgl_port_cfg_t *cfg)
     /* Task semaphore */
     lvgl_port_ctx.task_mux = xSemaphoreCreateMutex();
     ESP_GOTO_ON_FALSE(lvgl_port_ctx.task_mux, ESP_ERR_NO_MEM, err, TAG, "Create LVGL task sem fail!");
+    /* Task wake events */
+    lvgl_port_ctx.lvgl_events = xEventGroupCreate();
+    ESP_GOTO_ON_FALSE(lvgl_port_ctx.lvgl_events, ESP_ERR_NO_MEM, err, TAG, "Create LVGL Event Group fail!");
 
     BaseType_t res;
     if (cfg->task_affinity < 0) {
@@ -154,12 +160,43 @@ void lvgl_port_unlock(void)
 {
     assert(lvgl_port_ctx.lvgl_mux && "lvgl_port_init must be called first");
     xSemaphoreGiveRecursive(lvgl_port_ctx.lvgl_mux);
+
+    /* Other task changed LVGL objects (invalidate, animations, timers), LVGL task has to re-check its timers */
+    TaskHandle_t self = xTaskGetCurrentTaskHandle();
+    if (self != lvgl_port_ctx.lvgl_task && xSemaphoreGetMutexHolder(lvgl_port_ctx.lvgl_mux) != self) {
+        lvgl_port_task_wake(LVGL_PORT_EVENT_USER, NULL);
+    }
 }
 
 esp_err_t lvgl_port_task_wake(lvgl_port_event_type_t event, void *param)
 {
-    ESP_LOGE(TAG, "Task wake is not supported, when used LVGL8!");
-    return ESP_ERR_NOT_SUPPORTED;
+    EventBits_t bits = 0;
+    if (!lvgl_port_ctx.lvgl_events) {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    /* Get unprocessed bits */
+    if (xPortInIsrContext() == pdTRUE) {
+        bits = xEventGroupGetBitsFromISR(lvgl_port_ctx.lvgl_events);
+    } else {
+        bits = xEventGroupGetBits(lvgl_port_ctx.lvgl_events);
+    }
+
+    /* Set event */
+    bits |= event;
+
+    /* Save */
+    if (xPortInIsrContext() == pdTRUE) {
+        BaseType_t xHigherPriorityTaskWoken = pdFALSE;
+        xEventGroupSetBitsFromISR(lvgl_port_ctx.lvgl_events, bits, &xHigherPriorityTaskWoken);
+        if (xHigherPriorityTaskWoken) {
+            portYIELD_FROM_ISR( );
+        }
+    } else {
+        xEventGroupSetBits(lvgl_port_ctx.lvgl_events, bits);
+    }
+
+    return ESP_OK;
 }
 
 IRAM_ATTR bool lvgl_port_task_notify(uint32_t value)
@@ -176,13 +213,25 @@ IRAM_ATTR bool lvgl_port_task_notify(uint32_t value)
     return (need_yield == pdTRUE);
 }
 
+void lvgl_port_flush_wait(void)
+{
+    /* Flush done is notified only to LVGL task (lvgl_port_task_notify), others (lv_refr_now) only yield */
+    if (xTaskGetCurrentTaskHandle() == lvgl_port_ctx.lvgl_task) {
+        xTaskNotifyWait(0, 0, NULL, pdMS_TO_TICKS(ESP_LVGL_PORT_FLUSH_WAIT_MS));
+    } else {
+        taskYIELD();
+    }
+}
+
 /*******************************************************************************
 * Private functions
 *******************************************************************************/
 
 static void lvgl_port_task(void *arg)
 {
-    uint32_t task_delay_ms = lvgl_port_ctx.task_max_sleep_ms;
+    EventBits_t events = 0;
+    uint32_t task_delay_ms = 0;
+    lv_indev_t *indev = NULL;
 
     /* Take the task semaphore */
     if (xSemaphoreTake(lvgl_port_ctx.task_mux, 0) != pdTRUE) {
@@ -194,16 +243,35 @@ static void lvgl_port_task(void *arg)
     ESP_LOGI(TAG, "Starting LVGL task");
     lvgl_port_ctx.running = true;
     while (lvgl_port_ctx.running) {
+        /* Sleep till the next LVGL timer or till wake event (touch interrupt, input, other task unlock) */
+        TickType_t wait = (pdMS_TO_TICKS(task_delay_ms) >= 1 ? pdMS_TO_TICKS(task_delay_ms) : 1);
+        events = xEventGroupWaitBits(lvgl_port_ctx.lvgl_events, 0xFF, pdTRUE, pdFALSE, wait);
+
         if (lvgl_port_lock(0)) {
+            /* Call read input devices */
+            if (events & LVGL_PORT_EVENT_TOUCH) {
+                indev = lv_indev_get_next(NULL);
+                while (indev != NULL) {
+                    lv_indev_read_timer_cb(indev->driver->read_timer);
+                    indev = lv_indev_get_next(indev);
+                }
+            }
+
+            /* Handle LVGL */
             task_delay_ms = lv_timer_handler();
             lvgl_port_unlock();
+        } else {
+            task_delay_ms = 1; /*Keep trying*/
         }
-        if (task_delay_ms > lvgl_port_ctx.task_max_sleep_ms) {
+
+        if (task_delay_ms == LV_NO_TIMER_READY || task_delay_ms > lvgl_port_ctx.task_max_sleep_ms) {
             task_delay_ms = lvgl_port_ctx.task_max_sleep_ms;
-        } else if (task_delay_ms < 5) {
-            task_delay_ms = 5;
         }
-        vTaskDelay(pdMS_TO_TICKS(task_delay_ms));
+
+        /* Minimal dealy for the task, when woken by events. When there is too much events, it takes time for other tasks and interrupts. */
+        if (events) {
+            vTaskDelay(1);
+        }
     }
 
     /* Give semaphore back */
@@ -221,6 +289,9 @@ static void lvgl_port_task_deinit(void)
     if (lvgl_port_ctx.task_mux) {
         vSemaphoreDelete(lvgl_port_ctx.task_mux);
     }
+    if (lvgl_port_ctx.lvgl_events) {
+        vEventGroupDelete(lvgl_port_ctx.lvgl_events);
+    }
     memset(&lvgl_port_ctx, 0, sizeof(lvgl_port_ctx));
 #if LV_ENABLE_GC || !LV_MEM_CUSTOM
     /* Deinitialize LVGL */
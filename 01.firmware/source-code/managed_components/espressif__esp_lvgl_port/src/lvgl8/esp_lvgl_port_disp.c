@@ -4,6 +4,7 @@
  * SPDX-License-Identifier: Apache-2.0
  */
 
+#include <stdlib.h>
 #include <string.h>
 #include "esp_log.h"
 #include "esp_err.h"
@@ -24,8 +25,31 @@
 
 #if (CONFIG_IDF_TARGET_ESP32P4 && ESP_IDF_VERSION >= ESP_IDF_VERSION_VAL(5, 3, 0))
 #include "esp_lcd_mipi_dsi.h"
+#include "esp_cache.h"
+#define LVGL_PORT_FB_SYNC   1
+#else
+#define LVGL_PORT_FB_SYNC   0
+#endif
+
+#define LVGL_PORT_FB_SYNC_PPA   (LVGL_PORT_FB_SYNC && CONFIG_LVGL_PORT_FB_SYNC_PPA)
+
+#if LVGL_PORT_FB_SYNC_PPA
+#include "../common/ppa/lcd_ppa.h"
+/* Smaller areas are copied by CPU, PPA transaction setup costs more */
+#define LVGL_PORT_FB_SYNC_PPA_MIN_PX    (64 * 64)
 #endif
 
+#define LVGL_PORT_FB_AREAS_MAX  (LV_INV_BUF_SIZE)
+
+#if CONFIG_LVGL_PORT_LV8_BLEND_RGB565
+#include "draw/sw/lv_draw_sw.h"
+#include "../common/blend/blend_rgb565.h"
+#endif
+
+/* The kernels give the same pixels as LVGL only for this color format */
+#define LVGL_PORT_BLEND_RGB565  (CONFIG_LVGL_PORT_LV8_BLEND_RGB565 && LV_COLOR_DEPTH == 16 && LV_COLOR_16_SWAP == 0 && \
+                                 LV_COLOR_MIX_ROUND_OFS == LVGL_PORT_BLEND_RGB565_MIX_ROUND_OFS)
+
 #if (ESP_IDF_VERSION < ESP_IDF_VERSION_VAL(4, 4, 4)) || (ESP_IDF_VERSION == ESP_IDF_VERSION_VAL(5, 0, 0))
 #define LVGL_PORT_HANDLE_FLUSH_READY 0
 #else
@@ -38,6 +62,11 @@ static const char *TAG = "LVGL";
 * Types definitions
 *******************************************************************************/
 
+typedef struct {
+    lv_area_t   area[LVGL_PORT_FB_AREAS_MAX];   /* Not overlapping areas */
+    uint16_t    cnt;                            /* Count of areas */
+} lvgl_port_fb_areas_t;
+
 typedef struct {
     lvgl_port_disp_type_t     disp_type;    /* Display type */
     esp_lcd_panel_io_handle_t io_handle;    /* LCD panel IO handle */
@@ -48,6 +77,15 @@ typedef struct {
     lv_color_t                *trans_buf;   /* Buffer send to driver */
     uint32_t                  trans_size;   /* Maximum size for one transport */
     SemaphoreHandle_t         trans_sem;    /* Idle transfer mutex */
+    bool                      fb_draw_buf;  /* Draw buffers are the panel frame buffers (not allocated here) */
+#if LVGL_PORT_FB_SYNC
+    lvgl_port_fb_areas_t      fb_dirty[2];  /* Per frame buffer: areas drawn into the other buffer, which are stale here */
+    lvgl_port_fb_areas_t      fb_synced;    /* Areas copied into the drawn buffer before this frame */
+    lvgl_port_disp_fb_sync_stats_t fb_stats; /* Copying statistics */
+#if LVGL_PORT_FB_SYNC_PPA
+    lvgl_port_ppa_handle_t    ppa_handle;   /* PPA for copying big areas */
+#endif
+#endif
 } lvgl_port_display_ctx_t;
 
 /*******************************************************************************
@@ -67,7 +105,17 @@ static bool lvgl_port_flush_dpi_vsync_ready_callback(esp_lcd_panel_handle_t pane
 #endif
 static void lvgl_port_flush_callback(lv_disp_drv_t *drv, const lv_area_t *area, lv_color_t *color_map);
 static void lvgl_port_update_callback(lv_disp_drv_t *drv);
+static void lvgl_port_flush_wait_callback(lv_disp_drv_t *drv);
+#if LVGL_PORT_FB_SYNC
+static void lvgl_port_fb_present(lvgl_port_display_ctx_t *disp_ctx, lv_disp_drv_t *drv, lv_color_t *color_map);
+static void lvgl_port_fb_render_start_callback(lv_disp_drv_t *drv);
+static void lvgl_port_fb_monitor_callback(lv_disp_drv_t *drv, uint32_t time, uint32_t px);
+#endif
 static void lvgl_port_pix_monochrome_callback(lv_disp_drv_t *drv, uint8_t *buf, lv_coord_t buf_w, lv_coord_t x, lv_coord_t y, lv_color_t color, lv_opa_t opa);
+#if LVGL_PORT_BLEND_RGB565
+static void lvgl_port_draw_ctx_init(lv_disp_drv_t *drv, lv_draw_ctx_t *draw_ctx);
+static void lvgl_port_draw_blend(lv_draw_ctx_t *draw_ctx, const lv_draw_sw_blend_dsc_t *dsc);
+#endif
 
 /*******************************************************************************
 * Public API functions
@@ -118,6 +166,22 @@ lv_display_t *lvgl_port_add_disp_dsi(const lvgl_port_display_cfg_t *disp_cfg, co
         }
         /* Register done callback */
         esp_lcd_dpi_panel_register_event_callbacks(disp_ctx->panel_handle, &cbs, &disp_ctx->disp_drv);
+
+        /* Direct mode into the frame buffers: the port copies changed areas between them instead of LVGL */
+        if (disp_ctx->fb_draw_buf && disp_ctx->disp_drv.direct_mode) {
+#if LVGL_PORT_FB_SYNC_PPA
+            const lvgl_port_ppa_cfg_t ppa_cfg = {
+                .color_space = COLOR_SPACE_RGB,
+                .pixel_format = (LV_COLOR_DEPTH == 16 ? COLOR_PIXEL_RGB565 : COLOR_PIXEL_ARGB8888),
+            };
+            disp_ctx->ppa_handle = lvgl_port_ppa_create(&ppa_cfg);
+            if (disp_ctx->ppa_handle == NULL) {
+                ESP_LOGW(TAG, "PPA is not available, changed areas will be copied by CPU");
+            }
+#endif
+            disp_ctx->disp_drv.render_start_cb = lvgl_port_fb_render_start_callback;
+            disp_ctx->disp_drv.monitor_cb = lvgl_port_fb_monitor_callback;
+        }
 #else
         ESP_RETURN_ON_FALSE(false, NULL, TAG, "MIPI-DSI is supported only on ESP32P4 and from IDF 5.3!");
 #endif
@@ -173,6 +237,11 @@ esp_err_t lvgl_port_remove_disp(lv_disp_t *disp)
     if (disp_ctx->trans_sem) {
         vSemaphoreDelete(disp_ctx->trans_sem);
     }
+#if LVGL_PORT_FB_SYNC_PPA
+    if (disp_ctx->ppa_handle) {
+        lvgl_port_ppa_delete(disp_ctx->ppa_handle);
+    }
+#endif
 
     lv_disp_remove(disp);
 
@@ -182,11 +251,12 @@ esp_err_t lvgl_port_remove_disp(lv_disp_t *disp)
             lv_mem_free(disp_drv->draw_ctx);
             disp_drv->draw_ctx = NULL;
         }
-        if (disp_drv->draw_buf && disp_drv->draw_buf->buf1) {
+        /* Panel frame buffers are freed by the panel driver */
+        if (disp_drv->draw_buf && disp_drv->draw_buf->buf1 && !disp_ctx->fb_draw_buf) {
             free(disp_drv->draw_buf->buf1);
             disp_drv->draw_buf->buf1 = NULL;
         }
-        if (disp_drv->draw_buf && disp_drv->draw_buf->buf2) {
+        if (disp_drv->draw_buf && disp_drv->draw_buf->buf2 && !disp_ctx->fb_draw_buf) {
             free(disp_drv->draw_buf->buf2);
             disp_drv->draw_buf->buf2 = NULL;
         }
@@ -201,11 +271,27 @@ esp_err_t lvgl_port_remove_disp(lv_disp_t *disp)
     return ESP_OK;
 }
 
+esp_err_t lvgl_port_disp_get_fb_sync_stats(lv_disp_t *disp, lvgl_port_disp_fb_sync_stats_t *stats)
+{
+    ESP_RETURN_ON_FALSE(disp && stats, ESP_ERR_INVALID_ARG, TAG, "invalid argument");
+#if LVGL_PORT_FB_SYNC
+    lvgl_port_display_ctx_t *disp_ctx = lvgl_port_get_display_ctx(disp);
+    ESP_RETURN_ON_FALSE(disp_ctx->disp_drv.render_start_cb == lvgl_port_fb_render_start_callback, ESP_ERR_NOT_SUPPORTED, TAG, "Display is not in direct mode into frame buffers");
+    lvgl_port_lock(0);
+    *stats = disp_ctx->fb_stats;
+    lvgl_port_unlock();
+    return ESP_OK;
+#else
+    return ESP_ERR_NOT_SUPPORTED;
+#endif
+}
+
 void lvgl_port_flush_ready(lv_disp_t *disp)
 {
     assert(disp);
     assert(disp->driver);
     lv_disp_flush_ready(disp->driver);
+    lvgl_port_task_notify(0);
 }
 
 /*******************************************************************************
@@ -259,6 +345,7 @@ static lv_disp_t *lvgl_port_add_disp_priv(const lvgl_port_display_cfg_t *disp_cf
         buffer_size = disp_cfg->hres * disp_cfg->vres;
         ESP_GOTO_ON_ERROR(esp_lcd_dpi_panel_get_frame_buffer(disp_cfg->panel_handle, 2, (void *)&buf1, (void *)&buf2), err, TAG, "Get RGB buffers failed");
 #endif
+        disp_ctx->fb_draw_buf = true;
 
         trans_sem = xSemaphoreCreateCounting(1, 0);
         ESP_GOTO_ON_FALSE(trans_sem, ESP_ERR_NO_MEM, err, TAG, "Failed to create transport counting Semaphore");
@@ -304,9 +391,17 @@ static lv_disp_t *lvgl_port_add_disp_priv(const lvgl_port_display_cfg_t *disp_cf
     disp_ctx->disp_drv.hor_res = disp_cfg->hres;
     disp_ctx->disp_drv.ver_res = disp_cfg->vres;
     disp_ctx->disp_drv.flush_cb = lvgl_port_flush_callback;
+    disp_ctx->disp_drv.wait_cb = lvgl_port_flush_wait_callback;
     disp_ctx->disp_drv.draw_buf = disp_buf;
     disp_ctx->disp_drv.user_data = disp_ctx;
 
+#if LVGL_PORT_BLEND_RGB565
+    /* Software rendering only, GPU draw contexts of LVGL are kept */
+    if (disp_ctx->disp_drv.draw_ctx_init == lv_draw_sw_init_ctx) {
+        disp_ctx->disp_drv.draw_ctx_init = lvgl_port_draw_ctx_init;
+    }
+#endif
+
     disp_ctx->disp_drv.sw_rotate = disp_cfg->flags.sw_rotate;
     if (disp_ctx->disp_drv.sw_rotate == false) {
         disp_ctx->disp_drv.drv_update_cb = lvgl_port_update_callback;
@@ -368,12 +463,14 @@ static bool lvgl_port_flush_io_ready_callback(esp_lcd_panel_io_handle_t panel_io
     lvgl_port_display_ctx_t *disp_ctx = disp_drv->user_data;
     assert(disp_ctx != NULL);
     lv_disp_flush_ready(disp_drv);
+    /* Wake LVGL task waiting for the flush */
+    bool need_yield = lvgl_port_task_notify(0);
 
     if (disp_ctx->trans_size && disp_ctx->trans_sem) {
         xSemaphoreGiveFromISR(disp_ctx->trans_sem, &taskAwake);
     }
 
-    return false;
+    return (need_yield || taskAwake == pdTRUE);
 }
 
 #if (CONFIG_IDF_TARGET_ESP32P4 && ESP_IDF_VERSION >= ESP_IDF_VERSION_VAL(5, 3, 0))
@@ -386,12 +483,14 @@ static bool lvgl_port_flush_dpi_panel_ready_callback(esp_lcd_panel_handle_t pane
     lvgl_port_display_ctx_t *disp_ctx = disp_drv->user_data;
     assert(disp_ctx != NULL);
     lv_disp_flush_ready(disp_drv);
+    /* Wake LVGL task waiting for the flush */
+    bool need_yield = lvgl_port_task_notify(0);
 
     if (disp_ctx->trans_size && disp_ctx->trans_sem) {
         xSemaphoreGiveFromISR(disp_ctx->trans_sem, &taskAwake);
     }
 
-    return false;
+    return (need_yield || taskAwake == pdTRUE);
 }
 
 static bool lvgl_port_flush_dpi_vsync_ready_callback(esp_lcd_panel_handle_t panel_io, esp_lcd_dpi_panel_event_data_t *edata, void *user_ctx)
@@ -461,8 +560,16 @@ static void lvgl_port_flush_callback(lv_disp_drv_t *drv, const lv_area_t *area,
     if (disp_ctx->trans_size == 0) {
         if ((disp_ctx->disp_type == LVGL_PORT_DISP_TYPE_RGB || disp_ctx->disp_type == LVGL_PORT_DISP_TYPE_DSI) && (drv->direct_mode || drv->full_refresh)) {
             if (lv_disp_flush_is_last(drv)) {
-                /* If the interface is I80 or SPI, this step cannot be used for drawing. */
-                esp_lcd_panel_draw_bitmap(disp_ctx->panel_handle, x_start, y_start, x_end + 1, y_end + 1, color_map);
+#if LVGL_PORT_FB_SYNC
+                if (disp_ctx->disp_type == LVGL_PORT_DISP_TYPE_DSI && drv->direct_mode && disp_ctx->fb_draw_buf) {
+                    /* Write back only drawn lines and switch frame buffer */
+                    lvgl_port_fb_present(disp_ctx, drv, color_map);
+                } else
+#endif
+                {
+                    /* If the interface is I80 or SPI, this step cannot be used for drawing. */
+                    esp_lcd_panel_draw_bitmap(disp_ctx->panel_handle, x_start, y_start, x_end + 1, y_end + 1, color_map);
+                }
                 /* Waiting for the last frame buffer to complete transmission */
                 xSemaphoreTake(disp_ctx->trans_sem, 0);
                 xSemaphoreTake(disp_ctx->trans_sem, portMAX_DELAY);
@@ -502,6 +609,224 @@ static void lvgl_port_flush_callback(lv_disp_drv_t *drv, const lv_area_t *area,
     }
 }
 
+static void lvgl_port_flush_wait_callback(lv_disp_drv_t *drv)
+{
+    /* LVGL checks the flushing flag again after the wait */
+    lvgl_port_flush_wait();
+}
+
+#if LVGL_PORT_FB_SYNC
+static int lvgl_port_fb_band_cmp(const void *a, const void *b)
+{
+    return ((const lv_area_t *)a)->y1 - ((const lv_area_t *)b)->y1;
+}
+
+/* Parts of 'a' outside of 'b' (up to 4, not overlapping), -1 when they have no common part */
+static int lvgl_port_fb_area_diff(lv_area_t *res, const lv_area_t *a, const lv_area_t *b)
+{
+    lv_area_t c;
+    int cnt = 0;
+
+    if (!_lv_area_intersect(&c, a, b)) {
+        return -1;
+    }
+    if (a->y1 < c.y1) {
+        lv_area_set(&res[cnt++], a->x1, a->y1, a->x2, c.y1 - 1);
+    }
+    if (c.y2 < a->y2) {
+        lv_area_set(&res[cnt++], a->x1, c.y2 + 1, a->x2, a->y2);
+    }
+    if (a->x1 < c.x1) {
+        lv_area_set(&res[cnt++], a->x1, c.y1, c.x1 - 1, c.y2);
+    }
+    if (c.x2 < a->x2) {
+        lv_area_set(&res[cnt++], c.x2 + 1, c.y1, a->x2, c.y2);
+    }
+    return cnt;
+}
+
+/* Remove 'sub' from the areas. Without space for the pieces, the area is kept whole (copied more, never less). */
+static void lvgl_port_fb_areas_sub(lvgl_port_fb_areas_t *areas, const lv_area_t *sub)
+{
+    lv_area_t res[4];
+
+    for (int i = areas->cnt - 1; i >= 0; i--) {
+        int res_c = lvgl_port_fb_area_diff(res, &areas->area[i], sub);
+        if (res_c < 0 || areas->cnt - 1 + res_c > LVGL_PORT_FB_AREAS_MAX) {
+            continue;
+        }
+        /* Indexes above i are done, the last one can take the place of the removed area */
+        areas->area[i] = areas->area[--areas->cnt];
+        for (int j = 0; j < res_c; j++) {
+            areas->area[areas->cnt++] = res[j];
+        }
+    }
+}
+
+/* Add the part of 'area', which is not in the list yet (union) */
+static void lvgl_port_fb_areas_add(lvgl_port_fb_areas_t *areas, const lv_area_t *area)
+{
+    lvgl_port_fb_areas_t add = {
+        .area = { *area },
+        .cnt = 1,
+    };
+
+    for (int i = 0; i < areas->cnt && add.cnt > 0; i++) {
+        lvgl_port_fb_areas_sub(&add, &areas->area[i]);
+    }
+
+    if (areas->cnt + add.cnt > LVGL_PORT_FB_AREAS_MAX) {
+        /* Too many pieces, use one area around all */
+        lv_area_t join = *area;
+        for (int i = 0; i < areas->cnt; i++) {
+            _lv_area_join(&join, &join, &areas->area[i]);
+        }
+        areas->area[0] = join;
+        areas->cnt = 1;
+        return;
+    }
+
+    memcpy(&areas->area[areas->cnt], add.area, add.cnt * sizeof(lv_area_t));
+    areas->cnt += add.cnt;
+}
+
+/*
+ * Direct mode into the DPI frame buffers. LVGL swapped the buffers already: it draws into buf_act, the other one
+ * is on the screen. Areas drawn into the other buffer since buf_act was drawn last time are stale here, they are
+ * copied from the screen buffer, except of the parts, which are redrawn in this frame.
+ */
+static void lvgl_port_fb_render_start_callback(lv_disp_drv_t *drv)
+{
+    lvgl_port_display_ctx_t *disp_ctx = (lvgl_port_display_ctx_t *)drv->user_data;
+    lv_disp_t *disp = _lv_refr_get_disp_refreshing();
+    lv_disp_draw_buf_t *draw_buf = drv->draw_buf;
+    const int idx = (draw_buf->buf_act == draw_buf->buf1) ? 0 : 1;
+    lv_color_t *dst = draw_buf->buf_act;
+    lv_color_t *src = (idx == 0) ? draw_buf->buf2 : draw_buf->buf1;
+    lvgl_port_fb_areas_t *sync = &disp_ctx->fb_synced;
+    bool copied[LVGL_PORT_FB_AREAS_MAX] = {0};
+    uint32_t bytes = 0;
+
+    *sync = disp_ctx->fb_dirty[idx];
+    disp_ctx->fb_dirty[idx].cnt = 0;
+    for (int i = 0; i < disp->inv_p && sync->cnt > 0; i++) {
+        if (!disp->inv_area_joined[i]) {
+            lvgl_port_fb_areas_sub(sync, &disp->inv_areas[i]);
+        }
+    }
+
+#if LVGL_PORT_FB_SYNC_PPA
+    /* PPA first, it invalidates the destination in cache, so the CPU copies must come after it */
+    if (disp_ctx->ppa_handle) {
+        for (int i = 0; i < sync->cnt; i++) {
+            const lv_area_t *area = &sync->area[i];
+            if (lv_area_get_size(area) < LVGL_PORT_FB_SYNC_PPA_MIN_PX) {
+                continue;
+            }
+            lvgl_port_ppa_disp_copy_t copy_cfg = {
+                .in_buff = (uint8_t *)src,
+                .out_buff = (uint8_t *)dst,
+                .out_buff_size = draw_buf->size * sizeof(lv_color_t),
+                .area = {
+                    .x1 = area->x1,
+                    .x2 = area->x2,
+                    .y1 = area->y1,
+                    .y2 = area->y2,
+                },
+                .disp_size = {
+                    .hres = drv->hor_res,
+                    .vres = drv->ver_res,
+                },
+                .ppa_mode = PPA_TRANS_MODE_BLOCKING,
+            };
+            if (lvgl_port_ppa_copy(disp_ctx->ppa_handle, &copy_cfg) == ESP_OK) {
+                copied[i] = true;
+                bytes += lv_area_get_size(area) * sizeof(lv_color_t);
+            }
+        }
+        disp_ctx->fb_stats.bytes_ppa += bytes;
+    }
+#endif
+
+    for (int i = 0; i < sync->cnt; i++) {
+        const lv_area_t *area = &sync->area[i];
+        if (copied[i]) {
+            continue;
+        }
+        const size_t line_size = lv_area_get_width(area) * sizeof(lv_color_t);
+        for (lv_coord_t y = area->y1; y <= area->y2; y++) {
+            const uint32_t offset = y * drv->hor_res + area->x1;
+            memcpy(dst + offset, src + offset, line_size);
+        }
+        bytes += line_size * lv_area_get_height(area);
+    }
+
+    disp_ctx->fb_stats.frames++;
+    disp_ctx->fb_stats.areas_last = sync->cnt;
+    disp_ctx->fb_stats.bytes_last = bytes;
+    disp_ctx->fb_stats.bytes_total += bytes;
+    if (bytes > disp_ctx->fb_stats.bytes_max) {
+        disp_ctx->fb_stats.bytes_max = bytes;
+    }
+}
+
+static void lvgl_port_fb_monitor_callback(lv_disp_drv_t *drv, uint32_t time, uint32_t px)
+{
+    /* LVGL saved the areas of this frame to copy them into the other buffer before the next frame (sync areas).
+     * The port does it in lvgl_port_fb_render_start_callback(), so they are dropped here. */
+    lv_disp_t *disp = _lv_refr_get_disp_refreshing();
+    _lv_ll_clear(&disp->sync_areas);
+}
+
+/*
+ * Only the lines of drawn and copied areas are written back from cache, the last band goes through
+ * esp_lcd_panel_draw_bitmap(), which writes it back and switches the frame buffer.
+ */
+static void lvgl_port_fb_present(lvgl_port_display_ctx_t *disp_ctx, lv_disp_drv_t *drv, lv_color_t *color_map)
+{
+    lv_disp_t *disp = _lv_refr_get_disp_refreshing();
+    lv_disp_draw_buf_t *draw_buf = drv->draw_buf;
+    /* Areas of this frame are stale in the other buffer */
+    lvgl_port_fb_areas_t *dirty = &disp_ctx->fb_dirty[(color_map == draw_buf->buf1) ? 1 : 0];
+    lv_area_t bands[LVGL_PORT_FB_AREAS_MAX * 2];
+    uint16_t cnt = 0;
+
+    for (int i = 0; i < disp->inv_p; i++) {
+        if (!disp->inv_area_joined[i]) {
+            bands[cnt++] = disp->inv_areas[i];
+            lvgl_port_fb_areas_add(dirty, &disp->inv_areas[i]);
+        }
+    }
+    for (int i = 0; i < disp_ctx->fb_synced.cnt; i++) {
+        bands[cnt++] = disp_ctx->fb_synced.area[i];
+    }
+    disp_ctx->fb_synced.cnt = 0;
+
+    if (cnt == 0) {
+        esp_lcd_panel_draw_bitmap(disp_ctx->panel_handle, 0, 0, drv->hor_res, drv->ver_res, color_map);
+        return;
+    }
+
+    /* Merge overlapping line bands */
+    qsort(bands, cnt, sizeof(lv_area_t), lvgl_port_fb_band_cmp);
+    uint16_t merged = 0;
+    for (int i = 1; i < cnt; i++) {
+        if (bands[i].y1 <= bands[merged].y2 + 1) {
+            bands[merged].y2 = LV_MAX(bands[merged].y2, bands[i].y2);
+        } else {
+            bands[++merged] = bands[i];
+        }
+    }
+
+    const size_t line_size = drv->hor_res * sizeof(lv_color_t);
+    for (int i = 0; i < merged; i++) {
+        esp_cache_msync((uint8_t *)color_map + bands[i].y1 * line_size, (bands[i].y2 - bands[i].y1 + 1) * line_size,
+                        ESP_CACHE_MSYNC_FLAG_DIR_C2M | ESP_CACHE_MSYNC_FLAG_UNALIGNED);
+    }
+    esp_lcd_panel_draw_bitmap(disp_ctx->panel_handle, 0, bands[merged].y1, drv->hor_res, bands[merged].y2 + 1, color_map);
+}
+#endif
+
 static void lvgl_port_update_callback(lv_disp_drv_t *drv)
 {
     assert(drv);
@@ -559,3 +884,64 @@ static void lvgl_port_pix_monochrome_callback(lv_disp_drv_t *drv, uint8_t *buf,
         (*buf) |= (1 << (y % 8));
     }
 }
+
+#if LVGL_PORT_BLEND_RGB565
+static void lvgl_port_draw_ctx_init(lv_disp_drv_t *drv, lv_draw_ctx_t *draw_ctx)
+{
+    lv_draw_sw_init_ctx(drv, draw_ctx);
+    ((lv_draw_sw_ctx_t *)draw_ctx)->blend = lvgl_port_draw_blend;
+}
+
+/* Same preparation as lv_draw_sw_blend_basic(), blending itself in lvgl_port_blend_rgb565_esp() */
+static void lvgl_port_draw_blend(lv_draw_ctx_t *draw_ctx, const lv_draw_sw_blend_dsc_t *dsc)
+{
+    lv_disp_t *disp = _lv_refr_get_disp_refreshing();
+
+    /* Pixel callback, transparent screen and other blend modes are left to LVGL */
+    if (disp->driver->set_px_cb || disp->driver->screen_transp || dsc->blend_mode != LV_BLEND_MODE_NORMAL) {
+        lv_draw_sw_blend_basic(draw_ctx, dsc);
+        return;
+    }
+
+    lv_opa_t *mask = dsc->mask_buf;
+    if (mask && dsc->mask_res == LV_DRAW_MASK_RES_TRANSP) {
+        return;
+    } else if (dsc->mask_res == LV_DRAW_MASK_RES_FULL_COVER) {
+        mask = NULL;
+    }
+
+    lv_area_t blend_area;
+    if (!_lv_area_intersect(&blend_area, dsc->blend_area, draw_ctx->clip_area)) {
+        return;
+    }
+
+    const lv_coord_t dest_stride = lv_area_get_width(draw_ctx->buf_area);
+    lvgl_port_blend_rgb565_dsc_t blend = {
+        .dest_buf = (uint16_t *)draw_ctx->buf + dest_stride * (blend_area.y1 - draw_ctx->buf_area->y1) + (blend_area.x1 - draw_ctx->buf_area->x1),
+        .dest_w = lv_area_get_width(&blend_area),
+        .dest_h = lv_area_get_height(&blend_area),
+        .dest_stride = dest_stride,
+        .color = dsc->color.full,
+        .opa = dsc->opa,
+    };
+
+    if (dsc->src_buf) {
+        blend.src_stride = lv_area_get_width(dsc->blend_area);
+        blend.src_buf = (const uint16_t *)dsc->src_buf + blend.src_stride * (blend_area.y1 - dsc->blend_area->y1) + (blend_area.x1 - dsc->blend_area->x1);
+    }
+
+    if (mask) {
+        /* Round the values in the mask if anti-aliasing is disabled */
+        if (disp->driver->antialiasing == 0) {
+            int32_t mask_size = lv_area_get_size(dsc->mask_area);
+            for (int32_t i = 0; i < mask_size; i++) {
+                mask[i] = mask[i] > 128 ? LV_OPA_COVER : LV_OPA_TRANSP;
+            }
+        }
+        blend.mask_stride = lv_area_get_width(dsc->mask_area);
+        blend.mask_buf = mask + blend.mask_stride * (blend_area.y1 - dsc->mask_area->y1) + (blend_area.x1 - dsc->mask_area->x1);
+    }
+
+    lvgl_port_blend_rgb565_esp(&blend);
+}
+#endif
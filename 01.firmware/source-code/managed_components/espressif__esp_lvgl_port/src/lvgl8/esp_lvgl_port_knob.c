@@ -155,6 +155,9 @@ static void lvgl_port_encoder_btn_down_handler(void *arg, void *arg2)
             ctx->btn_enter = true;
         }
     }
+
+    /* Wake LVGL task, if needed */
+    lvgl_port_task_wake(LVGL_PORT_EVENT_TOUCH, NULL);
 }
 
 static void lvgl_port_encoder_btn_up_handler(void *arg, void *arg2)
@@ -167,6 +170,9 @@ static void lvgl_port_encoder_btn_up_handler(void *arg, void *arg2)
             ctx->btn_enter = false;
         }
     }
+
+    /* Wake LVGL task, if needed */
+    lvgl_port_task_wake(LVGL_PORT_EVENT_TOUCH, NULL);
 }
 
 static void lvgl_port_encoder_left_handler(void *arg, void *arg2)
@@ -180,6 +186,9 @@ static void lvgl_port_encoder_left_handler(void *arg, void *arg2)
             ctx->diff = (ctx->diff > 0) ? diff : ctx->diff + diff;
         }
     }
+
+    /* Wake LVGL task, if needed */
+    lvgl_port_task_wake(LVGL_PORT_EVENT_TOUCH, NULL);
 }
 
 static void lvgl_port_encoder_right_handler(void *arg, void *arg2)
@@ -193,6 +202,9 @@ static void lvgl_port_encoder_right_handler(void *arg, void *arg2)
             ctx->diff = (ctx->diff < 0) ? diff : ctx->diff + diff;
         }
     }
+
+    /* Wake LVGL task, if needed */
+    lvgl_port_task_wake(LVGL_PORT_EVENT_TOUCH, NULL);
 }
 
 static int32_t lvgl_port_calculate_diff(knob_handle_t knob, knob_event_t event)
@@ -7,22 +7,52 @@
 #include "esp_log.h"
 #include "esp_err.h"
 #include "esp_check.h"
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
 #include "esp_lcd_touch.h"
 #include "esp_lvgl_port.h"
 
 static const char *TAG = "LVGL";
 
+#define LVGL_PORT_TOUCH_QUEUE_LEN           (16)    /* Samples waiting for LVGL */
+#define LVGL_PORT_TOUCH_TASK_STACK          (4096)
+#define LVGL_PORT_TOUCH_TASK_PERIOD_MS      (10)    /* Reading period while pressed or without interrupt pin */
+#define LVGL_PORT_TOUCH_TASK_STOP_MS        (500)
+
 /*******************************************************************************
 * Types definitions
 *******************************************************************************/
 
+typedef struct {
+    int64_t     time;                   /* Time of interrupt (or reading without interrupt) in us */
+    uint16_t    x;
+    uint16_t    y;
+    bool        pressed;
+} lvgl_port_touch_sample_t;
+
+typedef struct {
+    TaskHandle_t                task;       /* Touch reading task, NULL when stopped */
+    volatile bool               running;    /* Task runs until false */
+    uint32_t                    period_ms;  /* Reading period while pressed or without interrupt pin */
+    portMUX_TYPE                lock;       /* Lock of the queue, interrupt time and statistics */
+    int64_t                     irq_time;   /* Time of the last not served interrupt, 0 = none */
+    lvgl_port_touch_sample_t    queue[LVGL_PORT_TOUCH_QUEUE_LEN];
+    uint8_t                     queue_head; /* Oldest sample */
+    uint8_t                     queue_cnt;
+    lvgl_port_touch_sample_t    last;       /* Last sample given to LVGL */
+    lvgl_port_touch_stats_t     stats;
+} lvgl_port_touch_task_ctx_t;
+
 typedef struct {
     esp_lcd_touch_handle_t   handle;     /* LCD touch IO handle */
     lv_indev_drv_t           indev_drv;  /* LVGL input device driver */
+    lv_indev_t               *indev;     /* LVGL input device */
     struct {
         float x;
         float y;
     } scale;                            /* Touch scale */
+    lvgl_port_touch_task_ctx_t *task;   /* Touch reading task, NULL = touch is read in LVGL task */
 } lvgl_port_touch_ctx_t;
 
 /*******************************************************************************
@@ -30,6 +60,12 @@ typedef struct {
 *******************************************************************************/
 
 static void lvgl_port_touchpad_read(lv_indev_drv_t *indev_drv, lv_indev_data_t *data);
+static void lvgl_port_touch_interrupt_callback(esp_lcd_touch_handle_t tp);
+static void lvgl_port_touchpad_read_queue(lv_indev_drv_t *indev_drv, lv_indev_data_t *data);
+static void lvgl_port_touch_task_interrupt_callback(esp_lcd_touch_handle_t tp);
+static void lvgl_port_touch_task(void *arg);
+static esp_err_t lvgl_port_touch_task_start(lvgl_port_touch_ctx_t *touch_ctx, const lvgl_port_touch_cfg_t *touch_cfg);
+static void lvgl_port_touch_task_stop(lvgl_port_touch_ctx_t *touch_ctx);
 
 /*******************************************************************************
 * Public API functions
@@ -37,6 +73,8 @@ static void lvgl_port_touchpad_read(lv_indev_drv_t *indev_drv, lv_indev_data_t *
 
 lv_indev_t *lvgl_port_add_touch(const lvgl_port_touch_cfg_t *touch_cfg)
 {
+    esp_err_t ret = ESP_OK;
+    lv_indev_t *indev = NULL;
     assert(touch_cfg != NULL);
     assert(touch_cfg->disp != NULL);
     assert(touch_cfg->handle != NULL);
@@ -50,14 +88,61 @@ lv_indev_t *lvgl_port_add_touch(const lvgl_port_touch_cfg_t *touch_cfg)
     touch_ctx->handle = touch_cfg->handle;
     touch_ctx->scale.x = (touch_cfg->scale.x ? touch_cfg->scale.x : 1);
     touch_ctx->scale.y = (touch_cfg->scale.y ? touch_cfg->scale.y : 1);
+    touch_ctx->indev = NULL;
+    touch_ctx->task = NULL;
 
+    if (touch_cfg->task.task_priority > 0) {
+        /* Queue and task are ready before the interrupt is registered, the task starts reading after the indev is registered */
+        touch_ctx->task = calloc(1, sizeof(lvgl_port_touch_task_ctx_t));
+        ESP_GOTO_ON_FALSE(touch_ctx->task, ESP_ERR_NO_MEM, err, TAG, "Not enough memory for touch task context allocation!");
+        portMUX_INITIALIZE(&touch_ctx->task->lock);
+        touch_ctx->task->period_ms = (touch_cfg->task.period_ms ? touch_cfg->task.period_ms : LVGL_PORT_TOUCH_TASK_PERIOD_MS);
+    }
+
+    if (touch_ctx->handle->config.int_gpio_num != GPIO_NUM_NC) {
+        /* Register touch interrupt callback */
+        ret = esp_lcd_touch_register_interrupt_callback_with_data(touch_ctx->handle,
+                touch_ctx->task ? lvgl_port_touch_task_interrupt_callback : lvgl_port_touch_interrupt_callback, touch_ctx);
+        ESP_GOTO_ON_ERROR(ret, err, TAG, "Error in register touch interrupt.");
+    }
+
+    lvgl_port_lock(0);
     /* Register a touchpad input device */
     lv_indev_drv_init(&touch_ctx->indev_drv);
     touch_ctx->indev_drv.type = LV_INDEV_TYPE_POINTER;
     touch_ctx->indev_drv.disp = touch_cfg->disp;
-    touch_ctx->indev_drv.read_cb = lvgl_port_touchpad_read;
+    touch_ctx->indev_drv.read_cb = (touch_ctx->task ? lvgl_port_touchpad_read_queue : lvgl_port_touchpad_read);
     touch_ctx->indev_drv.user_data = touch_ctx;
-    return lv_indev_drv_register(&touch_ctx->indev_drv);
+    indev = lv_indev_drv_register(&touch_ctx->indev_drv);
+    touch_ctx->indev = indev;
+    /* Event mode can be set only, when touch interrupt enabled or touch task reads it: the touch is read after interrupt (new sample) and polled only while pressed */
+    if (indev && (touch_ctx->task || touch_ctx->handle->config.int_gpio_num != GPIO_NUM_NC)) {
+        lv_timer_pause(indev->driver->read_timer);
+    }
+    lvgl_port_unlock();
+    ESP_GOTO_ON_FALSE(indev, ESP_ERR_NO_MEM, err, TAG, "Touch input device registration failed!");
+
+    if (touch_ctx->task) {
+        ret = lvgl_port_touch_task_start(touch_ctx, touch_cfg);
+        ESP_GOTO_ON_ERROR(ret, err, TAG, "Touch task creation failed!");
+    }
+
+err:
+    if (ret != ESP_OK) {
+        if (touch_ctx->handle->config.interrupt_callback != NULL) {
+            esp_lcd_touch_register_interrupt_callback(touch_ctx->handle, NULL);
+        }
+        if (indev) {
+            lvgl_port_lock(0);
+            lv_indev_delete(indev);
+            lvgl_port_unlock();
+            indev = NULL;
+        }
+        free(touch_ctx->task);
+        free(touch_ctx);
+    }
+
+    return indev;
 }
 
 esp_err_t lvgl_port_remove_touch(lv_indev_t *touch)
@@ -67,16 +152,42 @@ esp_err_t lvgl_port_remove_touch(lv_indev_t *touch)
     assert(indev_drv);
     lvgl_port_touch_ctx_t *touch_ctx = (lvgl_port_touch_ctx_t *)indev_drv->user_data;
 
+    if (touch_ctx && touch_ctx->task) {
+        /* Stop the task before the input device is gone, interrupt is not served without the task */
+        lvgl_port_touch_task_stop(touch_ctx);
+    }
+
+    lvgl_port_lock(0);
     /* Remove input device driver */
     lv_indev_delete(touch);
+    lvgl_port_unlock();
+
+    if (touch_ctx && touch_ctx->handle->config.int_gpio_num != GPIO_NUM_NC) {
+        /* Unregister touch interrupt callback */
+        esp_lcd_touch_register_interrupt_callback(touch_ctx->handle, NULL);
+    }
 
     if (touch_ctx) {
+        free(touch_ctx->task);
         free(touch_ctx);
     }
 
     return ESP_OK;
 }
 
+esp_err_t lvgl_port_touch_get_stats(lv_indev_t *touch, lvgl_port_touch_stats_t *stats)
+{
+    ESP_RETURN_ON_FALSE(touch && touch->driver && stats, ESP_ERR_INVALID_ARG, TAG, "Invalid arguments");
+    lvgl_port_touch_ctx_t *touch_ctx = (lvgl_port_touch_ctx_t *)touch->driver->user_data;
+    ESP_RETURN_ON_FALSE(touch_ctx && touch_ctx->task, ESP_ERR_INVALID_ARG, TAG, "Touch is not read by own task");
+
+    portENTER_CRITICAL(&touch_ctx->task->lock);
+    *stats = touch_ctx->task->stats;
+    portEXIT_CRITICAL(&touch_ctx->task->lock);
+
+    return ESP_OK;
+}
+
 /*******************************************************************************
 * Private functions
 *******************************************************************************/
@@ -104,4 +215,191 @@ static void lvgl_port_touchpad_read(lv_indev_drv_t *indev_drv, lv_indev_data_t *
     } else {
         data->state = LV_INDEV_STATE_RELEASED;
     }
+
+    /* Event mode: keep reading while pressed and while scroll throw is running (it is processed on reads), then wait for interrupt */
+    if (touch_ctx->indev && touch_ctx->handle->config.int_gpio_num != GPIO_NUM_NC) {
+        if (data->state == LV_INDEV_STATE_PRESSED || touch_ctx->indev->proc.types.pointer.scroll_obj) {
+            lv_timer_resume(indev_drv->read_timer);
+        } else {
+            lv_timer_pause(indev_drv->read_timer);
+        }
+    }
+}
+
+static void IRAM_ATTR lvgl_port_touch_interrupt_callback(esp_lcd_touch_handle_t tp)
+{
+    lvgl_port_touch_ctx_t *touch_ctx = (lvgl_port_touch_ctx_t *) tp->config.user_data;
+
+    /* Wake LVGL task, if needed */
+    lvgl_port_task_wake(LVGL_PORT_EVENT_TOUCH, touch_ctx->indev);
+}
+
+/* Touch reading task: I2C transfers are out of LVGL task, LVGL gets the samples from queue */
+
+static esp_err_t lvgl_port_touch_task_start(lvgl_port_touch_ctx_t *touch_ctx, const lvgl_port_touch_cfg_t *touch_cfg)
+{
+    lvgl_port_touch_task_ctx_t *task_ctx = touch_ctx->task;
+    const uint32_t stack = (touch_cfg->task.task_stack > 0 ? touch_cfg->task.task_stack : LVGL_PORT_TOUCH_TASK_STACK);
+
+    task_ctx->running = true;
+    if (xTaskCreate(lvgl_port_touch_task, "touch", stack, touch_ctx, touch_cfg->task.task_priority, &task_ctx->task) != pdPASS) {
+        task_ctx->running = false;
+        task_ctx->task = NULL;
+        return ESP_FAIL;
+    }
+    /* The first reading right away, it serves the interrupts before the task start too */
+    xTaskNotifyGive(task_ctx->task);
+
+    return ESP_OK;
+}
+
+static void lvgl_port_touch_task_stop(lvgl_port_touch_ctx_t *touch_ctx)
+{
+    lvgl_port_touch_task_ctx_t *task_ctx = touch_ctx->task;
+
+    task_ctx->running = false;
+    if (task_ctx->task) {
+        xTaskNotifyGive(task_ctx->task);
+    }
+    /* The task clears its handle at the end */
+    for (int i = 0; task_ctx->task != NULL && i < LVGL_PORT_TOUCH_TASK_STOP_MS / 10; i++) {
+        vTaskDelay(pdMS_TO_TICKS(10));
+    }
+    if (task_ctx->task != NULL) {
+        ESP_LOGE(TAG, "Failed to stop touch task");
+    }
+}
+
+static void lvgl_port_touch_task(void *arg)
+{
+    lvgl_port_touch_ctx_t *touch_ctx = (lvgl_port_touch_ctx_t *)arg;
+    lvgl_port_touch_task_ctx_t *task_ctx = touch_ctx->task;
+    const bool interrupt = (touch_ctx->handle->config.int_gpio_num != GPIO_NUM_NC);
+    lvgl_port_touch_sample_t prev = {0};
+
+    while (task_ctx->running) {
+        /* With interrupt pin: sleep till interrupt, while pressed read periodically too (release is not reported by interrupt on all controllers) */
+        const TickType_t wait = ((interrupt && !prev.pressed) ? portMAX_DELAY : pdMS_TO_TICKS(task_ctx->period_ms));
+        ulTaskNotifyTake(pdTRUE, wait);
+        if (!task_ctx->running) {
+            break;
+        }
+
+        uint16_t touchpad_x[1] = {0};
+        uint16_t touchpad_y[1] = {0};
+        uint8_t touchpad_cnt = 0;
+
+        /* Read data from touch controller */
+        const int64_t start = esp_timer_get_time();
+        esp_lcd_touch_read_data(touch_ctx->handle);
+        bool touchpad_pressed = esp_lcd_touch_get_coordinates(touch_ctx->handle, touchpad_x, touchpad_y, NULL, &touchpad_cnt, 1);
+        const uint32_t read_us = (uint32_t)(esp_timer_get_time() - start);
+
+        lvgl_port_touch_sample_t sample = {
+            .time = start,
+            .x = touchpad_x[0],
+            .y = touchpad_y[0],
+            .pressed = (touchpad_pressed && touchpad_cnt > 0),
+        };
+        if (!sample.pressed) {
+            /* Release at the last pressed point */
+            sample.x = prev.x;
+            sample.y = prev.y;
+        }
+        /* Only changes go to LVGL */
+        const bool changed = (sample.pressed != prev.pressed || sample.x != prev.x || sample.y != prev.y);
+
+        portENTER_CRITICAL(&task_ctx->lock);
+        if (task_ctx->irq_time) {
+            /* Sample is timestamped by the interrupt, which reported it */
+            sample.time = task_ctx->irq_time;
+            task_ctx->irq_time = 0;
+        }
+        if (changed) {
+            if (task_ctx->queue_cnt == LVGL_PORT_TOUCH_QUEUE_LEN) {
+                /* LVGL is late, drop the oldest sample */
+                task_ctx->queue_head = (task_ctx->queue_head + 1) % LVGL_PORT_TOUCH_QUEUE_LEN;
+                task_ctx->queue_cnt--;
+                task_ctx->stats.dropped++;
+            }
+            task_ctx->queue[(task_ctx->queue_head + task_ctx->queue_cnt) % LVGL_PORT_TOUCH_QUEUE_LEN] = sample;
+            task_ctx->queue_cnt++;
+            task_ctx->stats.samples++;
+        }
+        task_ctx->stats.read_last_us = read_us;
+        if (read_us > task_ctx->stats.read_max_us) {
+            task_ctx->stats.read_max_us = read_us;
+        }
+        portEXIT_CRITICAL(&task_ctx->lock);
+
+        if (changed) {
+            /* Wake LVGL task to read the new sample */
+            lvgl_port_task_wake(LVGL_PORT_EVENT_TOUCH, touch_ctx->indev);
+        }
+        prev = sample;
+    }
+
+    task_ctx->task = NULL;
+    vTaskDelete(NULL);
+}
+
+static void lvgl_port_touchpad_read_queue(lv_indev_drv_t *indev_drv, lv_indev_data_t *data)
+{
+    assert(indev_drv);
+    lvgl_port_touch_ctx_t *touch_ctx = (lvgl_port_touch_ctx_t *)indev_drv->user_data;
+    lvgl_port_touch_task_ctx_t *task_ctx = touch_ctx->task;
+    bool more = false;
+
+    /* One sample per read, LVGL reads again in the same cycle while there are more (press, moves and release are not merged) */
+    portENTER_CRITICAL(&task_ctx->lock);
+    if (task_ctx->queue_cnt > 0) {
+        task_ctx->last = task_ctx->queue[task_ctx->queue_head];
+        task_ctx->queue_head = (task_ctx->queue_head + 1) % LVGL_PORT_TOUCH_QUEUE_LEN;
+        task_ctx->queue_cnt--;
+        more = (task_ctx->queue_cnt > 0);
+
+        const uint32_t latency_us = (uint32_t)(esp_timer_get_time() - task_ctx->last.time);
+        task_ctx->stats.latency_last_us = latency_us;
+        if (latency_us > task_ctx->stats.latency_max_us) {
+            task_ctx->stats.latency_max_us = latency_us;
+        }
+    }
+    portEXIT_CRITICAL(&task_ctx->lock);
+
+    /* Without a new sample, the last state is repeated */
+    data->point.x = touch_ctx->scale.x * task_ctx->last.x;
+    data->point.y = touch_ctx->scale.y * task_ctx->last.y;
+    data->state = (task_ctx->last.pressed ? LV_INDEV_STATE_PRESSED : LV_INDEV_STATE_RELEASED);
+    data->continue_reading = more;
+
+    /* Keep reading while pressed (long press) and while scroll throw is running, then wait for the next sample */
+    if (touch_ctx->indev) {
+        if (data->state == LV_INDEV_STATE_PRESSED || more || touch_ctx->indev->proc.types.pointer.scroll_obj) {
+            lv_timer_resume(indev_drv->read_timer);
+        } else {
+            lv_timer_pause(indev_drv->read_timer);
+        }
+    }
+}
+
+static void IRAM_ATTR lvgl_port_touch_task_interrupt_callback(esp_lcd_touch_handle_t tp)
+{
+    lvgl_port_touch_ctx_t *touch_ctx = (lvgl_port_touch_ctx_t *) tp->config.user_data;
+    lvgl_port_touch_task_ctx_t *task_ctx = touch_ctx->task;
+    BaseType_t need_yield = pdFALSE;
+
+    /* Timestamp of the first not served interrupt */
+    portENTER_CRITICAL_ISR(&task_ctx->lock);
+    if (task_ctx->irq_time == 0) {
+        task_ctx->irq_time = esp_timer_get_time();
+    }
+    portEXIT_CRITICAL_ISR(&task_ctx->lock);
+
+    /* Wake touch task */
+    if (task_ctx->task) {
+        vTaskNotifyGiveFromISR(task_ctx->task, &need_yield);
+    }
+    if (need_yield) {
+        portYIELD_FROM_ISR();
+    }
 }
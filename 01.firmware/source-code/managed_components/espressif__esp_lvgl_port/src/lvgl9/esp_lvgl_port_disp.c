@@ -241,6 +241,13 @@ esp_err_t lvgl_port_remove_disp(lv_display_t *disp)
     return ESP_OK;
 }
 
+esp_err_t lvgl_port_disp_get_fb_sync_stats(lv_display_t *disp, lvgl_port_disp_fb_sync_stats_t *stats)
+{
+    ESP_RETURN_ON_FALSE(disp && stats, ESP_ERR_INVALID_ARG, TAG, "Invalid arguments");
+    /* Frame buffers are synchronized by LVGL itself */
+    return ESP_ERR_NOT_SUPPORTED;
+}
+
 void lvgl_port_flush_ready(lv_display_t *disp)
 {
     assert(disp);
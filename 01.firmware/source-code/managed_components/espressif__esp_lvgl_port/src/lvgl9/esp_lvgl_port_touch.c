@@ -53,6 +53,9 @@ lv_indev_t *lvgl_port_add_touch(const lvgl_port_touch_cfg_t *touch_cfg)
     touch_ctx->handle = touch_cfg->handle;
     touch_ctx->scale.x = (touch_cfg->scale.x ? touch_cfg->scale.x : 1);
     touch_ctx->scale.y = (touch_cfg->scale.y ? touch_cfg->scale.y : 1);
+    if (touch_cfg->task.task_priority) {
+        ESP_LOGW(TAG, "Touch reading task is supported only in LVGL8, touch is read in LVGL task");
+    }
 
     if (touch_ctx->handle->config.int_gpio_num != GPIO_NUM_NC) {
         /* Register touch interrupt callback */
@@ -106,6 +109,13 @@ esp_err_t lvgl_port_remove_touch(lv_indev_t *touch)
     return ESP_OK;
 }
 
+esp_err_t lvgl_port_touch_get_stats(lv_indev_t *touch, lvgl_port_touch_stats_t *stats)
+{
+    ESP_RETURN_ON_FALSE(touch && stats, ESP_ERR_INVALID_ARG, TAG, "Invalid arguments");
+    /* Touch is always read in LVGL task */
+    return ESP_ERR_NOT_SUPPORTED;
+}
+
 /*******************************************************************************
 * Private functions
 *******************************************************************************/
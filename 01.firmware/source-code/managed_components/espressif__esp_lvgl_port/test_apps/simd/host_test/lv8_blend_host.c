@@ -0,0 +1,57 @@
+/*
+ * SPDX-FileCopyrightText: 2025 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+// Host runner of the LVGL8 RGB565 blend tests in ../main/lv8_blend_common.c
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+#include "lv8_blend_common.h"
+
+static uint32_t clock_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint32_t)((uint64_t)ts.tv_sec * 1000000000u + ts.tv_nsec);
+}
+
+int main(int argc, char **argv)
+{
+    unsigned int loops = 1000;
+    int opt;
+    int fail = 0;
+
+    while ((opt = getopt(argc, argv, "n:")) != -1) {
+        if (opt == 'n') {
+            loops = (unsigned int)atoi(optarg);
+        }
+    }
+
+    for (int op = 0; op < LV8_BLEND_OPERATIONS; op++) {
+        lv8_blend_func_result_t res;
+        if (!lv8_blend_functionality(op, &res)) {
+            printf("FAIL %s: out of memory\n", lv8_blend_operation_names[op]);
+            return 1;
+        }
+        printf("%-14s %6u combinations, %u failures%s%s\n", lv8_blend_operation_names[op], res.combinations,
+               res.failures, res.failures ? ", first: " : "", res.first_failure);
+        fail += res.failures != 0;
+    }
+
+    printf("\nns per pixel      ESP ideal  ESP corner  REF ideal  REF corner\n");
+    for (int op = 0; op < LV8_BLEND_OPERATIONS && loops > 0; op++) {
+        printf("%-14s", lv8_blend_operation_names[op]);
+        for (int f = 0; f < 2; f++) {
+            lv8_blend_func_t func = f == 0 ? lvgl_port_blend_rgb565_esp : lvgl_port_blend_rgb565_ref;
+            printf("  %9.3f  %10.3f", lv8_blend_benchmark(op, func, true, loops, clock_ns),
+                   lv8_blend_benchmark(op, func, false, loops, clock_ns));
+        }
+        printf("\n");
+    }
+
+    return fail ? 1 : 0;
+}
@@ -0,0 +1,264 @@
+/*
+ * SPDX-FileCopyrightText: 2025 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+/*
+ * Test core of the LVGL8 RGB565 blend kernels. No ESP-IDF dependencies, it is built by the test app (Unity test cases
+ * in test_lv8_blend_*.c) and on host (../host_test).
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "lv8_blend_common.h"
+
+// ------------------------------------------------- Defines -----------------------------------------------------------
+
+#define CANARY_PIXELS 8
+#define CANARY_PIXEL 0xA5C3
+#define FUNC_MAX_W 33
+#define FUNC_MAX_H 3
+#define FUNC_MAX_PAD 2
+#define BENCH_DIM 128
+
+// ------------------------------------------------- Macros and Types --------------------------------------------------
+
+typedef struct {
+    uint16_t *dest;                                           // destination, CANARY_PIXELS after the allocation start
+    uint16_t *src;
+    uint8_t *mask;
+    void *alloc[3];                                           // allocations, used in free()
+} test_bufs_t;
+
+const char *const lv8_blend_operation_names[LV8_BLEND_OPERATIONS] = {
+    "fill", "fill opa", "fill mask", "fill mask opa", "copy", "copy opa", "copy mask", "copy mask opa",
+};
+
+// ------------------------------------------------ Static variables ---------------------------------------------------
+
+static uint32_t rnd_state = 1;
+
+// ------------------------------------------------ Static functions ---------------------------------------------------
+
+static uint32_t rnd(void)
+{
+    // xorshift32, the same sequence on every platform
+    rnd_state ^= rnd_state << 13;
+    rnd_state ^= rnd_state >> 17;
+    rnd_state ^= rnd_state << 5;
+    return rnd_state;
+}
+
+static bool op_has_src(lv8_blend_operation_t op)
+{
+    return op >= LV8_BLEND_COPY;
+}
+
+static bool op_has_mask(lv8_blend_operation_t op)
+{
+    return op == LV8_BLEND_FILL_MASK || op == LV8_BLEND_FILL_MASK_OPA || op == LV8_BLEND_COPY_MASK || op == LV8_BLEND_COPY_MASK_OPA;
+}
+
+static bool op_has_opa(lv8_blend_operation_t op)
+{
+    return op == LV8_BLEND_FILL_OPA || op == LV8_BLEND_FILL_MASK_OPA || op == LV8_BLEND_COPY_OPA || op == LV8_BLEND_COPY_MASK_OPA;
+}
+
+static void *alloc_align16(size_t size, void **alloc)
+{
+    *alloc = malloc(size + 16);
+    if (*alloc == NULL) {
+        return NULL;
+    }
+    return (void *)(((uintptr_t)*alloc + 15) & ~(uintptr_t)15);
+}
+
+static void free_bufs(test_bufs_t *bufs)
+{
+    for (int i = 0; i < 3; i++) {
+        free(bufs->alloc[i]);
+        bufs->alloc[i] = NULL;
+    }
+}
+
+static bool alloc_bufs(test_bufs_t *bufs, size_t pixels)
+{
+    memset(bufs, 0, sizeof(*bufs));
+    bufs->dest = alloc_align16((pixels + CANARY_PIXELS * 2) * sizeof(uint16_t), &bufs->alloc[0]);
+    bufs->src = alloc_align16((pixels + CANARY_PIXELS) * sizeof(uint16_t), &bufs->alloc[1]);
+    bufs->mask = alloc_align16(pixels + CANARY_PIXELS, &bufs->alloc[2]);
+    if (bufs->dest == NULL || bufs->src == NULL || bufs->mask == NULL) {
+        free_bufs(bufs);
+        return false;
+    }
+    bufs->dest += CANARY_PIXELS;
+    return true;
+}
+
+// Pixels of a plain background with some details, so that cached results are both hit and missed
+static void gen_pixels(uint16_t *buf, size_t len)
+{
+    uint16_t px = (uint16_t)rnd();
+    for (size_t i = 0; i < len; i++) {
+        if ((rnd() & 0x7) == 0) {
+            px = (uint16_t)rnd();
+        }
+        buf[i] = px;
+    }
+}
+
+// Anti-aliased shapes: runs of 0 and 255 with edges between them
+static void gen_mask(uint8_t *buf, size_t len)
+{
+    uint8_t val = 0;
+    for (size_t i = 0; i < len; i++) {
+        switch (rnd() & 0x7) {
+        case 0:
+            val = 0;
+            break;
+        case 1:
+            val = 255;
+            break;
+        case 2:
+        case 3:
+            val = (uint8_t)rnd();
+            buf[i] = val;
+            continue;
+        default:
+            break;
+        }
+        buf[i] = val;
+    }
+}
+
+// ------------------------------------------------ Test functions -----------------------------------------------------
+
+bool lv8_blend_functionality(lv8_blend_operation_t op, lv8_blend_func_result_t *res)
+{
+    static const uint8_t opa_full[] = {255, 254, 253};
+    static const uint8_t opa_part[] = {3, 77, 128, 200, 252};
+    const uint8_t *opas = op_has_opa(op) ? opa_part : opa_full;
+    const size_t opa_cnt = op_has_opa(op) ? sizeof(opa_part) : sizeof(opa_full);
+    const int src_max_off = op_has_src(op) ? 1 : 0;
+    const int mask_max_off = op_has_mask(op) ? 3 : 0;
+    const size_t pixels = (FUNC_MAX_W + FUNC_MAX_PAD + 1) * FUNC_MAX_H + 4;
+    test_bufs_t bufs;
+    test_bufs_t bufs_ref;
+
+    memset(res, 0, sizeof(*res));
+    if (!alloc_bufs(&bufs, pixels)) {
+        return false;
+    }
+    if (!alloc_bufs(&bufs_ref, pixels)) {
+        free_bufs(&bufs);
+        return false;
+    }
+
+    rnd_state = 1;
+    for (int w = 1; w <= FUNC_MAX_W; w++) {
+        for (int h = 1; h <= FUNC_MAX_H; h++) {
+            for (int pad = 0; pad <= FUNC_MAX_PAD; pad++) {
+                for (int dest_off = 0; dest_off <= 1; dest_off++) {
+                    for (int src_off = 0; src_off <= src_max_off; src_off++) {
+                        for (int mask_off = 0; mask_off <= mask_max_off; mask_off++) {
+                            for (size_t o = 0; o < opa_cnt; o++) {
+                                const size_t total = pixels + CANARY_PIXELS * 2;
+                                uint16_t *dest_all = bufs.dest - CANARY_PIXELS;
+                                uint16_t *dest_ref_all = bufs_ref.dest - CANARY_PIXELS;
+
+                                // Same inputs for both kernels, canaries around the area
+                                gen_pixels(dest_all, total);
+                                for (int i = 0; i < CANARY_PIXELS; i++) {
+                                    bufs.dest[dest_off - 1 - i] = CANARY_PIXEL;
+                                    bufs.dest[dest_off + (h - 1) * (w + pad) + w + i] = CANARY_PIXEL;
+                                }
+                                memcpy(dest_ref_all, dest_all, total * sizeof(uint16_t));
+                                gen_pixels(bufs.src, pixels);
+                                gen_mask(bufs.mask, pixels);
+
+                                lvgl_port_blend_rgb565_dsc_t dsc = {
+                                    .dest_buf = bufs.dest + dest_off,
+                                    .dest_w = w,
+                                    .dest_h = h,
+                                    .dest_stride = w + pad,
+                                    .src_buf = op_has_src(op) ? bufs.src + src_off : NULL,
+                                    .src_stride = w + (pad ^ 1),
+                                    .mask_buf = op_has_mask(op) ? bufs.mask + mask_off : NULL,
+                                    .mask_stride = w + pad + 1,
+                                    .color = (uint16_t)rnd(),
+                                    .opa = opas[o],
+                                };
+                                lvgl_port_blend_rgb565_esp(&dsc);
+                                dsc.dest_buf = bufs_ref.dest + dest_off;
+                                lvgl_port_blend_rgb565_ref(&dsc);
+
+                                res->combinations++;
+                                // The reference keeps the canaries and the line padding, so a write outside shows up here
+                                if (memcmp(dest_all, dest_ref_all, total * sizeof(uint16_t)) == 0) {
+                                    continue;
+                                }
+                                if (res->failures++ == 0) {
+                                    snprintf(res->first_failure, sizeof(res->first_failure),
+                                             "%s: w %d h %d pad %d dest_off %d src_off %d mask_off %d opa %u",
+                                             lv8_blend_operation_names[op], w, h, pad, dest_off, src_off, mask_off, opas[o]);
+                                }
+                            }
+                        }
+                    }
+                }
+            }
+        }
+    }
+
+    free_bufs(&bufs);
+    free_bufs(&bufs_ref);
+    return true;
+}
+
+float lv8_blend_benchmark(lv8_blend_operation_t op, lv8_blend_func_t func, bool ideal, unsigned int cycles, lv8_blend_clock_t clock)
+{
+    const int w = ideal ? BENCH_DIM : BENCH_DIM - 1;
+    const int stride = ideal ? BENCH_DIM : BENCH_DIM + 1;
+    const int off = ideal ? 0 : 1;
+    test_bufs_t bufs;
+
+    if (!alloc_bufs(&bufs, (size_t)(stride + 1) * BENCH_DIM)) {
+        return -1.0f;
+    }
+    rnd_state = 1;
+    gen_pixels(bufs.dest, (size_t)stride * BENCH_DIM);
+    gen_pixels(bufs.src, (size_t)stride * BENCH_DIM);
+    // Shape edges: transparent quarter, 8 pixels of anti-aliasing, covering rest
+    for (int y = 0; y < BENCH_DIM; y++) {
+        for (int x = 0; x < stride; x++) {
+            const int edge = x - BENCH_DIM / 4;
+            bufs.mask[y * stride + x] = edge < 0 ? 0 : edge < 8 ? (uint8_t)(edge * 32 + 16) : 255;
+        }
+    }
+
+    lvgl_port_blend_rgb565_dsc_t dsc = {
+        .dest_buf = bufs.dest + off,
+        .dest_w = w,
+        .dest_h = BENCH_DIM,
+        .dest_stride = stride,
+        .src_buf = op_has_src(op) ? bufs.src + off : NULL,
+        .src_stride = stride,
+        .mask_buf = op_has_mask(op) ? bufs.mask + off : NULL,
+        .mask_stride = stride,
+        .color = 0x39E7,
+        .opa = op_has_opa(op) ? 128 : 255,
+    };
+
+    // The first call to warm up caches
+    func(&dsc);
+    const uint32_t start = clock();
+    for (unsigned int i = 0; i < cycles; i++) {
+        func(&dsc);
+    }
+    const uint32_t end = clock();
+
+    free_bufs(&bufs);
+    return (float)(end - start) / cycles / (float)(w * BENCH_DIM);
+}
@@ -0,0 +1,90 @@
+/*
+ * SPDX-FileCopyrightText: 2025 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "blend_rgb565.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// ------------------------------------------------- Macros and Types --------------------------------------------------
+
+/**
+ * @brief LVGL8 RGB565 blend operations (fast paths of lv_draw_sw_blend_basic())
+ */
+typedef enum {
+    LV8_BLEND_FILL,                                           /*!< Fill with color */
+    LV8_BLEND_FILL_OPA,                                       /*!< Fill with color and opacity */
+    LV8_BLEND_FILL_MASK,                                      /*!< Fill with color through a mask */
+    LV8_BLEND_FILL_MASK_OPA,                                  /*!< Fill with color and opacity through a mask */
+    LV8_BLEND_COPY,                                           /*!< Copy image */
+    LV8_BLEND_COPY_OPA,                                       /*!< Blend image with opacity */
+    LV8_BLEND_COPY_MASK,                                      /*!< Copy image through a mask */
+    LV8_BLEND_COPY_MASK_OPA,                                  /*!< Blend image with opacity through a mask */
+    LV8_BLEND_OPERATIONS,
+} lv8_blend_operation_t;
+
+/**
+ * @brief Blend kernel
+ */
+typedef void (*lv8_blend_func_t)(const lvgl_port_blend_rgb565_dsc_t *dsc);
+
+/**
+ * @brief CPU cycle (or any time unit) counter
+ */
+typedef uint32_t (*lv8_blend_clock_t)(void);
+
+/**
+ * @brief Functionality test result
+ */
+typedef struct {
+    unsigned int combinations;                                /*!< Count of test combinations */
+    unsigned int failures;                                    /*!< Combinations, where the optimized kernel differs from the reference */
+    char first_failure[128];                                  /*!< Description of the first failing combination */
+} lv8_blend_func_result_t;
+
+/**
+ * @brief Operation names, for logs
+ */
+extern const char *const lv8_blend_operation_names[LV8_BLEND_OPERATIONS];
+
+// ------------------------------------------------- Test functions ----------------------------------------------------
+
+/**
+ * @brief Compare lvgl_port_blend_rgb565_esp() with lvgl_port_blend_rgb565_ref()
+ *
+ * - all widths up to 33 pixels, heights up to 3 lines, every pixel and mask alignment, line paddings,
+ *   opacities around LV_OPA_MAX, masks with runs of transparent and covering values
+ * - canary pixels around the destination must stay untouched
+ *
+ * @param[in] op Blend operation
+ * @param[out] res Test result
+ * @return false if out of memory
+ */
+bool lv8_blend_functionality(lv8_blend_operation_t op, lv8_blend_func_result_t *res);
+
+/**
+ * @brief Benchmark of one kernel on a 128x128 area
+ *
+ * - ideal case: 16-byte aligned buffers, 128 pixels wide, no line padding
+ * - corner case: buffers shifted by one pixel (one byte for mask), 127 pixels wide, line padding
+ *
+ * @param[in] op Blend operation
+ * @param[in] func Kernel
+ * @param[in] ideal Ideal or corner case
+ * @param[in] cycles Count of benchmark cycles
+ * @param[in] clock Counter
+ * @return counter ticks per pixel, negative if out of memory
+ */
+float lv8_blend_benchmark(lv8_blend_operation_t op, lv8_blend_func_t func, bool ideal, unsigned int cycles, lv8_blend_clock_t clock);
+
+#ifdef __cplusplus
+} /*extern "C"*/
+#endif
@@ -0,0 +1,92 @@
+/*
+ * SPDX-FileCopyrightText: 2025 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include "unity.h"
+#include "esp_log.h"
+#include "esp_cpu.h"
+#include "lv8_blend_common.h"
+
+#define BENCHMARK_CYCLES 1000
+
+// ------------------------------------------------ Static variables ---------------------------------------------------
+
+static const char *TAG_LV8_BLEND_BENCH = "LV8 Blend Benchmark";
+static const char *opt_ref_func[] = {"OPT", "REF"};
+
+// ------------------------------------------------ Static function headers --------------------------------------------
+
+/**
+ * @brief CPU cycle counter, both Xtensa and RISC-V
+ */
+static uint32_t lv8_blend_benchmark_clock(void);
+
+/**
+ * @brief Run the benchmark of one operation for both kernels, ideal and corner case
+ *
+ * @param[in] op Blend operation
+ */
+static void lv8_blend_benchmark_run(lv8_blend_operation_t op);
+
+// ------------------------------------------------ Test cases ---------------------------------------------------------
+
+/*
+Benchmark tests
+
+Requires:
+    - To pass functionality tests first
+
+Purpose:
+    - Test that an acceleration is achieved by the optimized LVGL8 RGB565 blend kernel over the reference
+
+Procedure:
+    - Run the optimized kernel multiple times (1000-times) on a 128x128 area, 16-byte aligned buffers, no line padding (ideal case)
+    - Run it on a 127x128 area, buffers shifted by one pixel, line padding (corner case)
+    - Count CPU cycles per pixel in both cases
+    - Repeat with the reference kernel
+    - The optimized kernel shall be faster in the ideal case
+*/
+
+// ------------------------------------------------ Test cases stages --------------------------------------------------
+
+TEST_CASE("LV8 Blend benchmark RGB565 fill", "[lv8][benchmark][RGB565]")
+{
+    lv8_blend_benchmark_run(LV8_BLEND_FILL);
+    lv8_blend_benchmark_run(LV8_BLEND_FILL_OPA);
+    lv8_blend_benchmark_run(LV8_BLEND_FILL_MASK);
+    lv8_blend_benchmark_run(LV8_BLEND_FILL_MASK_OPA);
+}
+
+TEST_CASE("LV8 Blend benchmark RGB565 image", "[lv8][benchmark][RGB565]")
+{
+    lv8_blend_benchmark_run(LV8_BLEND_COPY);
+    lv8_blend_benchmark_run(LV8_BLEND_COPY_OPA);
+    lv8_blend_benchmark_run(LV8_BLEND_COPY_MASK);
+    lv8_blend_benchmark_run(LV8_BLEND_COPY_MASK_OPA);
+}
+
+// ------------------------------------------------ Static test functions ----------------------------------------------
+
+static uint32_t lv8_blend_benchmark_clock(void)
+{
+    return (uint32_t)esp_cpu_get_cycle_count();
+}
+
+static void lv8_blend_benchmark_run(lv8_blend_operation_t op)
+{
+    float per_sample[2][2];
+
+    ESP_LOGI(TAG_LV8_BLEND_BENCH, "running test for %s", lv8_blend_operation_names[op]);
+    for (int i = 0; i < 2; i++) {
+        lv8_blend_func_t func = (i == 0) ? lvgl_port_blend_rgb565_esp : lvgl_port_blend_rgb565_ref;
+
+        per_sample[i][0] = lv8_blend_benchmark(op, func, true, BENCHMARK_CYCLES, lv8_blend_benchmark_clock);
+        per_sample[i][1] = lv8_blend_benchmark(op, func, false, BENCHMARK_CYCLES, lv8_blend_benchmark_clock);
+        TEST_ASSERT_TRUE_MESSAGE(per_sample[i][0] >= 0 && per_sample[i][1] >= 0, "Lack of memory");
+        ESP_LOGI(TAG_LV8_BLEND_BENCH, " %s ideal case: %.3f cycles per sample", opt_ref_func[i], per_sample[i][0]);
+        ESP_LOGI(TAG_LV8_BLEND_BENCH, " %s corner case: %.3f cycles per sample\n", opt_ref_func[i], per_sample[i][1]);
+    }
+    TEST_ASSERT_LESS_THAN_FLOAT(per_sample[1][0], per_sample[0][0]);
+}
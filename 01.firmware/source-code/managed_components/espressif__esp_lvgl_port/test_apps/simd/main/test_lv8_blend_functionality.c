@@ -0,0 +1,77 @@
+/*
+ * SPDX-FileCopyrightText: 2025 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include "unity.h"
+#include "esp_log.h"
+#include "lv8_blend_common.h"
+
+// ------------------------------------------------ Static variables ---------------------------------------------------
+
+static const char *TAG_LV8_BLEND_FUNC = "LV8 Blend Functionality";
+
+// ------------------------------------------------ Static function headers --------------------------------------------
+
+/**
+ * @brief Run the functionality test of one operation and evaluate it
+ *
+ * @param[in] op Blend operation
+ */
+static void lv8_blend_functionality_run(lv8_blend_operation_t op);
+
+// ------------------------------------------------ Test cases ---------------------------------------------------------
+
+/*
+Functionality tests
+
+Purpose:
+    - Test that the optimized LVGL8 RGB565 blend kernel achieves the same results as the reference (LVGL 8.4 fill_normal()
+      and map_normal() transcribed pixel by pixel)
+
+Procedure:
+    - For every destination width, height, line padding, pixel alignment of destination and source, byte alignment of mask
+      and opacity, generate the same input for both kernels
+    - Run the optimized and the reference kernel
+    - Compare the whole destination buffers, including canary pixels around and line padding
+    - The same test core is built on host, see ../host_test
+*/
+
+// ------------------------------------------------ Test cases stages --------------------------------------------------
+
+TEST_CASE("LV8 Blend functionality RGB565 fill", "[lv8][functionality][RGB565]")
+{
+    lv8_blend_functionality_run(LV8_BLEND_FILL);
+    lv8_blend_functionality_run(LV8_BLEND_FILL_OPA);
+}
+
+TEST_CASE("LV8 Blend functionality RGB565 fill with mask", "[lv8][functionality][RGB565]")
+{
+    lv8_blend_functionality_run(LV8_BLEND_FILL_MASK);
+    lv8_blend_functionality_run(LV8_BLEND_FILL_MASK_OPA);
+}
+
+TEST_CASE("LV8 Blend functionality RGB565 image", "[lv8][functionality][RGB565]")
+{
+    lv8_blend_functionality_run(LV8_BLEND_COPY);
+    lv8_blend_functionality_run(LV8_BLEND_COPY_OPA);
+}
+
+TEST_CASE("LV8 Blend functionality RGB565 image with mask", "[lv8][functionality][RGB565]")
+{
+    lv8_blend_functionality_run(LV8_BLEND_COPY_MASK);
+    lv8_blend_functionality_run(LV8_BLEND_COPY_MASK_OPA);
+}
+
+// ------------------------------------------------ Static test functions ----------------------------------------------
+
+static void lv8_blend_functionality_run(lv8_blend_operation_t op)
+{
+    lv8_blend_func_result_t res;
+
+    ESP_LOGI(TAG_LV8_BLEND_FUNC, "running test for %s", lv8_blend_operation_names[op]);
+    TEST_ASSERT_TRUE_MESSAGE(lv8_blend_functionality(op, &res), "Lack of memory");
+    ESP_LOGI(TAG_LV8_BLEND_FUNC, "test combinations: %u\n", res.combinations);
+    TEST_ASSERT_EQUAL_UINT_MESSAGE(0, res.failures, res.first_failure);
+}